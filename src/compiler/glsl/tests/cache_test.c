@@ -28,6 +28,7 @@
 #include <stdbool.h>
 #include <string.h>
 #include <ftw.h>
+#include <dirent.h>
 #include <errno.h>
 #include <stdarg.h>
 #include <inttypes.h>
@@ -37,6 +38,8 @@
 
 #include "util/mesa-sha1.h"
 #include "util/disk_cache.h"
+#include "util/macros.h"
+#include "util/u_queue.h"
 
 bool error = false;
 
@@ -493,6 +496,363 @@ test_put_key_and_get_key(void)
 
    disk_cache_destroy(cache);
 }
+
+/* Returns the number of pack files in cache_dir and their total size. */
+static unsigned
+get_pack_files(const char *cache_dir, off_t *total_size)
+{
+   unsigned count = 0;
+   struct dirent *entry;
+   DIR *dir;
+
+   *total_size = 0;
+
+   dir = opendir(cache_dir);
+   if (dir == NULL)
+      return 0;
+
+   while ((entry = readdir(dir)) != NULL) {
+      struct stat sb;
+
+      if (strncmp(entry->d_name, "pack.", 5) != 0 ||
+          strcmp(entry->d_name, "pack.idx") == 0)
+         continue;
+
+      if (fstatat(dirfd(dir), entry->d_name, &sb, 0) == 0) {
+         *total_size += sb.st_size;
+         count++;
+      }
+   }
+
+   closedir(dir);
+
+   return count;
+}
+
+static void
+test_single_file(void)
+{
+   const char *cache_dir = CACHE_TEST_TMP "/mesa-glsl-cache-dir/"
+                           CACHE_DIR_NAME;
+   struct disk_cache *cache;
+   uint8_t small[3][300], small_key[3][20];
+   uint8_t *big, big_key[5][20];
+   size_t size;
+   off_t pack_size;
+   char *result;
+   unsigned i, j;
+
+   setenv("MESA_GLSL_CACHE_SINGLE_FILE", "true", 1);
+   setenv("MESA_GLSL_CACHE_MAX_SIZE", "1K", 1);
+   cache = disk_cache_create("test", "make_check", 0);
+
+   /* Random data doesn't compress, so each item takes up a bit more than
+    * 300 bytes in the pack and the third one forces an eviction.
+    */
+   for (i = 0; i < 3; i++) {
+      for (j = 0; j < sizeof(small[i]); j++)
+         small[i][j] = rand();
+      disk_cache_compute_key(cache, small[i], sizeof(small[i]), small_key[i]);
+   }
+
+   disk_cache_put(cache, small_key[0], small[0], sizeof(small[0]), NULL);
+   wait_until_file_written(cache, small_key[0]);
+   disk_cache_put(cache, small_key[1], small[1], sizeof(small[1]), NULL);
+   wait_until_file_written(cache, small_key[1]);
+
+   result = disk_cache_get(cache, small_key[0], &size);
+   expect_true(result && size == sizeof(small[0]) &&
+               memcmp(result, small[0], size) == 0,
+               "disk_cache_get with single file");
+   free(result);
+
+   /* The first item was accessed last, so the second one gets evicted. */
+   disk_cache_put(cache, small_key[2], small[2], sizeof(small[2]), NULL);
+   wait_until_file_written(cache, small_key[2]);
+
+   expect_true(does_cache_contain(cache, small_key[2]),
+               "disk_cache_put with single file and eviction");
+   expect_true(does_cache_contain(cache, small_key[0]),
+               "single file eviction keeps recently used item");
+   expect_true(!does_cache_contain(cache, small_key[1]),
+               "single file eviction evicts least recently used item");
+
+   disk_cache_remove(cache, small_key[0]);
+   expect_true(!does_cache_contain(cache, small_key[0]),
+               "disk_cache_remove with single file");
+
+   /* Items must survive losing the index, (but removed ones must stay
+    * removed).
+    */
+   disk_cache_destroy(cache);
+
+   char *index_path;
+   if (asprintf(&index_path, "%s/pack.idx", cache_dir) == -1)
+      return;
+   unlink(index_path);
+   free(index_path);
+
+   cache = disk_cache_create("test", "make_check", 0);
+   expect_true(does_cache_contain(cache, small_key[2]),
+               "single file index recovery");
+   expect_true(!does_cache_contain(cache, small_key[0]),
+               "single file index recovery of removed item");
+   expect_true(!does_cache_contain(cache, small_key[1]),
+               "single file index recovery of evicted item");
+
+   /* Removing most of a large pack compacts it on the next put. */
+   disk_cache_destroy(cache);
+
+   setenv("MESA_GLSL_CACHE_MAX_SIZE", "4M", 1);
+   cache = disk_cache_create("test", "make_check", 0);
+
+   big = malloc(300 * 1024);
+   for (i = 0; i < 5; i++) {
+      for (j = 0; j < 300 * 1024; j++)
+         big[j] = rand();
+      disk_cache_compute_key(cache, big, 300 * 1024, big_key[i]);
+      disk_cache_put(cache, big_key[i], big, 300 * 1024, NULL);
+      wait_until_file_written(cache, big_key[i]);
+   }
+   free(big);
+
+   for (i = 0; i < 4; i++)
+      disk_cache_remove(cache, big_key[i]);
+
+   disk_cache_put(cache, small_key[0], small[0], sizeof(small[0]), NULL);
+   wait_until_file_written(cache, small_key[0]);
+
+   expect_true(does_cache_contain(cache, big_key[4]) &&
+               does_cache_contain(cache, small_key[0]) &&
+               does_cache_contain(cache, small_key[2]),
+               "single file compaction keeps live items");
+   expect_equal(get_pack_files(cache_dir, &pack_size), 1,
+                "single file compaction removes old pack");
+   expect_true(pack_size < 400 * 1024,
+               "single file compaction drops removed items");
+
+   disk_cache_destroy(cache);
+
+   unsetenv("MESA_GLSL_CACHE_SINGLE_FILE");
+}
+
+static void
+test_compression(void)
+{
+   static const char *codecs[] = {
+      "zlib", "zlib:1",
+#ifdef HAVE_ZSTD
+      "zstd", "zstd:19",
+#endif
+#ifdef HAVE_LZ4
+      "lz4", "lz4:9",
+#endif
+   };
+   uint8_t data[ARRAY_SIZE(codecs)][4096], key[ARRAY_SIZE(codecs)][20];
+   struct disk_cache *cache;
+   unsigned i, j, k;
+   char *result;
+   size_t size;
+
+   setenv("MESA_GLSL_CACHE_MAX_SIZE", "1M", 1);
+
+   /* Store an item with each codec... */
+   for (i = 0; i < ARRAY_SIZE(codecs); i++) {
+      for (j = 0; j < sizeof(data[i]); j++)
+         data[i][j] = "compressible shader binary"[j % 26] + i * (j % 3);
+
+      setenv("MESA_GLSL_CACHE_COMPRESSION", codecs[i], 1);
+      cache = disk_cache_create("test", "make_check", 0);
+
+      disk_cache_compute_key(cache, data[i], sizeof(data[i]), key[i]);
+      disk_cache_put(cache, key[i], data[i], sizeof(data[i]), NULL);
+      wait_until_file_written(cache, key[i]);
+
+      disk_cache_destroy(cache);
+   }
+
+   /* ...and check that every codec can read all of them back. */
+   for (i = 0; i < ARRAY_SIZE(codecs); i++) {
+      bool all_found = true;
+
+      setenv("MESA_GLSL_CACHE_COMPRESSION", codecs[i], 1);
+      cache = disk_cache_create("test", "make_check", 0);
+
+      for (k = 0; k < ARRAY_SIZE(codecs); k++) {
+         result = disk_cache_get(cache, key[k], &size);
+         if (!result || size != sizeof(data[k]) ||
+             memcmp(result, data[k], size) != 0)
+            all_found = false;
+         free(result);
+      }
+
+      expect_true(all_found, "disk_cache_get of items stored with any codec");
+
+      disk_cache_destroy(cache);
+   }
+
+   unsetenv("MESA_GLSL_CACHE_COMPRESSION");
+}
+
+#define PREFETCH_TEST_ITEMS 40
+
+struct prefetch_test_results {
+   uint8_t key[PREFETCH_TEST_ITEMS + 1][20];
+   void *data[PREFETCH_TEST_ITEMS + 1];
+   size_t size[PREFETCH_TEST_ITEMS + 1];
+   int calls[PREFETCH_TEST_ITEMS + 1];
+};
+
+static void
+prefetch_test_cb(void *cb_data, const cache_key key, void *data, size_t size)
+{
+   struct prefetch_test_results *results = cb_data;
+
+   for (unsigned i = 0; i < ARRAY_SIZE(results->key); i++) {
+      if (memcmp(results->key[i], key, 20) == 0) {
+         results->data[i] = data;
+         results->size[i] = size;
+         results->calls[i]++;
+         return;
+      }
+   }
+
+   free(data);
+}
+
+/* Returns whether a hot set manifest was written to cache_dir. */
+static bool
+has_hot_set_file(const char *cache_dir)
+{
+   struct dirent *entry;
+   bool found = false;
+   DIR *dir;
+
+   dir = opendir(cache_dir);
+   if (dir == NULL)
+      return false;
+
+   while ((entry = readdir(dir)) != NULL) {
+      if (strncmp(entry->d_name, "hotset.", 7) == 0 &&
+          strstr(entry->d_name, ".tmp") == NULL)
+         found = true;
+   }
+
+   closedir(dir);
+
+   return found;
+}
+
+static void
+test_prefetch(void)
+{
+   const char *cache_dir = CACHE_TEST_TMP "/mesa-glsl-cache-dir/"
+                           CACHE_DIR_NAME;
+   static struct prefetch_test_results results;
+   static uint8_t data[PREFETCH_TEST_ITEMS][1000];
+   struct util_queue_fence fence;
+   struct disk_cache *cache;
+   bool all_found, all_called;
+   char *result;
+   size_t size;
+   unsigned i, j;
+
+   setenv("MESA_GLSL_CACHE_MAX_SIZE", "1M", 1);
+   cache = disk_cache_create("test", "make_check", 0);
+
+   for (i = 0; i < PREFETCH_TEST_ITEMS; i++) {
+      for (j = 0; j < sizeof(data[i]); j++)
+         data[i][j] = rand();
+      disk_cache_compute_key(cache, data[i], sizeof(data[i]),
+                             results.key[i]);
+      disk_cache_put(cache, results.key[i], data[i], sizeof(data[i]), NULL);
+   }
+   for (i = 0; i < PREFETCH_TEST_ITEMS; i++)
+      wait_until_file_written(cache, results.key[i]);
+
+   /* The last key is never stored. */
+   disk_cache_compute_key(cache, "missing", 7, results.key[i]);
+
+   /* With a callback, every key is reported once. */
+   util_queue_fence_init(&fence);
+   disk_cache_prefetch(cache, (const cache_key *) results.key,
+                       ARRAY_SIZE(results.key), prefetch_test_cb, &results,
+                       &fence);
+   util_queue_fence_wait(&fence);
+
+   all_found = true;
+   all_called = true;
+   for (i = 0; i < ARRAY_SIZE(results.key); i++) {
+      if (results.calls[i] != 1)
+         all_called = false;
+      if (i < PREFETCH_TEST_ITEMS ?
+          (!results.data[i] || results.size[i] != sizeof(data[i]) ||
+           memcmp(results.data[i], data[i], sizeof(data[i])) != 0) :
+          results.data[i] != NULL)
+         all_found = false;
+      free(results.data[i]);
+   }
+
+   expect_true(all_called, "disk_cache_prefetch calls back once per key");
+   expect_true(all_found, "disk_cache_prefetch with a callback");
+
+   /* Without one, disk_cache_get() hands out the prefetched items, even
+    * after they are gone from the disk.
+    */
+   disk_cache_prefetch(cache, (const cache_key *) results.key,
+                       ARRAY_SIZE(results.key), NULL, NULL, &fence);
+   util_queue_fence_wait(&fence);
+   util_queue_fence_destroy(&fence);
+
+   for (i = 0; i < PREFETCH_TEST_ITEMS; i++)
+      disk_cache_remove(cache, results.key[i]);
+
+   all_found = true;
+   for (i = 0; i < PREFETCH_TEST_ITEMS; i++) {
+      result = disk_cache_get(cache, results.key[i], &size);
+      if (!result || size != sizeof(data[i]) ||
+          memcmp(result, data[i], size) != 0)
+         all_found = false;
+      free(result);
+   }
+
+   expect_true(all_found, "disk_cache_get of prefetched items");
+   expect_null(disk_cache_get(cache, results.key[i], &size),
+               "disk_cache_get of a missing prefetched item");
+
+   disk_cache_destroy(cache);
+
+   /* The items used by one run are prefetched by the next. */
+   setenv("MESA_GLSL_CACHE_HOT_SET", "true", 1);
+   cache = disk_cache_create("test", "make_check", 0);
+
+   for (i = 0; i < 2; i++) {
+      disk_cache_put(cache, results.key[i], data[i], sizeof(data[i]), NULL);
+      wait_until_file_written(cache, results.key[i]);
+   }
+
+   disk_cache_destroy(cache);
+
+   expect_true(has_hot_set_file(cache_dir),
+               "hot set manifest written on disk_cache_destroy");
+
+   cache = disk_cache_create("test", "make_check", 0);
+
+   all_found = true;
+   for (i = 0; i < 2; i++) {
+      result = disk_cache_get(cache, results.key[i], &size);
+      if (!result || size != sizeof(data[i]) ||
+          memcmp(result, data[i], size) != 0)
+         all_found = false;
+      free(result);
+   }
+
+   expect_true(all_found, "disk_cache_get of hot set items");
+
+   disk_cache_destroy(cache);
+
+   unsetenv("MESA_GLSL_CACHE_HOT_SET");
+}
 #endif /* ENABLE_SHADER_CACHE */
 
 int
@@ -507,6 +867,12 @@ main(void)
 
    test_put_key_and_get_key();
 
+   test_single_file();
+
+   test_compression();
+
+   test_prefetch();
+
    err = rmrf_local(CACHE_TEST_TMP);
    expect_equal(err, 0, "Removing " CACHE_TEST_TMP " again");
 #endif /* ENABLE_SHADER_CACHE */
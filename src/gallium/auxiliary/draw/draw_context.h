@@ -45,10 +45,13 @@ struct draw_context;
 struct draw_stage;
 struct draw_vertex_shader;
 struct draw_geometry_shader;
+struct draw_tess_ctrl_shader;
+struct draw_tess_eval_shader;
 struct draw_fragment_shader;
 struct tgsi_sampler;
 struct tgsi_image;
 struct tgsi_buffer;
+struct lp_cached_code;
 
 /*
  * structure to contain driver internal information 
@@ -150,6 +153,9 @@ draw_total_vs_outputs(const struct draw_context *draw);
 uint
 draw_total_gs_outputs(const struct draw_context *draw);
 
+uint
+draw_total_tes_outputs(const struct draw_context *draw);
+
 void
 draw_texture_sampler(struct draw_context *draw,
                      enum pipe_shader_type shader_type,
@@ -188,6 +194,24 @@ draw_set_mapped_texture(struct draw_context *draw,
                         uint32_t mip_offsets[PIPE_MAX_TEXTURE_LEVELS]);
 
 
+/**
+ * Callbacks into the driver's persistent shader cache, used to store the
+ * machine code of JIT-compiled shader variants.
+ */
+typedef void (*draw_disk_cache_find_shader_func)(void *cookie,
+                                                 struct lp_cached_code *cache,
+                                                 unsigned char ir_sha1_cache_key[20]);
+typedef void (*draw_disk_cache_insert_shader_func)(void *cookie,
+                                                   struct lp_cached_code *cache,
+                                                   unsigned char ir_sha1_cache_key[20]);
+
+void
+draw_set_disk_cache_callbacks(struct draw_context *draw,
+                              void *data_cookie,
+                              draw_disk_cache_find_shader_func find_shader,
+                              draw_disk_cache_insert_shader_func insert_shader);
+
+
 /*
  * Vertex shader functions
  */
@@ -226,6 +250,29 @@ void draw_bind_geometry_shader(struct draw_context *draw,
 void draw_delete_geometry_shader(struct draw_context *draw,
                                  struct draw_geometry_shader *dvs);
 
+/*
+ * Tessellation shader functions
+ */
+struct draw_tess_ctrl_shader *
+draw_create_tess_ctrl_shader(struct draw_context *draw,
+                             const struct pipe_shader_state *shader);
+void draw_bind_tess_ctrl_shader(struct draw_context *draw,
+                                struct draw_tess_ctrl_shader *dtcs);
+void draw_delete_tess_ctrl_shader(struct draw_context *draw,
+                                  struct draw_tess_ctrl_shader *dtcs);
+
+struct draw_tess_eval_shader *
+draw_create_tess_eval_shader(struct draw_context *draw,
+                             const struct pipe_shader_state *shader);
+void draw_bind_tess_eval_shader(struct draw_context *draw,
+                                struct draw_tess_eval_shader *dtes);
+void draw_delete_tess_eval_shader(struct draw_context *draw,
+                                  struct draw_tess_eval_shader *dtes);
+
+void draw_set_tess_state(struct draw_context *draw,
+                         const float default_outer_level[4],
+                         const float default_inner_level[2]);
+
 
 /*
  * Vertex data functions
@@ -52,11 +52,15 @@
 
 #include "tgsi/tgsi_exec.h"
 #include "tgsi/tgsi_dump.h"
+#include "tgsi/tgsi_parse.h"
 
 #include "util/u_math.h"
 #include "util/u_pointer.h"
 #include "util/u_string.h"
 #include "util/simple_list.h"
+#include "util/mesa-sha1.h"
+#include "util/os_time.h"
+#include "util/u_atomic.h"
 
 
 #define DEBUG_STORE 0
@@ -485,6 +489,9 @@ get_vertex_header_ptr_type(struct draw_llvm_variant *variant)
 }
 
 
+DEBUG_GET_ONCE_NUM_OPTION(draw_compile_threads, "DRAW_COMPILE_THREADS", 0)
+
+
 /**
  * Create per-context LLVM info.
  */
@@ -516,6 +523,12 @@ draw_llvm_create(struct draw_context *draw, LLVMContextRef context)
    llvm->nr_gs_variants = 0;
    make_empty_list(&llvm->gs_variants_list);
 
+   if (debug_get_option_draw_compile_threads())
+      util_queue_init(&llvm->compile_queue, "drawcompile", 32,
+                      debug_get_option_draw_compile_threads(),
+                      UTIL_QUEUE_INIT_RESIZE_IF_FULL |
+                      UTIL_QUEUE_INIT_USE_MINIMUM_PRIORITY);
+
    return llvm;
 
 fail:
@@ -530,6 +543,9 @@ fail:
 void
 draw_llvm_destroy(struct draw_llvm *llvm)
 {
+   if (util_queue_is_initialized(&llvm->compile_queue))
+      util_queue_destroy(&llvm->compile_queue);
+
    if (llvm->context_owned)
       LLVMContextDispose(llvm->context);
    llvm->context = NULL;
@@ -539,6 +555,30 @@ draw_llvm_destroy(struct draw_llvm *llvm)
 }
 
 
+/**
+ * Compute the key under which a variant's machine code is stored in the
+ * driver's persistent cache.  The generated code is fully determined by
+ * the shader tokens, the variant key and the vertex header size.
+ */
+static void
+draw_get_ir_cache_key(const char *stage,
+                      const struct tgsi_token *tokens,
+                      const void *key, unsigned key_size,
+                      unsigned num_io,
+                      unsigned char ir_sha1_cache_key[20])
+{
+   struct mesa_sha1 ctx;
+
+   _mesa_sha1_init(&ctx);
+   _mesa_sha1_update(&ctx, stage, strlen(stage));
+   _mesa_sha1_update(&ctx, tokens,
+                     tgsi_num_tokens(tokens) * sizeof(struct tgsi_token));
+   _mesa_sha1_update(&ctx, key, key_size);
+   _mesa_sha1_update(&ctx, &num_io, sizeof num_io);
+   _mesa_sha1_final(&ctx, ir_sha1_cache_key);
+}
+
+
 /**
  * Create LLVM-generated code for a vertex shader.
  */
@@ -552,6 +592,11 @@ draw_llvm_create_variant(struct draw_llvm *llvm,
       llvm_vertex_shader(llvm->draw->vs.vertex_shader);
    LLVMTypeRef vertex_header;
    char module_name[64];
+   unsigned char ir_sha1_cache_key[20];
+   struct lp_cached_code cached = { 0 };
+   boolean needs_caching = FALSE;
+   boolean compile_async;
+   int64_t start_time = os_time_get_nano();
 
    variant = MALLOC(sizeof *variant +
                     shader->variant_key_size -
@@ -561,18 +606,39 @@ draw_llvm_create_variant(struct draw_llvm *llvm,
 
    variant->llvm = llvm;
    variant->shader = shader;
+   variant->num_inputs = num_inputs;
+   variant->uses = 0;
+   variant->fallback_gallivm = NULL;
+   memset(&variant->tier_stats, 0, sizeof variant->tier_stats);
+   util_queue_fence_init(&variant->optimized);
 
    util_snprintf(module_name, sizeof(module_name), "draw_llvm_vs_variant%u",
                  variant->shader->variants_cached);
 
-   variant->gallivm = gallivm_create(module_name, llvm->context);
+   if (llvm->draw->disk_cache_cookie) {
+      draw_get_ir_cache_key("vs", shader->base.state.tokens,
+                            key, shader->variant_key_size, num_inputs,
+                            ir_sha1_cache_key);
+      llvm->draw->disk_cache_find_shader(llvm->draw->disk_cache_cookie,
+                                         &cached, ir_sha1_cache_key);
+      needs_caching = !cached.data_size;
+   }
+
+   compile_async = util_queue_is_initialized(&llvm->compile_queue) &&
+                   !cached.data_size;
+
+   /* The unoptimized code must not end up in the disk cache */
+   variant->gallivm = gallivm_create(module_name, llvm->context,
+                                     compile_async ? NULL : &cached);
+   variant->gallivm->no_opt = compile_async;
+   variant->tier = compile_async ? 0 : 1;
 
    create_jit_types(variant);
 
    memcpy(&variant->key, key, shader->variant_key_size);
 
    if (gallivm_debug & (GALLIVM_DEBUG_TGSI | GALLIVM_DEBUG_IR)) {
-      tgsi_dump(llvm->draw->vs.vertex_shader->state.tokens, 0);
+      tgsi_dump(shader->base.state.tokens, 0);
       draw_llvm_dump_variant_key(&variant->key);
    }
 
@@ -587,7 +653,15 @@ draw_llvm_create_variant(struct draw_llvm *llvm,
    variant->jit_func = (draw_jit_vert_func)
          gallivm_jit_function(variant->gallivm, variant->function);
 
+   if (needs_caching && !compile_async)
+      llvm->draw->disk_cache_insert_shader(llvm->draw->disk_cache_cookie,
+                                           &cached, ir_sha1_cache_key);
+
    gallivm_free_ir(variant->gallivm);
+   free(cached.data);
+
+   variant->tier_stats.compile_time[variant->tier] =
+      os_time_get_nano() - start_time;
 
    variant->list_item_global.base = variant;
    variant->list_item_local.base = variant;
@@ -598,6 +672,96 @@ draw_llvm_create_variant(struct draw_llvm *llvm,
 }
 
 
+static void
+draw_llvm_compile_job_execute(void *data, int thread_index)
+{
+   struct draw_llvm_variant *variant = data;
+   struct draw_llvm *llvm = variant->llvm;
+   struct llvm_vertex_shader *shader = variant->shader;
+   struct gallivm_state *gallivm;
+   struct lp_cached_code cached = { 0 };
+   unsigned char ir_sha1_cache_key[20];
+   LLVMContextRef context;
+   LLVMTypeRef vertex_header;
+   draw_jit_vert_func jit_func;
+   char module_name[64];
+   int64_t start_time = os_time_get_nano();
+
+   /* The draw_llvm's LLVMContext is in use by the draw thread */
+   context = LLVMContextCreate();
+   if (!context)
+      return;
+
+   util_snprintf(module_name, sizeof(module_name),
+                 "draw_llvm_vs_variant%u_opt", shader->variants_cached);
+
+   gallivm = gallivm_create(module_name, context, &cached);
+   if (!gallivm) {
+      LLVMContextDispose(context);
+      return;
+   }
+
+   /* The draw thread only touches variant->gallivm once this job is done,
+    * and the types must be recreated in the new LLVMContext.
+    */
+   variant->fallback_gallivm = variant->gallivm;
+   variant->gallivm = gallivm;
+   variant->context_ptr_type = NULL;
+   variant->buffer_ptr_type = NULL;
+   variant->vb_ptr_type = NULL;
+
+   create_jit_types(variant);
+
+   vertex_header = create_jit_vertex_header(gallivm, variant->num_inputs);
+   variant->vertex_header_ptr_type = LLVMPointerType(vertex_header, 0);
+
+   draw_llvm_generate(llvm, variant);
+
+   gallivm_compile_module(gallivm);
+
+   jit_func = (draw_jit_vert_func)
+         gallivm_jit_function(gallivm, variant->function);
+
+   if (llvm->draw->disk_cache_cookie) {
+      draw_get_ir_cache_key("vs", shader->base.state.tokens,
+                            &variant->key, shader->variant_key_size,
+                            variant->num_inputs, ir_sha1_cache_key);
+      llvm->draw->disk_cache_insert_shader(llvm->draw->disk_cache_cookie,
+                                           &cached, ir_sha1_cache_key);
+   }
+
+   gallivm_free_ir(gallivm);
+   free(cached.data);
+   LLVMContextDispose(context);
+
+   variant->tier_stats.compile_time[1] = os_time_get_nano() - start_time;
+
+   /*
+    * Vertex shading threads may be running the unoptimized code right
+    * now, it stays alive until the variant is destroyed.
+    */
+   p_atomic_set(&variant->jit_func, jit_func);
+   p_atomic_set(&variant->tier, 1);
+}
+
+
+/**
+ * Count a run of the variant, and queue the compilation of its optimized
+ * code once it has been run gallivm_tier_up_uses times.
+ */
+void
+draw_llvm_variant_used(struct draw_llvm_variant *variant)
+{
+   if (variant->tier != 0 ||
+       ++variant->uses != MAX2(gallivm_tier_up_uses, 1))
+      return;
+
+   util_queue_add_job(&variant->llvm->compile_queue, variant,
+                      &variant->optimized,
+                      draw_llvm_compile_job_execute, NULL);
+}
+
+
 static void
 generate_vs(struct draw_llvm_variant *variant,
             LLVMBuilderRef builder,
@@ -609,8 +773,8 @@ generate_vs(struct draw_llvm_variant *variant,
             const struct lp_build_sampler_soa *draw_sampler,
             boolean clamp_vertex_color)
 {
-   struct draw_llvm *llvm = variant->llvm;
-   const struct tgsi_token *tokens = llvm->draw->vs.vertex_shader->state.tokens;
+   const struct draw_vertex_shader *vs = &variant->shader->base;
+   const struct tgsi_token *tokens = vs->state.tokens;
    LLVMValueRef consts_ptr =
       draw_jit_context_vs_constants(variant->gallivm, context_ptr);
    LLVMValueRef num_consts_ptr =
@@ -628,14 +792,15 @@ generate_vs(struct draw_llvm_variant *variant,
                      context_ptr,
                      NULL,
                      draw_sampler,
-                     &llvm->draw->vs.vertex_shader->info,
+                     &vs->info,
+                     NULL,
                      NULL);
 
    {
       LLVMValueRef out;
       unsigned chan, attrib;
       struct lp_build_context bld;
-      struct tgsi_shader_info* info = &llvm->draw->vs.vertex_shader->info;
+      const struct tgsi_shader_info *info = &vs->info;
       lp_build_context_init(&bld, variant->gallivm, vs_type);
 
       for (attrib = 0; attrib < info->num_outputs; ++attrib) {
@@ -1081,7 +1246,7 @@ generate_viewport(struct draw_llvm_variant *variant,
    int i;
    struct gallivm_state *gallivm = variant->gallivm;
    struct lp_type f32_type = vs_type;
-   const unsigned pos = variant->llvm->draw->vs.position_output;
+   const unsigned pos = variant->shader->base.position_output;
    LLVMTypeRef vs_type_llvm = lp_build_vec_type(gallivm, vs_type);
    LLVMValueRef out3 = LLVMBuildLoad(builder, outputs[pos][3], ""); /*w0 w1 .. wn*/
    LLVMValueRef const1 = lp_build_const_vec(gallivm, f32_type, 1.0);       /*1.0 1.0 1.0 1.0*/
@@ -1131,7 +1296,7 @@ generate_viewport(struct draw_llvm_variant *variant,
  * Returns clipmask as nxi32 bitmask for the n vertices
  */
 static LLVMValueRef
-generate_clipmask(struct draw_llvm *llvm,
+generate_clipmask(const struct draw_vertex_shader *vs,
                   struct gallivm_state *gallivm,
                   struct lp_type vs_type,
                   LLVMValueRef (*outputs)[TGSI_NUM_CHANNELS],
@@ -1148,16 +1313,16 @@ generate_clipmask(struct draw_llvm *llvm,
    LLVMValueRef plane1, planes, plane_ptr, sum;
    struct lp_type f32_type = vs_type;
    struct lp_type i32_type = lp_int_type(vs_type);
-   const unsigned pos = llvm->draw->vs.position_output;
-   const unsigned cv = llvm->draw->vs.clipvertex_output;
-   int num_written_clipdistance = llvm->draw->vs.vertex_shader->info.num_written_clipdistance;
+   const unsigned pos = vs->position_output;
+   const unsigned cv = vs->clipvertex_output;
+   int num_written_clipdistance = vs->info.num_written_clipdistance;
    boolean have_cd = false;
    boolean clip_user = key->clip_user;
    unsigned ucp_enable = key->ucp_enable;
    unsigned cd[2];
 
-   cd[0] = llvm->draw->vs.ccdistance_output[0];
-   cd[1] = llvm->draw->vs.ccdistance_output[1];
+   cd[0] = vs->ccdistance_output[0];
+   cd[1] = vs->ccdistance_output[1];
 
    if (cd[0] != pos || cd[1] != pos)
       have_cd = true;
@@ -1321,7 +1486,7 @@ generate_clipmask(struct draw_llvm *llvm,
        * This isn't really part of clipmask but stored the same in vertex
        * header later, so do it here.
        */
-      unsigned edge_attr = llvm->draw->vs.edgeflag_output;
+      unsigned edge_attr = vs->edgeflag_output;
       LLVMValueRef one = lp_build_const_vec(gallivm, f32_type, 1.0);
       LLVMValueRef edgeflag = LLVMBuildLoad(builder, outputs[edge_attr][0], "");
       test = lp_build_compare(gallivm, f32_type, PIPE_FUNC_EQUAL, one, edgeflag);
@@ -1542,8 +1707,8 @@ draw_llvm_generate(struct draw_llvm *llvm, struct draw_llvm_variant *variant)
    LLVMValueRef instance_index[PIPE_MAX_ATTRIBS];
    LLVMValueRef fake_buf_ptr, fake_buf;
 
-   struct draw_context *draw = llvm->draw;
-   const struct tgsi_shader_info *vs_info = &draw->vs.vertex_shader->info;
+   const struct draw_vertex_shader *vs = &variant->shader->base;
+   const struct tgsi_shader_info *vs_info = &vs->info;
    unsigned i, j;
    struct lp_build_context bld, blduivec;
    struct lp_build_loop_state lp_loop;
@@ -1567,15 +1732,15 @@ draw_llvm_generate(struct draw_llvm *llvm, struct draw_llvm_variant *variant)
                                                     key->clip_user ||
                                                     key->need_edgeflags);
    LLVMValueRef variant_func;
-   const unsigned pos = draw->vs.position_output;
-   const unsigned cv = draw->vs.clipvertex_output;
+   const unsigned pos = vs->position_output;
+   const unsigned cv = vs->clipvertex_output;
    boolean have_clipdist = FALSE;
    struct lp_bld_tgsi_system_values system_values;
 
    memset(&system_values, 0, sizeof(system_values));
 
-   util_snprintf(func_name, sizeof(func_name), "draw_llvm_vs_variant%u",
-                 variant->shader->variants_cached);
+   /* Fixed name, so that the code can be reused from the disk cache. */
+   util_snprintf(func_name, sizeof(func_name), "draw_llvm_vs_variant");
 
    i = 0;
    arg_types[i++] = get_context_ptr_type(variant);       /* context */
@@ -1916,7 +2081,7 @@ draw_llvm_generate(struct draw_llvm *llvm, struct draw_llvm_variant *variant)
          if (enable_cliptest) {
             LLVMValueRef temp = LLVMBuildLoad(builder, clipmask_bool_ptr, "");
             /* allocate clipmask, assign it integer type */
-            clipmask = generate_clipmask(llvm,
+            clipmask = generate_clipmask(vs,
                                          gallivm,
                                          vs_type,
                                          outputs,
@@ -2161,7 +2326,21 @@ draw_llvm_destroy_variant(struct draw_llvm_variant *variant)
                     variant->shader->variants_cached, llvm->nr_variants);
    }
 
+   if (gallivm_debug & GALLIVM_DEBUG_PERF) {
+      char name[64];
+      util_snprintf(name, sizeof(name), "draw_llvm_vs_variant%u",
+                    variant->shader->variants_cached);
+      gallivm_print_tier_stats(name, &variant->tier_stats);
+   }
+
+   /* Cancel or wait for the background compilation, if any */
+   if (util_queue_is_initialized(&llvm->compile_queue))
+      util_queue_drop_job(&llvm->compile_queue, &variant->optimized);
+   util_queue_fence_destroy(&variant->optimized);
+
    gallivm_destroy(variant->gallivm);
+   if (variant->fallback_gallivm)
+      gallivm_destroy(variant->fallback_gallivm);
 
    remove_from_list(&variant->list_item_local);
    variant->shader->variants_cached--;
@@ -2254,8 +2433,8 @@ draw_gs_llvm_generate(struct draw_llvm *llvm,
 
    memset(&system_values, 0, sizeof(system_values));
 
-   util_snprintf(func_name, sizeof(func_name), "draw_llvm_gs_variant%u",
-                 variant->shader->variants_cached);
+   /* Fixed name, so that the code can be reused from the disk cache. */
+   util_snprintf(func_name, sizeof(func_name), "draw_llvm_gs_variant");
 
    assert(variant->vertex_header_ptr_type);
 
@@ -2356,7 +2535,8 @@ draw_gs_llvm_generate(struct draw_llvm *llvm,
                      NULL,
                      sampler,
                      &llvm->draw->gs.geometry_shader->info,
-                     (const struct lp_build_tgsi_gs_iface *)&gs_iface);
+                     (const struct lp_build_tgsi_gs_iface *)&gs_iface,
+                     NULL);
 
    sampler->destroy(sampler);
 
@@ -2378,6 +2558,9 @@ draw_gs_llvm_create_variant(struct draw_llvm *llvm,
       llvm_geometry_shader(llvm->draw->gs.geometry_shader);
    LLVMTypeRef vertex_header;
    char module_name[64];
+   unsigned char ir_sha1_cache_key[20];
+   struct lp_cached_code cached = { 0 };
+   boolean needs_caching = FALSE;
 
    variant = MALLOC(sizeof *variant +
                     shader->variant_key_size -
@@ -2391,7 +2574,16 @@ draw_gs_llvm_create_variant(struct draw_llvm *llvm,
    util_snprintf(module_name, sizeof(module_name), "draw_llvm_gs_variant%u",
                  variant->shader->variants_cached);
 
-   variant->gallivm = gallivm_create(module_name, llvm->context);
+   if (llvm->draw->disk_cache_cookie) {
+      draw_get_ir_cache_key("gs", shader->base.state.tokens,
+                            key, shader->variant_key_size, num_outputs,
+                            ir_sha1_cache_key);
+      llvm->draw->disk_cache_find_shader(llvm->draw->disk_cache_cookie,
+                                         &cached, ir_sha1_cache_key);
+      needs_caching = !cached.data_size;
+   }
+
+   variant->gallivm = gallivm_create(module_name, llvm->context, &cached);
 
    create_gs_jit_types(variant);
 
@@ -2408,7 +2600,12 @@ draw_gs_llvm_create_variant(struct draw_llvm *llvm,
    variant->jit_func = (draw_gs_jit_func)
          gallivm_jit_function(variant->gallivm, variant->function);
 
+   if (needs_caching)
+      llvm->draw->disk_cache_insert_shader(llvm->draw->disk_cache_cookie,
+                                           &cached, ir_sha1_cache_key);
+
    gallivm_free_ir(variant->gallivm);
+   free(cached.data);
 
    variant->list_item_global.base = variant;
    variant->list_item_local.base = variant;
@@ -35,9 +35,11 @@
 
 #include "gallivm/lp_bld_sample.h"
 #include "gallivm/lp_bld_limits.h"
+#include "gallivm/lp_bld_init.h"
 
 #include "pipe/p_context.h"
 #include "util/simple_list.h"
+#include "util/u_queue.h"
 
 
 struct draw_llvm;
@@ -388,6 +390,19 @@ struct draw_llvm_variant
    struct draw_llvm_variant_list_item list_item_global;
    struct draw_llvm_variant_list_item list_item_local;
 
+   /*
+    * Tiered compilation: the variant starts out with unoptimized code
+    * (tier 0) and is recompiled with optimizations in the background once
+    * it has been run gallivm_tier_up_uses times.  The unoptimized code is
+    * kept in fallback_gallivm, as other threads may still be running it.
+    */
+   unsigned num_inputs;
+   unsigned tier;
+   unsigned uses;
+   struct util_queue_fence optimized;
+   struct gallivm_state *fallback_gallivm;
+   struct gallivm_tier_stats tier_stats;
+
    /* key is variable-sized, must be last */
    struct draw_llvm_variant_key key;
 };
@@ -451,6 +466,9 @@ struct draw_llvm {
 
    struct draw_gs_llvm_variant_list_item gs_variants_list;
    int nr_gs_variants;
+
+   /** Optimizes the vertex shader variants in the background */
+   struct util_queue compile_queue;
 };
 
 
@@ -483,6 +501,9 @@ draw_llvm_create_variant(struct draw_llvm *llvm,
 void
 draw_llvm_destroy_variant(struct draw_llvm_variant *variant);
 
+void
+draw_llvm_variant_used(struct draw_llvm_variant *variant);
+
 struct draw_llvm_variant_key *
 draw_llvm_make_variant_key(struct draw_llvm *llvm, char *store);
 
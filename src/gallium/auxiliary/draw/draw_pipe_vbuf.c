@@ -433,7 +433,7 @@ draw_vbuf_stage(struct draw_context *draw, struct vbuf_render *render)
    if (!vbuf->indices)
       goto fail;
 
-   vbuf->cache = translate_cache_create();
+   vbuf->cache = draw_translate_cache_create(draw);
    if (!vbuf->cache)
       goto fail;
 
@@ -46,6 +46,8 @@
 
 #include "tgsi/tgsi_scan.h"
 
+#include "draw_context.h"
+
 #ifdef HAVE_LLVM
 struct gallivm_state;
 #endif
@@ -54,6 +56,12 @@ struct gallivm_state;
 /** Sum of frustum planes and user-defined planes */
 #define DRAW_TOTAL_CLIP_PLANES (6 + PIPE_MAX_CLIP_PLANES)
 
+/**
+ * Number of interpreter machines needed to run all the invocations of a
+ * tessellation control shader patch, four invocations per machine.
+ */
+#define DRAW_TCS_MAX_MACHINES 8
+
 /**
  * The largest possible index of a vertex that can be fetched.
  */
@@ -65,12 +73,14 @@ struct draw_context;
 struct draw_stage;
 struct vbuf_render;
 struct tgsi_exec_machine;
+struct tgsi_exec_vector;
 struct tgsi_sampler;
 struct tgsi_image;
 struct tgsi_buffer;
 struct draw_pt_front_end;
 struct draw_assembler;
 struct draw_llvm;
+struct translate_cache;
 
 
 /**
@@ -205,11 +215,18 @@ struct draw_context
          unsigned vs_constants_size[PIPE_MAX_CONSTANT_BUFFERS];
          const void *gs_constants[PIPE_MAX_CONSTANT_BUFFERS];
          unsigned gs_constants_size[PIPE_MAX_CONSTANT_BUFFERS];
+         const void *tcs_constants[PIPE_MAX_CONSTANT_BUFFERS];
+         unsigned tcs_constants_size[PIPE_MAX_CONSTANT_BUFFERS];
+         const void *tes_constants[PIPE_MAX_CONSTANT_BUFFERS];
+         unsigned tes_constants_size[PIPE_MAX_CONSTANT_BUFFERS];
          
          /* pointer to planes */
          float (*planes)[DRAW_TOTAL_CLIP_PLANES][4]; 
       } user;
 
+      /** number of vertices per patch for PIPE_PRIM_PATCHES */
+      unsigned vertices_per_patch;
+
       boolean test_fse;         /* enable FSE even though its not correct (eg for softpipe) */
       boolean no_fse;           /* disable FSE even when it is correct */
    } pt;
@@ -296,6 +313,42 @@ struct draw_context
 
    } gs;
 
+   /** Tessellation control shader state */
+   struct {
+      struct draw_tess_ctrl_shader *tess_ctrl_shader;
+
+      /** Fields for TGSI interpreter / execution */
+      struct {
+         struct tgsi_exec_machine *machines[DRAW_TCS_MAX_MACHINES];
+         struct tgsi_exec_vector *inputs;
+         struct tgsi_exec_vector *outputs;
+
+         struct tgsi_sampler *sampler;
+         struct tgsi_image *image;
+         struct tgsi_buffer *buffer;
+      } tgsi;
+
+      /** Tessellation levels used when no control shader is bound */
+      float default_outer_level[4];
+      float default_inner_level[2];
+   } tcs;
+
+   /** Tessellation evaluation shader state */
+   struct {
+      struct draw_tess_eval_shader *tess_eval_shader;
+      uint num_tes_outputs;  /**< convenience, from tess_eval_shader */
+      uint position_output;
+
+      /** Fields for TGSI interpreter / execution */
+      struct {
+         struct tgsi_exec_machine *machine;
+
+         struct tgsi_sampler *sampler;
+         struct tgsi_image *image;
+         struct tgsi_buffer *buffer;
+      } tgsi;
+   } tes;
+
    /** Fragment shader state */
    struct {
       struct draw_fragment_shader *fragment_shader;
@@ -326,6 +379,11 @@ struct draw_context
 
    struct draw_llvm *llvm;
 
+   /** Driver's persistent cache for JIT-compiled variants, may be NULL */
+   void *disk_cache_cookie;
+   draw_disk_cache_find_shader_func disk_cache_find_shader;
+   draw_disk_cache_insert_shader_func disk_cache_insert_shader;
+
    /** Texture sampler and sampler view state.
     * Note that we have arrays indexed by shader type.  At this time
     * we only handle vertex and geometry shaders in the draw module, but
@@ -383,6 +441,7 @@ struct draw_prim_info {
  */
 boolean draw_init(struct draw_context *draw);
 void draw_new_instance(struct draw_context *draw);
+struct translate_cache *draw_translate_cache_create(struct draw_context *draw);
 
 /*******************************************************************************
  * Vertex shader code:
@@ -399,6 +458,13 @@ boolean draw_gs_init( struct draw_context *draw );
 
 void draw_gs_destroy( struct draw_context *draw );
 
+
+/*******************************************************************************
+ * Tessellation shading code:
+ */
+boolean draw_tess_init( struct draw_context *draw );
+void draw_tess_destroy( struct draw_context *draw );
+
 /*******************************************************************************
  * Common shading code:
  */
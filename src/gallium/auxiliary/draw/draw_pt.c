@@ -32,6 +32,7 @@
 
 #include "draw/draw_context.h"
 #include "draw/draw_gs.h"
+#include "draw/draw_tess.h"
 #include "draw/draw_private.h"
 #include "draw/draw_pt.h"
 #include "draw/draw_vbuf.h"
@@ -66,7 +67,12 @@ draw_pt_arrays(struct draw_context *draw,
     */
    {
       unsigned first, incr;
-      draw_pt_split_prim(prim, &first, &incr);
+
+      if (prim == PIPE_PRIM_PATCHES) {
+         first = incr = draw->pt.vertices_per_patch;
+      } else {
+         draw_pt_split_prim(prim, &first, &incr);
+      }
       count = draw_pt_trim_count(count, first, incr);
       if (count < first)
          return TRUE;
@@ -75,6 +81,8 @@ draw_pt_arrays(struct draw_context *draw,
    if (!draw->force_passthrough) {
       unsigned gs_out_prim = (draw->gs.geometry_shader ? 
                               draw->gs.geometry_shader->output_primitive :
+                              draw->tes.tess_eval_shader ?
+                              draw->tes.tess_eval_shader->output_primitive :
                               prim);
 
       if (!draw->render) {
@@ -101,7 +109,8 @@ draw_pt_arrays(struct draw_context *draw,
    } else {
       if (opt == 0)
          middle = draw->pt.middle.fetch_emit;
-      else if (opt == PT_SHADE && !draw->pt.no_fse)
+      else if (opt == PT_SHADE && !draw->pt.no_fse &&
+               !draw->tes.tess_eval_shader)
          middle = draw->pt.middle.fetch_shade_emit;
       else
          middle = draw->pt.middle.general;
@@ -482,6 +491,7 @@ draw_vbo(struct draw_context *draw,
    draw->pt.user.min_index = info->min_index;
    draw->pt.user.max_index = info->max_index;
    draw->pt.user.eltSize = info->index_size ? draw->pt.user.eltSizeIB : 0;
+   draw->pt.vertices_per_patch = info->vertices_per_patch;
 
    if (0)
       debug_printf("draw_vbo(mode=%u start=%u count=%u):\n",
@@ -293,7 +293,7 @@ draw_pt_emit_create(struct draw_context *draw)
       return NULL;
 
    emit->draw = draw;
-   emit->cache = translate_cache_create();
+   emit->cache = draw_translate_cache_create(draw);
    if (!emit->cache) {
       FREE(emit);
       return NULL;
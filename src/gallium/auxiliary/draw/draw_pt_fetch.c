@@ -208,7 +208,7 @@ draw_pt_fetch_create(struct draw_context *draw)
       return NULL;
 
    fetch->draw = draw;
-   fetch->cache = translate_cache_create();
+   fetch->cache = draw_translate_cache_create(draw);
    if (!fetch->cache) {
       FREE(fetch);
       return NULL;
@@ -379,7 +379,7 @@ struct draw_pt_middle_end *draw_pt_fetch_emit( struct draw_context *draw )
    if (!fetch_emit)
       return NULL;
 
-   fetch_emit->cache = translate_cache_create();
+   fetch_emit->cache = draw_translate_cache_create(draw);
    if (!fetch_emit->cache) {
       FREE(fetch_emit);
       return NULL;
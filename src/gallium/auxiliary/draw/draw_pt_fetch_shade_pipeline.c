@@ -35,6 +35,7 @@
 #include "draw/draw_pt.h"
 #include "draw/draw_vs.h"
 #include "draw/draw_gs.h"
+#include "draw/draw_tess.h"
 
 
 struct fetch_pipeline_middle_end {
@@ -76,9 +77,11 @@ fetch_pipeline_prepare(struct draw_pt_middle_end *middle,
    struct draw_context *draw = fpme->draw;
    struct draw_vertex_shader *vs = draw->vs.vertex_shader;
    struct draw_geometry_shader *gs = draw->gs.geometry_shader;
+   struct draw_tess_eval_shader *tes = draw->tes.tess_eval_shader;
    unsigned i;
    unsigned instance_id_index = ~0;
    const unsigned gs_out_prim = (gs ? gs->output_primitive :
+                                 tes ? tes->output_primitive :
                                  u_assembled_prim(prim));
    unsigned nr_vs_outputs = draw_total_vs_outputs(draw);
    unsigned nr = MAX2(vs->info.num_inputs, nr_vs_outputs);
@@ -119,7 +122,7 @@ fetch_pipeline_prepare(struct draw_pt_middle_end *middle,
                                          draw->guard_band_xy,
                             draw->bypass_viewport,
                             draw->rasterizer->clip_halfz,
-                            (draw->vs.edgeflag_output ? TRUE : FALSE) );
+                            (draw->vs.edgeflag_output && !tes ? TRUE : FALSE) );
 
    draw_pt_so_emit_prepare( fpme->so_emit, FALSE );
 
@@ -226,73 +229,35 @@ draw_vertex_shader_run(struct draw_vertex_shader *vshader,
 }
 
 
+/**
+ * Everything after the vertex shader: geometry shader or primitive
+ * assembly, stream output, clipping and emit.  Takes ownership of
+ * in_vert_info->verts.
+ */
 static void
-fetch_pipeline_generic(struct draw_pt_middle_end *middle,
-                       const struct draw_fetch_info *fetch_info,
-                       const struct draw_prim_info *in_prim_info)
+fetch_pipeline_post_vs(struct fetch_pipeline_middle_end *fpme,
+                       struct draw_vertex_info *in_vert_info,
+                       const struct draw_prim_info *in_prim_info,
+                       const struct tgsi_shader_info *input_info)
 {
-   struct fetch_pipeline_middle_end *fpme = fetch_pipeline_middle_end(middle);
    struct draw_context *draw = fpme->draw;
-   struct draw_vertex_shader *vshader = draw->vs.vertex_shader;
    struct draw_geometry_shader *gshader = draw->gs.geometry_shader;
    struct draw_prim_info gs_prim_info;
-   struct draw_vertex_info fetched_vert_info;
-   struct draw_vertex_info vs_vert_info;
    struct draw_vertex_info gs_vert_info;
-   struct draw_vertex_info *vert_info;
+   struct draw_vertex_info *vert_info = in_vert_info;
    struct draw_prim_info ia_prim_info;
    struct draw_vertex_info ia_vert_info;
    const struct draw_prim_info *prim_info = in_prim_info;
    boolean free_prim_info = FALSE;
    unsigned opt = fpme->opt;
 
-   fetched_vert_info.count = fetch_info->count;
-   fetched_vert_info.vertex_size = fpme->vertex_size;
-   fetched_vert_info.stride = fpme->vertex_size;
-   fetched_vert_info.verts =
-      (struct vertex_header *)MALLOC(fpme->vertex_size *
-                                     align(fetch_info->count,  4));
-   if (!fetched_vert_info.verts) {
-      assert(0);
-      return;
-   }
-   if (draw->collect_statistics) {
-      draw->statistics.ia_vertices += prim_info->count;
-      draw->statistics.ia_primitives +=
-         u_decomposed_prims_for_vertices(prim_info->prim, fetch_info->count);
-      draw->statistics.vs_invocations += fetch_info->count;
-   }
-
-   /* Fetch into our vertex buffer.
-    */
-   fetch( fpme->fetch, fetch_info, (char *)fetched_vert_info.verts );
-
-   /* Finished with fetch:
-    */
-   fetch_info = NULL;
-   vert_info = &fetched_vert_info;
-
-   /* Run the shader, note that this overwrites the data[] parts of
-    * the pipeline verts.
-    */
-   if (fpme->opt & PT_SHADE) {
-      draw_vertex_shader_run(vshader,
-                             draw->pt.user.vs_constants,
-                             draw->pt.user.vs_constants_size,
-                             vert_info,
-                             &vs_vert_info);
-
-      FREE(vert_info->verts);
-      vert_info = &vs_vert_info;
-   }
-
    if ((fpme->opt & PT_SHADE) && gshader) {
       draw_geometry_shader_run(gshader,
                                draw->pt.user.gs_constants,
                                draw->pt.user.gs_constants_size,
                                vert_info,
                                prim_info,
-                               &vshader->info,
+                               input_info,
                                &gs_vert_info,
                                &gs_prim_info);
 
@@ -369,6 +334,80 @@ fetch_pipeline_generic(struct draw_pt_middle_end *middle,
 }
 
 
+static void
+fetch_pipeline_generic(struct draw_pt_middle_end *middle,
+                       const struct draw_fetch_info *fetch_info,
+                       const struct draw_prim_info *prim_info)
+{
+   struct fetch_pipeline_middle_end *fpme = fetch_pipeline_middle_end(middle);
+   struct draw_context *draw = fpme->draw;
+   struct draw_vertex_shader *vshader = draw->vs.vertex_shader;
+   struct draw_vertex_info fetched_vert_info;
+   struct draw_vertex_info vs_vert_info;
+   struct draw_vertex_info *vert_info;
+
+   fetched_vert_info.count = fetch_info->count;
+   fetched_vert_info.vertex_size = fpme->vertex_size;
+   fetched_vert_info.stride = fpme->vertex_size;
+   fetched_vert_info.verts =
+      (struct vertex_header *)MALLOC(fpme->vertex_size *
+                                     align(fetch_info->count,  4));
+   if (!fetched_vert_info.verts) {
+      assert(0);
+      return;
+   }
+   if (draw->collect_statistics) {
+      draw->statistics.ia_vertices += prim_info->count;
+      if (prim_info->prim == PIPE_PRIM_PATCHES)
+         draw->statistics.ia_primitives +=
+            prim_info->count / draw->pt.vertices_per_patch;
+      else
+         draw->statistics.ia_primitives +=
+            u_decomposed_prims_for_vertices(prim_info->prim, fetch_info->count);
+      draw->statistics.vs_invocations += fetch_info->count;
+   }
+
+   /* Fetch into our vertex buffer.
+    */
+   fetch( fpme->fetch, fetch_info, (char *)fetched_vert_info.verts );
+
+   /* Finished with fetch:
+    */
+   fetch_info = NULL;
+   vert_info = &fetched_vert_info;
+
+   /* Run the shader, note that this overwrites the data[] parts of
+    * the pipeline verts.
+    */
+   if (fpme->opt & PT_SHADE) {
+      draw_vertex_shader_run(vshader,
+                             draw->pt.user.vs_constants,
+                             draw->pt.user.vs_constants_size,
+                             vert_info,
+                             &vs_vert_info);
+
+      FREE(vert_info->verts);
+      vert_info = &vs_vert_info;
+   }
+
+   if ((fpme->opt & PT_SHADE) && draw->tes.tess_eval_shader) {
+      struct draw_tess_eval_shader *tes = draw->tes.tess_eval_shader;
+      struct draw_vertex_info tes_vert_info;
+      struct draw_prim_info tes_prim_info;
+
+      draw_tess_begin(draw, vert_info, prim_info, &vshader->info);
+      while (draw_tess_run(draw, &tes_vert_info, &tes_prim_info)) {
+         fetch_pipeline_post_vs(fpme, &tes_vert_info, &tes_prim_info,
+                                &tes->info);
+      }
+      FREE(vert_info->verts);
+   }
+   else {
+      fetch_pipeline_post_vs(fpme, vert_info, prim_info, &vshader->info);
+   }
+}
+
+
 static inline unsigned
 prim_type(unsigned prim, unsigned flags)
 {
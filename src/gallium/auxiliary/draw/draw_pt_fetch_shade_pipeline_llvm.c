@@ -28,6 +28,10 @@
 #include "util/u_math.h"
 #include "util/u_memory.h"
 #include "util/u_prim.h"
+#include "util/u_queue.h"
+#include "util/u_debug.h"
+#include "util/u_atomic.h"
+#include "util/os_time.h"
 #include "draw/draw_context.h"
 #include "draw/draw_gs.h"
 #include "draw/draw_vbuf.h"
@@ -40,6 +44,34 @@
 #include "gallivm/lp_bld_debug.h"
 
 
+/** Max number of extra threads shading vertices of a single run */
+#define LLVM_VS_MAX_THREADS 15
+
+/** Don't hand fewer vertices than this to a vertex shading thread */
+#define LLVM_VS_MIN_CHUNK 256
+
+DEBUG_GET_ONCE_NUM_OPTION(draw_vs_threads, "DRAW_VS_THREADS", 0)
+
+
+struct llvm_middle_end;
+
+/**
+ * A contiguous range of the fetched vertices, shaded on a worker thread.
+ */
+struct llvm_vs_chunk {
+   struct llvm_middle_end *fpme;
+   struct util_queue_fence fence;
+
+   struct vertex_header *verts;
+   unsigned count;
+   unsigned start_or_maxelt;
+   unsigned vid_base;
+   const unsigned *elts;
+
+   boolean clipped;
+};
+
+
 struct llvm_middle_end {
    struct draw_pt_middle_end base;
    struct draw_context *draw;
@@ -57,6 +89,10 @@ struct llvm_middle_end {
 
    struct draw_llvm *llvm;
    struct draw_llvm_variant *current_variant;
+
+   unsigned num_vs_threads;
+   struct util_queue vs_queue;
+   struct llvm_vs_chunk vs_chunks[LLVM_VS_MAX_THREADS];
 };
 
 
@@ -347,6 +383,134 @@ emit(struct pt_emit *emit,
 }
 
 
+static inline boolean
+llvm_run_vs(struct llvm_middle_end *fpme,
+            struct vertex_header *verts,
+            unsigned count,
+            unsigned start_or_maxelt,
+            unsigned vid_base,
+            const unsigned *elts)
+{
+   struct draw_context *draw = fpme->draw;
+   struct draw_llvm_variant *variant = fpme->current_variant;
+   /* The tier is read first, the code may be swapped in the background */
+   unsigned tier = p_atomic_read(&variant->tier);
+   draw_jit_vert_func jit_func = p_atomic_read(&variant->jit_func);
+   int64_t start = 0;
+   boolean clipped;
+
+   if (gallivm_debug & GALLIVM_DEBUG_PERF)
+      start = os_time_get_nano();
+
+   clipped = jit_func(&fpme->llvm->jit_context,
+                      verts,
+                      draw->pt.user.vbuffer,
+                      count,
+                      start_or_maxelt,
+                      fpme->vertex_size,
+                      draw->pt.vertex_buffer,
+                      draw->instance_id,
+                      vid_base,
+                      draw->start_instance,
+                      elts);
+
+   if (gallivm_debug & GALLIVM_DEBUG_PERF) {
+      p_atomic_inc(&variant->tier_stats.calls[tier]);
+      p_atomic_add(&variant->tier_stats.run_time[tier],
+                   os_time_get_nano() - start);
+   }
+
+   return clipped;
+}
+
+
+static void
+llvm_vs_chunk_execute(void *data, int thread_index)
+{
+   struct llvm_vs_chunk *chunk = data;
+   unsigned fpstate = util_fpstate_get();
+
+   /* draw_vbo() only treats denorms as zeros on the calling thread, do the
+    * same here so every chunk gets the same results.
+    */
+   util_fpstate_set_denorms_to_zero(fpstate);
+
+   chunk->clipped = llvm_run_vs(chunk->fpme, chunk->verts, chunk->count,
+                                chunk->start_or_maxelt, chunk->vid_base,
+                                chunk->elts);
+
+   util_fpstate_set(fpstate);
+}
+
+
+/**
+ * Run the vertex shader over all fetched vertices, splitting large runs
+ * over the vertex shading threads.  Every chunk writes its own range of
+ * verts, so the output is identical to a single call, and everything past
+ * this point still sees the vertices in submission order.
+ * \return  TRUE if any vertex was clipped or had a non-one edgeflag
+ */
+static boolean
+llvm_shade_vertices(struct llvm_middle_end *fpme,
+                    struct vertex_header *verts,
+                    unsigned count,
+                    unsigned start_or_maxelt,
+                    unsigned vid_base,
+                    const unsigned *elts)
+{
+   unsigned num_chunks = MIN2(fpme->num_vs_threads + 1,
+                              count / LLVM_VS_MIN_CHUNK);
+   unsigned chunk_size;
+   boolean clipped;
+   unsigned i;
+
+   draw_llvm_variant_used(fpme->current_variant);
+
+   if (num_chunks <= 1) {
+      return llvm_run_vs(fpme, verts, count, start_or_maxelt, vid_base, elts);
+   }
+
+   /* Chunks must start on a SIMD vector boundary, as the shader always
+    * writes whole vectors of vertices.
+    */
+   chunk_size = align(DIV_ROUND_UP(count, num_chunks), 16);
+   num_chunks = DIV_ROUND_UP(count, chunk_size);
+
+   for (i = 1; i < num_chunks; i++) {
+      struct llvm_vs_chunk *chunk = &fpme->vs_chunks[i - 1];
+      unsigned offset = i * chunk_size;
+
+      chunk->verts = (struct vertex_header *)
+         ((char *)verts + offset * fpme->vertex_size);
+      chunk->count = MIN2(chunk_size, count - offset);
+      chunk->vid_base = vid_base;
+      if (elts) {
+         chunk->start_or_maxelt = start_or_maxelt;
+         chunk->elts = elts + offset;
+      }
+      else {
+         chunk->start_or_maxelt = start_or_maxelt + offset;
+         chunk->elts = NULL;
+      }
+
+      util_queue_add_job(&fpme->vs_queue, chunk, &chunk->fence,
+                         llvm_vs_chunk_execute, NULL);
+   }
+
+   clipped = llvm_run_vs(fpme, verts, chunk_size, start_or_maxelt,
+                         vid_base, elts);
+
+   for (i = 1; i < num_chunks; i++) {
+      struct llvm_vs_chunk *chunk = &fpme->vs_chunks[i - 1];
+
+      util_queue_fence_wait(&chunk->fence);
+      clipped |= chunk->clipped;
+   }
+
+   return clipped;
+}
+
+
 static void
 llvm_pipeline_generic(struct draw_pt_middle_end *middle,
                       const struct draw_fetch_info *fetch_info,
@@ -397,17 +561,9 @@ llvm_pipeline_generic(struct draw_pt_middle_end *middle,
       vid_base = draw->pt.user.eltBias;
       elts = fetch_info->elts;
    }
-   clipped = fpme->current_variant->jit_func(&fpme->llvm->jit_context,
-                                             llvm_vert_info.verts,
-                                             draw->pt.user.vbuffer,
-                                             fetch_info->count,
-                                             start_or_maxelt,
-                                             fpme->vertex_size,
-                                             draw->pt.vertex_buffer,
-                                             draw->instance_id,
-                                             vid_base,
-                                             draw->start_instance,
-                                             elts);
+   clipped = llvm_shade_vertices(fpme, llvm_vert_info.verts,
+                                 fetch_info->count, start_or_maxelt,
+                                 vid_base, elts);
 
    /* Finished with fetch and vs:
     */
@@ -606,6 +762,13 @@ static void
 llvm_middle_end_destroy(struct draw_pt_middle_end *middle)
 {
    struct llvm_middle_end *fpme = llvm_middle_end(middle);
+   unsigned i;
+
+   if (util_queue_is_initialized(&fpme->vs_queue))
+      util_queue_destroy(&fpme->vs_queue);
+
+   for (i = 0; i < ARRAY_SIZE(fpme->vs_chunks); i++)
+      util_queue_fence_destroy(&fpme->vs_chunks[i].fence);
 
    if (fpme->fetch)
       draw_pt_fetch_destroy( fpme->fetch );
@@ -627,6 +790,7 @@ struct draw_pt_middle_end *
 draw_pt_fetch_pipeline_or_emit_llvm(struct draw_context *draw)
 {
    struct llvm_middle_end *fpme = 0;
+   unsigned i;
 
    if (!draw->llvm)
       return NULL;
@@ -645,6 +809,11 @@ draw_pt_fetch_pipeline_or_emit_llvm(struct draw_context *draw)
 
    fpme->draw = draw;
 
+   for (i = 0; i < ARRAY_SIZE(fpme->vs_chunks); i++) {
+      fpme->vs_chunks[i].fpme = fpme;
+      util_queue_fence_init(&fpme->vs_chunks[i].fence);
+   }
+
    fpme->fetch = draw_pt_fetch_create( draw );
    if (!fpme->fetch)
       goto fail;
@@ -667,6 +836,13 @@ draw_pt_fetch_pipeline_or_emit_llvm(struct draw_context *draw)
 
    fpme->current_variant = NULL;
 
+   fpme->num_vs_threads = MIN2(debug_get_option_draw_vs_threads(),
+                               LLVM_VS_MAX_THREADS);
+   if (fpme->num_vs_threads &&
+       !util_queue_init(&fpme->vs_queue, "drawvs", LLVM_VS_MAX_THREADS,
+                        fpme->num_vs_threads, 0))
+      fpme->num_vs_threads = 0;
+
    return &fpme->base;
 
  fail:
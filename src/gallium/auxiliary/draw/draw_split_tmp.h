@@ -40,7 +40,11 @@ FUNC(FUNC_VARS)
                    max_count_loop, max_count_fan);
    }
 
-   draw_pt_split_prim(prim, &first, &incr);
+   if (prim == PIPE_PRIM_PATCHES) {
+      first = incr = vsplit->draw->pt.vertices_per_patch;
+   } else {
+      draw_pt_split_prim(prim, &first, &incr);
+   }
    /* sanitize primitive length */
    count = draw_pt_trim_count(count, first, incr);
    if (count < first)
@@ -86,6 +90,7 @@ FUNC(FUNC_VARS)
       case PIPE_PRIM_LINE_STRIP_ADJACENCY:
       case PIPE_PRIM_TRIANGLES_ADJACENCY:
       case PIPE_PRIM_TRIANGLE_STRIP_ADJACENCY:
+      case PIPE_PRIM_PATCHES:
          seg_max =
             draw_pt_trim_count(MIN2(max_count_simple, count), first, incr);
          if (prim == PIPE_PRIM_TRIANGLE_STRIP ||
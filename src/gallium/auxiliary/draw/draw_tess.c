@@ -0,0 +1,764 @@
+/**************************************************************************
+ *
+ * Copyright 2019 The Mesa Authors
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+#include "draw_tess.h"
+
+#include "draw_private.h"
+#include "draw_context.h"
+
+#include "tgsi/tgsi_parse.h"
+#include "tgsi/tgsi_exec.h"
+
+#include "pipe/p_shader_tokens.h"
+
+#include "util/u_math.h"
+#include "util/u_memory.h"
+
+
+static int
+draw_tess_get_output_index(int semantic, int index,
+                           const struct tgsi_shader_info *info)
+{
+   unsigned i;
+   for (i = 0; i < info->num_outputs; i++) {
+      if (info->output_semantic_name[i] == semantic &&
+          info->output_semantic_index[i] == index)
+         return i;
+   }
+   return -1;
+}
+
+static inline boolean
+is_patch_semantic(unsigned semantic)
+{
+   return semantic == TGSI_SEMANTIC_PATCH ||
+          semantic == TGSI_SEMANTIC_TESSOUTER ||
+          semantic == TGSI_SEMANTIC_TESSINNER;
+}
+
+static inline void
+set_system_value(struct tgsi_exec_machine *machine,
+                 enum tgsi_semantic semantic,
+                 unsigned chan, unsigned lane, uint32_t value)
+{
+   const unsigned i = machine->SysSemanticToIndex[semantic];
+
+   if (i != -1)
+      machine->SystemValue[i].xyzw[chan].u[lane] = value;
+}
+
+/**
+ * Returns the vertex shader output of vertex i of the given patch.
+ */
+static const float (*
+tess_input_vertex(const struct draw_tess_eval_shader *tes,
+                  unsigned patch, unsigned i))[4]
+{
+   const struct draw_prim_info *prims = tes->input_prims;
+   const struct draw_vertex_info *verts = tes->input_verts;
+   unsigned idx = prims->start + patch * tes->draw->pt.vertices_per_patch + i;
+
+   if (!prims->linear)
+      idx = prims->elts[idx];
+
+   return (const float (*)[4])
+      ((const char *)verts->verts->data + idx * verts->stride);
+}
+
+
+/**
+ * Run the control shader on the given patch and gather the evaluation
+ * shader inputs from its outputs.
+ */
+static void
+tcs_run_patch(struct draw_context *draw,
+              struct draw_tess_ctrl_shader *tcs,
+              struct draw_tess_eval_shader *tes,
+              unsigned patch_idx)
+{
+   struct draw_tess_patch *patch = tes->patch;
+   struct tgsi_exec_vector *inputs = draw->tcs.tgsi.inputs;
+   const struct tgsi_exec_vector *outputs = draw->tcs.tgsi.outputs;
+   const unsigned vertices_in = draw->pt.vertices_per_patch;
+   const unsigned num_machines = DIV_ROUND_UP(tcs->vertices_out,
+                                              TGSI_QUAD_SIZE);
+   boolean restart = FALSE;
+   unsigned v, slot, m, c, j;
+
+   for (v = 0; v < vertices_in; v++) {
+      const float (*input)[4] = tess_input_vertex(tes, patch_idx, v);
+
+      for (slot = 0; slot < tcs->info.num_inputs; slot++) {
+         struct tgsi_exec_vector *in =
+            &inputs[v * TGSI_EXEC_MAX_INPUT_ATTRIBS + slot];
+         const int vs_slot = tcs->input_map[slot];
+
+         for (c = 0; c < TGSI_NUM_CHANNELS; c++) {
+            const float value = vs_slot < 0 ? 0.0f : input[vs_slot][c];
+            for (j = 0; j < TGSI_QUAD_SIZE; j++)
+               in->xyzw[c].f[j] = value;
+         }
+      }
+   }
+
+   for (m = 0; m < num_machines; m++) {
+      struct tgsi_exec_machine *machine = draw->tcs.tgsi.machines[m];
+      const unsigned num_invocations =
+         MIN2(TGSI_QUAD_SIZE, tcs->vertices_out - m * TGSI_QUAD_SIZE);
+
+      for (j = 0; j < TGSI_QUAD_SIZE; j++) {
+         set_system_value(machine, TGSI_SEMANTIC_INVOCATIONID, 0, j,
+                          m * TGSI_QUAD_SIZE + j);
+         set_system_value(machine, TGSI_SEMANTIC_VERTICESIN, 0, j,
+                          vertices_in);
+         set_system_value(machine, TGSI_SEMANTIC_PRIMID, 0, j,
+                          tes->in_prim_idx);
+      }
+      machine->NonHelperMask = (1 << num_invocations) - 1;
+   }
+
+   /* Invocations stopping at a barrier are resumed once all the others
+    * have reached it too.
+    */
+   do {
+      boolean barrier_hit = FALSE;
+
+      for (m = 0; m < num_machines; m++) {
+         struct tgsi_exec_machine *machine = draw->tcs.tgsi.machines[m];
+
+         tgsi_exec_machine_run(machine, restart ? machine->pc : 0);
+         if (machine->pc != -1)
+            barrier_hit = TRUE;
+      }
+      restart = barrier_hit;
+   } while (restart);
+
+   for (c = 0; c < 4; c++) {
+      patch->levels[c] = tcs->tess_outer_output < 0 ?
+         draw->tcs.default_outer_level[c] :
+         outputs[TGSI_EXEC_TCS_PATCH_OUTPUT(tcs->tess_outer_output)].xyzw[c].f[0];
+   }
+   for (c = 0; c < 2; c++) {
+      patch->levels[4 + c] = tcs->tess_inner_output < 0 ?
+         draw->tcs.default_inner_level[c] :
+         outputs[TGSI_EXEC_TCS_PATCH_OUTPUT(tcs->tess_inner_output)].xyzw[c].f[0];
+   }
+   patch->vertices_in = tcs->vertices_out;
+
+   for (slot = 0; slot < tes->info.num_inputs; slot++) {
+      const int tcs_slot = tes->input_map[slot];
+
+      if (tcs_slot < 0) {
+         for (v = 0; v < tcs->vertices_out; v++)
+            memset(patch->inputs[v][slot], 0, sizeof(patch->inputs[v][slot]));
+      }
+      else if (is_patch_semantic(tes->info.input_semantic_name[slot])) {
+         const struct tgsi_exec_vector *out =
+            &outputs[TGSI_EXEC_TCS_PATCH_OUTPUT(tcs_slot)];
+         for (c = 0; c < TGSI_NUM_CHANNELS; c++)
+            patch->inputs[0][slot][c] = out->xyzw[c].f[0];
+      }
+      else {
+         for (v = 0; v < tcs->vertices_out; v++) {
+            const struct tgsi_exec_vector *out =
+               &outputs[TGSI_EXEC_TCS_VERTEX_OUTPUT(v, tcs_slot)];
+            for (c = 0; c < TGSI_NUM_CHANNELS; c++)
+               patch->inputs[v][slot][c] = out->xyzw[c].f[v % TGSI_QUAD_SIZE];
+         }
+      }
+   }
+}
+
+
+/**
+ * Without a control shader the evaluation shader reads the vertex shader
+ * outputs directly and the tessellation levels are the default ones.
+ */
+static void
+passthrough_patch(struct draw_context *draw,
+                  struct draw_tess_eval_shader *tes,
+                  unsigned patch_idx)
+{
+   struct draw_tess_patch *patch = tes->patch;
+   const unsigned vertices_in = draw->pt.vertices_per_patch;
+   unsigned v, slot, c;
+
+   for (c = 0; c < 4; c++)
+      patch->levels[c] = draw->tcs.default_outer_level[c];
+   for (c = 0; c < 2; c++)
+      patch->levels[4 + c] = draw->tcs.default_inner_level[c];
+   patch->vertices_in = vertices_in;
+
+   for (v = 0; v < vertices_in; v++) {
+      const float (*input)[4] = tess_input_vertex(tes, patch_idx, v);
+
+      for (slot = 0; slot < tes->info.num_inputs; slot++) {
+         const int vs_slot = tes->input_map[slot];
+
+         if (vs_slot < 0)
+            memset(patch->inputs[v][slot], 0, sizeof(patch->inputs[v][slot]));
+         else
+            memcpy(patch->inputs[v][slot], input[vs_slot],
+                   sizeof(patch->inputs[v][slot]));
+      }
+   }
+
+   /* per-patch inputs which aren't written by anyone */
+   for (slot = 0; slot < tes->info.num_inputs; slot++) {
+      switch (tes->info.input_semantic_name[slot]) {
+      case TGSI_SEMANTIC_TESSOUTER:
+         memcpy(patch->inputs[0][slot], &patch->levels[0], 4 * sizeof(float));
+         break;
+      case TGSI_SEMANTIC_TESSINNER:
+         patch->inputs[0][slot][0] = patch->levels[4];
+         patch->inputs[0][slot][1] = patch->levels[5];
+         patch->inputs[0][slot][2] = 0.0f;
+         patch->inputs[0][slot][3] = 0.0f;
+         break;
+      default:
+         break;
+      }
+   }
+}
+
+
+static void
+tgsi_tes_prepare(struct draw_tess_eval_shader *shader,
+                 const void *constants[PIPE_MAX_CONSTANT_BUFFERS],
+                 const unsigned constants_size[PIPE_MAX_CONSTANT_BUFFERS])
+{
+   tgsi_exec_set_constant_buffers(shader->machine, PIPE_MAX_CONSTANT_BUFFERS,
+                                  constants, constants_size);
+}
+
+static void
+tgsi_tes_run(struct draw_tess_eval_shader *shader,
+             struct vertex_header *output,
+             unsigned vertex_size)
+{
+   struct tgsi_exec_machine *machine = shader->machine;
+   const struct draw_tess_patch *patch = shader->patch;
+   const struct draw_tessellator *tess = shader->tessellator;
+   float (*out)[4] = (float (*)[4])output->data;
+   unsigned i, j, v, slot, c;
+
+   /* the whole patch is visible to every domain point */
+   for (v = 0; v < patch->vertices_in; v++) {
+      for (slot = 0; slot < shader->info.num_inputs; slot++) {
+         struct tgsi_exec_vector *in =
+            &machine->Inputs[v * TGSI_EXEC_MAX_INPUT_ATTRIBS + slot];
+         for (c = 0; c < TGSI_NUM_CHANNELS; c++) {
+            for (j = 0; j < TGSI_QUAD_SIZE; j++)
+               in->xyzw[c].f[j] = patch->inputs[v][slot][c];
+         }
+      }
+   }
+
+   for (j = 0; j < TGSI_QUAD_SIZE; j++) {
+      for (c = 0; c < 4; c++)
+         set_system_value(machine, TGSI_SEMANTIC_TESSOUTER, c, j,
+                          fui(patch->levels[c]));
+      for (c = 0; c < 4; c++)
+         set_system_value(machine, TGSI_SEMANTIC_TESSINNER, c, j,
+                          c < 2 ? fui(patch->levels[4 + c]) : 0);
+      set_system_value(machine, TGSI_SEMANTIC_VERTICESIN, 0, j,
+                       patch->vertices_in);
+      set_system_value(machine, TGSI_SEMANTIC_PRIMID, 0, j, patch->prim_id);
+   }
+
+   for (i = 0; i < tess->num_points; i += TGSI_QUAD_SIZE) {
+      const unsigned max_vertices = MIN2(TGSI_QUAD_SIZE, tess->num_points - i);
+
+      for (j = 0; j < TGSI_QUAD_SIZE; j++) {
+         set_system_value(machine, TGSI_SEMANTIC_TESSCOORD, 0, j,
+                          fui(tess->u[i + j]));
+         set_system_value(machine, TGSI_SEMANTIC_TESSCOORD, 1, j,
+                          fui(tess->v[i + j]));
+         set_system_value(machine, TGSI_SEMANTIC_TESSCOORD, 2, j,
+                          fui(tess->w[i + j]));
+         set_system_value(machine, TGSI_SEMANTIC_TESSCOORD, 3, j, 0);
+      }
+
+      machine->NonHelperMask = (1 << max_vertices) - 1;
+      /* run interpreter */
+      tgsi_exec_machine_run(machine, 0);
+
+      /* Unswizzle all output results.
+       */
+      for (j = 0; j < max_vertices; j++) {
+         for (slot = 0; slot < shader->info.num_outputs; slot++) {
+            out[slot][0] = machine->Outputs[slot].xyzw[0].f[j];
+            out[slot][1] = machine->Outputs[slot].xyzw[1].f[j];
+            out[slot][2] = machine->Outputs[slot].xyzw[2].f[j];
+            out[slot][3] = machine->Outputs[slot].xyzw[3].f[j];
+         }
+         out = (float (*)[4])((char *)out + vertex_size);
+      }
+   }
+}
+
+
+
+/**
+ * Run the control shader and the tessellator on the next patch.
+ */
+static void
+tess_next_patch(struct draw_context *draw,
+                struct draw_tess_eval_shader *tes)
+{
+   struct draw_tess_ctrl_shader *tcs = draw->tcs.tess_ctrl_shader;
+   struct draw_tess_patch *patch = tes->patch;
+
+   if (tcs)
+      tcs_run_patch(draw, tcs, tes, tes->patch_idx);
+   else
+      passthrough_patch(draw, tes, tes->patch_idx);
+
+   patch->prim_id = tes->in_prim_idx;
+
+   draw_tessellate(tes->tessellator, &tes->domain,
+                   &patch->levels[0], &patch->levels[4]);
+
+   tes->patch_idx++;
+   tes->in_prim_idx++;
+   tes->patch_pending = tes->tessellator->num_points > 0;
+}
+
+
+void
+draw_tess_begin(struct draw_context *draw,
+                const struct draw_vertex_info *input_verts,
+                const struct draw_prim_info *input_prims,
+                const struct tgsi_shader_info *input_info)
+{
+   struct draw_tess_ctrl_shader *tcs = draw->tcs.tess_ctrl_shader;
+   struct draw_tess_eval_shader *tes = draw->tes.tess_eval_shader;
+   const struct tgsi_shader_info *tes_input_info =
+      tcs ? &tcs->info : input_info;
+   unsigned slot, m;
+
+   debug_assert(input_prims->prim == PIPE_PRIM_PATCHES);
+   debug_assert(input_prims->primitive_count == 1);
+
+   tes->input_info = input_info;
+   tes->input_verts = input_verts;
+   tes->input_prims = input_prims;
+   tes->num_patches = draw->pt.vertices_per_patch ?
+      input_prims->count / draw->pt.vertices_per_patch : 0;
+   tes->patch_idx = 0;
+   tes->patch_pending = FALSE;
+
+   for (slot = 0; slot < tes->info.num_inputs; slot++) {
+      tes->input_map[slot] =
+         draw_tess_get_output_index(tes->info.input_semantic_name[slot],
+                                    tes->info.input_semantic_index[slot],
+                                    tes_input_info);
+   }
+
+   if (tcs) {
+      for (slot = 0; slot < tcs->info.num_inputs; slot++) {
+         tcs->input_map[slot] =
+            draw_tess_get_output_index(tcs->info.input_semantic_name[slot],
+                                       tcs->info.input_semantic_index[slot],
+                                       input_info);
+      }
+
+      for (m = 0; m < DIV_ROUND_UP(tcs->vertices_out, TGSI_QUAD_SIZE); m++) {
+         tgsi_exec_set_constant_buffers(draw->tcs.tgsi.machines[m],
+                                        PIPE_MAX_CONSTANT_BUFFERS,
+                                        draw->pt.user.tcs_constants,
+                                        draw->pt.user.tcs_constants_size);
+      }
+
+      if (draw->collect_statistics)
+         draw->statistics.hs_invocations += tes->num_patches;
+   }
+
+   tes->prepare(tes, draw->pt.user.tes_constants,
+                draw->pt.user.tes_constants_size);
+}
+
+
+boolean
+draw_tess_run(struct draw_context *draw,
+              struct draw_vertex_info *output_verts,
+              struct draw_prim_info *output_prims)
+{
+   struct draw_tess_eval_shader *tes = draw->tes.tess_eval_shader;
+   const struct draw_tessellator *tess = tes->tessellator;
+   const unsigned vertex_size = sizeof(struct vertex_header) +
+      draw_total_tes_outputs(draw) * 4 * sizeof(float);
+   unsigned num_verts = 0, num_elts = 0, max_verts = 0;
+   char *verts = NULL;
+   unsigned i;
+
+   for (;;) {
+      if (!tes->patch_pending) {
+         if (tes->patch_idx >= tes->num_patches)
+            break;
+         tess_next_patch(draw, tes);
+         continue;
+      }
+
+      if (num_verts + tess->num_points > DRAW_TESS_MAX_BATCH_VERTICES ||
+          num_elts + tess->num_indices > DRAW_TESS_MAX_BATCH_ELTS)
+         break;
+
+      /* the shader writes whole vectors, leave room for the last one */
+      if (num_verts + tess->num_points + tes->vector_length > max_verts) {
+         unsigned new_max = MAX2(max_verts * 2, num_verts + tess->num_points +
+                                                tes->vector_length);
+         verts = REALLOC(verts, max_verts * vertex_size, new_max * vertex_size);
+         if (!verts)
+            return FALSE;
+         max_verts = new_max;
+      }
+      if (num_elts + tess->num_indices > tes->max_elts) {
+         unsigned new_max = MAX2(tes->max_elts * 2,
+                                 num_elts + tess->num_indices);
+         tes->elts = REALLOC(tes->elts, tes->max_elts * sizeof(ushort),
+                             new_max * sizeof(ushort));
+         if (!tes->elts) {
+            tes->max_elts = 0;
+            FREE(verts);
+            return FALSE;
+         }
+         tes->max_elts = new_max;
+      }
+
+      tes->run(tes, (struct vertex_header *)(verts + num_verts * vertex_size),
+               vertex_size);
+
+      for (i = 0; i < tess->num_indices; i++)
+         tes->elts[num_elts + i] = (ushort)(num_verts + tess->indices[i]);
+
+      if (draw->collect_statistics)
+         draw->statistics.ds_invocations += tess->num_points;
+
+      num_verts += tess->num_points;
+      num_elts += tess->num_indices;
+      tes->patch_pending = FALSE;
+   }
+
+   if (!num_verts) {
+      FREE(verts);
+      return FALSE;
+   }
+
+   output_verts->verts = (struct vertex_header *)verts;
+   output_verts->vertex_size = vertex_size;
+   output_verts->stride = vertex_size;
+   output_verts->count = num_verts;
+
+   tes->primitive_length = num_elts;
+
+   output_prims->linear = FALSE;
+   output_prims->elts = tes->elts;
+   output_prims->start = 0;
+   output_prims->count = num_elts;
+   output_prims->prim = tes->output_primitive;
+   output_prims->flags = 0x0;
+   output_prims->primitive_lengths = &tes->primitive_length;
+   output_prims->primitive_count = 1;
+
+   return TRUE;
+}
+
+
+boolean
+draw_tess_init(struct draw_context *draw)
+{
+   const unsigned num_inputs = TGSI_MAX_PATCH_VERTICES *
+                               TGSI_EXEC_MAX_INPUT_ATTRIBS;
+   unsigned m;
+
+   draw->tcs.tgsi.inputs =
+      align_malloc(num_inputs * sizeof(struct tgsi_exec_vector), 16);
+   draw->tcs.tgsi.outputs =
+      align_malloc(TGSI_EXEC_TCS_NUM_OUTPUTS * sizeof(struct tgsi_exec_vector),
+                   16);
+   if (!draw->tcs.tgsi.inputs || !draw->tcs.tgsi.outputs)
+      return FALSE;
+
+   /* the control shader is always interpreted */
+   for (m = 0; m < DRAW_TCS_MAX_MACHINES; m++) {
+      struct tgsi_exec_machine *machine =
+         tgsi_exec_machine_create(PIPE_SHADER_TESS_CTRL);
+      if (!machine)
+         return FALSE;
+
+      machine->Inputs = draw->tcs.tgsi.inputs;
+      machine->Outputs = draw->tcs.tgsi.outputs;
+      draw->tcs.tgsi.machines[m] = machine;
+   }
+
+   draw->tes.tgsi.machine = tgsi_exec_machine_create(PIPE_SHADER_TESS_EVAL);
+   if (!draw->tes.tgsi.machine)
+      return FALSE;
+
+   for (m = 0; m < 4; m++)
+      draw->tcs.default_outer_level[m] = 1.0f;
+   for (m = 0; m < 2; m++)
+      draw->tcs.default_inner_level[m] = 1.0f;
+
+   return TRUE;
+}
+
+void
+draw_tess_destroy(struct draw_context *draw)
+{
+   unsigned m;
+
+   for (m = 0; m < DRAW_TCS_MAX_MACHINES; m++) {
+      struct tgsi_exec_machine *machine = draw->tcs.tgsi.machines[m];
+      if (machine) {
+         /* the inputs and outputs are shared, free them only once */
+         machine->Inputs = NULL;
+         machine->Outputs = NULL;
+         tgsi_exec_machine_destroy(machine);
+      }
+   }
+   align_free(draw->tcs.tgsi.inputs);
+   align_free(draw->tcs.tgsi.outputs);
+
+   if (draw->tes.tgsi.machine)
+      tgsi_exec_machine_destroy(draw->tes.tgsi.machine);
+}
+
+
+struct draw_tess_ctrl_shader *
+draw_create_tess_ctrl_shader(struct draw_context *draw,
+                             const struct pipe_shader_state *state)
+{
+   struct draw_tess_ctrl_shader *tcs;
+   unsigned i;
+
+   tcs = CALLOC_STRUCT(draw_tess_ctrl_shader);
+   if (!tcs)
+      return NULL;
+
+   tcs->draw = draw;
+   tcs->state = *state;
+   tcs->state.tokens = tgsi_dup_tokens(state->tokens);
+   if (!tcs->state.tokens) {
+      FREE(tcs);
+      return NULL;
+   }
+
+   tgsi_scan_shader(state->tokens, &tcs->info);
+
+   tcs->vertices_out = tcs->info.properties[TGSI_PROPERTY_TCS_VERTICES_OUT];
+   debug_assert(tcs->vertices_out > 0 &&
+                tcs->vertices_out <= TGSI_MAX_PATCH_VERTICES);
+   debug_assert(tcs->info.num_inputs <= TGSI_EXEC_MAX_INPUT_ATTRIBS);
+
+   tcs->tess_outer_output = -1;
+   tcs->tess_inner_output = -1;
+   for (i = 0; i < tcs->info.num_outputs; i++) {
+      if (tcs->info.output_semantic_name[i] == TGSI_SEMANTIC_TESSOUTER)
+         tcs->tess_outer_output = i;
+      if (tcs->info.output_semantic_name[i] == TGSI_SEMANTIC_TESSINNER)
+         tcs->tess_inner_output = i;
+   }
+
+   return tcs;
+}
+
+void
+draw_bind_tess_ctrl_shader(struct draw_context *draw,
+                           struct draw_tess_ctrl_shader *dtcs)
+{
+   unsigned m;
+
+   draw_do_flush(draw, DRAW_FLUSH_STATE_CHANGE);
+
+   draw->tcs.tess_ctrl_shader = dtcs;
+   if (!dtcs)
+      return;
+
+   for (m = 0; m < DRAW_TCS_MAX_MACHINES; m++) {
+      struct tgsi_exec_machine *machine = draw->tcs.tgsi.machines[m];
+      if (machine->Tokens != dtcs->state.tokens) {
+         tgsi_exec_machine_bind_shader(machine,
+                                       dtcs->state.tokens,
+                                       draw->tcs.tgsi.sampler,
+                                       draw->tcs.tgsi.image,
+                                       draw->tcs.tgsi.buffer);
+      }
+   }
+}
+
+void
+draw_delete_tess_ctrl_shader(struct draw_context *draw,
+                             struct draw_tess_ctrl_shader *dtcs)
+{
+   unsigned m;
+
+   if (!dtcs)
+      return;
+
+   /* don't leave the machines pointing at freed tokens */
+   for (m = 0; m < DRAW_TCS_MAX_MACHINES; m++) {
+      struct tgsi_exec_machine *machine = draw->tcs.tgsi.machines[m];
+      if (machine->Tokens == dtcs->state.tokens)
+         tgsi_exec_machine_bind_shader(machine, NULL, NULL, NULL, NULL);
+   }
+
+   FREE((void*) dtcs->state.tokens);
+   FREE(dtcs);
+}
+
+
+struct draw_tess_eval_shader *
+draw_create_tess_eval_shader(struct draw_context *draw,
+                             const struct pipe_shader_state *state)
+{
+   struct draw_tess_eval_shader *tes;
+   unsigned i;
+
+   tes = CALLOC_STRUCT(draw_tess_eval_shader);
+   if (!tes)
+      return NULL;
+
+   tes->draw = draw;
+   tes->state = *state;
+   tes->state.tokens = tgsi_dup_tokens(state->tokens);
+   if (!tes->state.tokens) {
+      FREE(tes);
+      return NULL;
+   }
+
+   tgsi_scan_shader(state->tokens, &tes->info);
+   debug_assert(tes->info.num_inputs <= TGSI_EXEC_MAX_INPUT_ATTRIBS);
+
+   tes->tessellator = draw_tessellator_create();
+   tes->patch = align_malloc(sizeof(struct draw_tess_patch), 16);
+   if (!tes->tessellator || !tes->patch) {
+      draw_tessellator_destroy(tes->tessellator);
+      align_free(tes->patch);
+      FREE((void*) tes->state.tokens);
+      FREE(tes);
+      return NULL;
+   }
+   memset(tes->patch, 0, sizeof(struct draw_tess_patch));
+
+   tes->domain.prim_mode = tes->info.properties[TGSI_PROPERTY_TES_PRIM_MODE];
+   tes->domain.spacing = tes->info.properties[TGSI_PROPERTY_TES_SPACING];
+   tes->domain.vertex_order_cw =
+      tes->info.properties[TGSI_PROPERTY_TES_VERTEX_ORDER_CW];
+   tes->domain.point_mode = tes->info.properties[TGSI_PROPERTY_TES_POINT_MODE];
+   tes->output_primitive = draw_tess_out_prim(&tes->domain);
+
+   tes->position_output = -1;
+   for (i = 0; i < tes->info.num_outputs; i++) {
+      if (tes->info.output_semantic_name[i] == TGSI_SEMANTIC_POSITION &&
+          tes->info.output_semantic_index[i] == 0)
+         tes->position_output = i;
+      if (tes->info.output_semantic_name[i] == TGSI_SEMANTIC_VIEWPORT_INDEX)
+         tes->viewport_index_output = i;
+      if (tes->info.output_semantic_name[i] == TGSI_SEMANTIC_CLIPDIST) {
+         debug_assert(tes->info.output_semantic_index[i] <
+                      PIPE_MAX_CLIP_OR_CULL_DISTANCE_ELEMENT_COUNT);
+         tes->ccdistance_output[tes->info.output_semantic_index[i]] = i;
+      }
+   }
+
+   tes->machine = draw->tes.tgsi.machine;
+   tes->vector_length = TGSI_QUAD_SIZE;
+
+   tes->prepare = tgsi_tes_prepare;
+   tes->run = tgsi_tes_run;
+
+   return tes;
+}
+
+void
+draw_bind_tess_eval_shader(struct draw_context *draw,
+                           struct draw_tess_eval_shader *dtes)
+{
+   draw_do_flush(draw, DRAW_FLUSH_STATE_CHANGE);
+
+   if (dtes) {
+      draw->tes.tess_eval_shader = dtes;
+      draw->tes.num_tes_outputs = dtes->info.num_outputs;
+      draw->tes.position_output = dtes->position_output;
+      if (dtes->machine->Tokens != dtes->state.tokens) {
+         tgsi_exec_machine_bind_shader(dtes->machine,
+                                       dtes->state.tokens,
+                                       draw->tes.tgsi.sampler,
+                                       draw->tes.tgsi.image,
+                                       draw->tes.tgsi.buffer);
+      }
+   }
+   else {
+      draw->tes.tess_eval_shader = NULL;
+      draw->tes.num_tes_outputs = 0;
+   }
+}
+
+void
+draw_delete_tess_eval_shader(struct draw_context *draw,
+                             struct draw_tess_eval_shader *dtes)
+{
+   if (!dtes) {
+      return;
+   }
+   if (dtes->machine && dtes->machine->Tokens == dtes->state.tokens)
+      tgsi_exec_machine_bind_shader(dtes->machine, NULL, NULL, NULL, NULL);
+
+   draw_tessellator_destroy(dtes->tessellator);
+   align_free(dtes->patch);
+   FREE(dtes->elts);
+   FREE((void*) dtes->state.tokens);
+   FREE(dtes);
+}
+
+
+void
+draw_set_tess_state(struct draw_context *draw,
+                    const float default_outer_level[4],
+                    const float default_inner_level[2])
+{
+   draw_do_flush(draw, DRAW_FLUSH_STATE_CHANGE);
+
+   memcpy(draw->tcs.default_outer_level, default_outer_level,
+          sizeof(draw->tcs.default_outer_level));
+   memcpy(draw->tcs.default_inner_level, default_inner_level,
+          sizeof(draw->tcs.default_inner_level));
+}
+
+
+/*
+ * Called at the very begin of the draw call with a new instance
+ * Used to reset state that should persist between primitive restart.
+ */
+void
+draw_tess_new_instance(struct draw_context *draw)
+{
+   if (draw->tes.tess_eval_shader)
+      draw->tes.tess_eval_shader->in_prim_idx = 0;
+}
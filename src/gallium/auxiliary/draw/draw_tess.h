@@ -0,0 +1,160 @@
+/**************************************************************************
+ *
+ * Copyright 2019 The Mesa Authors
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/**
+ * Tessellation control and evaluation shader stages.
+ *
+ * The vertex shader output of a PIPE_PRIM_PATCHES draw is handed to
+ * draw_tess_begin().  Every patch then runs through the control shader,
+ * the fixed function tessellator and the evaluation shader, which are both
+ * interpreted, and draw_tess_run() returns the evaluated vertices in
+ * batches which the middle ends treat like the output of a geometry shader.
+ */
+
+#ifndef DRAW_TESS_H
+#define DRAW_TESS_H
+
+#include "draw_context.h"
+#include "draw_private.h"
+#include "draw_tessellator.h"
+#include "tgsi/tgsi_exec.h"
+
+struct draw_context;
+
+/**
+ * Upper bound of the number of vertices returned by one draw_tess_run()
+ * call.  A single patch never exceeds it.
+ */
+#define DRAW_TESS_MAX_BATCH_VERTICES 16384
+
+/**
+ * Upper bound of the number of elements returned by one draw_tess_run()
+ * call, so that the batch can still be emitted without the pipeline.
+ */
+#define DRAW_TESS_MAX_BATCH_ELTS 65535
+
+
+/**
+ * The inputs of the evaluation shader for one patch.
+ * Per-vertex input slot s of vertex v is found in inputs[v][s], per-patch
+ * inputs live in inputs[0] at their own slots.  This is the layout the
+ * interpreter uses for two-dimensional inputs.
+ */
+struct draw_tess_patch {
+   float inputs[TGSI_MAX_PATCH_VERTICES][TGSI_EXEC_MAX_INPUT_ATTRIBS][4];
+   float levels[6];             /**< outer[4] followed by inner[2] */
+   unsigned vertices_in;
+   unsigned prim_id;
+};
+
+
+/**
+ * Private version of the compiled tessellation control shader
+ */
+struct draw_tess_ctrl_shader {
+   struct draw_context *draw;
+
+   struct pipe_shader_state state;
+   struct tgsi_shader_info info;
+
+   unsigned vertices_out;
+   int tess_outer_output;       /**< -1 if not written */
+   int tess_inner_output;       /**< -1 if not written */
+
+   /** Vertex shader output slot of each input, -1 if not written */
+   int input_map[TGSI_EXEC_MAX_INPUT_ATTRIBS];
+};
+
+
+/**
+ * Private version of the compiled tessellation evaluation shader
+ */
+struct draw_tess_eval_shader {
+   struct draw_context *draw;
+
+   struct tgsi_exec_machine *machine;
+
+   struct pipe_shader_state state;
+   struct tgsi_shader_info info;
+
+   struct draw_tess_domain domain;
+   unsigned output_primitive;
+   unsigned position_output;
+   unsigned viewport_index_output;
+   unsigned ccdistance_output[PIPE_MAX_CLIP_OR_CULL_DISTANCE_ELEMENT_COUNT];
+   unsigned vector_length;
+
+   struct draw_tessellator *tessellator;
+   struct draw_tess_patch *patch;
+
+   /* State of the draw being tessellated */
+   const struct tgsi_shader_info *input_info;
+   const struct draw_vertex_info *input_verts;
+   const struct draw_prim_info *input_prims;
+   unsigned num_patches;
+   unsigned patch_idx;
+   boolean patch_pending;       /**< tessellated but not emitted yet */
+   unsigned in_prim_idx;
+
+   /** Control (or vertex) shader output slot of each input, -1 if none */
+   int input_map[TGSI_EXEC_MAX_INPUT_ATTRIBS];
+
+   ushort *elts;
+   unsigned max_elts;
+   unsigned primitive_length;
+
+   void (*prepare)(struct draw_tess_eval_shader *shader,
+                   const void *constants[PIPE_MAX_CONSTANT_BUFFERS],
+                   const unsigned constants_size[PIPE_MAX_CONSTANT_BUFFERS]);
+   /**
+    * Evaluate all the domain points of the tessellator for the current
+    * patch, writing vertices of the given size to output.
+    */
+   void (*run)(struct draw_tess_eval_shader *shader,
+               struct vertex_header *output,
+               unsigned vertex_size);
+};
+
+
+void draw_tess_new_instance(struct draw_context *draw);
+
+void draw_tess_begin(struct draw_context *draw,
+                     const struct draw_vertex_info *input_verts,
+                     const struct draw_prim_info *input_prims,
+                     const struct tgsi_shader_info *input_info);
+
+/*
+ * Tessellates the next batch of patches of the draw started by
+ * draw_tess_begin().  Returns FALSE once all patches have been consumed.
+ * The caller owns output_verts->verts, output_prims->elts stays owned by
+ * the tessellation evaluation shader.
+ */
+boolean draw_tess_run(struct draw_context *draw,
+                      struct draw_vertex_info *output_verts,
+                      struct draw_prim_info *output_prims);
+
+#endif
@@ -0,0 +1,664 @@
+/**************************************************************************
+ *
+ * Copyright 2019 The Mesa Authors
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL
+ * THE COPYRIGHT HOLDERS, AUTHORS AND/OR ITS SUPPLIERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+ * USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ **************************************************************************/
+
+/**
+ * Fixed function tessellator.
+ *
+ * Triangle and quad domains are subdivided into concentric rings.  The
+ * outermost ring is subdivided according to the outer tessellation levels,
+ * all other rings according to the inner levels, and the strip between two
+ * neighbouring rings is triangulated by walking along both of them.
+ *
+ * All triangles are generated counter-clockwise in (u, v) space and
+ * flipped at the end when clockwise ordering is requested.
+ */
+
+#include "util/u_math.h"
+#include "util/u_memory.h"
+
+#include "draw_tessellator.h"
+
+
+#define MAX_POINTS  ((DRAW_TESS_MAX_LEVEL + 1) * (DRAW_TESS_MAX_LEVEL + 1))
+#define MAX_INDICES (MAX_POINTS * 6)
+
+/** Smallest increment turning an inner level of one into a subdivision */
+#define LEVEL_EPSILON (2.0f * FLT_EPSILON)
+
+
+/**
+ * One ring of a triangle or quad domain.  Edge e goes from corner e to
+ * corner e + 1, and its last point is the first point of the next edge.
+ */
+struct draw_tess_ring
+{
+   unsigned num_edges;
+   unsigned count[4];                          /**< segments per edge */
+   unsigned index[4][DRAW_TESS_MAX_LEVEL + 1];
+   float t[4][DRAW_TESS_MAX_LEVEL + 1];        /**< position along the edge */
+   float coord[4][DRAW_TESS_MAX_LEVEL + 1][3]; /**< (u, v, w) */
+};
+
+
+unsigned
+draw_tess_out_prim(const struct draw_tess_domain *domain)
+{
+   if (domain->point_mode)
+      return PIPE_PRIM_POINTS;
+   if (domain->prim_mode == PIPE_PRIM_LINES)
+      return PIPE_PRIM_LINES;
+   return PIPE_PRIM_TRIANGLES;
+}
+
+
+static float
+clamp_level(float level, enum pipe_tess_spacing spacing)
+{
+   const float min = spacing == PIPE_TESS_SPACING_FRACTIONAL_EVEN ? 2.0f : 1.0f;
+   const float max = spacing == PIPE_TESS_SPACING_FRACTIONAL_ODD ?
+      DRAW_TESS_MAX_LEVEL - 1 : DRAW_TESS_MAX_LEVEL;
+
+   /* written so that NaN ends up at the minimum as well */
+   if (!(level >= min))
+      return min;
+   return MIN2(level, max);
+}
+
+
+/**
+ * Number of segments a clamped tessellation level results in.
+ */
+static unsigned
+round_level(float level, enum pipe_tess_spacing spacing)
+{
+   switch (spacing) {
+   case PIPE_TESS_SPACING_FRACTIONAL_EVEN:
+      return 2 * (unsigned) ceilf(level * 0.5f);
+   case PIPE_TESS_SPACING_FRACTIONAL_ODD:
+      return 2 * (unsigned) ceilf((level - 1.0f) * 0.5f) + 1;
+   case PIPE_TESS_SPACING_EQUAL:
+   default:
+      return (unsigned) ceilf(level);
+   }
+}
+
+
+/**
+ * Compute the n + 1 positions subdividing [0, 1] into n segments for the
+ * given level.  With fractional spacing there are n - 2 segments of length
+ * 1 / level and two shorter ones at both ends.
+ *
+ * The positions are mirrored exactly around 0.5, so that the two patches
+ * sharing an edge generate bit identical points no matter in which
+ * direction they walk it.
+ */
+static void
+subdivide(float level, enum pipe_tess_spacing spacing, unsigned n, float *t)
+{
+   unsigned i;
+
+   if (spacing == PIPE_TESS_SPACING_EQUAL || n <= 2 || (float) n == level) {
+      for (i = 0; i <= n / 2; i++)
+         t[i] = (float) i / n;
+   }
+   else {
+      const float seg = 1.0f / level;
+      const float end_seg = 0.5f * (level - (float) (n - 2)) * seg;
+
+      t[0] = 0.0f;
+      for (i = 1; i <= n / 2; i++)
+         t[i] = end_seg + (i - 1) * seg;
+   }
+
+   for (i = 0; i < (n + 1) / 2; i++)
+      t[n - i] = 1.0f - t[i];
+   if (n % 2 == 0)
+      t[n / 2] = 0.5f;
+}
+
+
+static inline unsigned
+add_point(struct draw_tessellator *tess, const float *coord)
+{
+   const unsigned i = tess->num_points++;
+
+   assert(i < MAX_POINTS);
+   tess->u[i] = coord[0];
+   tess->v[i] = coord[1];
+   tess->w[i] = coord[2];
+   return i;
+}
+
+
+static inline void
+add_triangle(struct draw_tessellator *tess,
+             unsigned a, unsigned b, unsigned c)
+{
+   unsigned *idx = tess->indices + tess->num_indices;
+
+   assert(tess->num_indices + 3 <= MAX_INDICES);
+   idx[0] = a;
+   idx[1] = b;
+   idx[2] = c;
+   tess->num_indices += 3;
+}
+
+
+/**
+ * Add the points of a ring whose edges have been set up in ring->count
+ * and ring->coord, and record the index of every edge point.
+ */
+static void
+emit_ring(struct draw_tessellator *tess, struct draw_tess_ring *ring)
+{
+   const unsigned first = tess->num_points;
+   unsigned len = 0, offset = 0;
+   unsigned e, j;
+
+   for (e = 0; e < ring->num_edges; e++) {
+      for (j = 0; j < ring->count[e]; j++)
+         add_point(tess, ring->coord[e][j]);
+      len += ring->count[e];
+   }
+
+   if (len == 0) {
+      /* the ring collapsed into a single point */
+      add_point(tess, ring->coord[0][0]);
+      len = 1;
+   }
+
+   for (e = 0; e < ring->num_edges; e++) {
+      for (j = 0; j <= ring->count[e]; j++)
+         ring->index[e][j] = first + (offset + j) % len;
+      offset += ring->count[e];
+   }
+}
+
+
+/**
+ * Like emit_ring(), for a quad ring without width or height.  It is a
+ * segment walked there along one edge and back along the opposite one, so
+ * only the points of the first edge are added.
+ */
+static void
+emit_flat_ring(struct draw_tessellator *tess, struct draw_tess_ring *ring)
+{
+   const unsigned e0 = ring->count[0] ? 0 : 1;
+   const unsigned n = ring->count[e0];
+   unsigned j;
+
+   assert(ring->num_edges == 4 && n > 0);
+   assert(ring->count[(e0 + 1) % 4] == 0 && ring->count[(e0 + 3) % 4] == 0);
+
+   for (j = 0; j <= n; j++)
+      ring->index[e0][j] = add_point(tess, ring->coord[e0][j]);
+   for (j = 0; j <= n; j++)
+      ring->index[e0 + 2][j] = ring->index[e0][n - j];
+
+   ring->index[(e0 + 1) % 4][0] = ring->index[e0][n];
+   ring->index[(e0 + 3) % 4][0] = ring->index[e0][0];
+}
+
+
+/**
+ * Triangulate the strip between edge e of a ring and the same edge of the
+ * next inner ring, always advancing along the edge whose next segment
+ * has its center closer to the start.
+ */
+static void
+stitch_edge(struct draw_tessellator *tess,
+            const struct draw_tess_ring *outer,
+            const struct draw_tess_ring *inner,
+            unsigned e)
+{
+   const unsigned *oi = outer->index[e];
+   const unsigned *ii = inner->index[e];
+   const float *ot = outer->t[e];
+   const float *it = inner->t[e];
+   const unsigned no = outer->count[e];
+   const unsigned ni = inner->count[e];
+   unsigned a = 0, b = 0;
+
+   while (a < no || b < ni) {
+      if (b == ni || (a < no && ot[a] + ot[a + 1] <= it[b] + it[b + 1])) {
+         add_triangle(tess, oi[a], oi[a + 1], ii[b]);
+         a++;
+      }
+      else {
+         add_triangle(tess, oi[a], ii[b + 1], ii[b]);
+         b++;
+      }
+   }
+}
+
+
+static void
+stitch_rings(struct draw_tessellator *tess,
+             const struct draw_tess_ring *outer,
+             const struct draw_tess_ring *inner)
+{
+   unsigned e;
+
+   for (e = 0; e < outer->num_edges; e++)
+      stitch_edge(tess, outer, inner, e);
+}
+
+
+static void
+tessellate_triangles(struct draw_tessellator *tess,
+                     enum pipe_tess_spacing spacing,
+                     const float outer[4],
+                     const float inner[2])
+{
+   /* edge e goes from the corner with coordinate e being one to the next,
+    * so the edges are w = 0, u = 0 and v = 0 in that order
+    */
+   static const unsigned edge_level[3] = { 2, 0, 1 };
+   struct draw_tess_ring *prev = &tess->rings[0];
+   struct draw_tess_ring *ring = &tess->rings[1];
+   struct draw_tess_ring *tmp;
+   float t_inner[DRAW_TESS_MAX_LEVEL + 1];
+   boolean all_one = TRUE;
+   float level, c = 0.0f;
+   unsigned n, e, j, k;
+
+   prev->num_edges = 3;
+   for (e = 0; e < 3; e++) {
+      const float outer_level = clamp_level(outer[edge_level[e]], spacing);
+      const unsigned cnt = round_level(outer_level, spacing);
+
+      subdivide(outer_level, spacing, cnt, prev->t[e]);
+      prev->count[e] = cnt;
+      all_one = all_one && cnt == 1;
+
+      /* only ever use t and its exact mirror on the outer edges */
+      for (j = 0; j <= cnt; j++) {
+         prev->coord[e][j][e] = prev->t[e][cnt - j];
+         prev->coord[e][j][(e + 1) % 3] = prev->t[e][j];
+         prev->coord[e][j][(e + 2) % 3] = 0.0f;
+      }
+   }
+   emit_ring(tess, prev);
+
+   level = clamp_level(inner[0], spacing);
+   n = round_level(level, spacing);
+   if (n == 1) {
+      if (all_one) {
+         add_triangle(tess, prev->index[0][0], prev->index[1][0],
+                      prev->index[2][0]);
+         return;
+      }
+      level = clamp_level(1.0f + LEVEL_EPSILON, spacing);
+      n = round_level(level, spacing);
+   }
+
+   subdivide(level, spacing, n, t_inner);
+
+   for (k = 1; ; k++) {
+      const unsigned s = n - 2 * k;
+      const float b = k == 1 ? t_inner[1] : prev->t[0][1];
+      float corner[3][3];
+
+      /* Each ring's corner sits where the perpendiculars through the first
+       * inner subdivision points of the two adjacent edges of the previous
+       * ring meet.
+       */
+      c += (2.0f / 3.0f) * b * (1.0f - 3.0f * c);
+
+      for (e = 0; e < 3; e++) {
+         corner[e][e] = 1.0f - 2.0f * c;
+         corner[e][(e + 1) % 3] = c;
+         corner[e][(e + 2) % 3] = c;
+      }
+
+      ring->num_edges = 3;
+      if (s > 0)
+         subdivide(level - 2.0f * k, spacing, s, ring->t[0]);
+      else
+         ring->t[0][0] = 0.0f;
+
+      for (e = 0; e < 3; e++) {
+         const float *p = corner[e];
+         const float *q = corner[(e + 1) % 3];
+
+         ring->count[e] = s;
+         if (e)
+            memcpy(ring->t[e], ring->t[0], (s + 1) * sizeof(float));
+
+         for (j = 0; j <= s; j++) {
+            const float t = ring->t[e][j];
+
+            ring->coord[e][j][0] = p[0] + t * (q[0] - p[0]);
+            ring->coord[e][j][1] = p[1] + t * (q[1] - p[1]);
+            ring->coord[e][j][2] = p[2] + t * (q[2] - p[2]);
+         }
+      }
+
+      emit_ring(tess, ring);
+      stitch_rings(tess, prev, ring);
+
+      if (s <= 1) {
+         if (s == 1)
+            add_triangle(tess, ring->index[0][0], ring->index[1][0],
+                         ring->index[2][0]);
+         break;
+      }
+
+      tmp = prev;
+      prev = ring;
+      ring = tmp;
+   }
+}
+
+
+static inline float
+normalize_pos(float x, float x0, float x1)
+{
+   return x1 > x0 ? (x - x0) / (x1 - x0) : 0.0f;
+}
+
+
+static void
+tessellate_quads(struct draw_tessellator *tess,
+                 enum pipe_tess_spacing spacing,
+                 const float outer[4],
+                 const float inner[2])
+{
+   /* edges v = 0, u = 1, v = 1 and u = 0, walked counter-clockwise */
+   static const unsigned edge_level[4] = { 1, 2, 3, 0 };
+   struct draw_tess_ring *prev = &tess->rings[0];
+   struct draw_tess_ring *ring = &tess->rings[1];
+   struct draw_tess_ring *tmp;
+   float tu[DRAW_TESS_MAX_LEVEL + 1];
+   float tv[DRAW_TESS_MAX_LEVEL + 1];
+   float level[2];
+   unsigned m, n, e, j, k;
+   boolean all_one = TRUE;
+
+   prev->num_edges = 4;
+   for (e = 0; e < 4; e++) {
+      const float outer_level = clamp_level(outer[edge_level[e]], spacing);
+      const unsigned cnt = round_level(outer_level, spacing);
+
+      subdivide(outer_level, spacing, cnt, prev->t[e]);
+      prev->count[e] = cnt;
+      all_one = all_one && cnt == 1;
+
+      for (j = 0; j <= cnt; j++) {
+         const float t = prev->t[e][j];
+         const float r = prev->t[e][cnt - j];
+         float *coord = prev->coord[e][j];
+
+         switch (e) {
+         case 0: coord[0] = t;    coord[1] = 0.0f; break;
+         case 1: coord[0] = 1.0f; coord[1] = t;    break;
+         case 2: coord[0] = r;    coord[1] = 1.0f; break;
+         default: coord[0] = 0.0f; coord[1] = r;   break;
+         }
+         coord[2] = 0.0f;
+      }
+   }
+   emit_ring(tess, prev);
+
+   level[0] = clamp_level(inner[0], spacing);
+   level[1] = clamp_level(inner[1], spacing);
+   m = round_level(level[0], spacing);
+   n = round_level(level[1], spacing);
+
+   if ((m == 1 || n == 1) && all_one) {
+      const unsigned a = prev->index[0][0], b = prev->index[1][0];
+      const unsigned c = prev->index[2][0], d = prev->index[3][0];
+
+      add_triangle(tess, a, b, c);
+      add_triangle(tess, a, c, d);
+      return;
+   }
+   if (m == 1) {
+      level[0] = clamp_level(1.0f + LEVEL_EPSILON, spacing);
+      m = round_level(level[0], spacing);
+   }
+   if (n == 1) {
+      level[1] = clamp_level(1.0f + LEVEL_EPSILON, spacing);
+      n = round_level(level[1], spacing);
+   }
+
+   subdivide(level[0], spacing, m, tu);
+   subdivide(level[1], spacing, n, tv);
+
+   for (k = 1; ; k++) {
+      const unsigned ms = m - 2 * k;
+      const unsigned ns = n - 2 * k;
+      const float u0 = tu[k], u1 = tu[m - k];
+      const float v0 = tv[k], v1 = tv[n - k];
+
+      ring->num_edges = 4;
+      ring->count[0] = ring->count[2] = ms;
+      ring->count[1] = ring->count[3] = ns;
+
+      for (j = 0; j <= ms; j++) {
+         const float ub = tu[k + j], ut = tu[m - k - j];
+
+         ring->coord[0][j][0] = ub;
+         ring->coord[0][j][1] = v0;
+         ring->coord[0][j][2] = 0.0f;
+         ring->t[0][j] = normalize_pos(ub, u0, u1);
+
+         ring->coord[2][j][0] = ut;
+         ring->coord[2][j][1] = v1;
+         ring->coord[2][j][2] = 0.0f;
+         ring->t[2][j] = 1.0f - normalize_pos(ut, u0, u1);
+      }
+      for (j = 0; j <= ns; j++) {
+         const float vr = tv[k + j], vl = tv[n - k - j];
+
+         ring->coord[1][j][0] = u1;
+         ring->coord[1][j][1] = vr;
+         ring->coord[1][j][2] = 0.0f;
+         ring->t[1][j] = normalize_pos(vr, v0, v1);
+
+         ring->coord[3][j][0] = u0;
+         ring->coord[3][j][1] = vl;
+         ring->coord[3][j][2] = 0.0f;
+         ring->t[3][j] = 1.0f - normalize_pos(vl, v0, v1);
+      }
+
+      if ((ms == 0) != (ns == 0))
+         emit_flat_ring(tess, ring);
+      else
+         emit_ring(tess, ring);
+      stitch_rings(tess, prev, ring);
+
+      if (ms <= 1 || ns <= 1) {
+         /* fill the remaining single row or column of grid cells */
+         if (ms == 1 && ns >= 1) {
+            for (j = 0; j < ns; j++) {
+               const unsigned a = ring->index[3][ns - j];
+               const unsigned b = ring->index[1][j];
+               const unsigned c = ring->index[1][j + 1];
+               const unsigned d = ring->index[3][ns - j - 1];
+
+               add_triangle(tess, a, b, c);
+               add_triangle(tess, a, c, d);
+            }
+         }
+         else if (ns == 1 && ms >= 1) {
+            for (j = 0; j < ms; j++) {
+               const unsigned a = ring->index[0][j];
+               const unsigned b = ring->index[0][j + 1];
+               const unsigned c = ring->index[2][ms - j - 1];
+               const unsigned d = ring->index[2][ms - j];
+
+               add_triangle(tess, a, b, c);
+               add_triangle(tess, a, c, d);
+            }
+         }
+         break;
+      }
+
+      tmp = prev;
+      prev = ring;
+      ring = tmp;
+   }
+}
+
+
+static void
+tessellate_isolines(struct draw_tessellator *tess,
+                    enum pipe_tess_spacing spacing,
+                    const float outer[4])
+{
+   const float lines_level = clamp_level(outer[0], PIPE_TESS_SPACING_EQUAL);
+   const float segs_level = clamp_level(outer[1], spacing);
+   const unsigned lines = round_level(lines_level, PIPE_TESS_SPACING_EQUAL);
+   const unsigned segs = round_level(segs_level, spacing);
+   float t[DRAW_TESS_MAX_LEVEL + 1];
+   unsigned i, j;
+
+   subdivide(segs_level, spacing, segs, t);
+
+   /* lines are placed at v = j / lines, v = 1 is never reached */
+   for (j = 0; j < lines; j++) {
+      const unsigned first = tess->num_points;
+      float coord[3];
+
+      coord[1] = (float) j / lines;
+      coord[2] = 0.0f;
+      for (i = 0; i <= segs; i++) {
+         coord[0] = t[i];
+         add_point(tess, coord);
+      }
+
+      for (i = 0; i < segs; i++) {
+         tess->indices[tess->num_indices++] = first + i;
+         tess->indices[tess->num_indices++] = first + i + 1;
+      }
+   }
+}
+
+
+void
+draw_tessellate(struct draw_tessellator *tess,
+                const struct draw_tess_domain *domain,
+                const float outer[4],
+                const float inner[2])
+{
+   unsigned num_outer, i;
+
+   tess->num_points = 0;
+   tess->num_indices = 0;
+   tess->out_prim = draw_tess_out_prim(domain);
+
+   switch (domain->prim_mode) {
+   case PIPE_PRIM_TRIANGLES:
+      num_outer = 3;
+      break;
+   case PIPE_PRIM_QUADS:
+      num_outer = 4;
+      break;
+   default:
+      num_outer = 2;
+      break;
+   }
+
+   /* the patch is discarded if any relevant outer level is <= 0 or NaN */
+   for (i = 0; i < num_outer; i++) {
+      if (!(outer[i] > 0.0f))
+         return;
+   }
+
+   switch (domain->prim_mode) {
+   case PIPE_PRIM_TRIANGLES:
+      tessellate_triangles(tess, domain->spacing, outer, inner);
+      break;
+   case PIPE_PRIM_QUADS:
+      tessellate_quads(tess, domain->spacing, outer, inner);
+      break;
+   default:
+      tessellate_isolines(tess, domain->spacing, outer);
+      break;
+   }
+
+   if (domain->point_mode) {
+      /* every point is generated exactly once */
+      for (i = 0; i < tess->num_points; i++)
+         tess->indices[i] = i;
+      tess->num_indices = tess->num_points;
+   }
+   else if (domain->vertex_order_cw &&
+            tess->out_prim == PIPE_PRIM_TRIANGLES) {
+      for (i = 0; i < tess->num_indices; i += 3) {
+         const unsigned tmp = tess->indices[i + 1];
+         tess->indices[i + 1] = tess->indices[i + 2];
+         tess->indices[i + 2] = tmp;
+      }
+   }
+
+   /* keep the padding well defined for the SIMD consumers */
+   for (i = tess->num_points;
+        i < align(tess->num_points, DRAW_TESS_POINT_ALIGN); i++) {
+      tess->u[i] = tess->v[i] = tess->w[i] = 0.0f;
+   }
+}
+
+
+struct draw_tessellator *
+draw_tessellator_create(void)
+{
+   const unsigned size = align(MAX_POINTS, DRAW_TESS_POINT_ALIGN) * sizeof(float);
+   struct draw_tessellator *tess = CALLOC_STRUCT(draw_tessellator);
+
+   if (!tess)
+      return NULL;
+
+   tess->u = align_malloc(size, 64);
+   tess->v = align_malloc(size, 64);
+   tess->w = align_malloc(size, 64);
+   tess->indices = MALLOC(MAX_INDICES * sizeof(unsigned));
+   tess->rings = CALLOC(2, sizeof(struct draw_tess_ring));
+
+   if (!tess->u || !tess->v || !tess->w || !tess->indices || !tess->rings) {
+      draw_tessellator_destroy(tess);
+      return NULL;
+   }
+
+   return tess;
+}
+
+
+void
+draw_tessellator_destroy(struct draw_tessellator *tess)
+{
+   if (!tess)
+      return;
+
+   align_free(tess->u);
+   align_free(tess->v);
+   align_free(tess->w);
+   FREE(tess->indices);
+   FREE(tess->rings);
+   FREE(tess);
+}
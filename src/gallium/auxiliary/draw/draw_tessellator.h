@@ -0,0 +1,99 @@
+/**************************************************************************
+ *
+ * Copyright 2019 The Mesa Authors
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL
+ * THE COPYRIGHT HOLDERS, AUTHORS AND/OR ITS SUPPLIERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+ * USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ **************************************************************************/
+
+/**
+ * Fixed function tessellator.
+ *
+ * Subdivides a triangle, quad or isoline domain according to the
+ * tessellation levels of a patch, following the rules of the GL 4.x
+ * specification, section 11.2.2.
+ */
+
+#ifndef DRAW_TESSELLATOR_H
+#define DRAW_TESSELLATOR_H
+
+#include "pipe/p_compiler.h"
+#include "pipe/p_defines.h"
+
+
+/** Largest tessellation level, GL's MAX_TESS_GEN_LEVEL */
+#define DRAW_TESS_MAX_LEVEL 64
+
+/**
+ * The domain point arrays are padded so that they can always be consumed
+ * in whole SIMD vectors of up to this many points.
+ */
+#define DRAW_TESS_POINT_ALIGN 16
+
+
+struct draw_tess_ring;
+
+/** The tessellation state of a tess evaluation shader */
+struct draw_tess_domain
+{
+   unsigned prim_mode;             /**< PIPE_PRIM_TRIANGLES, _QUADS or _LINES */
+   enum pipe_tess_spacing spacing;
+   boolean vertex_order_cw;
+   boolean point_mode;
+};
+
+struct draw_tessellator
+{
+   /**
+    * Domain points in SoA layout.  w is only meaningful for triangle
+    * domains and is zero otherwise.
+    */
+   float *u;
+   float *v;
+   float *w;
+   unsigned num_points;
+
+   /** Primitives connecting the domain points */
+   unsigned out_prim;              /**< PIPE_PRIM_POINTS, _LINES or _TRIANGLES */
+   unsigned *indices;
+   unsigned num_indices;
+
+   struct draw_tess_ring *rings;
+};
+
+
+struct draw_tessellator *
+draw_tessellator_create(void);
+
+void
+draw_tessellator_destroy(struct draw_tessellator *tess);
+
+void
+draw_tessellate(struct draw_tessellator *tess,
+                const struct draw_tess_domain *domain,
+                const float outer[4],
+                const float inner[2]);
+
+unsigned
+draw_tess_out_prim(const struct draw_tess_domain *domain);
+
+#endif /* DRAW_TESSELLATOR_H */
@@ -155,11 +155,11 @@ draw_vs_init( struct draw_context *draw )
          return FALSE;
    }
 
-   draw->vs.emit_cache = translate_cache_create();
+   draw->vs.emit_cache = draw_translate_cache_create(draw);
    if (!draw->vs.emit_cache) 
       return FALSE;
       
-   draw->vs.fetch_cache = translate_cache_create();
+   draw->vs.fetch_cache = draw_translate_cache_create(draw);
    if (!draw->vs.fetch_cache) 
       return FALSE;
 
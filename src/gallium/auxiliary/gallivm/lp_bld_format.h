@@ -151,6 +151,18 @@ lp_build_fetch_rgba_soa(struct gallivm_state *gallivm,
                         LLVMValueRef cache,
                         LLVMValueRef rgba_out[4]);
 
+boolean
+lp_build_store_rgba_soa_supported(const struct util_format_description *format_desc);
+
+void
+lp_build_store_rgba_soa(struct gallivm_state *gallivm,
+                        const struct util_format_description *format_desc,
+                        struct lp_type type,
+                        LLVMValueRef mask,
+                        LLVMValueRef base_ptr,
+                        LLVMValueRef offsets,
+                        const LLVMValueRef rgba_in[4]);
+
 /*
  * YUV
  */
@@ -165,6 +177,81 @@ lp_build_fetch_subsampled_rgba_aos(struct gallivm_state *gallivm,
                                    LLVMValueRef j);
 
 
+/*
+ * RGTC / LATC
+ */
+
+void
+lp_build_fetch_rgtc_rgba_soa(struct gallivm_state *gallivm,
+                             const struct util_format_description *format_desc,
+                             struct lp_type type,
+                             LLVMValueRef base_ptr,
+                             LLVMValueRef offset,
+                             LLVMValueRef i,
+                             LLVMValueRef j,
+                             LLVMValueRef rgba_out[4]);
+
+LLVMValueRef
+lp_build_fetch_rgtc_rgba_aos(struct gallivm_state *gallivm,
+                             const struct util_format_description *format_desc,
+                             unsigned n,
+                             LLVMValueRef base_ptr,
+                             LLVMValueRef offset,
+                             LLVMValueRef i,
+                             LLVMValueRef j);
+
+
+/*
+ * BPTC
+ */
+
+void
+lp_build_fetch_bptc_rgba_soa(struct gallivm_state *gallivm,
+                             const struct util_format_description *format_desc,
+                             struct lp_type type,
+                             LLVMValueRef base_ptr,
+                             LLVMValueRef offset,
+                             LLVMValueRef i,
+                             LLVMValueRef j,
+                             LLVMValueRef rgba_out[4]);
+
+LLVMValueRef
+lp_build_fetch_bptc_rgba_aos(struct gallivm_state *gallivm,
+                             const struct util_format_description *format_desc,
+                             unsigned n,
+                             LLVMValueRef base_ptr,
+                             LLVMValueRef offset,
+                             LLVMValueRef i,
+                             LLVMValueRef j);
+
+
+/*
+ * ETC
+ */
+
+void
+lp_build_fetch_etc_rgba_soa(struct gallivm_state *gallivm,
+                            const struct util_format_description *format_desc,
+                            struct lp_type type,
+                            LLVMValueRef base_ptr,
+                            LLVMValueRef offset,
+                            LLVMValueRef i,
+                            LLVMValueRef j,
+                            LLVMValueRef rgba_out[4]);
+
+LLVMValueRef
+lp_build_fetch_etc_rgba_aos(struct gallivm_state *gallivm,
+                            const struct util_format_description *format_desc,
+                            unsigned n,
+                            LLVMValueRef base_ptr,
+                            LLVMValueRef offset,
+                            LLVMValueRef i,
+                            LLVMValueRef j);
+
+
+boolean
+lp_build_format_cache_supported(const struct util_format_description *format_desc);
+
 LLVMValueRef
 lp_build_fetch_cached_texels(struct gallivm_state *gallivm,
                              const struct util_format_description *format_desc,
@@ -725,10 +725,97 @@ lp_build_fetch_rgba_aos(struct gallivm_state *gallivm,
    }
 
    /*
-    * s3tc rgb formats
+    * rgtc / latc, bptc and etc formats
     */
 
-   if (format_desc->layout == UTIL_FORMAT_LAYOUT_S3TC && cache) {
+   if (format_desc->layout == UTIL_FORMAT_LAYOUT_RGTC ||
+       format_desc->layout == UTIL_FORMAT_LAYOUT_BPTC ||
+       format_desc->layout == UTIL_FORMAT_LAYOUT_ETC) {
+      const struct util_format_description *linear_desc =
+         util_format_description(util_format_linear(format_desc->format));
+
+      if (util_format_fits_8unorm(linear_desc)) {
+         struct lp_type tmp_type;
+         LLVMValueRef tmp;
+
+         memset(&tmp_type, 0, sizeof tmp_type);
+         tmp_type.width = 8;
+         tmp_type.length = num_pixels * 4;
+         tmp_type.norm = TRUE;
+
+         if (format_desc->layout == UTIL_FORMAT_LAYOUT_RGTC) {
+            tmp = lp_build_fetch_rgtc_rgba_aos(gallivm, format_desc,
+                                               num_pixels, base_ptr, offset,
+                                               i, j);
+         }
+         else if (format_desc->layout == UTIL_FORMAT_LAYOUT_BPTC) {
+            tmp = lp_build_fetch_bptc_rgba_aos(gallivm, format_desc,
+                                               num_pixels, base_ptr, offset,
+                                               i, j);
+         }
+         else {
+            tmp = lp_build_fetch_etc_rgba_aos(gallivm, format_desc,
+                                              num_pixels, base_ptr, offset,
+                                              i, j);
+         }
+
+         lp_build_conv(gallivm,
+                       tmp_type, type,
+                       &tmp, 1, &tmp, 1);
+
+         return tmp;
+      }
+      else {
+         /* snorm and float: decode as SoA floats and interleave */
+         struct lp_type float_type = lp_type_float_vec(32, 32 * 4 * num_pixels);
+         struct lp_type soa_type = lp_type_float_vec(32, 32 * num_pixels);
+         LLVMValueRef rgba[4];
+         LLVMValueRef res = lp_build_undef(gallivm, float_type);
+         unsigned k, chan;
+
+         if (format_desc->layout == UTIL_FORMAT_LAYOUT_RGTC) {
+            lp_build_fetch_rgtc_rgba_soa(gallivm, format_desc, soa_type,
+                                         base_ptr, offset, i, j, rgba);
+         }
+         else if (format_desc->layout == UTIL_FORMAT_LAYOUT_BPTC) {
+            lp_build_fetch_bptc_rgba_soa(gallivm, format_desc, soa_type,
+                                         base_ptr, offset, i, j, rgba);
+         }
+         else {
+            lp_build_fetch_etc_rgba_soa(gallivm, format_desc, soa_type,
+                                        base_ptr, offset, i, j, rgba);
+         }
+
+         for (k = 0; k < num_pixels; ++k) {
+            for (chan = 0; chan < 4; ++chan) {
+               LLVMValueRef elem = rgba[chan];
+               if (num_pixels > 1) {
+                  elem = LLVMBuildExtractElement(builder, elem,
+                                                 lp_build_const_int32(gallivm, k),
+                                                 "");
+               }
+               res = LLVMBuildInsertElement(builder, res, elem,
+                                            lp_build_const_int32(gallivm,
+                                                                 k * 4 + chan),
+                                            "");
+            }
+         }
+
+         if (!type.floating || type.width != 32) {
+            lp_build_conv(gallivm,
+                          float_type, type,
+                          &res, 1, &res, 1);
+         }
+
+         return res;
+      }
+   }
+
+   /*
+    * s3tc formats
+    */
+
+   if (cache && lp_build_format_cache_supported(format_desc)) {
       struct lp_type tmp_type;
       LLVMValueRef tmp;
 
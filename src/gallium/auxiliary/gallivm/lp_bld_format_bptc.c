@@ -0,0 +1,1035 @@
+/**************************************************************************
+ *
+ * Copyright 2019 VMware, Inc.
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL VMWARE AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+
+/**
+ * @file
+ * BPTC (BC6H and BC7) texel fetch.
+ *
+ * As with RGTC every texel is decoded on its own for a whole vector of
+ * texels.  The block mode may differ per element, so the mode parameters
+ * are selected per element and all fields are then extracted with variable
+ * shifts.  The decoders are large, hence they are emitted only once per
+ * module as internal functions.  The decoding matches
+ * texcompress_bptc_tmp.h bit for bit.
+ */
+
+
+#include "util/u_format.h"
+#include "util/u_math.h"
+#include "util/u_string.h"
+
+#include "lp_bld_arit.h"
+#include "lp_bld_type.h"
+#include "lp_bld_const.h"
+#include "lp_bld_conv.h"
+#include "lp_bld_gather.h"
+#include "lp_bld_format.h"
+#include "lp_bld_init.h"
+#include "lp_bld_intr.h"
+#include "lp_bld_logic.h"
+#include "lp_bld_swizzle.h"
+
+#include "../../../mesa/main/texcompress_bptc_tables.h"
+
+
+/* Interpolation weights for 2, 3 and 4 bit indices, see interpolate() */
+static const uint32_t
+bptc_weights[4 + 8 + 16] = {
+   0, 21, 43, 64,
+   0, 9, 18, 27, 37, 46, 55, 64,
+   0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64
+};
+
+
+static boolean
+bptc_is_float(enum pipe_format format)
+{
+   return format == PIPE_FORMAT_BPTC_RGB_FLOAT ||
+          format == PIPE_FORMAT_BPTC_RGB_UFLOAT;
+}
+
+
+/**
+ * Look up a value of a constant table for every element.
+ * The table is emitted once per module as a global of the given name.
+ */
+static LLVMValueRef
+lookup_table(struct lp_build_context *bld,
+             const char *name,
+             const uint32_t *values,
+             unsigned count,
+             LLVMValueRef index)
+{
+   struct gallivm_state *gallivm = bld->gallivm;
+   LLVMBuilderRef builder = gallivm->builder;
+   LLVMTypeRef int32_type = LLVMInt32TypeInContext(gallivm->context);
+   LLVMValueRef table, offsets;
+
+   table = LLVMGetNamedGlobal(gallivm->module, name);
+   if (!table) {
+      LLVMValueRef elems[2 * N_PARTITIONS];
+      unsigned k;
+
+      assert(count <= ARRAY_SIZE(elems));
+      for (k = 0; k < count; k++) {
+         elems[k] = LLVMConstInt(int32_type, values[k], 0);
+      }
+      table = LLVMAddGlobal(gallivm->module,
+                            LLVMArrayType(int32_type, count), name);
+      LLVMSetGlobalConstant(table, TRUE);
+      LLVMSetLinkage(table, LLVMInternalLinkage);
+      LLVMSetInitializer(table, LLVMConstArray(int32_type, elems, count));
+   }
+
+   table = LLVMBuildBitCast(builder, table,
+                            LLVMPointerType(LLVMInt8TypeInContext(gallivm->context),
+                                            0), "");
+   offsets = LLVMBuildShl(builder, index,
+                          lp_build_const_int_vec(gallivm, bld->type, 2), "");
+   return lp_build_gather(gallivm, bld->type.length, 32, lp_type_uint(32),
+                          TRUE, table, offsets, FALSE);
+}
+
+
+/**
+ * Partition words of the two subset partitions, followed by those of the
+ * three subset partitions.
+ */
+static LLVMValueRef
+lookup_partition(struct lp_build_context *bld, LLVMValueRef index)
+{
+   uint32_t values[2 * N_PARTITIONS];
+   unsigned k;
+
+   for (k = 0; k < N_PARTITIONS; k++) {
+      values[k] = partition_table1[k];
+      values[N_PARTITIONS + k] = partition_table2[k];
+   }
+
+   return lookup_table(bld, "bptc_partitions", values, ARRAY_SIZE(values),
+                       index);
+}
+
+
+/**
+ * Anchor texels of a partition, the second subset of two subset partitions
+ * in bits 0-7, the second and third subsets of three subset partitions in
+ * bits 8-15 and 16-23.
+ */
+static LLVMValueRef
+lookup_anchors(struct lp_build_context *bld, LLVMValueRef partition)
+{
+   uint32_t values[N_PARTITIONS];
+   unsigned k;
+
+   for (k = 0; k < N_PARTITIONS; k++) {
+      values[k] = anchor_indices[0][k] |
+                  anchor_indices[1][k] << 8 |
+                  anchor_indices[2][k] << 16;
+   }
+
+   return lookup_table(bld, "bptc_anchors", values, ARRAY_SIZE(values),
+                       partition);
+}
+
+
+/**
+ * Interpolation weight of the index, which has index_bits bits.
+ */
+static LLVMValueRef
+lookup_weight(struct lp_build_context *bld,
+              LLVMValueRef index,
+              LLVMValueRef index_bits)
+{
+   struct gallivm_state *gallivm = bld->gallivm;
+   LLVMBuilderRef builder = gallivm->builder;
+   LLVMValueRef tmp;
+
+   /* the weights of n bit indices start at (1 << n) - 4 */
+   tmp = LLVMBuildShl(builder, bld->one, index_bits, "");
+   tmp = LLVMBuildSub(builder, tmp,
+                      lp_build_const_int_vec(gallivm, bld->type, 4), "");
+   tmp = LLVMBuildAdd(builder, tmp, index, "");
+
+   return lookup_table(bld, "bptc_weights", bptc_weights,
+                       ARRAY_SIZE(bptc_weights), tmp);
+}
+
+
+/**
+ * ((64 - weight) * a + weight * b + 32) >> 6
+ */
+static LLVMValueRef
+interpolate(struct lp_build_context *bld,
+            LLVMValueRef a,
+            LLVMValueRef b,
+            LLVMValueRef weight)
+{
+   struct gallivm_state *gallivm = bld->gallivm;
+   LLVMBuilderRef builder = gallivm->builder;
+   LLVMValueRef res, tmp;
+
+   tmp = LLVMBuildSub(builder, lp_build_const_int_vec(gallivm, bld->type, 64),
+                      weight, "");
+   res = LLVMBuildMul(builder, tmp, a, "");
+   tmp = LLVMBuildMul(builder, weight, b, "");
+   res = LLVMBuildAdd(builder, res, tmp, "");
+   res = LLVMBuildAdd(builder, res,
+                      lp_build_const_int_vec(gallivm, bld->type, 32), "");
+   return LLVMBuildAShr(builder, res,
+                        lp_build_const_int_vec(gallivm, bld->type, 6), "");
+}
+
+
+/**
+ * Extract n_bits bits at a constant bit offset of the 128 bit blocks.
+ */
+static LLVMValueRef
+extract_const_bits(struct lp_build_context *bld,
+                   LLVMValueRef words[4],
+                   unsigned offset,
+                   unsigned n_bits)
+{
+   struct gallivm_state *gallivm = bld->gallivm;
+   LLVMBuilderRef builder = gallivm->builder;
+   unsigned word = offset / 32;
+   unsigned shift = offset % 32;
+   LLVMValueRef res, tmp;
+
+   assert(n_bits > 0 && n_bits < 32 && offset + n_bits <= 128);
+
+   res = words[word];
+   if (shift) {
+      res = LLVMBuildLShr(builder, res,
+                          lp_build_const_int_vec(gallivm, bld->type, shift),
+                          "");
+   }
+   if (shift + n_bits > 32) {
+      tmp = LLVMBuildShl(builder, words[word + 1],
+                         lp_build_const_int_vec(gallivm, bld->type,
+                                                32 - shift), "");
+      res = LLVMBuildOr(builder, res, tmp, "");
+   }
+
+   return LLVMBuildAnd(builder, res,
+                       lp_build_const_int_vec(gallivm, bld->type,
+                                              (1 << n_bits) - 1), "");
+}
+
+
+/**
+ * Extract n_bits bits at a per element bit offset of the 128 bit blocks.
+ * n_bits is below 32 and may be zero, which gives zero.
+ */
+static LLVMValueRef
+extract_bits(struct lp_build_context *bld,
+             LLVMValueRef words[4],
+             LLVMValueRef offset,
+             LLVMValueRef n_bits)
+{
+   struct gallivm_state *gallivm = bld->gallivm;
+   LLVMBuilderRef builder = gallivm->builder;
+   struct lp_type type64 = lp_type_int_vec(64, 64 * bld->type.length);
+   LLVMTypeRef vec_type64 = lp_build_vec_type(gallivm, type64);
+   LLVMValueRef word, lo, hi, res, tmp;
+   unsigned k;
+
+   /* combine the word the field starts in with the next one */
+   word = LLVMBuildLShr(builder, offset,
+                        lp_build_const_int_vec(gallivm, bld->type, 5), "");
+   lo = words[0];
+   hi = words[1];
+   for (k = 1; k < 4; k++) {
+      tmp = lp_build_cmp(bld, PIPE_FUNC_EQUAL, word,
+                         lp_build_const_int_vec(gallivm, bld->type, k));
+      lo = lp_build_select(bld, tmp, words[k], lo);
+      hi = lp_build_select(bld, tmp, k < 3 ? words[k + 1] : bld->zero, hi);
+   }
+
+   lo = LLVMBuildZExt(builder, lo, vec_type64, "");
+   hi = LLVMBuildZExt(builder, hi, vec_type64, "");
+   hi = LLVMBuildShl(builder, hi,
+                     lp_build_const_int_vec(gallivm, type64, 32), "");
+   res = LLVMBuildOr(builder, lo, hi, "");
+
+   tmp = LLVMBuildAnd(builder, offset,
+                      lp_build_const_int_vec(gallivm, bld->type, 31), "");
+   tmp = LLVMBuildZExt(builder, tmp, vec_type64, "");
+   res = LLVMBuildLShr(builder, res, tmp, "");
+   res = LLVMBuildTrunc(builder, res, bld->vec_type, "");
+
+   tmp = LLVMBuildShl(builder, bld->one, n_bits, "");
+   tmp = LLVMBuildSub(builder, tmp, bld->one, "");
+   return LLVMBuildAnd(builder, res, tmp, "");
+}
+
+
+/**
+ * Sign extend the low n_bits bits, n_bits being at least one.
+ */
+static LLVMValueRef
+sign_extend(struct lp_build_context *bld,
+            LLVMValueRef value,
+            LLVMValueRef n_bits)
+{
+   LLVMBuilderRef builder = bld->gallivm->builder;
+   LLVMValueRef shift;
+
+   shift = LLVMBuildSub(builder,
+                        lp_build_const_int_vec(bld->gallivm, bld->type, 32),
+                        n_bits, "");
+   value = LLVMBuildShl(builder, value, shift, "");
+   return LLVMBuildAShr(builder, value, shift, "");
+}
+
+
+/**
+ * Set the parameter to value for the elements of the mode selected by sel.
+ * The first mode has no sel and initializes the parameter.
+ */
+static void
+select_value(struct lp_build_context *bld,
+             LLVMValueRef sel,
+             LLVMValueRef *param,
+             LLVMValueRef value)
+{
+   *param = sel ? lp_build_select(bld, sel, value, *param) : value;
+}
+
+
+static void
+select_param(struct lp_build_context *bld,
+             LLVMValueRef sel,
+             LLVMValueRef *param,
+             int value)
+{
+   select_value(bld, sel, param,
+                lp_build_const_int_vec(bld->gallivm, bld->type, value));
+}
+
+
+/**
+ * Index of texel (i, j) within the block, and the number of anchor texels
+ * (whose indices have one bit less) before it, for one or two subsets or
+ * for three subsets if is_three is set.
+ */
+static void
+anchors_before_texel(struct lp_build_context *bld,
+                     LLVMValueRef texel,
+                     LLVMValueRef anchors,
+                     LLVMValueRef is_two,
+                     LLVMValueRef is_three,
+                     LLVMValueRef *is_anchor,
+                     LLVMValueRef *num_before)
+{
+   struct gallivm_state *gallivm = bld->gallivm;
+   LLVMBuilderRef builder = gallivm->builder;
+   LLVMValueRef anchor[3], tmp;
+   unsigned k;
+
+   for (k = 0; k < 3; k++) {
+      tmp = LLVMBuildLShr(builder, anchors,
+                          lp_build_const_int_vec(gallivm, bld->type, 8 * k),
+                          "");
+      anchor[k] = LLVMBuildAnd(builder, tmp,
+                               lp_build_const_int_vec(gallivm, bld->type, 0xff),
+                               "");
+   }
+
+   /* the first texel is the anchor of the first subset */
+   *is_anchor = lp_build_cmp(bld, PIPE_FUNC_EQUAL, texel, bld->zero);
+   tmp = lp_build_cmp(bld, PIPE_FUNC_EQUAL, texel, anchor[0]);
+   tmp = LLVMBuildAnd(builder, tmp, is_two, "");
+   *is_anchor = LLVMBuildOr(builder, *is_anchor, tmp, "");
+   for (k = 1; k < 3; k++) {
+      tmp = lp_build_cmp(bld, PIPE_FUNC_EQUAL, texel, anchor[k]);
+      tmp = LLVMBuildAnd(builder, tmp, is_three, "");
+      *is_anchor = LLVMBuildOr(builder, *is_anchor, tmp, "");
+   }
+
+   /* the comparison masks are -1, so subtract them */
+   tmp = lp_build_cmp(bld, PIPE_FUNC_NOTEQUAL, texel, bld->zero);
+   *num_before = LLVMBuildSub(builder, bld->zero, tmp, "");
+   tmp = lp_build_cmp(bld, PIPE_FUNC_GREATER, texel, anchor[0]);
+   tmp = LLVMBuildAnd(builder, tmp, is_two, "");
+   *num_before = LLVMBuildSub(builder, *num_before, tmp, "");
+   for (k = 1; k < 3; k++) {
+      tmp = lp_build_cmp(bld, PIPE_FUNC_GREATER, texel, anchor[k]);
+      tmp = LLVMBuildAnd(builder, tmp, is_three, "");
+      *num_before = LLVMBuildSub(builder, *num_before, tmp, "");
+   }
+}
+
+
+/**
+ * Expand the n_bits bits values to 8 bits by replicating the top bits.
+ */
+static LLVMValueRef
+expand_component(struct lp_build_context *bld,
+                 LLVMValueRef value,
+                 LLVMValueRef n_bits)
+{
+   struct gallivm_state *gallivm = bld->gallivm;
+   LLVMBuilderRef builder = gallivm->builder;
+   LLVMValueRef shl, shr, tmp;
+
+   shl = LLVMBuildSub(builder, lp_build_const_int_vec(gallivm, bld->type, 8),
+                      n_bits, "");
+   shr = LLVMBuildShl(builder, n_bits, bld->one, "");
+   shr = LLVMBuildSub(builder, shr,
+                      lp_build_const_int_vec(gallivm, bld->type, 8), "");
+
+   tmp = LLVMBuildShl(builder, value, shl, "");
+   value = LLVMBuildLShr(builder, value, shr, "");
+   return LLVMBuildOr(builder, tmp, value, "");
+}
+
+
+/**
+ * Decode BC7 texels.
+ * @param words  the four 32 bit words of each block
+ * @return  <n x i32> packed rgba8 values
+ */
+static LLVMValueRef
+decode_bc7(struct gallivm_state *gallivm,
+           unsigned n,
+           LLVMValueRef words[4],
+           LLVMValueRef i,
+           LLVMValueRef j)
+{
+   LLVMBuilderRef builder = gallivm->builder;
+   struct lp_type type32 = lp_type_int_vec(32, 32 * n);
+   struct lp_build_context bld;
+   LLVMValueRef n_subsets = NULL, partition_bits = NULL, rotation_bits = NULL;
+   LLVMValueRef index_sel_bits = NULL, color_bits = NULL, alpha_bits = NULL;
+   LLVMValueRef endpoint_pbits = NULL, pbits = NULL;
+   LLVMValueRef index_bits = NULL, sec_index_bits = NULL;
+   LLVMValueRef mode, reserved, bit_offset, partition, rotation, index_sel;
+   LLVMValueRef texel, subset, endpoint, pbit_offset, num_endpoints;
+   LLVMValueRef is_two, is_three, is_anchor, num_before, anchor_bit;
+   LLVMValueRef index, sec_index, color_index, color_bits_sel;
+   LLVMValueRef alpha_index, alpha_bits_sel, use_sec, no_alpha;
+   LLVMValueRef color_n, alpha_n, weight, tmp;
+   LLVMValueRef endpoints[2][4], rgba[4], res;
+   char intrinsic[32];
+   unsigned m, e, c;
+
+   lp_build_context_init(&bld, gallivm, type32);
+
+#define C(v) lp_build_const_int_vec(gallivm, type32, v)
+
+   /* the mode is the number of trailing zeros of the first byte */
+   tmp = LLVMBuildAnd(builder, words[0], C(0xff), "");
+   tmp = LLVMBuildOr(builder, tmp, C(0x100), "");
+   lp_format_intrinsic(intrinsic, sizeof intrinsic, "llvm.cttz", bld.vec_type);
+   mode = lp_build_intrinsic_binary(builder, intrinsic, bld.vec_type, tmp,
+                                    LLVMConstInt(LLVMInt1TypeInContext(gallivm->context),
+                                                 0, 0));
+   reserved = lp_build_cmp(&bld, PIPE_FUNC_EQUAL, mode,
+                           C(ARRAY_SIZE(bptc_unorm_modes)));
+
+   /* blocks of the reserved mode are decoded as mode 0 and replaced below */
+   for (m = 0; m < ARRAY_SIZE(bptc_unorm_modes); m++) {
+      const struct bptc_unorm_mode *mode_desc = &bptc_unorm_modes[m];
+      LLVMValueRef sel = NULL;
+
+      if (m) {
+         sel = lp_build_cmp(&bld, PIPE_FUNC_EQUAL, mode, C(m));
+      }
+      select_param(&bld, sel, &n_subsets, mode_desc->n_subsets);
+      select_param(&bld, sel, &partition_bits, mode_desc->n_partition_bits);
+      select_param(&bld, sel, &rotation_bits,
+                   mode_desc->has_rotation_bits ? 2 : 0);
+      select_param(&bld, sel, &index_sel_bits,
+                   mode_desc->has_index_selection_bit);
+      select_param(&bld, sel, &color_bits, mode_desc->n_color_bits);
+      select_param(&bld, sel, &alpha_bits, mode_desc->n_alpha_bits);
+      select_param(&bld, sel, &endpoint_pbits, mode_desc->has_endpoint_pbits);
+      select_param(&bld, sel, &pbits, mode_desc->has_endpoint_pbits ||
+                                      mode_desc->has_shared_pbits);
+      select_param(&bld, sel, &index_bits, mode_desc->n_index_bits);
+      select_param(&bld, sel, &sec_index_bits,
+                   mode_desc->n_secondary_index_bits);
+   }
+
+   bit_offset = LLVMBuildAdd(builder, mode, bld.one, "");
+   partition = extract_bits(&bld, words, bit_offset, partition_bits);
+   bit_offset = LLVMBuildAdd(builder, bit_offset, partition_bits, "");
+   rotation = extract_bits(&bld, words, bit_offset, rotation_bits);
+   bit_offset = LLVMBuildAdd(builder, bit_offset, rotation_bits, "");
+   index_sel = extract_bits(&bld, words, bit_offset, index_sel_bits);
+   bit_offset = LLVMBuildAdd(builder, bit_offset, index_sel_bits, "");
+
+   texel = LLVMBuildShl(builder, j, C(2), "");
+   texel = LLVMBuildAdd(builder, texel, i, "");
+
+   is_two = lp_build_cmp(&bld, PIPE_FUNC_EQUAL, n_subsets, C(2));
+   is_three = lp_build_cmp(&bld, PIPE_FUNC_EQUAL, n_subsets, C(3));
+
+   tmp = LLVMBuildAnd(builder, is_three, C(N_PARTITIONS), "");
+   tmp = LLVMBuildAdd(builder, partition, tmp, "");
+   subset = lookup_partition(&bld, tmp);
+   tmp = LLVMBuildOr(builder, is_two, is_three, "");
+   subset = LLVMBuildAnd(builder, subset, tmp, "");
+   tmp = LLVMBuildShl(builder, texel, bld.one, "");
+   subset = LLVMBuildLShr(builder, subset, tmp, "");
+   subset = LLVMBuildAnd(builder, subset, C(3), "");
+
+   /*
+    * The endpoints are stored component by component, then come the alpha
+    * endpoints, and then the p-bits, one per endpoint or per subset.
+    */
+   num_endpoints = LLVMBuildShl(builder, n_subsets, bld.one, "");
+   endpoint = LLVMBuildShl(builder, subset, bld.one, "");
+   for (c = 0; c < 3; c++) {
+      for (e = 0; e < 2; e++) {
+         tmp = LLVMBuildMul(builder, num_endpoints, C(c), "");
+         tmp = LLVMBuildAdd(builder, tmp, endpoint, "");
+         tmp = LLVMBuildAdd(builder, tmp, C(e), "");
+         tmp = LLVMBuildMul(builder, tmp, color_bits, "");
+         tmp = LLVMBuildAdd(builder, bit_offset, tmp, "");
+         endpoints[e][c] = extract_bits(&bld, words, tmp, color_bits);
+      }
+   }
+   tmp = LLVMBuildMul(builder, num_endpoints, color_bits, "");
+   tmp = LLVMBuildMul(builder, tmp, C(3), "");
+   bit_offset = LLVMBuildAdd(builder, bit_offset, tmp, "");
+   for (e = 0; e < 2; e++) {
+      tmp = LLVMBuildAdd(builder, endpoint, C(e), "");
+      tmp = LLVMBuildMul(builder, tmp, alpha_bits, "");
+      tmp = LLVMBuildAdd(builder, bit_offset, tmp, "");
+      endpoints[e][3] = extract_bits(&bld, words, tmp, alpha_bits);
+   }
+   tmp = LLVMBuildMul(builder, num_endpoints, alpha_bits, "");
+   pbit_offset = LLVMBuildAdd(builder, bit_offset, tmp, "");
+
+   no_alpha = lp_build_cmp(&bld, PIPE_FUNC_EQUAL, alpha_bits, bld.zero);
+   color_n = LLVMBuildAdd(builder, color_bits, pbits, "");
+   alpha_n = LLVMBuildAdd(builder, alpha_bits, pbits, "");
+   alpha_n = lp_build_select(&bld, no_alpha, C(8), alpha_n);
+
+   for (e = 0; e < 2; e++) {
+      LLVMValueRef pbit;
+
+      tmp = LLVMBuildShl(builder, subset, endpoint_pbits, "");
+      if (e) {
+         tmp = LLVMBuildAdd(builder, tmp, endpoint_pbits, "");
+      }
+      tmp = LLVMBuildAdd(builder, pbit_offset, tmp, "");
+      pbit = extract_bits(&bld, words, tmp, pbits);
+
+      for (c = 0; c < 4; c++) {
+         tmp = LLVMBuildShl(builder, endpoints[e][c], pbits, "");
+         tmp = LLVMBuildOr(builder, tmp, pbit, "");
+         if (c == 3) {
+            tmp = lp_build_select(&bld, no_alpha, C(255), tmp);
+         }
+         endpoints[e][c] = expand_component(&bld, tmp,
+                                            c == 3 ? alpha_n : color_n);
+      }
+   }
+
+   /* the index data follows the p-bits */
+   tmp = LLVMBuildShl(builder, n_subsets, endpoint_pbits, "");
+   tmp = LLVMBuildMul(builder, tmp, pbits, "");
+   bit_offset = LLVMBuildAdd(builder, pbit_offset, tmp, "");
+
+   anchors_before_texel(&bld, texel, lookup_anchors(&bld, partition),
+                        is_two, is_three, &is_anchor, &num_before);
+   anchor_bit = LLVMBuildAnd(builder, is_anchor, bld.one, "");
+
+   tmp = LLVMBuildMul(builder, index_bits, texel, "");
+   tmp = LLVMBuildAdd(builder, bit_offset, tmp, "");
+   tmp = LLVMBuildSub(builder, tmp, num_before, "");
+   index = extract_bits(&bld, words, tmp,
+                        LLVMBuildSub(builder, index_bits, anchor_bit, ""));
+
+   tmp = LLVMBuildShl(builder, index_bits, C(4), "");
+   tmp = LLVMBuildAdd(builder, bit_offset, tmp, "");
+   tmp = LLVMBuildSub(builder, tmp, n_subsets, "");
+   tmp = LLVMBuildAdd(builder, tmp,
+                      LLVMBuildMul(builder, sec_index_bits, texel, ""), "");
+   bit_offset = LLVMBuildSub(builder, tmp, num_before, "");
+   use_sec = lp_build_cmp(&bld, PIPE_FUNC_NOTEQUAL, sec_index_bits, bld.zero);
+   tmp = LLVMBuildAnd(builder, anchor_bit, use_sec, "");
+   sec_index = extract_bits(&bld, words, bit_offset,
+                            LLVMBuildSub(builder, sec_index_bits, tmp, ""));
+
+   /* the index selection bit swaps the color and the alpha index */
+   tmp = lp_build_cmp(&bld, PIPE_FUNC_NOTEQUAL, index_sel, bld.zero);
+   color_index = lp_build_select(&bld, tmp, sec_index, index);
+   color_bits_sel = lp_build_select(&bld, tmp, sec_index_bits, index_bits);
+   use_sec = LLVMBuildAnd(builder, use_sec, LLVMBuildNot(builder, tmp, ""), "");
+   alpha_index = lp_build_select(&bld, use_sec, sec_index, index);
+   alpha_bits_sel = lp_build_select(&bld, use_sec, sec_index_bits, index_bits);
+
+   weight = lookup_weight(&bld, color_index, color_bits_sel);
+   for (c = 0; c < 3; c++) {
+      rgba[c] = interpolate(&bld, endpoints[0][c], endpoints[1][c], weight);
+   }
+   weight = lookup_weight(&bld, alpha_index, alpha_bits_sel);
+   rgba[3] = interpolate(&bld, endpoints[0][3], endpoints[1][3], weight);
+
+   /* rotation n swaps component n - 1 with alpha */
+   tmp = rgba[3];
+   for (c = 0; c < 3; c++) {
+      LLVMValueRef sel = lp_build_cmp(&bld, PIPE_FUNC_EQUAL, rotation,
+                                      C(c + 1));
+      rgba[3] = lp_build_select(&bld, sel, rgba[c], rgba[3]);
+      rgba[c] = lp_build_select(&bld, sel, tmp, rgba[c]);
+   }
+
+   res = rgba[0];
+   for (c = 1; c < 4; c++) {
+      tmp = LLVMBuildShl(builder, rgba[c], C(8 * c), "");
+      res = LLVMBuildOr(builder, res, tmp, "");
+   }
+
+   return lp_build_select(&bld, reserved, C(0xff000000), res);
+
+#undef C
+}
+
+
+/**
+ * Unquantize the n_bits bits BC6H endpoints to 16 bits (well, 15 bits plus
+ * sign for the signed formats).
+ */
+static LLVMValueRef
+unquantize_float(struct lp_build_context *bld,
+                 LLVMValueRef value,
+                 LLVMValueRef n_bits,
+                 boolean is_signed)
+{
+   struct gallivm_state *gallivm = bld->gallivm;
+   LLVMBuilderRef builder = gallivm->builder;
+   LLVMValueRef res, tmp, max, shift;
+
+#define C(v) lp_build_const_int_vec(gallivm, bld->type, v)
+
+   shift = LLVMBuildSub(builder, n_bits, bld->one, "");
+
+   if (is_signed) {
+      LLVMValueRef abs;
+
+      value = sign_extend(bld, value, n_bits);
+      abs = lp_build_abs(bld, value);
+
+      res = LLVMBuildShl(builder, abs, C(15), "");
+      res = LLVMBuildAdd(builder, res, C(0x4000), "");
+      res = LLVMBuildLShr(builder, res, shift, "");
+
+      max = LLVMBuildShl(builder, bld->one, shift, "");
+      max = LLVMBuildSub(builder, max, bld->one, "");
+      tmp = lp_build_cmp(bld, PIPE_FUNC_GEQUAL, abs, max);
+      res = lp_build_select(bld, tmp, C(0x7fff), res);
+
+      tmp = lp_build_cmp(bld, PIPE_FUNC_LESS, value, bld->zero);
+      res = lp_build_select(bld, tmp, LLVMBuildNeg(builder, res, ""), res);
+
+      tmp = lp_build_cmp(bld, PIPE_FUNC_GEQUAL, n_bits, C(16));
+   }
+   else {
+      res = LLVMBuildShl(builder, value, C(15), "");
+      res = LLVMBuildAdd(builder, res, C(0x4000), "");
+      res = LLVMBuildLShr(builder, res, shift, "");
+
+      max = LLVMBuildShl(builder, bld->one, n_bits, "");
+      max = LLVMBuildSub(builder, max, bld->one, "");
+      tmp = lp_build_cmp(bld, PIPE_FUNC_EQUAL, value, max);
+      res = lp_build_select(bld, tmp, C(0xffff), res);
+
+      tmp = lp_build_cmp(bld, PIPE_FUNC_GEQUAL, n_bits, C(15));
+   }
+
+   res = lp_build_select(bld, tmp, value, res);
+   tmp = lp_build_cmp(bld, PIPE_FUNC_EQUAL, value, bld->zero);
+   return lp_build_select(bld, tmp, bld->zero, res);
+
+#undef C
+}
+
+
+/**
+ * Decode BC6H texels.
+ * @param words  the four 32 bit words of each block
+ * @param rgb  returns the float rgb values
+ */
+static void
+decode_bc6h(struct gallivm_state *gallivm,
+            unsigned n,
+            boolean is_signed,
+            LLVMValueRef words[4],
+            LLVMValueRef i,
+            LLVMValueRef j,
+            LLVMValueRef rgb[3])
+{
+   LLVMBuilderRef builder = gallivm->builder;
+   struct lp_type type32 = lp_type_int_vec(32, 32 * n);
+   struct lp_build_context bld;
+   LLVMValueRef transformed = NULL, endpoint_bits = NULL, index_bits = NULL;
+   LLVMValueRef partition_bits = NULL, partition_offset = NULL;
+   LLVMValueRef delta_bits[3] = { NULL, NULL, NULL };
+   LLVMValueRef endpoints[4][3];
+   LLVMValueRef mode, reserved, tmp, sel;
+   LLVMValueRef partition, has_partition, subset, texel;
+   LLVMValueRef is_anchor, num_before, bit_offset, index, weight, mask;
+   unsigned m, e, c, k;
+
+   lp_build_context_init(&bld, gallivm, type32);
+
+#define C(v) lp_build_const_int_vec(gallivm, type32, v)
+
+   /* modes 0 and 1 have 2 mode bits, the others 5 */
+   tmp = LLVMBuildLShr(builder, words[0], bld.one, "");
+   tmp = LLVMBuildAnd(builder, tmp, C(0xe), "");
+   mode = LLVMBuildAnd(builder, words[0], bld.one, "");
+   mode = LLVMBuildOr(builder, mode, tmp, "");
+   mode = LLVMBuildAdd(builder, mode, C(2), "");
+   tmp = LLVMBuildAnd(builder, words[0], C(2), "");
+   tmp = lp_build_cmp(&bld, PIPE_FUNC_NOTEQUAL, tmp, bld.zero);
+   mode = lp_build_select(&bld, tmp, mode,
+                          LLVMBuildAnd(builder, words[0], C(3), ""));
+
+   /*
+    * The endpoint bits are scattered all over the block differently for
+    * every mode, so extract them for each mode and select the right one.
+    */
+   reserved = bld.zero;
+   for (m = 0; m < ARRAY_SIZE(bptc_float_modes); m++) {
+      const struct bptc_float_mode *mode_desc = &bptc_float_modes[m];
+      const struct bptc_float_bitfield *bitfield;
+      LLVMValueRef raw[4][3];
+      unsigned offset = m < 2 ? 2 : 5;
+
+      sel = m ? lp_build_cmp(&bld, PIPE_FUNC_EQUAL, mode, C(m)) : NULL;
+
+      if (mode_desc->reserved) {
+         reserved = LLVMBuildOr(builder, reserved, sel, "");
+         continue;
+      }
+
+      for (e = 0; e < 4; e++) {
+         for (c = 0; c < 3; c++) {
+            raw[e][c] = bld.zero;
+         }
+      }
+
+      for (bitfield = mode_desc->bitfields; bitfield->endpoint != -1;
+           bitfield++) {
+         LLVMValueRef *dst = &raw[bitfield->endpoint][bitfield->component];
+
+         if (bitfield->reverse) {
+            for (k = 0; k < bitfield->n_bits; k++) {
+               tmp = extract_const_bits(&bld, words, offset + k, 1);
+               tmp = LLVMBuildShl(builder, tmp,
+                                  C(bitfield->n_bits - 1 - k +
+                                    bitfield->offset), "");
+               *dst = LLVMBuildOr(builder, *dst, tmp, "");
+            }
+         }
+         else {
+            tmp = extract_const_bits(&bld, words, offset, bitfield->n_bits);
+            if (bitfield->offset) {
+               tmp = LLVMBuildShl(builder, tmp, C(bitfield->offset), "");
+            }
+            *dst = LLVMBuildOr(builder, *dst, tmp, "");
+         }
+         offset += bitfield->n_bits;
+      }
+
+      for (e = 0; e < 4; e++) {
+         for (c = 0; c < 3; c++) {
+            select_value(&bld, sel, &endpoints[e][c], raw[e][c]);
+         }
+      }
+      select_param(&bld, sel, &transformed, mode_desc->transformed_endpoints);
+      select_param(&bld, sel, &endpoint_bits, mode_desc->n_endpoint_bits);
+      for (c = 0; c < 3; c++) {
+         select_param(&bld, sel, &delta_bits[c], mode_desc->n_delta_bits[c]);
+      }
+      select_param(&bld, sel, &index_bits, mode_desc->n_index_bits);
+      select_param(&bld, sel, &partition_bits, mode_desc->n_partition_bits);
+      select_param(&bld, sel, &partition_offset, offset);
+   }
+
+   /* the other endpoints may be signed offsets from the first one */
+   transformed = lp_build_cmp(&bld, PIPE_FUNC_NOTEQUAL, transformed, bld.zero);
+   mask = LLVMBuildShl(builder, bld.one, endpoint_bits, "");
+   mask = LLVMBuildSub(builder, mask, bld.one, "");
+   for (e = 1; e < 4; e++) {
+      for (c = 0; c < 3; c++) {
+         tmp = sign_extend(&bld, endpoints[e][c], delta_bits[c]);
+         tmp = LLVMBuildAdd(builder, endpoints[0][c], tmp, "");
+         tmp = LLVMBuildAnd(builder, tmp, mask, "");
+         endpoints[e][c] = lp_build_select(&bld, transformed, tmp,
+                                           endpoints[e][c]);
+      }
+   }
+
+   for (e = 0; e < 4; e++) {
+      for (c = 0; c < 3; c++) {
+         endpoints[e][c] = unquantize_float(&bld, endpoints[e][c],
+                                            endpoint_bits, is_signed);
+      }
+   }
+
+   texel = LLVMBuildShl(builder, j, C(2), "");
+   texel = LLVMBuildAdd(builder, texel, i, "");
+
+   partition = extract_bits(&bld, words, partition_offset, partition_bits);
+   has_partition = lp_build_cmp(&bld, PIPE_FUNC_NOTEQUAL, partition_bits,
+                                bld.zero);
+   subset = lookup_partition(&bld, partition);
+   subset = LLVMBuildAnd(builder, subset, has_partition, "");
+   tmp = LLVMBuildShl(builder, texel, bld.one, "");
+   subset = LLVMBuildLShr(builder, subset, tmp, "");
+   subset = LLVMBuildAnd(builder, subset, bld.one, "");
+   subset = lp_build_cmp(&bld, PIPE_FUNC_NOTEQUAL, subset, bld.zero);
+
+   anchors_before_texel(&bld, texel, lookup_anchors(&bld, partition),
+                        has_partition, bld.zero, &is_anchor, &num_before);
+
+   bit_offset = LLVMBuildAdd(builder, partition_offset, partition_bits, "");
+   tmp = LLVMBuildMul(builder, index_bits, texel, "");
+   bit_offset = LLVMBuildAdd(builder, bit_offset, tmp, "");
+   bit_offset = LLVMBuildSub(builder, bit_offset, num_before, "");
+   tmp = LLVMBuildAnd(builder, is_anchor, bld.one, "");
+   index = extract_bits(&bld, words, bit_offset,
+                        LLVMBuildSub(builder, index_bits, tmp, ""));
+   weight = lookup_weight(&bld, index, index_bits);
+
+   for (c = 0; c < 3; c++) {
+      LLVMValueRef a, b, res;
+
+      a = lp_build_select(&bld, subset, endpoints[2][c], endpoints[0][c]);
+      b = lp_build_select(&bld, subset, endpoints[3][c], endpoints[1][c]);
+      res = interpolate(&bld, a, b, weight);
+
+      /* scale to the half float range */
+      if (is_signed) {
+         LLVMValueRef neg;
+
+         neg = lp_build_cmp(&bld, PIPE_FUNC_LESS, res, bld.zero);
+         tmp = lp_build_abs(&bld, res);
+         tmp = LLVMBuildMul(builder, tmp, C(31), "");
+         tmp = LLVMBuildLShr(builder, tmp, C(5), "");
+         res = LLVMBuildOr(builder, tmp,
+                           LLVMBuildAnd(builder, neg, C(0x8000), ""), "");
+      }
+      else {
+         res = LLVMBuildMul(builder, res, C(31), "");
+         res = LLVMBuildLShr(builder, res, C(6), "");
+      }
+      res = lp_build_select(&bld, reserved, bld.zero, res);
+
+      res = LLVMBuildTrunc(builder, res,
+                           lp_build_int_vec_type(gallivm,
+                                                 lp_type_int_vec(16, 16 * n)),
+                           "");
+      rgb[c] = lp_build_half_to_float(gallivm, res);
+   }
+
+#undef C
+}
+
+
+/**
+ * Get (or emit) the decode function of the format, which decodes n texels.
+ */
+static LLVMValueRef
+get_decode_function(struct gallivm_state *gallivm,
+                    enum pipe_format format,
+                    unsigned n)
+{
+   LLVMBuilderRef builder = gallivm->builder;
+   LLVMContextRef context = gallivm->context;
+   struct lp_type type32 = lp_type_int_vec(32, 32 * n);
+   LLVMTypeRef int_vec_type = lp_build_vec_type(gallivm, type32);
+   LLVMTypeRef float_vec_type =
+      lp_build_vec_type(gallivm, lp_type_float_vec(32, 32 * n));
+   LLVMTypeRef arg_types[4], ret_type, function_type;
+   LLVMValueRef function, args[4], words[4], offset, ret;
+   LLVMBasicBlockRef block, old_block;
+   boolean is_float = bptc_is_float(format);
+   boolean is_signed = format == PIPE_FORMAT_BPTC_RGB_FLOAT;
+   char name[64];
+   unsigned k;
+
+   util_snprintf(name, sizeof name, "bptc_decode_%s_%u",
+                 is_float ? (is_signed ? "float" : "ufloat") : "unorm", n);
+
+   function = LLVMGetNamedFunction(gallivm->module, name);
+   if (function) {
+      return function;
+   }
+
+   arg_types[0] = LLVMPointerType(LLVMInt8TypeInContext(context), 0);
+   arg_types[1] = int_vec_type;
+   arg_types[2] = int_vec_type;
+   arg_types[3] = int_vec_type;
+   if (is_float) {
+      LLVMTypeRef elem_types[3] = {
+         float_vec_type, float_vec_type, float_vec_type
+      };
+      ret_type = LLVMStructTypeInContext(context, elem_types, 3, 0);
+   }
+   else {
+      ret_type = int_vec_type;
+   }
+   function_type = LLVMFunctionType(ret_type, arg_types,
+                                    ARRAY_SIZE(arg_types), 0);
+   function = LLVMAddFunction(gallivm->module, name, function_type);
+   LLVMSetFunctionCallConv(function, LLVMFastCallConv);
+   LLVMSetLinkage(function, LLVMInternalLinkage);
+
+   for (k = 0; k < ARRAY_SIZE(args); k++) {
+      args[k] = LLVMGetParam(function, k);
+   }
+
+   old_block = LLVMGetInsertBlock(builder);
+   block = LLVMAppendBasicBlockInContext(context, function, "entry");
+   LLVMPositionBuilderAtEnd(builder, block);
+
+   for (k = 0; k < 4; k++) {
+      offset = LLVMBuildAdd(builder, args[1],
+                            lp_build_const_int_vec(gallivm, type32, 4 * k), "");
+      words[k] = lp_build_gather(gallivm, n, 32, lp_type_uint(32), FALSE,
+                                 args[0], offset, FALSE);
+   }
+
+   if (is_float) {
+      LLVMValueRef rgb[3];
+
+      decode_bc6h(gallivm, n, is_signed, words, args[2], args[3], rgb);
+      ret = LLVMGetUndef(ret_type);
+      for (k = 0; k < 3; k++) {
+         ret = LLVMBuildInsertValue(builder, ret, rgb[k], k, "");
+      }
+   }
+   else {
+      ret = decode_bc7(gallivm, n, words, args[2], args[3]);
+   }
+   LLVMBuildRet(builder, ret);
+
+   LLVMPositionBuilderAtEnd(builder, old_block);
+
+   gallivm_verify_function(gallivm, function);
+
+   return function;
+}
+
+
+static LLVMValueRef
+call_decode_function(struct gallivm_state *gallivm,
+                     enum pipe_format format,
+                     unsigned n,
+                     LLVMValueRef base_ptr,
+                     LLVMValueRef offset,
+                     LLVMValueRef i,
+                     LLVMValueRef j)
+{
+   LLVMBuilderRef builder = gallivm->builder;
+   LLVMValueRef args[4], ret;
+
+   args[0] = base_ptr;
+   args[1] = offset;
+   args[2] = i;
+   args[3] = j;
+   ret = LLVMBuildCall(builder, get_decode_function(gallivm, format, n),
+                       args, ARRAY_SIZE(args), "");
+   LLVMSetInstructionCallConv(ret, LLVMFastCallConv);
+
+   return ret;
+}
+
+
+/**
+ * Fetch n BC7 texels.
+ * Like with S3TC the sRGB formats return the encoded values.
+ * @return  <4n x i8> rgba8 values
+ */
+LLVMValueRef
+lp_build_fetch_bptc_rgba_aos(struct gallivm_state *gallivm,
+                             const struct util_format_description *format_desc,
+                             unsigned n,
+                             LLVMValueRef base_ptr,
+                             LLVMValueRef offset,
+                             LLVMValueRef i,
+                             LLVMValueRef j)
+{
+   LLVMValueRef rgba;
+
+   assert(format_desc->layout == UTIL_FORMAT_LAYOUT_BPTC);
+   assert(!bptc_is_float(format_desc->format));
+
+   rgba = call_decode_function(gallivm, format_desc->format, n,
+                               base_ptr, offset, i, j);
+
+   return LLVMBuildBitCast(gallivm->builder, rgba,
+                           lp_build_vec_type(gallivm,
+                                             lp_type_uint_vec(8, 32 * n)), "");
+}
+
+
+/**
+ * Fetch BC6H texels as SoA floats.
+ */
+void
+lp_build_fetch_bptc_rgba_soa(struct gallivm_state *gallivm,
+                             const struct util_format_description *format_desc,
+                             struct lp_type type,
+                             LLVMValueRef base_ptr,
+                             LLVMValueRef offset,
+                             LLVMValueRef i,
+                             LLVMValueRef j,
+                             LLVMValueRef rgba_out[4])
+{
+   LLVMBuilderRef builder = gallivm->builder;
+   struct lp_build_context bld;
+   LLVMValueRef rgb, rgba[4];
+   unsigned chan;
+
+   assert(format_desc->layout == UTIL_FORMAT_LAYOUT_BPTC);
+   assert(bptc_is_float(format_desc->format));
+   assert(type.floating && type.width == 32);
+
+   lp_build_context_init(&bld, gallivm, type);
+
+   rgb = call_decode_function(gallivm, format_desc->format, type.length,
+                              base_ptr, offset, i, j);
+   for (chan = 0; chan < 3; chan++) {
+      rgba[chan] = LLVMBuildExtractValue(builder, rgb, chan, "");
+   }
+   rgba[3] = bld.one;
+
+   for (chan = 0; chan < 4; chan++) {
+      rgba_out[chan] = lp_build_swizzle_soa_channel(&bld, rgba,
+                                                    format_desc->swizzle[chan]);
+   }
+}
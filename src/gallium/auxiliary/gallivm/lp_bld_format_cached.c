@@ -32,6 +32,7 @@
 #include "lp_bld_flow.h"
 #include "lp_bld_swizzle.h"
 
+#include "util/u_format.h"
 #include "util/u_math.h"
 
 
@@ -43,7 +44,9 @@
  * a small cache helps.
  * The elements in the cache are the decoded blocks - currently things
  * are restricted to formats which are 4x4 block based, and the decoded
- * texels must fit into 4x8 bits.
+ * texels must fit into 4x8 bits.  A miss decodes the whole block with a
+ * single call to the format's unpack_rgba_8unorm(), and the texels are
+ * stored in row major order.
  * The cache is direct mapped so hitrates aren't all that great and cache
  * thrashing could happen.
  *
@@ -155,37 +158,35 @@ update_cached_block(struct gallivm_state *gallivm,
    LLVMValueRef function;
    LLVMValueRef tag_value, tmp_ptr;
    LLVMValueRef col[4];
-   unsigned i, j;
-
-   /*
-    * Use format_desc->fetch_rgba_8unorm() for each pixel in the block.
-    * This doesn't actually make any sense whatsoever, someone would need
-    * to write a function doing this for all pixels in a block (either as
-    * an external c function or with generated code). Don't ask.
-    */
+   LLVMValueRef args[6];
+   unsigned i;
 
    {
       /*
        * Function to call looks like:
-       *   fetch(uint8_t *dst, const uint8_t *src, unsigned i, unsigned j)
+       *   unpack(uint8_t *dst, unsigned dst_stride,
+       *          const uint8_t *src, unsigned src_stride,
+       *          unsigned width, unsigned height)
        */
       LLVMTypeRef ret_type;
-      LLVMTypeRef arg_types[4];
+      LLVMTypeRef arg_types[6];
       LLVMTypeRef function_type;
 
-      assert(format_desc->fetch_rgba_8unorm);
+      assert(format_desc->unpack_rgba_8unorm);
 
       ret_type = LLVMVoidTypeInContext(gallivm->context);
       arg_types[0] = pi8t;
-      arg_types[1] = pi8t;
-      arg_types[2] = i32t;
+      arg_types[1] = i32t;
+      arg_types[2] = pi8t;
       arg_types[3] = i32t;
+      arg_types[4] = i32t;
+      arg_types[5] = i32t;
       function_type = LLVMFunctionType(ret_type, arg_types,
                                        ARRAY_SIZE(arg_types), 0);
 
-      /* make const pointer for the C fetch_rgba_8unorm function */
+      /* make const pointer for the C unpack_rgba_8unorm function */
       function = lp_build_const_int_pointer(gallivm,
-         func_to_pointer((func_pointer) format_desc->fetch_rgba_8unorm));
+         func_to_pointer((func_pointer) format_desc->unpack_rgba_8unorm));
 
       /* cast the callee pointer to the function's type */
       function = LLVMBuildBitCast(builder, function,
@@ -194,35 +195,24 @@ update_cached_block(struct gallivm_state *gallivm,
    }
 
    tmp_ptr = lp_build_array_alloca(gallivm, i32x4,
-                                   lp_build_const_int32(gallivm, 16),
+                                   lp_build_const_int32(gallivm, 4),
                                    "tmp_decode_store");
-   tmp_ptr = LLVMBuildBitCast(builder, tmp_ptr, pi8t, "");
 
    /*
-    * Invoke format_desc->fetch_rgba_8unorm() for each pixel.
-    * This is going to be really really slow.
-    * Note: the block store format is actually
-    * x0y0x0y1x0y2x0y3 x1y0x1y1x1y2x1y3 ...
+    * Decode the whole block, one row of 4 rgba8 texels per vector.
+    * Note we actually supply a pointer to the start of the block,
+    * not the start of the texture, the source stride is unused for a
+    * single row of blocks.
     */
-   for (i = 0; i < 4; ++i) {
-      for (j = 0; j < 4; ++j) {
-         LLVMValueRef args[4];
-         LLVMValueRef dst_offset = lp_build_const_int32(gallivm, (i * 4 + j) * 4);
-
-         /*
-          * Note we actually supply a pointer to the start of the block,
-          * not the start of the texture.
-          */
-         args[0] = LLVMBuildGEP(gallivm->builder, tmp_ptr, &dst_offset, 1, "");
-         args[1] = ptr_addr;
-         args[2] = LLVMConstInt(i32t, i, 0);
-         args[3] = LLVMConstInt(i32t, j, 0);
-         LLVMBuildCall(builder, function, args, ARRAY_SIZE(args), "");
-      }
-   }
+   args[0] = LLVMBuildBitCast(builder, tmp_ptr, pi8t, "");
+   args[1] = LLVMConstInt(i32t, 16, 0);
+   args[2] = ptr_addr;
+   args[3] = LLVMConstInt(i32t, 0, 0);
+   args[4] = LLVMConstInt(i32t, 4, 0);
+   args[5] = LLVMConstInt(i32t, 4, 0);
+   LLVMBuildCall(builder, function, args, ARRAY_SIZE(args), "");
 
    /* Finally store the block - pointless mem copy + update tag. */
-   tmp_ptr = LLVMBuildBitCast(builder, tmp_ptr, LLVMPointerType(i32x4, 0), "");
    for (i = 0; i < 4; ++i) {
       LLVMValueRef tmp_offset = lp_build_const_int32(gallivm, i);
       LLVMValueRef ptr = LLVMBuildGEP(gallivm->builder, tmp_ptr, &tmp_offset, 1, "");
@@ -235,6 +225,21 @@ update_cached_block(struct gallivm_state *gallivm,
 }
 
 
+/**
+ * Whether lp_build_fetch_cached_texels() can handle the format.
+ * RGTC, BPTC and ETC are decoded directly, see lp_bld_format_rgtc.c,
+ * lp_bld_format_bptc.c and lp_bld_format_etc.c.
+ */
+boolean
+lp_build_format_cache_supported(const struct util_format_description *format_desc)
+{
+   return format_desc->layout == UTIL_FORMAT_LAYOUT_S3TC &&
+          format_desc->block.width == 4 &&
+          format_desc->block.height == 4 &&
+          format_desc->unpack_rgba_8unorm != NULL;
+}
+
+
 /*
  * Do a cached lookup.
  *
@@ -302,8 +307,8 @@ lp_build_fetch_cached_texels(struct gallivm_state *gallivm,
 
    hash_mask = lp_build_const_int_vec(gallivm, type, LP_BUILD_FORMAT_CACHE_SIZE - 1);
    hash_index = LLVMBuildAnd(builder, hash_index, hash_mask, "");
-   ij_index = LLVMBuildShl(builder, i, lp_build_const_int_vec(gallivm, type, 2), "");
-   ij_index = LLVMBuildAdd(builder, ij_index, j, "");
+   ij_index = LLVMBuildShl(builder, j, lp_build_const_int_vec(gallivm, type, 2), "");
+   ij_index = LLVMBuildAdd(builder, ij_index, i, "");
    block_index = LLVMBuildShl(builder, hash_index,
                               lp_build_const_int_vec(gallivm, type, 4), "");
    block_index = LLVMBuildAdd(builder, ij_index, block_index, "");
@@ -0,0 +1,797 @@
+/**************************************************************************
+ *
+ * Copyright 2019 VMware, Inc.
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL VMWARE AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+
+/**
+ * @file
+ * ETC1, ETC2 and EAC texel fetch.
+ *
+ * Like RGTC every texel is decoded on its own for a whole vector of texels.
+ * All ETC2 block modes are decoded for every element and the right one is
+ * selected at the end.  The decoding matches etc1_fetch_texel() and the
+ * ETC2 fetch functions of texcompress_etc.c bit for bit.
+ */
+
+
+#include "util/u_format.h"
+#include "util/u_math.h"
+#include "util/u_string.h"
+
+#include "lp_bld_arit.h"
+#include "lp_bld_type.h"
+#include "lp_bld_const.h"
+#include "lp_bld_conv.h"
+#include "lp_bld_gather.h"
+#include "lp_bld_format.h"
+#include "lp_bld_init.h"
+#include "lp_bld_intr.h"
+#include "lp_bld_logic.h"
+#include "lp_bld_swizzle.h"
+
+
+static const int32_t
+etc1_modifier_tables[8][4] = {
+   {  2,   8,  -2,   -8},
+   {  5,  17,  -5,  -17},
+   {  9,  29,  -9,  -29},
+   { 13,  42, -13,  -42},
+   { 18,  60, -18,  -60},
+   { 24,  80, -24,  -80},
+   { 33, 106, -33, -106},
+   { 47, 183, -47, -183}
+};
+
+static const int32_t
+etc2_distance_table[8] = {
+   3, 6, 11, 16, 23, 32, 41, 64
+};
+
+static const int32_t
+etc2_modifier_tables[16][8] = {
+   {  -3,   -6,   -9,  -15,   2,   5,   8,   14},
+   {  -3,   -7,  -10,  -13,   2,   6,   9,   12},
+   {  -2,   -5,   -8,  -13,   1,   4,   7,   12},
+   {  -2,   -4,   -6,  -13,   1,   3,   5,   12},
+   {  -3,   -6,   -8,  -12,   2,   5,   7,   11},
+   {  -3,   -7,   -9,  -11,   2,   6,   8,   10},
+   {  -4,   -7,   -8,  -11,   3,   6,   7,   10},
+   {  -3,   -5,   -8,  -11,   2,   4,   7,   10},
+   {  -2,   -6,   -8,  -10,   1,   5,   7,    9},
+   {  -2,   -5,   -8,  -10,   1,   4,   7,    9},
+   {  -2,   -4,   -8,  -10,   1,   3,   7,    9},
+   {  -2,   -5,   -7,  -10,   1,   4,   6,    9},
+   {  -3,   -4,   -7,  -10,   2,   3,   6,    9},
+   {  -1,   -2,   -3,  -10,   0,   1,   2,    9},
+   {  -4,   -6,   -8,   -9,   3,   5,   7,    8},
+   {  -3,   -5,   -7,   -9,   2,   4,   6,    8},
+};
+
+
+static boolean
+etc_is_punchthrough(enum pipe_format format)
+{
+   return format == PIPE_FORMAT_ETC2_RGB8A1 ||
+          format == PIPE_FORMAT_ETC2_SRGB8A1;
+}
+
+
+static boolean
+etc_is_eac(enum pipe_format format)
+{
+   switch (format) {
+   case PIPE_FORMAT_ETC2_R11_UNORM:
+   case PIPE_FORMAT_ETC2_R11_SNORM:
+   case PIPE_FORMAT_ETC2_RG11_UNORM:
+   case PIPE_FORMAT_ETC2_RG11_SNORM:
+      return TRUE;
+   default:
+      return FALSE;
+   }
+}
+
+
+/**
+ * Look up a value of a constant table for every element.
+ * The table is emitted once per module as a global of the given name.
+ */
+static LLVMValueRef
+lookup_table(struct lp_build_context *bld,
+             const char *name,
+             const int32_t *values,
+             unsigned count,
+             LLVMValueRef index)
+{
+   struct gallivm_state *gallivm = bld->gallivm;
+   LLVMBuilderRef builder = gallivm->builder;
+   LLVMTypeRef int32_type = LLVMInt32TypeInContext(gallivm->context);
+   LLVMValueRef table, offsets;
+
+   table = LLVMGetNamedGlobal(gallivm->module, name);
+   if (!table) {
+      LLVMValueRef elems[16 * 8];
+      unsigned k;
+
+      assert(count <= ARRAY_SIZE(elems));
+      for (k = 0; k < count; k++) {
+         elems[k] = LLVMConstInt(int32_type, values[k], 1);
+      }
+      table = LLVMAddGlobal(gallivm->module,
+                            LLVMArrayType(int32_type, count), name);
+      LLVMSetGlobalConstant(table, TRUE);
+      LLVMSetLinkage(table, LLVMInternalLinkage);
+      LLVMSetInitializer(table, LLVMConstArray(int32_type, elems, count));
+   }
+
+   table = LLVMBuildBitCast(builder, table,
+                            LLVMPointerType(LLVMInt8TypeInContext(gallivm->context),
+                                            0), "");
+   offsets = LLVMBuildShl(builder, index,
+                          lp_build_const_int_vec(gallivm, bld->type, 2), "");
+   return lp_build_gather(gallivm, bld->type.length, 32, lp_type_uint(32),
+                          TRUE, table, offsets, FALSE);
+}
+
+
+/**
+ * Byte k of the 32 bit words.
+ */
+static LLVMValueRef
+get_byte(struct lp_build_context *bld,
+         LLVMValueRef word,
+         unsigned k)
+{
+   struct gallivm_state *gallivm = bld->gallivm;
+   LLVMBuilderRef builder = gallivm->builder;
+
+   if (k) {
+      word = LLVMBuildLShr(builder, word,
+                           lp_build_const_int_vec(gallivm, bld->type, 8 * k),
+                           "");
+   }
+   if (k < 3) {
+      word = LLVMBuildAnd(builder, word,
+                          lp_build_const_int_vec(gallivm, bld->type, 0xff), "");
+   }
+   return word;
+}
+
+
+/**
+ * Reverse the byte order, as the index bits are stored big endian.
+ */
+static LLVMValueRef
+byte_swap(struct gallivm_state *gallivm,
+          LLVMValueRef value)
+{
+   LLVMTypeRef type = LLVMTypeOf(value);
+   char intrinsic[32];
+
+   lp_format_intrinsic(intrinsic, sizeof intrinsic, "llvm.bswap", type);
+   return lp_build_intrinsic_unary(gallivm->builder, intrinsic, type, value);
+}
+
+
+/**
+ * (value >> shift) & mask
+ */
+static LLVMValueRef
+get_field(struct lp_build_context *bld,
+          LLVMValueRef value,
+          unsigned shift,
+          unsigned mask)
+{
+   struct gallivm_state *gallivm = bld->gallivm;
+   LLVMBuilderRef builder = gallivm->builder;
+
+   if (shift) {
+      value = LLVMBuildLShr(builder, value,
+                            lp_build_const_int_vec(gallivm, bld->type, shift),
+                            "");
+   }
+   return LLVMBuildAnd(builder, value,
+                       lp_build_const_int_vec(gallivm, bld->type, mask), "");
+}
+
+
+/**
+ * Sign extend the low 3 bits, the lookup[] of the differential colors.
+ */
+static LLVMValueRef
+sign_extend_3(struct lp_build_context *bld,
+              LLVMValueRef value)
+{
+   struct gallivm_state *gallivm = bld->gallivm;
+   LLVMBuilderRef builder = gallivm->builder;
+   LLVMValueRef shift = lp_build_const_int_vec(gallivm, bld->type, 29);
+
+   value = LLVMBuildShl(builder, value, shift, "");
+   return LLVMBuildAShr(builder, value, shift, "");
+}
+
+
+/**
+ * Expand 4 bit values to 8 bits.
+ */
+static LLVMValueRef
+extend_4to8(struct lp_build_context *bld,
+            LLVMValueRef value)
+{
+   LLVMBuilderRef builder = bld->gallivm->builder;
+   LLVMValueRef tmp;
+
+   tmp = LLVMBuildShl(builder, value,
+                      lp_build_const_int_vec(bld->gallivm, bld->type, 4), "");
+   return LLVMBuildOr(builder, tmp, value, "");
+}
+
+
+/**
+ * Expand the 6 or 7 bit planar mode values to 8 bits.
+ */
+static LLVMValueRef
+extend_planar(struct lp_build_context *bld,
+              LLVMValueRef value,
+              unsigned n_bits)
+{
+   struct gallivm_state *gallivm = bld->gallivm;
+   LLVMBuilderRef builder = gallivm->builder;
+   LLVMValueRef tmp;
+
+   tmp = LLVMBuildShl(builder, value,
+                      lp_build_const_int_vec(gallivm, bld->type, 8 - n_bits),
+                      "");
+   value = LLVMBuildLShr(builder, value,
+                         lp_build_const_int_vec(gallivm, bld->type,
+                                                2 * n_bits - 8), "");
+   return LLVMBuildOr(builder, tmp, value, "");
+}
+
+
+/**
+ * Is value outside of 0..31, i.e. do the differential colors overflow.
+ */
+static LLVMValueRef
+overflows(struct lp_build_context *bld,
+          LLVMValueRef value)
+{
+   struct gallivm_state *gallivm = bld->gallivm;
+
+   value = LLVMBuildAnd(gallivm->builder, value,
+                        lp_build_const_int_vec(gallivm, bld->type, ~31), "");
+   return lp_build_cmp(bld, PIPE_FUNC_NOTEQUAL, value, bld->zero);
+}
+
+
+/**
+ * Decode ETC1 or ETC2 RGB (with punchthrough alpha) 64 bit blocks.
+ * @param lo, hi  the two 32 bit words of each block
+ * @param i, j  <n x i32> texel coordinates within the block
+ * @return  <n x i32> packed rgba8 values
+ */
+static LLVMValueRef
+decode_etc_rgb(struct gallivm_state *gallivm,
+               enum pipe_format format,
+               unsigned n,
+               LLVMValueRef lo,
+               LLVMValueRef hi,
+               LLVMValueRef i,
+               LLVMValueRef j)
+{
+   LLVMBuilderRef builder = gallivm->builder;
+   struct lp_type type32 = lp_type_int_vec(32, 32 * n);
+   struct lp_build_context bld;
+   boolean is_etc2 = format != PIPE_FORMAT_ETC1_RGB8;
+   boolean punchthrough = etc_is_punchthrough(format);
+   LLVMValueRef src[4], pixel_indices, bit, idx, tmp;
+   LLVMValueRef diff, opaque, blk, table, modifier;
+   LLVMValueRef t_mode, h_mode, planar_mode, use_c1, distance, delta;
+   LLVMValueRef rgba[4], res;
+   unsigned c;
+
+   lp_build_context_init(&bld, gallivm, type32);
+
+#define C(v) lp_build_const_int_vec(gallivm, type32, v)
+
+   for (c = 0; c < 4; c++) {
+      src[c] = get_byte(&bld, lo, c);
+   }
+   pixel_indices = byte_swap(gallivm, hi);
+
+   /* idx = ((pixel_indices >> (15 + bit)) & 2) | ((pixel_indices >> bit) & 1) */
+   bit = LLVMBuildShl(builder, i, C(2), "");
+   bit = LLVMBuildAdd(builder, bit, j, "");
+   tmp = LLVMBuildLShr(builder, pixel_indices, bit, "");
+   idx = LLVMBuildAnd(builder, tmp, bld.one, "");
+   tmp = LLVMBuildLShr(builder, tmp, C(15), "");
+   tmp = LLVMBuildAnd(builder, tmp, C(2), "");
+   idx = LLVMBuildOr(builder, idx, tmp, "");
+
+   diff = LLVMBuildAnd(builder, src[3], C(2), "");
+   diff = lp_build_cmp(&bld, PIPE_FUNC_NOTEQUAL, diff, bld.zero);
+   if (punchthrough) {
+      /* there is no individual mode, the bit is the opaque bit instead */
+      opaque = diff;
+      diff = lp_build_const_int_vec(gallivm, type32, -1);
+   }
+   else {
+      opaque = lp_build_const_int_vec(gallivm, type32, -1);
+   }
+
+   /*
+    * Individual and differential modes, these are all ETC1 has.
+    */
+   tmp = LLVMBuildAnd(builder, src[3], bld.one, "");
+   tmp = lp_build_cmp(&bld, PIPE_FUNC_NOTEQUAL, tmp, bld.zero);
+   blk = lp_build_select(&bld, tmp, j, i);
+   blk = lp_build_cmp(&bld, PIPE_FUNC_GEQUAL, blk, C(2));
+   table = lp_build_select(&bld, blk, get_field(&bld, src[3], 2, 7),
+                           get_field(&bld, src[3], 5, 7));
+   tmp = LLVMBuildShl(builder, table, C(2), "");
+   tmp = LLVMBuildOr(builder, tmp, idx, "");
+   modifier = lookup_table(&bld, "etc1_modifiers",
+                           &etc1_modifier_tables[0][0], 8 * 4, tmp);
+   if (punchthrough) {
+      /* non-opaque blocks use zero for indices 0 and 2 */
+      tmp = LLVMBuildAnd(builder, idx, bld.one, "");
+      tmp = LLVMBuildOr(builder, LLVMBuildNeg(builder, tmp, ""), opaque, "");
+      modifier = LLVMBuildAnd(builder, modifier, tmp, "");
+   }
+
+   for (c = 0; c < 3; c++) {
+      LLVMValueRef hi_color, lo_color, ind, base;
+
+      /* differential: 5 bit base plus 3 bit signed delta */
+      hi_color = LLVMBuildAnd(builder, src[c], C(0xf8), "");
+      hi_color = LLVMBuildOr(builder, hi_color,
+                             LLVMBuildLShr(builder, src[c], C(5), ""), "");
+      lo_color = LLVMBuildLShr(builder, src[c], C(3), "");
+      lo_color = LLVMBuildAdd(builder, lo_color, sign_extend_3(&bld, src[c]),
+                              "");
+      lo_color = LLVMBuildAnd(builder, lo_color, C(0xff), "");
+      tmp = LLVMBuildShl(builder, lo_color, C(3), "");
+      lo_color = LLVMBuildLShr(builder, lo_color, C(2), "");
+      lo_color = LLVMBuildOr(builder, lo_color, tmp, "");
+      lo_color = LLVMBuildAnd(builder, lo_color, C(0xff), "");
+      base = lp_build_select(&bld, blk, lo_color, hi_color);
+
+      /* individual: two 4 bit colors */
+      hi_color = extend_4to8(&bld, get_field(&bld, src[c], 4, 0xf));
+      lo_color = extend_4to8(&bld, get_field(&bld, src[c], 0, 0xf));
+      ind = lp_build_select(&bld, blk, lo_color, hi_color);
+
+      base = lp_build_select(&bld, diff, base, ind);
+      rgba[c] = LLVMBuildAdd(builder, base, modifier, "");
+   }
+
+   if (is_etc2) {
+      LLVMValueRef c1[3], c2[3], o[3], h[3], v[3];
+      LLVMValueRef overflow_r, overflow_g, overflow_b, odd;
+
+      /* T, H and planar blocks are differential blocks whose colors overflow */
+      tmp = LLVMBuildLShr(builder, src[0], C(3), "");
+      tmp = LLVMBuildAdd(builder, tmp, sign_extend_3(&bld, src[0]), "");
+      overflow_r = overflows(&bld, tmp);
+      tmp = LLVMBuildLShr(builder, src[1], C(3), "");
+      tmp = LLVMBuildAdd(builder, tmp, sign_extend_3(&bld, src[1]), "");
+      overflow_g = overflows(&bld, tmp);
+      tmp = LLVMBuildLShr(builder, src[2], C(3), "");
+      tmp = LLVMBuildAdd(builder, tmp, sign_extend_3(&bld, src[2]), "");
+      overflow_b = overflows(&bld, tmp);
+
+      t_mode = LLVMBuildAnd(builder, diff, overflow_r, "");
+      tmp = LLVMBuildNot(builder, overflow_r, "");
+      h_mode = LLVMBuildAnd(builder, diff, tmp, "");
+      planar_mode = LLVMBuildAnd(builder, h_mode,
+                                 LLVMBuildNot(builder, overflow_g, ""), "");
+      planar_mode = LLVMBuildAnd(builder, planar_mode, overflow_b, "");
+      h_mode = LLVMBuildAnd(builder, h_mode, overflow_g, "");
+
+      /*
+       * T and H modes: two 4 bit base colors, paint colors are chosen by
+       * the index and offset by a distance.
+       */
+      tmp = get_field(&bld, src[0], 1, 0xc);
+      tmp = LLVMBuildOr(builder, tmp, get_field(&bld, src[0], 0, 3), "");
+      c1[0] = lp_build_select(&bld, t_mode, tmp, get_field(&bld, src[0], 3, 0xf));
+      tmp = LLVMBuildShl(builder, get_field(&bld, src[0], 0, 7), bld.one, "");
+      tmp = LLVMBuildOr(builder, tmp, get_field(&bld, src[1], 4, 1), "");
+      c1[1] = lp_build_select(&bld, t_mode, get_field(&bld, src[1], 4, 0xf),
+                              tmp);
+      tmp = LLVMBuildAnd(builder, src[1], C(8), "");
+      tmp = LLVMBuildOr(builder, tmp,
+                        LLVMBuildShl(builder, get_field(&bld, src[1], 0, 3),
+                                     bld.one, ""), "");
+      tmp = LLVMBuildOr(builder, tmp, get_field(&bld, src[2], 7, 1), "");
+      c1[2] = lp_build_select(&bld, t_mode, get_field(&bld, src[1], 0, 0xf),
+                              tmp);
+
+      c2[0] = lp_build_select(&bld, t_mode, get_field(&bld, src[2], 4, 0xf),
+                              get_field(&bld, src[2], 3, 0xf));
+      tmp = LLVMBuildShl(builder, get_field(&bld, src[2], 0, 7), bld.one, "");
+      tmp = LLVMBuildOr(builder, tmp, get_field(&bld, src[3], 7, 1), "");
+      c2[1] = lp_build_select(&bld, t_mode, get_field(&bld, src[2], 0, 0xf),
+                              tmp);
+      c2[2] = lp_build_select(&bld, t_mode, get_field(&bld, src[3], 4, 0xf),
+                              get_field(&bld, src[3], 3, 0xf));
+
+      for (c = 0; c < 3; c++) {
+         c1[c] = extend_4to8(&bld, c1[c]);
+         c2[c] = extend_4to8(&bld, c2[c]);
+      }
+
+      /* T: ((src3 >> 2) & 3) << 1 | (src3 & 1),
+       * H: (src3 & 4) | (src3 & 1) << 1 | (c1 >= c2) */
+      tmp = LLVMBuildAnd(builder, src[3], bld.one, "");
+      tmp = LLVMBuildShl(builder, tmp, bld.one, "");
+      tmp = LLVMBuildOr(builder, tmp, LLVMBuildAnd(builder, src[3], C(4), ""),
+                        "");
+      {
+         LLVMValueRef value1, value2, ge;
+
+         value1 = LLVMBuildShl(builder, c1[0], C(16), "");
+         value1 = LLVMBuildOr(builder, value1,
+                              LLVMBuildShl(builder, c1[1], C(8), ""), "");
+         value1 = LLVMBuildOr(builder, value1, c1[2], "");
+         value2 = LLVMBuildShl(builder, c2[0], C(16), "");
+         value2 = LLVMBuildOr(builder, value2,
+                              LLVMBuildShl(builder, c2[1], C(8), ""), "");
+         value2 = LLVMBuildOr(builder, value2, c2[2], "");
+         ge = lp_build_cmp(&bld, PIPE_FUNC_GEQUAL, value1, value2);
+         tmp = LLVMBuildOr(builder, tmp,
+                           LLVMBuildAnd(builder, ge, bld.one, ""), "");
+      }
+      distance = get_field(&bld, src[3], 1, 6);
+      distance = LLVMBuildOr(builder, distance,
+                             LLVMBuildAnd(builder, src[3], bld.one, ""), "");
+      distance = lp_build_select(&bld, t_mode, distance, tmp);
+      distance = lookup_table(&bld, "etc2_distances", etc2_distance_table,
+                              ARRAY_SIZE(etc2_distance_table), distance);
+
+      /* T: c1, c2 + d, c2, c2 - d,  H: c1 + d, c1 - d, c2 + d, c2 - d */
+      tmp = lp_build_cmp(&bld, PIPE_FUNC_EQUAL, idx, bld.zero);
+      use_c1 = lp_build_cmp(&bld, PIPE_FUNC_LESS, idx, C(2));
+      use_c1 = lp_build_select(&bld, t_mode, tmp, use_c1);
+      odd = LLVMBuildAnd(builder, idx, bld.one, "");
+      odd = lp_build_cmp(&bld, PIPE_FUNC_NOTEQUAL, odd, bld.zero);
+      delta = lp_build_select(&bld, odd, LLVMBuildNeg(builder, distance, ""),
+                              distance);
+      tmp = lp_build_cmp(&bld, PIPE_FUNC_EQUAL, idx, bld.one);
+      tmp = lp_build_select(&bld, tmp, distance,
+                            LLVMBuildNeg(builder, distance, ""));
+      tmp = lp_build_select(&bld, odd, tmp, bld.zero);
+      delta = lp_build_select(&bld, t_mode, tmp, delta);
+
+      /*
+       * Planar mode: three 6/7/6 bit colors, interpolated.
+       */
+      o[0] = get_field(&bld, src[0], 1, 0x3f);
+      o[1] = LLVMBuildShl(builder, get_field(&bld, src[0], 0, 1), C(6), "");
+      o[1] = LLVMBuildOr(builder, o[1], get_field(&bld, src[1], 1, 0x3f), "");
+      o[2] = LLVMBuildShl(builder, get_field(&bld, src[1], 0, 1), C(5), "");
+      o[2] = LLVMBuildOr(builder, o[2], LLVMBuildAnd(builder, src[2], C(0x18), ""),
+                         "");
+      tmp = LLVMBuildShl(builder, get_field(&bld, src[2], 0, 3), bld.one, "");
+      o[2] = LLVMBuildOr(builder, o[2], tmp, "");
+      o[2] = LLVMBuildOr(builder, o[2], get_field(&bld, src[3], 7, 1), "");
+
+      h[0] = get_field(&bld, src[3], 1, 0x3e);
+      h[0] = LLVMBuildOr(builder, h[0], get_field(&bld, src[3], 0, 1), "");
+      h[1] = get_field(&bld, hi, 1, 0x7f);
+      h[2] = LLVMBuildShl(builder, get_field(&bld, hi, 0, 1), C(5), "");
+      h[2] = LLVMBuildOr(builder, h[2], get_field(&bld, hi, 11, 0x1f), "");
+
+      v[0] = LLVMBuildShl(builder, get_field(&bld, hi, 8, 7), C(3), "");
+      v[0] = LLVMBuildOr(builder, v[0], get_field(&bld, hi, 21, 7), "");
+      v[1] = LLVMBuildShl(builder, get_field(&bld, hi, 16, 0x1f), C(2), "");
+      v[1] = LLVMBuildOr(builder, v[1], get_field(&bld, hi, 30, 3), "");
+      v[2] = get_field(&bld, hi, 24, 0x3f);
+
+      for (c = 0; c < 3; c++) {
+         unsigned n_bits = c == 1 ? 7 : 6;
+         LLVMValueRef paint, planar;
+
+         o[c] = extend_planar(&bld, o[c], n_bits);
+         h[c] = extend_planar(&bld, h[c], n_bits);
+         v[c] = extend_planar(&bld, v[c], n_bits);
+
+         /* (i * (H - O) + j * (V - O) + 4 * O + 2) >> 2 */
+         tmp = LLVMBuildSub(builder, h[c], o[c], "");
+         planar = LLVMBuildMul(builder, i, tmp, "");
+         tmp = LLVMBuildSub(builder, v[c], o[c], "");
+         tmp = LLVMBuildMul(builder, j, tmp, "");
+         planar = LLVMBuildAdd(builder, planar, tmp, "");
+         tmp = LLVMBuildShl(builder, o[c], C(2), "");
+         planar = LLVMBuildAdd(builder, planar, tmp, "");
+         planar = LLVMBuildAdd(builder, planar, C(2), "");
+         planar = LLVMBuildAShr(builder, planar, C(2), "");
+
+         paint = lp_build_select(&bld, use_c1, c1[c], c2[c]);
+         paint = LLVMBuildAdd(builder, paint, delta, "");
+
+         tmp = LLVMBuildOr(builder, t_mode, h_mode, "");
+         rgba[c] = lp_build_select(&bld, tmp, paint, rgba[c]);
+         rgba[c] = lp_build_select(&bld, planar_mode, planar, rgba[c]);
+      }
+
+      /* the planar mode is always opaque */
+      opaque = LLVMBuildOr(builder, opaque, planar_mode, "");
+   }
+
+   res = C(0xff000000);
+   for (c = 0; c < 3; c++) {
+      tmp = lp_build_clamp(&bld, rgba[c], bld.zero, C(255));
+      if (c) {
+         tmp = LLVMBuildShl(builder, tmp, C(8 * c), "");
+      }
+      res = LLVMBuildOr(builder, res, tmp, "");
+   }
+
+   if (punchthrough) {
+      /* index 2 of non-opaque blocks is transparent black */
+      tmp = lp_build_cmp(&bld, PIPE_FUNC_EQUAL, idx, C(2));
+      tmp = LLVMBuildAnd(builder, tmp, LLVMBuildNot(builder, opaque, ""), "");
+      res = lp_build_select(&bld, tmp, bld.zero, res);
+   }
+
+   return res;
+
+#undef C
+}
+
+
+enum eac_kind {
+   EAC_ALPHA8,
+   EAC_R11_UNORM,
+   EAC_R11_SNORM
+};
+
+
+/**
+ * Decode EAC 64 bit blocks, the alpha of ETC2 RGBA8 or a channel of the
+ * R11 and RG11 formats.
+ * @param lo, hi  the two 32 bit words of each block
+ * @return  <n x i32> decoded values, 0..255 for alpha, 0..65535 or
+ *          -32767..32767 for the unorm or snorm 11 bit formats
+ */
+static LLVMValueRef
+decode_eac(struct gallivm_state *gallivm,
+           enum eac_kind kind,
+           unsigned n,
+           LLVMValueRef lo,
+           LLVMValueRef hi,
+           LLVMValueRef i,
+           LLVMValueRef j)
+{
+   LLVMBuilderRef builder = gallivm->builder;
+   struct lp_type type32 = lp_type_int_vec(32, 32 * n);
+   struct lp_type type64 = lp_type_int_vec(64, 64 * n);
+   LLVMTypeRef vec_type64 = lp_build_vec_type(gallivm, type64);
+   struct lp_build_context bld;
+   LLVMValueRef base, multiplier, table, bits, bit, idx, modifier;
+   LLVMValueRef res, tmp;
+
+   lp_build_context_init(&bld, gallivm, type32);
+
+#define C(v) lp_build_const_int_vec(gallivm, type32, v)
+
+   base = get_field(&bld, lo, 0, 0xff);
+   table = get_field(&bld, lo, 8, 0xf);
+   multiplier = get_field(&bld, lo, 12, 0xf);
+
+   /* bytes 2-7 are the 48 bit big endian index stream */
+   bits = LLVMBuildZExt(builder, lo, vec_type64, "");
+   tmp = LLVMBuildZExt(builder, hi, vec_type64, "");
+   tmp = LLVMBuildShl(builder, tmp,
+                      lp_build_const_int_vec(gallivm, type64, 32), "");
+   bits = byte_swap(gallivm, LLVMBuildOr(builder, bits, tmp, ""));
+
+   /* bit = ((3 - j) + (3 - i) * 4) * 3 */
+   bit = LLVMBuildShl(builder, i, C(2), "");
+   bit = LLVMBuildAdd(builder, bit, j, "");
+   bit = LLVMBuildSub(builder, C(15), bit, "");
+   bit = LLVMBuildMul(builder, bit, C(3), "");
+   bit = LLVMBuildZExt(builder, bit, vec_type64, "");
+   idx = LLVMBuildLShr(builder, bits, bit, "");
+   idx = LLVMBuildTrunc(builder, idx, bld.vec_type, "");
+   idx = LLVMBuildAnd(builder, idx, C(7), "");
+
+   tmp = LLVMBuildShl(builder, table, C(3), "");
+   tmp = LLVMBuildOr(builder, tmp, idx, "");
+   modifier = lookup_table(&bld, "etc2_modifiers",
+                           &etc2_modifier_tables[0][0], 16 * 8, tmp);
+
+   if (kind == EAC_ALPHA8) {
+      res = LLVMBuildMul(builder, modifier, multiplier, "");
+      res = LLVMBuildAdd(builder, base, res, "");
+      return lp_build_clamp(&bld, res, bld.zero, C(255));
+   }
+
+   /* base * 8 + modifier * multiplier * 8, or modifier if multiplier is 0 */
+   tmp = LLVMBuildMul(builder, modifier, multiplier, "");
+   tmp = LLVMBuildShl(builder, tmp, C(3), "");
+   modifier = lp_build_select(&bld,
+                              lp_build_cmp(&bld, PIPE_FUNC_EQUAL, multiplier,
+                                           bld.zero),
+                              modifier, tmp);
+
+   if (kind == EAC_R11_UNORM) {
+      res = LLVMBuildShl(builder, base, C(3), "");
+      res = LLVMBuildOr(builder, res, C(4), "");
+      res = LLVMBuildAdd(builder, res, modifier, "");
+      res = lp_build_clamp(&bld, res, bld.zero, C(2047));
+
+      /* extend to 16 bits */
+      tmp = LLVMBuildShl(builder, res, C(5), "");
+      res = LLVMBuildLShr(builder, res, C(6), "");
+      return LLVMBuildOr(builder, res, tmp, "");
+   }
+   else {
+      LLVMValueRef abs, neg;
+
+      /* -128 is treated as -127 */
+      base = LLVMBuildShl(builder, base, C(24), "");
+      base = LLVMBuildAShr(builder, base, C(24), "");
+      base = lp_build_max(&bld, base, C(-127));
+
+      res = LLVMBuildShl(builder, base, C(3), "");
+      res = LLVMBuildAdd(builder, res, modifier, "");
+      res = lp_build_clamp(&bld, res, C(-1023), C(1023));
+
+      /* extend the magnitude to 15 bits */
+      neg = lp_build_cmp(&bld, PIPE_FUNC_LESS, res, bld.zero);
+      abs = lp_build_abs(&bld, res);
+      tmp = LLVMBuildShl(builder, abs, C(5), "");
+      abs = LLVMBuildLShr(builder, abs, C(5), "");
+      abs = LLVMBuildOr(builder, abs, tmp, "");
+      return lp_build_select(&bld, neg, LLVMBuildNeg(builder, abs, ""), abs);
+   }
+
+#undef C
+}
+
+
+/**
+ * Load the two 32 bit words of the 64 bit blocks at offset + block_offset.
+ */
+static void
+load_block(struct gallivm_state *gallivm,
+           unsigned n,
+           LLVMValueRef base_ptr,
+           LLVMValueRef offset,
+           unsigned block_offset,
+           LLVMValueRef *lo,
+           LLVMValueRef *hi)
+{
+   struct lp_type type32 = lp_type_int_vec(32, 32 * n);
+   LLVMValueRef tmp;
+
+   tmp = LLVMBuildAdd(gallivm->builder, offset,
+                      lp_build_const_int_vec(gallivm, type32, block_offset), "");
+   *lo = lp_build_gather(gallivm, n, 32, lp_type_uint(32), FALSE,
+                         base_ptr, tmp, FALSE);
+   tmp = LLVMBuildAdd(gallivm->builder, offset,
+                      lp_build_const_int_vec(gallivm, type32,
+                                             block_offset + 4), "");
+   *hi = lp_build_gather(gallivm, n, 32, lp_type_uint(32), FALSE,
+                         base_ptr, tmp, FALSE);
+}
+
+
+/**
+ * Fetch texels of an ETC2 R11 or RG11 format as SoA floats.
+ * @param type  float32 vector type, offset, i and j have its length
+ */
+void
+lp_build_fetch_etc_rgba_soa(struct gallivm_state *gallivm,
+                            const struct util_format_description *format_desc,
+                            struct lp_type type,
+                            LLVMValueRef base_ptr,
+                            LLVMValueRef offset,
+                            LLVMValueRef i,
+                            LLVMValueRef j,
+                            LLVMValueRef rgba_out[4])
+{
+   LLVMBuilderRef builder = gallivm->builder;
+   struct lp_build_context bld;
+   boolean is_signed = format_desc->format == PIPE_FORMAT_ETC2_R11_SNORM ||
+                       format_desc->format == PIPE_FORMAT_ETC2_RG11_SNORM;
+   unsigned num_chans = format_desc->block.bits / 64;
+   LLVMValueRef rgba[4], lo, hi, tmp;
+   unsigned chan;
+
+   assert(etc_is_eac(format_desc->format));
+   assert(type.floating && type.width == 32);
+
+   lp_build_context_init(&bld, gallivm, type);
+
+   for (chan = 0; chan < 4; chan++) {
+      if (chan >= num_chans) {
+         rgba[chan] = chan == 3 ? bld.one : bld.zero;
+         continue;
+      }
+
+      load_block(gallivm, type.length, base_ptr, offset, 8 * chan, &lo, &hi);
+      tmp = decode_eac(gallivm, is_signed ? EAC_R11_SNORM : EAC_R11_UNORM,
+                       type.length, lo, hi, i, j);
+      tmp = LLVMBuildSIToFP(builder, tmp, bld.vec_type, "");
+      rgba[chan] = LLVMBuildFDiv(builder, tmp,
+                                 lp_build_const_vec(gallivm, type,
+                                                    is_signed ? 32767.0 :
+                                                                65535.0), "");
+   }
+
+   for (chan = 0; chan < 4; chan++) {
+      rgba_out[chan] = lp_build_swizzle_soa_channel(&bld, rgba,
+                                                    format_desc->swizzle[chan]);
+   }
+}
+
+
+/**
+ * Fetch texels of an ETC1 or ETC2 RGB, RGB8A1 or RGBA8 format as packed
+ * rgba8.  Like with S3TC the sRGB formats return the encoded values.
+ * @return  <4n x i8> vector
+ */
+LLVMValueRef
+lp_build_fetch_etc_rgba_aos(struct gallivm_state *gallivm,
+                            const struct util_format_description *format_desc,
+                            unsigned n,
+                            LLVMValueRef base_ptr,
+                            LLVMValueRef offset,
+                            LLVMValueRef i,
+                            LLVMValueRef j)
+{
+   LLVMBuilderRef builder = gallivm->builder;
+   struct lp_type type32 = lp_type_int_vec(32, 32 * n);
+   enum pipe_format format = format_desc->format;
+   LLVMValueRef lo, hi, res, alpha;
+
+   assert(format_desc->layout == UTIL_FORMAT_LAYOUT_ETC);
+   assert(!etc_is_eac(format));
+
+   if (format_desc->block.bits == 128) {
+      /* the EAC alpha block comes first */
+      load_block(gallivm, n, base_ptr, offset, 8, &lo, &hi);
+      res = decode_etc_rgb(gallivm, format, n, lo, hi, i, j);
+      res = LLVMBuildAnd(builder, res,
+                         lp_build_const_int_vec(gallivm, type32, 0xffffff), "");
+
+      load_block(gallivm, n, base_ptr, offset, 0, &lo, &hi);
+      alpha = decode_eac(gallivm, EAC_ALPHA8, n, lo, hi, i, j);
+      alpha = LLVMBuildShl(builder, alpha,
+                           lp_build_const_int_vec(gallivm, type32, 24), "");
+      res = LLVMBuildOr(builder, res, alpha, "");
+   }
+   else {
+      load_block(gallivm, n, base_ptr, offset, 0, &lo, &hi);
+      res = decode_etc_rgb(gallivm, format, n, lo, hi, i, j);
+   }
+
+   return LLVMBuildBitCast(builder, res,
+                           LLVMVectorType(LLVMInt8TypeInContext(gallivm->context),
+                                          4 * n), "");
+}
@@ -0,0 +1,333 @@
+/**************************************************************************
+ *
+ * Copyright 2019 VMware, Inc.
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL VMWARE AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+
+/**
+ * @file
+ * RGTC (BC4/BC5) and LATC texel fetch.
+ *
+ * Every texel is decoded on its own, but for a whole vector of texels at
+ * once, so unlike the block cache this needs neither a C call nor any
+ * per-element control flow.  The decoding matches
+ * util_format_(un)signed_fetch_texel_rgtc() bit for bit.
+ *
+ * BC6H and BC7 are decoded the same way in lp_bld_format_bptc.c, ETC1, ETC2
+ * and EAC in lp_bld_format_etc.c.
+ */
+
+
+#include "util/u_format.h"
+
+#include "lp_bld_arit.h"
+#include "lp_bld_type.h"
+#include "lp_bld_const.h"
+#include "lp_bld_conv.h"
+#include "lp_bld_gather.h"
+#include "lp_bld_format.h"
+#include "lp_bld_logic.h"
+#include "lp_bld_swizzle.h"
+
+
+static boolean
+rgtc_is_signed(enum pipe_format format)
+{
+   switch (format) {
+   case PIPE_FORMAT_RGTC1_SNORM:
+   case PIPE_FORMAT_RGTC2_SNORM:
+   case PIPE_FORMAT_LATC1_SNORM:
+   case PIPE_FORMAT_LATC2_SNORM:
+      return TRUE;
+   default:
+      return FALSE;
+   }
+}
+
+
+/**
+ * Decode one 64 bit BC4 block channel.
+ * @param offset  <n x i32> byte offset of the block channel from base_ptr
+ * @param i, j  <n x i32> texel coordinates within the block
+ * @return  <n x i32> decoded values, 0..255 or -128..127 if is_signed
+ */
+static LLVMValueRef
+decode_bc4_channel(struct gallivm_state *gallivm,
+                   unsigned n,
+                   boolean is_signed,
+                   LLVMValueRef base_ptr,
+                   LLVMValueRef offset,
+                   LLVMValueRef i,
+                   LLVMValueRef j)
+{
+   LLVMBuilderRef builder = gallivm->builder;
+   struct lp_type type32 = lp_type_int_vec(32, 32 * n);
+   struct lp_type type64 = lp_type_int_vec(64, 64 * n);
+   struct lp_build_context bld32;
+   LLVMValueRef lo, hi, bits, bit_pos, code;
+   LLVMValueRef a0, a1, six_mode;
+   LLVMValueRef interp8, interp6, res, tmp;
+
+   lp_build_context_init(&bld32, gallivm, type32);
+
+   /* Bytes 0-1 are the endpoints, bytes 2-7 the 16 3-bit codes */
+   lo = lp_build_gather(gallivm, n, 32, lp_type_uint(32), FALSE,
+                        base_ptr, offset, FALSE);
+   tmp = LLVMBuildAdd(builder, offset,
+                      lp_build_const_int_vec(gallivm, type32, 4), "");
+   hi = lp_build_gather(gallivm, n, 32, lp_type_uint(32), FALSE,
+                        base_ptr, tmp, FALSE);
+
+   if (is_signed) {
+      a0 = LLVMBuildShl(builder, lo,
+                        lp_build_const_int_vec(gallivm, type32, 24), "");
+      a0 = LLVMBuildAShr(builder, a0,
+                         lp_build_const_int_vec(gallivm, type32, 24), "");
+      a1 = LLVMBuildShl(builder, lo,
+                        lp_build_const_int_vec(gallivm, type32, 16), "");
+      a1 = LLVMBuildAShr(builder, a1,
+                         lp_build_const_int_vec(gallivm, type32, 24), "");
+   }
+   else {
+      a0 = LLVMBuildAnd(builder, lo,
+                        lp_build_const_int_vec(gallivm, type32, 0xff), "");
+      a1 = LLVMBuildLShr(builder, lo,
+                         lp_build_const_int_vec(gallivm, type32, 8), "");
+      a1 = LLVMBuildAnd(builder, a1,
+                        lp_build_const_int_vec(gallivm, type32, 0xff), "");
+   }
+
+   /* bits = 48 bit code stream, code = (bits >> 3 * (4 * j + i)) & 7 */
+   bits = LLVMBuildLShr(builder, lo,
+                        lp_build_const_int_vec(gallivm, type32, 16), "");
+   bits = LLVMBuildZExt(builder, bits, lp_build_vec_type(gallivm, type64), "");
+   tmp = LLVMBuildZExt(builder, hi, lp_build_vec_type(gallivm, type64), "");
+   tmp = LLVMBuildShl(builder, tmp,
+                      lp_build_const_int_vec(gallivm, type64, 16), "");
+   bits = LLVMBuildOr(builder, bits, tmp, "");
+
+   bit_pos = LLVMBuildShl(builder, j,
+                          lp_build_const_int_vec(gallivm, type32, 2), "");
+   bit_pos = LLVMBuildAdd(builder, bit_pos, i, "");
+   bit_pos = LLVMBuildMul(builder, bit_pos,
+                          lp_build_const_int_vec(gallivm, type32, 3), "");
+   bit_pos = LLVMBuildZExt(builder, bit_pos,
+                           lp_build_vec_type(gallivm, type64), "");
+   code = LLVMBuildLShr(builder, bits, bit_pos, "");
+   code = LLVMBuildTrunc(builder, code, bld32.vec_type, "");
+   code = LLVMBuildAnd(builder, code,
+                       lp_build_const_int_vec(gallivm, type32, 7), "");
+
+   /*
+    * a0 > a1: ((8 - code) * a0 + (code - 1) * a1) / 7
+    * else:    ((6 - code) * a0 + (code - 1) * a1) / 5, code 6 and 7 are
+    *          the minimum and maximum of the type.
+    * C integer division truncates towards zero, as sdiv does.
+    */
+   tmp = LLVMBuildSub(builder, code, bld32.one, "");
+   tmp = LLVMBuildMul(builder, tmp, a1, "");
+
+   interp8 = LLVMBuildSub(builder,
+                          lp_build_const_int_vec(gallivm, type32, 8), code, "");
+   interp8 = LLVMBuildMul(builder, interp8, a0, "");
+   interp8 = LLVMBuildAdd(builder, interp8, tmp, "");
+   interp8 = LLVMBuildSDiv(builder, interp8,
+                           lp_build_const_int_vec(gallivm, type32, 7), "");
+
+   interp6 = LLVMBuildSub(builder,
+                          lp_build_const_int_vec(gallivm, type32, 6), code, "");
+   interp6 = LLVMBuildMul(builder, interp6, a0, "");
+   interp6 = LLVMBuildAdd(builder, interp6, tmp, "");
+   interp6 = LLVMBuildSDiv(builder, interp6,
+                           lp_build_const_int_vec(gallivm, type32, 5), "");
+
+   six_mode = lp_build_cmp(&bld32, PIPE_FUNC_LEQUAL, a0, a1);
+
+   tmp = lp_build_cmp(&bld32, PIPE_FUNC_EQUAL, code,
+                      lp_build_const_int_vec(gallivm, type32, 6));
+   interp6 = lp_build_select(&bld32, tmp,
+                             lp_build_const_int_vec(gallivm, type32,
+                                                    is_signed ? -128 : 0),
+                             interp6);
+   tmp = lp_build_cmp(&bld32, PIPE_FUNC_EQUAL, code,
+                      lp_build_const_int_vec(gallivm, type32, 7));
+   interp6 = lp_build_select(&bld32, tmp,
+                             lp_build_const_int_vec(gallivm, type32,
+                                                    is_signed ? 127 : 255),
+                             interp6);
+
+   res = lp_build_select(&bld32, six_mode, interp6, interp8);
+
+   tmp = lp_build_cmp(&bld32, PIPE_FUNC_EQUAL, code, bld32.one);
+   res = lp_build_select(&bld32, tmp, a1, res);
+   tmp = lp_build_cmp(&bld32, PIPE_FUNC_EQUAL, code, bld32.zero);
+   res = lp_build_select(&bld32, tmp, a0, res);
+
+   return res;
+}
+
+
+/**
+ * Decode the one or two channels of the block.
+ */
+static unsigned
+decode_rgtc(struct gallivm_state *gallivm,
+            const struct util_format_description *format_desc,
+            unsigned n,
+            LLVMValueRef base_ptr,
+            LLVMValueRef offset,
+            LLVMValueRef i,
+            LLVMValueRef j,
+            LLVMValueRef chans[2])
+{
+   boolean is_signed = rgtc_is_signed(format_desc->format);
+   unsigned num_chans = format_desc->block.bits / 64;
+   unsigned chan;
+
+   assert(format_desc->layout == UTIL_FORMAT_LAYOUT_RGTC);
+   assert(num_chans == 1 || num_chans == 2);
+
+   for (chan = 0; chan < num_chans; chan++) {
+      LLVMValueRef chan_offset = offset;
+
+      if (chan) {
+         struct lp_type type32 = lp_type_int_vec(32, 32 * n);
+         chan_offset = LLVMBuildAdd(gallivm->builder, offset,
+                                    lp_build_const_int_vec(gallivm, type32, 8),
+                                    "");
+      }
+      chans[chan] = decode_bc4_channel(gallivm, n, is_signed, base_ptr,
+                                       chan_offset, i, j);
+   }
+
+   return num_chans;
+}
+
+
+/**
+ * Fetch texels of a RGTC or LATC format as SoA floats.
+ * @param type  float32 vector type, offset, i and j have its length
+ */
+void
+lp_build_fetch_rgtc_rgba_soa(struct gallivm_state *gallivm,
+                             const struct util_format_description *format_desc,
+                             struct lp_type type,
+                             LLVMValueRef base_ptr,
+                             LLVMValueRef offset,
+                             LLVMValueRef i,
+                             LLVMValueRef j,
+                             LLVMValueRef rgba_out[4])
+{
+   LLVMBuilderRef builder = gallivm->builder;
+   struct lp_build_context bld;
+   LLVMValueRef chans[2], rgba[4];
+   unsigned num_chans, chan;
+
+   assert(type.floating && type.width == 32);
+
+   lp_build_context_init(&bld, gallivm, type);
+
+   num_chans = decode_rgtc(gallivm, format_desc, type.length,
+                           base_ptr, offset, i, j, chans);
+
+   for (chan = 0; chan < 4; chan++) {
+      LLVMValueRef tmp;
+
+      if (chan >= num_chans) {
+         rgba[chan] = chan == 3 ? bld.one : bld.zero;
+         continue;
+      }
+
+      tmp = LLVMBuildSIToFP(builder, chans[chan], bld.vec_type, "");
+      if (rgtc_is_signed(format_desc->format)) {
+         /* byte_to_float_tex(): -128 maps to -1.0 too */
+         tmp = LLVMBuildFDiv(builder, tmp,
+                             lp_build_const_vec(gallivm, type, 127.0), "");
+         tmp = lp_build_max(&bld, tmp,
+                            lp_build_const_vec(gallivm, type, -1.0));
+      }
+      else {
+         tmp = LLVMBuildFMul(builder, tmp,
+                             lp_build_const_vec(gallivm, type, 1.0 / 255.0),
+                             "");
+      }
+      rgba[chan] = tmp;
+   }
+
+   for (chan = 0; chan < 4; chan++) {
+      rgba_out[chan] = lp_build_swizzle_soa_channel(&bld, rgba,
+                                                    format_desc->swizzle[chan]);
+   }
+}
+
+
+/**
+ * Fetch texels of an unsigned RGTC or LATC format as packed rgba8.
+ * @return  <4n x i8> vector
+ */
+LLVMValueRef
+lp_build_fetch_rgtc_rgba_aos(struct gallivm_state *gallivm,
+                             const struct util_format_description *format_desc,
+                             unsigned n,
+                             LLVMValueRef base_ptr,
+                             LLVMValueRef offset,
+                             LLVMValueRef i,
+                             LLVMValueRef j)
+{
+   LLVMBuilderRef builder = gallivm->builder;
+   struct lp_type type32 = lp_type_int_vec(32, 32 * n);
+   LLVMValueRef chans[2], res;
+   unsigned num_chans, chan;
+
+   assert(!rgtc_is_signed(format_desc->format));
+
+   num_chans = decode_rgtc(gallivm, format_desc, n,
+                           base_ptr, offset, i, j, chans);
+
+   res = lp_build_const_int_vec(gallivm, type32, 0);
+   for (chan = 0; chan < 4; chan++) {
+      enum pipe_swizzle swizzle = format_desc->swizzle[chan];
+      LLVMValueRef tmp;
+
+      if (swizzle == PIPE_SWIZZLE_0) {
+         continue;
+      }
+      else if (swizzle == PIPE_SWIZZLE_1) {
+         res = LLVMBuildOr(builder, res,
+                           lp_build_const_int_vec(gallivm, type32,
+                                                  0xffu << (chan * 8)), "");
+         continue;
+      }
+
+      assert(swizzle < num_chans);
+      tmp = LLVMBuildShl(builder, chans[swizzle],
+                         lp_build_const_int_vec(gallivm, type32, chan * 8), "");
+      res = LLVMBuildOr(builder, res, tmp, "");
+   }
+
+   return LLVMBuildBitCast(builder, res,
+                           LLVMVectorType(LLVMInt8TypeInContext(gallivm->context),
+                                          4 * n), "");
+}
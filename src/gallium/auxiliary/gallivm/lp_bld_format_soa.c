@@ -42,6 +42,7 @@
 #include "lp_bld_format.h"
 #include "lp_bld_arit.h"
 #include "lp_bld_pack.h"
+#include "lp_bld_flow.h"
 
 
 static void
@@ -736,17 +737,47 @@ lp_build_fetch_rgba_soa(struct gallivm_state *gallivm,
       return;
    }
 
+   /*
+    * RGTC and LATC, the BPTC float formats and the ETC2 R11 and RG11 formats
+    * are decoded directly in SoA.
+    */
+
+   if (format_desc->layout == UTIL_FORMAT_LAYOUT_RGTC &&
+       type.floating && type.width == 32) {
+      lp_build_fetch_rgtc_rgba_soa(gallivm, format_desc, type,
+                                   base_ptr, offset, i, j, rgba_out);
+      return;
+   }
+
+   if ((format == PIPE_FORMAT_BPTC_RGB_FLOAT ||
+        format == PIPE_FORMAT_BPTC_RGB_UFLOAT) &&
+       type.floating && type.width == 32) {
+      lp_build_fetch_bptc_rgba_soa(gallivm, format_desc, type,
+                                   base_ptr, offset, i, j, rgba_out);
+      return;
+   }
+
+   if ((format == PIPE_FORMAT_ETC2_R11_UNORM ||
+        format == PIPE_FORMAT_ETC2_R11_SNORM ||
+        format == PIPE_FORMAT_ETC2_RG11_UNORM ||
+        format == PIPE_FORMAT_ETC2_RG11_SNORM) &&
+       type.floating && type.width == 32) {
+      lp_build_fetch_etc_rgba_soa(gallivm, format_desc, type,
+                                  base_ptr, offset, i, j, rgba_out);
+      return;
+   }
+
    /*
     * Try calling lp_build_fetch_rgba_aos for all pixels.
     * Should only really hit subsampled, compressed
-    * (for s3tc srgb too, for rgtc the unorm ones only) by now.
+    * (for s3tc, bptc and etc srgb too) by now.
     * (This is invalid for plain 8unorm formats because we're lazy with
     * the swizzle since some results would arrive swizzled, some not.)
     */
 
    if ((format_desc->layout != UTIL_FORMAT_LAYOUT_PLAIN) &&
-       (util_format_fits_8unorm(format_desc) ||
-        format_desc->layout == UTIL_FORMAT_LAYOUT_S3TC) &&
+       util_format_fits_8unorm(
+          util_format_description(util_format_linear(format))) &&
        type.floating && type.width == 32 &&
        (type.length == 1 || (type.length % 4 == 0))) {
       struct lp_type tmp_type;
@@ -778,7 +809,9 @@ lp_build_fetch_rgba_soa(struct gallivm_state *gallivm,
        */
       frgba8_desc = util_format_description(PIPE_FORMAT_R8G8B8A8_UNORM);
       if (format_desc->colorspace == UTIL_FORMAT_COLORSPACE_SRGB) {
-         assert(format_desc->layout == UTIL_FORMAT_LAYOUT_S3TC);
+         assert(format_desc->layout == UTIL_FORMAT_LAYOUT_S3TC ||
+                format_desc->layout == UTIL_FORMAT_LAYOUT_BPTC ||
+                format_desc->layout == UTIL_FORMAT_LAYOUT_ETC);
          frgba8_desc = util_format_description(PIPE_FORMAT_R8G8B8A8_SRGB);
       }
       lp_build_unpack_rgba_soa(gallivm,
@@ -813,8 +846,8 @@ lp_build_fetch_rgba_soa(struct gallivm_state *gallivm,
     * in particular if the formats have less than 4 channels.
     *
     * Right now, this should only be hit for:
-    * - RGTC snorm formats
-    *   (those miss fast fetch functions hence they are terrible anyway)
+    * - ASTC formats, which llvmpipe does not expose
+    * - compressed formats fetched as non-float32 types
     */
 
    {
@@ -858,3 +891,244 @@ lp_build_fetch_rgba_soa(struct gallivm_state *gallivm,
       convert_to_soa(gallivm, aos_fetch, rgba_out, type);
    }
 }
+
+
+/**
+ * Whether lp_build_store_rgba_soa() can store texels of this format.
+ */
+boolean
+lp_build_store_rgba_soa_supported(const struct util_format_description *format_desc)
+{
+   unsigned chan;
+
+   if (format_desc->format == PIPE_FORMAT_R11G11B10_FLOAT)
+      return TRUE;
+
+   if (format_desc->layout != UTIL_FORMAT_LAYOUT_PLAIN ||
+       format_desc->colorspace != UTIL_FORMAT_COLORSPACE_RGB ||
+       format_desc->block.width != 1 ||
+       format_desc->block.height != 1 ||
+       !util_is_power_of_two_nonzero(format_desc->block.bits) ||
+       format_desc->block.bits < 8 ||
+       format_desc->block.bits > 128)
+      return FALSE;
+
+   for (chan = 0; chan < format_desc->nr_channels; chan++) {
+      const struct util_format_channel_description *chan_desc =
+         &format_desc->channel[chan];
+
+      switch (chan_desc->type) {
+      case UTIL_FORMAT_TYPE_VOID:
+         continue;
+      case UTIL_FORMAT_TYPE_UNSIGNED:
+      case UTIL_FORMAT_TYPE_SIGNED:
+         break;
+      case UTIL_FORMAT_TYPE_FLOAT:
+         if (chan_desc->size != 16 && chan_desc->size != 32)
+            return FALSE;
+         break;
+      default:
+         return FALSE;
+      }
+
+      /* each channel must be within one dword of the packed texel */
+      if ((chan_desc->shift % 32) + chan_desc->size > 32)
+         return FALSE;
+   }
+
+   return TRUE;
+}
+
+
+/**
+ * Convert one channel to its packed bits, in the low bits of the elements
+ * of an integer vector.
+ */
+static LLVMValueRef
+lp_build_pack_soa_chan(struct gallivm_state *gallivm,
+                       struct lp_type type,
+                       const struct util_format_channel_description *chan_desc,
+                       LLVMValueRef value)
+{
+   LLVMBuilderRef builder = gallivm->builder;
+   struct lp_type int_type = lp_int_type(type);
+   struct lp_type uint_type = lp_uint_type(type);
+   struct lp_build_context bld, int_bld, uint_bld;
+   const unsigned width = chan_desc->size;
+
+   lp_build_context_init(&bld, gallivm, type);
+   lp_build_context_init(&int_bld, gallivm, int_type);
+   lp_build_context_init(&uint_bld, gallivm, uint_type);
+
+   switch (chan_desc->type) {
+   case UTIL_FORMAT_TYPE_UNSIGNED:
+      if (chan_desc->pure_integer) {
+         value = LLVMBuildBitCast(builder, value, uint_bld.vec_type, "");
+         if (width < 32) {
+            value = lp_build_min(&uint_bld, value,
+                                 lp_build_const_int_vec(gallivm, uint_type,
+                                                        (1ULL << width) - 1));
+         }
+      }
+      else {
+         assert(chan_desc->normalized);
+         value = lp_build_clamp(&bld, value, bld.zero, bld.one);
+         value = lp_build_clamped_float_to_unsigned_norm(gallivm, type,
+                                                         width, value);
+      }
+      break;
+
+   case UTIL_FORMAT_TYPE_SIGNED:
+      if (chan_desc->pure_integer) {
+         value = LLVMBuildBitCast(builder, value, int_bld.vec_type, "");
+         if (width < 32) {
+            value = lp_build_clamp(&int_bld, value,
+                                   lp_build_const_int_vec(gallivm, int_type,
+                                                          -(1LL << (width - 1))),
+                                   lp_build_const_int_vec(gallivm, int_type,
+                                                          (1LL << (width - 1)) - 1));
+         }
+      }
+      else {
+         double scale = (double)((1ULL << (width - 1)) - 1);
+
+         assert(chan_desc->normalized);
+         value = lp_build_clamp(&bld, value,
+                                lp_build_const_vec(gallivm, type, -1.0),
+                                bld.one);
+         value = lp_build_mul(&bld, value,
+                              lp_build_const_vec(gallivm, type, scale));
+         value = lp_build_iround(&bld, value);
+      }
+      if (width < 32) {
+         value = LLVMBuildAnd(builder, value,
+                              lp_build_const_int_vec(gallivm, int_type,
+                                                     (1ULL << width) - 1), "");
+      }
+      break;
+
+   case UTIL_FORMAT_TYPE_FLOAT:
+      if (width == 16) {
+         value = lp_build_float_to_half(gallivm, value);
+         value = LLVMBuildZExt(builder, value, uint_bld.vec_type, "");
+      }
+      else {
+         assert(width == 32);
+      }
+      break;
+
+   default:
+      assert(0);
+      value = uint_bld.zero;
+      break;
+   }
+
+   return LLVMBuildBitCast(builder, value, uint_bld.vec_type, "");
+}
+
+
+/**
+ * Convert texels from SoA rgba and store them, the reverse of
+ * lp_build_fetch_rgba_soa() for the formats accepted by
+ * lp_build_store_rgba_soa_supported().
+ *
+ * Stores are done one element at a time, with control flow, since other
+ * threads may concurrently write the neighbouring texels.
+ *
+ * \param type  the type of 'rgba_in', 32-bit floats or for pure integer
+ *              formats 32-bit integers
+ * \param mask  integer vector, the texels of the non-zero elements are
+ *              stored
+ * \param base_ptr  i8 pointer to the texture data
+ * \param offsets  byte offsets of the texels from base_ptr
+ */
+void
+lp_build_store_rgba_soa(struct gallivm_state *gallivm,
+                        const struct util_format_description *format_desc,
+                        struct lp_type type,
+                        LLVMValueRef mask,
+                        LLVMValueRef base_ptr,
+                        LLVMValueRef offsets,
+                        const LLVMValueRef rgba_in[4])
+{
+   LLVMBuilderRef builder = gallivm->builder;
+   struct lp_type uint_type = lp_uint_type(type);
+   LLVMTypeRef store_type;
+   LLVMValueRef packed[4];
+   unsigned num_dwords, chan, i, j;
+
+   assert(type.width == 32);
+   assert(lp_build_store_rgba_soa_supported(format_desc));
+
+   num_dwords = MAX2(format_desc->block.bits / 32, 1);
+   for (j = 0; j < num_dwords; j++)
+      packed[j] = lp_build_zero(gallivm, uint_type);
+
+   if (format_desc->format == PIPE_FORMAT_R11G11B10_FLOAT) {
+      LLVMValueRef rgb[3];
+
+      for (chan = 0; chan < 3; chan++)
+         rgb[chan] = LLVMBuildBitCast(builder, rgba_in[chan],
+                                      lp_build_vec_type(gallivm, type), "");
+      packed[0] = lp_build_float_to_r11g11b10(gallivm, rgb);
+   }
+   else {
+      for (chan = 0; chan < format_desc->nr_channels; chan++) {
+         const struct util_format_channel_description *chan_desc =
+            &format_desc->channel[chan];
+         unsigned shift = chan_desc->shift % 32;
+         LLVMValueRef value;
+         unsigned comp;
+
+         if (chan_desc->type == UTIL_FORMAT_TYPE_VOID)
+            continue;
+
+         /* find the rgba component which ends up in this channel */
+         for (comp = 0; comp < 4; comp++) {
+            if (format_desc->swizzle[comp] == chan)
+               break;
+         }
+         if (comp == 4)
+            continue;
+
+         value = lp_build_pack_soa_chan(gallivm, type, chan_desc,
+                                        rgba_in[comp]);
+         if (shift) {
+            value = LLVMBuildShl(builder, value,
+                                 lp_build_const_int_vec(gallivm, uint_type,
+                                                        shift), "");
+         }
+         packed[chan_desc->shift / 32] =
+            LLVMBuildOr(builder, packed[chan_desc->shift / 32], value, "");
+      }
+   }
+
+   store_type = LLVMIntTypeInContext(gallivm->context,
+                                     MIN2(format_desc->block.bits, 32));
+
+   for (i = 0; i < type.length; i++) {
+      LLVMValueRef ii = lp_build_const_int32(gallivm, i);
+      LLVMValueRef scalar_mask, offset, ptr;
+      struct lp_build_if_state ifthen;
+
+      scalar_mask = LLVMBuildExtractElement(builder, mask, ii, "");
+      scalar_mask = LLVMBuildICmp(builder, LLVMIntNE, scalar_mask,
+                                  LLVMConstNull(LLVMTypeOf(scalar_mask)), "");
+      lp_build_if(&ifthen, gallivm, scalar_mask);
+
+      offset = LLVMBuildExtractElement(builder, offsets, ii, "");
+      ptr = LLVMBuildGEP(builder, base_ptr, &offset, 1, "");
+      ptr = LLVMBuildBitCast(builder, ptr, LLVMPointerType(store_type, 0), "");
+
+      for (j = 0; j < num_dwords; j++) {
+         LLVMValueRef jj = lp_build_const_int32(gallivm, j);
+         LLVMValueRef elem = LLVMBuildExtractElement(builder, packed[j], ii, "");
+         LLVMValueRef elem_ptr = LLVMBuildGEP(builder, ptr, &jj, 1, "");
+
+         elem = LLVMBuildTrunc(builder, elem, store_type, "");
+         LLVMBuildStore(builder, elem, elem_ptr);
+      }
+
+      lp_build_endif(&ifthen);
+   }
+}
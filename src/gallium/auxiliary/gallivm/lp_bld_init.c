@@ -59,6 +59,13 @@ static const bool use_mcjit = USE_MCJIT;
 static bool use_mcjit = FALSE;
 #endif
 
+/*
+ * Whether modules are compiled into the process wide ORC JIT instead of an
+ * MCJIT engine each, see lp_orc_add_module().  Still experimental, so only
+ * enabled with GALLIVM_ORC=1.
+ */
+static bool use_orc = FALSE;
+
 
 #ifdef DEBUG
 unsigned gallivm_debug = 0;
@@ -85,6 +92,8 @@ static boolean gallivm_initialized = FALSE;
 
 unsigned lp_native_vector_width;
 
+unsigned gallivm_tier_up_uses;
+
 
 /*
  * Optimization values are:
@@ -103,6 +112,13 @@ enum LLVM_CodeGenOpt_Level {
 };
 
 
+static inline boolean
+gallivm_no_opt(const struct gallivm_state *gallivm)
+{
+   return gallivm->no_opt || (gallivm_debug & GALLIVM_DEBUG_NO_OPT);
+}
+
+
 /**
  * Create the LLVM (optimization) pass manager and install
  * relevant optimization passes.
@@ -136,7 +152,7 @@ create_pass_manager(struct gallivm_state *gallivm)
       free(td_str);
    }
 
-   if ((gallivm_debug & GALLIVM_DEBUG_NO_OPT) == 0) {
+   if (!gallivm_no_opt(gallivm)) {
       /*
        * TODO: Evaluate passes some more - keeping in mind
        * both quality of generated code and compile times.
@@ -192,6 +208,12 @@ gallivm_free_ir(struct gallivm_state *gallivm)
       LLVMDisposeModule(gallivm->module);
    }
 
+   /* The object cache must outlive the engine it is attached to */
+   if (gallivm->cache) {
+      lp_free_objcache(gallivm->cache->jit_obj_cache);
+      gallivm->cache->jit_obj_cache = NULL;
+   }
+
    FREE(gallivm->module_name);
 
    if (!use_mcjit) {
@@ -214,6 +236,7 @@ gallivm_free_ir(struct gallivm_state *gallivm)
    gallivm->passmgr = NULL;
    gallivm->context = NULL;
    gallivm->builder = NULL;
+   gallivm->cache = NULL;
 }
 
 
@@ -225,6 +248,10 @@ gallivm_free_code(struct gallivm_state *gallivm)
 {
    assert(!gallivm->module);
    assert(!gallivm->engine);
+   if (gallivm->jit_module) {
+      lp_orc_release_module(gallivm->jit_module);
+      gallivm->jit_module = NULL;
+   }
    lp_free_generated_code(gallivm->code);
    gallivm->code = NULL;
    lp_free_memory_manager(gallivm->memorymgr);
@@ -232,23 +259,39 @@ gallivm_free_code(struct gallivm_state *gallivm)
 }
 
 
+static inline enum LLVM_CodeGenOpt_Level
+gallivm_opt_level(const struct gallivm_state *gallivm)
+{
+   return gallivm_no_opt(gallivm) ? None : Default;
+}
+
+
+/**
+ * Address of a compiled function, NULL if it can't be looked up (such as
+ * internal functions with the ORC JIT).
+ */
+static void *
+gallivm_get_function_code(struct gallivm_state *gallivm, LLVMValueRef func)
+{
+   if (gallivm->jit_module) {
+      return lp_orc_get_function_address(gallivm->jit_module,
+                                         LLVMGetValueName(func));
+   }
+   return LLVMGetPointerToGlobal(gallivm->engine, func);
+}
+
+
 static boolean
 init_gallivm_engine(struct gallivm_state *gallivm)
 {
    if (1) {
-      enum LLVM_CodeGenOpt_Level optlevel;
+      enum LLVM_CodeGenOpt_Level optlevel = gallivm_opt_level(gallivm);
       char *error = NULL;
       int ret;
 
-      if (gallivm_debug & GALLIVM_DEBUG_NO_OPT) {
-         optlevel = None;
-      }
-      else {
-         optlevel = Default;
-      }
-
       ret = lp_build_create_jit_compiler_for_module(&gallivm->engine,
                                                     &gallivm->code,
+                                                    gallivm->cache,
                                                     gallivm->module,
                                                     gallivm->memorymgr,
                                                     (unsigned) optlevel,
@@ -301,7 +344,7 @@ fail:
  */
 static boolean
 init_gallivm_state(struct gallivm_state *gallivm, const char *name,
-                   LLVMContextRef context)
+                   LLVMContextRef context, struct lp_cached_code *cache)
 {
    assert(!gallivm->context);
    assert(!gallivm->module);
@@ -310,6 +353,7 @@ init_gallivm_state(struct gallivm_state *gallivm, const char *name,
       return FALSE;
 
    gallivm->context = context;
+   gallivm->cache = cache;
 
    if (!gallivm->context)
       goto fail;
@@ -332,9 +376,11 @@ init_gallivm_state(struct gallivm_state *gallivm, const char *name,
    if (!gallivm->builder)
       goto fail;
 
-   gallivm->memorymgr = lp_get_default_memory_manager();
-   if (!gallivm->memorymgr)
-      goto fail;
+   if (!use_orc) {
+      gallivm->memorymgr = lp_get_default_memory_manager();
+      if (!gallivm->memorymgr)
+         goto fail;
+   }
 
    /* FIXME: MC-JIT only allows compiling one module at a time, and it must be
     * complete when MC-JIT is created. So defer the MC-JIT engine creation for
@@ -381,8 +427,9 @@ init_gallivm_state(struct gallivm_state *gallivm, const char *name,
       }
    }
 
-   if (!create_pass_manager(gallivm))
-      goto fail;
+   /* The pass manager is created by gallivm_compile_module(), so that
+    * gallivm_state::no_opt can still be set while building the IR.
+    */
 
    return TRUE;
 
@@ -471,6 +518,7 @@ lp_build_init(void)
       util_cpu_caps.has_avx2 = 0;
       util_cpu_caps.has_f16c = 0;
       util_cpu_caps.has_fma = 0;
+      util_cpu_caps.has_avx512f = 0;
    }
    if (HAVE_LLVM < 0x0304 || !use_mcjit) {
       /* AVX2 support has only been tested with LLVM 3.4, and it requires
@@ -500,6 +548,13 @@ lp_build_init(void)
    }
 #endif
 
+   gallivm_tier_up_uses = debug_get_num_option("GALLIVM_TIER_UP_USES", 16);
+
+   if (GALLIVM_HAVE_ORC && use_mcjit &&
+       debug_get_bool_option("GALLIVM_ORC", FALSE)) {
+      use_orc = lp_orc_init();
+   }
+
    gallivm_initialized = TRUE;
 
    return TRUE;
@@ -509,15 +564,19 @@ lp_build_init(void)
 
 /**
  * Create a new gallivm_state object.
+ * \param cache  optional cached machine code for the module, see
+ *               struct lp_cached_code.  Must stay valid until the
+ *               module's functions have been jitted.
  */
 struct gallivm_state *
-gallivm_create(const char *name, LLVMContextRef context)
+gallivm_create(const char *name, LLVMContextRef context,
+               struct lp_cached_code *cache)
 {
    struct gallivm_state *gallivm;
 
    gallivm = CALLOC_STRUCT(gallivm_state);
    if (gallivm) {
-      if (!init_gallivm_state(gallivm, name, context)) {
+      if (!init_gallivm_state(gallivm, name, context, cache)) {
          FREE(gallivm);
          gallivm = NULL;
       }
@@ -581,6 +640,10 @@ gallivm_compile_module(struct gallivm_state *gallivm)
       gallivm->builder = NULL;
    }
 
+   if (!create_pass_manager(gallivm)) {
+      assert(0);
+   }
+
    /* Dump bitcode to a file */
    if (gallivm_debug & GALLIVM_DEBUG_DUMP_BC) {
       char filename[256];
@@ -589,14 +652,18 @@ gallivm_compile_module(struct gallivm_state *gallivm)
       LLVMWriteBitcodeToFile(gallivm->module, filename);
       debug_printf("%s written\n", filename);
       debug_printf("Invoke as \"opt %s %s | llc -O%d %s%s\"\n",
-                   gallivm_debug & GALLIVM_DEBUG_NO_OPT ? "-mem2reg" :
+                   gallivm_no_opt(gallivm) ? "-mem2reg" :
                    "-sroa -early-cse -simplifycfg -reassociate "
                    "-mem2reg -constprop -instcombine -gvn",
-                   filename, gallivm_debug & GALLIVM_DEBUG_NO_OPT ? 0 : 2,
+                   filename, gallivm_no_opt(gallivm) ? 0 : 2,
                    (HAVE_LLVM >= 0x0305) ? "[-mcpu=<-mcpu option>] " : "",
                    "[-mattr=<-mattr option(s)>]");
    }
 
+   /* The IR is only needed for codegen, which a cache hit skips */
+   if (gallivm->cache && gallivm->cache->data_size)
+      goto skip_opt;
+
    if (gallivm_debug & GALLIVM_DEBUG_PERF)
       time_begin = os_time_get();
 
@@ -630,7 +697,22 @@ gallivm_compile_module(struct gallivm_state *gallivm)
                    gallivm->module_name, time_msec);
    }
 
-   if (use_mcjit) {
+skip_opt:
+   if (use_orc) {
+      char *error = NULL;
+
+      /* The ORC JIT sets the module's DataLayout from its target machine */
+      gallivm->jit_module = lp_orc_add_module(gallivm->module,
+                                              gallivm->cache,
+                                              gallivm_opt_level(gallivm),
+                                              &error);
+      if (!gallivm->jit_module) {
+         _debug_printf("%s\n", error);
+         free(error);
+         assert(0);
+      }
+   }
+   else if (use_mcjit) {
       /* Setting the module's DataLayout to an empty string will cause the
        * ExecutionEngine to copy to the DataLayout string from its target
        * machine to the module.  As of LLVM 3.8 the module and the execution
@@ -653,8 +735,8 @@ gallivm_compile_module(struct gallivm_state *gallivm)
       if (!init_gallivm_engine(gallivm)) {
          assert(0);
       }
+      assert(gallivm->engine);
    }
-   assert(gallivm->engine);
 
    ++gallivm->compiled;
 
@@ -668,8 +750,9 @@ gallivm_compile_module(struct gallivm_state *gallivm)
           * LLVMGetPointerToGlobal() will abort otherwise.
           */
          if (!LLVMIsDeclaration(llvm_func)) {
-            void *func_code = LLVMGetPointerToGlobal(gallivm->engine, llvm_func);
-            lp_disassemble(llvm_func, func_code);
+            void *func_code = gallivm_get_function_code(gallivm, llvm_func);
+            if (func_code)
+               lp_disassemble(llvm_func, func_code);
          }
          llvm_func = LLVMGetNextFunction(llvm_func);
       }
@@ -681,8 +764,9 @@ gallivm_compile_module(struct gallivm_state *gallivm)
 
       while (llvm_func) {
          if (!LLVMIsDeclaration(llvm_func)) {
-            void *func_code = LLVMGetPointerToGlobal(gallivm->engine, llvm_func);
-            lp_profile(llvm_func, func_code);
+            void *func_code = gallivm_get_function_code(gallivm, llvm_func);
+            if (func_code)
+               lp_profile(llvm_func, func_code);
          }
          llvm_func = LLVMGetNextFunction(llvm_func);
       }
@@ -701,12 +785,12 @@ gallivm_jit_function(struct gallivm_state *gallivm,
    int64_t time_begin = 0;
 
    assert(gallivm->compiled);
-   assert(gallivm->engine);
+   assert(gallivm->engine || gallivm->jit_module);
 
    if (gallivm_debug & GALLIVM_DEBUG_PERF)
       time_begin = os_time_get();
 
-   code = LLVMGetPointerToGlobal(gallivm->engine, func);
+   code = gallivm_get_function_code(gallivm, func);
    assert(code);
    jit_func = pointer_to_func(code);
 
@@ -719,3 +803,29 @@ gallivm_jit_function(struct gallivm_state *gallivm,
 
    return jit_func;
 }
+
+
+/**
+ * Print the compile and execution times of a variant per tier, and the
+ * speedup of the optimized code.
+ */
+void
+gallivm_print_tier_stats(const char *name,
+                         const struct gallivm_tier_stats *stats)
+{
+   double per_call[2];
+   unsigned tier;
+
+   for (tier = 0; tier < 2; tier++) {
+      per_call[tier] = stats->calls[tier] ?
+         (double)stats->run_time[tier] / stats->calls[tier] : 0.0;
+      debug_printf("%s tier %u: compile %.3f msec, %" PRIu64 " calls, "
+                   "%.1f nsec/call\n",
+                   name, tier, stats->compile_time[tier] / 1000000.0,
+                   stats->calls[tier], per_call[tier]);
+   }
+
+   if (per_call[0] > 0.0 && per_call[1] > 0.0) {
+      debug_printf("%s speedup %.2fx\n", name, per_call[0] / per_call[1]);
+   }
+}
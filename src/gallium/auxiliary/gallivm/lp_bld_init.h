@@ -39,6 +39,24 @@
 extern "C" {
 #endif
 
+/**
+ * Machine code for a module, as stored in a persistent shader cache.
+ *
+ * If data_size is non-zero when the module is compiled, the code in data
+ * is loaded (and relocated) instead of running codegen.  Otherwise data
+ * is filled in with the newly generated object, unless the module
+ * referenced absolute addresses which can't be reused by another process
+ * (dont_cache).  The caller owns data and must free() it.
+ */
+struct lp_cached_code {
+   void *data;
+   size_t data_size;
+   boolean dont_cache;
+   void *jit_obj_cache;
+};
+
+struct lp_jit_module;
+
 struct gallivm_state
 {
    char *module_name;
@@ -50,7 +68,35 @@ struct gallivm_state
    LLVMBuilderRef builder;
    LLVMMCJITMemoryManagerRef memorymgr;
    struct lp_generated_code *code;
+   struct lp_jit_module *jit_module;   /**< code in the ORC JIT, if used */
+   struct lp_cached_code *cache;
    unsigned compiled;
+   /**
+    * Run only the passes required for correctness and no codegen
+    * optimizations, trading code quality for compile time.  May be set
+    * any time before gallivm_compile_module().
+    */
+   boolean no_opt;
+};
+
+
+/**
+ * Tiered compilation.  Drivers which can recompile a variant in the
+ * background first compile it with no_opt set (tier 0), and recompile it
+ * with all optimizations (tier 1) once it has been used this many times.
+ * Set with GALLIVM_TIER_UP_USES.
+ */
+extern unsigned gallivm_tier_up_uses;
+
+/**
+ * Time spent running the code of a variant at each tier, collected with
+ * GALLIVM_DEBUG=perf.
+ */
+struct gallivm_tier_stats
+{
+   int64_t compile_time[2];   /**< in nanoseconds, 0 if never compiled */
+   uint64_t calls[2];
+   uint64_t run_time[2];      /**< in nanoseconds */
 };
 
 
@@ -59,7 +105,8 @@ lp_build_init(void);
 
 
 struct gallivm_state *
-gallivm_create(const char *name, LLVMContextRef context);
+gallivm_create(const char *name, LLVMContextRef context,
+               struct lp_cached_code *cache);
 
 void
 gallivm_destroy(struct gallivm_state *gallivm);
@@ -78,6 +125,10 @@ func_pointer
 gallivm_jit_function(struct gallivm_state *gallivm,
                      LLVMValueRef func);
 
+void
+gallivm_print_tier_stats(const char *name,
+                         const struct gallivm_tier_stats *stats);
+
 #ifdef __cplusplus
 }
 #endif
@@ -55,6 +55,14 @@
 
 #define LP_MAX_TGSI_CONST_BUFFER_SIZE (LP_MAX_TGSI_CONSTS * sizeof(float[4]))
 
+/**
+ * Maximum number of shader buffers and images (fragment and compute
+ * shaders only for now).
+ */
+#define LP_MAX_TGSI_SHADER_BUFFERS 16
+
+#define LP_MAX_TGSI_SHADER_IMAGES 8
+
 /*
  * For quick access we cache registers in statically
  * allocated arrays. Here we define the maximum size
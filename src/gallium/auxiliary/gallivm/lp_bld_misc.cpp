@@ -79,11 +79,32 @@
 #include <llvm/IR/Module.h>
 #include <llvm/Support/CBindingWrapping.h>
 
+#if HAVE_LLVM >= 0x0306
+#include <llvm/ExecutionEngine/ObjectCache.h>
+#include <llvm/Support/MemoryBuffer.h>
+#endif
+
 #include <llvm/Config/llvm-config.h>
 #if LLVM_USE_INTEL_JITEVENTS
 #include <llvm/ExecutionEngine/JITEventListener.h>
 #endif
 
+#include "lp_bld_misc.h"
+
+#if GALLIVM_HAVE_ORC
+#include <llvm/ExecutionEngine/Orc/CompileUtils.h>
+#include <llvm/ExecutionEngine/Orc/Core.h>
+#include <llvm/ExecutionEngine/Orc/Legacy.h>
+#include <llvm/ExecutionEngine/Orc/RTDyldObjectLinkingLayer.h>
+#include <llvm/IR/Mangler.h>
+#include <llvm/IR/ModuleSlotTracker.h>
+#include <llvm/Support/raw_ostream.h>
+#include <llvm/Target/TargetMachine.h>
+#include <algorithm>
+#include <map>
+#include <vector>
+#endif
+
 // Workaround http://llvm.org/PR23628
 #if HAVE_LLVM >= 0x0307
 #  pragma pop_macro("DEBUG")
@@ -92,11 +113,12 @@
 #include "c11/threads.h"
 #include "os/os_thread.h"
 #include "pipe/p_config.h"
+#include "util/mesa-sha1.h"
 #include "util/u_debug.h"
 #include "util/u_cpu_detect.h"
 
-#include "lp_bld_misc.h"
 #include "lp_bld_debug.h"
+#include "lp_bld_init.h"
 
 namespace {
 
@@ -473,35 +495,72 @@ class ShaderMemoryManager : public DelegatingJITMemoryManager {
 };
 
 
+#if HAVE_LLVM >= 0x0306
 /**
- * Same as LLVMCreateJITCompilerForModule, but:
- * - allows using MCJIT and enabling AVX feature where available.
- * - set target options
+ * MCJIT object cache backed by a struct lp_cached_code.
  *
- * See also:
- * - llvm/lib/ExecutionEngine/ExecutionEngineBindings.cpp
- * - llvm/tools/lli/lli.cpp
- * - http://markmail.org/message/ttkuhvgj4cxxy2on#query:+page:1+mid:aju2dggerju3ivd3+state:results
+ * If the lp_cached_code already holds an object, MCJIT loads and relocates
+ * it instead of running codegen.  Otherwise the freshly generated object is
+ * copied out so the caller can store it in a persistent cache.
  */
-extern "C"
-LLVMBool
-lp_build_create_jit_compiler_for_module(LLVMExecutionEngineRef *OutJIT,
-                                        lp_generated_code **OutCode,
-                                        LLVMModuleRef M,
-                                        LLVMMCJITMemoryManagerRef CMM,
-                                        unsigned OptLevel,
-                                        int useMCJIT,
-                                        char **OutError)
-{
-   using namespace llvm;
+class LPObjectCache : public llvm::ObjectCache {
+private:
+   bool has_object;
+   struct lp_cached_code *cache_out;
 
-   std::string Error;
-#if HAVE_LLVM >= 0x0306
-   EngineBuilder builder(std::unique_ptr<Module>(unwrap(M)));
-#else
-   EngineBuilder builder(unwrap(M));
+public:
+   LPObjectCache(struct lp_cached_code *cache)
+   {
+      cache_out = cache;
+      has_object = false;
+   }
+
+   ~LPObjectCache()
+   {
+   }
+
+   void notifyObjectCompiled(const llvm::Module *M,
+                             llvm::MemoryBufferRef Obj)
+   {
+      /* Modules are compiled exactly once */
+      assert(!has_object);
+      has_object = true;
+
+      if (cache_out->dont_cache)
+         return;
+
+      cache_out->data_size = Obj.getBufferSize();
+      cache_out->data = malloc(cache_out->data_size);
+      if (!cache_out->data) {
+         cache_out->data_size = 0;
+         return;
+      }
+      memcpy(cache_out->data, Obj.getBufferStart(), cache_out->data_size);
+   }
+
+   std::unique_ptr<llvm::MemoryBuffer> getObject(const llvm::Module *M)
+   {
+      if (cache_out->data_size) {
+         return llvm::MemoryBuffer::getMemBuffer(
+            llvm::StringRef((const char *)cache_out->data,
+                            cache_out->data_size),
+            "", false);
+      }
+      return NULL;
+   }
+};
 #endif
 
+
+/**
+ * Set up the target options, CPU and features of the code generated for
+ * the host, shared by the MCJIT and ORC JIT paths.
+ */
+static void
+setup_engine_builder(llvm::EngineBuilder &builder, unsigned OptLevel)
+{
+   using namespace llvm;
+
    /**
     * LLVM 3.1+ haven't more "extern unsigned llvm::StackAlignmentOverride" and
     * friends for configuring code generation options, like stack alignment.
@@ -530,30 +589,9 @@ lp_build_create_jit_compiler_for_module(LLVMExecutionEngineRef *OutJIT,
 #endif
 
    builder.setEngineKind(EngineKind::JIT)
-          .setErrorStr(&Error)
           .setTargetOptions(options)
           .setOptLevel((CodeGenOpt::Level)OptLevel);
 
-   if (useMCJIT) {
-#if HAVE_LLVM < 0x0306
-       builder.setUseMCJIT(true);
-#endif
-#ifdef _WIN32
-       /*
-        * MCJIT works on Windows, but currently only through ELF object format.
-        *
-        * XXX: We could use `LLVM_HOST_TRIPLE "-elf"` but LLVM_HOST_TRIPLE has
-        * different strings for MinGW/MSVC, so better play it safe and be
-        * explicit.
-        */
-#  ifdef _WIN64
-       LLVMSetTarget(M, "x86_64-pc-win32-elf");
-#  else
-       LLVMSetTarget(M, "i686-pc-win32-elf");
-#  endif
-#endif
-   }
-
    llvm::SmallVector<std::string, 16> MAttrs;
 
 #if defined(PIPE_ARCH_X86) || defined(PIPE_ARCH_X86_64)
@@ -612,11 +650,20 @@ lp_build_create_jit_compiler_for_module(LLVMExecutionEngineRef *OutJIT,
       MAttrs.push_back("-fma");
    }
    MAttrs.push_back(util_cpu_caps.has_avx2 ? "+avx2" : "-avx2");
-   /* disable avx512 and all subvariants */
+   /*
+    * Disable avx512 subvariants.  Only the foundation is enabled, for the
+    * 512-bit vectors of the 16-wide llvmpipe fragment shaders; without
+    * avx512vl the narrower vectors keep their AVX/AVX2 encodings.
+    * llvmpipe clears has_avx512f when it doesn't use that mode.
+    */
 #if HAVE_LLVM >= 0x0304
    MAttrs.push_back("-avx512cd");
    MAttrs.push_back("-avx512er");
+#if HAVE_LLVM >= 0x0309
+   MAttrs.push_back(util_cpu_caps.has_avx512f ? "+avx512f" : "-avx512f");
+#else
    MAttrs.push_back("-avx512f");
+#endif
    MAttrs.push_back("-avx512pf");
 #endif
 #if HAVE_LLVM >= 0x0305
@@ -704,6 +751,61 @@ lp_build_create_jit_compiler_for_module(LLVMExecutionEngineRef *OutJIT,
       debug_printf("llc -mcpu option: %s\n", MCPU.str().c_str());
    }
 #endif
+}
+
+
+/**
+ * Same as LLVMCreateJITCompilerForModule, but:
+ * - allows using MCJIT and enabling AVX feature where available.
+ * - set target options
+ *
+ * See also:
+ * - llvm/lib/ExecutionEngine/ExecutionEngineBindings.cpp
+ * - llvm/tools/lli/lli.cpp
+ * - http://markmail.org/message/ttkuhvgj4cxxy2on#query:+page:1+mid:aju2dggerju3ivd3+state:results
+ */
+extern "C"
+LLVMBool
+lp_build_create_jit_compiler_for_module(LLVMExecutionEngineRef *OutJIT,
+                                        lp_generated_code **OutCode,
+                                        struct lp_cached_code *cache_out,
+                                        LLVMModuleRef M,
+                                        LLVMMCJITMemoryManagerRef CMM,
+                                        unsigned OptLevel,
+                                        int useMCJIT,
+                                        char **OutError)
+{
+   using namespace llvm;
+
+   std::string Error;
+#if HAVE_LLVM >= 0x0306
+   EngineBuilder builder(std::unique_ptr<Module>(unwrap(M)));
+#else
+   EngineBuilder builder(unwrap(M));
+#endif
+
+   builder.setErrorStr(&Error);
+   setup_engine_builder(builder, OptLevel);
+
+   if (useMCJIT) {
+#if HAVE_LLVM < 0x0306
+       builder.setUseMCJIT(true);
+#endif
+#ifdef _WIN32
+       /*
+        * MCJIT works on Windows, but currently only through ELF object format.
+        *
+        * XXX: We could use `LLVM_HOST_TRIPLE "-elf"` but LLVM_HOST_TRIPLE has
+        * different strings for MinGW/MSVC, so better play it safe and be
+        * explicit.
+        */
+#  ifdef _WIN64
+       LLVMSetTarget(M, "x86_64-pc-win32-elf");
+#  else
+       LLVMSetTarget(M, "i686-pc-win32-elf");
+#  endif
+#endif
+   }
 
    ShaderMemoryManager *MM = NULL;
    if (useMCJIT) {
@@ -739,6 +841,13 @@ lp_build_create_jit_compiler_for_module(LLVMExecutionEngineRef *OutJIT,
    JIT->RegisterJITEventListener(JEL);
 #endif
    if (JIT) {
+#if HAVE_LLVM >= 0x0306
+      if (cache_out && useMCJIT) {
+         LPObjectCache *objcache = new LPObjectCache(cache_out);
+         JIT->setObjectCache(objcache);
+         cache_out->jit_obj_cache = (void *)objcache;
+      }
+#endif
       *OutJIT = wrap(JIT);
       return 0;
    }
@@ -757,6 +866,16 @@ lp_free_generated_code(struct lp_generated_code *code)
    ShaderMemoryManager::freeGeneratedCode(code);
 }
 
+extern "C"
+void
+lp_free_objcache(void *objcache_ptr)
+{
+#if HAVE_LLVM >= 0x0306
+   LPObjectCache *objcache = (LPObjectCache *)objcache_ptr;
+   delete objcache;
+#endif
+}
+
 extern "C"
 LLVMMCJITMemoryManagerRef
 lp_get_default_memory_manager()
@@ -798,3 +917,574 @@ lp_is_function(LLVMValueRef v)
 	return llvm::isa<llvm::Function>(llvm::unwrap(v));
 #endif
 }
+
+
+#if GALLIVM_HAVE_ORC
+
+#if HAVE_LLVM >= 0x0800
+typedef llvm::orc::LegacyRTDyldObjectLinkingLayer LPObjectLayer;
+#else
+typedef llvm::orc::RTDyldObjectLinkingLayer LPObjectLayer;
+#endif
+
+
+/**
+ * The machine code of one gallivm module in the process wide ORC JIT.
+ */
+struct lp_jit_module {
+   llvm::orc::VModuleKey key;
+   bool added;      /**< object handed to the linking layer */
+   bool released;   /**< lp_orc_release_module() was called */
+   unsigned users;  /**< number of modules calling functions defined here */
+
+   /** Shared function symbols defined by this module */
+   std::vector<std::string> exports;
+   /** Modules defining the shared functions this module calls */
+   std::vector<struct lp_jit_module *> imports;
+
+   lp_jit_module() : key(0), added(false), released(false), users(0) {}
+};
+
+
+/**
+ * ORC JIT shared by all gallivm modules of the process.
+ *
+ * Codegen runs in the thread calling lp_orc_add_module() and the resulting
+ * objects are only linked, relocated and made executable under the lock
+ * when a function is first looked up.  Every object has its own memory
+ * manager, so its code is freed as soon as the module is released.
+ *
+ * Internal helper functions which don't depend on anything but their own
+ * body (texture sampling, format conversion) are given a name derived from
+ * a hash of their code.  The first module defining such a function exports
+ * it and later modules just call it, keeping their defining module alive
+ * until they are released themselves.
+ */
+class LPOrcJIT {
+public:
+   llvm::orc::ExecutionSession ES;
+   std::shared_ptr<llvm::orc::SymbolResolver> Resolver;
+   LPObjectLayer ObjectLayer;
+   const llvm::DataLayout DL;
+
+   /** Owner of each shared function symbol, by mangled name */
+   std::map<std::string, struct lp_jit_module *> SharedFunctions;
+
+   /**
+    * Target machines not used by any thread, by optimization level.  A
+    * target machine can't run codegen in several threads at once, so every
+    * lp_orc_add_module() call takes one for itself.
+    */
+   std::vector<llvm::TargetMachine *> IdleTargetMachines[llvm::CodeGenOpt::Aggressive + 1];
+
+   mtx_t mutex;
+
+   LPOrcJIT(llvm::TargetMachine &TM) :
+      Resolver(llvm::orc::createLegacyLookupResolver(
+                  ES,
+                  [this](const std::string &Name) {
+                     return findSymbol(Name);
+                  },
+                  [](llvm::Error Err) {
+                     llvm::cantFail(std::move(Err), "lookup failed");
+                  })),
+      ObjectLayer(ES,
+                  [this](llvm::orc::VModuleKey) {
+                     return LPObjectLayer::Resources{
+                        std::make_shared<llvm::SectionMemoryManager>(),
+                        Resolver};
+                  }),
+      DL(TM.createDataLayout())
+   {
+      mtx_init(&mutex, mtx_plain);
+   }
+
+   std::string mangle(llvm::StringRef Name)
+   {
+      std::string Mangled;
+      llvm::raw_string_ostream os(Mangled);
+      llvm::Mangler::getNameWithPrefix(os, Name, DL);
+      return os.str();
+   }
+
+   /*
+    * Symbol resolution for the relocation of an object.  Only called with
+    * the lock held.
+    */
+   llvm::JITSymbol findSymbol(const std::string &Name)
+   {
+      std::map<std::string, struct lp_jit_module *>::iterator it =
+         SharedFunctions.find(Name);
+      if (it != SharedFunctions.end() && it->second->added)
+         return ObjectLayer.findSymbolIn(it->second->key, Name, false);
+
+      if (uint64_t Addr =
+          llvm::RTDyldMemoryManager::getSymbolAddressInProcess(Name))
+         return llvm::JITSymbol(Addr, llvm::JITSymbolFlags::Exported);
+
+      return nullptr;
+   }
+
+   /*
+    * Free the code of a module nobody uses anymore, and of the modules it
+    * was the last user of.  Only called with the lock held.
+    */
+   void destroy(struct lp_jit_module *jm)
+   {
+      if (jm->added) {
+         llvm::cantFail(ObjectLayer.removeObject(jm->key));
+         ES.releaseVModule(jm->key);
+      }
+
+      for (size_t i = 0; i < jm->exports.size(); i++) {
+         std::map<std::string, struct lp_jit_module *>::iterator it =
+            SharedFunctions.find(jm->exports[i]);
+         if (it != SharedFunctions.end() && it->second == jm)
+            SharedFunctions.erase(it);
+      }
+
+      for (size_t i = 0; i < jm->imports.size(); i++) {
+         struct lp_jit_module *owner = jm->imports[i];
+         assert(owner->users);
+         if (--owner->users == 0 && owner->released)
+            destroy(owner);
+      }
+
+      delete jm;
+   }
+};
+
+static LPOrcJIT *orc_jit = NULL;
+static once_flag orc_jit_once_flag = ONCE_FLAG_INIT;
+
+
+static llvm::TargetMachine *
+create_target_machine(unsigned OptLevel, std::string &Error)
+{
+   llvm::EngineBuilder builder;
+
+   builder.setErrorStr(&Error);
+   setup_engine_builder(builder, OptLevel);
+
+   return builder.selectTarget();
+}
+
+
+static void
+init_orc_jit(void)
+{
+   std::string Error;
+   llvm::TargetMachine *TM =
+      create_target_machine(llvm::CodeGenOpt::Default, Error);
+
+   if (!TM) {
+      _debug_printf("gallivm: no ORC JIT target: %s\n", Error.c_str());
+      return;
+   }
+
+   orc_jit = new LPOrcJIT(*TM);
+   orc_jit->IdleTargetMachines[llvm::CodeGenOpt::Default].push_back(TM);
+}
+
+
+static llvm::TargetMachine *
+acquire_target_machine(LPOrcJIT *jit, unsigned OptLevel, std::string &Error)
+{
+   llvm::TargetMachine *TM = NULL;
+
+   assert(OptLevel < ARRAY_SIZE(jit->IdleTargetMachines));
+
+   mtx_lock(&jit->mutex);
+   if (!jit->IdleTargetMachines[OptLevel].empty()) {
+      TM = jit->IdleTargetMachines[OptLevel].back();
+      jit->IdleTargetMachines[OptLevel].pop_back();
+   }
+   mtx_unlock(&jit->mutex);
+
+   if (!TM)
+      TM = create_target_machine(OptLevel, Error);
+
+   return TM;
+}
+
+
+static void
+release_target_machine(LPOrcJIT *jit, unsigned OptLevel,
+                       llvm::TargetMachine *TM)
+{
+   mtx_lock(&jit->mutex);
+   jit->IdleTargetMachines[OptLevel].push_back(TM);
+   mtx_unlock(&jit->mutex);
+}
+
+
+/*
+ * Collect the definitions of the named struct types used by T, which are
+ * only printed by name in the IR.
+ */
+static void
+print_struct_bodies(llvm::Type *T,
+                    llvm::SmallPtrSetImpl<llvm::Type *> &visited,
+                    llvm::raw_ostream &os)
+{
+   if (!visited.insert(T).second)
+      return;
+
+   if (llvm::StructType *ST = llvm::dyn_cast<llvm::StructType>(T)) {
+      if (ST->hasName()) {
+         os << ST->getName() << " = { ";
+         for (unsigned i = 0; i < ST->getNumElements(); i++) {
+            ST->getElementType(i)->print(os);
+            os << ", ";
+         }
+         os << (ST->isPacked() ? "} packed\n" : "}\n");
+      }
+   }
+
+   for (unsigned i = 0; i < T->getNumContainedTypes(); i++)
+      print_struct_bodies(T->getContainedType(i), visited, os);
+}
+
+
+/**
+ * Whether the code of F only depends on its own body, so that any function
+ * with the same IR can call one shared copy of it instead.
+ */
+static bool
+is_shareable_function(const llvm::Function &F)
+{
+   using namespace llvm;
+
+   if (F.isDeclaration() || !F.hasLocalLinkage() || F.hasAddressTaken() ||
+       F.hasPersonalityFn() || F.hasPrefixData() || F.hasPrologueData())
+      return false;
+
+   for (const BasicBlock &BB : F) {
+      for (const Instruction &I : BB) {
+         SmallVector<std::pair<unsigned, MDNode *>, 4> MDs;
+         I.getAllMetadataOtherThanDebugLoc(MDs);
+         if (!MDs.empty())
+            return false;
+
+         for (const Use &U : I.operands()) {
+            SmallVector<const Value *, 8> worklist;
+            worklist.push_back(U.get());
+            while (!worklist.empty()) {
+               const Value *V = worklist.pop_back_val();
+               if (const Function *Callee = dyn_cast<Function>(V)) {
+                  /* Only calls to external functions and intrinsics */
+                  if (!Callee->isDeclaration())
+                     return false;
+               } else if (isa<GlobalValue>(V) || isa<BlockAddress>(V)) {
+                  return false;
+               } else if (const ConstantExpr *CE = dyn_cast<ConstantExpr>(V)) {
+                  for (const Use &Op : CE->operands())
+                     worklist.push_back(Op.get());
+               }
+            }
+         }
+      }
+   }
+
+   return true;
+}
+
+
+/**
+ * Name of a shareable function, derived from everything its machine code
+ * depends on: its IR and the codegen optimization level, which also tells
+ * the two compile tiers apart.
+ */
+static std::string
+shared_function_name(llvm::Function &F, unsigned OptLevel)
+{
+   using namespace llvm;
+
+   std::string text;
+   raw_string_ostream os(text);
+   SmallPtrSet<Type *, 16> visited;
+   ModuleSlotTracker MST(F.getParent(), false);
+
+   MST.incorporateFunction(F);
+
+   os << "O" << OptLevel << '\n';
+   os << F.getCallingConv() << ' ';
+   F.getFunctionType()->print(os);
+   os << '\n' << F.getAttributes().getAsString(AttributeList::FunctionIndex);
+   for (unsigned i = 0; i <= F.arg_size(); i++)
+      os << '\n' << F.getAttributes().getAsString(i);
+   os << '\n';
+   print_struct_bodies(F.getFunctionType(), visited, os);
+
+   for (const BasicBlock &BB : F) {
+      for (const Instruction &I : BB) {
+         I.print(os, MST);
+         os << '\n';
+         /* The attribute groups are only printed as per module numbers */
+         if (ImmutableCallSite CS = ImmutableCallSite(&I)) {
+            const AttributeList &Attrs = CS.getAttributes();
+            for (unsigned i = AttributeList::ReturnIndex;
+                 i <= CS.arg_size(); i++)
+               os << Attrs.getAsString(i) << ';';
+            os << Attrs.getAsString(AttributeList::FunctionIndex) << '\n';
+         }
+         print_struct_bodies(I.getType(), visited, os);
+         for (const Use &U : I.operands())
+            print_struct_bodies(U->getType(), visited, os);
+         if (const AllocaInst *AI = dyn_cast<AllocaInst>(&I))
+            print_struct_bodies(AI->getAllocatedType(), visited, os);
+         if (const GetElementPtrInst *GEP = dyn_cast<GetElementPtrInst>(&I))
+            print_struct_bodies(GEP->getSourceElementType(), visited, os);
+      }
+   }
+   os.flush();
+
+   unsigned char sha1[20];
+   char sha1_str[41];
+   _mesa_sha1_compute(text.data(), text.size(), sha1);
+   _mesa_sha1_format(sha1_str, sha1);
+
+   return std::string("lp_shared_") + sha1_str;
+}
+
+
+/*
+ * Give the shareable functions of M their shared names, and replace the
+ * ones some other module already defines by declarations.
+ */
+static void
+share_functions(LPOrcJIT *jit, llvm::Module &M, unsigned OptLevel,
+                struct lp_jit_module *jm)
+{
+   using namespace llvm;
+
+   std::vector<Function *> shared;
+
+   for (Module::iterator F = M.begin(); F != M.end(); ) {
+      Function &Func = *F++;
+
+      if (!is_shareable_function(Func))
+         continue;
+
+      std::string name = shared_function_name(Func, OptLevel);
+      Function *Existing = M.getFunction(name);
+      if (Existing) {
+         /* Identical helpers for different texture units */
+         Func.replaceAllUsesWith(Existing);
+         Func.eraseFromParent();
+         continue;
+      }
+
+      Func.setName(name);
+      shared.push_back(&Func);
+   }
+
+   if (shared.empty())
+      return;
+
+   mtx_lock(&jit->mutex);
+
+   for (size_t i = 0; i < shared.size(); i++) {
+      Function *F = shared[i];
+      std::string mangled = jit->mangle(F->getName());
+      std::map<std::string, struct lp_jit_module *>::iterator it =
+         jit->SharedFunctions.find(mangled);
+
+      if (it == jit->SharedFunctions.end()) {
+         jit->SharedFunctions[mangled] = jm;
+         jm->exports.push_back(mangled);
+         F->setLinkage(GlobalValue::ExternalLinkage);
+         F->setVisibility(GlobalValue::DefaultVisibility);
+      } else if (it->second->added) {
+         struct lp_jit_module *owner = it->second;
+         F->deleteBody();
+         F->setDSOLocal(false);
+         if (std::find(jm->imports.begin(), jm->imports.end(), owner) ==
+             jm->imports.end()) {
+            jm->imports.push_back(owner);
+            owner->users++;
+         }
+      }
+      /*
+       * Otherwise the defining module is still being compiled by another
+       * thread, keep a private copy.
+       */
+   }
+
+   mtx_unlock(&jit->mutex);
+}
+
+
+extern "C" bool
+lp_orc_init(void)
+{
+   call_once(&orc_jit_once_flag, init_orc_jit);
+   return orc_jit != NULL;
+}
+
+
+/**
+ * Generate the machine code of a module and add it to the process wide JIT.
+ * The module itself stays owned by the caller.
+ *
+ * The cache is handled like MCJIT does with LPObjectCache.  Modules whose
+ * object may be stored in a persistent cache keep private copies of all
+ * their functions, as the object must be loadable by another process.
+ */
+extern "C" struct lp_jit_module *
+lp_orc_add_module(LLVMModuleRef MRef,
+                  struct lp_cached_code *cache,
+                  unsigned OptLevel,
+                  char **OutError)
+{
+   using namespace llvm;
+
+   LPOrcJIT *jit = orc_jit;
+   Module *M = unwrap(MRef);
+   std::string ErrorStr;
+
+   assert(jit);
+
+   TargetMachine *TM = acquire_target_machine(jit, OptLevel, ErrorStr);
+   if (!TM) {
+      *OutError = strdup(ErrorStr.c_str());
+      return NULL;
+   }
+
+   M->setDataLayout(TM->createDataLayout());
+   M->setTargetTriple(TM->getTargetTriple().str());
+
+   struct lp_jit_module *jm = new lp_jit_module();
+
+   if (!cache || cache->dont_cache)
+      share_functions(jit, *M, OptLevel, jm);
+
+   std::unique_ptr<MemoryBuffer> Obj;
+   if (cache) {
+      bool cache_hit = cache->data_size != 0;
+      LPObjectCache objcache(cache);
+      orc::SimpleCompiler compile(*TM, &objcache);
+
+      Obj = compile(*M);
+      /* Don't keep referencing the caller's copy */
+      if (cache_hit && Obj)
+         Obj = MemoryBuffer::getMemBufferCopy(Obj->getBuffer());
+   } else {
+      orc::SimpleCompiler compile(*TM);
+
+      Obj = compile(*M);
+   }
+
+   release_target_machine(jit, OptLevel, TM);
+
+   mtx_lock(&jit->mutex);
+
+   if (Obj) {
+      jm->key = jit->ES.allocateVModule();
+      if (Error Err = jit->ObjectLayer.addObject(jm->key, std::move(Obj))) {
+         raw_string_ostream os(ErrorStr);
+         os << Err;
+         os.flush();
+         consumeError(std::move(Err));
+         jit->ES.releaseVModule(jm->key);
+      } else {
+         jm->added = true;
+      }
+   } else {
+      ErrorStr = "codegen failed";
+   }
+
+   if (!jm->added) {
+      jit->destroy(jm);
+      jm = NULL;
+      *OutError = strdup(ErrorStr.c_str());
+   }
+
+   mtx_unlock(&jit->mutex);
+
+   return jm;
+}
+
+
+/**
+ * Address of an external function of the module.  The module's object is
+ * linked and made executable by the first lookup.
+ */
+extern "C" void *
+lp_orc_get_function_address(struct lp_jit_module *jm, const char *name)
+{
+   LPOrcJIT *jit = orc_jit;
+   void *code = NULL;
+
+   mtx_lock(&jit->mutex);
+
+   llvm::JITSymbol Sym =
+      jit->ObjectLayer.findSymbolIn(jm->key, jit->mangle(name), false);
+   if (llvm::Error Err = Sym.takeError()) {
+      llvm::consumeError(std::move(Err));
+   } else if (Sym) {
+      llvm::Expected<llvm::JITTargetAddress> Addr = Sym.getAddress();
+      if (Addr)
+         code = (void *)(uintptr_t)*Addr;
+      else
+         llvm::consumeError(Addr.takeError());
+   }
+
+   mtx_unlock(&jit->mutex);
+
+   return code;
+}
+
+
+/**
+ * Release a module's machine code.  Shared functions it defines stay
+ * around until the last module calling them is released too.
+ */
+extern "C" void
+lp_orc_release_module(struct lp_jit_module *jm)
+{
+   LPOrcJIT *jit = orc_jit;
+
+   mtx_lock(&jit->mutex);
+
+   assert(!jm->released);
+   jm->released = true;
+   if (!jm->users)
+      jit->destroy(jm);
+
+   mtx_unlock(&jit->mutex);
+}
+
+#else /* !GALLIVM_HAVE_ORC */
+
+extern "C" bool
+lp_orc_init(void)
+{
+   return false;
+}
+
+extern "C" struct lp_jit_module *
+lp_orc_add_module(LLVMModuleRef M,
+                  struct lp_cached_code *cache,
+                  unsigned OptLevel,
+                  char **OutError)
+{
+   assert(0);
+   *OutError = strdup("ORC JIT not available");
+   return NULL;
+}
+
+extern "C" void *
+lp_orc_get_function_address(struct lp_jit_module *module, const char *name)
+{
+   assert(0);
+   return NULL;
+}
+
+extern "C" void
+lp_orc_release_module(struct lp_jit_module *module)
+{
+   assert(0);
+}
+
+#endif /* !GALLIVM_HAVE_ORC */
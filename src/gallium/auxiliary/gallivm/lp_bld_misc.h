@@ -35,12 +35,26 @@
 #include <llvm-c/Target.h>
 
 
+/*
+ * The ORC JIT is written against the legacy object linking layer, which
+ * only exists in this form in LLVM 7 to 11, and hashes functions with the
+ * CallSite wrappers that LLVM 11 removed.
+ */
+#if HAVE_LLVM >= 0x0700 && HAVE_LLVM < 0x0b00 && !defined(_WIN32)
+#define GALLIVM_HAVE_ORC 1
+#else
+#define GALLIVM_HAVE_ORC 0
+#endif
+
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
 
 struct lp_generated_code;
+struct lp_cached_code;
+struct lp_jit_module;
 
 extern LLVMTargetLibraryInfoRef
 gallivm_create_target_library_info(const char *triple);
@@ -55,6 +69,7 @@ lp_set_target_options(void);
 extern int
 lp_build_create_jit_compiler_for_module(LLVMExecutionEngineRef *OutJIT,
                                         struct lp_generated_code **OutCode,
+                                        struct lp_cached_code *cache_out,
                                         LLVMModuleRef M,
                                         LLVMMCJITMemoryManagerRef MM,
                                         unsigned OptLevel,
@@ -64,12 +79,30 @@ lp_build_create_jit_compiler_for_module(LLVMExecutionEngineRef *OutJIT,
 extern void
 lp_free_generated_code(struct lp_generated_code *code);
 
+extern void
+lp_free_objcache(void *objcache);
+
 extern LLVMMCJITMemoryManagerRef
 lp_get_default_memory_manager();
 
 extern void
 lp_free_memory_manager(LLVMMCJITMemoryManagerRef memorymgr);
 
+extern bool
+lp_orc_init(void);
+
+extern struct lp_jit_module *
+lp_orc_add_module(LLVMModuleRef M,
+                  struct lp_cached_code *cache,
+                  unsigned OptLevel,
+                  char **OutError);
+
+extern void *
+lp_orc_get_function_address(struct lp_jit_module *module, const char *name);
+
+extern void
+lp_orc_release_module(struct lp_jit_module *module);
+
 extern LLVMValueRef
 lp_get_called_value(LLVMValueRef call);
 
@@ -2023,16 +2023,67 @@ lp_build_sample_partial_offset(struct lp_build_context *bld,
 }
 
 
+/**
+ * Partial offset along the x or y axis for textures stored in
+ * LP_SAMPLER_TILE_SIZE x LP_SAMPLER_TILE_SIZE texel tiles.
+ *
+ * The tiles are stored row by row, and the texels of a tile are stored
+ * contiguously, so the offset remains separable into x and y parts:
+ *
+ *   x: ((x & ~3) * 4 + (x & 3)) * texel_bytes
+ *   y: (y & ~3) * row_stride + (y & 3) * 4 * texel_bytes
+ *
+ * \param texel_bytes  size of a texel (block formats are never tiled)
+ * \param y_axis  whether coord is the y coordinate
+ * \param row_stride  row stride, only used for the y axis
+ */
+void
+lp_build_sample_tiled_partial_offset(struct lp_build_context *bld,
+                                     unsigned texel_bytes,
+                                     boolean y_axis,
+                                     LLVMValueRef coord,
+                                     LLVMValueRef row_stride,
+                                     LLVMValueRef *out_offset)
+{
+   LLVMBuilderRef builder = bld->gallivm->builder;
+   LLVMValueRef tile_mask = lp_build_const_int_vec(bld->gallivm, bld->type,
+                                                   LP_SAMPLER_TILE_SIZE - 1);
+   LLVMValueRef subcoord, tilecoord, offset;
+
+   subcoord = LLVMBuildAnd(builder, coord, tile_mask, "");
+   tilecoord = LLVMBuildXor(builder, coord, subcoord, "");
+
+   if (y_axis) {
+      assert(row_stride);
+      offset = lp_build_mul(bld, tilecoord, row_stride);
+      subcoord = lp_build_mul_imm(bld, subcoord,
+                                  LP_SAMPLER_TILE_SIZE * texel_bytes);
+      offset = lp_build_add(bld, offset, subcoord);
+   }
+   else {
+      tilecoord = lp_build_shl_imm(bld, tilecoord,
+                                   util_logbase2(LP_SAMPLER_TILE_SIZE));
+      offset = lp_build_add(bld, tilecoord, subcoord);
+      offset = lp_build_mul_imm(bld, offset, texel_bytes);
+   }
+
+   *out_offset = offset;
+}
+
+
 /**
  * Compute the offset of a pixel block.
  *
  * x, y, z, y_stride, z_stride are vectors, and they refer to pixels.
+ * If tiled is set the texture uses the tiled layout described in
+ * lp_build_sample_tiled_partial_offset().
  *
  * Returns the relative offset and i,j sub-block coordinates
  */
 void
 lp_build_sample_offset(struct lp_build_context *bld,
                        const struct util_format_description *format_desc,
+                       boolean tiled,
                        LLVMValueRef x,
                        LLVMValueRef y,
                        LLVMValueRef z,
@@ -2045,24 +2096,45 @@ lp_build_sample_offset(struct lp_build_context *bld,
    LLVMValueRef x_stride;
    LLVMValueRef offset;
 
-   x_stride = lp_build_const_vec(bld->gallivm, bld->type,
-                                 format_desc->block.bits/8);
-
-   lp_build_sample_partial_offset(bld,
-                                  format_desc->block.width,
-                                  x, x_stride,
-                                  &offset, out_i);
-
-   if (y && y_stride) {
-      LLVMValueRef y_offset;
-      lp_build_sample_partial_offset(bld,
-                                     format_desc->block.height,
-                                     y, y_stride,
-                                     &y_offset, out_j);
-      offset = lp_build_add(bld, offset, y_offset);
+   if (tiled) {
+      assert(format_desc->block.width == 1 && format_desc->block.height == 1);
+
+      lp_build_sample_tiled_partial_offset(bld,
+                                           format_desc->block.bits/8,
+                                           FALSE, x, NULL,
+                                           &offset);
+      *out_i = bld->zero;
+
+      if (y && y_stride) {
+         LLVMValueRef y_offset;
+         lp_build_sample_tiled_partial_offset(bld,
+                                              format_desc->block.bits/8,
+                                              TRUE, y, y_stride,
+                                              &y_offset);
+         offset = lp_build_add(bld, offset, y_offset);
+      }
+      *out_j = bld->zero;
    }
    else {
-      *out_j = bld->zero;
+      x_stride = lp_build_const_vec(bld->gallivm, bld->type,
+                                    format_desc->block.bits/8);
+
+      lp_build_sample_partial_offset(bld,
+                                     format_desc->block.width,
+                                     x, x_stride,
+                                     &offset, out_i);
+
+      if (y && y_stride) {
+         LLVMValueRef y_offset;
+         lp_build_sample_partial_offset(bld,
+                                        format_desc->block.height,
+                                        y, y_stride,
+                                        &y_offset, out_j);
+         offset = lp_build_add(bld, offset, y_offset);
+      }
+      else {
+         *out_j = bld->zero;
+      }
    }
 
    if (z && z_stride) {
@@ -96,6 +96,12 @@ enum lp_sampler_op_type {
 #define LP_SAMPLER_LOD_PROPERTY_SHIFT       6
 #define LP_SAMPLER_LOD_PROPERTY_MASK  (3 << 6)
 
+/**
+ * Width and height in texels of the tiles of textures with a tiled layout
+ * (see lp_static_texture_state::tiled).
+ */
+#define LP_SAMPLER_TILE_SIZE          4
+
 struct lp_sampler_params
 {
    struct lp_type type;
@@ -143,6 +149,7 @@ struct lp_static_texture_state
    unsigned pot_height:1;
    unsigned pot_depth:1;
    unsigned level_zero_only:1;
+   unsigned tiled:1;         /**< stored in LP_SAMPLER_TILE_SIZE^2 tiles? */
 };
 
 
@@ -590,9 +597,19 @@ lp_build_sample_partial_offset(struct lp_build_context *bld,
                                LLVMValueRef *out_i);
 
 
+void
+lp_build_sample_tiled_partial_offset(struct lp_build_context *bld,
+                                     unsigned texel_bytes,
+                                     boolean y_axis,
+                                     LLVMValueRef coord,
+                                     LLVMValueRef row_stride,
+                                     LLVMValueRef *out_offset);
+
+
 void
 lp_build_sample_offset(struct lp_build_context *bld,
                        const struct util_format_description *format_desc,
+                       boolean tiled,
                        LLVMValueRef x,
                        LLVMValueRef y,
                        LLVMValueRef z,
@@ -67,6 +67,7 @@ struct lp_build_mask_context;
 struct gallivm_state;
 struct lp_derivatives;
 struct lp_build_tgsi_gs_iface;
+struct lp_build_tgsi_mem_iface;
 
 
 enum lp_build_tex_modifier {
@@ -170,6 +171,11 @@ struct lp_bld_tgsi_system_values {
    LLVMValueRef prim_id;
    LLVMValueRef basevertex;
    LLVMValueRef invocation_id;
+   /* compute shaders: thread_id is a vector, the others are scalars */
+   LLVMValueRef thread_id[3];
+   LLVMValueRef block_id[3];
+   LLVMValueRef grid_size[3];
+   LLVMValueRef block_size[3];
 };
 
 
@@ -230,7 +236,8 @@ lp_build_tgsi_soa(struct gallivm_state *gallivm,
                   LLVMValueRef thread_data_ptr,
                   const struct lp_build_sampler_soa *sampler,
                   const struct tgsi_shader_info *info,
-                  const struct lp_build_tgsi_gs_iface *gs_iface);
+                  const struct lp_build_tgsi_gs_iface *gs_iface,
+                  const struct lp_build_tgsi_mem_iface *mem_iface);
 
 
 void
@@ -430,6 +437,58 @@ struct lp_build_tgsi_gs_iface
                        LLVMValueRef emitted_prims_vec);
 };
 
+/**
+ * An image bound to a shader, see lp_build_tgsi_mem_iface::fetch_image.
+ */
+struct lp_build_tgsi_image
+{
+   /** Format of the image view, PIPE_FORMAT_NONE if nothing is bound */
+   enum pipe_format format;
+
+   LLVMValueRef base_ptr;     /**< i8 pointer to the first texel */
+
+   /**
+    * Size of the image in texels.  For array images depth is the number of
+    * layers, and for 1D arrays height is 1.
+    */
+   LLVMValueRef width;
+   LLVMValueRef height;
+   LLVMValueRef depth;
+
+   LLVMValueRef row_stride;   /**< in bytes */
+   LLVMValueRef img_stride;   /**< in bytes, between layers or slices */
+};
+
+/**
+ * Memory interface: gives the TGSI translation access to the shader buffers
+ * and images, and for compute shaders to the shared memory and barriers of
+ * the current work group.  Callbacks which a shader stage doesn't need may
+ * be NULL.
+ *
+ * Pointers returned by fetch_buffer/fetch_shared must always point at
+ * valid memory of at least 4 bytes, even for unbound slots (size 0),
+ * since bounds checking is done by clamping the offset rather than with
+ * control flow.  The same goes for the base pointer of bound images.
+ */
+struct lp_build_tgsi_mem_iface
+{
+   void (*fetch_buffer)(const struct lp_build_tgsi_mem_iface *mem_iface,
+                        struct lp_build_tgsi_context * bld_base,
+                        unsigned index,
+                        LLVMValueRef *base_ptr,
+                        LLVMValueRef *size);
+   void (*fetch_image)(const struct lp_build_tgsi_mem_iface *mem_iface,
+                       struct lp_build_tgsi_context * bld_base,
+                       unsigned index,
+                       struct lp_build_tgsi_image *image);
+   void (*fetch_shared)(const struct lp_build_tgsi_mem_iface *mem_iface,
+                        struct lp_build_tgsi_context * bld_base,
+                        LLVMValueRef *base_ptr,
+                        LLVMValueRef *size);
+   void (*emit_barrier)(const struct lp_build_tgsi_mem_iface *mem_iface,
+                        struct lp_build_tgsi_context * bld_base);
+};
+
 struct lp_build_tgsi_soa_context
 {
    struct lp_build_tgsi_context bld_base;
@@ -443,6 +502,8 @@ struct lp_build_tgsi_soa_context
    LLVMValueRef emitted_vertices_vec_ptr;
    LLVMValueRef max_output_vertices_vec;
 
+   const struct lp_build_tgsi_mem_iface *mem_iface;
+
    LLVMValueRef consts_ptr;
    LLVMValueRef const_sizes_ptr;
    LLVMValueRef consts[LP_MAX_TGSI_CONST_BUFFERS];
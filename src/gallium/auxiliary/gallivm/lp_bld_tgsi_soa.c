@@ -39,6 +39,7 @@
 #include "pipe/p_config.h"
 #include "pipe/p_shader_tokens.h"
 #include "util/u_debug.h"
+#include "util/u_format.h"
 #include "util/u_math.h"
 #include "util/u_memory.h"
 #include "tgsi/tgsi_dump.h"
@@ -58,6 +59,7 @@
 #include "lp_bld_logic.h"
 #include "lp_bld_swizzle.h"
 #include "lp_bld_flow.h"
+#include "lp_bld_format.h"
 #include "lp_bld_quad.h"
 #include "lp_bld_tgsi.h"
 #include "lp_bld_limits.h"
@@ -1650,6 +1652,7 @@ emit_fetch_system_value(
    LLVMBuilderRef builder = gallivm->builder;
    LLVMValueRef res;
    enum tgsi_opcode_type atype; // Actual type of the value
+   unsigned swizzle = swizzle_in & 0xffff;
 
    assert(!reg->Register.Indirect);
 
@@ -1684,6 +1687,30 @@ emit_fetch_system_value(
       atype = TGSI_TYPE_UNSIGNED;
       break;
 
+   case TGSI_SEMANTIC_THREAD_ID:
+      res = swizzle < 3 ? bld->system_values.thread_id[swizzle] :
+                          bld_base->uint_bld.zero;
+      atype = TGSI_TYPE_UNSIGNED;
+      break;
+
+   case TGSI_SEMANTIC_BLOCK_ID:
+      res = swizzle < 3 ? lp_build_broadcast_scalar(&bld_base->uint_bld, bld->system_values.block_id[swizzle]) :
+                          bld_base->uint_bld.zero;
+      atype = TGSI_TYPE_UNSIGNED;
+      break;
+
+   case TGSI_SEMANTIC_GRID_SIZE:
+      res = swizzle < 3 ? lp_build_broadcast_scalar(&bld_base->uint_bld, bld->system_values.grid_size[swizzle]) :
+                          bld_base->uint_bld.one;
+      atype = TGSI_TYPE_UNSIGNED;
+      break;
+
+   case TGSI_SEMANTIC_BLOCK_SIZE:
+      res = swizzle < 3 ? lp_build_broadcast_scalar(&bld_base->uint_bld, bld->system_values.block_size[swizzle]) :
+                          bld_base->uint_bld.one;
+      atype = TGSI_TYPE_UNSIGNED;
+      break;
+
    default:
       assert(!"unexpected semantic in emit_fetch_system_value");
       res = bld_base->base.zero;
@@ -3494,6 +3521,580 @@ end_primitive(
    }
 }
 
+/**
+ * Get the base pointer (as a pointer to 32-bit elements) and the size in
+ * dwords of the shader buffer or shared memory referenced by a LOAD,
+ * STORE, ATOM* or RESQ instruction.
+ */
+static void
+get_memory_ptr(struct lp_build_tgsi_soa_context *bld,
+               unsigned file,
+               unsigned index,
+               LLVMTypeRef elem_type,
+               LLVMValueRef *base_ptr,
+               LLVMValueRef *num_dwords)
+{
+   struct gallivm_state *gallivm = bld->bld_base.base.gallivm;
+   LLVMBuilderRef builder = gallivm->builder;
+   LLVMValueRef ptr, size;
+
+   assert(bld->mem_iface);
+   if (file == TGSI_FILE_MEMORY) {
+      bld->mem_iface->fetch_shared(bld->mem_iface, &bld->bld_base, &ptr, &size);
+   } else {
+      assert(file == TGSI_FILE_BUFFER);
+      bld->mem_iface->fetch_buffer(bld->mem_iface, &bld->bld_base, index,
+                                   &ptr, &size);
+   }
+
+   *base_ptr = LLVMBuildBitCast(builder, ptr,
+                                LLVMPointerType(elem_type, 0), "");
+   size = LLVMBuildLShr(builder, size, lp_build_const_int32(gallivm, 2), "");
+   *num_dwords = lp_build_broadcast_scalar(&bld->bld_base.uint_bld, size);
+}
+
+/**
+ * Fetch the byte offset operand of a memory instruction and turn it into
+ * a vector of dword indices.
+ */
+static LLVMValueRef
+get_memory_index(struct lp_build_tgsi_context * bld_base,
+                 const struct tgsi_full_instruction *inst,
+                 unsigned src_op)
+{
+   struct lp_build_context *uint_bld = &bld_base->uint_bld;
+   LLVMBuilderRef builder = bld_base->base.gallivm->builder;
+   LLVMValueRef offset;
+
+   offset = lp_build_emit_fetch(bld_base, inst, src_op, TGSI_CHAN_X);
+   offset = LLVMBuildBitCast(builder, offset, uint_bld->vec_type, "");
+   return lp_build_shr_imm(uint_bld, offset, 2);
+}
+
+/**
+ * Get the image referenced by a memory instruction.  Returns the format
+ * description, or NULL if no image is bound, in which case loads and
+ * atomics return zero and stores are dropped.
+ */
+static const struct util_format_description *
+get_image(struct lp_build_tgsi_soa_context *bld,
+          unsigned index,
+          struct lp_build_tgsi_image *image)
+{
+   memset(image, 0, sizeof *image);
+
+   assert(bld->mem_iface && bld->mem_iface->fetch_image);
+   bld->mem_iface->fetch_image(bld->mem_iface, &bld->bld_base, index, image);
+
+   if (image->format == PIPE_FORMAT_NONE)
+      return NULL;
+
+   return util_format_description(image->format);
+}
+
+/**
+ * Compute the byte offsets of the texels addressed by the integer
+ * coordinates of an image instruction, and which of them are inside the
+ * image.  Out of bounds offsets are replaced with zero, so they can be
+ * fetched without control flow.
+ */
+static void
+get_image_offsets(struct lp_build_tgsi_context * bld_base,
+                  const struct tgsi_full_instruction *inst,
+                  unsigned coord_src,
+                  const struct util_format_description *format_desc,
+                  const struct lp_build_tgsi_image *image,
+                  LLVMValueRef *offsets,
+                  LLVMValueRef *in_bounds)
+{
+   struct gallivm_state *gallivm = bld_base->base.gallivm;
+   LLVMBuilderRef builder = gallivm->builder;
+   struct lp_build_context *uint_bld = &bld_base->uint_bld;
+   LLVMValueRef coords[3];
+   LLVMValueRef sizes[3];
+   LLVMValueRef strides[3];
+   unsigned num_coords, i;
+
+   strides[0] = lp_build_const_int_vec(gallivm, uint_bld->type,
+                                       format_desc->block.bits / 8);
+   strides[1] = lp_build_broadcast_scalar(uint_bld, image->row_stride);
+   strides[2] = lp_build_broadcast_scalar(uint_bld, image->img_stride);
+   sizes[0] = image->width;
+   sizes[1] = image->height;
+   sizes[2] = image->depth;
+
+   switch (inst->Memory.Texture) {
+   case TGSI_TEXTURE_BUFFER:
+   case TGSI_TEXTURE_1D:
+      num_coords = 1;
+      break;
+   case TGSI_TEXTURE_1D_ARRAY:
+      /* the layer is the second coordinate */
+      num_coords = 2;
+      strides[1] = strides[2];
+      sizes[1] = sizes[2];
+      break;
+   case TGSI_TEXTURE_2D:
+   case TGSI_TEXTURE_RECT:
+      num_coords = 2;
+      break;
+   case TGSI_TEXTURE_3D:
+   case TGSI_TEXTURE_2D_ARRAY:
+   case TGSI_TEXTURE_CUBE:
+   case TGSI_TEXTURE_CUBE_ARRAY:
+      /* the layer (or layer-face) is the third coordinate */
+      num_coords = 3;
+      break;
+   default:
+      assert(0);
+      num_coords = 1;
+      break;
+   }
+
+   *offsets = uint_bld->zero;
+   *in_bounds = lp_build_const_int_vec(gallivm, uint_bld->type, ~0);
+
+   for (i = 0; i < num_coords; i++) {
+      LLVMValueRef size;
+
+      coords[i] = lp_build_emit_fetch(bld_base, inst, coord_src, i);
+      coords[i] = LLVMBuildBitCast(builder, coords[i], uint_bld->vec_type, "");
+
+      /* negative coordinates are out of bounds as unsigned values */
+      size = lp_build_broadcast_scalar(uint_bld, sizes[i]);
+      *in_bounds = LLVMBuildAnd(builder, *in_bounds,
+                                lp_build_compare(gallivm, uint_bld->type,
+                                                 PIPE_FUNC_LESS,
+                                                 coords[i], size), "");
+      *offsets = lp_build_add(uint_bld, *offsets,
+                              lp_build_mul(uint_bld, coords[i], strides[i]));
+   }
+
+   *offsets = lp_build_select(uint_bld, *in_bounds, *offsets, uint_bld->zero);
+}
+
+/**
+ * Type of the rgba values of an image format: integers for pure integer
+ * formats, floats otherwise.
+ */
+static struct lp_type
+get_image_texel_type(struct lp_build_tgsi_context * bld_base,
+                     const struct util_format_description *format_desc)
+{
+   if (util_format_is_pure_sint(format_desc->format))
+      return bld_base->int_bld.type;
+   if (util_format_is_pure_uint(format_desc->format))
+      return bld_base->uint_bld.type;
+   return bld_base->base.type;
+}
+
+static void
+image_load_emit(
+   struct lp_build_tgsi_soa_context * bld,
+   struct lp_build_emit_data * emit_data)
+{
+   struct lp_build_tgsi_context * bld_base = &bld->bld_base;
+   struct gallivm_state *gallivm = bld_base->base.gallivm;
+   LLVMBuilderRef builder = gallivm->builder;
+   const struct tgsi_full_instruction *inst = emit_data->inst;
+   const struct util_format_description *format_desc;
+   struct lp_build_tgsi_image image;
+   LLVMValueRef offsets, in_bounds, rgba[4];
+   unsigned chan;
+
+   format_desc = get_image(bld, inst->Src[0].Register.Index, &image);
+   if (!format_desc) {
+      TGSI_FOR_EACH_DST0_ENABLED_CHANNEL(inst, chan) {
+         emit_data->output[chan] = bld_base->base.zero;
+      }
+      return;
+   }
+
+   get_image_offsets(bld_base, inst, 1, format_desc, &image,
+                     &offsets, &in_bounds);
+
+   lp_build_fetch_rgba_soa(gallivm, format_desc,
+                           get_image_texel_type(bld_base, format_desc),
+                           TRUE, image.base_ptr, offsets,
+                           bld_base->uint_bld.zero, bld_base->uint_bld.zero,
+                           NULL, rgba);
+
+   TGSI_FOR_EACH_DST0_ENABLED_CHANNEL(inst, chan) {
+      LLVMValueRef value;
+
+      value = LLVMBuildBitCast(builder, rgba[chan],
+                               bld_base->uint_bld.vec_type, "");
+      value = lp_build_select(&bld_base->uint_bld, in_bounds, value,
+                              bld_base->uint_bld.zero);
+      emit_data->output[chan] =
+         LLVMBuildBitCast(builder, value, bld_base->base.vec_type, "");
+   }
+}
+
+static void
+image_store_emit(
+   struct lp_build_tgsi_soa_context * bld,
+   struct lp_build_emit_data * emit_data)
+{
+   struct lp_build_tgsi_context * bld_base = &bld->bld_base;
+   struct gallivm_state *gallivm = bld_base->base.gallivm;
+   LLVMBuilderRef builder = gallivm->builder;
+   const struct tgsi_full_instruction *inst = emit_data->inst;
+   const struct util_format_description *format_desc;
+   struct lp_build_tgsi_image image;
+   struct lp_type texel_type;
+   LLVMValueRef offsets, in_bounds, mask, rgba[4];
+   unsigned chan;
+
+   format_desc = get_image(bld, inst->Dst[0].Register.Index, &image);
+   if (!format_desc || !lp_build_store_rgba_soa_supported(format_desc))
+      return;
+
+   get_image_offsets(bld_base, inst, 0, format_desc, &image,
+                     &offsets, &in_bounds);
+   mask = LLVMBuildAnd(builder, mask_vec(bld_base), in_bounds, "");
+
+   texel_type = get_image_texel_type(bld_base, format_desc);
+   for (chan = 0; chan < 4; chan++) {
+      rgba[chan] = lp_build_emit_fetch(bld_base, inst, 1, chan);
+      rgba[chan] = LLVMBuildBitCast(builder, rgba[chan],
+                                    lp_build_vec_type(gallivm, texel_type), "");
+   }
+
+   lp_build_store_rgba_soa(gallivm, format_desc, texel_type, mask,
+                           image.base_ptr, offsets, rgba);
+}
+
+static void
+image_resq_emit(
+   struct lp_build_tgsi_soa_context * bld,
+   struct lp_build_emit_data * emit_data)
+{
+   struct lp_build_tgsi_context * bld_base = &bld->bld_base;
+   struct gallivm_state *gallivm = bld_base->base.gallivm;
+   LLVMBuilderRef builder = gallivm->builder;
+   const struct tgsi_full_instruction *inst = emit_data->inst;
+   struct lp_build_context *uint_bld = &bld_base->uint_bld;
+   struct lp_build_tgsi_image image;
+   LLVMValueRef sizes[4];
+   unsigned chan;
+
+   if (!get_image(bld, inst->Src[0].Register.Index, &image)) {
+      TGSI_FOR_EACH_DST0_ENABLED_CHANNEL(inst, chan) {
+         emit_data->output[chan] = uint_bld->zero;
+      }
+      return;
+   }
+
+   sizes[0] = image.width;
+   sizes[1] = image.height;
+   sizes[2] = image.depth;
+   sizes[3] = lp_build_const_int32(gallivm, 1);   /* samples */
+
+   switch (inst->Memory.Texture) {
+   case TGSI_TEXTURE_1D_ARRAY:
+      sizes[1] = image.depth;
+      break;
+   case TGSI_TEXTURE_CUBE_ARRAY:
+      sizes[2] = LLVMBuildUDiv(builder, image.depth,
+                               lp_build_const_int32(gallivm, 6), "");
+      break;
+   default:
+      break;
+   }
+
+   TGSI_FOR_EACH_DST0_ENABLED_CHANNEL(inst, chan) {
+      emit_data->output[chan] = lp_build_broadcast_scalar(uint_bld,
+                                                          sizes[chan]);
+   }
+}
+
+static void
+load_emit(
+   const struct lp_build_tgsi_action * action,
+   struct lp_build_tgsi_context * bld_base,
+   struct lp_build_emit_data * emit_data)
+{
+   struct lp_build_tgsi_soa_context * bld = lp_soa_context(bld_base);
+   struct gallivm_state *gallivm = bld_base->base.gallivm;
+   const struct tgsi_full_instruction *inst = emit_data->inst;
+   struct lp_build_context *uint_bld = &bld_base->uint_bld;
+   LLVMValueRef base_ptr, num_dwords, index;
+   unsigned chan;
+
+   if (inst->Src[0].Register.File == TGSI_FILE_IMAGE) {
+      image_load_emit(bld, emit_data);
+      return;
+   }
+
+   get_memory_ptr(bld, inst->Src[0].Register.File, inst->Src[0].Register.Index,
+                  bld_base->base.elem_type, &base_ptr, &num_dwords);
+   index = get_memory_index(bld_base, inst, 1);
+
+   TGSI_FOR_EACH_DST0_ENABLED_CHANNEL(inst, chan) {
+      LLVMValueRef chan_index, overflow_mask;
+
+      chan_index = lp_build_add(uint_bld, index,
+                                lp_build_const_int_vec(gallivm, uint_bld->type,
+                                                       chan));
+      overflow_mask = lp_build_compare(gallivm, uint_bld->type,
+                                       PIPE_FUNC_GEQUAL,
+                                       chan_index, num_dwords);
+      emit_data->output[chan] = build_gather(bld_base, base_ptr, chan_index,
+                                             overflow_mask, NULL);
+   }
+}
+
+/**
+ * Scalar stores and atomics have to be done with per-element control flow:
+ * unlike the indirect temporary scatter we cannot read back and select the
+ * old value, since other invocations may write the same memory concurrently.
+ */
+static void
+store_emit(
+   const struct lp_build_tgsi_action * action,
+   struct lp_build_tgsi_context * bld_base,
+   struct lp_build_emit_data * emit_data)
+{
+   struct lp_build_tgsi_soa_context * bld = lp_soa_context(bld_base);
+   struct gallivm_state *gallivm = bld_base->base.gallivm;
+   LLVMBuilderRef builder = gallivm->builder;
+   const struct tgsi_full_instruction *inst = emit_data->inst;
+   struct lp_build_context *uint_bld = &bld_base->uint_bld;
+   LLVMValueRef base_ptr, num_dwords, index, exec_mask;
+   unsigned chan, i;
+
+   if (inst->Dst[0].Register.File == TGSI_FILE_IMAGE) {
+      image_store_emit(bld, emit_data);
+      return;
+   }
+
+   get_memory_ptr(bld, inst->Dst[0].Register.File, inst->Dst[0].Register.Index,
+                  uint_bld->elem_type, &base_ptr, &num_dwords);
+   index = get_memory_index(bld_base, inst, 0);
+   exec_mask = mask_vec(bld_base);
+
+   TGSI_FOR_EACH_DST0_ENABLED_CHANNEL(inst, chan) {
+      LLVMValueRef chan_index, in_bounds, pred, value;
+
+      chan_index = lp_build_add(uint_bld, index,
+                                lp_build_const_int_vec(gallivm, uint_bld->type,
+                                                       chan));
+      in_bounds = lp_build_compare(gallivm, uint_bld->type, PIPE_FUNC_LESS,
+                                   chan_index, num_dwords);
+      pred = LLVMBuildAnd(builder, exec_mask, in_bounds, "");
+      value = lp_build_emit_fetch(bld_base, inst, 1, chan);
+      value = LLVMBuildBitCast(builder, value, uint_bld->vec_type, "");
+
+      for (i = 0; i < uint_bld->type.length; i++) {
+         LLVMValueRef ii = lp_build_const_int32(gallivm, i);
+         LLVMValueRef scalar_pred, scalar_index, scalar_ptr;
+         struct lp_build_if_state ifthen;
+
+         scalar_pred = LLVMBuildExtractElement(builder, pred, ii, "");
+         scalar_pred = LLVMBuildICmp(builder, LLVMIntNE, scalar_pred,
+                                     lp_build_const_int32(gallivm, 0), "");
+         lp_build_if(&ifthen, gallivm, scalar_pred);
+         scalar_index = LLVMBuildExtractElement(builder, chan_index, ii, "");
+         scalar_ptr = LLVMBuildGEP(builder, base_ptr, &scalar_index, 1,
+                                   "store_ptr");
+         LLVMBuildStore(builder,
+                        LLVMBuildExtractElement(builder, value, ii, ""),
+                        scalar_ptr);
+         lp_build_endif(&ifthen);
+      }
+   }
+}
+
+static void
+atomic_emit(
+   const struct lp_build_tgsi_action * action,
+   struct lp_build_tgsi_context * bld_base,
+   struct lp_build_emit_data * emit_data)
+{
+   struct lp_build_tgsi_soa_context * bld = lp_soa_context(bld_base);
+   struct gallivm_state *gallivm = bld_base->base.gallivm;
+   LLVMBuilderRef builder = gallivm->builder;
+   const struct tgsi_full_instruction *inst = emit_data->inst;
+   struct lp_build_context *uint_bld = &bld_base->uint_bld;
+   LLVMValueRef base_ptr, index, in_bounds, pred;
+   LLVMValueRef value, value2 = NULL, result_ptr, result;
+   LLVMAtomicRMWBinOp op = LLVMAtomicRMWBinOpAdd;
+   unsigned chan, i;
+
+   switch (inst->Instruction.Opcode) {
+   case TGSI_OPCODE_ATOMUADD:
+      op = LLVMAtomicRMWBinOpAdd;
+      break;
+   case TGSI_OPCODE_ATOMXCHG:
+      op = LLVMAtomicRMWBinOpXchg;
+      break;
+   case TGSI_OPCODE_ATOMAND:
+      op = LLVMAtomicRMWBinOpAnd;
+      break;
+   case TGSI_OPCODE_ATOMOR:
+      op = LLVMAtomicRMWBinOpOr;
+      break;
+   case TGSI_OPCODE_ATOMXOR:
+      op = LLVMAtomicRMWBinOpXor;
+      break;
+   case TGSI_OPCODE_ATOMUMIN:
+      op = LLVMAtomicRMWBinOpUMin;
+      break;
+   case TGSI_OPCODE_ATOMUMAX:
+      op = LLVMAtomicRMWBinOpUMax;
+      break;
+   case TGSI_OPCODE_ATOMIMIN:
+      op = LLVMAtomicRMWBinOpMin;
+      break;
+   case TGSI_OPCODE_ATOMIMAX:
+      op = LLVMAtomicRMWBinOpMax;
+      break;
+   case TGSI_OPCODE_ATOMCAS:
+      break;
+   default:
+      assert(0);
+      break;
+   }
+
+   if (inst->Src[0].Register.File == TGSI_FILE_IMAGE) {
+      const struct util_format_description *format_desc;
+      struct lp_build_tgsi_image image;
+      LLVMValueRef offsets;
+
+      /* only r32i, r32ui and (for exchanges) r32f images allow atomics */
+      format_desc = get_image(bld, inst->Src[0].Register.Index, &image);
+      if (!format_desc || format_desc->block.bits != 32) {
+         TGSI_FOR_EACH_DST0_ENABLED_CHANNEL(inst, chan) {
+            emit_data->output[chan] = uint_bld->zero;
+         }
+         return;
+      }
+
+      get_image_offsets(bld_base, inst, 1, format_desc, &image,
+                        &offsets, &in_bounds);
+      base_ptr = LLVMBuildBitCast(builder, image.base_ptr,
+                                  LLVMPointerType(uint_bld->elem_type, 0), "");
+      index = lp_build_shr_imm(uint_bld, offsets, 2);
+   }
+   else {
+      LLVMValueRef num_dwords;
+
+      get_memory_ptr(bld, inst->Src[0].Register.File,
+                     inst->Src[0].Register.Index,
+                     uint_bld->elem_type, &base_ptr, &num_dwords);
+      index = get_memory_index(bld_base, inst, 1);
+      in_bounds = lp_build_compare(gallivm, uint_bld->type, PIPE_FUNC_LESS,
+                                   index, num_dwords);
+   }
+   pred = LLVMBuildAnd(builder, mask_vec(bld_base), in_bounds, "");
+
+   value = lp_build_emit_fetch(bld_base, inst, 2, TGSI_CHAN_X);
+   value = LLVMBuildBitCast(builder, value, uint_bld->vec_type, "");
+   if (inst->Instruction.Opcode == TGSI_OPCODE_ATOMCAS) {
+      value2 = lp_build_emit_fetch(bld_base, inst, 3, TGSI_CHAN_X);
+      value2 = LLVMBuildBitCast(builder, value2, uint_bld->vec_type, "");
+   }
+
+   /* lanes which are disabled or out of bounds return zero */
+   result_ptr = lp_build_alloca(gallivm, uint_bld->vec_type, "atomic_res");
+
+   for (i = 0; i < uint_bld->type.length; i++) {
+      LLVMValueRef ii = lp_build_const_int32(gallivm, i);
+      LLVMValueRef scalar_pred, scalar_index, scalar_ptr, scalar;
+      struct lp_build_if_state ifthen;
+
+      scalar_pred = LLVMBuildExtractElement(builder, pred, ii, "");
+      scalar_pred = LLVMBuildICmp(builder, LLVMIntNE, scalar_pred,
+                                  lp_build_const_int32(gallivm, 0), "");
+      lp_build_if(&ifthen, gallivm, scalar_pred);
+
+      scalar_index = LLVMBuildExtractElement(builder, index, ii, "");
+      scalar_ptr = LLVMBuildGEP(builder, base_ptr, &scalar_index, 1,
+                                "atomic_ptr");
+      if (inst->Instruction.Opcode == TGSI_OPCODE_ATOMCAS) {
+#if HAVE_LLVM >= 0x0309
+         scalar = LLVMBuildAtomicCmpXchg(builder, scalar_ptr,
+                     LLVMBuildExtractElement(builder, value, ii, ""),
+                     LLVMBuildExtractElement(builder, value2, ii, ""),
+                     LLVMAtomicOrderingSequentiallyConsistent,
+                     LLVMAtomicOrderingSequentiallyConsistent,
+                     false);
+         scalar = LLVMBuildExtractValue(builder, scalar, 0, "");
+#else
+         assert(0);
+         scalar = lp_build_const_int32(gallivm, 0);
+#endif
+      } else {
+         scalar = LLVMBuildAtomicRMW(builder, op, scalar_ptr,
+                     LLVMBuildExtractElement(builder, value, ii, ""),
+                     LLVMAtomicOrderingSequentiallyConsistent,
+                     false);
+      }
+      result = LLVMBuildLoad(builder, result_ptr, "");
+      result = LLVMBuildInsertElement(builder, result, scalar, ii, "");
+      LLVMBuildStore(builder, result, result_ptr);
+
+      lp_build_endif(&ifthen);
+   }
+
+   result = LLVMBuildLoad(builder, result_ptr, "");
+   TGSI_FOR_EACH_DST0_ENABLED_CHANNEL(inst, chan) {
+      emit_data->output[chan] = result;
+   }
+}
+
+static void
+resq_emit(
+   const struct lp_build_tgsi_action * action,
+   struct lp_build_tgsi_context * bld_base,
+   struct lp_build_emit_data * emit_data)
+{
+   struct lp_build_tgsi_soa_context * bld = lp_soa_context(bld_base);
+   const struct tgsi_full_instruction *inst = emit_data->inst;
+   struct lp_build_context *uint_bld = &bld_base->uint_bld;
+   LLVMValueRef base_ptr, num_dwords;
+   unsigned chan;
+
+   if (inst->Src[0].Register.File == TGSI_FILE_IMAGE) {
+      image_resq_emit(bld, emit_data);
+      return;
+   }
+
+   get_memory_ptr(bld, inst->Src[0].Register.File, inst->Src[0].Register.Index,
+                  uint_bld->elem_type, &base_ptr, &num_dwords);
+
+   TGSI_FOR_EACH_DST0_ENABLED_CHANNEL(inst, chan) {
+      emit_data->output[chan] = lp_build_shl_imm(uint_bld, num_dwords, 2);
+   }
+}
+
+static void
+barrier_emit(
+   const struct lp_build_tgsi_action * action,
+   struct lp_build_tgsi_context * bld_base,
+   struct lp_build_emit_data * emit_data)
+{
+   struct lp_build_tgsi_soa_context * bld = lp_soa_context(bld_base);
+
+   if (bld->mem_iface->emit_barrier)
+      bld->mem_iface->emit_barrier(bld->mem_iface, bld_base);
+}
+
+static void
+membar_emit(
+   const struct lp_build_tgsi_action * action,
+   struct lp_build_tgsi_context * bld_base,
+   struct lp_build_emit_data * emit_data)
+{
+#if HAVE_LLVM >= 0x0309
+   LLVMBuilderRef builder = bld_base->base.gallivm->builder;
+
+   LLVMBuildFence(builder, LLVMAtomicOrderingSequentiallyConsistent,
+                  false, "");
+#endif
+}
+
 static void
 cal_emit(
    const struct lp_build_tgsi_action * action,
@@ -3817,7 +4418,8 @@ lp_build_tgsi_soa(struct gallivm_state *gallivm,
                   LLVMValueRef thread_data_ptr,
                   const struct lp_build_sampler_soa *sampler,
                   const struct tgsi_shader_info *info,
-                  const struct lp_build_tgsi_gs_iface *gs_iface)
+                  const struct lp_build_tgsi_gs_iface *gs_iface,
+                  const struct lp_build_tgsi_mem_iface *mem_iface)
 {
    struct lp_build_tgsi_soa_context bld;
 
@@ -3973,6 +4575,25 @@ lp_build_tgsi_soa(struct gallivm_state *gallivm,
                                 max_output_vertices);
    }
 
+   if (mem_iface) {
+      bld.mem_iface = mem_iface;
+      bld.bld_base.op_actions[TGSI_OPCODE_LOAD].emit = load_emit;
+      bld.bld_base.op_actions[TGSI_OPCODE_STORE].emit = store_emit;
+      bld.bld_base.op_actions[TGSI_OPCODE_RESQ].emit = resq_emit;
+      bld.bld_base.op_actions[TGSI_OPCODE_ATOMUADD].emit = atomic_emit;
+      bld.bld_base.op_actions[TGSI_OPCODE_ATOMXCHG].emit = atomic_emit;
+      bld.bld_base.op_actions[TGSI_OPCODE_ATOMCAS].emit = atomic_emit;
+      bld.bld_base.op_actions[TGSI_OPCODE_ATOMAND].emit = atomic_emit;
+      bld.bld_base.op_actions[TGSI_OPCODE_ATOMOR].emit = atomic_emit;
+      bld.bld_base.op_actions[TGSI_OPCODE_ATOMXOR].emit = atomic_emit;
+      bld.bld_base.op_actions[TGSI_OPCODE_ATOMUMIN].emit = atomic_emit;
+      bld.bld_base.op_actions[TGSI_OPCODE_ATOMUMAX].emit = atomic_emit;
+      bld.bld_base.op_actions[TGSI_OPCODE_ATOMIMIN].emit = atomic_emit;
+      bld.bld_base.op_actions[TGSI_OPCODE_ATOMIMAX].emit = atomic_emit;
+      bld.bld_base.op_actions[TGSI_OPCODE_BARRIER].emit = barrier_emit;
+      bld.bld_base.op_actions[TGSI_OPCODE_MEMBAR].emit = membar_emit;
+   }
+
    lp_exec_mask_init(&bld.exec_mask, &bld.bld_base.int_bld);
 
    bld.system_values = *system_values;
@@ -62,10 +62,13 @@
 #include "util/u_memory.h"
 #include "util/u_math.h"
 #include "util/rounding.h"
+#include "util/u_sse.h"
 
 
 #define DEBUG_EXECUTION 0
 
+DEBUG_GET_ONCE_BOOL_OPTION(no_fast_path, "TGSI_EXEC_NO_FAST_PATH", FALSE)
+
 
 #define FAST_MATH 0
 
@@ -1085,6 +1088,546 @@ tgsi_check_soa_dependencies(const struct tgsi_full_instruction *inst)
 }
 
 
+/*
+ * Pre-decoded float ALU instructions.
+ *
+ * The bulk of most shaders is plain float arithmetic on directly addressed
+ * registers.  For those instructions bind_shader records a compact decoded
+ * form with the register files, channel offsets and immediate operands
+ * already resolved, and tgsi_exec_machine_run() executes them on all four
+ * channels of the quad (16 values) at once instead of going through
+ * exec_instruction(), fetch_source() and store_dest() one channel at a
+ * time.  The results are bit-identical to the generic path, everything
+ * else still goes through exec_instruction().
+ */
+
+enum tgsi_exec_fast_op {
+   TGSI_EXEC_FAST_NONE = 0,   /**< use exec_instruction() */
+   TGSI_EXEC_FAST_MOV,
+   TGSI_EXEC_FAST_ADD,
+   TGSI_EXEC_FAST_MUL,
+   TGSI_EXEC_FAST_MAD,
+   TGSI_EXEC_FAST_MIN,
+   TGSI_EXEC_FAST_MAX,
+   TGSI_EXEC_FAST_DP2,
+   TGSI_EXEC_FAST_DP3,
+   TGSI_EXEC_FAST_DP4
+};
+
+struct tgsi_exec_decoded_src
+{
+   ubyte File;       /**< TGSI_FILE_x */
+   ubyte Cbuf;       /**< constant buffer */
+   ubyte Absolute;
+   ubyte Negate;
+   /**
+    * Swizzled channel offsets from the start of the register file in
+    * units of union tgsi_exec_channel, or element offsets into the buffer
+    * for constants.
+    */
+   int Chan[TGSI_NUM_CHANNELS];
+};
+
+struct tgsi_exec_decoded_inst
+{
+   ubyte Opcode;     /**< TGSI_EXEC_FAST_x */
+   ubyte NumSrcs;
+   ubyte WriteMask;
+   ubyte Saturate;
+   ubyte DstFile;    /**< TGSI_FILE_TEMPORARY or TGSI_FILE_OUTPUT */
+   int DstIndex;
+   struct tgsi_exec_decoded_src Src[3];
+};
+
+
+#if defined(PIPE_ARCH_SSE)
+
+typedef __m128 fast_vec;
+
+static inline fast_vec
+fast_load(const union tgsi_exec_channel *chan)
+{
+   return _mm_loadu_ps(chan->f);
+}
+
+static inline fast_vec
+fast_splat(uint u)
+{
+   return _mm_castsi128_ps(_mm_set1_epi32(u));
+}
+
+static inline fast_vec
+fast_add(fast_vec a, fast_vec b)
+{
+   return _mm_add_ps(a, b);
+}
+
+static inline fast_vec
+fast_mul(fast_vec a, fast_vec b)
+{
+   return _mm_mul_ps(a, b);
+}
+
+/* minps/maxps return the second operand for unordered inputs, exactly
+ * like micro_min()/micro_max().
+ */
+static inline fast_vec
+fast_min(fast_vec a, fast_vec b)
+{
+   return _mm_min_ps(a, b);
+}
+
+static inline fast_vec
+fast_max(fast_vec a, fast_vec b)
+{
+   return _mm_max_ps(a, b);
+}
+
+static inline fast_vec
+fast_abs(fast_vec a)
+{
+   return _mm_and_ps(a, fast_splat(0x7fffffff));
+}
+
+static inline fast_vec
+fast_neg(fast_vec a)
+{
+   return _mm_xor_ps(a, fast_splat(0x80000000));
+}
+
+/* Same as the saturate in store_dest(), NaN is passed through. */
+static inline fast_vec
+fast_saturate(fast_vec a)
+{
+   const fast_vec one = _mm_set1_ps(1.0f);
+   const fast_vec lt0 = _mm_cmplt_ps(a, _mm_setzero_ps());
+   const fast_vec gt1 = _mm_cmpgt_ps(a, one);
+
+   return _mm_or_ps(_mm_andnot_ps(_mm_or_ps(lt0, gt1), a),
+                    _mm_and_ps(gt1, one));
+}
+
+static inline void
+fast_store(union tgsi_exec_channel *dst, fast_vec a, uint execmask)
+{
+   if (execmask == 0xf) {
+      _mm_storeu_ps(dst->f, a);
+   }
+   else {
+      const fast_vec mask =
+         _mm_castsi128_ps(_mm_set_epi32(-(int) ((execmask >> 3) & 1),
+                                        -(int) ((execmask >> 2) & 1),
+                                        -(int) ((execmask >> 1) & 1),
+                                        -(int) (execmask & 1)));
+
+      _mm_storeu_ps(dst->f, _mm_or_ps(_mm_and_ps(mask, a),
+                                      _mm_andnot_ps(mask, fast_load(dst))));
+   }
+}
+
+#else
+
+typedef union tgsi_exec_channel fast_vec;
+
+static inline fast_vec
+fast_load(const union tgsi_exec_channel *chan)
+{
+   return *chan;
+}
+
+static inline fast_vec
+fast_splat(uint u)
+{
+   fast_vec r;
+   r.u[0] = r.u[1] = r.u[2] = r.u[3] = u;
+   return r;
+}
+
+static inline fast_vec
+fast_add(fast_vec a, fast_vec b)
+{
+   uint i;
+   for (i = 0; i < TGSI_QUAD_SIZE; i++)
+      a.f[i] += b.f[i];
+   return a;
+}
+
+static inline fast_vec
+fast_mul(fast_vec a, fast_vec b)
+{
+   uint i;
+   for (i = 0; i < TGSI_QUAD_SIZE; i++)
+      a.f[i] *= b.f[i];
+   return a;
+}
+
+static inline fast_vec
+fast_min(fast_vec a, fast_vec b)
+{
+   uint i;
+   for (i = 0; i < TGSI_QUAD_SIZE; i++)
+      a.f[i] = a.f[i] < b.f[i] ? a.f[i] : b.f[i];
+   return a;
+}
+
+static inline fast_vec
+fast_max(fast_vec a, fast_vec b)
+{
+   uint i;
+   for (i = 0; i < TGSI_QUAD_SIZE; i++)
+      a.f[i] = a.f[i] > b.f[i] ? a.f[i] : b.f[i];
+   return a;
+}
+
+static inline fast_vec
+fast_abs(fast_vec a)
+{
+   uint i;
+   for (i = 0; i < TGSI_QUAD_SIZE; i++)
+      a.u[i] &= 0x7fffffff;
+   return a;
+}
+
+static inline fast_vec
+fast_neg(fast_vec a)
+{
+   uint i;
+   for (i = 0; i < TGSI_QUAD_SIZE; i++)
+      a.u[i] ^= 0x80000000;
+   return a;
+}
+
+static inline fast_vec
+fast_saturate(fast_vec a)
+{
+   uint i;
+
+   for (i = 0; i < TGSI_QUAD_SIZE; i++) {
+      if (a.f[i] < 0.0f)
+         a.f[i] = 0.0f;
+      else if (a.f[i] > 1.0f)
+         a.f[i] = 1.0f;
+   }
+   return a;
+}
+
+static inline void
+fast_store(union tgsi_exec_channel *dst, fast_vec a, uint execmask)
+{
+   uint i;
+
+   for (i = 0; i < TGSI_QUAD_SIZE; i++)
+      if (execmask & (1 << i))
+         dst->u[i] = a.u[i];
+}
+
+#endif /* PIPE_ARCH_SSE */
+
+
+/**
+ * Decode a single instruction, return FALSE if it has to go through
+ * exec_instruction().
+ */
+static boolean
+decode_instruction(struct tgsi_exec_machine *mach,
+                   const struct tgsi_full_instruction *inst,
+                   struct tgsi_exec_decoded_inst *dec,
+                   union tgsi_exec_channel **imms,
+                   uint *num_imms)
+{
+   const struct tgsi_full_dst_register *dst = &inst->Dst[0];
+   union tgsi_exec_channel *new_imms;
+   uint i, chan;
+
+   switch (inst->Instruction.Opcode) {
+   case TGSI_OPCODE_MOV: dec->Opcode = TGSI_EXEC_FAST_MOV; break;
+   case TGSI_OPCODE_ADD: dec->Opcode = TGSI_EXEC_FAST_ADD; break;
+   case TGSI_OPCODE_MUL: dec->Opcode = TGSI_EXEC_FAST_MUL; break;
+   case TGSI_OPCODE_MAD: dec->Opcode = TGSI_EXEC_FAST_MAD; break;
+   case TGSI_OPCODE_MIN: dec->Opcode = TGSI_EXEC_FAST_MIN; break;
+   case TGSI_OPCODE_MAX: dec->Opcode = TGSI_EXEC_FAST_MAX; break;
+   case TGSI_OPCODE_DP2: dec->Opcode = TGSI_EXEC_FAST_DP2; break;
+   case TGSI_OPCODE_DP3: dec->Opcode = TGSI_EXEC_FAST_DP3; break;
+   case TGSI_OPCODE_DP4: dec->Opcode = TGSI_EXEC_FAST_DP4; break;
+   default:
+      return FALSE;
+   }
+
+   if (inst->Instruction.NumDstRegs != 1 ||
+       inst->Instruction.NumSrcRegs > ARRAY_SIZE(dec->Src))
+      return FALSE;
+
+   /* tess control outputs are shared between the invocations of a patch,
+    * see store_tcs_output()
+    */
+   if (dst->Register.Indirect || dst->Register.Dimension)
+      return FALSE;
+   if (dst->Register.File == TGSI_FILE_TEMPORARY) {
+      if (dst->Register.Index >= TGSI_EXEC_NUM_TEMPS)
+         return FALSE;
+   }
+   else if (dst->Register.File != TGSI_FILE_OUTPUT ||
+            mach->ShaderType == PIPE_SHADER_TESS_CTRL) {
+      return FALSE;
+   }
+
+   dec->NumSrcs = inst->Instruction.NumSrcRegs;
+   dec->WriteMask = dst->Register.WriteMask;
+   dec->Saturate = inst->Instruction.Saturate;
+   dec->DstFile = dst->Register.File;
+   dec->DstIndex = dst->Register.Index;
+
+   for (i = 0; i < dec->NumSrcs; i++) {
+      const struct tgsi_full_src_register *reg = &inst->Src[i];
+      struct tgsi_exec_decoded_src *src = &dec->Src[i];
+      const int index = reg->Register.Index;
+
+      if (reg->Register.Indirect)
+         return FALSE;
+
+      src->File = reg->Register.File;
+      src->Cbuf = 0;
+      src->Absolute = reg->Register.Absolute;
+      src->Negate = reg->Register.Negate;
+
+      switch (reg->Register.File) {
+      case TGSI_FILE_CONSTANT:
+         if (reg->Register.Dimension) {
+            if (reg->Dimension.Indirect ||
+                reg->Dimension.Index >= PIPE_MAX_CONSTANT_BUFFERS)
+               return FALSE;
+            src->Cbuf = reg->Dimension.Index;
+         }
+         for (chan = 0; chan < TGSI_NUM_CHANNELS; chan++)
+            src->Chan[chan] = index * 4 +
+               tgsi_util_get_full_src_register_swizzle(reg, chan);
+         break;
+
+      case TGSI_FILE_IMMEDIATE:
+         if (reg->Register.Dimension || index >= (int) mach->ImmLimit)
+            return FALSE;
+
+         /* broadcast the swizzled value with the modifiers applied */
+         new_imms = REALLOC(*imms,
+                            *num_imms * sizeof(union tgsi_exec_channel),
+                            (*num_imms + TGSI_NUM_CHANNELS) *
+                            sizeof(union tgsi_exec_channel));
+         if (!new_imms)
+            return FALSE;
+         *imms = new_imms;
+         for (chan = 0; chan < TGSI_NUM_CHANNELS; chan++) {
+            const uint swizzle =
+               tgsi_util_get_full_src_register_swizzle(reg, chan);
+            union tgsi_exec_channel *c = &(*imms)[*num_imms + chan];
+            union fi imm;
+
+            imm.f = mach->Imms[index][swizzle];
+            if (src->Absolute)
+               imm.ui &= 0x7fffffff;
+            if (src->Negate)
+               imm.ui ^= 0x80000000;
+            c->u[0] = c->u[1] = c->u[2] = c->u[3] = imm.ui;
+            src->Chan[chan] = *num_imms + chan;
+         }
+         *num_imms += TGSI_NUM_CHANNELS;
+         src->Absolute = src->Negate = 0;
+         break;
+
+      case TGSI_FILE_TEMPORARY:
+      case TGSI_FILE_INPUT:
+      case TGSI_FILE_OUTPUT:
+         /* 2D inputs are only used by geometry and tessellation shaders */
+         if (reg->Register.Dimension || index < 0)
+            return FALSE;
+         if (reg->Register.File == TGSI_FILE_TEMPORARY &&
+             index >= TGSI_EXEC_NUM_TEMPS)
+            return FALSE;
+         if (reg->Register.File == TGSI_FILE_OUTPUT &&
+             mach->ShaderType == PIPE_SHADER_TESS_CTRL)
+            return FALSE;
+         for (chan = 0; chan < TGSI_NUM_CHANNELS; chan++)
+            src->Chan[chan] = index * TGSI_NUM_CHANNELS +
+               tgsi_util_get_full_src_register_swizzle(reg, chan);
+         break;
+
+      default:
+         return FALSE;
+      }
+   }
+
+   return TRUE;
+}
+
+
+/**
+ * Build mach->DecodedInstructions from mach->Instructions.
+ */
+static void
+decode_instructions(struct tgsi_exec_machine *mach)
+{
+   struct tgsi_exec_decoded_inst *decoded;
+   union tgsi_exec_channel *imms = NULL;
+   uint num_imms = 0, num_decoded = 0;
+   uint i;
+
+   decoded = CALLOC(mach->NumInstructions, sizeof(*decoded));
+   if (!decoded)
+      return;
+
+   for (i = 0; i < mach->NumInstructions; i++) {
+      if (decode_instruction(mach, &mach->Instructions[i], &decoded[i],
+                             &imms, &num_imms))
+         num_decoded++;
+      else
+         decoded[i].Opcode = TGSI_EXEC_FAST_NONE;
+   }
+
+   if (!num_decoded) {
+      FREE(decoded);
+      FREE(imms);
+      return;
+   }
+
+   mach->DecodedInstructions = decoded;
+   mach->DecodedImms = imms;
+}
+
+
+static inline void
+fetch_decoded_src(const struct tgsi_exec_machine *mach,
+                  const struct tgsi_exec_decoded_src *src,
+                  fast_vec v[TGSI_NUM_CHANNELS])
+{
+   const union tgsi_exec_channel *base;
+   uint chan;
+
+   switch (src->File) {
+   case TGSI_FILE_TEMPORARY:
+      base = mach->Temps[0].xyzw;
+      break;
+   case TGSI_FILE_INPUT:
+      base = mach->Inputs[0].xyzw;
+      break;
+   case TGSI_FILE_OUTPUT:
+      base = mach->Outputs[0].xyzw;
+      break;
+   case TGSI_FILE_IMMEDIATE:
+      base = mach->DecodedImms;
+      break;
+   default:
+      {
+         /* same bounds check as fetch_src_file_channel() */
+         const uint *buf = (const uint *) mach->Consts[src->Cbuf];
+         const int size = (int) mach->ConstsSize[src->Cbuf];
+
+         for (chan = 0; chan < TGSI_NUM_CHANNELS; chan++) {
+            const int pos = src->Chan[chan];
+            v[chan] = fast_splat(pos < 0 || pos >= size ? 0 : buf[pos]);
+         }
+         base = NULL;
+      }
+      break;
+   }
+
+   if (base) {
+      for (chan = 0; chan < TGSI_NUM_CHANNELS; chan++)
+         v[chan] = fast_load(&base[src->Chan[chan]]);
+   }
+
+   if (src->Absolute) {
+      for (chan = 0; chan < TGSI_NUM_CHANNELS; chan++)
+         v[chan] = fast_abs(v[chan]);
+   }
+   if (src->Negate) {
+      for (chan = 0; chan < TGSI_NUM_CHANNELS; chan++)
+         v[chan] = fast_neg(v[chan]);
+   }
+}
+
+
+/**
+ * Execute a pre-decoded instruction, the equivalent of exec_instruction()
+ * for the opcodes accepted by decode_instruction().
+ */
+static void
+exec_decoded_instruction(struct tgsi_exec_machine *mach,
+                         const struct tgsi_exec_decoded_inst *dec)
+{
+   const uint execmask = mach->ExecMask;
+   fast_vec src[3][TGSI_NUM_CHANNELS];
+   fast_vec dst[TGSI_NUM_CHANNELS];
+   union tgsi_exec_channel *out;
+   uint i, chan;
+
+   if (!execmask)
+      return;
+
+   /* all sources are read before anything is written */
+   for (i = 0; i < dec->NumSrcs; i++)
+      fetch_decoded_src(mach, &dec->Src[i], src[i]);
+
+   switch (dec->Opcode) {
+   case TGSI_EXEC_FAST_MOV:
+      for (chan = 0; chan < TGSI_NUM_CHANNELS; chan++)
+         dst[chan] = src[0][chan];
+      break;
+   case TGSI_EXEC_FAST_ADD:
+      for (chan = 0; chan < TGSI_NUM_CHANNELS; chan++)
+         dst[chan] = fast_add(src[0][chan], src[1][chan]);
+      break;
+   case TGSI_EXEC_FAST_MUL:
+      for (chan = 0; chan < TGSI_NUM_CHANNELS; chan++)
+         dst[chan] = fast_mul(src[0][chan], src[1][chan]);
+      break;
+   case TGSI_EXEC_FAST_MAD:
+      for (chan = 0; chan < TGSI_NUM_CHANNELS; chan++)
+         dst[chan] = fast_add(fast_mul(src[0][chan], src[1][chan]),
+                              src[2][chan]);
+      break;
+   case TGSI_EXEC_FAST_MIN:
+      for (chan = 0; chan < TGSI_NUM_CHANNELS; chan++)
+         dst[chan] = fast_min(src[0][chan], src[1][chan]);
+      break;
+   case TGSI_EXEC_FAST_MAX:
+      for (chan = 0; chan < TGSI_NUM_CHANNELS; chan++)
+         dst[chan] = fast_max(src[0][chan], src[1][chan]);
+      break;
+   case TGSI_EXEC_FAST_DP2:
+   case TGSI_EXEC_FAST_DP3:
+   case TGSI_EXEC_FAST_DP4:
+      {
+         /* same summation order as exec_dp2/3/4() */
+         const uint n = dec->Opcode == TGSI_EXEC_FAST_DP2 ? 2 :
+                        dec->Opcode == TGSI_EXEC_FAST_DP3 ? 3 : 4;
+         fast_vec sum = fast_mul(src[0][0], src[1][0]);
+
+         for (chan = 1; chan < n; chan++)
+            sum = fast_add(fast_mul(src[0][chan], src[1][chan]), sum);
+         for (chan = 0; chan < TGSI_NUM_CHANNELS; chan++)
+            dst[chan] = sum;
+      }
+      break;
+   default:
+      assert(0);
+      return;
+   }
+
+   if (dec->DstFile == TGSI_FILE_OUTPUT)
+      out = mach->Outputs[mach->Temps[TEMP_OUTPUT_I].xyzw[TEMP_OUTPUT_C].u[0]
+                          + dec->DstIndex].xyzw;
+   else
+      out = mach->Temps[dec->DstIndex].xyzw;
+
+   for (chan = 0; chan < TGSI_NUM_CHANNELS; chan++) {
+      if (dec->WriteMask & (1 << chan)) {
+         fast_store(&out[chan],
+                    dec->Saturate ? fast_saturate(dst[chan]) : dst[chan],
+                    execmask);
+      }
+   }
+}
+
+
 /**
  * Initialize machine state by expanding tokens to full instructions,
  * allocating temporary storage, setting up constants, etc.
@@ -1117,6 +1660,11 @@ tgsi_exec_machine_bind_shader(
    mach->Image = image;
    mach->Buffer = buffer;
 
+   FREE(mach->DecodedInstructions);
+   mach->DecodedInstructions = NULL;
+   FREE(mach->DecodedImms);
+   mach->DecodedImms = NULL;
+
    if (!tokens) {
       /* unbind and free all */
       FREE(mach->Declarations);
@@ -1273,6 +1821,9 @@ tgsi_exec_machine_bind_shader(
    FREE(mach->Instructions);
    mach->Instructions = instructions;
    mach->NumInstructions = numInstructions;
+
+   if (mach->UseFastPath)
+      decode_instructions(mach);
 }
 
 
@@ -1290,9 +1841,21 @@ tgsi_exec_machine_create(enum pipe_shader_type shader_type)
 
    mach->ShaderType = shader_type;
    mach->Addrs = &mach->Temps[TGSI_EXEC_TEMP_ADDR];
+   mach->UseFastPath = !debug_get_option_no_fast_path();
    mach->MaxGeometryShaderOutputs = TGSI_MAX_TOTAL_VERTICES;
 
-   if (shader_type != PIPE_SHADER_COMPUTE) {
+   if (shader_type == PIPE_SHADER_TESS_EVAL) {
+      mach->Inputs = align_malloc(sizeof(struct tgsi_exec_vector) *
+                                  TGSI_MAX_PATCH_VERTICES * PIPE_MAX_SHADER_INPUTS, 16);
+      mach->Outputs = align_malloc(sizeof(struct tgsi_exec_vector) * PIPE_MAX_SHADER_OUTPUTS, 16);
+      if (!mach->Inputs || !mach->Outputs)
+         goto fail;
+   }
+   else if (shader_type != PIPE_SHADER_COMPUTE &&
+            shader_type != PIPE_SHADER_TESS_CTRL) {
+      /* tess control inputs and outputs are shared by the machines running
+       * the invocations of a patch and are set up by the caller.
+       */
       mach->Inputs = align_malloc(sizeof(struct tgsi_exec_vector) * PIPE_MAX_SHADER_INPUTS, 16);
       mach->Outputs = align_malloc(sizeof(struct tgsi_exec_vector) * PIPE_MAX_SHADER_OUTPUTS, 16);
       if (!mach->Inputs || !mach->Outputs)
@@ -1337,6 +1900,8 @@ tgsi_exec_machine_destroy(struct tgsi_exec_machine *mach)
    if (mach) {
       FREE(mach->Instructions);
       FREE(mach->Declarations);
+      FREE(mach->DecodedInstructions);
+      FREE(mach->DecodedImms);
 
       align_free(mach->Inputs);
       align_free(mach->Outputs);
@@ -1527,7 +2092,7 @@ fetch_src_file_channel(const struct tgsi_exec_machine *mach,
                          }*/
          int pos = index2D->i[i] * TGSI_EXEC_MAX_INPUT_ATTRIBS + index->i[i];
          assert(pos >= 0);
-         assert(pos < TGSI_MAX_PRIM_VERTICES * PIPE_MAX_ATTRIBS);
+         assert(pos < TGSI_MAX_PATCH_VERTICES * TGSI_EXEC_MAX_INPUT_ATTRIBS);
          chan->u[i] = mach->Inputs[pos].xyzw[swizzle].u[i];
       }
       break;
@@ -1586,6 +2151,37 @@ fetch_src_file_channel(const struct tgsi_exec_machine *mach,
    }
 }
 
+/**
+ * Read tessellation control outputs, which are addressed by output vertex
+ * for per-vertex outputs (index2D != NULL) and shared by all invocations
+ * for per-patch outputs.
+ */
+static void
+fetch_tcs_output(const struct tgsi_exec_machine *mach,
+                 const uint swizzle,
+                 const union tgsi_exec_channel *index,
+                 const union tgsi_exec_channel *index2D,
+                 union tgsi_exec_channel *chan)
+{
+   uint i;
+
+   for (i = 0; i < TGSI_QUAD_SIZE; i++) {
+      assert(index->i[i] >= 0 && index->i[i] < PIPE_MAX_SHADER_OUTPUTS);
+
+      if (index2D) {
+         const int vertex = index2D->i[i];
+
+         assert(vertex >= 0 && vertex < TGSI_MAX_PATCH_VERTICES);
+         chan->u[i] = mach->Outputs[TGSI_EXEC_TCS_VERTEX_OUTPUT(vertex, index->i[i])]
+            .xyzw[swizzle].u[vertex % TGSI_QUAD_SIZE];
+      }
+      else {
+         chan->u[i] = mach->Outputs[TGSI_EXEC_TCS_PATCH_OUTPUT(index->i[i])]
+            .xyzw[swizzle].u[0];
+      }
+   }
+}
+
 static void
 fetch_source_d(const struct tgsi_exec_machine *mach,
                union tgsi_exec_channel *chan,
@@ -1724,6 +2320,14 @@ fetch_source_d(const struct tgsi_exec_machine *mach,
    }
 
    swizzle = tgsi_util_get_full_src_register_swizzle( reg, chan_index );
+
+   if (reg->Register.File == TGSI_FILE_OUTPUT &&
+       mach->ShaderType == PIPE_SHADER_TESS_CTRL) {
+      fetch_tcs_output(mach, swizzle, &index,
+                       reg->Register.Dimension ? &index2D : NULL, chan);
+      return;
+   }
+
    fetch_src_file_channel(mach,
                           reg->Register.File,
                           swizzle,
@@ -1758,23 +2362,13 @@ fetch_source(const struct tgsi_exec_machine *mach,
    }
 }
 
-static union tgsi_exec_channel *
-store_dest_dstret(struct tgsi_exec_machine *mach,
-                 const union tgsi_exec_channel *chan,
-                 const struct tgsi_full_dst_register *reg,
-                 uint chan_index,
-                 enum tgsi_exec_datatype dst_datatype)
+static void
+fetch_dst_indices(const struct tgsi_exec_machine *mach,
+                  const struct tgsi_full_dst_register *reg,
+                  int *offset,
+                  union tgsi_exec_channel *index2D)
 {
-   static union tgsi_exec_channel null;
-   union tgsi_exec_channel *dst;
-   union tgsi_exec_channel index2D;
-   int offset = 0;  /* indirection offset */
-   int index;
-
-   /* for debugging */
-   if (0 && dst_datatype == TGSI_EXEC_DATA_FLOAT) {
-      check_inf_or_nan(chan);
-   }
+   *offset = 0;
 
    /* There is an extra source register that indirectly subscripts
     * a register file. The direct index now becomes an offset
@@ -1809,7 +2403,7 @@ store_dest_dstret(struct tgsi_exec_machine *mach,
                              &indir_index);
 
       /* save indirection offset */
-      offset = indir_index.i[0];
+      *offset = indir_index.i[0];
    }
 
    /* There is an extra source register that is a second
@@ -1821,10 +2415,10 @@ store_dest_dstret(struct tgsi_exec_machine *mach,
     *       [3] = Dimension.Index
     */
    if (reg->Register.Dimension) {
-      index2D.i[0] =
-      index2D.i[1] =
-      index2D.i[2] =
-      index2D.i[3] = reg->Dimension.Index;
+      index2D->i[0] =
+      index2D->i[1] =
+      index2D->i[2] =
+      index2D->i[3] = reg->Dimension.Index;
 
       /* Again, the second subscript index can be addressed indirectly
        * identically to the first one.
@@ -1857,17 +2451,17 @@ store_dest_dstret(struct tgsi_exec_machine *mach,
                                 &ZeroVec,
                                 &indir_index);
 
-         index2D.i[0] += indir_index.i[0];
-         index2D.i[1] += indir_index.i[1];
-         index2D.i[2] += indir_index.i[2];
-         index2D.i[3] += indir_index.i[3];
+         index2D->i[0] += indir_index.i[0];
+         index2D->i[1] += indir_index.i[1];
+         index2D->i[2] += indir_index.i[2];
+         index2D->i[3] += indir_index.i[3];
 
          /* for disabled execution channels, zero-out the index to
           * avoid using a potential garbage value.
           */
          for (i = 0; i < TGSI_QUAD_SIZE; i++) {
             if ((execmask & (1 << i)) == 0) {
-               index2D.i[i] = 0;
+               index2D->i[i] = 0;
             }
          }
       }
@@ -1877,12 +2471,33 @@ store_dest_dstret(struct tgsi_exec_machine *mach,
        * by a dimension register and continue the saga.
        */
    } else {
-      index2D.i[0] =
-      index2D.i[1] =
-      index2D.i[2] =
-      index2D.i[3] = 0;
+      index2D->i[0] =
+      index2D->i[1] =
+      index2D->i[2] =
+      index2D->i[3] = 0;
+   }
+}
+
+static union tgsi_exec_channel *
+store_dest_dstret(struct tgsi_exec_machine *mach,
+                 const union tgsi_exec_channel *chan,
+                 const struct tgsi_full_dst_register *reg,
+                 uint chan_index,
+                 enum tgsi_exec_datatype dst_datatype)
+{
+   static union tgsi_exec_channel null;
+   union tgsi_exec_channel *dst;
+   union tgsi_exec_channel index2D;
+   int offset;  /* indirection offset */
+   int index;
+
+   /* for debugging */
+   if (0 && dst_datatype == TGSI_EXEC_DATA_FLOAT) {
+      check_inf_or_nan(chan);
    }
 
+   fetch_dst_indices(mach, reg, &offset, &index2D);
+
    switch (reg->Register.File) {
    case TGSI_FILE_NULL:
       dst = &null;
@@ -1925,6 +2540,51 @@ store_dest_dstret(struct tgsi_exec_machine *mach,
    return dst;
 }
 
+/**
+ * Write tessellation control outputs, see fetch_tcs_output().
+ */
+static void
+store_tcs_output(struct tgsi_exec_machine *mach,
+                 const union tgsi_exec_channel *chan,
+                 const struct tgsi_full_dst_register *reg,
+                 uint chan_index,
+                 boolean saturate)
+{
+   const uint execmask = mach->ExecMask;
+   union tgsi_exec_channel index2D;
+   int offset;
+   int index;
+   uint i, j;
+
+   fetch_dst_indices(mach, reg, &offset, &index2D);
+   index = offset + reg->Register.Index;
+   assert(index >= 0 && index < PIPE_MAX_SHADER_OUTPUTS);
+
+   for (i = 0; i < TGSI_QUAD_SIZE; i++) {
+      union tgsi_exec_channel value;
+
+      if (!(execmask & (1 << i)))
+         continue;
+
+      value.u[0] = chan->u[i];
+      if (saturate)
+         value.f[0] = CLAMP(value.f[0], 0.0f, 1.0f);
+
+      if (reg->Register.Dimension) {
+         const int vertex = index2D.i[i];
+
+         assert(vertex >= 0 && vertex < TGSI_MAX_PATCH_VERTICES);
+         mach->Outputs[TGSI_EXEC_TCS_VERTEX_OUTPUT(vertex, index)]
+            .xyzw[chan_index].u[vertex % TGSI_QUAD_SIZE] = value.u[0];
+      }
+      else {
+         for (j = 0; j < TGSI_QUAD_SIZE; j++)
+            mach->Outputs[TGSI_EXEC_TCS_PATCH_OUTPUT(index)]
+               .xyzw[chan_index].u[j] = value.u[0];
+      }
+   }
+}
+
 static void
 store_dest_double(struct tgsi_exec_machine *mach,
                  const union tgsi_exec_channel *chan,
@@ -1936,6 +2596,12 @@ store_dest_double(struct tgsi_exec_machine *mach,
    const uint execmask = mach->ExecMask;
    int i;
 
+   if (reg->Register.File == TGSI_FILE_OUTPUT &&
+       mach->ShaderType == PIPE_SHADER_TESS_CTRL) {
+      store_tcs_output(mach, chan, reg, chan_index, FALSE);
+      return;
+   }
+
    dst = store_dest_dstret(mach, chan, reg, chan_index, dst_datatype);
    if (!dst)
       return;
@@ -1958,6 +2624,13 @@ store_dest(struct tgsi_exec_machine *mach,
    const uint execmask = mach->ExecMask;
    int i;
 
+   if (reg->Register.File == TGSI_FILE_OUTPUT &&
+       mach->ShaderType == PIPE_SHADER_TESS_CTRL) {
+      store_tcs_output(mach, chan, reg, chan_index,
+                       inst->Instruction.Saturate);
+      return;
+   }
+
    dst = store_dest_dstret(mach, chan, reg, chan_index, dst_datatype);
    if (!dst)
       return;
@@ -6064,6 +6737,11 @@ tgsi_exec_machine_setup_masks(struct tgsi_exec_machine *mach)
       /* GS runs on a single primitive for now */
       default_mask = 0x1;
    }
+   else if (mach->ShaderType == PIPE_SHADER_TESS_CTRL &&
+            mach->NonHelperMask) {
+      /* only run the invocations which exist in the patch */
+      default_mask = mach->NonHelperMask;
+   }
 
    if (mach->NonHelperMask == 0)
       mach->NonHelperMask = default_mask;
@@ -6128,10 +6806,23 @@ tgsi_exec_machine_run( struct tgsi_exec_machine *mach, int start_pc )
 #endif
 
          assert(mach->pc < (int) mach->NumInstructions);
-         barrier_hit = exec_instruction(mach, mach->Instructions + mach->pc, &mach->pc);
+         if (mach->DecodedInstructions &&
+             mach->DecodedInstructions[mach->pc].Opcode != TGSI_EXEC_FAST_NONE) {
+            exec_decoded_instruction(mach,
+                                     &mach->DecodedInstructions[mach->pc]);
+            mach->pc++;
+            barrier_hit = FALSE;
+         }
+         else {
+            barrier_hit = exec_instruction(mach, mach->Instructions + mach->pc,
+                                           &mach->pc);
+         }
 
-         /* for compute shaders if we hit a barrier return now for later rescheduling */
-         if (barrier_hit && mach->ShaderType == PIPE_SHADER_COMPUTE)
+         /* for compute and tess control shaders if we hit a barrier return
+          * now for later rescheduling
+          */
+         if (barrier_hit && (mach->ShaderType == PIPE_SHADER_COMPUTE ||
+                             mach->ShaderType == PIPE_SHADER_TESS_CTRL))
             return 0;
 
 #if DEBUG_EXECUTION
@@ -311,8 +311,27 @@ struct tgsi_sampler
 /* The maximum total number of vertices */
 #define TGSI_MAX_TOTAL_VERTICES (TGSI_MAX_PRIM_VERTICES * TGSI_MAX_PRIMITIVES * PIPE_MAX_ATTRIBS)
 
+/* The maximum number of vertices per patch */
+#define TGSI_MAX_PATCH_VERTICES 32
+
+/* Tessellation control shaders run up to TGSI_QUAD_SIZE invocations per
+ * machine, and all machines running the invocations of a patch share the
+ * input and output arrays, which are provided by the caller.
+ * Per-vertex output attrib of output vertex v is found in lane v % 4 of
+ * the vector returned by TGSI_EXEC_TCS_VERTEX_OUTPUT(v, attrib), per-patch
+ * outputs are stored behind them with the same value in all lanes.
+ */
+#define TGSI_EXEC_TCS_VERTEX_OUTPUT(vertex, attrib) \
+   (((vertex) / TGSI_QUAD_SIZE) * PIPE_MAX_SHADER_OUTPUTS + (attrib))
+#define TGSI_EXEC_TCS_PATCH_OUTPUT(attrib) \
+   TGSI_EXEC_TCS_VERTEX_OUTPUT(TGSI_MAX_PATCH_VERTICES, attrib)
+#define TGSI_EXEC_TCS_NUM_OUTPUTS \
+   TGSI_EXEC_TCS_PATCH_OUTPUT(PIPE_MAX_SHADER_OUTPUTS)
+
 #define TGSI_MAX_MISC_INPUTS 8
 
+struct tgsi_exec_decoded_inst;
+
 /** function call/activation record */
 struct tgsi_call_record
 {
@@ -445,6 +464,13 @@ struct tgsi_exec_machine
    struct tgsi_full_declaration *Declarations;
    uint NumDeclarations;
 
+   /** Pre-decoded float ALU instructions, parallel to Instructions */
+   struct tgsi_exec_decoded_inst *DecodedInstructions;
+   /** Broadcast immediate operands of the decoded instructions */
+   union tgsi_exec_channel *DecodedImms;
+   /** Build DecodedInstructions in bind_shader (TGSI_EXEC_NO_FAST_PATH) */
+   boolean UseFastPath;
+
    struct tgsi_declaration_sampler_view
       SamplerViews[PIPE_MAX_SHADER_SAMPLER_VIEWS];
 
@@ -32,6 +32,7 @@
 
 #include "pipe/p_config.h"
 #include "pipe/p_state.h"
+#include "util/u_cpu_detect.h"
 #include "translate.h"
 
 struct translate *translate_create( const struct translate_key *key )
@@ -49,6 +50,25 @@ struct translate *translate_create( const struct translate_key *key )
    return translate_generic_create( key );
 }
 
+/**
+ * Like translate_create(), but prefer the gallivm generator on CPUs with
+ * AVX2.  The JIT compile time only pays off with wide vectors and gathers,
+ * and only for users which already run gallivm, like draw with LLVM.
+ */
+struct translate *translate_create_llvm( const struct translate_key *key )
+{
+#if defined(HAVE_LLVM) && (defined(PIPE_ARCH_X86) || defined(PIPE_ARCH_X86_64))
+   util_cpu_detect();
+   if (util_cpu_caps.has_avx2) {
+      struct translate *translate = translate_llvm_create( key );
+      if (translate)
+         return translate;
+   }
+#endif
+
+   return translate_create( key );
+}
+
 boolean translate_is_output_format_supported(enum pipe_format format)
 {
    return translate_generic_is_output_format_supported(format);
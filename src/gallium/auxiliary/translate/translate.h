@@ -128,6 +128,8 @@ struct translate {
 
 struct translate *translate_create( const struct translate_key *key );
 
+struct translate *translate_create_llvm( const struct translate_key *key );
+
 boolean translate_is_output_format_supported(enum pipe_format format);
 
 static inline int translate_keysize( const struct translate_key *key )
@@ -161,6 +163,8 @@ static inline void translate_key_sanitize( struct translate_key *a )
  */
 struct translate *translate_sse2_create( const struct translate_key *key );
 
+struct translate *translate_llvm_create( const struct translate_key *key );
+
 struct translate *translate_generic_create( const struct translate_key *key );
 
 boolean translate_generic_is_output_format_supported(enum pipe_format format);
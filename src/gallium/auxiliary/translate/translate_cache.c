@@ -35,6 +35,7 @@
 
 struct translate_cache {
    struct cso_hash *hash;
+   boolean use_llvm;
 };
 
 struct translate_cache * translate_cache_create( void )
@@ -45,6 +46,18 @@ struct translate_cache * translate_cache_create( void )
    }
 
    cache->hash = cso_hash_create();
+   cache->use_llvm = FALSE;
+   return cache;
+}
+
+/**
+ * A cache whose translates come from translate_create_llvm().
+ */
+struct translate_cache * translate_cache_create_llvm( void )
+{
+   struct translate_cache *cache = translate_cache_create();
+   if (cache)
+      cache->use_llvm = TRUE;
    return cache;
 }
 
@@ -98,7 +111,10 @@ struct translate * translate_cache_find(struct translate_cache *cache,
 
    if (!translate) {
       /* create/insert */
-      translate = translate_create(key);
+      if (cache->use_llvm)
+         translate = translate_create_llvm(key);
+      else
+         translate = translate_create(key);
       cso_hash_insert(cache->hash, hash_key, translate);
    }
 
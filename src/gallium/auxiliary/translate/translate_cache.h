@@ -39,6 +39,7 @@ struct translate_key;
 struct translate;
 
 struct translate_cache *translate_cache_create( void );
+struct translate_cache *translate_cache_create_llvm( void );
 void translate_cache_destroy(struct translate_cache *cache);
 
 /**
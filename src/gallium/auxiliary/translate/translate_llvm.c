@@ -0,0 +1,844 @@
+/**************************************************************************
+ *
+ * Copyright 2019 VMware, Inc.
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL VMWARE AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/**
+ * Vertex fetch/convert code generated with gallivm.
+ *
+ * Vertices are processed a full native vector at a time (8 with AVX2).
+ * The attributes of all lanes are fetched in SoA form with
+ * lp_build_fetch_rgba_soa(), which gathers the elements and converts any
+ * vertex format (half floats, 10_10_10_2, normalized and scaled integers
+ * etc.), then transposed to AoS and stored to the output vertices.
+ *
+ * Only 32 bit float and integer outputs (plus plain copies) are handled,
+ * which is what the draw module needs for fetching; keys with other output
+ * formats are left to the rtasm and generic implementations.
+ */
+
+
+#include "util/u_memory.h"
+#include "util/u_format.h"
+#include "util/u_string.h"
+#include "pipe/p_state.h"
+#include "translate.h"
+
+#include "gallivm/lp_bld_init.h"
+#include "gallivm/lp_bld_type.h"
+#include "gallivm/lp_bld_const.h"
+#include "gallivm/lp_bld_arit.h"
+#include "gallivm/lp_bld_debug.h"
+#include "gallivm/lp_bld_flow.h"
+#include "gallivm/lp_bld_format.h"
+#include "gallivm/lp_bld_intr.h"
+#include "gallivm/lp_bld_pack.h"
+#include "gallivm/lp_bld_struct.h"
+#include "gallivm/lp_bld_swizzle.h"
+
+
+#define TRANSLATE_LLVM_MAX_LENGTH 8
+
+
+/**
+ * Per element state set by translate::set_buffer() and read by the
+ * generated code.
+ */
+struct translate_llvm_attrib {
+   const uint8_t *input_ptr;
+   unsigned input_stride;
+   unsigned max_index;
+};
+
+enum translate_llvm_attrib_member {
+   TRANSLATE_LLVM_ATTRIB_INPUT_PTR = 0,
+   TRANSLATE_LLVM_ATTRIB_INPUT_STRIDE,
+   TRANSLATE_LLVM_ATTRIB_MAX_INDEX,
+   TRANSLATE_LLVM_ATTRIB_NUM_FIELDS
+};
+
+
+enum translate_llvm_emit {
+   TRANSLATE_LLVM_EMIT_COPY,      /**< memcpy of the input element */
+   TRANSLATE_LLVM_EMIT_CONVERT,   /**< fetch to float/int and store */
+   TRANSLATE_LLVM_EMIT_INSTANCE_ID
+};
+
+
+struct translate_llvm {
+   struct translate translate;
+
+   struct translate_llvm_attrib attrib[TRANSLATE_MAX_ATTRIBS];
+
+   struct {
+      enum translate_llvm_emit emit;
+      unsigned copy_size;        /**< in bytes, for copies */
+      unsigned nr_channels;      /**< stored channels, for conversions */
+      boolean output_float;      /**< else 32 bit integers */
+      struct lp_type fetch_type;
+   } element[TRANSLATE_MAX_ATTRIBS];
+
+   unsigned vector_length;
+
+   LLVMContextRef context;
+   struct gallivm_state *gallivm;
+   LLVMTypeRef attrib_ptr_type;
+};
+
+
+/**
+ * State shared by the code generation of one run function.
+ */
+struct translate_llvm_build {
+   struct translate_llvm *tl;
+   struct gallivm_state *gallivm;
+   struct lp_build_context blduivec;
+
+   LLVMValueRef output_ptr;
+   LLVMValueRef instance_id;
+
+   /* Hoisted per element state */
+   LLVMValueRef input_ptr[TRANSLATE_MAX_ATTRIBS];
+   LLVMValueRef input_stride[TRANSLATE_MAX_ATTRIBS];
+   LLVMValueRef max_index[TRANSLATE_MAX_ATTRIBS];
+
+   /* Results of instanced elements, the same for all vertices */
+   LLVMValueRef instance_src[TRANSLATE_MAX_ATTRIBS];
+   LLVMValueRef instance_aos[TRANSLATE_MAX_ATTRIBS];
+};
+
+
+static struct translate_llvm *
+translate_llvm(struct translate *translate)
+{
+   return (struct translate_llvm *)translate;
+}
+
+
+static LLVMTypeRef
+create_attrib_type(struct gallivm_state *gallivm)
+{
+   LLVMTargetDataRef target = gallivm->target;
+   LLVMTypeRef elem_types[TRANSLATE_LLVM_ATTRIB_NUM_FIELDS];
+   LLVMTypeRef attrib_type;
+
+   elem_types[TRANSLATE_LLVM_ATTRIB_INPUT_PTR] =
+      LLVMPointerType(LLVMInt8TypeInContext(gallivm->context), 0);
+   elem_types[TRANSLATE_LLVM_ATTRIB_INPUT_STRIDE] =
+   elem_types[TRANSLATE_LLVM_ATTRIB_MAX_INDEX] =
+      LLVMInt32TypeInContext(gallivm->context);
+
+   attrib_type = LLVMStructTypeInContext(gallivm->context, elem_types,
+                                         ARRAY_SIZE(elem_types), 0);
+
+   (void) target; /* silence unused var warning for non-debug build */
+   LP_CHECK_MEMBER_OFFSET(struct translate_llvm_attrib, input_ptr,
+                          target, attrib_type,
+                          TRANSLATE_LLVM_ATTRIB_INPUT_PTR);
+   LP_CHECK_MEMBER_OFFSET(struct translate_llvm_attrib, input_stride,
+                          target, attrib_type,
+                          TRANSLATE_LLVM_ATTRIB_INPUT_STRIDE);
+   LP_CHECK_MEMBER_OFFSET(struct translate_llvm_attrib, max_index,
+                          target, attrib_type,
+                          TRANSLATE_LLVM_ATTRIB_MAX_INDEX);
+   LP_CHECK_STRUCT_SIZE(struct translate_llvm_attrib, target, attrib_type);
+
+   return attrib_type;
+}
+
+
+/**
+ * Fetch the attribute of all lanes and transpose it to one AoS vector
+ * per lane.
+ */
+static void
+fetch_element(struct translate_llvm_build *bld,
+              unsigned attr,
+              LLVMValueRef offsets,
+              LLVMValueRef aos[TRANSLATE_LLVM_MAX_LENGTH])
+{
+   struct translate_llvm *tl = bld->tl;
+   struct gallivm_state *gallivm = bld->gallivm;
+   const struct util_format_description *format_desc =
+      util_format_description(tl->translate.key.element[attr].input_format);
+   struct lp_type fetch_type = tl->element[attr].fetch_type;
+   struct lp_type aos_type = fetch_type;
+   LLVMValueRef soa[4];
+   unsigned chunk, chan;
+
+   lp_build_fetch_rgba_soa(gallivm, format_desc, fetch_type, FALSE,
+                           bld->input_ptr[attr], offsets,
+                           bld->blduivec.zero, bld->blduivec.zero,
+                           NULL, soa);
+
+   aos_type.length = 4;
+
+   for (chunk = 0; chunk < tl->vector_length; chunk += 4) {
+      LLVMValueRef src[4];
+
+      for (chan = 0; chan < 4; chan++) {
+         src[chan] = LLVMBuildBitCast(gallivm->builder, soa[chan],
+                                      lp_build_vec_type(gallivm, fetch_type),
+                                      "");
+         if (tl->vector_length > 4)
+            src[chan] = lp_build_extract_range(gallivm, src[chan], chunk, 4);
+      }
+
+      lp_build_transpose_aos(gallivm, aos_type, src, &aos[chunk]);
+   }
+}
+
+
+/**
+ * Byte offsets of the element for the given vertex indices.
+ */
+static LLVMValueRef
+element_offsets(struct translate_llvm_build *bld,
+                unsigned attr,
+                LLVMValueRef indices)
+{
+   struct lp_build_context *blduivec = &bld->blduivec;
+   LLVMValueRef max_index, stride;
+
+   /* clamp to avoid going out of bounds */
+   max_index = lp_build_broadcast_scalar(blduivec, bld->max_index[attr]);
+   indices = lp_build_min(blduivec, indices, max_index);
+
+   stride = lp_build_broadcast_scalar(blduivec, bld->input_stride[attr]);
+   return LLVMBuildMul(bld->gallivm->builder, indices, stride, "");
+}
+
+
+static void
+store_element(struct translate_llvm_build *bld,
+              unsigned attr,
+              LLVMValueRef dst,
+              LLVMValueRef src,
+              LLVMValueRef aos)
+{
+   struct translate_llvm *tl = bld->tl;
+   struct gallivm_state *gallivm = bld->gallivm;
+   LLVMBuilderRef builder = gallivm->builder;
+   LLVMTypeRef i32_type = LLVMInt32TypeInContext(gallivm->context);
+   LLVMTypeRef float_type = LLVMFloatTypeInContext(gallivm->context);
+   LLVMValueRef value;
+   unsigned chan;
+
+   switch (tl->element[attr].emit) {
+   case TRANSLATE_LLVM_EMIT_COPY: {
+      LLVMTypeRef copy_type =
+         LLVMIntTypeInContext(gallivm->context,
+                              tl->element[attr].copy_size * 8);
+
+      src = LLVMBuildBitCast(builder, src, LLVMPointerType(copy_type, 0), "");
+      dst = LLVMBuildBitCast(builder, dst, LLVMPointerType(copy_type, 0), "");
+      value = LLVMBuildLoad(builder, src, "");
+      LLVMSetAlignment(value, 1);
+      LLVMSetAlignment(LLVMBuildStore(builder, value, dst), 1);
+      break;
+   }
+
+   case TRANSLATE_LLVM_EMIT_CONVERT: {
+      LLVMTypeRef chan_type =
+         tl->element[attr].output_float ? float_type : i32_type;
+      unsigned nr_channels = tl->element[attr].nr_channels;
+
+      if (nr_channels == 4) {
+         dst = LLVMBuildBitCast(builder, dst,
+                                LLVMPointerType(LLVMTypeOf(aos), 0), "");
+         LLVMSetAlignment(LLVMBuildStore(builder, aos, dst), 1);
+         break;
+      }
+
+      /* Don't touch the bytes following the element */
+      dst = LLVMBuildBitCast(builder, dst, LLVMPointerType(chan_type, 0), "");
+      for (chan = 0; chan < nr_channels; chan++) {
+         LLVMValueRef index = lp_build_const_int32(gallivm, chan);
+         LLVMValueRef chan_ptr = LLVMBuildGEP(builder, dst, &index, 1, "");
+
+         value = LLVMBuildExtractElement(builder, aos, index, "");
+         LLVMSetAlignment(LLVMBuildStore(builder, value, chan_ptr), 1);
+      }
+      break;
+   }
+
+   case TRANSLATE_LLVM_EMIT_INSTANCE_ID:
+      if (tl->element[attr].output_float) {
+         value = LLVMBuildUIToFP(builder, bld->instance_id, float_type, "");
+         dst = LLVMBuildBitCast(builder, dst,
+                                LLVMPointerType(float_type, 0), "");
+      }
+      else {
+         value = bld->instance_id;
+         dst = LLVMBuildBitCast(builder, dst,
+                                LLVMPointerType(i32_type, 0), "");
+      }
+      LLVMSetAlignment(LLVMBuildStore(builder, value, dst), 1);
+      break;
+   }
+}
+
+
+/**
+ * Translate one vector of vertices, starting at output vertex 'first'.
+ * If 'remaining' is not NULL only that many lanes are written.
+ */
+static void
+emit_vertices(struct translate_llvm_build *bld,
+              LLVMValueRef indices,
+              LLVMValueRef first,
+              LLVMValueRef remaining)
+{
+   struct translate_llvm *tl = bld->tl;
+   const struct translate_key *key = &tl->translate.key;
+   struct gallivm_state *gallivm = bld->gallivm;
+   LLVMBuilderRef builder = gallivm->builder;
+   LLVMValueRef src[TRANSLATE_MAX_ATTRIBS][TRANSLATE_LLVM_MAX_LENGTH];
+   LLVMValueRef aos[TRANSLATE_MAX_ATTRIBS][TRANSLATE_LLVM_MAX_LENGTH];
+   LLVMValueRef vert_ptr;
+   unsigned attr, lane;
+
+   memset(src, 0, sizeof src);
+   memset(aos, 0, sizeof aos);
+
+   for (attr = 0; attr < key->nr_elements; attr++) {
+      const struct translate_element *elem = &key->element[attr];
+
+      if (elem->type == TRANSLATE_ELEMENT_INSTANCE_ID)
+         continue;
+
+      if (elem->instance_divisor) {
+         for (lane = 0; lane < tl->vector_length; lane++) {
+            src[attr][lane] = bld->instance_src[attr];
+            aos[attr][lane] = bld->instance_aos[attr];
+         }
+      }
+      else {
+         LLVMValueRef offsets = element_offsets(bld, attr, indices);
+
+         if (tl->element[attr].emit == TRANSLATE_LLVM_EMIT_COPY) {
+            for (lane = 0; lane < tl->vector_length; lane++) {
+               LLVMValueRef offset =
+                  LLVMBuildExtractElement(builder, offsets,
+                                          lp_build_const_int32(gallivm, lane),
+                                          "");
+               src[attr][lane] = LLVMBuildGEP(builder, bld->input_ptr[attr],
+                                              &offset, 1, "");
+            }
+         }
+         else {
+            fetch_element(bld, attr, offsets, aos[attr]);
+         }
+      }
+   }
+
+   first = LLVMBuildMul(builder, first,
+                        lp_build_const_int32(gallivm, key->output_stride), "");
+   vert_ptr = LLVMBuildGEP(builder, bld->output_ptr, &first, 1, "");
+
+   for (lane = 0; lane < tl->vector_length; lane++) {
+      struct lp_build_if_state if_ctx;
+      boolean guarded = remaining && lane > 0;
+
+      if (guarded) {
+         LLVMValueRef cond =
+            LLVMBuildICmp(builder, LLVMIntUGT, remaining,
+                          lp_build_const_int32(gallivm, lane), "");
+         lp_build_if(&if_ctx, gallivm, cond);
+      }
+
+      for (attr = 0; attr < key->nr_elements; attr++) {
+         LLVMValueRef offset =
+            lp_build_const_int32(gallivm, lane * key->output_stride +
+                                          key->element[attr].output_offset);
+         LLVMValueRef dst = LLVMBuildGEP(builder, vert_ptr, &offset, 1, "");
+
+         store_element(bld, attr, dst, src[attr][lane], aos[attr][lane]);
+      }
+
+      if (guarded)
+         lp_build_endif(&if_ctx);
+   }
+}
+
+
+/**
+ * Vertex indices of a full vector of vertices starting at 'first'.
+ */
+static LLVMValueRef
+load_indices(struct translate_llvm_build *bld,
+             unsigned index_size,
+             LLVMValueRef start_or_elts,
+             LLVMValueRef first)
+{
+   struct gallivm_state *gallivm = bld->gallivm;
+   LLVMBuilderRef builder = gallivm->builder;
+   struct lp_build_context *blduivec = &bld->blduivec;
+   LLVMTypeRef elt_type, vec_type;
+   LLVMValueRef indices, ptr;
+
+   if (!index_size) {
+      LLVMValueRef lanes[TRANSLATE_LLVM_MAX_LENGTH];
+      unsigned lane;
+
+      for (lane = 0; lane < blduivec->type.length; lane++)
+         lanes[lane] = lp_build_const_int32(gallivm, lane);
+
+      first = LLVMBuildAdd(builder, start_or_elts, first, "");
+      indices = lp_build_broadcast_scalar(blduivec, first);
+      return LLVMBuildAdd(builder, indices,
+                          LLVMConstVector(lanes, blduivec->type.length), "");
+   }
+
+   elt_type = LLVMIntTypeInContext(gallivm->context, index_size * 8);
+   vec_type = LLVMVectorType(elt_type, blduivec->type.length);
+
+   ptr = LLVMBuildGEP(builder, start_or_elts, &first, 1, "");
+   ptr = LLVMBuildBitCast(builder, ptr, LLVMPointerType(vec_type, 0), "");
+   indices = LLVMBuildLoad(builder, ptr, "elts");
+   LLVMSetAlignment(indices, index_size);
+
+   if (index_size < 4)
+      indices = LLVMBuildZExt(builder, indices, blduivec->vec_type, "");
+
+   return indices;
+}
+
+
+/**
+ * Vertex indices of the last, partial vector of vertices.  Unused lanes
+ * get index 0 (elts) or are clamped to the buffer size later (linear).
+ */
+static LLVMValueRef
+load_indices_tail(struct translate_llvm_build *bld,
+                  unsigned index_size,
+                  LLVMValueRef start_or_elts,
+                  LLVMValueRef first,
+                  LLVMValueRef remaining)
+{
+   struct gallivm_state *gallivm = bld->gallivm;
+   LLVMBuilderRef builder = gallivm->builder;
+   struct lp_build_context *blduivec = &bld->blduivec;
+   struct lp_build_for_loop_state loop;
+   LLVMValueRef indices_ptr, elt_ptr, index;
+
+   if (!index_size)
+      return load_indices(bld, index_size, start_or_elts, first);
+
+   indices_ptr = lp_build_alloca(gallivm, blduivec->vec_type, "indices");
+
+   lp_build_for_loop_begin(&loop, gallivm, lp_build_const_int32(gallivm, 0),
+                           LLVMIntULT, remaining,
+                           lp_build_const_int32(gallivm, 1));
+   {
+      index = LLVMBuildAdd(builder, first, loop.counter, "");
+      elt_ptr = LLVMBuildGEP(builder, start_or_elts, &index, 1, "");
+      index = LLVMBuildLoad(builder, elt_ptr, "");
+      if (index_size < 4)
+         index = LLVMBuildZExt(builder, index, blduivec->elem_type, "");
+
+      elt_ptr = LLVMBuildLoad(builder, indices_ptr, "");
+      elt_ptr = LLVMBuildInsertElement(builder, elt_ptr, index,
+                                       loop.counter, "");
+      LLVMBuildStore(builder, elt_ptr, indices_ptr);
+   }
+   lp_build_for_loop_end(&loop);
+
+   return LLVMBuildLoad(builder, indices_ptr, "");
+}
+
+
+/**
+ * Generate one of the run functions.  index_size is 0 for the linear
+ * run(), otherwise the size in bytes of the elements of the elts array.
+ */
+static LLVMValueRef
+generate_run(struct translate_llvm *tl, unsigned index_size)
+{
+   struct gallivm_state *gallivm = tl->gallivm;
+   const struct translate_key *key = &tl->translate.key;
+   LLVMContextRef context = gallivm->context;
+   LLVMTypeRef int32_type = LLVMInt32TypeInContext(context);
+   LLVMTypeRef int8_ptr_type =
+      LLVMPointerType(LLVMInt8TypeInContext(context), 0);
+   LLVMTypeRef arg_types[6];
+   LLVMTypeRef func_type;
+   LLVMValueRef func;
+   LLVMValueRef translate_ptr, start_or_elts, count, start_instance;
+   LLVMValueRef attribs_ptr, full_count, remaining, tmp;
+   LLVMBasicBlockRef block;
+   LLVMBuilderRef builder = gallivm->builder;
+   struct translate_llvm_build bld;
+   struct lp_build_for_loop_state loop;
+   struct lp_build_if_state if_ctx;
+   struct lp_type uint_type;
+   char func_name[64];
+   unsigned attr;
+
+   memset(&bld, 0, sizeof bld);
+   bld.tl = tl;
+   bld.gallivm = gallivm;
+
+   uint_type = lp_type_uint_vec(32, 32 * tl->vector_length);
+   lp_build_context_init(&bld.blduivec, gallivm, uint_type);
+
+   if (index_size)
+      util_snprintf(func_name, sizeof func_name, "translate_run_elts%u",
+                    index_size * 8);
+   else
+      util_snprintf(func_name, sizeof func_name, "translate_run");
+
+   arg_types[0] = int8_ptr_type;                               /* translate */
+   arg_types[1] = index_size ?
+      LLVMPointerType(LLVMIntTypeInContext(context, index_size * 8), 0) :
+      int32_type;                                              /* elts/start */
+   arg_types[2] = int32_type;                                  /* count */
+   arg_types[3] = int32_type;                                  /* start_instance */
+   arg_types[4] = int32_type;                                  /* instance_id */
+   arg_types[5] = int8_ptr_type;                               /* output */
+
+   func_type = LLVMFunctionType(LLVMVoidTypeInContext(context),
+                                arg_types, ARRAY_SIZE(arg_types), 0);
+   func = LLVMAddFunction(gallivm->module, func_name, func_type);
+   LLVMSetFunctionCallConv(func, LLVMCCallConv);
+   lp_add_function_attr(func, 6, LP_FUNC_ATTR_NOALIAS);
+
+   translate_ptr   = LLVMGetParam(func, 0);
+   start_or_elts   = LLVMGetParam(func, 1);
+   count           = LLVMGetParam(func, 2);
+   start_instance  = LLVMGetParam(func, 3);
+   bld.instance_id = LLVMGetParam(func, 4);
+   bld.output_ptr  = LLVMGetParam(func, 5);
+
+   lp_build_name(translate_ptr, "translate");
+   lp_build_name(start_or_elts, index_size ? "elts" : "start");
+   lp_build_name(count, "count");
+   lp_build_name(start_instance, "start_instance");
+   lp_build_name(bld.instance_id, "instance_id");
+   lp_build_name(bld.output_ptr, "output");
+
+   block = LLVMAppendBasicBlockInContext(context, func, "entry");
+   LLVMPositionBuilderAtEnd(builder, block);
+
+   tmp = lp_build_const_int32(gallivm, offsetof(struct translate_llvm, attrib));
+   attribs_ptr = LLVMBuildGEP(builder, translate_ptr, &tmp, 1, "");
+   attribs_ptr = LLVMBuildBitCast(builder, attribs_ptr,
+                                  tl->attrib_ptr_type, "attribs");
+
+   /*
+    * Per element state, and the data of instanced elements which is
+    * shared by all the vertices.
+    */
+   for (attr = 0; attr < key->nr_elements; attr++) {
+      const struct translate_element *elem = &key->element[attr];
+      LLVMValueRef attrib_ptr, index, offset;
+
+      if (elem->type == TRANSLATE_ELEMENT_INSTANCE_ID)
+         continue;
+
+      index = lp_build_const_int32(gallivm, attr);
+      attrib_ptr = LLVMBuildGEP(builder, attribs_ptr, &index, 1, "");
+      bld.input_ptr[attr] =
+         lp_build_struct_get(gallivm, attrib_ptr,
+                             TRANSLATE_LLVM_ATTRIB_INPUT_PTR, "input_ptr");
+      bld.input_stride[attr] =
+         lp_build_struct_get(gallivm, attrib_ptr,
+                             TRANSLATE_LLVM_ATTRIB_INPUT_STRIDE, "input_stride");
+      bld.max_index[attr] =
+         lp_build_struct_get(gallivm, attrib_ptr,
+                             TRANSLATE_LLVM_ATTRIB_MAX_INDEX, "max_index");
+
+      if (!elem->instance_divisor)
+         continue;
+
+      /*
+       * XXX like the other implementations this doesn't clamp the
+       * instance index.
+       */
+      index = LLVMBuildUDiv(builder, bld.instance_id,
+                            lp_build_const_int32(gallivm,
+                                                 elem->instance_divisor), "");
+      index = LLVMBuildAdd(builder, start_instance, index, "");
+      offset = LLVMBuildMul(builder, index, bld.input_stride[attr], "");
+
+      if (tl->element[attr].emit == TRANSLATE_LLVM_EMIT_COPY) {
+         bld.instance_src[attr] =
+            LLVMBuildGEP(builder, bld.input_ptr[attr], &offset, 1, "");
+      }
+      else {
+         LLVMValueRef aos[TRANSLATE_LLVM_MAX_LENGTH];
+         LLVMValueRef offsets =
+            lp_build_broadcast_scalar(&bld.blduivec, offset);
+
+         fetch_element(&bld, attr, offsets, aos);
+         bld.instance_aos[attr] = aos[0];
+      }
+   }
+
+   /* Full vectors */
+   full_count = LLVMBuildAnd(builder, count,
+                             lp_build_const_int32(gallivm,
+                                                  ~(tl->vector_length - 1)),
+                             "");
+
+   lp_build_for_loop_begin(&loop, gallivm, lp_build_const_int32(gallivm, 0),
+                           LLVMIntULT, full_count,
+                           lp_build_const_int32(gallivm, tl->vector_length));
+   {
+      LLVMValueRef indices = load_indices(&bld, index_size, start_or_elts,
+                                          loop.counter);
+      emit_vertices(&bld, indices, loop.counter, NULL);
+   }
+   lp_build_for_loop_end(&loop);
+
+   /* Remaining vertices */
+   remaining = LLVMBuildSub(builder, count, full_count, "");
+   tmp = LLVMBuildICmp(builder, LLVMIntNE, remaining,
+                       lp_build_const_int32(gallivm, 0), "");
+   lp_build_if(&if_ctx, gallivm, tmp);
+   {
+      LLVMValueRef indices = load_indices_tail(&bld, index_size,
+                                               start_or_elts, full_count,
+                                               remaining);
+      emit_vertices(&bld, indices, full_count, remaining);
+   }
+   lp_build_endif(&if_ctx);
+
+   LLVMBuildRetVoid(builder);
+
+   gallivm_verify_function(gallivm, func);
+
+   return func;
+}
+
+
+static void
+translate_llvm_set_buffer(struct translate *translate,
+                          unsigned buf,
+                          const void *ptr,
+                          unsigned stride,
+                          unsigned max_index)
+{
+   struct translate_llvm *tl = translate_llvm(translate);
+   unsigned i;
+
+   for (i = 0; i < translate->key.nr_elements; i++) {
+      if (translate->key.element[i].type == TRANSLATE_ELEMENT_NORMAL &&
+          translate->key.element[i].input_buffer == buf) {
+         tl->attrib[i].input_ptr = ((const uint8_t *)ptr +
+                                    translate->key.element[i].input_offset);
+         tl->attrib[i].input_stride = stride;
+         tl->attrib[i].max_index = max_index;
+      }
+   }
+}
+
+
+static void
+translate_llvm_release(struct translate *translate)
+{
+   struct translate_llvm *tl = translate_llvm(translate);
+
+   if (tl->gallivm)
+      gallivm_destroy(tl->gallivm);
+   if (tl->context)
+      LLVMContextDispose(tl->context);
+   FREE(tl);
+}
+
+
+/**
+ * Whether the output format is a 1 to 4 channel format with 32 bit float
+ * or (if integer is set) pure integer channels of the given type.
+ */
+static boolean
+is_32bit_output_format(const struct util_format_description *desc,
+                       boolean integer,
+                       enum util_format_type type)
+{
+   unsigned chan;
+
+   if (desc->layout != UTIL_FORMAT_LAYOUT_PLAIN ||
+       desc->block.bits != 32 * desc->nr_channels)
+      return FALSE;
+
+   for (chan = 0; chan < desc->nr_channels; chan++) {
+      if (desc->swizzle[chan] != chan ||
+          desc->channel[chan].size != 32 ||
+          desc->channel[chan].type != type ||
+          desc->channel[chan].pure_integer != integer ||
+          desc->channel[chan].normalized)
+         return FALSE;
+   }
+
+   return TRUE;
+}
+
+
+/**
+ * Choose how an element is emitted.  Returns FALSE if the conversion is
+ * not supported.
+ */
+static boolean
+init_element(struct translate_llvm *tl, unsigned attr)
+{
+   const struct translate_element *elem = &tl->translate.key.element[attr];
+   const struct util_format_description *out_desc =
+      util_format_description(elem->output_format);
+   const struct util_format_description *in_desc;
+
+   if (!out_desc)
+      return FALSE;
+
+   if (elem->type == TRANSLATE_ELEMENT_INSTANCE_ID) {
+      tl->element[attr].emit = TRANSLATE_LLVM_EMIT_INSTANCE_ID;
+
+      switch (elem->output_format) {
+      case PIPE_FORMAT_R32_USCALED:
+      case PIPE_FORMAT_R32_SSCALED:
+      case PIPE_FORMAT_R32_UINT:
+      case PIPE_FORMAT_R32_SINT:
+         tl->element[attr].output_float = FALSE;
+         return TRUE;
+      case PIPE_FORMAT_R32_FLOAT:
+         tl->element[attr].output_float = TRUE;
+         return TRUE;
+      default:
+         return FALSE;
+      }
+   }
+
+   in_desc = util_format_description(elem->input_format);
+   if (!in_desc)
+      return FALSE;
+
+   if (elem->input_format == elem->output_format &&
+       in_desc->block.width == 1 &&
+       in_desc->block.height == 1 &&
+       !(in_desc->block.bits & 7)) {
+      tl->element[attr].emit = TRANSLATE_LLVM_EMIT_COPY;
+      tl->element[attr].copy_size = in_desc->block.bits >> 3;
+      return TRUE;
+   }
+
+   tl->element[attr].emit = TRANSLATE_LLVM_EMIT_CONVERT;
+   tl->element[attr].nr_channels = out_desc->nr_channels;
+
+   if (in_desc->channel[0].pure_integer) {
+      enum util_format_type type = in_desc->channel[0].type;
+      unsigned chan;
+
+      /* Integers must keep their sign and precision */
+      if (!is_32bit_output_format(out_desc, TRUE, type))
+         return FALSE;
+
+      for (chan = 0; chan < MIN2(in_desc->nr_channels,
+                                 out_desc->nr_channels); chan++) {
+         if (in_desc->channel[chan].type != type)
+            return FALSE;
+      }
+
+      tl->element[attr].output_float = FALSE;
+      if (type == UTIL_FORMAT_TYPE_SIGNED)
+         tl->element[attr].fetch_type =
+            lp_type_int_vec(32, 32 * tl->vector_length);
+      else
+         tl->element[attr].fetch_type =
+            lp_type_uint_vec(32, 32 * tl->vector_length);
+   }
+   else {
+      if (!is_32bit_output_format(out_desc, FALSE, UTIL_FORMAT_TYPE_FLOAT))
+         return FALSE;
+
+      tl->element[attr].output_float = TRUE;
+      tl->element[attr].fetch_type =
+         lp_type_float_vec(32, 32 * tl->vector_length);
+   }
+
+   return TRUE;
+}
+
+
+struct translate *
+translate_llvm_create(const struct translate_key *key)
+{
+   struct translate_llvm *tl;
+   LLVMValueRef run, run_elts, run_elts16, run_elts8;
+   unsigned i;
+
+   if (!lp_build_init())
+      return NULL;
+
+   tl = CALLOC_STRUCT(translate_llvm);
+   if (!tl)
+      return NULL;
+
+   assert(key->nr_elements <= TRANSLATE_MAX_ATTRIBS);
+
+   tl->translate.key = *key;
+   tl->translate.release = translate_llvm_release;
+   tl->translate.set_buffer = translate_llvm_set_buffer;
+   tl->vector_length = MIN2(lp_native_vector_width / 32,
+                            TRANSLATE_LLVM_MAX_LENGTH);
+
+   for (i = 0; i < key->nr_elements; i++) {
+      if (!init_element(tl, i))
+         goto fail;
+   }
+
+   tl->context = LLVMContextCreate();
+   if (!tl->context)
+      goto fail;
+
+   tl->gallivm = gallivm_create("translate", tl->context, NULL);
+   if (!tl->gallivm)
+      goto fail;
+
+   tl->attrib_ptr_type = LLVMPointerType(create_attrib_type(tl->gallivm), 0);
+
+   run = generate_run(tl, 0);
+   run_elts = generate_run(tl, 4);
+   run_elts16 = generate_run(tl, 2);
+   run_elts8 = generate_run(tl, 1);
+
+   gallivm_compile_module(tl->gallivm);
+
+   tl->translate.run = (run_func)
+      gallivm_jit_function(tl->gallivm, run);
+   tl->translate.run_elts = (run_elts_func)
+      gallivm_jit_function(tl->gallivm, run_elts);
+   tl->translate.run_elts16 = (run_elts16_func)
+      gallivm_jit_function(tl->gallivm, run_elts16);
+   tl->translate.run_elts8 = (run_elts8_func)
+      gallivm_jit_function(tl->gallivm, run_elts8);
+
+   gallivm_free_ir(tl->gallivm);
+
+   return &tl->translate;
+
+fail:
+   translate_llvm_release(&tl->translate);
+   return NULL;
+}
@@ -549,6 +549,1587 @@ util_format_test_cases[] =
          }
       }
    },
+   {
+      PIPE_FORMAT_RGTC1_UNORM,
+      PACKED_8x8(0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff),
+      PACKED_8x8(0xf0, 0x10, 0x88, 0xc6, 0xfa, 0x88, 0xc6, 0xfa),
+      {
+         {
+            {0xf0/255.0, 0x00/255.0, 0x00/255.0, 0xff/255.0},
+            {0x10/255.0, 0x00/255.0, 0x00/255.0, 0xff/255.0},
+            {0xd0/255.0, 0x00/255.0, 0x00/255.0, 0xff/255.0},
+            {0xb0/255.0, 0x00/255.0, 0x00/255.0, 0xff/255.0}
+         },
+         {
+            {0x90/255.0, 0x00/255.0, 0x00/255.0, 0xff/255.0},
+            {0x70/255.0, 0x00/255.0, 0x00/255.0, 0xff/255.0},
+            {0x50/255.0, 0x00/255.0, 0x00/255.0, 0xff/255.0},
+            {0x30/255.0, 0x00/255.0, 0x00/255.0, 0xff/255.0}
+         },
+         {
+            {0xf0/255.0, 0x00/255.0, 0x00/255.0, 0xff/255.0},
+            {0x10/255.0, 0x00/255.0, 0x00/255.0, 0xff/255.0},
+            {0xd0/255.0, 0x00/255.0, 0x00/255.0, 0xff/255.0},
+            {0xb0/255.0, 0x00/255.0, 0x00/255.0, 0xff/255.0}
+         },
+         {
+            {0x90/255.0, 0x00/255.0, 0x00/255.0, 0xff/255.0},
+            {0x70/255.0, 0x00/255.0, 0x00/255.0, 0xff/255.0},
+            {0x50/255.0, 0x00/255.0, 0x00/255.0, 0xff/255.0},
+            {0x30/255.0, 0x00/255.0, 0x00/255.0, 0xff/255.0}
+         }
+      }
+   },
+   {
+      PIPE_FORMAT_RGTC1_UNORM,
+      PACKED_8x8(0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff),
+      PACKED_8x8(0x20, 0xd0, 0x63, 0x7d, 0x44, 0x63, 0x7d, 0x44),
+      {
+         {
+            {0x66/255.0, 0x00/255.0, 0x00/255.0, 0xff/255.0},
+            {0x89/255.0, 0x00/255.0, 0x00/255.0, 0xff/255.0},
+            {0xac/255.0, 0x00/255.0, 0x00/255.0, 0xff/255.0},
+            {0x00/255.0, 0x00/255.0, 0x00/255.0, 0xff/255.0}
+         },
+         {
+            {0xff/255.0, 0x00/255.0, 0x00/255.0, 0xff/255.0},
+            {0x20/255.0, 0x00/255.0, 0x00/255.0, 0xff/255.0},
+            {0xd0/255.0, 0x00/255.0, 0x00/255.0, 0xff/255.0},
+            {0x43/255.0, 0x00/255.0, 0x00/255.0, 0xff/255.0}
+         },
+         {
+            {0x66/255.0, 0x00/255.0, 0x00/255.0, 0xff/255.0},
+            {0x89/255.0, 0x00/255.0, 0x00/255.0, 0xff/255.0},
+            {0xac/255.0, 0x00/255.0, 0x00/255.0, 0xff/255.0},
+            {0x00/255.0, 0x00/255.0, 0x00/255.0, 0xff/255.0}
+         },
+         {
+            {0xff/255.0, 0x00/255.0, 0x00/255.0, 0xff/255.0},
+            {0x20/255.0, 0x00/255.0, 0x00/255.0, 0xff/255.0},
+            {0xd0/255.0, 0x00/255.0, 0x00/255.0, 0xff/255.0},
+            {0x43/255.0, 0x00/255.0, 0x00/255.0, 0xff/255.0}
+         }
+      }
+   },
+   {
+      PIPE_FORMAT_RGTC1_SNORM,
+      PACKED_8x8(0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff),
+      PACKED_8x8(0x70, 0x90, 0xf5, 0x11, 0x8d, 0xf5, 0x11, 0x8d),
+      {
+         {
+            {-16/127.0, 0.0, 0.0, 1.0},
+            {-48/127.0, 0.0, 0.0, 1.0},
+            {-80/127.0, 0.0, 0.0, 1.0},
+            {112/127.0, 0.0, 0.0, 1.0}
+         },
+         {
+            {-112/127.0, 0.0, 0.0, 1.0},
+            {80/127.0, 0.0, 0.0, 1.0},
+            {48/127.0, 0.0, 0.0, 1.0},
+            {16/127.0, 0.0, 0.0, 1.0}
+         },
+         {
+            {-16/127.0, 0.0, 0.0, 1.0},
+            {-48/127.0, 0.0, 0.0, 1.0},
+            {-80/127.0, 0.0, 0.0, 1.0},
+            {112/127.0, 0.0, 0.0, 1.0}
+         },
+         {
+            {-112/127.0, 0.0, 0.0, 1.0},
+            {80/127.0, 0.0, 0.0, 1.0},
+            {48/127.0, 0.0, 0.0, 1.0},
+            {16/127.0, 0.0, 0.0, 1.0}
+         }
+      }
+   },
+   {
+      PIPE_FORMAT_RGTC1_SNORM,
+      PACKED_8x8(0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff),
+      PACKED_8x8(0x80, 0x40, 0x1a, 0xeb, 0x23, 0x1a, 0xeb, 0x23),
+      {
+         {
+            {-89/127.0, 0.0, 0.0, 1.0},
+            {-51/127.0, 0.0, 0.0, 1.0},
+            {-12/127.0, 0.0, 0.0, 1.0},
+            {25/127.0, 0.0, 0.0, 1.0}
+         },
+         {
+            {-1.0, 0.0, 0.0, 1.0},
+            {127/127.0, 0.0, 0.0, 1.0},
+            {-1.0, 0.0, 0.0, 1.0},
+            {64/127.0, 0.0, 0.0, 1.0}
+         },
+         {
+            {-89/127.0, 0.0, 0.0, 1.0},
+            {-51/127.0, 0.0, 0.0, 1.0},
+            {-12/127.0, 0.0, 0.0, 1.0},
+            {25/127.0, 0.0, 0.0, 1.0}
+         },
+         {
+            {-1.0, 0.0, 0.0, 1.0},
+            {127/127.0, 0.0, 0.0, 1.0},
+            {-1.0, 0.0, 0.0, 1.0},
+            {64/127.0, 0.0, 0.0, 1.0}
+         }
+      }
+   },
+   {
+      PIPE_FORMAT_RGTC2_UNORM,
+      {0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff},
+      {0xf0, 0x10, 0x88, 0xc6, 0xfa, 0x88, 0xc6, 0xfa, 0x20, 0xd0, 0x63, 0x7d, 0x44, 0x63, 0x7d, 0x44},
+      {
+         {
+            {0xf0/255.0, 0x66/255.0, 0x00/255.0, 0xff/255.0},
+            {0x10/255.0, 0x89/255.0, 0x00/255.0, 0xff/255.0},
+            {0xd0/255.0, 0xac/255.0, 0x00/255.0, 0xff/255.0},
+            {0xb0/255.0, 0x00/255.0, 0x00/255.0, 0xff/255.0}
+         },
+         {
+            {0x90/255.0, 0xff/255.0, 0x00/255.0, 0xff/255.0},
+            {0x70/255.0, 0x20/255.0, 0x00/255.0, 0xff/255.0},
+            {0x50/255.0, 0xd0/255.0, 0x00/255.0, 0xff/255.0},
+            {0x30/255.0, 0x43/255.0, 0x00/255.0, 0xff/255.0}
+         },
+         {
+            {0xf0/255.0, 0x66/255.0, 0x00/255.0, 0xff/255.0},
+            {0x10/255.0, 0x89/255.0, 0x00/255.0, 0xff/255.0},
+            {0xd0/255.0, 0xac/255.0, 0x00/255.0, 0xff/255.0},
+            {0xb0/255.0, 0x00/255.0, 0x00/255.0, 0xff/255.0}
+         },
+         {
+            {0x90/255.0, 0xff/255.0, 0x00/255.0, 0xff/255.0},
+            {0x70/255.0, 0x20/255.0, 0x00/255.0, 0xff/255.0},
+            {0x50/255.0, 0xd0/255.0, 0x00/255.0, 0xff/255.0},
+            {0x30/255.0, 0x43/255.0, 0x00/255.0, 0xff/255.0}
+         }
+      }
+   },
+   {
+      PIPE_FORMAT_RGTC2_SNORM,
+      {0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff},
+      {0x70, 0x90, 0xf5, 0x11, 0x8d, 0xf5, 0x11, 0x8d, 0x80, 0x40, 0x1a, 0xeb, 0x23, 0x1a, 0xeb, 0x23},
+      {
+         {
+            {-16/127.0, -89/127.0, 0.0, 1.0},
+            {-48/127.0, -51/127.0, 0.0, 1.0},
+            {-80/127.0, -12/127.0, 0.0, 1.0},
+            {112/127.0, 25/127.0, 0.0, 1.0}
+         },
+         {
+            {-112/127.0, -1.0, 0.0, 1.0},
+            {80/127.0, 127/127.0, 0.0, 1.0},
+            {48/127.0, -1.0, 0.0, 1.0},
+            {16/127.0, 64/127.0, 0.0, 1.0}
+         },
+         {
+            {-16/127.0, -89/127.0, 0.0, 1.0},
+            {-48/127.0, -51/127.0, 0.0, 1.0},
+            {-80/127.0, -12/127.0, 0.0, 1.0},
+            {112/127.0, 25/127.0, 0.0, 1.0}
+         },
+         {
+            {-112/127.0, -1.0, 0.0, 1.0},
+            {80/127.0, 127/127.0, 0.0, 1.0},
+            {48/127.0, -1.0, 0.0, 1.0},
+            {16/127.0, 64/127.0, 0.0, 1.0}
+         }
+      }
+   },
+   {
+      PIPE_FORMAT_LATC1_UNORM,
+      PACKED_8x8(0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff),
+      PACKED_8x8(0x20, 0xd0, 0x63, 0x7d, 0x44, 0x63, 0x7d, 0x44),
+      {
+         {
+            {0x66/255.0, 0x66/255.0, 0x66/255.0, 0xff/255.0},
+            {0x89/255.0, 0x89/255.0, 0x89/255.0, 0xff/255.0},
+            {0xac/255.0, 0xac/255.0, 0xac/255.0, 0xff/255.0},
+            {0x00/255.0, 0x00/255.0, 0x00/255.0, 0xff/255.0}
+         },
+         {
+            {0xff/255.0, 0xff/255.0, 0xff/255.0, 0xff/255.0},
+            {0x20/255.0, 0x20/255.0, 0x20/255.0, 0xff/255.0},
+            {0xd0/255.0, 0xd0/255.0, 0xd0/255.0, 0xff/255.0},
+            {0x43/255.0, 0x43/255.0, 0x43/255.0, 0xff/255.0}
+         },
+         {
+            {0x66/255.0, 0x66/255.0, 0x66/255.0, 0xff/255.0},
+            {0x89/255.0, 0x89/255.0, 0x89/255.0, 0xff/255.0},
+            {0xac/255.0, 0xac/255.0, 0xac/255.0, 0xff/255.0},
+            {0x00/255.0, 0x00/255.0, 0x00/255.0, 0xff/255.0}
+         },
+         {
+            {0xff/255.0, 0xff/255.0, 0xff/255.0, 0xff/255.0},
+            {0x20/255.0, 0x20/255.0, 0x20/255.0, 0xff/255.0},
+            {0xd0/255.0, 0xd0/255.0, 0xd0/255.0, 0xff/255.0},
+            {0x43/255.0, 0x43/255.0, 0x43/255.0, 0xff/255.0}
+         }
+      }
+   },
+   {
+      PIPE_FORMAT_LATC1_SNORM,
+      PACKED_8x8(0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff),
+      PACKED_8x8(0x80, 0x40, 0x1a, 0xeb, 0x23, 0x1a, 0xeb, 0x23),
+      {
+         {
+            {-89/127.0, -89/127.0, -89/127.0, 1.0},
+            {-51/127.0, -51/127.0, -51/127.0, 1.0},
+            {-12/127.0, -12/127.0, -12/127.0, 1.0},
+            {25/127.0, 25/127.0, 25/127.0, 1.0}
+         },
+         {
+            {-1.0, -1.0, -1.0, 1.0},
+            {127/127.0, 127/127.0, 127/127.0, 1.0},
+            {-1.0, -1.0, -1.0, 1.0},
+            {64/127.0, 64/127.0, 64/127.0, 1.0}
+         },
+         {
+            {-89/127.0, -89/127.0, -89/127.0, 1.0},
+            {-51/127.0, -51/127.0, -51/127.0, 1.0},
+            {-12/127.0, -12/127.0, -12/127.0, 1.0},
+            {25/127.0, 25/127.0, 25/127.0, 1.0}
+         },
+         {
+            {-1.0, -1.0, -1.0, 1.0},
+            {127/127.0, 127/127.0, 127/127.0, 1.0},
+            {-1.0, -1.0, -1.0, 1.0},
+            {64/127.0, 64/127.0, 64/127.0, 1.0}
+         }
+      }
+   },
+   {
+      PIPE_FORMAT_LATC2_UNORM,
+      {0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff},
+      {0x20, 0xd0, 0x63, 0x7d, 0x44, 0x63, 0x7d, 0x44, 0xf0, 0x10, 0x88, 0xc6, 0xfa, 0x88, 0xc6, 0xfa},
+      {
+         {
+            {0x66/255.0, 0x66/255.0, 0x66/255.0, 0xf0/255.0},
+            {0x89/255.0, 0x89/255.0, 0x89/255.0, 0x10/255.0},
+            {0xac/255.0, 0xac/255.0, 0xac/255.0, 0xd0/255.0},
+            {0x00/255.0, 0x00/255.0, 0x00/255.0, 0xb0/255.0}
+         },
+         {
+            {0xff/255.0, 0xff/255.0, 0xff/255.0, 0x90/255.0},
+            {0x20/255.0, 0x20/255.0, 0x20/255.0, 0x70/255.0},
+            {0xd0/255.0, 0xd0/255.0, 0xd0/255.0, 0x50/255.0},
+            {0x43/255.0, 0x43/255.0, 0x43/255.0, 0x30/255.0}
+         },
+         {
+            {0x66/255.0, 0x66/255.0, 0x66/255.0, 0xf0/255.0},
+            {0x89/255.0, 0x89/255.0, 0x89/255.0, 0x10/255.0},
+            {0xac/255.0, 0xac/255.0, 0xac/255.0, 0xd0/255.0},
+            {0x00/255.0, 0x00/255.0, 0x00/255.0, 0xb0/255.0}
+         },
+         {
+            {0xff/255.0, 0xff/255.0, 0xff/255.0, 0x90/255.0},
+            {0x20/255.0, 0x20/255.0, 0x20/255.0, 0x70/255.0},
+            {0xd0/255.0, 0xd0/255.0, 0xd0/255.0, 0x50/255.0},
+            {0x43/255.0, 0x43/255.0, 0x43/255.0, 0x30/255.0}
+         }
+      }
+   },
+   {
+      PIPE_FORMAT_LATC2_SNORM,
+      {0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff},
+      {0x80, 0x40, 0x1a, 0xeb, 0x23, 0x1a, 0xeb, 0x23, 0x70, 0x90, 0xf5, 0x11, 0x8d, 0xf5, 0x11, 0x8d},
+      {
+         {
+            {-89/127.0, -89/127.0, -89/127.0, -16/127.0},
+            {-51/127.0, -51/127.0, -51/127.0, -48/127.0},
+            {-12/127.0, -12/127.0, -12/127.0, -80/127.0},
+            {25/127.0, 25/127.0, 25/127.0, 112/127.0}
+         },
+         {
+            {-1.0, -1.0, -1.0, -112/127.0},
+            {127/127.0, 127/127.0, 127/127.0, 80/127.0},
+            {-1.0, -1.0, -1.0, 48/127.0},
+            {64/127.0, 64/127.0, 64/127.0, 16/127.0}
+         },
+         {
+            {-89/127.0, -89/127.0, -89/127.0, -16/127.0},
+            {-51/127.0, -51/127.0, -51/127.0, -48/127.0},
+            {-12/127.0, -12/127.0, -12/127.0, -80/127.0},
+            {25/127.0, 25/127.0, 25/127.0, 112/127.0}
+         },
+         {
+            {-1.0, -1.0, -1.0, -112/127.0},
+            {127/127.0, 127/127.0, 127/127.0, 80/127.0},
+            {-1.0, -1.0, -1.0, 48/127.0},
+            {64/127.0, 64/127.0, 64/127.0, 16/127.0}
+         }
+      }
+   },
+   {
+      PIPE_FORMAT_BPTC_RGBA_UNORM,
+      {0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff},
+      {0x69, 0x47, 0x1d, 0x94, 0xec, 0x89, 0x93, 0xc7, 0x44, 0xbc, 0xd8, 0xcf, 0xcb, 0x3c, 0xc5, 0xa6},
+      {
+         {
+            {0x82/255.0, 0x55/255.0, 0x8c/255.0, 0xff/255.0},
+            {0x45/255.0, 0x5f/255.0, 0x47/255.0, 0xff/255.0},
+            {0x31/255.0, 0x63/255.0, 0x31/255.0, 0xff/255.0},
+            {0xa9/255.0, 0x4e/255.0, 0xb8/255.0, 0xff/255.0}
+         },
+         {
+            {0x31/255.0, 0x63/255.0, 0x31/255.0, 0xff/255.0},
+            {0x58/255.0, 0x5c/255.0, 0x5d/255.0, 0xff/255.0},
+            {0x6c/255.0, 0x58/255.0, 0x73/255.0, 0xff/255.0},
+            {0xa9/255.0, 0x4e/255.0, 0xb8/255.0, 0xff/255.0}
+         },
+         {
+            {0xc5/255.0, 0xaf/255.0, 0x4c/255.0, 0xff/255.0},
+            {0xc5/255.0, 0xaf/255.0, 0x4c/255.0, 0xff/255.0},
+            {0x2e/255.0, 0xb8/255.0, 0x59/255.0, 0xff/255.0},
+            {0x17/255.0, 0xbf/255.0, 0x3d/255.0, 0xff/255.0}
+         },
+         {
+            {0xdf/255.0, 0x5d/255.0, 0x2b/255.0, 0xff/255.0},
+            {0xdf/255.0, 0x5d/255.0, 0x2b/255.0, 0xff/255.0},
+            {0x5f/255.0, 0xa9/255.0, 0x93/255.0, 0xff/255.0},
+            {0x2e/255.0, 0xb8/255.0, 0x59/255.0, 0xff/255.0}
+         }
+      }
+   },
+   {
+      PIPE_FORMAT_BPTC_RGBA_UNORM,
+      {0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff},
+      {0xda, 0xa8, 0xe6, 0xca, 0xa4, 0xe2, 0x3b, 0x69, 0xbd, 0x41, 0x89, 0x41, 0xda, 0x1e, 0xdc, 0x4e},
+      {
+         {
+            {0x93/255.0, 0x75/255.0, 0xb5/255.0, 0xff/255.0},
+            {0xb9/255.0, 0xf9/255.0, 0x6c/255.0, 0xff/255.0},
+            {0xc0/255.0, 0xa8/255.0, 0x59/255.0, 0xff/255.0},
+            {0xa3/255.0, 0x93/255.0, 0xa7/255.0, 0xff/255.0}
+         },
+         {
+            {0x82/255.0, 0x56/255.0, 0xc3/255.0, 0xff/255.0},
+            {0x82/255.0, 0x56/255.0, 0xc3/255.0, 0xff/255.0},
+            {0xc7/255.0, 0x53/255.0, 0x46/255.0, 0xff/255.0},
+            {0xc7/255.0, 0x53/255.0, 0x46/255.0, 0xff/255.0}
+         },
+         {
+            {0xc7/255.0, 0x53/255.0, 0x46/255.0, 0xff/255.0},
+            {0x8b/255.0, 0x67/255.0, 0xbb/255.0, 0xff/255.0},
+            {0xa3/255.0, 0x93/255.0, 0xa7/255.0, 0xff/255.0},
+            {0xc7/255.0, 0x53/255.0, 0x46/255.0, 0xff/255.0}
+         },
+         {
+            {0xc5/255.0, 0x6e/255.0, 0x4c/255.0, 0xff/255.0},
+            {0xc5/255.0, 0x6e/255.0, 0x4c/255.0, 0xff/255.0},
+            {0x8b/255.0, 0x67/255.0, 0xbb/255.0, 0xff/255.0},
+            {0x93/255.0, 0x75/255.0, 0xb5/255.0, 0xff/255.0}
+         }
+      }
+   },
+   {
+      PIPE_FORMAT_BPTC_RGBA_UNORM,
+      {0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff},
+      {0xc4, 0x13, 0xc6, 0x82, 0x49, 0x4c, 0x19, 0xe2, 0x74, 0x0e, 0xa9, 0x4a, 0x4f, 0x39, 0x49, 0x20},
+      {
+         {
+            {0x73/255.0, 0xbb/255.0, 0x71/255.0, 0xff/255.0},
+            {0xc6/255.0, 0x63/255.0, 0x94/255.0, 0xff/255.0},
+            {0x8a/255.0, 0x58/255.0, 0x7e/255.0, 0xff/255.0},
+            {0x73/255.0, 0xbb/255.0, 0x71/255.0, 0xff/255.0}
+         },
+         {
+            {0x9d/255.0, 0xb0/255.0, 0x43/255.0, 0xff/255.0},
+            {0x8a/255.0, 0x58/255.0, 0x7e/255.0, 0xff/255.0},
+            {0x8a/255.0, 0x58/255.0, 0x7e/255.0, 0xff/255.0},
+            {0x9d/255.0, 0xb0/255.0, 0x43/255.0, 0xff/255.0}
+         },
+         {
+            {0x63/255.0, 0xe7/255.0, 0x29/255.0, 0xff/255.0},
+            {0x73/255.0, 0xd1/255.0, 0x6a/255.0, 0xff/255.0},
+            {0x84/255.0, 0xbb/255.0, 0xae/255.0, 0xff/255.0},
+            {0x63/255.0, 0xe7/255.0, 0x29/255.0, 0xff/255.0}
+         },
+         {
+            {0x63/255.0, 0xe7/255.0, 0x29/255.0, 0xff/255.0},
+            {0x63/255.0, 0xe7/255.0, 0x29/255.0, 0xff/255.0},
+            {0x73/255.0, 0xd1/255.0, 0x6a/255.0, 0xff/255.0},
+            {0x63/255.0, 0xe7/255.0, 0x29/255.0, 0xff/255.0}
+         }
+      }
+   },
+   {
+      PIPE_FORMAT_BPTC_RGBA_UNORM,
+      {0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff},
+      {0x08, 0x77, 0x6d, 0xb8, 0xbe, 0x59, 0x25, 0x51, 0x54, 0x7a, 0x34, 0x28, 0xe1, 0x41, 0x4d, 0x18},
+      {
+         {
+            {0xba/255.0, 0xcc/255.0, 0x2a/255.0, 0xff/255.0},
+            {0x71/255.0, 0x25/255.0, 0x69/255.0, 0xff/255.0},
+            {0x6c/255.0, 0x54/255.0, 0x7a/255.0, 0xff/255.0},
+            {0x6c/255.0, 0x54/255.0, 0x7a/255.0, 0xff/255.0}
+         },
+         {
+            {0x71/255.0, 0x25/255.0, 0x69/255.0, 0xff/255.0},
+            {0x71/255.0, 0x25/255.0, 0x69/255.0, 0xff/255.0},
+            {0x71/255.0, 0x25/255.0, 0x69/255.0, 0xff/255.0},
+            {0xa0/255.0, 0xa5/255.0, 0x44/255.0, 0xff/255.0}
+         },
+         {
+            {0xa0/255.0, 0xa5/255.0, 0x44/255.0, 0xff/255.0},
+            {0xfa/255.0, 0x14/255.0, 0xa0/255.0, 0xff/255.0},
+            {0xba/255.0, 0xcc/255.0, 0x2a/255.0, 0xff/255.0},
+            {0xa0/255.0, 0xa5/255.0, 0x44/255.0, 0xff/255.0}
+         },
+         {
+            {0xba/255.0, 0xcc/255.0, 0x2a/255.0, 0xff/255.0},
+            {0x86/255.0, 0x7b/255.0, 0x60/255.0, 0xff/255.0},
+            {0xa0/255.0, 0xa5/255.0, 0x44/255.0, 0xff/255.0},
+            {0xba/255.0, 0xcc/255.0, 0x2a/255.0, 0xff/255.0}
+         }
+      }
+   },
+   {
+      PIPE_FORMAT_BPTC_RGBA_UNORM,
+      {0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff},
+      {0x10, 0x71, 0xde, 0x14, 0xf2, 0x41, 0x77, 0x0b, 0xea, 0x05, 0x37, 0xb5, 0xdd, 0x78, 0xa9, 0x3a},
+      {
+         {
+            {0x91/255.0, 0x97/255.0, 0x49/255.0, 0x69/255.0},
+            {0x97/255.0, 0x70/255.0, 0x8d/255.0, 0xb9/255.0},
+            {0x9c/255.0, 0x4a/255.0, 0xce/255.0, 0x86/255.0},
+            {0x97/255.0, 0x70/255.0, 0x8d/255.0, 0x4f/255.0}
+         },
+         {
+            {0x91/255.0, 0x97/255.0, 0x49/255.0, 0x69/255.0},
+            {0x91/255.0, 0x97/255.0, 0x49/255.0, 0x69/255.0},
+            {0x8c/255.0, 0xbd/255.0, 0x08/255.0, 0xd3/255.0},
+            {0x8c/255.0, 0xbd/255.0, 0x08/255.0, 0xb9/255.0}
+         },
+         {
+            {0x91/255.0, 0x97/255.0, 0x49/255.0, 0x1c/255.0},
+            {0x91/255.0, 0x97/255.0, 0x49/255.0, 0xd3/255.0},
+            {0x9c/255.0, 0x4a/255.0, 0xce/255.0, 0xa0/255.0},
+            {0x9c/255.0, 0x4a/255.0, 0xce/255.0, 0x86/255.0}
+         },
+         {
+            {0x97/255.0, 0x70/255.0, 0x8d/255.0, 0x4f/255.0},
+            {0x8c/255.0, 0xbd/255.0, 0x08/255.0, 0xa0/255.0},
+            {0x8c/255.0, 0xbd/255.0, 0x08/255.0, 0xb9/255.0},
+            {0x97/255.0, 0x70/255.0, 0x8d/255.0, 0x36/255.0}
+         }
+      }
+   },
+   {
+      PIPE_FORMAT_BPTC_RGBA_UNORM,
+      {0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff},
+      {0xa0, 0x2a, 0x90, 0x6b, 0xb2, 0x44, 0xa8, 0xf2, 0xe6, 0xcb, 0x5a, 0x83, 0x7e, 0xba, 0x11, 0xf2},
+      {
+         {
+            {0x4d/255.0, 0xb0/255.0, 0x6b/255.0, 0x4a/255.0},
+            {0x54/255.0, 0xbc/255.0, 0x97/255.0, 0x5c/255.0},
+            {0x40/255.0, 0xbc/255.0, 0x10/255.0, 0x26/255.0},
+            {0x40/255.0, 0xb0/255.0, 0x10/255.0, 0x26/255.0}
+         },
+         {
+            {0x4d/255.0, 0xb6/255.0, 0x6b/255.0, 0x4a/255.0},
+            {0x4d/255.0, 0xb6/255.0, 0x6b/255.0, 0x4a/255.0},
+            {0x47/255.0, 0xbc/255.0, 0x3c/255.0, 0x38/255.0},
+            {0x4d/255.0, 0xb6/255.0, 0x6b/255.0, 0x4a/255.0}
+         },
+         {
+            {0x4d/255.0, 0xb0/255.0, 0x6b/255.0, 0x4a/255.0},
+            {0x40/255.0, 0xaa/255.0, 0x10/255.0, 0x26/255.0},
+            {0x47/255.0, 0xb0/255.0, 0x3c/255.0, 0x38/255.0},
+            {0x47/255.0, 0xaa/255.0, 0x3c/255.0, 0x38/255.0}
+         },
+         {
+            {0x4d/255.0, 0xb6/255.0, 0x6b/255.0, 0x4a/255.0},
+            {0x54/255.0, 0xaa/255.0, 0x97/255.0, 0x5c/255.0},
+            {0x54/255.0, 0xbc/255.0, 0x97/255.0, 0x5c/255.0},
+            {0x4d/255.0, 0xbc/255.0, 0x6b/255.0, 0x4a/255.0}
+         }
+      }
+   },
+   {
+      PIPE_FORMAT_BPTC_RGBA_UNORM,
+      {0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff},
+      {0xc0, 0x36, 0x09, 0xb3, 0xd8, 0x5e, 0x48, 0xc5, 0xf4, 0x32, 0x5c, 0xf8, 0x48, 0x22, 0x5f, 0xc0},
+      {
+         {
+            {0xc6/255.0, 0x2d/255.0, 0xa4/255.0, 0x52/255.0},
+            {0x48/255.0, 0x16/255.0, 0x2e/255.0, 0x8a/255.0},
+            {0xc6/255.0, 0x2d/255.0, 0xa4/255.0, 0x52/255.0},
+            {0xbd/255.0, 0x2c/255.0, 0x9b/255.0, 0x56/255.0}
+         },
+         {
+            {0x66/255.0, 0x1b/255.0, 0x4a/255.0, 0x7d/255.0},
+            {0xab/255.0, 0x28/255.0, 0x8a/255.0, 0x5e/255.0},
+            {0x8d/255.0, 0x23/255.0, 0x6e/255.0, 0x6c/255.0},
+            {0x48/255.0, 0x16/255.0, 0x2e/255.0, 0x8a/255.0}
+         },
+         {
+            {0x8d/255.0, 0x23/255.0, 0x6e/255.0, 0x6c/255.0},
+            {0xb4/255.0, 0x2a/255.0, 0x93/255.0, 0x5a/255.0},
+            {0xc6/255.0, 0x2d/255.0, 0xa4/255.0, 0x52/255.0},
+            {0xc6/255.0, 0x2d/255.0, 0xa4/255.0, 0x52/255.0}
+         },
+         {
+            {0x48/255.0, 0x16/255.0, 0x2e/255.0, 0x8a/255.0},
+            {0xab/255.0, 0x28/255.0, 0x8a/255.0, 0x5e/255.0},
+            {0xdb/255.0, 0x31/255.0, 0xb7/255.0, 0x49/255.0},
+            {0x66/255.0, 0x1b/255.0, 0x4a/255.0, 0x7d/255.0}
+         }
+      }
+   },
+   {
+      PIPE_FORMAT_BPTC_RGBA_UNORM,
+      {0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff},
+      {0x80, 0xd5, 0x3e, 0x11, 0x1e, 0x62, 0x4a, 0x80, 0x60, 0x4d, 0x43, 0x14, 0xc0, 0xb5, 0x96, 0x87},
+      {
+         {
+            {0xdb/255.0, 0x38/255.0, 0x08/255.0, 0x9a/255.0},
+            {0xdb/255.0, 0x38/255.0, 0x08/255.0, 0x9a/255.0},
+            {0x6d/255.0, 0x28/255.0, 0x5a/255.0, 0x53/255.0},
+            {0x38/255.0, 0x20/255.0, 0x82/255.0, 0x30/255.0}
+         },
+         {
+            {0x85/255.0, 0x2b/255.0, 0x3c/255.0, 0x41/255.0},
+            {0x6d/255.0, 0x28/255.0, 0x5a/255.0, 0x53/255.0},
+            {0xa6/255.0, 0x30/255.0, 0x30/255.0, 0x77/255.0},
+            {0xa6/255.0, 0x30/255.0, 0x30/255.0, 0x77/255.0}
+         },
+         {
+            {0x87/255.0, 0x2d/255.0, 0x1d/255.0, 0x30/255.0},
+            {0x87/255.0, 0x2d/255.0, 0x1d/255.0, 0x30/255.0},
+            {0xa6/255.0, 0x30/255.0, 0x30/255.0, 0x77/255.0},
+            {0x6d/255.0, 0x28/255.0, 0x5a/255.0, 0x53/255.0}
+         },
+         {
+            {0x82/255.0, 0x28/255.0, 0x59/255.0, 0x51/255.0},
+            {0x87/255.0, 0x2d/255.0, 0x1d/255.0, 0x30/255.0},
+            {0x8a/255.0, 0x30/255.0, 0x00/255.0, 0x20/255.0},
+            {0x6d/255.0, 0x28/255.0, 0x5a/255.0, 0x53/255.0}
+         }
+      }
+   },
+   {
+      PIPE_FORMAT_BPTC_RGBA_UNORM,
+      {0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff},
+      {0x00, 0x0f, 0x8f, 0x9e, 0x79, 0xe2, 0xff, 0xc8, 0xfd, 0x78, 0x9c, 0xfd, 0x0a, 0xfb, 0xc0, 0x80},
+      {
+         {
+            {0x00/255.0, 0x00/255.0, 0x00/255.0, 0xff/255.0},
+            {0x00/255.0, 0x00/255.0, 0x00/255.0, 0xff/255.0},
+            {0x00/255.0, 0x00/255.0, 0x00/255.0, 0xff/255.0},
+            {0x00/255.0, 0x00/255.0, 0x00/255.0, 0xff/255.0}
+         },
+         {
+            {0x00/255.0, 0x00/255.0, 0x00/255.0, 0xff/255.0},
+            {0x00/255.0, 0x00/255.0, 0x00/255.0, 0xff/255.0},
+            {0x00/255.0, 0x00/255.0, 0x00/255.0, 0xff/255.0},
+            {0x00/255.0, 0x00/255.0, 0x00/255.0, 0xff/255.0}
+         },
+         {
+            {0x00/255.0, 0x00/255.0, 0x00/255.0, 0xff/255.0},
+            {0x00/255.0, 0x00/255.0, 0x00/255.0, 0xff/255.0},
+            {0x00/255.0, 0x00/255.0, 0x00/255.0, 0xff/255.0},
+            {0x00/255.0, 0x00/255.0, 0x00/255.0, 0xff/255.0}
+         },
+         {
+            {0x00/255.0, 0x00/255.0, 0x00/255.0, 0xff/255.0},
+            {0x00/255.0, 0x00/255.0, 0x00/255.0, 0xff/255.0},
+            {0x00/255.0, 0x00/255.0, 0x00/255.0, 0xff/255.0},
+            {0x00/255.0, 0x00/255.0, 0x00/255.0, 0xff/255.0}
+         }
+      }
+   },
+   {
+      PIPE_FORMAT_BPTC_RGB_UFLOAT,
+      {0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff},
+      {0xd0, 0xa0, 0xb1, 0x4e, 0x83, 0xb7, 0xbe, 0x0b, 0xd5, 0x74, 0x1f, 0xae, 0x36, 0x7b, 0x8a, 0xeb},
+      {
+         {
+            {0.00680541992, 0.0506591797, 0.213134766, 1},
+            {0.00733566284, 0.0535888672, 0.22277832, 1},
+            {0.00975799561, 0.0684204102, 0.265625, 1},
+            {0.00952148438, 0.0465393066, 0.216186523, 1}
+         },
+         {
+            {0.00707244873, 0.0521240234, 0.218017578, 1},
+            {0.00959014893, 0.0518493652, 0.227905273, 1},
+            {0.00959014893, 0.0518493652, 0.227905273, 1},
+            {0.00733566284, 0.0535888672, 0.22277832, 1}
+         },
+         {
+            {0.00680541992, 0.0506591797, 0.213134766, 1},
+            {0.00952148438, 0.0465393066, 0.216186523, 1},
+            {0.00972747803, 0.0631103516, 0.25390625, 1},
+            {0.00624465942, 0.0475769043, 0.20300293, 1}
+         },
+         {
+            {0.00975799561, 0.0684204102, 0.265625, 1},
+            {0.00952148438, 0.0465393066, 0.216186523, 1},
+            {0.00707244873, 0.0521240234, 0.218017578, 1},
+            {0.00571060181, 0.0446472168, 0.193481445, 1}
+         }
+      }
+   },
+   {
+      PIPE_FORMAT_BPTC_RGB_FLOAT,
+      {0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff},
+      {0xcd, 0x2d, 0x95, 0x63, 0x36, 0xb5, 0xcf, 0x8e, 0xfa, 0xd1, 0x9c, 0x64, 0xcf, 0x60, 0xd4, 0xce},
+      {
+         {
+            {-0.63671875, 31.5625, 0.000376462936, 1},
+            {-0.054107666, 44.1875, 4.66015625, 1},
+            {-0.054107666, 44.1875, 4.66015625, 1},
+            {-0.148071289, 0.0627441406, 1003.5, 1}
+         },
+         {
+            {-0.63671875, 31.5625, 0.000376462936, 1},
+            {-99.5, 18.125, -748, 1},
+            {-0.148071289, 0.0627441406, 1003.5, 1},
+            {-1.7265625, -0.000164270401, 269.5, 1}
+         },
+         {
+            {-0.0153198242, 50.75, 506, 1},
+            {-79.125, -285, 34.75, 1},
+            {-0.0441894531, 6.71875, 1960, 1},
+            {-23.453125, -2.87695312, 66.5625, 1}
+         },
+         {
+            {-79.125, -285, 34.75, 1},
+            {-79.125, -285, 34.75, 1},
+            {-0.148071289, 0.0627441406, 1003.5, 1},
+            {-1.7265625, -0.000164270401, 269.5, 1}
+         }
+      }
+   },
+   {
+      PIPE_FORMAT_BPTC_RGB_UFLOAT,
+      {0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff},
+      {0x82, 0xb0, 0x1b, 0xd0, 0x0b, 0x85, 0xfe, 0x73, 0x54, 0xe9, 0xd2, 0x73, 0x2d, 0xb7, 0x4d, 0xad},
+      {
+         {
+            {88.3125, 2.6796875, 0.005443573, 1},
+            {81.3125, 2.67382812, 0.00579071045, 1},
+            {74.75, 2.6484375, 0.005859375, 1},
+            {84.5625, 2.6875, 0.00576019287, 1}
+         },
+         {
+            {88.75, 2.73046875, 0.00561904907, 1},
+            {89, 2.765625, 0.00574111938, 1},
+            {81.3125, 2.67382812, 0.00579071045, 1},
+            {84.5625, 2.6875, 0.00576019287, 1}
+         },
+         {
+            {88.75, 2.73046875, 0.00561904907, 1},
+            {88.75, 2.73046875, 0.00561904907, 1},
+            {88.1875, 2.70117188, 0.0057220459, 1},
+            {88.1875, 2.70117188, 0.0057220459, 1}
+         },
+         {
+            {88.625, 2.71289062, 0.00556182861, 1},
+            {89, 2.765625, 0.00574111938, 1},
+            {89, 2.765625, 0.00574111938, 1},
+            {91.5, 2.71484375, 0.00568771362, 1}
+         }
+      }
+   },
+   {
+      PIPE_FORMAT_BPTC_RGB_FLOAT,
+      {0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff},
+      {0xe6, 0xe5, 0xe1, 0x47, 0x37, 0x94, 0xdc, 0x9d, 0x8a, 0xd9, 0x41, 0xef, 0x66, 0x49, 0x64, 0xcb},
+      {
+         {
+            {864, -0.000113606453, -0.000223398209, 1},
+            {918, -0.000109314919, -0.000234007835, 1},
+            {944, -0.000107228756, -0.000239253044, 1},
+            {903, -0.000110507011, -0.000231146812, 1}
+         },
+         {
+            {910.5, -9.32812691e-05, -0.000247001648, 1},
+            {915, -9.76920128e-05, -0.000240325928, 1},
+            {923.5, -0.0001065135, -0.00022995472, 1},
+            {919, -0.000102102757, -0.000235199928, 1}
+         },
+         {
+            {923.5, -0.0001065135, -0.00022995472, 1},
+            {923.5, -0.0001065135, -0.00022995472, 1},
+            {941.5, -0.000127315521, -0.000208616257, 1},
+            {937, -0.000120222569, -0.000213861465, 1}
+         },
+         {
+            {928.5, -0.000111401081, -0.000224232674, 1},
+            {928.5, -0.000111401081, -0.000224232674, 1},
+            {937, -0.000120222569, -0.000213861465, 1},
+            {928.5, -0.000111401081, -0.000224232674, 1}
+         }
+      }
+   },
+   {
+      PIPE_FORMAT_BPTC_RGB_UFLOAT,
+      {0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff},
+      {0x4a, 0x47, 0x47, 0x3b, 0xb3, 0x0d, 0xb7, 0xaf, 0x02, 0x7b, 0x26, 0xa9, 0x52, 0xa2, 0x47, 0x2b},
+      {
+         {
+            {587.5, 1423, 0.00245475769, 1},
+            {600, 1533, 0.00216674805, 1},
+            {600, 1533, 0.00216674805, 1},
+            {611.5, 1533, 0.00220108032, 1}
+         },
+         {
+            {594, 1405, 0.00244903564, 1},
+            {614.5, 1351, 0.00243759155, 1},
+            {611.5, 1533, 0.00220108032, 1},
+            {600, 1533, 0.00216674805, 1}
+         },
+         {
+            {594, 1405, 0.00244903564, 1},
+            {608, 1369, 0.00244140625, 1},
+            {621, 1334, 0.00243377686, 1},
+            {605.5, 1533, 0.00218200684, 1}
+         },
+         {
+            {608, 1369, 0.00244140625, 1},
+            {621, 1334, 0.00243377686, 1},
+            {594, 1405, 0.00244903564, 1},
+            {587.5, 1423, 0.00245475769, 1}
+         }
+      }
+   },
+   {
+      PIPE_FORMAT_BPTC_RGB_FLOAT,
+      {0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff},
+      {0x2e, 0x10, 0x6c, 0xe0, 0x35, 0xd9, 0x9f, 0x0c, 0xe4, 0x6a, 0x82, 0x35, 0x87, 0x0d, 0xe7, 0x8f},
+      {
+         {
+            {1.68164062, 2492, 18400, 1},
+            {0.496582031, 6840, 18400, 1},
+            {0.569335938, 2852, 12784, 1},
+            {0.543945312, 3724, 14320, 1}
+         },
+         {
+            {1.98730469, 2282, 14456, 1},
+            {2.61132812, 2064, 11424, 1},
+            {0.518554688, 5096, 15856, 1},
+            {0.598144531, 1965, 11080, 1}
+         },
+         {
+            {2.40625, 2134, 12400, 1},
+            {1.78320312, 2422, 16432, 1},
+            {2.203125, 2204, 13376, 1},
+            {0.569335938, 2852, 12784, 1}
+         },
+         {
+            {2.61132812, 2064, 11424, 1},
+            {2.81640625, 2022, 10448, 1},
+            {1.98730469, 2282, 14456, 1},
+            {2.203125, 2204, 13376, 1}
+         }
+      }
+   },
+   {
+      PIPE_FORMAT_BPTC_RGB_UFLOAT,
+      {0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff},
+      {0x52, 0x3b, 0x2e, 0x28, 0x33, 0xa5, 0x62, 0xd8, 0x17, 0x01, 0x12, 0xe6, 0x5d, 0x95, 0xf1, 0x7a},
+      {
+         {
+            {2988, 0.0750732422, 7.9296875, 1},
+            {2080, 0.0633544922, 6.83984375, 1},
+            {839, 0.044708252, 3.72460938, 1},
+            {2080, 0.0633544922, 6.83984375, 1}
+         },
+         {
+            {3484, 0.0536499023, 19.09375, 1},
+            {612, 0.038848877, 3.1796875, 1},
+            {1157, 0.0512084961, 4.66015625, 1},
+            {612, 0.038848877, 3.1796875, 1}
+         },
+         {
+            {6080, 0.0773925781, 24.65625, 1},
+            {6708, 0.0838012695, 25.75, 1},
+            {5452, 0.0710449219, 23.5625, 1},
+            {839, 0.044708252, 3.72460938, 1}
+         },
+         {
+            {3484, 0.0536499023, 19.09375, 1},
+            {6080, 0.0773925781, 24.65625, 1},
+            {3484, 0.0536499023, 19.09375, 1},
+            {6708, 0.0838012695, 25.75, 1}
+         }
+      }
+   },
+   {
+      PIPE_FORMAT_BPTC_RGB_FLOAT,
+      {0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff},
+      {0xb6, 0x84, 0x2d, 0xc7, 0xe6, 0xdc, 0x8f, 0xf5, 0x42, 0x5b, 0x57, 0xcf, 0xea, 0x04, 0xd5, 0x31},
+      {
+         {
+            {0.0151977539, 139.75, 753.5, 1},
+            {0.00550460815, 14.453125, 627.5, 1},
+            {0.012298584, 1301, 1208, 1},
+            {0.00869750977, 107.25, 3608, 1}
+         },
+         {
+            {0.0118865967, 120.3125, 1677, 1},
+            {0.00550460815, 14.453125, 627.5, 1},
+            {0.012298584, 1301, 1208, 1},
+            {0.00869750977, 107.25, 3608, 1}
+         },
+         {
+            {0.0118865967, 120.3125, 1677, 1},
+            {0.020690918, 23360, 1836, 1},
+            {0.00696563721, 60.3125, 784.5, 1},
+            {0.0141372681, 131, 945.5, 1}
+         },
+         {
+            {0.0108261108, 115.9375, 2072, 1},
+            {0.00937652588, 305.25, 959, 1},
+            {0.00696563721, 60.3125, 784.5, 1},
+            {0.0151977539, 139.75, 753.5, 1}
+         }
+      }
+   },
+   {
+      PIPE_FORMAT_BPTC_RGB_UFLOAT,
+      {0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff},
+      {0xda, 0x66, 0xc7, 0x2f, 0x43, 0xa7, 0x76, 0x06, 0xcb, 0x53, 0x8f, 0xc3, 0x06, 0xe7, 0xc2, 0xb5},
+      {
+         {
+            {0.00393676758, 3.38671875, 15.6640625, 1},
+            {0.00470733643, 1.68164062, 5.5078125, 1},
+            {0.00510406494, 2.48632812, 3.83398438, 1},
+            {0.00338935852, 4.2734375, 12.3984375, 1}
+         },
+         {
+            {0.00452804565, 2.97070312, 18.96875, 1},
+            {0.00538635254, 3.27734375, 3.18554688, 1},
+            {0.00483703613, 1.86816406, 4.89453125, 1},
+            {0.00312423706, 5.0234375, 10.765625, 1}
+         },
+         {
+            {0.00612640381, 1.92382812, 28.78125, 1},
+            {0.00525283813, 2.90234375, 3.4921875, 1},
+            {0.00510406494, 2.48632812, 3.83398438, 1},
+            {0.00338935852, 4.2734375, 12.3984375, 1}
+         },
+         {
+            {0.00452804565, 2.97070312, 18.96875, 1},
+            {0.00510406494, 2.48632812, 3.83398438, 1},
+            {0.00538635254, 3.27734375, 3.18554688, 1},
+            {0.00506210327, 2.59570312, 22.234375, 1}
+         }
+      }
+   },
+   {
+      PIPE_FORMAT_BPTC_RGB_FLOAT,
+      {0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff},
+      {0xde, 0x1b, 0x1c, 0x94, 0x03, 0xf3, 0x25, 0x6e, 0xda, 0x84, 0xb9, 0x55, 0x47, 0x87, 0xa7, 0xca},
+      {
+         {
+            {0.189697266, -0.0527038574, 1.07617188, 1},
+            {0.000489711761, -0.119506836, 6.11328125, 1},
+            {0.000489711761, -0.119506836, 6.11328125, 1},
+            {7.94529915e-05, -0.00217819214, -1.40917969, 1}
+         },
+         {
+            {0.189697266, -0.0527038574, 1.07617188, 1},
+            {0.0187988281, -0.138671875, -226, 1},
+            {-15.125, 0.0187988281, 0.000339508057, 1},
+            {7.94529915e-05, -0.00217819214, -1.40917969, 1}
+         },
+         {
+            {-0.00405502319, 1.29342079e-05, -0.0064201355, 1},
+            {-15.125, 0.0187988281, 0.000339508057, 1},
+            {0.0187988281, -0.138671875, -226, 1},
+            {-0.969726562, 0.00235557556, -1.75237656e-05, 1}
+         },
+         {
+            {7.94529915e-05, -0.00217819214, -1.40917969, 1},
+            {-0.0621643066, 0.000295162201, -0.0004799366, 1},
+            {-0.969726562, 0.00235557556, -1.75237656e-05, 1},
+            {-0.00405502319, 1.29342079e-05, -0.0064201355, 1}
+         }
+      }
+   },
+   {
+      PIPE_FORMAT_BPTC_RGB_UFLOAT,
+      {0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff},
+      {0xc3, 0x9f, 0x0b, 0xe7, 0x9b, 0x6a, 0x6b, 0x50, 0x56, 0x49, 0x94, 0xd8, 0x04, 0xf0, 0x33, 0xf2},
+      {
+         {
+            {0.00958251953, 9.625, 0.259033203, 1},
+            {0.0121002197, 22.875, 0.109619141, 1},
+            {0.0192565918, 132.5, 0.0160522461, 1},
+            {0.0108413696, 14.53125, 0.174438477, 1}
+         },
+         {
+            {0.0108413696, 14.53125, 0.174438477, 1},
+            {0.0192565918, 132.5, 0.0160522461, 1},
+            {0.0167388916, 91, 0.0260772705, 1},
+            {0.0299224854, 840, 0.00254249573, 1}
+         },
+         {
+            {0.0108413696, 14.53125, 0.174438477, 1},
+            {0.00665664673, 2.421875, 1.12109375, 1},
+            {0.00665664673, 2.421875, 1.12109375, 1},
+            {0.0399169922, 2088, 0.000907421112, 1}
+         },
+         {
+            {0.00958251953, 9.625, 0.259033203, 1},
+            {0.00958251953, 9.625, 0.259033203, 1},
+            {0.00833129883, 6.359375, 0.419433594, 1},
+            {0.0399169922, 2088, 0.000907421112, 1}
+         }
+      }
+   },
+   {
+      PIPE_FORMAT_BPTC_RGB_FLOAT,
+      {0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff},
+      {0xa7, 0xac, 0x32, 0xde, 0x44, 0x77, 0xd8, 0x8f, 0xe6, 0xbe, 0x9f, 0x5e, 0x56, 0xec, 0xd4, 0x71},
+      {
+         {
+            {-14.2421875, -3600, 5.96875, 1},
+            {-0.405761719, -182.125, 0.186157227, 1},
+            {-0.405761719, -182.125, 0.186157227, 1},
+            {-1.04882812, -415, 0.468261719, 1}
+         },
+         {
+            {-0.295898438, -134.875, 0.13293457, 1},
+            {-2.07421875, -743.5, 0.915527344, 1},
+            {-0.405761719, -182.125, 0.186157227, 1},
+            {-7.609375, -2088, 3.28125, 1}
+         },
+         {
+            {-5.4140625, -1596, 2.21484375, 1},
+            {-7.609375, -2088, 3.28125, 1},
+            {-0.805175781, -320.5, 0.361816406, 1},
+            {-0.405761719, -182.125, 0.186157227, 1}
+         },
+         {
+            {-10.734375, -2844, 4.265625, 1},
+            {-0.585449219, -241.125, 0.255371094, 1},
+            {-28.296875, -6504, 11.59375, 1},
+            {-3.83007812, -1218, 1.68164062, 1}
+         }
+      }
+   },
+   {
+      PIPE_FORMAT_BPTC_RGB_UFLOAT,
+      {0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff},
+      {0xcb, 0xbe, 0xf1, 0xe9, 0xf3, 0x46, 0xba, 0xcf, 0xf0, 0xbc, 0x1a, 0xbc, 0x11, 0x08, 0xbb, 0x4a},
+      {
+         {
+            {0.000440120697, 264.75, 20.59375, 1},
+            {0.000377178192, 215.75, 12.4296875, 1},
+            {0.000390052795, 224.875, 13.6171875, 1},
+            {0.000394105911, 227.625, 13.984375, 1}
+         },
+         {
+            {0.000397920609, 230.375, 14.3515625, 1},
+            {0.000436067581, 259, 19.859375, 1},
+            {0.000390052795, 224.875, 13.6171875, 1},
+            {0.000394105911, 227.625, 13.984375, 1}
+         },
+         {
+            {0.000436067581, 259, 19.859375, 1},
+            {0.000436067581, 259, 19.859375, 1},
+            {0.000406742096, 236.625, 15.1796875, 1},
+            {0.000440120697, 264.75, 20.59375, 1}
+         },
+         {
+            {0.000394105911, 227.625, 13.984375, 1},
+            {0.000394105911, 227.625, 13.984375, 1},
+            {0.000397920609, 230.375, 14.3515625, 1},
+            {0.000423431396, 248.5, 17.484375, 1}
+         }
+      }
+   },
+   {
+      PIPE_FORMAT_BPTC_RGB_FLOAT,
+      {0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff},
+      {0x8f, 0x10, 0x67, 0x3e, 0x61, 0xc1, 0x21, 0x72, 0x9c, 0xdf, 0x02, 0x83, 0xce, 0x8d, 0xd5, 0x40},
+      {
+         {
+            {1.62207031, 0.000138044357, 5228, 1},
+            {1.62207031, 0.000138044357, 5228, 1},
+            {1.62109375, 0.000137925148, 5236, 1},
+            {1.62109375, 0.000137925148, 5232, 1}
+         },
+         {
+            {1.62304688, 0.000138163567, 5228, 1},
+            {1.62402344, 0.000138163567, 5224, 1},
+            {1.62304688, 0.000138163567, 5228, 1},
+            {1.62207031, 0.000138044357, 5228, 1}
+         },
+         {
+            {1.62109375, 0.000137925148, 5236, 1},
+            {1.62109375, 0.000137925148, 5232, 1},
+            {1.62109375, 0.000137925148, 5232, 1},
+            {1.62207031, 0.000138044357, 5228, 1}
+         },
+         {
+            {1.62304688, 0.000138044357, 5228, 1},
+            {1.62109375, 0.000137925148, 5232, 1},
+            {1.62402344, 0.000138163567, 5224, 1},
+            {1.62304688, 0.000138044357, 5228, 1}
+         }
+      }
+   },
+   {
+      PIPE_FORMAT_BPTC_RGB_UFLOAT,
+      {0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff},
+      {0xf3, 0x9c, 0x72, 0xcd, 0x03, 0x93, 0xdb, 0x9a, 0xd1, 0x82, 0x18, 0x08, 0xe4, 0x87, 0xd2, 0xd5},
+      {
+         {
+            {0, 0, 0, 1},
+            {0, 0, 0, 1},
+            {0, 0, 0, 1},
+            {0, 0, 0, 1}
+         },
+         {
+            {0, 0, 0, 1},
+            {0, 0, 0, 1},
+            {0, 0, 0, 1},
+            {0, 0, 0, 1}
+         },
+         {
+            {0, 0, 0, 1},
+            {0, 0, 0, 1},
+            {0, 0, 0, 1},
+            {0, 0, 0, 1}
+         },
+         {
+            {0, 0, 0, 1},
+            {0, 0, 0, 1},
+            {0, 0, 0, 1},
+            {0, 0, 0, 1}
+         }
+      }
+   },
+   {
+      PIPE_FORMAT_ETC1_RGB8,
+      PACKED_8x8(0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff),
+      PACKED_8x8(0xa5, 0x1d, 0xb1, 0x4b, 0x11, 0x28, 0x77, 0x2d),
+      {
+         {
+            {0xc2/255.0, 0x35/255.0, 0xd2/255.0, 0xff/255.0},
+            {0xae/255.0, 0x21/255.0, 0xbe/255.0, 0xff/255.0},
+            {0x88/255.0, 0x00/255.0, 0x98/255.0, 0xff/255.0},
+            {0x88/255.0, 0x00/255.0, 0x98/255.0, 0xff/255.0}
+         },
+         {
+            {0xae/255.0, 0x21/255.0, 0xbe/255.0, 0xff/255.0},
+            {0x88/255.0, 0x00/255.0, 0x98/255.0, 0xff/255.0},
+            {0xc2/255.0, 0x35/255.0, 0xd2/255.0, 0xff/255.0},
+            {0xc2/255.0, 0x35/255.0, 0xd2/255.0, 0xff/255.0}
+         },
+         {
+            {0xa9/255.0, 0x1d/255.0, 0xda/255.0, 0xff/255.0},
+            {0x95/255.0, 0x09/255.0, 0xc6/255.0, 0xff/255.0},
+            {0xa9/255.0, 0x1d/255.0, 0xda/255.0, 0xff/255.0},
+            {0xa9/255.0, 0x1d/255.0, 0xda/255.0, 0xff/255.0}
+         },
+         {
+            {0x6f/255.0, 0x00/255.0, 0xa0/255.0, 0xff/255.0},
+            {0x95/255.0, 0x09/255.0, 0xc6/255.0, 0xff/255.0},
+            {0x95/255.0, 0x09/255.0, 0xc6/255.0, 0xff/255.0},
+            {0x95/255.0, 0x09/255.0, 0xc6/255.0, 0xff/255.0}
+         }
+      }
+   },
+   {
+      PIPE_FORMAT_ETC2_RGB8,
+      PACKED_8x8(0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff),
+      PACKED_8x8(0x35, 0xc1, 0xd9, 0x5c, 0x69, 0xc1, 0x21, 0x4c),
+      {
+         {
+            {0x2a/255.0, 0xc3/255.0, 0xd4/255.0, 0xff/255.0},
+            {0x3c/255.0, 0xd5/255.0, 0xe6/255.0, 0xff/255.0},
+            {0x00/255.0, 0x00/255.0, 0x00/255.0, 0xff/255.0},
+            {0x84/255.0, 0x40/255.0, 0xc8/255.0, 0xff/255.0}
+         },
+         {
+            {0x3c/255.0, 0xd5/255.0, 0xe6/255.0, 0xff/255.0},
+            {0x3c/255.0, 0xd5/255.0, 0xe6/255.0, 0xff/255.0},
+            {0x84/255.0, 0x40/255.0, 0xc8/255.0, 0xff/255.0},
+            {0x00/255.0, 0x00/255.0, 0x00/255.0, 0xff/255.0}
+         },
+         {
+            {0x50/255.0, 0xe9/255.0, 0xfa/255.0, 0xff/255.0},
+            {0x16/255.0, 0xaf/255.0, 0xc0/255.0, 0xff/255.0},
+            {0x84/255.0, 0x40/255.0, 0xc8/255.0, 0xff/255.0},
+            {0x26/255.0, 0x00/255.0, 0x6a/255.0, 0xff/255.0}
+         },
+         {
+            {0x50/255.0, 0xe9/255.0, 0xfa/255.0, 0xff/255.0},
+            {0x2a/255.0, 0xc3/255.0, 0xd4/255.0, 0xff/255.0},
+            {0x26/255.0, 0x00/255.0, 0x6a/255.0, 0xff/255.0},
+            {0x84/255.0, 0x40/255.0, 0xc8/255.0, 0xff/255.0}
+         }
+      }
+   },
+   {
+      PIPE_FORMAT_ETC2_RGB8,
+      PACKED_8x8(0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff),
+      PACKED_8x8(0x4c, 0x0f, 0x85, 0x2b, 0x83, 0xaa, 0x44, 0xcb),
+      {
+         {
+            {0x5b/255.0, 0x19/255.0, 0x95/255.0, 0xff/255.0},
+            {0x4f/255.0, 0x0d/255.0, 0x89/255.0, 0xff/255.0},
+            {0x45/255.0, 0x03/255.0, 0x7f/255.0, 0xff/255.0},
+            {0x4f/255.0, 0x0d/255.0, 0x89/255.0, 0xff/255.0}
+         },
+         {
+            {0x39/255.0, 0x00/255.0, 0x73/255.0, 0xff/255.0},
+            {0x45/255.0, 0x03/255.0, 0x7f/255.0, 0xff/255.0},
+            {0x45/255.0, 0x03/255.0, 0x7f/255.0, 0xff/255.0},
+            {0x4f/255.0, 0x0d/255.0, 0x89/255.0, 0xff/255.0}
+         },
+         {
+            {0x32/255.0, 0x09/255.0, 0x74/255.0, 0xff/255.0},
+            {0x46/255.0, 0x1d/255.0, 0x88/255.0, 0xff/255.0},
+            {0x46/255.0, 0x1d/255.0, 0x88/255.0, 0xff/255.0},
+            {0x46/255.0, 0x1d/255.0, 0x88/255.0, 0xff/255.0}
+         },
+         {
+            {0x0c/255.0, 0x00/255.0, 0x4e/255.0, 0xff/255.0},
+            {0x0c/255.0, 0x00/255.0, 0x4e/255.0, 0xff/255.0},
+            {0x32/255.0, 0x09/255.0, 0x74/255.0, 0xff/255.0},
+            {0x20/255.0, 0x00/255.0, 0x62/255.0, 0xff/255.0}
+         }
+      }
+   },
+   {
+      PIPE_FORMAT_ETC2_RGB8,
+      PACKED_8x8(0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff),
+      PACKED_8x8(0x05, 0xda, 0x04, 0x5f, 0xc2, 0x18, 0x17, 0xca),
+      {
+         {
+            {0x11/255.0, 0xdd/255.0, 0xaa/255.0, 0xff/255.0},
+            {0x00/255.0, 0x44/255.0, 0x55/255.0, 0xff/255.0},
+            {0x40/255.0, 0x84/255.0, 0x95/255.0, 0xff/255.0},
+            {0x40/255.0, 0x84/255.0, 0x95/255.0, 0xff/255.0}
+         },
+         {
+            {0x40/255.0, 0x84/255.0, 0x95/255.0, 0xff/255.0},
+            {0x11/255.0, 0xdd/255.0, 0xaa/255.0, 0xff/255.0},
+            {0x00/255.0, 0x04/255.0, 0x15/255.0, 0xff/255.0},
+            {0x11/255.0, 0xdd/255.0, 0xaa/255.0, 0xff/255.0}
+         },
+         {
+            {0x11/255.0, 0xdd/255.0, 0xaa/255.0, 0xff/255.0},
+            {0x40/255.0, 0x84/255.0, 0x95/255.0, 0xff/255.0},
+            {0x40/255.0, 0x84/255.0, 0x95/255.0, 0xff/255.0},
+            {0x00/255.0, 0x44/255.0, 0x55/255.0, 0xff/255.0}
+         },
+         {
+            {0x00/255.0, 0x04/255.0, 0x15/255.0, 0xff/255.0},
+            {0x40/255.0, 0x84/255.0, 0x95/255.0, 0xff/255.0},
+            {0x11/255.0, 0xdd/255.0, 0xaa/255.0, 0xff/255.0},
+            {0x00/255.0, 0x44/255.0, 0x55/255.0, 0xff/255.0}
+         }
+      }
+   },
+   {
+      PIPE_FORMAT_ETC2_RGB8,
+      PACKED_8x8(0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff),
+      PACKED_8x8(0x18, 0x06, 0x96, 0x53, 0xac, 0x2c, 0x86, 0x0a),
+      {
+         {
+            {0x43/255.0, 0x10/255.0, 0x65/255.0, 0xff/255.0},
+            {0x43/255.0, 0x10/255.0, 0x65/255.0, 0xff/255.0},
+            {0x43/255.0, 0x10/255.0, 0x65/255.0, 0xff/255.0},
+            {0x43/255.0, 0x10/255.0, 0x65/255.0, 0xff/255.0}
+         },
+         {
+            {0x23/255.0, 0x00/255.0, 0x45/255.0, 0xff/255.0},
+            {0x32/255.0, 0xdc/255.0, 0xba/255.0, 0xff/255.0},
+            {0x23/255.0, 0x00/255.0, 0x45/255.0, 0xff/255.0},
+            {0x32/255.0, 0xdc/255.0, 0xba/255.0, 0xff/255.0}
+         },
+         {
+            {0x32/255.0, 0xdc/255.0, 0xba/255.0, 0xff/255.0},
+            {0x43/255.0, 0x10/255.0, 0x65/255.0, 0xff/255.0},
+            {0x12/255.0, 0xbc/255.0, 0x9a/255.0, 0xff/255.0},
+            {0x43/255.0, 0x10/255.0, 0x65/255.0, 0xff/255.0}
+         },
+         {
+            {0x12/255.0, 0xbc/255.0, 0x9a/255.0, 0xff/255.0},
+            {0x43/255.0, 0x10/255.0, 0x65/255.0, 0xff/255.0},
+            {0x32/255.0, 0xdc/255.0, 0xba/255.0, 0xff/255.0},
+            {0x12/255.0, 0xbc/255.0, 0x9a/255.0, 0xff/255.0}
+         }
+      }
+   },
+   {
+      PIPE_FORMAT_ETC2_RGB8,
+      PACKED_8x8(0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff),
+      PACKED_8x8(0x31, 0x70, 0xf2, 0x66, 0x5a, 0x1e, 0x18, 0xe5),
+      {
+         {
+            {0x61/255.0, 0xf1/255.0, 0x51/255.0, 0xff/255.0},
+            {0x7c/255.0, 0xcb/255.0, 0x40/255.0, 0xff/255.0},
+            {0x96/255.0, 0xa6/255.0, 0x2f/255.0, 0xff/255.0},
+            {0xb1/255.0, 0x80/255.0, 0x1d/255.0, 0xff/255.0}
+         },
+         {
+            {0x7a/255.0, 0xe7/255.0, 0x62/255.0, 0xff/255.0},
+            {0x94/255.0, 0xc1/255.0, 0x51/255.0, 0xff/255.0},
+            {0xaf/255.0, 0x9b/255.0, 0x40/255.0, 0xff/255.0},
+            {0xc9/255.0, 0x75/255.0, 0x2f/255.0, 0xff/255.0}
+         },
+         {
+            {0x92/255.0, 0xdc/255.0, 0x74/255.0, 0xff/255.0},
+            {0xad/255.0, 0xb6/255.0, 0x62/255.0, 0xff/255.0},
+            {0xc7/255.0, 0x91/255.0, 0x51/255.0, 0xff/255.0},
+            {0xe2/255.0, 0x6b/255.0, 0x40/255.0, 0xff/255.0}
+         },
+         {
+            {0xab/255.0, 0xd2/255.0, 0x85/255.0, 0xff/255.0},
+            {0xc5/255.0, 0xac/255.0, 0x74/255.0, 0xff/255.0},
+            {0xe0/255.0, 0x86/255.0, 0x62/255.0, 0xff/255.0},
+            {0xfa/255.0, 0x60/255.0, 0x51/255.0, 0xff/255.0}
+         }
+      }
+   },
+   {
+      PIPE_FORMAT_ETC2_RGB8A1,
+      PACKED_8x8(0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff),
+      PACKED_8x8(0x9d, 0x38, 0x52, 0x51, 0xd2, 0xba, 0x06, 0xb2),
+      {
+         {
+            {0x9c/255.0, 0x39/255.0, 0x52/255.0, 0xff/255.0},
+            {0x7f/255.0, 0x1c/255.0, 0x35/255.0, 0xff/255.0},
+            {0x9c/255.0, 0x39/255.0, 0x52/255.0, 0xff/255.0},
+            {0x00/255.0, 0x00/255.0, 0x00/255.0, 0x00/255.0}
+         },
+         {
+            {0x7f/255.0, 0x1c/255.0, 0x35/255.0, 0xff/255.0},
+            {0x7f/255.0, 0x1c/255.0, 0x35/255.0, 0xff/255.0},
+            {0x7f/255.0, 0x1c/255.0, 0x35/255.0, 0xff/255.0},
+            {0x9c/255.0, 0x39/255.0, 0x52/255.0, 0xff/255.0}
+         },
+         {
+            {0x84/255.0, 0x39/255.0, 0x63/255.0, 0xff/255.0},
+            {0x84/255.0, 0x39/255.0, 0x63/255.0, 0xff/255.0},
+            {0xc0/255.0, 0x75/255.0, 0x9f/255.0, 0xff/255.0},
+            {0x00/255.0, 0x00/255.0, 0x00/255.0, 0x00/255.0}
+         },
+         {
+            {0x00/255.0, 0x00/255.0, 0x00/255.0, 0x00/255.0},
+            {0x48/255.0, 0x00/255.0, 0x27/255.0, 0xff/255.0},
+            {0x84/255.0, 0x39/255.0, 0x63/255.0, 0xff/255.0},
+            {0x00/255.0, 0x00/255.0, 0x00/255.0, 0x00/255.0}
+         }
+      }
+   },
+   {
+      PIPE_FORMAT_ETC2_RGB8A1,
+      PACKED_8x8(0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff),
+      PACKED_8x8(0x0d, 0x26, 0x72, 0x5c, 0xb5, 0xce, 0xfd, 0xec),
+      {
+         {
+            {0x55/255.0, 0x22/255.0, 0x66/255.0, 0xff/255.0},
+            {0x55/255.0, 0x22/255.0, 0x66/255.0, 0xff/255.0},
+            {0x4e/255.0, 0x00/255.0, 0x2c/255.0, 0xff/255.0},
+            {0x4e/255.0, 0x00/255.0, 0x2c/255.0, 0xff/255.0}
+         },
+         {
+            {0x00/255.0, 0x00/255.0, 0x00/255.0, 0x00/255.0},
+            {0xa0/255.0, 0x4b/255.0, 0x7e/255.0, 0xff/255.0},
+            {0x55/255.0, 0x22/255.0, 0x66/255.0, 0xff/255.0},
+            {0x4e/255.0, 0x00/255.0, 0x2c/255.0, 0xff/255.0}
+         },
+         {
+            {0x4e/255.0, 0x00/255.0, 0x2c/255.0, 0xff/255.0},
+            {0x4e/255.0, 0x00/255.0, 0x2c/255.0, 0xff/255.0},
+            {0x4e/255.0, 0x00/255.0, 0x2c/255.0, 0xff/255.0},
+            {0xa0/255.0, 0x4b/255.0, 0x7e/255.0, 0xff/255.0}
+         },
+         {
+            {0x4e/255.0, 0x00/255.0, 0x2c/255.0, 0xff/255.0},
+            {0x4e/255.0, 0x00/255.0, 0x2c/255.0, 0xff/255.0},
+            {0xa0/255.0, 0x4b/255.0, 0x7e/255.0, 0xff/255.0},
+            {0x4e/255.0, 0x00/255.0, 0x2c/255.0, 0xff/255.0}
+         }
+      }
+   },
+   {
+      PIPE_FORMAT_ETC2_RGB8A1,
+      PACKED_8x8(0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff),
+      PACKED_8x8(0xac, 0x0d, 0x42, 0x5a, 0xae, 0xde, 0x55, 0xf8),
+      {
+         {
+            {0x58/255.0, 0x8b/255.0, 0xad/255.0, 0xff/255.0},
+            {0x85/255.0, 0x41/255.0, 0xb8/255.0, 0xff/255.0},
+            {0x52/255.0, 0x85/255.0, 0xa7/255.0, 0xff/255.0},
+            {0x52/255.0, 0x85/255.0, 0xa7/255.0, 0xff/255.0}
+         },
+         {
+            {0x8b/255.0, 0x47/255.0, 0xbe/255.0, 0xff/255.0},
+            {0x52/255.0, 0x85/255.0, 0xa7/255.0, 0xff/255.0},
+            {0x8b/255.0, 0x47/255.0, 0xbe/255.0, 0xff/255.0},
+            {0x8b/255.0, 0x47/255.0, 0xbe/255.0, 0xff/255.0}
+         },
+         {
+            {0x8b/255.0, 0x47/255.0, 0xbe/255.0, 0xff/255.0},
+            {0x85/255.0, 0x41/255.0, 0xb8/255.0, 0xff/255.0},
+            {0x85/255.0, 0x41/255.0, 0xb8/255.0, 0xff/255.0},
+            {0x52/255.0, 0x85/255.0, 0xa7/255.0, 0xff/255.0}
+         },
+         {
+            {0x85/255.0, 0x41/255.0, 0xb8/255.0, 0xff/255.0},
+            {0x85/255.0, 0x41/255.0, 0xb8/255.0, 0xff/255.0},
+            {0x8b/255.0, 0x47/255.0, 0xbe/255.0, 0xff/255.0},
+            {0x8b/255.0, 0x47/255.0, 0xbe/255.0, 0xff/255.0}
+         }
+      }
+   },
+   {
+      PIPE_FORMAT_ETC2_RGB8A1,
+      PACKED_8x8(0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff),
+      PACKED_8x8(0x5e, 0x36, 0x0c, 0xde, 0x38, 0x98, 0xe4, 0x25),
+      {
+         {
+            {0xbe/255.0, 0x36/255.0, 0x24/255.0, 0xff/255.0},
+            {0xbd/255.0, 0x37/255.0, 0x2e/255.0, 0xff/255.0},
+            {0xbc/255.0, 0x37/255.0, 0x39/255.0, 0xff/255.0},
+            {0xbb/255.0, 0x38/255.0, 0x43/255.0, 0xff/255.0}
+         },
+         {
+            {0x96/255.0, 0x31/255.0, 0x41/255.0, 0xff/255.0},
+            {0x95/255.0, 0x31/255.0, 0x4b/255.0, 0xff/255.0},
+            {0x94/255.0, 0x32/255.0, 0x55/255.0, 0xff/255.0},
+            {0x93/255.0, 0x32/255.0, 0x5f/255.0, 0xff/255.0}
+         },
+         {
+            {0x6d/255.0, 0x2b/255.0, 0x5d/255.0, 0xff/255.0},
+            {0x6c/255.0, 0x2c/255.0, 0x67/255.0, 0xff/255.0},
+            {0x6b/255.0, 0x2c/255.0, 0x72/255.0, 0xff/255.0},
+            {0x6a/255.0, 0x2d/255.0, 0x7c/255.0, 0xff/255.0}
+         },
+         {
+            {0x45/255.0, 0x26/255.0, 0x7a/255.0, 0xff/255.0},
+            {0x44/255.0, 0x26/255.0, 0x84/255.0, 0xff/255.0},
+            {0x43/255.0, 0x27/255.0, 0x8e/255.0, 0xff/255.0},
+            {0x42/255.0, 0x27/255.0, 0x98/255.0, 0xff/255.0}
+         }
+      }
+   },
+   {
+      PIPE_FORMAT_ETC2_RGBA8,
+      {0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff},
+      {0x68, 0xd6, 0x2a, 0x52, 0xfb, 0x6e, 0xfb, 0x1d, 0x86, 0x2a, 0xa0, 0x36, 0xdf, 0x2d, 0xaf, 0x35},
+      {
+         {
+            {0x73/255.0, 0x18/255.0, 0x94/255.0, 0x0d/255.0},
+            {0x95/255.0, 0x3a/255.0, 0xb6/255.0, 0x0d/255.0},
+            {0x23/255.0, 0x00/255.0, 0x55/255.0, 0x00/255.0},
+            {0x5b/255.0, 0x21/255.0, 0x8d/255.0, 0xb6/255.0}
+         },
+         {
+            {0x89/255.0, 0x2e/255.0, 0xaa/255.0, 0x00/255.0},
+            {0x73/255.0, 0x18/255.0, 0x94/255.0, 0x00/255.0},
+            {0x23/255.0, 0x00/255.0, 0x55/255.0, 0x00/255.0},
+            {0xc3/255.0, 0x89/255.0, 0xf5/255.0, 0x8f/255.0}
+         },
+         {
+            {0x73/255.0, 0x18/255.0, 0x94/255.0, 0x8f/255.0},
+            {0x89/255.0, 0x2e/255.0, 0xaa/255.0, 0xea/255.0},
+            {0x23/255.0, 0x00/255.0, 0x55/255.0, 0xb6/255.0},
+            {0x5b/255.0, 0x21/255.0, 0x8d/255.0, 0x00/255.0}
+         },
+         {
+            {0x7f/255.0, 0x24/255.0, 0xa0/255.0, 0xb6/255.0},
+            {0x89/255.0, 0x2e/255.0, 0xaa/255.0, 0x00/255.0},
+            {0x23/255.0, 0x00/255.0, 0x55/255.0, 0xea/255.0},
+            {0x23/255.0, 0x00/255.0, 0x55/255.0, 0xb6/255.0}
+         }
+      }
+   },
+   {
+      PIPE_FORMAT_ETC2_R11_UNORM,
+      PACKED_8x8(0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff),
+      PACKED_8x8(0x9e, 0xbf, 0xe1, 0x44, 0x56, 0xd8, 0xb2, 0x8e),
+      {
+         {
+            {0xf69e/65535.0, 0, 0, 1},
+            {0x518a/65535.0, 0, 0, 1},
+            {0xe09c/65535.0, 0, 0, 1},
+            {0x678c/65535.0, 0, 0, 1}
+         },
+         {
+            {0x7d8f/65535.0, 0, 0, 1},
+            {0x678c/65535.0, 0, 0, 1},
+            {0xe09c/65535.0, 0, 0, 1},
+            {0x518a/65535.0, 0, 0, 1}
+         },
+         {
+            {0x518a/65535.0, 0, 0, 1},
+            {0x518a/65535.0, 0, 0, 1},
+            {0x678c/65535.0, 0, 0, 1},
+            {0x678c/65535.0, 0, 0, 1}
+         },
+         {
+            {0xb496/65535.0, 0, 0, 1},
+            {0xe09c/65535.0, 0, 0, 1},
+            {0x3b87/65535.0, 0, 0, 1},
+            {0xe09c/65535.0, 0, 0, 1}
+         }
+      }
+   },
+   {
+      PIPE_FORMAT_ETC2_R11_UNORM,
+      PACKED_8x8(0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff),
+      PACKED_8x8(0xc5, 0x0c, 0xd7, 0x30, 0x03, 0xbb, 0x6e, 0xac),
+      {
+         {
+            {0xc658/65535.0, 0, 0, 1},
+            {0xc538/65535.0, 0, 0, 1},
+            {0xc5f8/65535.0, 0, 0, 1},
+            {0xc6b8/65535.0, 0, 0, 1}
+         },
+         {
+            {0xc5f8/65535.0, 0, 0, 1},
+            {0xc538/65535.0, 0, 0, 1},
+            {0xc658/65535.0, 0, 0, 1},
+            {0xc4b8/65535.0, 0, 0, 1}
+         },
+         {
+            {0xc658/65535.0, 0, 0, 1},
+            {0xc538/65535.0, 0, 0, 1},
+            {0xc658/65535.0, 0, 0, 1},
+            {0xc5f8/65535.0, 0, 0, 1}
+         },
+         {
+            {0xc458/65535.0, 0, 0, 1},
+            {0xc458/65535.0, 0, 0, 1},
+            {0xc658/65535.0, 0, 0, 1},
+            {0xc5d8/65535.0, 0, 0, 1}
+         }
+      }
+   },
+   {
+      PIPE_FORMAT_ETC2_R11_SNORM,
+      PACKED_8x8(0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff),
+      PACKED_8x8(0xc5, 0x8a, 0xca, 0x69, 0x57, 0x24, 0xdc, 0xf9),
+      {
+         {
+            {-0x0300/32767.0, 0, 0, 1},
+            {-0x330c/32767.0, 0, 0, 1},
+            {-0x5b16/32767.0, 0, 0, 1},
+            {-0x0300/32767.0, 0, 0, 1}
+         },
+         {
+            {-0x7b1e/32767.0, 0, 0, 1},
+            {-0x2308/32767.0, 0, 0, 1},
+            {-0x5b16/32767.0, 0, 0, 1},
+            {-1.0, 0, 0, 1}
+         },
+         {
+            {-0x330c/32767.0, 0, 0, 1},
+            {-0x7b1e/32767.0, 0, 0, 1},
+            {-0x5b16/32767.0, 0, 0, 1},
+            {0x0d03/32767.0, 0, 0, 1}
+         },
+         {
+            {-0x0300/32767.0, 0, 0, 1},
+            {0x0d03/32767.0, 0, 0, 1},
+            {-0x2308/32767.0, 0, 0, 1},
+            {-0x5b16/32767.0, 0, 0, 1}
+         }
+      }
+   },
+   {
+      PIPE_FORMAT_ETC2_R11_SNORM,
+      PACKED_8x8(0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff),
+      PACKED_8x8(0x80, 0x02, 0x39, 0x01, 0x6c, 0xdc, 0x6c, 0xb9),
+      {
+         {
+            {-0x7fbf/32767.0, 0, 0, 1},
+            {-0x7f5f/32767.0, 0, 0, 1},
+            {-0x7e3f/32767.0, 0, 0, 1},
+            {-0x7e3f/32767.0, 0, 0, 1}
+         },
+         {
+            {-0x7e3f/32767.0, 0, 0, 1},
+            {-0x7e9f/32767.0, 0, 0, 1},
+            {-0x7d9f/32767.0, 0, 0, 1},
+            {-1.0, 0, 0, 1}
+         },
+         {
+            {-1.0, 0, 0, 1},
+            {-0x7e9f/32767.0, 0, 0, 1},
+            {-0x7f5f/32767.0, 0, 0, 1},
+            {-0x7d9f/32767.0, 0, 0, 1}
+         },
+         {
+            {-0x7f5f/32767.0, 0, 0, 1},
+            {-0x7eff/32767.0, 0, 0, 1},
+            {-0x7e3f/32767.0, 0, 0, 1},
+            {-0x7fbf/32767.0, 0, 0, 1}
+         }
+      }
+   },
+   {
+      PIPE_FORMAT_ETC2_RG11_UNORM,
+      {0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff},
+      {0xab, 0xc1, 0x63, 0xcd, 0x16, 0x6f, 0x4e, 0xef, 0x94, 0x74, 0x14, 0xd8, 0x7e, 0xba, 0x06, 0xbf},
+      {
+         {
+            {0x0f81/65535.0, 0x7f8f/65535.0, 0, 1},
+            {0xffff/65535.0, 0xa294/65535.0, 0, 1},
+            {0x0f81/65535.0, 0xb796/65535.0, 0, 1},
+            {0xffff/65535.0, 0x4088/65535.0, 0, 1}
+         },
+         {
+            {0x8790/65535.0, 0xb796/65535.0, 0, 1},
+            {0xc398/65535.0, 0x6a8d/65535.0, 0, 1},
+            {0x0f81/65535.0, 0xc598/65535.0, 0, 1},
+            {0x0f81/65535.0, 0x5c8b/65535.0, 0, 1}
+         },
+         {
+            {0xffff/65535.0, 0x6a8d/65535.0, 0, 1},
+            {0x3386/65535.0, 0xe19c/65535.0, 0, 1},
+            {0xffff/65535.0, 0xa294/65535.0, 0, 1},
+            {0xf39e/65535.0, 0xe19c/65535.0, 0, 1}
+         },
+         {
+            {0xc398/65535.0, 0xb796/65535.0, 0, 1},
+            {0xffff/65535.0, 0xc598/65535.0, 0, 1},
+            {0xc398/65535.0, 0x7f8f/65535.0, 0, 1},
+            {0xffff/65535.0, 0xe19c/65535.0, 0, 1}
+         }
+      }
+   },
+   {
+      PIPE_FORMAT_ETC2_RG11_SNORM,
+      {0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff},
+      {0x1f, 0xc1, 0x47, 0x5e, 0xef, 0x27, 0x6f, 0x5d, 0x89, 0xfa, 0xe1, 0x80, 0x71, 0xbe, 0xec, 0x8f},
+      {
+         {
+            {-0x5916/32767.0, 0x1004/32767.0, 0, 1},
+            {0x7fff/32767.0, -1.0, 0, 1},
+            {-0x350d/32767.0, -0x4a12/32767.0, 0, 1},
+            {0x7fff/32767.0, -0x0e03/32767.0, 0, 1}
+         },
+         {
+            {-0x350d/32767.0, -1.0, 0, 1},
+            {-0x7d1f/32767.0, -1.0, 0, 1},
+            {-0x350d/32767.0, 0x1004/32767.0, 0, 1},
+            {0x6719/32767.0, -1.0, 0, 1}
+         },
+         {
+            {0x7fff/32767.0, -1.0, 0, 1},
+            {0x6719/32767.0, -0x0e03/32767.0, 0, 1},
+            {0x7fff/32767.0, -0x4a12/32767.0, 0, 1},
+            {-0x7d1f/32767.0, -1.0, 0, 1}
+         },
+         {
+            {0x6719/32767.0, -1.0, 0, 1},
+            {0x7fff/32767.0, -1.0, 0, 1},
+            {0x7fff/32767.0, -0x0e03/32767.0, 0, 1},
+            {0x6719/32767.0, 0x1004/32767.0, 0, 1}
+         }
+      }
+   },
 
 
    /*
@@ -457,6 +457,18 @@ lp_build_occlusion_count(struct gallivm_state *gallivm,
                                        LLVMInt32TypeInContext(context), bits);
       count = LLVMBuildZExt(builder, count, LLVMIntTypeInContext(context, 64), "");
    }
+   else if(util_cpu_caps.has_avx512f && type.length == 16) {
+      /* sign bits to a k register, no shuffling through i8 vectors needed */
+      const char *popcntintr = "llvm.ctpop.i16";
+      LLVMTypeRef i16type = LLVMInt16TypeInContext(context);
+      LLVMValueRef bits = LLVMBuildBitCast(builder, maskvalue,
+                                           lp_build_int_vec_type(gallivm, type), "");
+      bits = LLVMBuildICmp(builder, LLVMIntSLT, bits,
+                           LLVMConstNull(LLVMTypeOf(bits)), "");
+      bits = LLVMBuildBitCast(builder, bits, i16type, "");
+      count = lp_build_intrinsic_unary(builder, popcntintr, i16type, bits);
+      count = LLVMBuildZExt(builder, count, LLVMIntTypeInContext(context, 64), "");
+   }
    else {
       unsigned i;
       LLVMValueRef countv = LLVMBuildAnd(builder, maskvalue, countmask, "countv");
@@ -511,6 +523,17 @@ lp_build_occlusion_count(struct gallivm_state *gallivm,
 }
 
 
+/**
+ * Index of pixel (x, y) of a 4x4 block within a 16-wide vector holding
+ * the four 2x2 quads of the block in the usual quad order.
+ */
+static inline unsigned
+lp_depth_quad_index_4x4(unsigned x, unsigned y)
+{
+   return ((y / 2) * 2 + x / 2) * 4 + (y & 1) * 2 + (x & 1);
+}
+
+
 /**
  * Load depth/stencil values.
  * The stored values are linear, swizzle them.
@@ -546,53 +569,86 @@ lp_build_depth_stencil_load_swizzled(struct gallivm_state *gallivm,
    struct lp_type zs_load_type = zs_type;
 
    zs_load_type.length = zs_load_type.length / 2;
-   load_ptr_type = LLVMPointerType(lp_build_vec_type(gallivm, zs_load_type), 0);
 
-   if (z_src_type.length == 4) {
+   if (z_src_type.length == 16) {
+      /*
+       * The whole 4x4 block in one vector: load the 4 rows separately,
+       * concatenate them and swizzle into quad order.
+       */
+      struct lp_type zs_row_type = zs_type;
+      LLVMValueRef rows[4];
       unsigned i;
-      LLVMValueRef looplsb = LLVMBuildAnd(builder, loop_counter,
-                                          lp_build_const_int32(gallivm, 1), "");
-      LLVMValueRef loopmsb = LLVMBuildAnd(builder, loop_counter,
-                                          lp_build_const_int32(gallivm, 2), "");
-      LLVMValueRef offset2 = LLVMBuildMul(builder, loopmsb,
-                                          depth_stride, "");
-      depth_offset1 = LLVMBuildMul(builder, looplsb,
-                                   lp_build_const_int32(gallivm, depth_bytes * 2), "");
-      depth_offset1 = LLVMBuildAdd(builder, depth_offset1, offset2, "");
 
-      /* just concatenate the loaded 2x2 values into 4-wide vector */
+      assert(!is_1d);
+      zs_row_type.length = 4;
+      load_ptr_type = LLVMPointerType(lp_build_vec_type(gallivm, zs_row_type), 0);
+
       for (i = 0; i < 4; i++) {
-         shuffles[i] = lp_build_const_int32(gallivm, i);
+         LLVMValueRef row_offset = LLVMBuildMul(builder, depth_stride,
+                                                lp_build_const_int32(gallivm, i), "");
+         zs_dst_ptr = LLVMBuildGEP(builder, depth_ptr, &row_offset, 1, "");
+         zs_dst_ptr = LLVMBuildBitCast(builder, zs_dst_ptr, load_ptr_type, "");
+         rows[i] = LLVMBuildLoad(builder, zs_dst_ptr, "");
+      }
+      zs_dst1 = lp_build_concat(gallivm, &rows[0], zs_row_type, 2);
+      zs_dst2 = lp_build_concat(gallivm, &rows[2], zs_row_type, 2);
+
+      for (i = 0; i < 16; i++) {
+         unsigned quad = i / 4;
+         unsigned x = (quad & 1) * 2 + (i & 1);
+         unsigned y = (quad >> 1) * 2 + ((i >> 1) & 1);
+         shuffles[i] = lp_build_const_int32(gallivm, y * 4 + x);
       }
    }
    else {
-      unsigned i;
-      LLVMValueRef loopx2 = LLVMBuildShl(builder, loop_counter,
-                                         lp_build_const_int32(gallivm, 1), "");
-      assert(z_src_type.length == 8);
-      depth_offset1 = LLVMBuildMul(builder, loopx2, depth_stride, "");
-      /*
-       * We load 2x4 values, and need to swizzle them (order
-       * 0,1,4,5,2,3,6,7) - not so hot with avx unfortunately.
-       */
-      for (i = 0; i < 8; i++) {
-         shuffles[i] = lp_build_const_int32(gallivm, (i&1) + (i&2) * 2 + (i&4) / 2);
+      load_ptr_type = LLVMPointerType(lp_build_vec_type(gallivm, zs_load_type), 0);
+
+      if (z_src_type.length == 4) {
+         unsigned i;
+         LLVMValueRef looplsb = LLVMBuildAnd(builder, loop_counter,
+                                             lp_build_const_int32(gallivm, 1), "");
+         LLVMValueRef loopmsb = LLVMBuildAnd(builder, loop_counter,
+                                             lp_build_const_int32(gallivm, 2), "");
+         LLVMValueRef offset2 = LLVMBuildMul(builder, loopmsb,
+                                             depth_stride, "");
+         depth_offset1 = LLVMBuildMul(builder, looplsb,
+                                      lp_build_const_int32(gallivm, depth_bytes * 2), "");
+         depth_offset1 = LLVMBuildAdd(builder, depth_offset1, offset2, "");
+
+         /* just concatenate the loaded 2x2 values into 4-wide vector */
+         for (i = 0; i < 4; i++) {
+            shuffles[i] = lp_build_const_int32(gallivm, i);
+         }
+      }
+      else {
+         unsigned i;
+         LLVMValueRef loopx2 = LLVMBuildShl(builder, loop_counter,
+                                            lp_build_const_int32(gallivm, 1), "");
+         assert(z_src_type.length == 8);
+         depth_offset1 = LLVMBuildMul(builder, loopx2, depth_stride, "");
+         /*
+          * We load 2x4 values, and need to swizzle them (order
+          * 0,1,4,5,2,3,6,7) - not so hot with avx unfortunately.
+          */
+         for (i = 0; i < 8; i++) {
+            shuffles[i] = lp_build_const_int32(gallivm, (i&1) + (i&2) * 2 + (i&4) / 2);
+         }
       }
-   }
 
-   depth_offset2 = LLVMBuildAdd(builder, depth_offset1, depth_stride, "");
+      depth_offset2 = LLVMBuildAdd(builder, depth_offset1, depth_stride, "");
 
-   /* Load current z/stencil values from z/stencil buffer */
-   zs_dst_ptr = LLVMBuildGEP(builder, depth_ptr, &depth_offset1, 1, "");
-   zs_dst_ptr = LLVMBuildBitCast(builder, zs_dst_ptr, load_ptr_type, "");
-   zs_dst1 = LLVMBuildLoad(builder, zs_dst_ptr, "");
-   if (is_1d) {
-      zs_dst2 = lp_build_undef(gallivm, zs_load_type);
-   }
-   else {
-      zs_dst_ptr = LLVMBuildGEP(builder, depth_ptr, &depth_offset2, 1, "");
+      /* Load current z/stencil values from z/stencil buffer */
+      zs_dst_ptr = LLVMBuildGEP(builder, depth_ptr, &depth_offset1, 1, "");
       zs_dst_ptr = LLVMBuildBitCast(builder, zs_dst_ptr, load_ptr_type, "");
-      zs_dst2 = LLVMBuildLoad(builder, zs_dst_ptr, "");
+      zs_dst1 = LLVMBuildLoad(builder, zs_dst_ptr, "");
+      if (is_1d) {
+         zs_dst2 = lp_build_undef(gallivm, zs_load_type);
+      }
+      else {
+         zs_dst_ptr = LLVMBuildGEP(builder, depth_ptr, &depth_offset2, 1, "");
+         zs_dst_ptr = LLVMBuildBitCast(builder, zs_dst_ptr, load_ptr_type, "");
+         zs_dst2 = LLVMBuildLoad(builder, zs_dst_ptr, "");
+      }
    }
 
    *z_fb = LLVMBuildShuffleVector(builder, zs_dst1, zs_dst2,
@@ -706,11 +762,10 @@ lp_build_depth_stencil_write_swizzled(struct gallivm_state *gallivm,
                                    lp_build_const_int32(gallivm, depth_bytes * 2), "");
       depth_offset1 = LLVMBuildAdd(builder, depth_offset1, offset2, "");
    }
-   else {
+   else if (z_src_type.length == 8) {
       unsigned i;
       LLVMValueRef loopx2 = LLVMBuildShl(builder, loop_counter,
                                          lp_build_const_int32(gallivm, 1), "");
-      assert(z_src_type.length == 8);
       depth_offset1 = LLVMBuildMul(builder, loopx2, depth_stride, "");
       /*
        * We load 2x4 values, and need to swizzle them (order
@@ -720,6 +775,12 @@ lp_build_depth_stencil_write_swizzled(struct gallivm_state *gallivm,
          shuffles[i] = lp_build_const_int32(gallivm, (i&1) + (i&2) * 2 + (i&4) / 2);
       }
    }
+   else {
+      /* the whole 4x4 block, stored row by row below */
+      assert(z_src_type.length == 16);
+      assert(!is_1d);
+      depth_offset1 = lp_build_const_int32(gallivm, 0);
+   }
 
    depth_offset2 = LLVMBuildAdd(builder, depth_offset1, depth_stride, "");
 
@@ -747,6 +808,47 @@ lp_build_depth_stencil_write_swizzled(struct gallivm_state *gallivm,
                                lp_build_int_vec_type(gallivm, zs_type), "");
    }
 
+   if (z_src_type.length == 16) {
+      struct lp_type zs_row_type = zs_type;
+      LLVMTypeRef row_ptr_type;
+      unsigned x, y;
+
+      zs_row_type.length = 4;
+      row_ptr_type = LLVMPointerType(lp_build_vec_type(gallivm, zs_row_type), 0);
+
+      for (y = 0; y < 4; y++) {
+         LLVMValueRef row_shuffles[8];
+         LLVMValueRef row, row_offset, row_ptr;
+
+         if (format_desc->block.bits <= 32) {
+            for (x = 0; x < 4; x++) {
+               row_shuffles[x] =
+                  lp_build_const_int32(gallivm, lp_depth_quad_index_4x4(x, y));
+            }
+            row = LLVMBuildShuffleVector(builder, z_value, z_value,
+                                         LLVMConstVector(row_shuffles, 4), "");
+         }
+         else {
+            for (x = 0; x < 4; x++) {
+               unsigned idx = lp_depth_quad_index_4x4(x, y);
+               row_shuffles[x*2] = lp_build_const_int32(gallivm, idx);
+               row_shuffles[x*2+1] = lp_build_const_int32(gallivm, idx + 16);
+            }
+            row = LLVMBuildShuffleVector(builder, z_value, s_value,
+                                         LLVMConstVector(row_shuffles, 8), "");
+            row = LLVMBuildBitCast(builder, row,
+                                   lp_build_vec_type(gallivm, zs_row_type), "");
+         }
+
+         row_offset = LLVMBuildMul(builder, depth_stride,
+                                   lp_build_const_int32(gallivm, y), "");
+         row_ptr = LLVMBuildGEP(builder, depth_ptr, &row_offset, 1, "");
+         row_ptr = LLVMBuildBitCast(builder, row_ptr, row_ptr_type, "");
+         LLVMBuildStore(builder, row, row_ptr);
+      }
+      return;
+   }
+
    if (format_desc->block.bits <= 32) {
       if (z_src_type.length == 4) {
          zs_dst1 = lp_build_extract_range(gallivm, z_value, 0, 2);
@@ -110,6 +110,10 @@
 #define PERSPECTIVE_DIVIDE_PER_QUAD 0
 
 
+/*
+ * Pixel offsets within the 4x4 stamp in quad order, a 16-wide vector
+ * covers the whole stamp.
+ */
 static const unsigned char quad_offset_x[16] = {0, 1, 0, 1, 2, 3, 2, 3, 0, 1, 0, 1, 2, 3, 2, 3};
 static const unsigned char quad_offset_y[16] = {0, 0, 1, 1, 0, 0, 1, 1, 2, 2, 3, 3, 2, 2, 3, 3};
 
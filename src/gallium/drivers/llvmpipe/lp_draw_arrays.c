@@ -35,8 +35,11 @@
 #include "pipe/p_context.h"
 #include "util/u_draw.h"
 #include "util/u_prim.h"
+#include "util/u_atomic.h"
+#include "util/os_time.h"
 
 #include "lp_context.h"
+#include "lp_screen.h"
 #include "lp_state.h"
 #include "lp_query.h"
 
@@ -55,7 +58,9 @@ llvmpipe_draw_vbo(struct pipe_context *pipe, const struct pipe_draw_info *info)
 {
    struct llvmpipe_context *lp = llvmpipe_context(pipe);
    struct draw_context *draw = lp->draw;
+   struct llvmpipe_screen *screen = llvmpipe_screen(pipe->screen);
    const void *mapped_indices = NULL;
+   int64_t start_time;
    unsigned i;
 
    if (!llvmpipe_check_render_cond(lp))
@@ -69,6 +74,8 @@ llvmpipe_draw_vbo(struct pipe_context *pipe, const struct pipe_draw_info *info)
    if (lp->dirty)
       llvmpipe_update_derived( lp );
 
+   llvmpipe_fs_variant_draw(lp);
+
    /*
     * Map vertex buffers
     */
@@ -126,6 +133,7 @@ llvmpipe_draw_vbo(struct pipe_context *pipe, const struct pipe_draw_info *info)
                                     lp->active_statistics_queries > 0);
 
    /* draw! */
+   start_time = os_time_get_nano();
    draw_vbo(draw, info);
 
    /*
@@ -153,6 +161,10 @@ llvmpipe_draw_vbo(struct pipe_context *pipe, const struct pipe_draw_info *info)
     * internally when this condition is seen?)
     */
    draw_flush(draw);
+
+   /* Vertex processing and binning, plus any scene flushed meanwhile */
+   p_atomic_add(&screen->counters.counter[LP_COUNTER_BIN_TIME],
+                os_time_get_nano() - start_time);
 }
 
 
@@ -104,10 +104,21 @@ lp_fence_signal(struct lp_fence *fence)
    mtx_unlock(&fence->mutex);
 }
 
+/**
+ * Check if the fence has finished, without blocking.
+ * Takes the fence mutex since the setup code polls fences of scenes
+ * which may still be in flight on the rasterizer threads.
+ */
 boolean
 lp_fence_signalled(struct lp_fence *f)
 {
-   return f->count == f->rank;
+   boolean signalled;
+
+   mtx_lock(&f->mutex);
+   signalled = f->count == f->rank;
+   mtx_unlock(&f->mutex);
+
+   return signalled;
 }
 
 void
@@ -37,7 +37,10 @@
 #include "draw/draw_context.h"
 #include "lp_flush.h"
 #include "lp_context.h"
+#include "lp_fence.h"
+#include "lp_screen.h"
 #include "lp_setup.h"
+#include "lp_texture.h"
 
 
 /**
@@ -129,5 +132,39 @@ llvmpipe_flush_resource(struct pipe_context *pipe,
       }
    }
 
+   if (cpu_access) {
+      /*
+       * Scenes queued by other contexts may still be rendering to the
+       * resource, (or for writes, sampling from it).
+       */
+      struct llvmpipe_screen *screen = llvmpipe_screen(resource->screen);
+      struct llvmpipe_resource *lpr = llvmpipe_resource(resource);
+      struct lp_fence *fences[2] = { NULL, NULL };
+      boolean ret = TRUE;
+      unsigned i;
+
+      mtx_lock(&screen->rast_mutex);
+      lp_fence_reference(&fences[0], lpr->last_write_fence);
+      if (!read_only)
+         lp_fence_reference(&fences[1], lpr->last_use_fence);
+      mtx_unlock(&screen->rast_mutex);
+
+      for (i = 0; i < ARRAY_SIZE(fences); i++) {
+         if (!fences[i])
+            continue;
+
+         if (do_not_block) {
+            if (!lp_fence_signalled(fences[i]))
+               ret = FALSE;
+         } else {
+            lp_fence_wait(fences[i]);
+         }
+
+         lp_fence_reference(&fences[i], NULL);
+      }
+
+      return ret;
+   }
+
    return TRUE;
 }
@@ -45,6 +45,7 @@
 
 struct lp_build_format_cache;
 struct lp_fragment_shader_variant;
+struct lp_compute_shader_variant;
 struct llvmpipe_screen;
 
 
@@ -71,6 +72,17 @@ struct lp_jit_sampler
 };
 
 
+struct lp_jit_image
+{
+   const void *base;
+   uint32_t width;        /* same as number of elements */
+   uint32_t height;
+   uint32_t depth;        /* doubles as array size */
+   uint32_t row_stride;
+   uint32_t img_stride;
+};
+
+
 struct lp_jit_viewport
 {
    float min_depth;
@@ -101,6 +113,17 @@ enum {
 };
 
 
+enum {
+   LP_JIT_IMAGE_BASE = 0,
+   LP_JIT_IMAGE_WIDTH,
+   LP_JIT_IMAGE_HEIGHT,
+   LP_JIT_IMAGE_DEPTH,
+   LP_JIT_IMAGE_ROW_STRIDE,
+   LP_JIT_IMAGE_IMG_STRIDE,
+   LP_JIT_IMAGE_NUM_FIELDS  /* number of fields above */
+};
+
+
 enum {
    LP_JIT_VIEWPORT_MIN_DEPTH,
    LP_JIT_VIEWPORT_MAX_DEPTH,
@@ -124,6 +147,14 @@ struct lp_jit_context
    const float *constants[LP_MAX_TGSI_CONST_BUFFERS];
    int num_constants[LP_MAX_TGSI_CONST_BUFFERS];
 
+   struct lp_jit_texture textures[PIPE_MAX_SHADER_SAMPLER_VIEWS];
+   struct lp_jit_sampler samplers[PIPE_MAX_SAMPLERS];
+   struct lp_jit_image images[LP_MAX_TGSI_SHADER_IMAGES];
+
+   /** shader buffers and their sizes in bytes */
+   uint32_t *ssbos[LP_MAX_TGSI_SHADER_BUFFERS];
+   int num_ssbo_bytes[LP_MAX_TGSI_SHADER_BUFFERS];
+
    float alpha_ref_value;
 
    uint32_t stencil_ref_front, stencil_ref_back;
@@ -132,27 +163,31 @@ struct lp_jit_context
    float *f_blend_color;
 
    struct lp_jit_viewport *viewports;
-
-   struct lp_jit_texture textures[PIPE_MAX_SHADER_SAMPLER_VIEWS];
-   struct lp_jit_sampler samplers[PIPE_MAX_SAMPLERS];
 };
 
 
 /**
  * These enum values must match the position of the fields in the
  * lp_jit_context struct above.
+ *
+ * The fields up to LP_JIT_CTX_NUM_SSBO_BYTES are shared with
+ * lp_jit_cs_context, so the code accessing textures, samplers, images and
+ * shader buffers works with either context.
  */
 enum {
    LP_JIT_CTX_CONSTANTS = 0,
    LP_JIT_CTX_NUM_CONSTANTS,
+   LP_JIT_CTX_TEXTURES,
+   LP_JIT_CTX_SAMPLERS,
+   LP_JIT_CTX_IMAGES,
+   LP_JIT_CTX_SSBOS,
+   LP_JIT_CTX_NUM_SSBO_BYTES,
    LP_JIT_CTX_ALPHA_REF,
    LP_JIT_CTX_STENCIL_REF_FRONT,
    LP_JIT_CTX_STENCIL_REF_BACK,
    LP_JIT_CTX_U8_BLEND_COLOR,
    LP_JIT_CTX_F_BLEND_COLOR,
    LP_JIT_CTX_VIEWPORTS,
-   LP_JIT_CTX_TEXTURES,
-   LP_JIT_CTX_SAMPLERS,
    LP_JIT_CTX_COUNT
 };
 
@@ -187,6 +222,15 @@ enum {
 #define lp_jit_context_samplers(_gallivm, _ptr) \
    lp_build_struct_get_ptr(_gallivm, _ptr, LP_JIT_CTX_SAMPLERS, "samplers")
 
+#define lp_jit_context_images(_gallivm, _ptr) \
+   lp_build_struct_get_ptr(_gallivm, _ptr, LP_JIT_CTX_IMAGES, "images")
+
+#define lp_jit_context_ssbos(_gallivm, _ptr) \
+   lp_build_struct_get_ptr(_gallivm, _ptr, LP_JIT_CTX_SSBOS, "ssbos")
+
+#define lp_jit_context_num_ssbo_bytes(_gallivm, _ptr) \
+   lp_build_struct_get_ptr(_gallivm, _ptr, LP_JIT_CTX_NUM_SSBO_BYTES, "num_ssbo_bytes")
+
 
 struct lp_jit_thread_data
 {
@@ -259,6 +303,113 @@ typedef void
                     unsigned depth_stride);
 
 
+/**
+ * This structure is passed directly to the generated compute shader.
+ *
+ * Changes here must be reflected in the lp_jit_cs_context_* macros and
+ * lp_jit_init_cs_types function.
+ */
+struct lp_jit_cs_context
+{
+   const float *constants[LP_MAX_TGSI_CONST_BUFFERS];
+   int num_constants[LP_MAX_TGSI_CONST_BUFFERS];
+
+   struct lp_jit_texture textures[PIPE_MAX_SHADER_SAMPLER_VIEWS];
+   struct lp_jit_sampler samplers[PIPE_MAX_SAMPLERS];
+   struct lp_jit_image images[LP_MAX_TGSI_SHADER_IMAGES];
+
+   /** shader buffers and their sizes in bytes */
+   uint32_t *ssbos[LP_MAX_TGSI_SHADER_BUFFERS];
+   int num_ssbo_bytes[LP_MAX_TGSI_SHADER_BUFFERS];
+
+   /** size of the shared memory in bytes */
+   uint32_t shared_size;
+};
+
+
+/**
+ * These enum values must match the position of the fields in the
+ * lp_jit_cs_context struct above, and the common ones those of
+ * lp_jit_context.
+ */
+enum {
+   LP_JIT_CS_CTX_CONSTANTS = LP_JIT_CTX_CONSTANTS,
+   LP_JIT_CS_CTX_NUM_CONSTANTS = LP_JIT_CTX_NUM_CONSTANTS,
+   LP_JIT_CS_CTX_TEXTURES = LP_JIT_CTX_TEXTURES,
+   LP_JIT_CS_CTX_SAMPLERS = LP_JIT_CTX_SAMPLERS,
+   LP_JIT_CS_CTX_IMAGES = LP_JIT_CTX_IMAGES,
+   LP_JIT_CS_CTX_SSBOS = LP_JIT_CTX_SSBOS,
+   LP_JIT_CS_CTX_NUM_SSBO_BYTES = LP_JIT_CTX_NUM_SSBO_BYTES,
+   LP_JIT_CS_CTX_SHARED_SIZE,
+   LP_JIT_CS_CTX_COUNT
+};
+
+
+#define lp_jit_cs_context_constants(_gallivm, _ptr) \
+   lp_build_struct_get_ptr(_gallivm, _ptr, LP_JIT_CS_CTX_CONSTANTS, "constants")
+
+#define lp_jit_cs_context_num_constants(_gallivm, _ptr) \
+   lp_build_struct_get_ptr(_gallivm, _ptr, LP_JIT_CS_CTX_NUM_CONSTANTS, "num_constants")
+
+#define lp_jit_cs_context_shared_size(_gallivm, _ptr) \
+   lp_build_struct_get(_gallivm, _ptr, LP_JIT_CS_CTX_SHARED_SIZE, "shared_size")
+
+
+struct lp_cs_exec;
+
+struct lp_jit_cs_thread_data
+{
+   /** texture cache, at the same place as in lp_jit_thread_data */
+   struct lp_build_format_cache *cache;
+
+   /** shared memory of the work group being executed */
+   void *shared;
+
+   /** opaque state of the executing thread, passed to lp_cs_barrier() */
+   struct lp_cs_exec *exec;
+};
+
+
+enum {
+   LP_JIT_CS_THREAD_DATA_CACHE = LP_JIT_THREAD_DATA_CACHE,
+   LP_JIT_CS_THREAD_DATA_SHARED,
+   LP_JIT_CS_THREAD_DATA_EXEC,
+   LP_JIT_CS_THREAD_DATA_COUNT
+};
+
+
+#define lp_jit_cs_thread_data_shared(_gallivm, _ptr) \
+   lp_build_struct_get(_gallivm, _ptr, LP_JIT_CS_THREAD_DATA_SHARED, "shared")
+
+
+/**
+ * typedef for compute shader function
+ *
+ * Runs one SIMD group, i.e. as many consecutive invocations of a work group
+ * as there are vector lanes.
+ *
+ * @param context            jit context
+ * @param block_id_x/y/z     work group id
+ * @param grid_size_x/y/z    number of work groups
+ * @param block_size_x/y/z   work group size
+ * @param first_invocation   linear invocation index of the first lane
+ * @param thread_data        task thread data
+ */
+typedef void
+(*lp_jit_cs_func)(const struct lp_jit_cs_context *context,
+                  uint32_t block_id_x,
+                  uint32_t block_id_y,
+                  uint32_t block_id_z,
+                  uint32_t grid_size_x,
+                  uint32_t grid_size_y,
+                  uint32_t grid_size_z,
+                  uint32_t block_size_x,
+                  uint32_t block_size_y,
+                  uint32_t block_size_z,
+                  uint32_t first_invocation,
+                  struct lp_jit_cs_thread_data *thread_data);
+
+
 void
 lp_jit_screen_cleanup(struct llvmpipe_screen *screen);
 
@@ -271,4 +422,23 @@ void
 lp_jit_init_types(struct lp_fragment_shader_variant *lp);
 
 
+void
+lp_jit_init_cs_types(struct lp_compute_shader_variant *variant);
+
+
+void
+lp_jit_texture_from_pipe(struct lp_jit_texture *jit_tex,
+                         const struct pipe_sampler_view *view);
+
+
+void
+lp_jit_sampler_from_pipe(struct lp_jit_sampler *jit_sam,
+                         const struct pipe_sampler_state *sampler);
+
+
+void
+lp_jit_image_from_pipe(struct lp_jit_image *jit_image,
+                       const struct pipe_image_view *view);
+
+
 #endif /* LP_JIT_H */
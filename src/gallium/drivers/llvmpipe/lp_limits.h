@@ -61,7 +61,17 @@
 #define LP_MAX_WIDTH  (1 << (LP_MAX_TEXTURE_LEVELS - 1))
 
 
-#define LP_MAX_THREADS 16
+/**
+ * Upper bound on the number of rasterizer threads.  The thread pool and
+ * per-thread query counters are sized at runtime, this is only a sanity
+ * limit.
+ */
+#define LP_MAX_THREADS 256
+
+/**
+ * Max number of NUMA nodes the rasterizer threads are spread over.
+ */
+#define LP_MAX_NUMA_NODES 16
 
 
 /**
@@ -34,6 +34,7 @@
 #define LP_PERF_H
 
 #include "pipe/p_compiler.h"
+#include "lp_limits.h"
 
 /**
  * Various counters
@@ -80,6 +81,38 @@ extern struct lp_counters lp_count;
 #endif
 
 
+/**
+ * Counters which are always collected, unlike the ones above, and exposed
+ * as driver queries.  They are per screen, cumulative since its creation
+ * and only updated with atomics: the rasterizer threads add their counts
+ * once per scene, the draw and compile paths once per call.
+ * Times are in nanoseconds.
+ */
+enum lp_driver_counter
+{
+   LP_COUNTER_SCENES,
+   LP_COUNTER_BIN_TIME,
+   LP_COUNTER_BINS,
+   LP_COUNTER_BIN_COMMANDS,
+   LP_COUNTER_EMPTY_BINS,
+   LP_COUNTER_FULLY_COVERED_BINS,
+   LP_COUNTER_FS_COMPILES,
+   LP_COUNTER_FS_COMPILE_TIME,
+   LP_COUNTER_FS_TIER_UPS,
+   LP_COUNTER_FS_TIER_UP_TIME,
+   LP_NUM_DRIVER_COUNTERS
+};
+
+
+struct lp_driver_counters
+{
+   uint64_t counter[LP_NUM_DRIVER_COUNTERS];
+
+   /** Time each rasterizer thread spent rasterizing scenes */
+   uint64_t rast_time[LP_MAX_THREADS];
+};
+
+
 extern void
 lp_reset_counters(void);
 
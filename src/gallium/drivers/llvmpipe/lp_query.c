@@ -33,6 +33,8 @@
 #include "draw/draw_context.h"
 #include "pipe/p_defines.h"
 #include "util/u_memory.h"
+#include "util/u_string.h"
+#include "util/u_atomic.h"
 #include "util/os_time.h"
 #include "lp_context.h"
 #include "lp_flush.h"
@@ -48,19 +50,168 @@ static struct llvmpipe_query *llvmpipe_query( struct pipe_query *p )
    return (struct llvmpipe_query *)p;
 }
 
+
+/**
+ * Driver queries, read from the screen's lp_driver_counters.
+ *
+ * The counters are screen-wide, so a query also counts the work of other
+ * contexts of the screen.  The rasterizer adds its counts when a thread
+ * finishes a scene, so scenes still in flight at end_query are missed;
+ * results are exact when a flush+finish precedes both begin and end.
+ *
+ * The ratios are returned as UINT64 percentages rather than PERCENTAGE,
+ * which the HUD and the perfmon extension read with different types.
+ */
+enum lp_driver_query {
+   LP_QUERY_SCENES,
+   LP_QUERY_BIN_TIME,
+   LP_QUERY_RAST_TIME,
+   LP_QUERY_BINS,
+   LP_QUERY_BIN_COMMANDS,
+   LP_QUERY_COMMANDS_PER_BIN,
+   LP_QUERY_EMPTY_TILES,
+   LP_QUERY_EMPTY_TILES_RATIO,
+   LP_QUERY_FULLY_COVERED_TILES,
+   LP_QUERY_FULLY_COVERED_TILES_RATIO,
+   LP_QUERY_FS_COMPILES,
+   LP_QUERY_FS_COMPILE_TIME,
+   LP_QUERY_FS_TIER_UPS,
+   LP_QUERY_FS_TIER_UP_TIME,
+   /* followed by one rast-time query per rasterizer thread */
+   LP_QUERY_RAST_TIME_THREAD0
+};
+
+#define LP_QUERY_NAME_SIZE 24
+
+
+static boolean
+lp_is_driver_query(unsigned type)
+{
+   return type >= PIPE_QUERY_DRIVER_SPECIFIC;
+}
+
+
+static uint64_t
+lp_read_counter(struct llvmpipe_screen *screen, enum lp_driver_counter c)
+{
+   return p_atomic_read(&screen->counters.counter[c]);
+}
+
+
+/**
+ * Sample the current value of a driver query, plus the divisor of the
+ * queries returning a ratio or an average.
+ */
+static void
+lp_sample_driver_query(struct llvmpipe_screen *screen,
+                       unsigned query,
+                       uint64_t value[2])
+{
+   unsigned i;
+
+   value[0] = 0;
+   value[1] = 0;
+
+   switch (query) {
+   case LP_QUERY_SCENES:
+      value[0] = lp_read_counter(screen, LP_COUNTER_SCENES);
+      break;
+   case LP_QUERY_BIN_TIME:
+      value[0] = lp_read_counter(screen, LP_COUNTER_BIN_TIME);
+      break;
+   case LP_QUERY_RAST_TIME:
+      for (i = 0; i < LP_MAX_THREADS; i++)
+         value[0] += p_atomic_read(&screen->counters.rast_time[i]);
+      break;
+   case LP_QUERY_BINS:
+      value[0] = lp_read_counter(screen, LP_COUNTER_BINS);
+      break;
+   case LP_QUERY_BIN_COMMANDS:
+      value[0] = lp_read_counter(screen, LP_COUNTER_BIN_COMMANDS);
+      break;
+   case LP_QUERY_COMMANDS_PER_BIN:
+      value[0] = lp_read_counter(screen, LP_COUNTER_BIN_COMMANDS);
+      value[1] = lp_read_counter(screen, LP_COUNTER_BINS);
+      break;
+   case LP_QUERY_EMPTY_TILES:
+      value[0] = lp_read_counter(screen, LP_COUNTER_EMPTY_BINS);
+      break;
+   case LP_QUERY_EMPTY_TILES_RATIO:
+      value[0] = lp_read_counter(screen, LP_COUNTER_EMPTY_BINS);
+      value[1] = value[0] + lp_read_counter(screen, LP_COUNTER_BINS);
+      break;
+   case LP_QUERY_FULLY_COVERED_TILES:
+      value[0] = lp_read_counter(screen, LP_COUNTER_FULLY_COVERED_BINS);
+      break;
+   case LP_QUERY_FULLY_COVERED_TILES_RATIO:
+      value[0] = lp_read_counter(screen, LP_COUNTER_FULLY_COVERED_BINS);
+      value[1] = lp_read_counter(screen, LP_COUNTER_BINS);
+      break;
+   case LP_QUERY_FS_COMPILES:
+      value[0] = lp_read_counter(screen, LP_COUNTER_FS_COMPILES);
+      break;
+   case LP_QUERY_FS_COMPILE_TIME:
+      value[0] = lp_read_counter(screen, LP_COUNTER_FS_COMPILE_TIME);
+      break;
+   case LP_QUERY_FS_TIER_UPS:
+      value[0] = lp_read_counter(screen, LP_COUNTER_FS_TIER_UPS);
+      break;
+   case LP_QUERY_FS_TIER_UP_TIME:
+      value[0] = lp_read_counter(screen, LP_COUNTER_FS_TIER_UP_TIME);
+      break;
+   default:
+      i = query - LP_QUERY_RAST_TIME_THREAD0;
+      assert(i < LP_MAX_THREADS);
+      value[0] = p_atomic_read(&screen->counters.rast_time[i]);
+      break;
+   }
+}
+
+
+static uint64_t
+lp_driver_query_result(struct llvmpipe_screen *screen,
+                       const struct llvmpipe_query *pq)
+{
+   const struct pipe_driver_query_info *info =
+      &screen->driver_queries[pq->type - PIPE_QUERY_DRIVER_SPECIFIC];
+   uint64_t value = pq->driver_end[0] - pq->driver_start[0];
+   uint64_t divisor = pq->driver_end[1] - pq->driver_start[1];
+
+   if (info->result_type == PIPE_DRIVER_QUERY_RESULT_TYPE_AVERAGE) {
+      if (!divisor)
+         return 0;
+      if (info->max_value.u64 == 100)
+         value *= 100;
+      return value / divisor;
+   }
+
+   if (info->type == PIPE_DRIVER_QUERY_TYPE_MICROSECONDS)
+      return value / 1000;
+
+   return value;
+}
+
 static struct pipe_query *
 llvmpipe_create_query(struct pipe_context *pipe, 
                       unsigned type,
                       unsigned index)
 {
+   struct llvmpipe_screen *screen = llvmpipe_screen(pipe->screen);
+   unsigned num_threads = MAX2(1, screen->num_threads);
    struct llvmpipe_query *pq;
 
-   assert(type < PIPE_QUERY_TYPES);
+   assert(type < PIPE_QUERY_TYPES ||
+          (lp_is_driver_query(type) &&
+           type - PIPE_QUERY_DRIVER_SPECIFIC < screen->num_driver_queries));
 
-   pq = CALLOC_STRUCT( llvmpipe_query );
+   /* The per-thread counters are allocated along with the query. */
+   pq = CALLOC(1, sizeof *pq + 2 * num_threads * sizeof(uint64_t));
 
    if (pq) {
       pq->type = type;
+      pq->num_threads = num_threads;
+      pq->start = (uint64_t *) (pq + 1);
+      pq->end = pq->start + num_threads;
    }
 
    return (struct pipe_query *) pq;
@@ -95,9 +246,8 @@ llvmpipe_get_query_result(struct pipe_context *pipe,
                           boolean wait,
                           union pipe_query_result *vresult)
 {
-   struct llvmpipe_screen *screen = llvmpipe_screen(pipe->screen);
-   unsigned num_threads = MAX2(1, screen->num_threads);
    struct llvmpipe_query *pq = llvmpipe_query(q);
+   unsigned num_threads = pq->num_threads;
    uint64_t *result = (uint64_t *)vresult;
    int i;
 
@@ -114,6 +264,11 @@ llvmpipe_get_query_result(struct pipe_context *pipe,
       }
    }
 
+   if (lp_is_driver_query(pq->type)) {
+      *result = lp_driver_query_result(llvmpipe_screen(pipe->screen), pq);
+      return TRUE;
+   }
+
    /* Sum the results from each of the threads:
     */
    *result = 0;
@@ -200,9 +355,24 @@ llvmpipe_begin_query(struct pipe_context *pipe, struct pipe_query *q)
       llvmpipe_finish(pipe, __FUNCTION__);
    }
 
+   /* The scene may also still be in flight on the rasterizer threads,
+    * which write the per-thread counters we're about to reset.
+    */
+   if (pq->fence && !lp_fence_signalled(pq->fence)) {
+      lp_fence_wait(pq->fence);
+   }
+
+
+   memset(pq->start, 0, pq->num_threads * sizeof(pq->start[0]));
+   memset(pq->end, 0, pq->num_threads * sizeof(pq->end[0]));
+
+   if (lp_is_driver_query(pq->type)) {
+      lp_sample_driver_query(llvmpipe_screen(pipe->screen),
+                             pq->type - PIPE_QUERY_DRIVER_SPECIFIC,
+                             pq->driver_start);
+      return true;
+   }
 
-   memset(pq->start, 0, sizeof(pq->start));
-   memset(pq->end, 0, sizeof(pq->end));
    lp_setup_begin_query(llvmpipe->setup, pq);
 
    switch (pq->type) {
@@ -249,6 +419,13 @@ llvmpipe_end_query(struct pipe_context *pipe, struct pipe_query *q)
    struct llvmpipe_context *llvmpipe = llvmpipe_context( pipe );
    struct llvmpipe_query *pq = llvmpipe_query(q);
 
+   if (lp_is_driver_query(pq->type)) {
+      lp_sample_driver_query(llvmpipe_screen(pipe->screen),
+                             pq->type - PIPE_QUERY_DRIVER_SPECIFIC,
+                             pq->driver_end);
+      return true;
+   }
+
    lp_setup_end_query(llvmpipe->setup, pq);
 
    switch (pq->type) {
@@ -344,3 +521,138 @@ void llvmpipe_init_query_funcs(struct llvmpipe_context *llvmpipe )
 }
 
 
+static int
+llvmpipe_get_driver_query_info(struct pipe_screen *_screen,
+                               unsigned index,
+                               struct pipe_driver_query_info *info)
+{
+   struct llvmpipe_screen *screen = llvmpipe_screen(_screen);
+
+   if (!info)
+      return screen->num_driver_queries;
+
+   if (index >= screen->num_driver_queries)
+      return 0;
+
+   *info = screen->driver_queries[index];
+   return 1;
+}
+
+
+static int
+llvmpipe_get_driver_query_group_info(struct pipe_screen *_screen,
+                                     unsigned index,
+                                     struct pipe_driver_query_group_info *info)
+{
+   struct llvmpipe_screen *screen = llvmpipe_screen(_screen);
+
+   if (!info)
+      return 1;
+
+   if (index != 0)
+      return 0;
+
+   /* All of them are plain reads of the counters */
+   info->name = "llvmpipe";
+   info->max_active_queries = screen->num_driver_queries;
+   info->num_queries = screen->num_driver_queries;
+   return 1;
+}
+
+
+static void
+lp_add_driver_query(struct llvmpipe_screen *screen,
+                    const char *name,
+                    enum pipe_driver_query_type type,
+                    enum pipe_driver_query_result_type result_type,
+                    uint64_t max_value)
+{
+   struct pipe_driver_query_info *info =
+      &screen->driver_queries[screen->num_driver_queries];
+
+   info->name = name;
+   info->query_type = PIPE_QUERY_DRIVER_SPECIFIC + screen->num_driver_queries;
+   info->max_value.u64 = max_value;
+   info->type = type;
+   info->result_type = result_type;
+   info->group_id = 0;
+   info->flags = 0;
+
+   screen->num_driver_queries++;
+}
+
+
+void
+llvmpipe_init_screen_query_funcs(struct pipe_screen *_screen)
+{
+   struct llvmpipe_screen *screen = llvmpipe_screen(_screen);
+   unsigned num_threads = MAX2(1, screen->num_threads);
+   unsigned num_queries = LP_QUERY_RAST_TIME_THREAD0 + num_threads;
+   char *names;
+   unsigned i;
+
+   /* The names of the per-thread queries are stored after the infos */
+   screen->driver_queries =
+      CALLOC(1, num_queries * sizeof(screen->driver_queries[0]) +
+                num_threads * LP_QUERY_NAME_SIZE);
+   screen->num_driver_queries = 0;
+   if (!screen->driver_queries)
+      return;
+   names = (char *) (screen->driver_queries + num_queries);
+
+   lp_add_driver_query(screen, "scenes",
+                       PIPE_DRIVER_QUERY_TYPE_UINT64,
+                       PIPE_DRIVER_QUERY_RESULT_TYPE_CUMULATIVE, 0);
+   lp_add_driver_query(screen, "bin-time",
+                       PIPE_DRIVER_QUERY_TYPE_MICROSECONDS,
+                       PIPE_DRIVER_QUERY_RESULT_TYPE_CUMULATIVE, 0);
+   lp_add_driver_query(screen, "rast-time",
+                       PIPE_DRIVER_QUERY_TYPE_MICROSECONDS,
+                       PIPE_DRIVER_QUERY_RESULT_TYPE_CUMULATIVE, 0);
+   lp_add_driver_query(screen, "bins",
+                       PIPE_DRIVER_QUERY_TYPE_UINT64,
+                       PIPE_DRIVER_QUERY_RESULT_TYPE_CUMULATIVE, 0);
+   lp_add_driver_query(screen, "bin-commands",
+                       PIPE_DRIVER_QUERY_TYPE_UINT64,
+                       PIPE_DRIVER_QUERY_RESULT_TYPE_CUMULATIVE, 0);
+   lp_add_driver_query(screen, "commands-per-bin",
+                       PIPE_DRIVER_QUERY_TYPE_UINT64,
+                       PIPE_DRIVER_QUERY_RESULT_TYPE_AVERAGE, 0);
+   lp_add_driver_query(screen, "empty-tiles",
+                       PIPE_DRIVER_QUERY_TYPE_UINT64,
+                       PIPE_DRIVER_QUERY_RESULT_TYPE_CUMULATIVE, 0);
+   lp_add_driver_query(screen, "empty-tiles-ratio",
+                       PIPE_DRIVER_QUERY_TYPE_UINT64,
+                       PIPE_DRIVER_QUERY_RESULT_TYPE_AVERAGE, 100);
+   lp_add_driver_query(screen, "fully-covered-tiles",
+                       PIPE_DRIVER_QUERY_TYPE_UINT64,
+                       PIPE_DRIVER_QUERY_RESULT_TYPE_CUMULATIVE, 0);
+   lp_add_driver_query(screen, "fully-covered-tiles-ratio",
+                       PIPE_DRIVER_QUERY_TYPE_UINT64,
+                       PIPE_DRIVER_QUERY_RESULT_TYPE_AVERAGE, 100);
+   lp_add_driver_query(screen, "fs-compiles",
+                       PIPE_DRIVER_QUERY_TYPE_UINT64,
+                       PIPE_DRIVER_QUERY_RESULT_TYPE_CUMULATIVE, 0);
+   lp_add_driver_query(screen, "fs-compile-time",
+                       PIPE_DRIVER_QUERY_TYPE_MICROSECONDS,
+                       PIPE_DRIVER_QUERY_RESULT_TYPE_CUMULATIVE, 0);
+   lp_add_driver_query(screen, "fs-tier-ups",
+                       PIPE_DRIVER_QUERY_TYPE_UINT64,
+                       PIPE_DRIVER_QUERY_RESULT_TYPE_CUMULATIVE, 0);
+   lp_add_driver_query(screen, "fs-tier-up-time",
+                       PIPE_DRIVER_QUERY_TYPE_MICROSECONDS,
+                       PIPE_DRIVER_QUERY_RESULT_TYPE_CUMULATIVE, 0);
+   assert(screen->num_driver_queries == LP_QUERY_RAST_TIME_THREAD0);
+
+   for (i = 0; i < num_threads; i++) {
+      char *name = names + i * LP_QUERY_NAME_SIZE;
+      util_snprintf(name, LP_QUERY_NAME_SIZE, "rast-time-thread%u", i);
+      lp_add_driver_query(screen, name,
+                          PIPE_DRIVER_QUERY_TYPE_MICROSECONDS,
+                          PIPE_DRIVER_QUERY_RESULT_TYPE_CUMULATIVE, 0);
+   }
+
+   screen->base.get_driver_query_info = llvmpipe_get_driver_query_info;
+   screen->base.get_driver_query_group_info =
+      llvmpipe_get_driver_query_group_info;
+}
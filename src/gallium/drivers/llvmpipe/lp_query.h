@@ -39,22 +39,30 @@
 
 
 struct llvmpipe_context;
+struct pipe_screen;
 
 
 struct llvmpipe_query {
-   uint64_t start[LP_MAX_THREADS];  /* start count value for each thread */
-   uint64_t end[LP_MAX_THREADS];    /* end count value for each thread */
+   uint64_t *start;                 /* start count value for each thread */
+   uint64_t *end;                   /* end count value for each thread */
+   unsigned num_threads;            /* size of the start/end arrays */
    struct lp_fence *fence;          /* fence from last scene this was binned in */
    unsigned type;                   /* PIPE_QUERY_* */
    unsigned num_primitives_generated;
    unsigned num_primitives_written;
 
    struct pipe_query_data_pipeline_statistics stats;
+
+   /* driver counter values, and divisor for averages, at begin and end */
+   uint64_t driver_start[2];
+   uint64_t driver_end[2];
 };
 
 
 extern void llvmpipe_init_query_funcs(struct llvmpipe_context * );
 
+extern void llvmpipe_init_screen_query_funcs(struct pipe_screen *);
+
 extern boolean llvmpipe_check_render_cond(struct llvmpipe_context *);
 
 #endif /* LP_QUERY_H */
@@ -33,6 +33,8 @@
 #include "util/u_pack_color.h"
 #include "util/u_string.h"
 #include "util/u_thread.h"
+#include "util/u_cpu_detect.h"
+#include "util/u_atomic.h"
 
 #include "util/os_time.h"
 
@@ -74,11 +76,14 @@ lp_rast_begin( struct lp_rasterizer *rast,
 }
 
 
+/**
+ * Finish rasterizing a scene.
+ * The scene itself is recycled by the setup code once its fence has
+ * signalled, see lp_setup_get_empty_scene().
+ */
 static void
 lp_rast_end( struct lp_rasterizer *rast )
 {
-   lp_scene_end_rasterization( rast->curr_scene );
-
    rast->curr_scene = NULL;
 }
 
@@ -108,6 +113,7 @@ lp_rast_tile_begin(struct lp_rasterizer_task *task,
 
    task->thread_data.vis_counter = 0;
    task->thread_data.ps_invocations = 0;
+   task->tile_fully_covered = FALSE;
 
    for (i = 0; i < task->scene->fb.nr_cbufs; i++) {
       if (task->scene->fb.cbufs[i]) {
@@ -299,6 +305,7 @@ lp_rast_shade_tile(struct lp_rasterizer_task *task,
    const struct lp_rast_shader_inputs *inputs = arg.shade_tile;
    const struct lp_rast_state *state;
    struct lp_fragment_shader_variant *variant;
+   int64_t shader_start;
    const unsigned tile_x = task->x, tile_y = task->y;
    unsigned x, y;
 
@@ -316,6 +323,8 @@ lp_rast_shade_tile(struct lp_rasterizer_task *task,
    }
    variant = state->variant;
 
+   task->tile_fully_covered = TRUE;
+
    /* render the whole 64x64 tile in 4x4 chunks */
    for (y = 0; y < task->height; y += 4){
       for (x = 0; x < task->width; x += 4) {
@@ -350,6 +359,7 @@ lp_rast_shade_tile(struct lp_rasterizer_task *task,
 
          /* run shader on 4x4 block */
          BEGIN_JIT_CALL(state, task);
+         shader_start = lp_rast_shader_time_begin();
          variant->jit_function[RAST_WHOLE]( &state->jit_context,
                                             tile_x + x, tile_y + y,
                                             inputs->frontfacing,
@@ -362,6 +372,7 @@ lp_rast_shade_tile(struct lp_rasterizer_task *task,
                                             &task->thread_data,
                                             stride,
                                             depth_stride);
+         lp_rast_shader_time_end(variant, shader_start);
          END_JIT_CALL();
       }
    }
@@ -402,6 +413,7 @@ lp_rast_shade_quads_mask(struct lp_rasterizer_task *task,
 {
    const struct lp_rast_state *state = task->state;
    struct lp_fragment_shader_variant *variant = state->variant;
+   int64_t shader_start;
    const struct lp_scene *scene = task->scene;
    uint8_t *color[PIPE_MAX_COLOR_BUFS];
    unsigned stride[PIPE_MAX_COLOR_BUFS];
@@ -451,6 +463,7 @@ lp_rast_shade_quads_mask(struct lp_rasterizer_task *task,
 
       /* run shader on 4x4 block */
       BEGIN_JIT_CALL(state, task);
+      shader_start = lp_rast_shader_time_begin();
       variant->jit_function[RAST_EDGE_TEST](&state->jit_context,
                                             x, y,
                                             inputs->frontfacing,
@@ -463,6 +476,7 @@ lp_rast_shade_quads_mask(struct lp_rasterizer_task *task,
                                             &task->thread_data,
                                             stride,
                                             depth_stride);
+      lp_rast_shader_time_end(variant, shader_start);
       END_JIT_CALL();
    }
 }
@@ -607,6 +621,7 @@ do_rasterize_bin(struct lp_rasterizer_task *task,
       for (k = 0; k < block->count; k++) {
          dispatch[block->cmd[k]]( task, block->arg[k] );
       }
+      task->nr_bin_commands += block->count;
    }
 }
 
@@ -628,6 +643,9 @@ rasterize_bin(struct lp_rasterizer_task *task,
 
    lp_rast_tile_end(task);
 
+   task->nr_bins++;
+   if (task->tile_fully_covered)
+      task->nr_fully_covered_bins++;
 
    /* Debug/Perf flags:
     */
@@ -654,6 +672,38 @@ is_empty_bin( const struct cmd_bin *bin )
 }
 
 
+/**
+ * Add the counts of the scene just rasterized by this thread to the
+ * driver counters.
+ */
+static void
+lp_rast_add_counters(struct lp_rasterizer_task *task, int64_t rast_time)
+{
+   struct lp_driver_counters *counters = task->rast->counters;
+
+   if (task->thread_index == 0) {
+      const struct lp_scene *scene = task->scene;
+
+      p_atomic_inc(&counters->counter[LP_COUNTER_SCENES]);
+      /* Bins without commands never make it into the bin lists, so no
+       * thread sees them.
+       */
+      p_atomic_add(&counters->counter[LP_COUNTER_EMPTY_BINS],
+                   lp_scene_get_num_bins(scene) - scene->num_active_bins);
+   }
+   p_atomic_add(&counters->rast_time[task->thread_index], rast_time);
+   p_atomic_add(&counters->counter[LP_COUNTER_BINS], task->nr_bins);
+   p_atomic_add(&counters->counter[LP_COUNTER_FULLY_COVERED_BINS],
+                task->nr_fully_covered_bins);
+   p_atomic_add(&counters->counter[LP_COUNTER_BIN_COMMANDS],
+                task->nr_bin_commands);
+
+   task->nr_bins = 0;
+   task->nr_fully_covered_bins = 0;
+   task->nr_bin_commands = 0;
+}
+
+
 /**
  * Rasterize/execute all bins within a scene.
  * Called per thread.
@@ -662,6 +712,8 @@ static void
 rasterize_scene(struct lp_rasterizer_task *task,
                 struct lp_scene *scene)
 {
+   int64_t start_time = os_time_get_nano();
+
    task->scene = scene;
 
    /* Clear the cache tags. This should not always be necessary but
@@ -682,7 +734,7 @@ rasterize_scene(struct lp_rasterizer_task *task,
          int i, j;
 
          assert(scene);
-         while ((bin = lp_scene_bin_iter_next(scene, &i, &j))) {
+         while ((bin = lp_scene_bin_iter_next(scene, task->node, &i, &j))) {
             if (!is_empty_bin( bin ))
                rasterize_bin(task, bin, i, j);
          }
@@ -704,6 +756,8 @@ rasterize_scene(struct lp_rasterizer_task *task,
    }
 #endif
 
+   lp_rast_add_counters(task, os_time_get_nano() - start_time);
+
    if (scene->fence) {
       lp_fence_signal(scene->fence);
    }
@@ -756,29 +810,12 @@ lp_rast_queue_scene( struct lp_rasterizer *rast,
 }
 
 
-void
-lp_rast_finish( struct lp_rasterizer *rast )
-{
-   if (rast->num_threads == 0) {
-      /* nothing to do */
-   }
-   else {
-      int i;
-
-      /* wait for work to complete */
-      for (i = 0; i < rast->num_threads; i++) {
-         pipe_semaphore_wait(&rast->tasks[i].work_done);
-      }
-   }
-}
-
-
 /**
  * This is the thread's main entrypoint.
  * It's a simple loop:
  *   1. wait for work
  *   2. do work
- *   3. signal that we're done
+ *   3. signal the scene's fence
  */
 static int
 thread_function(void *init_data)
@@ -837,11 +874,8 @@ thread_function(void *init_data)
          lp_rast_end( rast );
       }
 
-      /* signal done with work */
       if (debug)
          debug_printf("thread %d done working\n", task->thread_index);
-
-      pipe_semaphore_signal(&task->work_done);
    }
 
 #ifdef _WIN32
@@ -852,6 +886,111 @@ thread_function(void *init_data)
 }
 
 
+#if defined(HAVE_PTHREAD_SETAFFINITY) && defined(__linux__)
+
+/**
+ * Read the set of CPUs of each NUMA node from sysfs.
+ * \return number of nodes found, zero if the topology is unknown
+ */
+static unsigned
+get_numa_nodes(cpu_set_t *node_cpus, unsigned max_nodes)
+{
+   unsigned num_nodes = 0;
+   unsigned id;
+
+   /* Node ids may be sparse, so don't stop at the first missing one. */
+   for (id = 0; id < 4 * max_nodes && num_nodes < max_nodes; id++) {
+      cpu_set_t *cpus = &node_cpus[num_nodes];
+      unsigned first, last, cpu;
+      char path[64];
+      FILE *f;
+      int c;
+
+      util_snprintf(path, sizeof path,
+                    "/sys/devices/system/node/node%u/cpulist", id);
+      f = fopen(path, "r");
+      if (!f)
+         continue;
+
+      /* The format is a list of ranges, eg. "0-15,32-47" */
+      CPU_ZERO(cpus);
+      while (fscanf(f, "%u", &first) == 1) {
+         last = first;
+         c = fgetc(f);
+         if (c == '-') {
+            if (fscanf(f, "%u", &last) != 1)
+               break;
+            c = fgetc(f);
+         }
+         for (cpu = first; cpu <= last && cpu < CPU_SETSIZE; cpu++)
+            CPU_SET(cpu, cpus);
+         if (c != ',')
+            break;
+      }
+      fclose(f);
+
+      if (CPU_COUNT(cpus))
+         num_nodes++;
+   }
+
+   return num_nodes;
+}
+
+
+/**
+ * Pin the rasterizer threads according to LP_THREAD_AFFINITY:
+ *   "cpu"  - thread i runs on CPU i
+ *   "numa" - threads are split into contiguous groups, one per NUMA node,
+ *            and each group may run on any CPU of its node
+ * Anything else leaves scheduling to the OS.
+ */
+static void
+set_rast_thread_affinity(struct lp_rasterizer *rast)
+{
+   const char *mode = debug_get_option("LP_THREAD_AFFINITY", "none");
+   unsigned i;
+
+   if (!strcmp(mode, "cpu")) {
+      unsigned nr_cpus = MAX2(1, util_cpu_caps.nr_cpus);
+
+      for (i = 0; i < rast->num_threads; i++) {
+         cpu_set_t cpuset;
+
+         CPU_ZERO(&cpuset);
+         CPU_SET(i % nr_cpus, &cpuset);
+         pthread_setaffinity_np(rast->threads[i], sizeof cpuset, &cpuset);
+      }
+   }
+   else if (!strcmp(mode, "numa")) {
+      cpu_set_t node_cpus[LP_MAX_NUMA_NODES];
+      unsigned num_nodes = get_numa_nodes(node_cpus, LP_MAX_NUMA_NODES);
+
+      num_nodes = MIN2(num_nodes, rast->num_threads);
+      if (num_nodes <= 1)
+         return;
+
+      for (i = 0; i < rast->num_threads; i++) {
+         unsigned node = i * num_nodes / rast->num_threads;
+
+         rast->tasks[i].node = node;
+         pthread_setaffinity_np(rast->threads[i], sizeof node_cpus[node],
+                                &node_cpus[node]);
+      }
+
+      rast->num_nodes = num_nodes;
+   }
+}
+
+#else
+
+static void
+set_rast_thread_affinity(struct lp_rasterizer *rast)
+{
+}
+
+#endif
+
+
 /**
  * Initialize semaphores and spawn the threads.
  */
@@ -867,6 +1006,8 @@ create_rast_threads(struct lp_rasterizer *rast)
       rast->threads[i] = u_thread_create(thread_function,
                                             (void *) &rast->tasks[i]);
    }
+
+   set_rast_thread_affinity(rast);
 }
 
 
@@ -875,9 +1016,11 @@ create_rast_threads(struct lp_rasterizer *rast)
  * Create new lp_rasterizer.  If num_threads is zero, don't create any
  * new threads, do rendering synchronously.
  * \param num_threads  number of rasterizer threads to create
+ * \param counters  driver counters the threads add their counts to
  */
 struct lp_rasterizer *
-lp_rast_create( unsigned num_threads )
+lp_rast_create( unsigned num_threads,
+                struct lp_driver_counters *counters )
 {
    struct lp_rasterizer *rast;
    unsigned i;
@@ -892,6 +1035,14 @@ lp_rast_create( unsigned num_threads )
       goto no_full_scenes;
    }
 
+   rast->tasks = CALLOC(MAX2(1, num_threads), sizeof *rast->tasks);
+   rast->threads = CALLOC(MAX2(1, num_threads), sizeof *rast->threads);
+   if (!rast->tasks || !rast->threads) {
+      goto no_thread_data_cache;
+   }
+
+   rast->num_nodes = 1;
+
    for (i = 0; i < MAX2(1, num_threads); i++) {
       struct lp_rasterizer_task *task = &rast->tasks[i];
       task->rast = rast;
@@ -904,6 +1055,7 @@ lp_rast_create( unsigned num_threads )
    }
 
    rast->num_threads = num_threads;
+   rast->counters = counters;
 
    rast->no_rast = debug_get_bool_option("LP_NO_RAST", FALSE);
 
@@ -919,12 +1071,16 @@ lp_rast_create( unsigned num_threads )
    return rast;
 
 no_thread_data_cache:
-   for (i = 0; i < MAX2(1, rast->num_threads); i++) {
-      if (rast->tasks[i].thread_data.cache) {
-         align_free(rast->tasks[i].thread_data.cache);
+   if (rast->tasks) {
+      for (i = 0; i < MAX2(1, num_threads); i++) {
+         if (rast->tasks[i].thread_data.cache) {
+            align_free(rast->tasks[i].thread_data.cache);
+         }
       }
    }
 
+   FREE(rast->tasks);
+   FREE(rast->threads);
    lp_scene_queue_destroy(rast->full_scenes);
 no_full_scenes:
    FREE(rast);
@@ -975,7 +1131,20 @@ void lp_rast_destroy( struct lp_rasterizer *rast )
 
    lp_scene_queue_destroy(rast->full_scenes);
 
+   FREE(rast->tasks);
+   FREE(rast->threads);
    FREE(rast);
 }
 
 
+/**
+ * Number of NUMA nodes the rasterizer threads are spread over.  The
+ * setup code splits each scene's bins into this many lists.
+ */
+unsigned
+lp_rast_num_nodes( const struct lp_rasterizer *rast )
+{
+   return rast->num_nodes;
+}
+
+
@@ -156,19 +156,22 @@ struct lp_rast_clear_rb {
 
 
 
+struct lp_driver_counters;
+
 struct lp_rasterizer *
-lp_rast_create( unsigned num_threads );
+lp_rast_create( unsigned num_threads,
+                struct lp_driver_counters *counters );
 
 void
 lp_rast_destroy( struct lp_rasterizer * );
 
+unsigned
+lp_rast_num_nodes( const struct lp_rasterizer *rast );
+
 void 
 lp_rast_queue_scene( struct lp_rasterizer *rast,
                      struct lp_scene *scene );
 
-void
-lp_rast_finish( struct lp_rasterizer *rast );
-
 
 union lp_rast_cmd_arg {
    const struct lp_rast_shader_inputs *shade_tile;
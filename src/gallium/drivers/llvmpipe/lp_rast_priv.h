@@ -28,6 +28,8 @@
 #ifndef LP_RAST_PRIV_H
 #define LP_RAST_PRIV_H
 
+#include "util/os_time.h"
+#include "util/u_atomic.h"
 #include "util/u_format.h"
 #include "util/u_thread.h"
 #include "gallivm/lp_bld_debug.h"
@@ -73,6 +75,29 @@ extern const struct lp_rasterizer_task *jit_task;
 #endif
 
 
+/*
+ * With GALLIVM_DEBUG=perf, the time spent running fragment shader code is
+ * accounted to the tier of the variant's code.
+ */
+static inline int64_t
+lp_rast_shader_time_begin(void)
+{
+   return (gallivm_debug & GALLIVM_DEBUG_PERF) ? os_time_get_nano() : 0;
+}
+
+static inline void
+lp_rast_shader_time_end(struct lp_fragment_shader_variant *variant,
+                        int64_t start)
+{
+   if (gallivm_debug & GALLIVM_DEBUG_PERF) {
+      unsigned tier = p_atomic_read(&variant->tier);
+      p_atomic_inc(&variant->tier_stats.calls[tier]);
+      p_atomic_add(&variant->tier_stats.run_time[tier],
+                   os_time_get_nano() - start);
+   }
+}
+
+
 struct lp_rasterizer;
 struct cmd_bin;
 
@@ -97,9 +122,20 @@ struct lp_rasterizer_task
    /** "my" index */
    unsigned thread_index;
 
+   /** NUMA node this thread runs on, picks its bins from this list first */
+   unsigned node;
+
    /** Non-interpolated passthru state and occlude counter for visible pixels */
    struct lp_jit_thread_data thread_data;
 
+   /** Whether the current tile got a whole-tile shading command */
+   boolean tile_fully_covered;
+
+   /** Counts of the current scene, added to the driver counters at its end */
+   uint64_t nr_bins;
+   uint64_t nr_fully_covered_bins;
+   uint64_t nr_bin_commands;
+
    pipe_semaphore work_ready;
    pipe_semaphore work_done;
 };
@@ -122,13 +158,19 @@ struct lp_rasterizer
    struct lp_scene *curr_scene;
 
    /** A task object for each rasterization thread */
-   struct lp_rasterizer_task tasks[LP_MAX_THREADS];
+   struct lp_rasterizer_task *tasks;
 
    unsigned num_threads;
-   thrd_t threads[LP_MAX_THREADS];
+   thrd_t *threads;
+
+   /** Number of NUMA nodes the threads are spread over */
+   unsigned num_nodes;
 
    /** For synchronizing the rasterization threads */
    util_barrier barrier;
+
+   /** Where the threads add up their counts, owned by the screen */
+   struct lp_driver_counters *counters;
 };
 
 
@@ -228,6 +270,7 @@ lp_rast_shade_quads_all( struct lp_rasterizer_task *task,
    const struct lp_scene *scene = task->scene;
    const struct lp_rast_state *state = task->state;
    struct lp_fragment_shader_variant *variant = state->variant;
+   int64_t shader_start;
    uint8_t *color[PIPE_MAX_COLOR_BUFS];
    unsigned stride[PIPE_MAX_COLOR_BUFS];
    uint8_t *depth = NULL;
@@ -262,6 +305,7 @@ lp_rast_shade_quads_all( struct lp_rasterizer_task *task,
 
       /* run shader on 4x4 block */
       BEGIN_JIT_CALL(state, task);
+      shader_start = lp_rast_shader_time_begin();
       variant->jit_function[RAST_WHOLE]( &state->jit_context,
                                          x, y,
                                          inputs->frontfacing,
@@ -274,6 +318,7 @@ lp_rast_shade_quads_all( struct lp_rasterizer_task *task,
                                          &task->thread_data,
                                          stride,
                                          depth_stride);
+      lp_rast_shader_time_end(variant, shader_start);
       END_JIT_CALL();
    }
 }
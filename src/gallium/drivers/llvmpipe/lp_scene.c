@@ -31,9 +31,11 @@
 #include "util/u_inlines.h"
 #include "util/simple_list.h"
 #include "util/u_format.h"
+#include "util/u_atomic.h"
 #include "lp_scene.h"
 #include "lp_fence.h"
 #include "lp_debug.h"
+#include "lp_texture.h"
 
 
 #define RESOURCE_REF_SZ 32
@@ -41,6 +43,7 @@
 /** List of resource references */
 struct resource_ref {
    struct pipe_resource *resource[RESOURCE_REF_SZ];
+   uint32_t writeable;   /**< bitmask of the resources the scene writes */
    int count;
    struct resource_ref *next;
 };
@@ -62,8 +65,6 @@ lp_scene_create( struct pipe_context *pipe )
    scene->data.head =
       CALLOC_STRUCT(data_block);
 
-   (void) mtx_init(&scene->mutex, mtx_plain);
-
 #ifdef DEBUG
    /* Do some scene limit sanity checks here */
    {
@@ -90,7 +91,6 @@ void
 lp_scene_destroy(struct lp_scene *scene)
 {
    lp_fence_reference(&scene->fence, NULL);
-   mtx_destroy(&scene->mutex);
    assert(scene->data.head->next == NULL);
    FREE(scene->data.head);
    FREE(scene);
@@ -205,6 +205,7 @@ lp_scene_begin_rasterization(struct lp_scene *scene)
 
 /**
  * Free all the temporary data in a scene.
+ * Called by the setup code once the scene's fence has signalled.
  */
 void
 lp_scene_end_rasterization(struct lp_scene *scene )
@@ -369,12 +370,14 @@ lp_scene_data_size( const struct lp_scene *scene )
 
 
 /**
- * Add a reference to a resource by the scene.
+ * Add a reference to a resource by the scene.  Writeable is set for
+ * resources shaders may write to, i.e. shader buffers and images.
  */
 boolean
 lp_scene_add_resource_reference(struct lp_scene *scene,
                                 struct pipe_resource *resource,
-                                boolean initializing_scene)
+                                boolean initializing_scene,
+                                boolean writeable)
 {
    struct resource_ref *ref, **last = &scene->resources;
    int i;
@@ -386,9 +389,13 @@ lp_scene_add_resource_reference(struct lp_scene *scene,
 
       /* Search for this resource:
        */
-      for (i = 0; i < ref->count; i++)
-         if (ref->resource[i] == resource)
+      for (i = 0; i < ref->count; i++) {
+         if (ref->resource[i] == resource) {
+            if (writeable)
+               ref->writeable |= 1u << i;
             return TRUE;
+         }
+      }
 
       if (ref->count < RESOURCE_REF_SZ) {
          /* If the block is half-empty, then append the reference here.
@@ -411,6 +418,8 @@ lp_scene_add_resource_reference(struct lp_scene *scene,
 
    /* Append the reference to the reference block.
     */
+   if (writeable)
+      ref->writeable |= 1u << ref->count;
    pipe_resource_reference(&ref->resource[ref->count++], resource);
    scene->resource_reference_size += llvmpipe_resource_size(resource);
 
@@ -429,8 +438,9 @@ lp_scene_add_resource_reference(struct lp_scene *scene,
 
 /**
  * Does this scene have a reference to the given resource?
+ * Returns LP_REFERENCED_FOR_READ/WRITE flags.
  */
-boolean
+unsigned
 lp_scene_is_resource_referenced(const struct lp_scene *scene,
                                 const struct pipe_resource *resource)
 {
@@ -438,72 +448,92 @@ lp_scene_is_resource_referenced(const struct lp_scene *scene,
    int i;
 
    for (ref = scene->resources; ref; ref = ref->next) {
-      for (i = 0; i < ref->count; i++)
-         if (ref->resource[i] == resource)
-            return TRUE;
+      for (i = 0; i < ref->count; i++) {
+         if (ref->resource[i] == resource) {
+            if (ref->writeable & (1u << i))
+               return LP_REFERENCED_FOR_READ | LP_REFERENCED_FOR_WRITE;
+            return LP_REFERENCED_FOR_READ;
+         }
+      }
    }
 
-   return FALSE;
+   return LP_UNREFERENCED;
 }
 
 
-
-
-/** advance curr_x,y to the next bin */
-static boolean
-next_bin(struct lp_scene *scene)
+/**
+ * Make this scene's fence the last use of every resource it references,
+ * and the last write of those shaders may write to, for
+ * llvmpipe_flush_resource() to wait on.  Called with the screen's
+ * rast_mutex held, when the scene is queued.
+ */
+void
+lp_scene_fence_resources(struct lp_scene *scene)
 {
-   scene->curr_x++;
-   if (scene->curr_x >= scene->tiles_x) {
-      scene->curr_x = 0;
-      scene->curr_y++;
-   }
-   if (scene->curr_y >= scene->tiles_y) {
-      /* no more bins */
-      return FALSE;
+   const struct resource_ref *ref;
+   int i;
+
+   for (ref = scene->resources; ref; ref = ref->next) {
+      for (i = 0; i < ref->count; i++) {
+         struct llvmpipe_resource *lpr = llvmpipe_resource(ref->resource[i]);
+         lp_fence_reference(&lpr->last_use_fence, scene->fence);
+         if (ref->writeable & (1u << i))
+            lp_fence_reference(&lpr->last_write_fence, scene->fence);
+      }
    }
-   return TRUE;
 }
 
 
+
+
 void
 lp_scene_bin_iter_begin( struct lp_scene *scene )
 {
-   scene->curr_x = scene->curr_y = -1;
+   unsigned i;
+
+   for (i = 0; i < scene->num_bin_lists; i++)
+      scene->bin_lists[i].next = scene->bin_lists[i].start;
 }
 
 
 /**
  * Return pointer to next bin to be rendered.
- * The lp_scene::curr_x and ::curr_y fields will be advanced.
+ * Bins are claimed from the given list first and from the other lists
+ * once it runs dry.  The list cursors are advanced atomically, so no
+ * locking is needed here.
  * Multiple rendering threads will call this function to get a chunk
  * of work (a bin) to work on.
  */
 struct cmd_bin *
-lp_scene_bin_iter_next( struct lp_scene *scene , int *x, int *y)
+lp_scene_bin_iter_next( struct lp_scene *scene, unsigned list,
+                        int *x, int *y)
 {
-   struct cmd_bin *bin = NULL;
+   unsigned n;
 
-   mtx_lock(&scene->mutex);
+   for (n = 0; n < scene->num_bin_lists; n++) {
+      unsigned l = (list + n) % scene->num_bin_lists;
+      unsigned i;
+      uint32_t pos;
 
-   if (scene->curr_x < 0) {
-      /* first bin */
-      scene->curr_x = 0;
-      scene->curr_y = 0;
-   }
-   else if (!next_bin(scene)) {
-      /* no more bins left */
-      goto end;
-   }
+      /* avoid bumping the cursor of lists already exhausted */
+      if ((unsigned) p_atomic_read(&scene->bin_lists[l].next) >=
+          scene->bin_lists[l].end)
+         continue;
 
-   bin = lp_scene_get_bin(scene, scene->curr_x, scene->curr_y);
-   *x = scene->curr_x;
-   *y = scene->curr_y;
+      i = p_atomic_inc_return(&scene->bin_lists[l].next) - 1;
+      if (i >= scene->bin_lists[l].end)
+         continue;
+
+      pos = scene->bin_order[i];
+      *x = pos & 0xffff;
+      *y = pos >> 16;
+
+      /*printf("return bin at %d, %d\n", *x, *y);*/
+      return lp_scene_get_bin(scene, *x, *y);
+   }
 
-end:
-   /*printf("return bin %p at %d, %d\n", (void *) bin, *bin_x, *bin_y);*/
-   mtx_unlock(&scene->mutex);
-   return bin;
+   /* no more bins left */
+   return NULL;
 }
 
 
@@ -545,17 +575,137 @@ void lp_scene_begin_binning(struct lp_scene *scene,
       max_layer = MIN2(max_layer, zsbuf->u.tex.last_layer - zsbuf->u.tex.first_layer);
    }
    scene->fb_max_layer = max_layer;
+   scene->had_memory_writes = FALSE;
+}
+
+
+/** Gather the even bits of a Morton code */
+static inline unsigned
+morton_compact(unsigned v)
+{
+   v &= 0x55555555;
+   v = (v | (v >> 1)) & 0x33333333;
+   v = (v | (v >> 2)) & 0x0f0f0f0f;
+   v = (v | (v >> 4)) & 0x00ff00ff;
+   v = (v | (v >> 8)) & 0x0000ffff;
+   return v;
 }
 
 
-void lp_scene_end_binning( struct lp_scene *scene )
+/**
+ * Number of commands in a bin, rounded to a power of two class.
+ * Class 0 is a bin with no commands at all.
+ */
+static unsigned
+bin_weight_class(const struct cmd_bin *bin)
+{
+   const struct cmd_block *block;
+   unsigned count = 0;
+
+   for (block = bin->head; block; block = block->next)
+      count += block->count;
+
+   return count ? util_logbase2(count) + 1 : 0;
+}
+
+
+/**
+ * Build a list of bins for the rasterizer threads to work on, covering
+ * tile rows [y0, y1) and starting at bin_order[first].
+ *
+ * Empty bins are dropped.  The rest are sorted so that the most
+ * expensive bins (by command count) are handed out first, which keeps
+ * threads from being left with one long bin at the end of a scene.
+ * Within a weight class bins are in Morton order, so consecutive bins
+ * picked up by a thread tend to be close to each other on screen.
+ *
+ * \return number of bins in the list
+ */
+static unsigned
+lp_scene_sort_bins(struct lp_scene *scene, unsigned y0, unsigned y1,
+                   unsigned first)
+{
+   unsigned start[34];
+   unsigned count[33];
+   unsigned dim = util_next_power_of_two(MAX2(scene->tiles_x,
+                                              scene->tiles_y));
+   unsigned pass, code, i;
+
+   memset(count, 0, sizeof count);
+
+   /* First pass counts the bins in each weight class, second pass
+    * places them.
+    */
+   for (pass = 0; pass < 2; pass++) {
+      for (code = 0; code < dim * dim; code++) {
+         unsigned x = morton_compact(code);
+         unsigned y = morton_compact(code >> 1);
+         const struct cmd_bin *bin;
+         unsigned w;
+
+         if (x >= scene->tiles_x || y < y0 || y >= y1)
+            continue;
+
+         bin = lp_scene_get_bin(scene, x, y);
+         if (!bin->head)
+            continue;
+
+         w = bin_weight_class(bin);
+         if (pass == 0)
+            count[w]++;
+         else
+            scene->bin_order[start[w + 1]++] = (y << 16) | x;
+      }
+
+      if (pass == 0) {
+         /* Heaviest class first.  Placement is stable so Morton order
+          * is preserved within each class.
+          */
+         start[ARRAY_SIZE(count)] = first;
+         for (i = ARRAY_SIZE(count); i > 0; i--)
+            start[i - 1] = start[i] + count[i - 1];
+      }
+   }
+
+   return start[0] - first;
+}
+
+
+/**
+ * Finish binning.
+ * \param num_bin_lists  number of lists to split the bins into, one per
+ *                       NUMA node the rasterizer threads run on.  Each
+ *                       list covers a fixed band of tile rows, so a given
+ *                       tile is normally rasterized on the same node
+ *                       from scene to scene.
+ */
+void lp_scene_end_binning( struct lp_scene *scene, unsigned num_bin_lists )
 {
+   unsigned i;
+
+   num_bin_lists = CLAMP(num_bin_lists, 1, LP_MAX_NUMA_NODES);
+
+   scene->num_active_bins = 0;
+   for (i = 0; i < num_bin_lists; i++) {
+      unsigned y0 = i * scene->tiles_y / num_bin_lists;
+      unsigned y1 = (i + 1) * scene->tiles_y / num_bin_lists;
+
+      scene->bin_lists[i].start = scene->num_active_bins;
+      scene->num_active_bins += lp_scene_sort_bins(scene, y0, y1,
+                                                   scene->num_active_bins);
+      scene->bin_lists[i].end = scene->num_active_bins;
+   }
+   scene->num_bin_lists = num_bin_lists;
+
    if (LP_DEBUG & DEBUG_SCENE) {
       debug_printf("rasterize scene:\n");
       debug_printf("  scene_size: %u\n",
                    scene->scene_size);
       debug_printf("  data size: %u\n",
                    lp_scene_data_size(scene));
+      debug_printf("  active bins: %u of %u\n",
+                   scene->num_active_bins,
+                   lp_scene_get_num_bins(scene));
 
       if (0)
          lp_debug_bins( scene );
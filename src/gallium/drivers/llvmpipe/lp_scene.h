@@ -134,6 +134,8 @@ struct lp_scene {
    unsigned num_active_queries;
    /* If queries were either active or there were begin/end query commands */
    boolean had_queries;
+   /* If any fragment shader of the scene writes to buffers or images */
+   boolean had_memory_writes;
 
    /* Framebuffer mappings - valid only between begin_rasterization()
     * and end_rasterization().
@@ -172,8 +174,22 @@ struct lp_scene {
     */
    unsigned tiles_x, tiles_y;
 
-   int curr_x, curr_y;  /**< for iterating over bins */
-   mtx_t mutex;
+   /**
+    * Non-empty bins in the order the rasterizer threads should pick them
+    * up, encoded as (y << 16) | x.  Built by lp_scene_end_binning().
+    */
+   uint32_t bin_order[TILES_X * TILES_Y];
+   unsigned num_active_bins;
+
+   /**
+    * bin_order is split into one list per NUMA node, each covering a
+    * band of tile rows.  Threads drain their own node's list first.
+    */
+   struct {
+      unsigned start, end;  /**< range within bin_order */
+      int next;             /**< for iterating over bins, updated atomically */
+   } bin_lists[LP_MAX_NUMA_NODES];
+   unsigned num_bin_lists;
 
    struct cmd_bin tile[TILES_X][TILES_Y];
    struct data_block_list data;
@@ -196,11 +212,14 @@ struct cmd_block *lp_scene_new_cmd_block( struct lp_scene *scene,
 
 boolean lp_scene_add_resource_reference(struct lp_scene *scene,
                                         struct pipe_resource *resource,
-                                        boolean initializing_scene);
+                                        boolean initializing_scene,
+                                        boolean writeable);
 
-boolean lp_scene_is_resource_referenced(const struct lp_scene *scene,
+unsigned lp_scene_is_resource_referenced(const struct lp_scene *scene,
                                         const struct pipe_resource *resource );
 
+void lp_scene_fence_resources(struct lp_scene *scene);
+
 
 /**
  * Allocate space for a command/data in the bin's data buffer.
@@ -381,7 +400,8 @@ void
 lp_scene_bin_iter_begin( struct lp_scene *scene );
 
 struct cmd_bin *
-lp_scene_bin_iter_next( struct lp_scene *scene, int *x, int *y );
+lp_scene_bin_iter_next( struct lp_scene *scene, unsigned list,
+                        int *x, int *y );
 
 
 
@@ -392,7 +412,7 @@ lp_scene_begin_binning(struct lp_scene *scene,
                        struct pipe_framebuffer_state *fb);
 
 void
-lp_scene_end_binning(struct lp_scene *scene);
+lp_scene_end_binning(struct lp_scene *scene, unsigned num_bin_lists);
 
 
 /* Begin/end rasterization of a scene
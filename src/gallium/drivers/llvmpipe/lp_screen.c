@@ -33,10 +33,16 @@
 #include "util/u_screen.h"
 #include "util/u_string.h"
 #include "util/u_format_s3tc.h"
+#include "util/u_atomic.h"
+#include "util/disk_cache.h"
+#include "util/mesa-sha1.h"
 #include "pipe/p_defines.h"
 #include "pipe/p_screen.h"
 #include "draw/draw_context.h"
 #include "gallivm/lp_bld_type.h"
+#include "gallivm/lp_bld_init.h"
+#include "gallivm/lp_bld_debug.h"
+#include <llvm-c/ExecutionEngine.h>
 
 #include "os/os_misc.h"
 #include "util/os_time.h"
@@ -48,7 +54,9 @@
 #include "lp_debug.h"
 #include "lp_public.h"
 #include "lp_limits.h"
+#include "lp_query.h"
 #include "lp_rast.h"
+#include "lp_state_cs.h"
 
 #include "state_tracker/sw_winsys.h"
 
@@ -68,6 +76,7 @@ static const struct debug_named_value lp_debug_flags[] = {
    { "fence", DEBUG_FENCE, NULL },
    { "mem", DEBUG_MEM, NULL },
    { "fs", DEBUG_FS, NULL },
+   { "cache_stats", DEBUG_CACHE_STATS, NULL },
    DEBUG_NAMED_VALUE_END
 };
 #endif
@@ -82,9 +91,13 @@ static const struct debug_named_value lp_perf_flags[] = {
    { "no_blend",       PERF_NO_BLEND, NULL },
    { "no_depth",       PERF_NO_DEPTH, NULL },
    { "no_alphatest",   PERF_NO_ALPHATEST, NULL },
+   { "no_tiled_tex",   PERF_NO_TILED_TEX, NULL },
    DEBUG_NAMED_VALUE_END
 };
 
+/** Vector width in bits of the fragment shader, see LP_FS_VECTOR_WIDTH */
+unsigned lp_fs_vector_width = 0;
+
 
 static const char *
 llvmpipe_get_vendor(struct pipe_screen *screen)
@@ -214,7 +227,7 @@ llvmpipe_get_param(struct pipe_screen *screen, enum pipe_cap param)
    case PIPE_CAP_QUADS_FOLLOW_PROVOKING_VERTEX_CONVENTION:
       return 0;
    case PIPE_CAP_COMPUTE:
-      return 0;
+      return LP_HAVE_COMPUTE;
    case PIPE_CAP_USER_VERTEX_BUFFERS:
       return 1;
    case PIPE_CAP_VERTEX_BUFFER_OFFSET_4BYTE_ALIGNED_ONLY:
@@ -324,7 +337,6 @@ llvmpipe_get_param(struct pipe_screen *screen, enum pipe_cap param)
    case PIPE_CAP_MULTI_DRAW_INDIRECT_PARAMS:
    case PIPE_CAP_TGSI_FS_POSITION_IS_SYSVAL:
    case PIPE_CAP_TGSI_FS_FACE_IS_INTEGER_SYSVAL:
-   case PIPE_CAP_SHADER_BUFFER_OFFSET_ALIGNMENT:
    case PIPE_CAP_INVALIDATE_BUFFER:
    case PIPE_CAP_GENERATE_MIPMAP:
    case PIPE_CAP_STRING_MARKER:
@@ -381,6 +393,8 @@ llvmpipe_get_param(struct pipe_screen *screen, enum pipe_cap param)
       return 32;
    case PIPE_CAP_MAX_SHADER_BUFFER_SIZE:
       return 1 << 27;
+   case PIPE_CAP_SHADER_BUFFER_OFFSET_ALIGNMENT:
+      return 16;
 
    default:
       return u_pipe_screen_get_param_defaults(screen, param);
@@ -396,6 +410,10 @@ llvmpipe_get_shader_param(struct pipe_screen *screen,
    {
    case PIPE_SHADER_FRAGMENT:
       switch (param) {
+      case PIPE_SHADER_CAP_MAX_SHADER_BUFFERS:
+         return LP_MAX_TGSI_SHADER_BUFFERS;
+      case PIPE_SHADER_CAP_MAX_SHADER_IMAGES:
+         return LP_MAX_TGSI_SHADER_IMAGES;
       default:
          return gallivm_get_shader_param(param);
       }
@@ -419,11 +437,78 @@ llvmpipe_get_shader_param(struct pipe_screen *screen,
       default:
          return draw_get_shader_param(shader, param);
       }
+   case PIPE_SHADER_COMPUTE:
+      if (!LP_HAVE_COMPUTE)
+         return 0;
+      switch (param) {
+      case PIPE_SHADER_CAP_MAX_INPUTS:
+      case PIPE_SHADER_CAP_MAX_OUTPUTS:
+         return 0;
+      case PIPE_SHADER_CAP_MAX_SHADER_BUFFERS:
+         return LP_MAX_TGSI_SHADER_BUFFERS;
+      case PIPE_SHADER_CAP_MAX_SHADER_IMAGES:
+         return LP_MAX_TGSI_SHADER_IMAGES;
+      default:
+         return gallivm_get_shader_param(param);
+      }
    default:
       return 0;
    }
 }
 
+static int
+llvmpipe_get_compute_param(struct pipe_screen *_screen,
+                           enum pipe_shader_ir ir_type,
+                           enum pipe_compute_cap param,
+                           void *ret)
+{
+   switch (param) {
+   case PIPE_COMPUTE_CAP_IR_TARGET:
+      return 0;
+   case PIPE_COMPUTE_CAP_MAX_GRID_SIZE:
+      if (ret) {
+         uint64_t *grid_size = ret;
+         grid_size[0] = 65535;
+         grid_size[1] = 65535;
+         grid_size[2] = 65535;
+      }
+      return 3 * sizeof(uint64_t);
+   case PIPE_COMPUTE_CAP_MAX_BLOCK_SIZE:
+      if (ret) {
+         uint64_t *block_size = ret;
+         block_size[0] = 1024;
+         block_size[1] = 1024;
+         block_size[2] = 1024;
+      }
+      return 3 * sizeof(uint64_t);
+   case PIPE_COMPUTE_CAP_MAX_THREADS_PER_BLOCK:
+      if (ret) {
+         uint64_t *max_threads_per_block = ret;
+         *max_threads_per_block = 1024;
+      }
+      return sizeof(uint64_t);
+   case PIPE_COMPUTE_CAP_MAX_LOCAL_SIZE:
+      if (ret) {
+         uint64_t *max_local_size = ret;
+         *max_local_size = 32768;
+      }
+      return sizeof(uint64_t);
+   case PIPE_COMPUTE_CAP_GRID_DIMENSION:
+   case PIPE_COMPUTE_CAP_MAX_GLOBAL_SIZE:
+   case PIPE_COMPUTE_CAP_MAX_PRIVATE_SIZE:
+   case PIPE_COMPUTE_CAP_MAX_INPUT_SIZE:
+   case PIPE_COMPUTE_CAP_MAX_MEM_ALLOC_SIZE:
+   case PIPE_COMPUTE_CAP_MAX_CLOCK_FREQUENCY:
+   case PIPE_COMPUTE_CAP_MAX_COMPUTE_UNITS:
+   case PIPE_COMPUTE_CAP_IMAGES_SUPPORTED:
+   case PIPE_COMPUTE_CAP_SUBGROUP_SIZE:
+   case PIPE_COMPUTE_CAP_ADDRESS_BITS:
+   case PIPE_COMPUTE_CAP_MAX_VARIABLE_THREADS_PER_BLOCK:
+      break;
+   }
+   return 0;
+}
+
 static float
 llvmpipe_get_paramf(struct pipe_screen *screen, enum pipe_capf param)
 {
@@ -552,10 +637,6 @@ llvmpipe_is_format_supported( struct pipe_screen *_screen,
       return FALSE;
    }
 
-   if (format_desc->layout == UTIL_FORMAT_LAYOUT_ETC &&
-       format != PIPE_FORMAT_ETC1_RGB8)
-      return FALSE;
-
    /*
     * Everything can be supported by u_format
     * (those without fetch_rgba_float might be not but shouldn't hit that)
@@ -577,6 +658,19 @@ llvmpipe_flush_frontbuffer(struct pipe_screen *_screen,
    struct llvmpipe_screen *screen = llvmpipe_screen(_screen);
    struct sw_winsys *winsys = screen->winsys;
    struct llvmpipe_resource *texture = llvmpipe_resource(resource);
+   struct lp_fence *fence = NULL;
+
+   /* Scenes are rasterized asynchronously, so the last one drawing to the
+    * display target may still be running.  The state trackers present
+    * without a fence, so wait for it here.
+    */
+   mtx_lock(&screen->rast_mutex);
+   lp_fence_reference(&fence, texture->last_write_fence);
+   mtx_unlock(&screen->rast_mutex);
+   if (fence) {
+      lp_fence_wait(fence);
+      lp_fence_reference(&fence, NULL);
+   }
 
    assert(texture->dt);
    if (texture->dt)
@@ -592,8 +686,22 @@ llvmpipe_destroy_screen( struct pipe_screen *_screen )
    if (screen->rast)
       lp_rast_destroy(screen->rast);
 
+   if (util_queue_is_initialized(&screen->compile_queue))
+      util_queue_destroy(&screen->compile_queue);
+
+   if (util_queue_is_initialized(&screen->cs_queue))
+      util_queue_destroy(&screen->cs_queue);
+
+   if (LP_DEBUG & DEBUG_CACHE_STATS)
+      debug_printf("llvmpipe: disk shader cache %u hits, %u misses\n",
+                   screen->num_disk_shader_cache_hits,
+                   screen->num_disk_shader_cache_misses);
+   disk_cache_destroy(screen->disk_shader_cache);
+
    lp_jit_screen_cleanup(screen);
 
+   FREE(screen->driver_queries);
+
    if(winsys->destroy)
       winsys->destroy(winsys);
 
@@ -644,6 +752,99 @@ llvmpipe_get_timestamp(struct pipe_screen *_screen)
    return os_time_get_nano();
 }
 
+static void
+lp_disk_cache_create(struct llvmpipe_screen *screen)
+{
+   struct util_cpu_caps cpu_caps = util_cpu_caps;
+   struct mesa_sha1 ctx;
+   unsigned char sha1[20];
+   char timestamp_str[41];
+   uint32_t mesa_timestamp, llvm_timestamp;
+   unsigned llvm_version = HAVE_LLVM;
+   uint64_t driver_flags;
+
+   if (!disk_cache_get_function_timestamp(lp_disk_cache_create,
+                                          &mesa_timestamp) ||
+       !disk_cache_get_function_timestamp(LLVMLinkInMCJIT,
+                                          &llvm_timestamp))
+      return;
+
+   /*
+    * The generated code depends on the host CPU features and vector width,
+    * but not on the number of cores, so leave those out of the key.
+    */
+   cpu_caps.nr_cpus = 0;
+   cpu_caps.cores_per_L3 = 0;
+
+   _mesa_sha1_init(&ctx);
+   _mesa_sha1_update(&ctx, &mesa_timestamp, sizeof mesa_timestamp);
+   _mesa_sha1_update(&ctx, &llvm_timestamp, sizeof llvm_timestamp);
+   _mesa_sha1_update(&ctx, &llvm_version, sizeof llvm_version);
+   _mesa_sha1_update(&ctx, &cpu_caps, sizeof cpu_caps);
+   _mesa_sha1_update(&ctx, &lp_native_vector_width,
+                     sizeof lp_native_vector_width);
+   _mesa_sha1_update(&ctx, &lp_fs_vector_width,
+                     sizeof lp_fs_vector_width);
+   _mesa_sha1_final(&ctx, sha1);
+   _mesa_sha1_format(timestamp_str, sha1);
+
+   /* These flags affect shader compilation. */
+   driver_flags = (uint64_t)(unsigned)LP_PERF |
+                  (uint64_t)gallivm_debug << 32;
+
+   screen->disk_shader_cache = disk_cache_create("llvmpipe", timestamp_str,
+                                                 driver_flags);
+}
+
+
+/**
+ * Look up the machine code of a shader variant in the disk cache.
+ * On a hit, cache->data is malloc'ed and owned by the caller.
+ */
+void
+lp_disk_cache_find_shader(void *cookie,
+                          struct lp_cached_code *cache,
+                          unsigned char ir_sha1_cache_key[20])
+{
+   struct llvmpipe_screen *screen = cookie;
+   cache_key sha1;
+
+   if (!screen->disk_shader_cache)
+      return;
+
+   disk_cache_compute_key(screen->disk_shader_cache, ir_sha1_cache_key,
+                          20, sha1);
+
+   cache->data = disk_cache_get(screen->disk_shader_cache, sha1,
+                                &cache->data_size);
+   if (cache->data)
+      p_atomic_inc(&screen->num_disk_shader_cache_hits);
+   else
+      p_atomic_inc(&screen->num_disk_shader_cache_misses);
+}
+
+
+/**
+ * Store the machine code of a freshly compiled shader variant.
+ */
+void
+lp_disk_cache_insert_shader(void *cookie,
+                            struct lp_cached_code *cache,
+                            unsigned char ir_sha1_cache_key[20])
+{
+   struct llvmpipe_screen *screen = cookie;
+   cache_key sha1;
+
+   if (!screen->disk_shader_cache || !cache->data_size || cache->dont_cache)
+      return;
+
+   disk_cache_compute_key(screen->disk_shader_cache, ir_sha1_cache_key,
+                          20, sha1);
+   disk_cache_put(screen->disk_shader_cache, sha1, cache->data,
+                  cache->data_size, NULL);
+}
+
+
 /**
  * Create a new pipe_screen object
  * Note: we're not presently subclassing pipe_screen (no llvmpipe_screen).
@@ -652,6 +853,7 @@ struct pipe_screen *
 llvmpipe_create_screen(struct sw_winsys *winsys)
 {
    struct llvmpipe_screen *screen;
+   unsigned num_compile_threads;
 
    util_cpu_detect();
 
@@ -670,6 +872,25 @@ llvmpipe_create_screen(struct sw_winsys *winsys)
       return NULL;
    }
 
+   /*
+    * Shading a whole 4x4 block as one 16-wide vector must be asked for,
+    * and only pays off with AVX-512.
+    */
+   lp_fs_vector_width = MIN2(lp_native_vector_width, 256);
+   lp_fs_vector_width = debug_get_num_option("LP_FS_VECTOR_WIDTH",
+                                             lp_fs_vector_width);
+   if (lp_fs_vector_width != 128 &&
+       lp_fs_vector_width != 256 &&
+       lp_fs_vector_width != 512)
+      lp_fs_vector_width = MIN2(lp_native_vector_width, 256);
+
+   /* Only the 16-wide fragment shaders use 512-bit vectors.  Otherwise
+    * keep LLVM from using AVX-512 at all, which would only lower the clock
+    * of some CPUs.
+    */
+   if (lp_fs_vector_width != 512)
+      util_cpu_caps.has_avx512f = 0;
+
    screen->winsys = winsys;
 
    screen->base.destroy = llvmpipe_destroy_screen;
@@ -679,6 +900,7 @@ llvmpipe_create_screen(struct sw_winsys *winsys)
    screen->base.get_device_vendor = llvmpipe_get_vendor; // TODO should be the CPU vendor
    screen->base.get_param = llvmpipe_get_param;
    screen->base.get_shader_param = llvmpipe_get_shader_param;
+   screen->base.get_compute_param = llvmpipe_get_compute_param;
    screen->base.get_paramf = llvmpipe_get_paramf;
    screen->base.is_format_supported = llvmpipe_is_format_supported;
 
@@ -698,7 +920,7 @@ llvmpipe_create_screen(struct sw_winsys *winsys)
    screen->num_threads = debug_get_num_option("LP_NUM_THREADS", screen->num_threads);
    screen->num_threads = MIN2(screen->num_threads, LP_MAX_THREADS);
 
-   screen->rast = lp_rast_create(screen->num_threads);
+   screen->rast = lp_rast_create(screen->num_threads, &screen->counters);
    if (!screen->rast) {
       lp_jit_screen_cleanup(screen);
       FREE(screen);
@@ -706,5 +928,26 @@ llvmpipe_create_screen(struct sw_winsys *winsys)
    }
    (void) mtx_init(&screen->rast_mutex, mtx_plain);
 
+   /* The driver queries include one per rasterizer thread */
+   llvmpipe_init_screen_query_funcs(&screen->base);
+
+   num_compile_threads = debug_get_num_option("LP_NUM_COMPILE_THREADS", 0);
+   num_compile_threads = MIN2(num_compile_threads, LP_MAX_THREADS);
+   if (num_compile_threads)
+      util_queue_init(&screen->compile_queue, "lpcompile", 64,
+                      num_compile_threads,
+                      UTIL_QUEUE_INIT_RESIZE_IF_FULL |
+                      UTIL_QUEUE_INIT_USE_MINIMUM_PRIORITY);
+
+#if LP_HAVE_COMPUTE
+   /* The thread launching a grid runs work groups too */
+   if (screen->num_threads > 1)
+      util_queue_init(&screen->cs_queue, "lpcs", screen->num_threads,
+                      screen->num_threads - 1,
+                      UTIL_QUEUE_INIT_RESIZE_IF_FULL);
+#endif
+
+   lp_disk_cache_create(screen);
+
    return &screen->base;
 }
@@ -37,10 +37,14 @@
 #include "pipe/p_screen.h"
 #include "pipe/p_defines.h"
 #include "os/os_thread.h"
+#include "util/u_queue.h"
 #include "gallivm/lp_bld.h"
+#include "lp_perf.h"
 
 
 struct sw_winsys;
+struct disk_cache;
+struct lp_cached_code;
 
 
 struct llvmpipe_screen
@@ -57,9 +61,41 @@ struct llvmpipe_screen
 
    struct lp_rasterizer *rast;
    mtx_t rast_mutex;
+
+   /** Persistent cache of JIT-compiled shader variants, may be NULL */
+   struct disk_cache *disk_shader_cache;
+   unsigned num_disk_shader_cache_hits;
+   unsigned num_disk_shader_cache_misses;
+
+   /** Background compilation of optimized fragment shader variants,
+    * only initialized with LP_NUM_COMPILE_THREADS > 0
+    */
+   struct util_queue compile_queue;
+
+   /** Threads running compute work groups, besides the launching one */
+   struct util_queue cs_queue;
+
+   /** Exposed as driver queries, see lp_query.c */
+   struct lp_driver_counters counters;
+   struct pipe_driver_query_info *driver_queries;
+   unsigned num_driver_queries;
 };
 
 
+extern unsigned lp_fs_vector_width;
+
+
+void
+lp_disk_cache_find_shader(void *cookie,
+                          struct lp_cached_code *cache,
+                          unsigned char ir_sha1_cache_key[20]);
+
+void
+lp_disk_cache_insert_shader(void *cookie,
+                            struct lp_cached_code *cache,
+                            unsigned char ir_sha1_cache_key[20]);
+
+
 
 
 static inline struct llvmpipe_screen *
@@ -55,8 +55,15 @@ struct lp_setup_variant;
 
 
 /** Max number of scenes */
-/* XXX: make multiple scenes per context work, see lp_setup_rasterize_scene */
-#define MAX_SCENES 1
+#define MAX_SCENES 4
+
+/**
+ * Default number of scenes per context.  With more than one scene the
+ * setup code can bin the next scene while the rasterizer threads are
+ * still busy with the previous one.  Can be overridden with the
+ * LP_NUM_SCENES env var.
+ */
+#define LP_DEFAULT_SCENES 2
 
 
 
@@ -87,6 +94,7 @@ struct lp_setup_context
     */
    struct draw_stage *vbuf;
    unsigned num_threads;
+   unsigned num_scenes;
    unsigned scene_idx;
    struct lp_scene *scenes[MAX_SCENES];  /**< all the scenes */
    struct lp_scene *scene;               /**< current scene being built */
@@ -134,6 +142,8 @@ struct lp_setup_context
       struct lp_rast_state current;  /**< currently set state */
       struct pipe_resource *current_tex[PIPE_MAX_SHADER_SAMPLER_VIEWS];
       unsigned current_tex_num;
+      struct pipe_resource *current_ssbos[LP_MAX_TGSI_SHADER_BUFFERS];
+      struct pipe_resource *current_images[LP_MAX_TGSI_SHADER_IMAGES];
    } fs;
 
    /** fragment shader constants */
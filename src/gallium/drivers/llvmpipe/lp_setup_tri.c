@@ -233,8 +233,11 @@ lp_setup_whole_tile(struct lp_setup_context *setup,
        * were just active we also can't do the optimization since to get
        * accurate query results we unfortunately need to execute the rendering
        * commands.
+       * - Shaders writing to buffers or images have side effects beyond the
+       * tile which must not be dropped.
        */
-      if (!scene->fb.zsbuf && scene->fb_max_layer == 0 && !scene->had_queries) {
+      if (!scene->fb.zsbuf && scene->fb_max_layer == 0 && !scene->had_queries &&
+          !scene->had_memory_writes) {
          /*
           * All previous rendering will be overwritten so reset the bin.
           */
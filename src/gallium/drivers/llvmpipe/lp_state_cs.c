@@ -0,0 +1,933 @@
+/**************************************************************************
+ *
+ * Copyright 2019 The Mesa Authors
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL
+ * THE COPYRIGHT HOLDERS, AUTHORS AND/OR ITS SUPPLIERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+ * USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ **************************************************************************/
+
+/**
+ * @file
+ * Compute shaders.
+ *
+ * The TGSI is translated with the regular SoA code generator, one call of
+ * the generated function runs one SIMD group (as many invocations as there
+ * are vector lanes) of a work group.  Launches are synchronous: work groups
+ * are handed out to the compute threads of the screen through an atomic
+ * counter, with the calling thread taking part.
+ *
+ * All SIMD groups of a work group run on the same thread.  If the shader
+ * has barriers each SIMD group gets its own stack, and a barrier switches
+ * back to the scheduler which resumes the next SIMD group; a barrier is
+ * crossed once every SIMD group has reached it.
+ *
+ * Like fragment shaders, the code depends on the sampler and image state,
+ * so variants are compiled when a grid is launched with new state.
+ */
+
+#include "pipe/p_defines.h"
+#include "pipe/p_shader_tokens.h"
+#include "util/u_atomic.h"
+#include "util/u_inlines.h"
+#include "util/u_math.h"
+#include "util/u_memory.h"
+#include "util/u_pointer.h"
+#include "util/u_string.h"
+#include "tgsi/tgsi_dump.h"
+#include "tgsi/tgsi_parse.h"
+#include "draw/draw_context.h"
+#include "gallivm/lp_bld_const.h"
+#include "gallivm/lp_bld_debug.h"
+#include "gallivm/lp_bld_flow.h"
+#include "gallivm/lp_bld_format.h"
+#include "gallivm/lp_bld_init.h"
+#include "gallivm/lp_bld_intr.h"
+#include "gallivm/lp_bld_logic.h"
+#include "gallivm/lp_bld_struct.h"
+#include "gallivm/lp_bld_tgsi.h"
+#include "gallivm/lp_bld_type.h"
+#include "lp_context.h"
+#include "lp_debug.h"
+#include "lp_flush.h"
+#include "lp_screen.h"
+#include "lp_state_cs.h"
+#include "lp_tex_sample.h"
+#include "lp_texture.h"
+
+#if LP_HAVE_COMPUTE
+
+#include <ucontext.h>
+
+
+/** Stack size of each SIMD group of shaders using barriers */
+#define LP_CS_STACK_SIZE (64 * 1024)
+
+/**
+ * Max number of variants of a compute shader.  Unlike fragment shaders,
+ * there are no per-draw state changes, so the state rarely changes between
+ * launches of the same shader.
+ */
+#define LP_MAX_CS_VARIANTS 32
+
+
+static unsigned cs_no = 0;
+
+/**
+ * Out-of-bounds accesses are clamped to the first element rather than
+ * skipped, so unbound slots must point at valid memory.
+ */
+static uint32_t fake_buf[4];
+
+
+struct lp_cs_fiber
+{
+   ucontext_t context;
+   void *stack;
+   boolean done;
+};
+
+
+/** State shared by all threads taking part in one launch */
+struct lp_cs_launch
+{
+   struct lp_compute_shader *shader;
+   struct lp_compute_shader_variant *variant;
+   struct lp_jit_cs_context jit_context;
+
+   uint32_t grid_size[3];
+   uint32_t block_size[3];
+
+   unsigned num_groups;
+   unsigned num_simd_groups;   /**< per work group */
+
+   unsigned next_group;        /**< atomically incremented */
+};
+
+
+/** Per-thread state of a launch */
+struct lp_cs_exec
+{
+   struct lp_cs_launch *launch;
+   struct lp_jit_cs_thread_data thread_data;
+   struct util_queue_fence fence;
+
+   uint32_t block_id[3];
+
+   /* Only used for shaders with barriers */
+   ucontext_t main_context;
+   struct lp_cs_fiber *fibers;
+   unsigned current;
+};
+
+
+/**
+ * Buffers and images are fetched like for fragment shaders, shared memory
+ * and barriers are specific to compute shaders.
+ */
+struct lp_cs_iface
+{
+   struct lp_llvm_mem_iface base;
+
+   LLVMValueRef thread_data_ptr;
+};
+
+
+static void
+cs_iface_fetch_shared(const struct lp_build_tgsi_mem_iface *mem_iface,
+                      struct lp_build_tgsi_context *bld_base,
+                      LLVMValueRef *base_ptr,
+                      LLVMValueRef *size)
+{
+   const struct lp_cs_iface *iface = (const struct lp_cs_iface *)mem_iface;
+   struct gallivm_state *gallivm = bld_base->base.gallivm;
+
+   *base_ptr = lp_jit_cs_thread_data_shared(gallivm, iface->thread_data_ptr);
+   *size = lp_jit_cs_context_shared_size(gallivm, iface->base.context_ptr);
+}
+
+
+static void
+cs_iface_emit_barrier(const struct lp_build_tgsi_mem_iface *mem_iface,
+                      struct lp_build_tgsi_context *bld_base)
+{
+   const struct lp_cs_iface *iface = (const struct lp_cs_iface *)mem_iface;
+   struct gallivm_state *gallivm = bld_base->base.gallivm;
+   LLVMTypeRef arg_type = LLVMTypeOf(iface->thread_data_ptr);
+   LLVMValueRef function;
+   LLVMValueRef args[1];
+
+   function = lp_build_const_func_pointer(gallivm,
+                                          func_to_pointer((func_pointer)lp_cs_barrier),
+                                          LLVMVoidTypeInContext(gallivm->context),
+                                          &arg_type, 1, "lp_cs_barrier");
+   args[0] = iface->thread_data_ptr;
+   LLVMBuildCall(gallivm->builder, function, args, ARRAY_SIZE(args), "");
+}
+
+
+/**
+ * Generate the code of a compute shader variant.
+ */
+static LLVMValueRef
+generate_compute(struct lp_compute_shader *shader,
+                 struct lp_compute_shader_variant *variant)
+{
+   struct gallivm_state *gallivm = variant->gallivm;
+   const struct lp_compute_shader_variant_key *key = &variant->key;
+   LLVMTypeRef int32_type = LLVMInt32TypeInContext(gallivm->context);
+   LLVMTypeRef arg_types[12];
+   LLVMTypeRef func_type;
+   LLVMValueRef function;
+   LLVMValueRef context_ptr;
+   LLVMValueRef thread_data_ptr;
+   LLVMValueRef block_id[3], grid_size[3], block_size[3];
+   LLVMValueRef first_invocation;
+   LLVMValueRef consts_ptr, num_consts_ptr;
+   LLVMValueRef invocation, num_invocations, tmp, mask_val;
+   LLVMValueRef lanes[LP_MAX_VECTOR_LENGTH];
+   LLVMValueRef outputs[PIPE_MAX_SHADER_OUTPUTS][TGSI_NUM_CHANNELS];
+   LLVMBasicBlockRef block;
+   LLVMBuilderRef builder;
+   struct lp_build_context uint_bld;
+   struct lp_build_mask_context mask;
+   struct lp_bld_tgsi_system_values system_values;
+   struct lp_build_sampler_soa *sampler;
+   struct lp_cs_iface iface;
+   struct lp_type cs_type;
+   unsigned i;
+
+   memset(&cs_type, 0, sizeof cs_type);
+   cs_type.floating = TRUE;      /* floating point values */
+   cs_type.sign = TRUE;          /* values are signed */
+   cs_type.norm = FALSE;         /* values are not limited to [0,1] or [-1,1] */
+   cs_type.width = 32;           /* 32-bit float */
+   cs_type.length = shader->vector_length;
+
+   /*
+    * Generate the function prototype. Any change here must be reflected in
+    * lp_jit.h's lp_jit_cs_func function pointer type, and vice-versa.
+    */
+   arg_types[0] = variant->jit_context_ptr_type;       /* context */
+   for (i = 1; i < 11; i++)
+      arg_types[i] = int32_type;                       /* ids and sizes */
+   arg_types[11] = variant->jit_thread_data_ptr_type;  /* per thread data */
+
+   func_type = LLVMFunctionType(LLVMVoidTypeInContext(gallivm->context),
+                                arg_types, ARRAY_SIZE(arg_types), 0);
+
+   function = LLVMAddFunction(gallivm->module, "cs_variant", func_type);
+   LLVMSetFunctionCallConv(function, LLVMCCallConv);
+
+   for (i = 0; i < ARRAY_SIZE(arg_types); ++i)
+      if (LLVMGetTypeKind(arg_types[i]) == LLVMPointerTypeKind)
+         lp_add_function_attr(function, i + 1, LP_FUNC_ATTR_NOALIAS);
+
+   context_ptr = LLVMGetParam(function, 0);
+   for (i = 0; i < 3; i++) {
+      block_id[i] = LLVMGetParam(function, 1 + i);
+      grid_size[i] = LLVMGetParam(function, 4 + i);
+      block_size[i] = LLVMGetParam(function, 7 + i);
+   }
+   first_invocation = LLVMGetParam(function, 10);
+   thread_data_ptr = LLVMGetParam(function, 11);
+
+   lp_build_name(context_ptr, "context");
+   lp_build_name(first_invocation, "first_invocation");
+   lp_build_name(thread_data_ptr, "thread_data");
+
+   block = LLVMAppendBasicBlockInContext(gallivm->context, function, "entry");
+   builder = gallivm->builder;
+   assert(builder);
+   LLVMPositionBuilderAtEnd(builder, block);
+
+   lp_build_context_init(&uint_bld, gallivm, lp_uint_type(cs_type));
+
+   /*
+    * Split the linear invocation index of each lane into the
+    * block-relative x, y and z ids.
+    */
+   for (i = 0; i < cs_type.length; i++)
+      lanes[i] = lp_build_const_int32(gallivm, i);
+   invocation = lp_build_broadcast_scalar(&uint_bld, first_invocation);
+   invocation = LLVMBuildAdd(builder, invocation,
+                             LLVMConstVector(lanes, cs_type.length), "");
+
+   tmp = lp_build_broadcast_scalar(&uint_bld, block_size[0]);
+   system_values.thread_id[0] = LLVMBuildURem(builder, invocation, tmp, "");
+   tmp = LLVMBuildUDiv(builder, invocation, tmp, "");
+   system_values.thread_id[1] =
+      LLVMBuildURem(builder, tmp,
+                    lp_build_broadcast_scalar(&uint_bld, block_size[1]), "");
+   system_values.thread_id[2] =
+      LLVMBuildUDiv(builder, tmp,
+                    lp_build_broadcast_scalar(&uint_bld, block_size[1]), "");
+
+   /* The last SIMD group of a work group may be partially filled */
+   num_invocations = LLVMBuildMul(builder, block_size[0], block_size[1], "");
+   num_invocations = LLVMBuildMul(builder, num_invocations, block_size[2], "");
+   mask_val = lp_build_compare(gallivm, uint_bld.type, PIPE_FUNC_LESS,
+                               invocation,
+                               lp_build_broadcast_scalar(&uint_bld,
+                                                         num_invocations));
+   lp_build_mask_begin(&mask, gallivm, cs_type, mask_val);
+
+   for (i = 0; i < 3; i++) {
+      system_values.block_id[i] = block_id[i];
+      system_values.grid_size[i] = grid_size[i];
+      system_values.block_size[i] = block_size[i];
+   }
+   system_values.instance_id = NULL;
+   system_values.vertex_id = NULL;
+   system_values.vertex_id_nobase = NULL;
+   system_values.prim_id = NULL;
+   system_values.basevertex = NULL;
+   system_values.invocation_id = NULL;
+
+   lp_llvm_mem_iface_init(&iface.base, context_ptr, key->image_format);
+   iface.base.base.fetch_shared = cs_iface_fetch_shared;
+   iface.base.base.emit_barrier = cs_iface_emit_barrier;
+   iface.thread_data_ptr = thread_data_ptr;
+
+   sampler = lp_llvm_sampler_soa_create(key->state);
+
+   consts_ptr = lp_jit_cs_context_constants(gallivm, context_ptr);
+   num_consts_ptr = lp_jit_cs_context_num_constants(gallivm, context_ptr);
+
+   memset(outputs, 0, sizeof outputs);
+
+   lp_build_tgsi_soa(gallivm, shader->tokens, cs_type, &mask,
+                     consts_ptr, num_consts_ptr, &system_values,
+                     NULL, outputs, context_ptr, thread_data_ptr,
+                     sampler, &shader->info, NULL, &iface.base.base);
+
+   sampler->destroy(sampler);
+
+   lp_build_mask_end(&mask);
+
+   LLVMBuildRetVoid(builder);
+
+   gallivm_verify_function(gallivm, function);
+
+   return function;
+}
+
+
+static struct lp_compute_shader_variant *
+generate_variant(struct llvmpipe_context *llvmpipe,
+                 struct lp_compute_shader *shader,
+                 const struct lp_compute_shader_variant_key *key)
+{
+   struct lp_compute_shader_variant *variant;
+   LLVMValueRef function;
+   char module_name[64];
+
+   variant = CALLOC_STRUCT(lp_compute_shader_variant);
+   if (!variant)
+      return NULL;
+
+   variant->no = shader->variants_created++;
+   memcpy(&variant->key, key, shader->variant_key_size);
+
+   util_snprintf(module_name, sizeof(module_name), "cs%u_variant%u",
+                 shader->no, variant->no);
+
+   variant->gallivm = gallivm_create(module_name, llvmpipe->context, NULL);
+   if (!variant->gallivm) {
+      FREE(variant);
+      return NULL;
+   }
+
+   lp_jit_init_cs_types(variant);
+
+   function = generate_compute(shader, variant);
+
+   gallivm_compile_module(variant->gallivm);
+
+   variant->jit_function = (lp_jit_cs_func)
+      gallivm_jit_function(variant->gallivm, function);
+
+   gallivm_free_ir(variant->gallivm);
+
+   return variant;
+}
+
+
+static void
+delete_variant(struct lp_compute_shader_variant *variant)
+{
+   /* Launches are synchronous, so the code can't be in use anymore */
+   gallivm_destroy(variant->gallivm);
+   FREE(variant);
+}
+
+
+static void *
+llvmpipe_create_compute_state(struct pipe_context *pipe,
+                              const struct pipe_compute_state *templ)
+{
+   struct lp_compute_shader *shader;
+   int nr_samplers, nr_sampler_views;
+
+   if (templ->ir_type != PIPE_SHADER_IR_TGSI)
+      return NULL;
+
+   shader = CALLOC_STRUCT(lp_compute_shader);
+   if (!shader)
+      return NULL;
+
+   shader->no = cs_no++;
+   shader->tokens = tgsi_dup_tokens(templ->prog);
+   if (!shader->tokens) {
+      FREE(shader);
+      return NULL;
+   }
+
+   tgsi_scan_shader(shader->tokens, &shader->info);
+
+   shader->req_local_mem = templ->req_local_mem;
+   shader->has_barrier = shader->info.opcode_count[TGSI_OPCODE_BARRIER] > 0;
+   shader->vector_length = MIN2(lp_native_vector_width / 32, 16);
+
+   nr_samplers = shader->info.file_max[TGSI_FILE_SAMPLER] + 1;
+   nr_sampler_views = shader->info.file_max[TGSI_FILE_SAMPLER_VIEW] + 1;
+   shader->variant_key_size = Offset(struct lp_compute_shader_variant_key,
+                                     state[MAX2(nr_samplers, nr_sampler_views)]);
+
+   if (LP_DEBUG & DEBUG_TGSI) {
+      debug_printf("llvmpipe: Create compute shader #%u %p:\n",
+                   shader->no, (void *)shader);
+      tgsi_dump(shader->tokens, 0);
+   }
+
+   return shader;
+}
+
+
+static void
+llvmpipe_bind_compute_state(struct pipe_context *pipe, void *cs)
+{
+   struct llvmpipe_context *llvmpipe = llvmpipe_context(pipe);
+
+   llvmpipe->cs = (struct lp_compute_shader *)cs;
+}
+
+
+static void
+llvmpipe_delete_compute_state(struct pipe_context *pipe, void *cs)
+{
+   struct lp_compute_shader *shader = (struct lp_compute_shader *)cs;
+   struct lp_compute_shader_variant *variant, *next;
+
+   for (variant = shader->variants; variant; variant = next) {
+      next = variant->next;
+      delete_variant(variant);
+   }
+
+   FREE((void *)shader->tokens);
+   FREE(shader);
+}
+
+
+/**
+ * Like the fragment shader's make_variant_key().
+ */
+static void
+make_variant_key(struct llvmpipe_context *lp,
+                 struct lp_compute_shader *shader,
+                 struct lp_compute_shader_variant_key *key)
+{
+   const struct tgsi_shader_info *info = &shader->info;
+   unsigned i;
+
+   memset(key, 0, shader->variant_key_size);
+
+   for (i = 0; i < info->file_max[TGSI_FILE_IMAGE] + 1; i++) {
+      const struct pipe_image_view *image =
+         &lp->images[PIPE_SHADER_COMPUTE][i];
+
+      key->image_format[i] = image->resource ? image->format
+                                             : PIPE_FORMAT_NONE;
+   }
+
+   key->nr_samplers = info->file_max[TGSI_FILE_SAMPLER] + 1;
+
+   for (i = 0; i < key->nr_samplers; ++i) {
+      if (info->file_mask[TGSI_FILE_SAMPLER] & (1 << i)) {
+         lp_sampler_static_sampler_state(&key->state[i].sampler_state,
+                                         lp->samplers[PIPE_SHADER_COMPUTE][i]);
+      }
+   }
+
+   /* Compute shaders always use the dx10-style texture opcodes */
+   key->nr_sampler_views = info->file_max[TGSI_FILE_SAMPLER_VIEW] + 1;
+   for (i = 0; i < key->nr_sampler_views; ++i) {
+      if (info->file_mask[TGSI_FILE_SAMPLER_VIEW] & (1u << (i & 31))) {
+         const struct pipe_sampler_view *view =
+            lp->sampler_views[PIPE_SHADER_COMPUTE][i];
+
+         lp_sampler_static_texture_state(&key->state[i].texture_state, view);
+         key->state[i].texture_state.tiled =
+            llvmpipe_sampler_view_is_tiled(view);
+      }
+   }
+}
+
+
+/**
+ * Find the variant of the shader for the current state, compiling it if
+ * needed.
+ */
+static struct lp_compute_shader_variant *
+update_cs_variant(struct llvmpipe_context *llvmpipe,
+                  struct lp_compute_shader *shader)
+{
+   struct lp_compute_shader_variant_key key;
+   struct lp_compute_shader_variant *variant, **prev;
+
+   make_variant_key(llvmpipe, shader, &key);
+
+   for (prev = &shader->variants; *prev; prev = &(*prev)->next) {
+      variant = *prev;
+      if (memcmp(&variant->key, &key, shader->variant_key_size) == 0) {
+         /* move to the front */
+         *prev = variant->next;
+         variant->next = shader->variants;
+         shader->variants = variant;
+         return variant;
+      }
+   }
+
+   if (shader->variants_cached >= LP_MAX_CS_VARIANTS) {
+      /* evict the least recently used variant */
+      for (prev = &shader->variants; (*prev)->next; prev = &(*prev)->next)
+         ;
+      delete_variant(*prev);
+      *prev = NULL;
+      shader->variants_cached--;
+   }
+
+   variant = generate_variant(llvmpipe, shader, &key);
+   if (!variant)
+      return NULL;
+
+   variant->next = shader->variants;
+   shader->variants = variant;
+   shader->variants_cached++;
+
+   return variant;
+}
+
+
+/**
+ * Fill in the jit context, waiting for any pending rendering which
+ * references the bound resources.
+ */
+static void
+update_cs_jit_context(struct llvmpipe_context *llvmpipe,
+                      struct lp_cs_launch *launch)
+{
+   struct pipe_context *pipe = &llvmpipe->pipe;
+   struct lp_jit_cs_context *jit_context = &launch->jit_context;
+   unsigned i;
+
+   for (i = 0; i < LP_MAX_TGSI_CONST_BUFFERS; i++) {
+      const struct pipe_constant_buffer *cb =
+         &llvmpipe->constants[PIPE_SHADER_COMPUTE][i];
+      const ubyte *data = NULL;
+
+      if (cb->buffer) {
+         llvmpipe_flush_resource(pipe, cb->buffer, 0, TRUE, TRUE, FALSE,
+                                 "launch_grid");
+         data = (const ubyte *)llvmpipe_resource_data(cb->buffer);
+      }
+      else if (cb->user_buffer) {
+         data = (const ubyte *)cb->user_buffer;
+      }
+
+      if (data) {
+         jit_context->constants[i] =
+            (const float *)(data + cb->buffer_offset);
+         jit_context->num_constants[i] =
+            MIN2(cb->buffer_size, LP_MAX_TGSI_CONST_BUFFER_SIZE) /
+            (sizeof(float) * 4);
+      }
+      else {
+         jit_context->constants[i] = (const float *)fake_buf;
+         jit_context->num_constants[i] = 0;
+      }
+   }
+
+   for (i = 0; i < llvmpipe->num_sampler_views[PIPE_SHADER_COMPUTE]; i++) {
+      struct pipe_sampler_view *view =
+         llvmpipe->sampler_views[PIPE_SHADER_COMPUTE][i];
+
+      if (view) {
+         llvmpipe_flush_resource(pipe, view->texture, 0, TRUE, TRUE, FALSE,
+                                 "launch_grid");
+         lp_jit_texture_from_pipe(&jit_context->textures[i], view);
+      }
+   }
+
+   for (i = 0; i < llvmpipe->num_samplers[PIPE_SHADER_COMPUTE]; i++) {
+      const struct pipe_sampler_state *sampler =
+         llvmpipe->samplers[PIPE_SHADER_COMPUTE][i];
+
+      if (sampler)
+         lp_jit_sampler_from_pipe(&jit_context->samplers[i], sampler);
+   }
+
+   for (i = 0; i < LP_MAX_TGSI_SHADER_IMAGES; i++) {
+      const struct pipe_image_view *image =
+         &llvmpipe->images[PIPE_SHADER_COMPUTE][i];
+
+      /* unbound images are never accessed, see make_variant_key() */
+      if (image->resource) {
+         llvmpipe_flush_resource(pipe, image->resource, 0, FALSE, TRUE, FALSE,
+                                 "launch_grid");
+         lp_jit_image_from_pipe(&jit_context->images[i], image);
+      }
+   }
+
+   for (i = 0; i < LP_MAX_TGSI_SHADER_BUFFERS; i++) {
+      const struct pipe_shader_buffer *sb =
+         &llvmpipe->ssbos[PIPE_SHADER_COMPUTE][i];
+
+      if (sb->buffer) {
+         llvmpipe_flush_resource(pipe, sb->buffer, 0, FALSE, TRUE, FALSE,
+                                 "launch_grid");
+         jit_context->ssbos[i] = (uint32_t *)
+            ((ubyte *)llvmpipe_resource_data(sb->buffer) + sb->buffer_offset);
+         jit_context->num_ssbo_bytes[i] = sb->buffer_size;
+      }
+      else {
+         jit_context->ssbos[i] = fake_buf;
+         jit_context->num_ssbo_bytes[i] = 0;
+      }
+   }
+
+   jit_context->shared_size = launch->shader->req_local_mem;
+}
+
+
+static inline void
+run_simd_group(struct lp_cs_exec *exec, unsigned first_invocation)
+{
+   const struct lp_cs_launch *launch = exec->launch;
+
+   launch->variant->jit_function(&launch->jit_context,
+                                exec->block_id[0],
+                                exec->block_id[1],
+                                exec->block_id[2],
+                                launch->grid_size[0],
+                                launch->grid_size[1],
+                                launch->grid_size[2],
+                                launch->block_size[0],
+                                launch->block_size[1],
+                                launch->block_size[2],
+                                first_invocation,
+                                &exec->thread_data);
+}
+
+
+/**
+ * makecontext() only passes int arguments, so the pointer is split.
+ */
+static void
+fiber_entry(int exec_lo, int exec_hi)
+{
+   struct lp_cs_exec *exec = (struct lp_cs_exec *)(uintptr_t)
+      (((uint64_t)(uint32_t)exec_hi << 32) | (uint32_t)exec_lo);
+   unsigned current = exec->current;
+
+   run_simd_group(exec, current * exec->launch->shader->vector_length);
+
+   /* Returning resumes the scheduler through uc_link */
+   exec->fibers[current].done = TRUE;
+}
+
+
+void
+lp_cs_barrier(struct lp_jit_cs_thread_data *thread_data)
+{
+   struct lp_cs_exec *exec = thread_data->exec;
+
+   /* A single SIMD group per work group needs no switching */
+   if (exec->fibers)
+      swapcontext(&exec->fibers[exec->current].context, &exec->main_context);
+}
+
+
+static void
+run_work_group(struct lp_cs_exec *exec)
+{
+   const unsigned num_simd_groups = exec->launch->num_simd_groups;
+   const unsigned vector_length = exec->launch->shader->vector_length;
+   uint64_t exec_ptr = (uintptr_t)exec;
+   unsigned remaining;
+   unsigned i;
+
+   if (!exec->fibers) {
+      for (i = 0; i < num_simd_groups; i++)
+         run_simd_group(exec, i * vector_length);
+      return;
+   }
+
+   for (i = 0; i < num_simd_groups; i++) {
+      struct lp_cs_fiber *fiber = &exec->fibers[i];
+
+      getcontext(&fiber->context);
+      fiber->context.uc_stack.ss_sp = fiber->stack;
+      fiber->context.uc_stack.ss_size = LP_CS_STACK_SIZE;
+      fiber->context.uc_link = &exec->main_context;
+      makecontext(&fiber->context, (void (*)(void))fiber_entry, 2,
+                  (int)(uint32_t)exec_ptr, (int)(uint32_t)(exec_ptr >> 32));
+      fiber->done = FALSE;
+   }
+
+   /*
+    * Resume each SIMD group in turn until it either finishes or reaches the
+    * next barrier.
+    */
+   do {
+      remaining = 0;
+      for (i = 0; i < num_simd_groups; i++) {
+         if (!exec->fibers[i].done) {
+            exec->current = i;
+            swapcontext(&exec->main_context, &exec->fibers[i].context);
+            if (!exec->fibers[i].done)
+               remaining++;
+         }
+      }
+   } while (remaining);
+}
+
+
+/**
+ * Run work groups until there are none left.
+ */
+static void
+cs_exec_work_groups(void *data, int thread_index)
+{
+   struct lp_cs_exec *exec = (struct lp_cs_exec *)data;
+   struct lp_cs_launch *launch = exec->launch;
+   unsigned fpstate = util_fpstate_get();
+   unsigned group;
+
+   /* Same floating point state as the rasterizer threads */
+   util_fpstate_set_denorms_to_zero(fpstate);
+
+   while ((group = p_atomic_inc_return(&launch->next_group) - 1) <
+          launch->num_groups) {
+      exec->block_id[0] = group % launch->grid_size[0];
+      group /= launch->grid_size[0];
+      exec->block_id[1] = group % launch->grid_size[1];
+      exec->block_id[2] = group / launch->grid_size[1];
+
+      run_work_group(exec);
+   }
+
+   util_fpstate_set(fpstate);
+}
+
+
+static void
+cs_exec_fini(struct lp_cs_exec *exec)
+{
+   unsigned i;
+
+   if (exec->fibers) {
+      for (i = 0; i < exec->launch->num_simd_groups; i++)
+         FREE(exec->fibers[i].stack);
+      FREE(exec->fibers);
+   }
+   align_free(exec->thread_data.shared);
+   align_free(exec->thread_data.cache);
+}
+
+
+static boolean
+cs_exec_init(struct lp_cs_exec *exec, struct lp_cs_launch *launch)
+{
+   unsigned i;
+
+   exec->launch = launch;
+   exec->thread_data.exec = exec;
+
+   /* Always valid memory, see struct lp_build_tgsi_mem_iface */
+   exec->thread_data.shared =
+      align_malloc(MAX2(launch->shader->req_local_mem, 16), 16);
+   if (!exec->thread_data.shared)
+      return FALSE;
+
+   if (LP_USE_TEXTURE_CACHE &&
+       launch->shader->info.file_count[TGSI_FILE_SAMPLER_VIEW]) {
+      exec->thread_data.cache =
+         align_malloc(sizeof(struct lp_build_format_cache), 16);
+      if (!exec->thread_data.cache)
+         goto fail;
+      memset(exec->thread_data.cache->cache_tags, 0,
+             sizeof(exec->thread_data.cache->cache_tags));
+   }
+
+   if (launch->shader->has_barrier && launch->num_simd_groups > 1) {
+      exec->fibers = CALLOC(launch->num_simd_groups, sizeof *exec->fibers);
+      if (!exec->fibers)
+         goto fail;
+
+      for (i = 0; i < launch->num_simd_groups; i++) {
+         exec->fibers[i].stack = MALLOC(LP_CS_STACK_SIZE);
+         if (!exec->fibers[i].stack)
+            goto fail;
+      }
+   }
+
+   return TRUE;
+
+fail:
+   cs_exec_fini(exec);
+   return FALSE;
+}
+
+
+static void
+fill_grid_size(struct pipe_context *pipe,
+               const struct pipe_grid_info *info,
+               uint32_t grid_size[3])
+{
+   struct pipe_transfer *transfer;
+   uint32_t *params;
+
+   if (!info->indirect) {
+      grid_size[0] = info->grid[0];
+      grid_size[1] = info->grid[1];
+      grid_size[2] = info->grid[2];
+      return;
+   }
+
+   params = pipe_buffer_map_range(pipe, info->indirect,
+                                  info->indirect_offset,
+                                  3 * sizeof(uint32_t),
+                                  PIPE_TRANSFER_READ,
+                                  &transfer);
+   if (!transfer) {
+      grid_size[0] = grid_size[1] = grid_size[2] = 0;
+      return;
+   }
+
+   grid_size[0] = params[0];
+   grid_size[1] = params[1];
+   grid_size[2] = params[2];
+   pipe_buffer_unmap(pipe, transfer);
+}
+
+
+static void
+llvmpipe_launch_grid(struct pipe_context *pipe,
+                     const struct pipe_grid_info *info)
+{
+   struct llvmpipe_context *llvmpipe = llvmpipe_context(pipe);
+   struct llvmpipe_screen *screen = llvmpipe_screen(pipe->screen);
+   struct lp_compute_shader *shader = llvmpipe->cs;
+   struct lp_cs_launch launch;
+   struct lp_cs_exec *execs;
+   unsigned num_invocations;
+   unsigned num_execs;
+   unsigned i;
+
+   if (!shader)
+      return;
+
+   memset(&launch, 0, sizeof launch);
+   launch.shader = shader;
+
+   fill_grid_size(pipe, info, launch.grid_size);
+   launch.num_groups = launch.grid_size[0] *
+                       launch.grid_size[1] *
+                       launch.grid_size[2];
+
+   launch.block_size[0] = info->block[0];
+   launch.block_size[1] = info->block[1];
+   launch.block_size[2] = info->block[2];
+   num_invocations = launch.block_size[0] *
+                     launch.block_size[1] *
+                     launch.block_size[2];
+
+   if (!launch.num_groups || !num_invocations)
+      return;
+
+   launch.num_simd_groups = DIV_ROUND_UP(num_invocations,
+                                         shader->vector_length);
+
+   launch.variant = update_cs_variant(llvmpipe, shader);
+   if (!launch.variant)
+      return;
+
+   /* Vertices still queued in the draw module may reference the resources */
+   draw_flush(llvmpipe->draw);
+
+   update_cs_jit_context(llvmpipe, &launch);
+
+   num_execs = 1;
+   if (util_queue_is_initialized(&screen->cs_queue))
+      num_execs = MIN2(launch.num_groups, screen->cs_queue.num_threads + 1);
+
+   execs = CALLOC(num_execs, sizeof *execs);
+   if (!execs)
+      return;
+
+   for (i = 0; i < num_execs; i++) {
+      if (!cs_exec_init(&execs[i], &launch))
+         break;
+      util_queue_fence_init(&execs[i].fence);
+   }
+   num_execs = i;
+
+   for (i = 1; i < num_execs; i++) {
+      util_queue_add_job(&screen->cs_queue, &execs[i], &execs[i].fence,
+                         cs_exec_work_groups, NULL);
+   }
+
+   if (num_execs)
+      cs_exec_work_groups(&execs[0], 0);
+
+   for (i = 0; i < num_execs; i++) {
+      util_queue_fence_wait(&execs[i].fence);
+      util_queue_fence_destroy(&execs[i].fence);
+      cs_exec_fini(&execs[i]);
+   }
+
+   FREE(execs);
+}
+
+#endif /* LP_HAVE_COMPUTE */
+
+
+void
+llvmpipe_init_compute_funcs(struct llvmpipe_context *llvmpipe)
+{
+#if LP_HAVE_COMPUTE
+   llvmpipe->pipe.create_compute_state = llvmpipe_create_compute_state;
+   llvmpipe->pipe.bind_compute_state = llvmpipe_bind_compute_state;
+   llvmpipe->pipe.delete_compute_state = llvmpipe_delete_compute_state;
+   llvmpipe->pipe.launch_grid = llvmpipe_launch_grid;
+#endif
+}
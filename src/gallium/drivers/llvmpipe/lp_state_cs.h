@@ -0,0 +1,118 @@
+/**************************************************************************
+ *
+ * Copyright 2019 The Mesa Authors
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL
+ * THE COPYRIGHT HOLDERS, AUTHORS AND/OR ITS SUPPLIERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+ * USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ **************************************************************************/
+
+
+#ifndef LP_STATE_CS_H_
+#define LP_STATE_CS_H_
+
+#include "pipe/p_compiler.h"
+#include "pipe/p_config.h"
+#include "pipe/p_state.h"
+#include "tgsi/tgsi_scan.h" /* for tgsi_shader_info */
+#include "gallivm/lp_bld.h"
+#include "lp_jit.h"
+#include "lp_state_fs.h" /* for lp_sampler_static_state */
+
+
+struct llvmpipe_context;
+
+
+/**
+ * Work group barriers suspend the SIMD group hitting them and switch to the
+ * next one, which needs a stack per SIMD group.  This is done with the
+ * ucontext functions, so compute shaders are only exposed where they exist.
+ */
+#if defined(PIPE_OS_LINUX) && defined(__GLIBC__) && HAVE_LLVM >= 0x0309
+#define LP_HAVE_COMPUTE 1
+#else
+#define LP_HAVE_COMPUTE 0
+#endif
+
+
+struct lp_compute_shader_variant_key
+{
+   unsigned nr_samplers:8;      /* actually derivable from just the shader */
+   unsigned nr_sampler_views:8; /* actually derivable from just the shader */
+
+   /** formats of the bound images, PIPE_FORMAT_NONE if unbound */
+   uint16_t image_format[LP_MAX_TGSI_SHADER_IMAGES];
+
+   struct lp_sampler_static_state state[PIPE_MAX_SHADER_SAMPLER_VIEWS];
+};
+
+
+struct lp_compute_shader_variant
+{
+   struct lp_compute_shader_variant_key key;
+
+   struct gallivm_state *gallivm;
+   LLVMTypeRef jit_context_ptr_type;
+   LLVMTypeRef jit_thread_data_ptr_type;
+   lp_jit_cs_func jit_function;
+
+   /** next variant, in most recently used order */
+   struct lp_compute_shader_variant *next;
+
+   /* For debugging/profiling purposes */
+   unsigned no;
+};
+
+
+struct lp_compute_shader
+{
+   const struct tgsi_token *tokens;
+   struct tgsi_shader_info info;
+
+   /** Size of the shared memory of each work group in bytes */
+   unsigned req_local_mem;
+
+   boolean has_barrier;
+
+   /** Number of invocations run by one call of the jit function */
+   unsigned vector_length;
+
+   /** Variants of the shader, most recently used first */
+   struct lp_compute_shader_variant *variants;
+   unsigned variants_cached;
+   unsigned variants_created;
+
+   /** Size of the used part of struct lp_compute_shader_variant_key */
+   unsigned variant_key_size;
+
+   /* For debugging/profiling purposes */
+   unsigned no;
+};
+
+
+void
+llvmpipe_init_compute_funcs(struct llvmpipe_context *llvmpipe);
+
+void
+lp_cs_barrier(struct lp_jit_cs_thread_data *thread_data);
+
+
+#endif /* LP_STATE_CS_H_ */
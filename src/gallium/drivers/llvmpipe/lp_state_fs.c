@@ -68,6 +68,9 @@
 #include "util/simple_list.h"
 #include "util/u_dual_blend.h"
 #include "util/os_time.h"
+#include "util/mesa-sha1.h"
+#include "util/u_atomic.h"
+#include "util/u_queue.h"
 #include "pipe/p_shader_tokens.h"
 #include "draw/draw_context.h"
 #include "tgsi/tgsi_dump.h"
@@ -102,6 +105,7 @@
 #include "lp_flush.h"
 #include "lp_state_fs.h"
 #include "lp_rast.h"
+#include "lp_screen.h"
 
 
 /** Fragment shader number (for debugging) */
@@ -336,6 +340,7 @@ generate_fs_loop(struct gallivm_state *gallivm,
    unsigned depth_mode;
 
    struct lp_bld_tgsi_system_values system_values;
+   struct lp_llvm_mem_iface mem_iface;
 
    memset(&system_values, 0, sizeof(system_values));
 
@@ -370,6 +375,16 @@ generate_fs_loop(struct gallivm_state *gallivm,
          depth_mode = LATE_DEPTH_TEST | LATE_DEPTH_WRITE;
       }
 
+      /*
+       * Stores and atomics of fragments failing the tests must still happen
+       * unless the shader asks for early fragment tests, in which case the
+       * tests must be done before the shader even if it would kill fragments.
+       */
+      if (shader->info.base.properties[TGSI_PROPERTY_FS_EARLY_DEPTH_STENCIL])
+         depth_mode = EARLY_DEPTH_TEST | EARLY_DEPTH_WRITE;
+      else if (shader->info.base.writes_memory)
+         depth_mode = LATE_DEPTH_TEST | LATE_DEPTH_WRITE;
+
       if (!(key->depth.enabled && key->depth.writemask) &&
           !(key->stencil[0].enabled && (key->stencil[0].writemask ||
                                         (key->stencil[1].enabled &&
@@ -475,11 +490,12 @@ generate_fs_loop(struct gallivm_state *gallivm,
    lp_build_interp_soa_update_inputs_dyn(interp, gallivm, loop_state.counter);
 
    /* Build the actual shader */
+   lp_llvm_mem_iface_init(&mem_iface, context_ptr, key->image_format);
    lp_build_tgsi_soa(gallivm, tokens, type, &mask,
                      consts_ptr, num_consts_ptr, &system_values,
                      interp->inputs,
                      outputs, context_ptr, thread_data_ptr,
-                     sampler, &shader->info.base, NULL);
+                     sampler, &shader->info.base, NULL, &mem_iface.base);
 
    /* Alpha test */
    if (key->alpha.enabled) {
@@ -2397,8 +2413,7 @@ generate_unswizzled_blend(struct gallivm_state *gallivm,
  * 2x2 pixels.
  */
 static void
-generate_fragment(struct llvmpipe_context *lp,
-                  struct lp_fragment_shader *shader,
+generate_fragment(struct lp_fragment_shader *shader,
                   struct lp_fragment_shader_variant *variant,
                   unsigned partial_mask)
 {
@@ -2434,7 +2449,9 @@ generate_fragment(struct llvmpipe_context *lp,
    LLVMValueRef fs_out_color[PIPE_MAX_COLOR_BUFS][TGSI_NUM_CHANNELS][16 / 4];
    LLVMValueRef function;
    LLVMValueRef facing;
+   struct lp_type blend_fs_type;
    unsigned num_fs;
+   unsigned blend_num_fs;
    unsigned i;
    unsigned chan;
    unsigned cbuf;
@@ -2442,7 +2459,7 @@ generate_fragment(struct llvmpipe_context *lp,
    const boolean dual_source_blend = key->blend.rt[0].blend_enable &&
                                      util_blend_state_is_dual(&key->blend, 0);
 
-   assert(lp_native_vector_width / 32 >= 4);
+   assert(lp_fs_vector_width / 32 >= 4);
 
    /* Adjust color input interpolation according to flatshade state:
     */
@@ -2468,7 +2485,10 @@ generate_fragment(struct llvmpipe_context *lp,
    fs_type.sign = TRUE;          /* values are signed */
    fs_type.norm = FALSE;         /* values are not limited to [0,1] or [-1,1] */
    fs_type.width = 32;           /* 32-bit float */
-   fs_type.length = MIN2(lp_native_vector_width / 32, 16); /* n*4 elements per vector */
+   fs_type.length = lp_fs_vector_width / 32; /* n*4 elements per vector */
+   /* 1d resources only use the upper half of the stamp */
+   if (key->resource_1d)
+      fs_type.length = MIN2(fs_type.length, 8);
 
    memset(&blend_type, 0, sizeof blend_type);
    blend_type.floating = FALSE; /* values are integers */
@@ -2486,8 +2506,13 @@ generate_fragment(struct llvmpipe_context *lp,
 
    blend_vec_type = lp_build_vec_type(gallivm, blend_type);
 
-   util_snprintf(func_name, sizeof(func_name), "fs%u_variant%u_%s",
-                 shader->no, variant->no, partial_mask ? "partial" : "whole");
+   /*
+    * Every variant lives in its own module, so the function names need not
+    * be unique.  Keeping them fixed lets the machine code be reused from the
+    * disk cache by a later variant with the same key.
+    */
+   util_snprintf(func_name, sizeof(func_name), "fs_variant_%s",
+                 partial_mask ? "partial" : "whole");
 
    arg_types[0] = variant->jit_context_ptr_type;       /* context */
    arg_types[1] = int32_type;                          /* x */
@@ -2636,7 +2661,38 @@ generate_fragment(struct llvmpipe_context *lp,
                        facing,
                        thread_data_ptr);
 
-      for (i = 0; i < num_fs; i++) {
+      /*
+       * Blending works on at most 8-wide vectors.  A 16-wide result is
+       * handed over as two 8-wide halves, quads 0,1 and quads 2,3, which
+       * is just a reinterpretation of the stored vectors.
+       */
+      blend_fs_type = fs_type;
+      blend_fs_type.length = MIN2(fs_type.length, 8);
+      blend_num_fs = num_fs * fs_type.length / blend_fs_type.length;
+
+      if (blend_fs_type.length != fs_type.length) {
+         LLVMTypeRef color_ptr_type =
+            LLVMPointerType(lp_build_vec_type(gallivm, blend_fs_type), 0);
+
+         mask_store = LLVMBuildBitCast(builder, mask_store,
+            LLVMPointerType(lp_build_int_vec_type(gallivm, blend_fs_type), 0), "");
+         for (cbuf = 0; cbuf < key->nr_cbufs; cbuf++) {
+            for (chan = 0; chan < TGSI_NUM_CHANNELS; ++chan) {
+               color_store[cbuf][chan] =
+                  LLVMBuildBitCast(builder, color_store[cbuf][chan],
+                                   color_ptr_type, "");
+            }
+         }
+         if (dual_source_blend) {
+            for (chan = 0; chan < TGSI_NUM_CHANNELS; ++chan) {
+               color_store[1][chan] =
+                  LLVMBuildBitCast(builder, color_store[1][chan],
+                                   color_ptr_type, "");
+            }
+         }
+      }
+
+      for (i = 0; i < blend_num_fs; i++) {
          LLVMValueRef indexi = lp_build_const_int32(gallivm, i);
          LLVMValueRef ptr = LLVMBuildGEP(builder, mask_store,
                                          &indexi, 1, "");
@@ -2690,7 +2746,8 @@ generate_fragment(struct llvmpipe_context *lp,
 
          generate_unswizzled_blend(gallivm, cbuf, variant,
                                    key->cbuf_format[cbuf],
-                                   num_fs, fs_type, fs_mask, fs_out_color,
+                                   blend_num_fs, blend_fs_type,
+                                   fs_mask, fs_out_color,
                                    context_ptr, color_ptr, stride,
                                    partial_mask, do_branch);
       }
@@ -2807,19 +2864,184 @@ lp_debug_fs_variant(const struct lp_fragment_shader_variant *variant)
 }
 
 
+/**
+ * Compute the disk cache key of a fragment shader variant: the generated
+ * code is fully determined by the shader tokens and the variant key.
+ */
+static void
+lp_fs_get_ir_cache_key(const struct lp_fragment_shader *shader,
+                       const struct lp_fragment_shader_variant_key *key,
+                       unsigned char ir_sha1_cache_key[20])
+{
+   struct mesa_sha1 ctx;
+
+   _mesa_sha1_init(&ctx);
+   _mesa_sha1_update(&ctx, "fs", 2);
+   _mesa_sha1_update(&ctx, shader->base.tokens,
+                     tgsi_num_tokens(shader->base.tokens) *
+                     sizeof(struct tgsi_token));
+   _mesa_sha1_update(&ctx, key, shader->variant_key_size);
+   _mesa_sha1_final(&ctx, ir_sha1_cache_key);
+}
+
+
+/**
+ * Build the IR for a fragment shader variant in variant->gallivm, compile
+ * it and return the entry points in jit_function.  Counted in the screen's
+ * driver counters.
+ * \return  the time it took, in nanoseconds
+ */
+static int64_t
+generate_variant_code(struct llvmpipe_screen *screen,
+                      struct lp_fragment_shader *shader,
+                      struct lp_fragment_shader_variant *variant,
+                      lp_jit_frag_func jit_function[2])
+{
+   int64_t start_time = os_time_get_nano();
+   int64_t compile_time;
+
+   variant->function[RAST_EDGE_TEST] = NULL;
+   variant->function[RAST_WHOLE] = NULL;
+
+   lp_jit_init_types(variant);
+
+   generate_fragment(shader, variant, RAST_EDGE_TEST);
+
+   if (variant->opaque) {
+      /* Specialized shader, which doesn't need to read the color buffer. */
+      generate_fragment(shader, variant, RAST_WHOLE);
+   }
+
+   /*
+    * Compile everything
+    */
+
+   gallivm_compile_module(variant->gallivm);
+
+   jit_function[RAST_EDGE_TEST] = (lp_jit_frag_func)
+         gallivm_jit_function(variant->gallivm,
+                              variant->function[RAST_EDGE_TEST]);
+
+   if (variant->function[RAST_WHOLE]) {
+      jit_function[RAST_WHOLE] = (lp_jit_frag_func)
+            gallivm_jit_function(variant->gallivm,
+                                 variant->function[RAST_WHOLE]);
+   } else {
+      jit_function[RAST_WHOLE] = jit_function[RAST_EDGE_TEST];
+   }
+
+   compile_time = os_time_get_nano() - start_time;
+   p_atomic_inc(&screen->counters.counter[LP_COUNTER_FS_COMPILES]);
+   p_atomic_add(&screen->counters.counter[LP_COUNTER_FS_COMPILE_TIME],
+                compile_time);
+
+   return compile_time;
+}
+
+
+/**
+ * Background compilation of the optimized code for a variant which is
+ * meanwhile drawing with unoptimized code.
+ */
+struct lp_fs_compile_job
+{
+   struct llvmpipe_screen *screen;
+   struct lp_fragment_shader_variant *variant;
+};
+
+
+static void
+lp_fs_compile_job_execute(void *data, int thread_index)
+{
+   struct lp_fs_compile_job *job = data;
+   struct lp_fragment_shader_variant *variant = job->variant;
+   struct gallivm_state *gallivm;
+   struct lp_cached_code cached = { 0 };
+   unsigned char ir_sha1_cache_key[20];
+   lp_jit_frag_func jit_function[2];
+   LLVMContextRef context;
+   char module_name[64];
+   int64_t compile_time;
+
+   /* The context's LLVMContext is in use by the draw thread */
+   context = LLVMContextCreate();
+   if (!context)
+      return;
+
+   util_snprintf(module_name, sizeof(module_name), "fs%u_variant%u_opt",
+                 variant->shader->no, variant->no);
+
+   gallivm = gallivm_create(module_name, context, &cached);
+   if (!gallivm) {
+      LLVMContextDispose(context);
+      return;
+   }
+
+   /* The draw thread only touches variant->gallivm once this job is done,
+    * and the types must be recreated in the new LLVMContext.
+    */
+   variant->fallback_gallivm = variant->gallivm;
+   variant->gallivm = gallivm;
+   variant->jit_context_ptr_type = NULL;
+
+   compile_time = generate_variant_code(job->screen, variant->shader,
+                                        variant, jit_function);
+   variant->tier_stats.compile_time[1] = compile_time;
+   p_atomic_inc(&job->screen->counters.counter[LP_COUNTER_FS_TIER_UPS]);
+   p_atomic_add(&job->screen->counters.counter[LP_COUNTER_FS_TIER_UP_TIME],
+                compile_time);
+
+   lp_fs_get_ir_cache_key(variant->shader, &variant->key, ir_sha1_cache_key);
+   lp_disk_cache_insert_shader(job->screen, &cached, ir_sha1_cache_key);
+
+   gallivm_free_ir(gallivm);
+   free(cached.data);
+   LLVMContextDispose(context);
+
+   /*
+    * Scenes binned with this variant may be rasterizing right now.  Each
+    * entry point is swapped with a single store, and the fallback code
+    * stays alive until the variant is destroyed.
+    */
+   p_atomic_set(&variant->jit_function[RAST_WHOLE],
+                jit_function[RAST_WHOLE]);
+   p_atomic_set(&variant->jit_function[RAST_EDGE_TEST],
+                jit_function[RAST_EDGE_TEST]);
+   p_atomic_set(&variant->tier, 1);
+}
+
+
+static void
+lp_fs_compile_job_cleanup(void *data, int thread_index)
+{
+   FREE(data);
+}
+
+
 /**
  * Generate a new fragment shader variant from the shader code and
  * other state indicated by the key.
+ *
+ * When the screen has a compile queue and the code isn't in the disk
+ * cache, the variant is compiled without optimizations first, so that
+ * drawing can continue.  The optimized code is built in the background
+ * once the variant turns out to be used often, see
+ * llvmpipe_fs_variant_draw().
  */
 static struct lp_fragment_shader_variant *
 generate_variant(struct llvmpipe_context *lp,
                  struct lp_fragment_shader *shader,
                  const struct lp_fragment_shader_variant_key *key)
 {
+   struct llvmpipe_screen *screen = llvmpipe_screen(lp->pipe.screen);
    struct lp_fragment_shader_variant *variant;
    const struct util_format_description *cbuf0_format_desc = NULL;
    boolean fullcolormask;
    char module_name[64];
+   unsigned char ir_sha1_cache_key[20];
+   struct lp_cached_code cached = { 0 };
+   boolean needs_caching = FALSE;
+   boolean compile_async;
 
    variant = CALLOC_STRUCT(lp_fragment_shader_variant);
    if (!variant)
@@ -2828,12 +3050,25 @@ generate_variant(struct llvmpipe_context *lp,
    util_snprintf(module_name, sizeof(module_name), "fs%u_variant%u",
                  shader->no, shader->variants_created);
 
-   variant->gallivm = gallivm_create(module_name, lp->context);
+   lp_fs_get_ir_cache_key(shader, key, ir_sha1_cache_key);
+   lp_disk_cache_find_shader(screen, &cached, ir_sha1_cache_key);
+   needs_caching = !cached.data_size;
+
+   compile_async = util_queue_is_initialized(&screen->compile_queue) &&
+                   !cached.data_size;
+
+   /* The unoptimized code must not end up in the disk cache */
+   variant->gallivm = gallivm_create(module_name, lp->context,
+                                     compile_async ? NULL : &cached);
    if (!variant->gallivm) {
+      free(cached.data);
       FREE(variant);
       return NULL;
    }
 
+   variant->gallivm->no_opt = compile_async;
+   variant->tier = compile_async ? 0 : 1;
+
    variant->shader = shader;
    variant->list_item_global.base = variant;
    variant->list_item_local.base = variant;
@@ -2859,50 +3094,59 @@ generate_variant(struct llvmpipe_context *lp,
          !key->blend.alpha_to_coverage &&
          !key->depth.enabled &&
          !shader->info.base.uses_kill &&
-         !shader->info.base.writes_samplemask
+         !shader->info.base.writes_samplemask &&
+         !shader->info.base.writes_memory
       ? TRUE : FALSE;
 
    if ((LP_DEBUG & DEBUG_FS) || (gallivm_debug & GALLIVM_DEBUG_IR)) {
       lp_debug_fs_variant(variant);
    }
 
-   lp_jit_init_types(variant);
-   
-   if (variant->jit_function[RAST_EDGE_TEST] == NULL)
-      generate_fragment(lp, shader, variant, RAST_EDGE_TEST);
+   variant->tier_stats.compile_time[variant->tier] =
+      generate_variant_code(screen, shader, variant, variant->jit_function);
 
-   if (variant->jit_function[RAST_WHOLE] == NULL) {
-      if (variant->opaque) {
-         /* Specialized shader, which doesn't need to read the color buffer. */
-         generate_fragment(lp, shader, variant, RAST_WHOLE);
-      }
-   }
+   variant->nr_instrs += lp_build_count_ir_module(variant->gallivm->module);
 
-   /*
-    * Compile everything
-    */
+   if (needs_caching && !compile_async)
+      lp_disk_cache_insert_shader(screen, &cached, ir_sha1_cache_key);
 
-   gallivm_compile_module(variant->gallivm);
+   gallivm_free_ir(variant->gallivm);
+   free(cached.data);
 
-   variant->nr_instrs += lp_build_count_ir_module(variant->gallivm->module);
+   util_queue_fence_init(&variant->optimized);
 
-   if (variant->function[RAST_EDGE_TEST]) {
-      variant->jit_function[RAST_EDGE_TEST] = (lp_jit_frag_func)
-            gallivm_jit_function(variant->gallivm,
-                                 variant->function[RAST_EDGE_TEST]);
-   }
+   return variant;
+}
 
-   if (variant->function[RAST_WHOLE]) {
-         variant->jit_function[RAST_WHOLE] = (lp_jit_frag_func)
-               gallivm_jit_function(variant->gallivm,
-                                    variant->function[RAST_WHOLE]);
-   } else if (!variant->jit_function[RAST_WHOLE]) {
-      variant->jit_function[RAST_WHOLE] = variant->jit_function[RAST_EDGE_TEST];
-   }
 
-   gallivm_free_ir(variant->gallivm);
+/**
+ * Count a draw with the bound fragment shader variant, and queue the
+ * compilation of its optimized code once it has been drawn with
+ * gallivm_tier_up_uses times.
+ */
+void
+llvmpipe_fs_variant_draw(struct llvmpipe_context *lp)
+{
+   struct llvmpipe_screen *screen = llvmpipe_screen(lp->pipe.screen);
+   struct lp_fragment_shader_variant *variant = lp->fs_variant;
+   struct lp_fs_compile_job *job;
 
-   return variant;
+   if (!variant || variant->tier != 0)
+      return;
+
+   /* Variants may be shared by contexts, only one of them queues the job */
+   if (p_atomic_inc_return(&variant->uses) != MAX2(gallivm_tier_up_uses, 1))
+      return;
+
+   job = CALLOC_STRUCT(lp_fs_compile_job);
+   if (!job)
+      return;
+
+   job->screen = screen;
+   job->variant = variant;
+   util_queue_add_job(&screen->compile_queue, job, &variant->optimized,
+                      lp_fs_compile_job_execute,
+                      lp_fs_compile_job_cleanup);
 }
 
 
@@ -3036,7 +3280,24 @@ llvmpipe_remove_shader_variant(struct llvmpipe_context *lp,
                    lp->nr_fs_variants, variant->nr_instrs, lp->nr_fs_instrs);
    }
 
+   if (gallivm_debug & GALLIVM_DEBUG_PERF) {
+      char name[64];
+      util_snprintf(name, sizeof(name), "fs%u_variant%u",
+                    variant->shader->no, variant->no);
+      gallivm_print_tier_stats(name, &variant->tier_stats);
+   }
+
+   if (lp->fs_variant == variant)
+      lp->fs_variant = NULL;
+
+   /* Cancel or wait for the background compilation, if any */
+   util_queue_drop_job(&llvmpipe_screen(lp->pipe.screen)->compile_queue,
+                       &variant->optimized);
+   util_queue_fence_destroy(&variant->optimized);
+
    gallivm_destroy(variant->gallivm);
+   if (variant->fallback_gallivm)
+      gallivm_destroy(variant->fallback_gallivm);
 
    /* remove from shader's list */
    remove_from_list(&variant->list_item_local);
@@ -3128,7 +3389,7 @@ llvmpipe_set_constant_buffer(struct pipe_context *pipe,
       draw_set_mapped_constant_buffer(llvmpipe->draw, shader,
                                       index, data, size);
    }
-   else {
+   else if (shader == PIPE_SHADER_FRAGMENT) {
       llvmpipe->dirty |= LP_NEW_FS_CONSTANTS;
    }
 
@@ -3138,6 +3399,74 @@ llvmpipe_set_constant_buffer(struct pipe_context *pipe,
 }
 
 
+static void
+llvmpipe_set_shader_buffers(struct pipe_context *pipe,
+                            enum pipe_shader_type shader,
+                            unsigned start_slot, unsigned count,
+                            const struct pipe_shader_buffer *buffers)
+{
+   struct llvmpipe_context *llvmpipe = llvmpipe_context(pipe);
+   unsigned i;
+
+   assert(shader < PIPE_SHADER_TYPES);
+   assert(start_slot + count <= ARRAY_SIZE(llvmpipe->ssbos[shader]));
+
+   draw_flush(llvmpipe->draw);
+
+   for (i = 0; i < count; i++) {
+      struct pipe_shader_buffer *dst = &llvmpipe->ssbos[shader][start_slot + i];
+
+      if (buffers) {
+         pipe_resource_reference(&dst->buffer, buffers[i].buffer);
+         dst->buffer_offset = buffers[i].buffer_offset;
+         dst->buffer_size = buffers[i].buffer_size;
+      }
+      else {
+         pipe_resource_reference(&dst->buffer, NULL);
+         dst->buffer_offset = 0;
+         dst->buffer_size = 0;
+      }
+   }
+
+   if (shader == PIPE_SHADER_FRAGMENT) {
+      llvmpipe->dirty |= LP_NEW_FS_SSBOS;
+   }
+}
+
+
+static void
+llvmpipe_set_shader_images(struct pipe_context *pipe,
+                           enum pipe_shader_type shader,
+                           unsigned start_slot, unsigned count,
+                           const struct pipe_image_view *images)
+{
+   struct llvmpipe_context *llvmpipe = llvmpipe_context(pipe);
+   unsigned i;
+
+   assert(shader < PIPE_SHADER_TYPES);
+   assert(start_slot + count <= ARRAY_SIZE(llvmpipe->images[shader]));
+
+   draw_flush(llvmpipe->draw);
+
+   for (i = 0; i < count; i++) {
+      struct pipe_image_view *dst = &llvmpipe->images[shader][start_slot + i];
+
+      if (images && images[i].resource) {
+         /* shader images are only addressed linearly */
+         llvmpipe_resource_make_linear(pipe, images[i].resource);
+         util_copy_image_view(dst, &images[i]);
+      }
+      else {
+         util_copy_image_view(dst, NULL);
+      }
+   }
+
+   if (shader == PIPE_SHADER_FRAGMENT) {
+      llvmpipe->dirty |= LP_NEW_FS_IMAGES;
+   }
+}
+
+
 /**
  * Return the blend factor equivalent to a destination alpha of one.
  */
@@ -3316,6 +3645,14 @@ make_variant_key(struct llvmpipe_context *lp,
       }
    }
 
+   for (i = 0; i < shader->info.base.file_max[TGSI_FILE_IMAGE] + 1; i++) {
+      const struct pipe_image_view *image =
+         &lp->images[PIPE_SHADER_FRAGMENT][i];
+
+      key->image_format[i] = image->resource ? image->format
+                                             : PIPE_FORMAT_NONE;
+   }
+
    /* This value will be the same for all the variants of a given shader:
     */
    key->nr_samplers = shader->info.base.file_max[TGSI_FILE_SAMPLER] + 1;
@@ -3343,6 +3680,8 @@ make_variant_key(struct llvmpipe_context *lp,
          if(shader->info.base.file_mask[TGSI_FILE_SAMPLER_VIEW] & (1u << (i & 31))) {
             lp_sampler_static_texture_state(&key->state[i].texture_state,
                                             lp->sampler_views[PIPE_SHADER_FRAGMENT][i]);
+            key->state[i].texture_state.tiled =
+               llvmpipe_sampler_view_is_tiled(lp->sampler_views[PIPE_SHADER_FRAGMENT][i]);
          }
       }
    }
@@ -3352,6 +3691,8 @@ make_variant_key(struct llvmpipe_context *lp,
          if(shader->info.base.file_mask[TGSI_FILE_SAMPLER] & (1 << i)) {
             lp_sampler_static_texture_state(&key->state[i].texture_state,
                                             lp->sampler_views[PIPE_SHADER_FRAGMENT][i]);
+            key->state[i].texture_state.tiled =
+               llvmpipe_sampler_view_is_tiled(lp->sampler_views[PIPE_SHADER_FRAGMENT][i]);
          }
       }
    }
@@ -3466,6 +3807,7 @@ llvmpipe_update_fs(struct llvmpipe_context *lp)
 
    /* Bind this variant */
    lp_setup_set_fs_variant(lp->setup, variant);
+   lp->fs_variant = variant;
 }
 
 
@@ -3480,6 +3822,8 @@ llvmpipe_init_fs_funcs(struct llvmpipe_context *llvmpipe)
    llvmpipe->pipe.delete_fs_state = llvmpipe_delete_fs_state;
 
    llvmpipe->pipe.set_constant_buffer = llvmpipe_set_constant_buffer;
+   llvmpipe->pipe.set_shader_buffers = llvmpipe_set_shader_buffers;
+   llvmpipe->pipe.set_shader_images = llvmpipe_set_shader_images;
 }
 
 
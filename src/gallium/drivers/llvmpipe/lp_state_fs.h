@@ -32,8 +32,10 @@
 
 #include "pipe/p_compiler.h"
 #include "pipe/p_state.h"
+#include "util/u_queue.h"
 #include "tgsi/tgsi_scan.h" /* for tgsi_shader_info */
 #include "gallivm/lp_bld_sample.h" /* for struct lp_sampler_static_state */
+#include "gallivm/lp_bld_init.h" /* for struct gallivm_tier_stats */
 #include "gallivm/lp_bld_tgsi.h" /* for lp_tgsi_info */
 #include "lp_bld_interp.h" /* for struct lp_shader_input */
 
@@ -81,6 +83,9 @@ struct lp_fragment_shader_variant_key
    enum pipe_format zsbuf_format;
    enum pipe_format cbuf_format[PIPE_MAX_COLOR_BUFS];
 
+   /** formats of the bound images, PIPE_FORMAT_NONE if unbound */
+   uint16_t image_format[LP_MAX_TGSI_SHADER_IMAGES];
+
    struct lp_sampler_static_state state[PIPE_MAX_SHADER_SAMPLER_VIEWS];
 };
 
@@ -109,6 +114,21 @@ struct lp_fragment_shader_variant
 
    lp_jit_frag_func jit_function[2];
 
+   /**
+    * With a compile queue, jit_function first points at unoptimized code
+    * in gallivm (tier 0).  Once the variant has been drawn with
+    * gallivm_tier_up_uses times, the optimized code (tier 1) is compiled
+    * in the background and replaces it, gallivm is moved to
+    * fallback_gallivm and this fence is signalled.
+    */
+   struct util_queue_fence optimized;
+   struct gallivm_state *fallback_gallivm;
+   unsigned tier;         /**< tier of the code in jit_function */
+   unsigned uses;         /**< draws using the tier 0 code */
+
+   /** Updated by the rasterizer threads with GALLIVM_DEBUG=perf */
+   struct gallivm_tier_stats tier_stats;
+
    /* Total number of LLVM instructions generated */
    unsigned nr_instrs;
 
@@ -98,7 +98,7 @@ llvmpipe_bind_sampler_states(struct pipe_context *pipe,
                         llvmpipe->samplers[shader],
                         llvmpipe->num_samplers[shader]);
    }
-   else {
+   else if (shader == PIPE_SHADER_FRAGMENT) {
       llvmpipe->dirty |= LP_NEW_SAMPLER;
    }
 }
@@ -140,6 +140,12 @@ llvmpipe_set_sampler_views(struct pipe_context *pipe,
       }
       pipe_sampler_view_reference(&llvmpipe->sampler_views[shader][start + i],
                                   views[i]);
+
+      /* the draw module samplers don't know about tiled textures */
+      if (views[i] && views[i]->texture &&
+          (shader == PIPE_SHADER_VERTEX || shader == PIPE_SHADER_GEOMETRY)) {
+         llvmpipe_resource_make_linear(pipe, views[i]->texture);
+      }
    }
 
    /* find highest non-null sampler_views[] entry */
@@ -156,7 +162,7 @@ llvmpipe_set_sampler_views(struct pipe_context *pipe,
                              llvmpipe->sampler_views[shader],
                              llvmpipe->num_sampler_views[shader]);
    }
-   else {
+   else if (shader == PIPE_SHADER_FRAGMENT) {
       llvmpipe->dirty |= LP_NEW_SAMPLER_VIEW;
    }
 }
@@ -275,6 +281,7 @@ prepare_shader_sampling(
                last_level = view->u.tex.last_level;
                assert(first_level <= last_level);
                assert(last_level <= res->last_level);
+               assert(!lp_tex->tiled);
                addr = lp_tex->tex_data;
 
                for (j = first_level; j <= last_level; j++) {
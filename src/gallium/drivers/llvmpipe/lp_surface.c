@@ -141,6 +141,11 @@ llvmpipe_create_surface(struct pipe_context *pipe,
       }
    }
 
+   /* the rasterizer only knows how to write linear images */
+   if (llvmpipe_resource_is_texture(pt)) {
+      llvmpipe_resource_make_linear(pipe, pt);
+   }
+
    ps = CALLOC_STRUCT(pipe_surface);
    if (ps) {
       pipe_reference_init(&ps->reference, 1);
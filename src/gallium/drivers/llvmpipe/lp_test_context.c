@@ -0,0 +1,622 @@
+/**************************************************************************
+ *
+ * Copyright 2019 The Mesa Authors
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL VMWARE AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+
+/**
+ * @file
+ * Unit tests running whole llvmpipe contexts.
+ *
+ * Scenes are rasterized while the context that queued them carries on, so
+ * these check that a second context touching the same resources waits for
+ * them.  That only happens with rasterizer threads, (LP_NUM_THREADS > 0).
+ * The driver queries fed by the rasterizer and compute shader launches are
+ * checked here too.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "pipe/p_context.h"
+#include "pipe/p_screen.h"
+#include "pipe/p_state.h"
+#include "state_tracker/sw_winsys.h"
+#include "tgsi/tgsi_text.h"
+#include "util/u_box.h"
+#include "util/u_inlines.h"
+#include "util/u_memory.h"
+#include "util/u_sampler.h"
+#include "util/u_surface.h"
+
+#include "lp_limits.h"
+#include "lp_public.h"
+#include "lp_test.h"
+
+
+#define TEX_SIZE 2048
+#define NUM_FRAMES 16
+
+
+void
+write_tsv_header(FILE *fp)
+{
+   fprintf(fp,
+           "result\t"
+           "test\n");
+
+   fflush(fp);
+}
+
+
+static void
+write_tsv_row(FILE *fp, const char *name, boolean success)
+{
+   fprintf(fp, "%s\t%s\n", success ? "pass" : "fail", name);
+
+   fflush(fp);
+}
+
+
+/**
+ * A winsys without display targets, which is all these tests need.
+ */
+static boolean
+test_is_displaytarget_format_supported(struct sw_winsys *ws,
+                                       unsigned tex_usage,
+                                       enum pipe_format format)
+{
+   return FALSE;
+}
+
+
+static void
+test_winsys_destroy(struct sw_winsys *ws)
+{
+   FREE(ws);
+}
+
+
+static struct pipe_screen *
+create_screen(void)
+{
+   struct sw_winsys *ws = CALLOC_STRUCT(sw_winsys);
+
+   if (!ws)
+      return NULL;
+
+   ws->destroy = test_winsys_destroy;
+   ws->is_displaytarget_format_supported =
+      test_is_displaytarget_format_supported;
+
+   return llvmpipe_create_screen(ws);
+}
+
+
+static struct pipe_resource *
+create_texture(struct pipe_screen *screen, unsigned size, unsigned bind)
+{
+   struct pipe_resource templat;
+
+   memset(&templat, 0, sizeof templat);
+   templat.target = PIPE_TEXTURE_2D;
+   templat.format = PIPE_FORMAT_B8G8R8A8_UNORM;
+   templat.width0 = size;
+   templat.height0 = size;
+   templat.depth0 = 1;
+   templat.array_size = 1;
+   templat.bind = bind;
+
+   return screen->resource_create(screen, &templat);
+}
+
+
+static void
+bind_framebuffer(struct pipe_context *pipe, struct pipe_resource *tex)
+{
+   struct pipe_framebuffer_state fb;
+   struct pipe_surface surf_tmpl, *surf;
+
+   u_surface_default_template(&surf_tmpl, tex);
+   surf = pipe->create_surface(pipe, tex, &surf_tmpl);
+
+   memset(&fb, 0, sizeof fb);
+   fb.width = tex->width0;
+   fb.height = tex->height0;
+   fb.nr_cbufs = 1;
+   fb.cbufs[0] = surf;
+   pipe->set_framebuffer_state(pipe, &fb);
+
+   pipe_surface_reference(&surf, NULL);
+}
+
+
+/* Both the clear color and its B8G8R8A8_UNORM value. */
+static uint32_t
+frame_color(unsigned frame, union pipe_color_union *color)
+{
+   color->f[0] = (frame >> 0) & 1;
+   color->f[1] = (frame >> 1) & 1;
+   color->f[2] = (frame >> 2) & 1;
+   color->f[3] = 1.0f;
+
+   return 0xff000000 |
+          ((frame >> 0) & 1) * 0xff0000 |
+          ((frame >> 1) & 1) * 0xff00 |
+          ((frame >> 2) & 1) * 0xff;
+}
+
+
+/**
+ * Check every texel of a texture, mapped in the given context.
+ */
+static boolean
+check_texture(struct pipe_context *pipe, struct pipe_resource *tex,
+              uint32_t expected, unsigned verbose)
+{
+   struct pipe_transfer *transfer;
+   const uint8_t *map;
+   unsigned x, y;
+
+   map = pipe_transfer_map(pipe, tex, 0, 0, PIPE_TRANSFER_READ,
+                           0, 0, tex->width0, tex->height0, &transfer);
+   if (!map)
+      return FALSE;
+
+   for (y = 0; y < tex->height0; y++) {
+      const uint32_t *row = (const uint32_t *)(map + y * transfer->stride);
+
+      for (x = 0; x < tex->width0; x++) {
+         if (row[x] != expected) {
+            if (verbose)
+               printf("  texel %u,%u is 0x%08x instead of 0x%08x\n",
+                      x, y, row[x], expected);
+            pipe->transfer_unmap(pipe, transfer);
+            return FALSE;
+         }
+      }
+   }
+
+   pipe->transfer_unmap(pipe, transfer);
+   return TRUE;
+}
+
+
+/**
+ * One context clears a large render target and only flushes, the other
+ * one reads it back right away.
+ */
+static boolean
+test_render_then_read(struct pipe_screen *screen, unsigned verbose)
+{
+   struct pipe_context *a = screen->context_create(screen, NULL, 0);
+   struct pipe_context *b = screen->context_create(screen, NULL, 0);
+   struct pipe_framebuffer_state fb;
+   struct pipe_resource *tex;
+   boolean success = TRUE;
+   unsigned frame;
+
+   tex = create_texture(screen, TEX_SIZE, PIPE_BIND_RENDER_TARGET);
+   bind_framebuffer(a, tex);
+
+   for (frame = 0; frame < NUM_FRAMES && success; frame++) {
+      union pipe_color_union color;
+      uint32_t expected = frame_color(frame, &color);
+
+      a->clear(a, PIPE_CLEAR_COLOR0, &color, 0.0, 0);
+      a->flush(a, NULL, 0);
+
+      success = check_texture(b, tex, expected, verbose);
+   }
+
+   memset(&fb, 0, sizeof fb);
+   a->set_framebuffer_state(a, &fb);
+   pipe_resource_reference(&tex, NULL);
+   a->destroy(a);
+   b->destroy(b);
+
+   return success;
+}
+
+
+static void
+fill_texture(struct pipe_context *pipe, struct pipe_resource *tex,
+             uint32_t value)
+{
+   struct pipe_box box;
+   uint32_t *data;
+   unsigned i;
+
+   data = MALLOC(tex->width0 * tex->height0 * 4);
+   for (i = 0; i < tex->width0 * tex->height0; i++)
+      data[i] = value;
+
+   u_box_2d(0, 0, tex->width0, tex->height0, &box);
+   pipe->texture_subdata(pipe, tex, 0, PIPE_TRANSFER_WRITE, &box, data,
+                         tex->width0 * 4, 0);
+
+   FREE(data);
+}
+
+
+/**
+ * One context samples a texture into a large render target and only
+ * flushes, the other one overwrites the texture right away.  The render
+ * target must get the old contents.
+ */
+static boolean
+test_sample_then_write(struct pipe_screen *screen, unsigned verbose)
+{
+   struct pipe_context *a = screen->context_create(screen, NULL, 0);
+   struct pipe_context *b = screen->context_create(screen, NULL, 0);
+   struct pipe_resource *src, *dst;
+   union pipe_color_union color;
+   boolean success = TRUE;
+   unsigned frame;
+
+   src = create_texture(screen, 64, PIPE_BIND_SAMPLER_VIEW);
+   dst = create_texture(screen, TEX_SIZE, PIPE_BIND_RENDER_TARGET);
+
+   fill_texture(a, src, frame_color(0, &color));
+
+   for (frame = 0; frame < NUM_FRAMES && success; frame++) {
+      struct pipe_blit_info blit;
+
+      memset(&blit, 0, sizeof blit);
+      blit.src.resource = src;
+      blit.src.format = src->format;
+      u_box_2d(0, 0, src->width0, src->height0, &blit.src.box);
+      blit.dst.resource = dst;
+      blit.dst.format = dst->format;
+      u_box_2d(0, 0, dst->width0, dst->height0, &blit.dst.box);
+      blit.mask = PIPE_MASK_RGBA;
+      blit.filter = PIPE_TEX_FILTER_NEAREST;
+
+      a->blit(a, &blit);
+      a->flush(a, NULL, 0);
+
+      fill_texture(b, src, frame_color(frame + 1, &color));
+
+      success = check_texture(a, dst, frame_color(frame, &color), verbose);
+   }
+
+   pipe_resource_reference(&src, NULL);
+   pipe_resource_reference(&dst, NULL);
+   a->destroy(a);
+   b->destroy(b);
+
+   return success;
+}
+
+
+/**
+ * Blit into a single tile of a large render target, without clearing it
+ * first, and check that the "empty-tiles" driver query counts all the
+ * others.
+ */
+static boolean
+test_empty_tiles(struct pipe_screen *screen, unsigned verbose)
+{
+   struct pipe_context *a = screen->context_create(screen, NULL, 0);
+   struct pipe_driver_query_info info;
+   struct pipe_fence_handle *fence = NULL;
+   union pipe_query_result result;
+   struct pipe_resource *src, *dst;
+   struct pipe_blit_info blit;
+   struct pipe_query *q;
+   union pipe_color_union color;
+   unsigned num_tiles = (TEX_SIZE / TILE_SIZE) * (TEX_SIZE / TILE_SIZE);
+   unsigned i, n;
+
+   n = screen->get_driver_query_info(screen, 0, NULL);
+   for (i = 0; i < n; i++) {
+      if (screen->get_driver_query_info(screen, i, &info) &&
+          strcmp(info.name, "empty-tiles") == 0)
+         break;
+   }
+   if (i == n) {
+      a->destroy(a);
+      return FALSE;
+   }
+
+   /* Scaled, so it can't be done as a copy on the CPU. */
+   src = create_texture(screen, TILE_SIZE / 2, PIPE_BIND_SAMPLER_VIEW);
+   dst = create_texture(screen, TEX_SIZE, PIPE_BIND_RENDER_TARGET);
+
+   fill_texture(a, src, frame_color(1, &color));
+
+   memset(&blit, 0, sizeof blit);
+   blit.src.resource = src;
+   blit.src.format = src->format;
+   u_box_2d(0, 0, src->width0, src->height0, &blit.src.box);
+   blit.dst.resource = dst;
+   blit.dst.format = dst->format;
+   u_box_2d(0, 0, TILE_SIZE, TILE_SIZE, &blit.dst.box);
+   blit.mask = PIPE_MASK_RGBA;
+   blit.filter = PIPE_TEX_FILTER_NEAREST;
+
+   q = a->create_query(a, info.query_type, 0);
+   a->begin_query(a, q);
+
+   a->blit(a, &blit);
+
+   /* The counters are only updated once the scene is rasterized. */
+   a->flush(a, &fence, 0);
+   screen->fence_finish(screen, NULL, fence, PIPE_TIMEOUT_INFINITE);
+   screen->fence_reference(screen, &fence, NULL);
+
+   a->end_query(a, q);
+   a->get_query_result(a, q, TRUE, &result);
+   a->destroy_query(a, q);
+
+   if (verbose)
+      printf("  %llu of %u tiles empty\n",
+             (unsigned long long)result.u64, num_tiles);
+
+   pipe_resource_reference(&src, NULL);
+   pipe_resource_reference(&dst, NULL);
+   a->destroy(a);
+
+   return result.u64 == num_tiles - 1;
+}
+
+
+#define CS_BLOCK_SIZE 64
+#define CS_GRID_SIZE 4
+#define CS_INVOCATIONS (CS_BLOCK_SIZE * CS_GRID_SIZE)
+
+
+/**
+ * Every invocation writes its global id to shared memory and, after a
+ * barrier, copies its right neighbour's value to a shader buffer.  It also
+ * copies a texel of a sampler view to an image, adding one.
+ */
+static const char cs_text[] =
+   "COMP\n"
+   "PROPERTY CS_FIXED_BLOCK_WIDTH 64\n"
+   "PROPERTY CS_FIXED_BLOCK_HEIGHT 1\n"
+   "PROPERTY CS_FIXED_BLOCK_DEPTH 1\n"
+   "DCL SV[0], THREAD_ID\n"
+   "DCL SV[1], BLOCK_ID\n"
+   "DCL SVIEW[0], 2D, UINT\n"
+   "DCL BUFFER[0]\n"
+   "DCL MEMORY[0], SHARED\n"
+   "DCL IMAGE[0], 2D, PIPE_FORMAT_R32_UINT, WR\n"
+   "DCL TEMP[0..3]\n"
+   "IMM[0] UINT32 {4, 63, 64, 1}\n"
+   "IMM[1] UINT32 {0, 0, 0, 0}\n"
+   "  0: UMAD TEMP[0].x, SV[1].xxxx, IMM[0].zzzz, SV[0].xxxx\n"
+   "  1: UMUL TEMP[1].x, SV[0].xxxx, IMM[0].xxxx\n"
+   "  2: STORE MEMORY[0].x, TEMP[1].xxxx, TEMP[0].xxxx\n"
+   "  3: BARRIER\n"
+   "  4: UADD TEMP[2].x, SV[0].xxxx, IMM[0].wwww\n"
+   "  5: AND TEMP[2].x, TEMP[2].xxxx, IMM[0].yyyy\n"
+   "  6: UMUL TEMP[2].x, TEMP[2].xxxx, IMM[0].xxxx\n"
+   "  7: LOAD TEMP[2].x, MEMORY[0], TEMP[2].xxxx\n"
+   "  8: UMUL TEMP[1].x, TEMP[0].xxxx, IMM[0].xxxx\n"
+   "  9: STORE BUFFER[0].x, TEMP[1].xxxx, TEMP[2].xxxx\n"
+   " 10: MOV TEMP[3], IMM[1]\n"
+   " 11: MOV TEMP[3].x, TEMP[0].xxxx\n"
+   " 12: SAMPLE_I TEMP[1], TEMP[3], SVIEW[0]\n"
+   " 13: UADD TEMP[1].x, TEMP[1].xxxx, IMM[0].wwww\n"
+   " 14: STORE IMAGE[0], TEMP[3], TEMP[1], 2D, PIPE_FORMAT_R32_UINT\n"
+   " 15: END\n";
+
+
+static struct pipe_resource *
+create_uint_texture(struct pipe_screen *screen, unsigned bind)
+{
+   struct pipe_resource templat;
+
+   memset(&templat, 0, sizeof templat);
+   templat.target = PIPE_TEXTURE_2D;
+   templat.format = PIPE_FORMAT_R32_UINT;
+   templat.width0 = CS_INVOCATIONS;
+   templat.height0 = 1;
+   templat.depth0 = 1;
+   templat.array_size = 1;
+   templat.bind = bind;
+
+   return screen->resource_create(screen, &templat);
+}
+
+
+/**
+ * Launch a grid with several blocks, several SIMD groups each, reading
+ * and writing shared memory across a barrier, a shader buffer, a sampler
+ * view and an image.
+ */
+static boolean
+test_launch_grid(struct pipe_screen *screen, unsigned verbose)
+{
+   struct pipe_context *a;
+   struct tgsi_token tokens[1024];
+   struct pipe_compute_state cs_tmpl;
+   struct pipe_grid_info grid;
+   struct pipe_shader_buffer sb;
+   struct pipe_image_view image;
+   struct pipe_sampler_view view_tmpl, *view, *no_view = NULL;
+   struct pipe_resource *buf, *src, *dst;
+   struct pipe_transfer *transfer;
+   const uint32_t *map;
+   boolean success = TRUE;
+   uint32_t data[CS_INVOCATIONS];
+   struct pipe_box box;
+   void *cs;
+   unsigned i;
+
+   if (!screen->get_param(screen, PIPE_CAP_COMPUTE))
+      return TRUE;
+
+   if (!tgsi_text_translate(cs_text, tokens, ARRAY_SIZE(tokens)))
+      return FALSE;
+
+   a = screen->context_create(screen, NULL, 0);
+
+   buf = pipe_buffer_create(screen, PIPE_BIND_SHADER_BUFFER,
+                            PIPE_USAGE_DEFAULT, sizeof data);
+   src = create_uint_texture(screen, PIPE_BIND_SAMPLER_VIEW);
+   dst = create_uint_texture(screen, PIPE_BIND_SHADER_IMAGE);
+
+   for (i = 0; i < CS_INVOCATIONS; i++)
+      data[i] = i * 3;
+   u_box_2d(0, 0, CS_INVOCATIONS, 1, &box);
+   a->texture_subdata(a, src, 0, PIPE_TRANSFER_WRITE, &box, data,
+                      sizeof data, 0);
+
+   memset(&cs_tmpl, 0, sizeof cs_tmpl);
+   cs_tmpl.ir_type = PIPE_SHADER_IR_TGSI;
+   cs_tmpl.prog = tokens;
+   cs_tmpl.req_local_mem = CS_BLOCK_SIZE * 4;
+   cs = a->create_compute_state(a, &cs_tmpl);
+   a->bind_compute_state(a, cs);
+
+   memset(&sb, 0, sizeof sb);
+   sb.buffer = buf;
+   sb.buffer_size = sizeof data;
+   a->set_shader_buffers(a, PIPE_SHADER_COMPUTE, 0, 1, &sb);
+
+   u_sampler_view_default_template(&view_tmpl, src, src->format);
+   view = a->create_sampler_view(a, src, &view_tmpl);
+   a->set_sampler_views(a, PIPE_SHADER_COMPUTE, 0, 1, &view);
+
+   memset(&image, 0, sizeof image);
+   image.resource = dst;
+   image.format = dst->format;
+   image.access = PIPE_IMAGE_ACCESS_WRITE;
+   a->set_shader_images(a, PIPE_SHADER_COMPUTE, 0, 1, &image);
+
+   memset(&grid, 0, sizeof grid);
+   grid.block[0] = CS_BLOCK_SIZE;
+   grid.block[1] = 1;
+   grid.block[2] = 1;
+   grid.grid[0] = CS_GRID_SIZE;
+   grid.grid[1] = 1;
+   grid.grid[2] = 1;
+   a->launch_grid(a, &grid);
+
+   map = pipe_buffer_map(a, buf, PIPE_TRANSFER_READ, &transfer);
+   for (i = 0; i < CS_INVOCATIONS && success; i++) {
+      uint32_t expected = (i & ~(CS_BLOCK_SIZE - 1)) |
+                          ((i + 1) & (CS_BLOCK_SIZE - 1));
+
+      if (map[i] != expected) {
+         if (verbose)
+            printf("  buffer element %u is %u instead of %u\n",
+                   i, map[i], expected);
+         success = FALSE;
+      }
+   }
+   pipe_buffer_unmap(a, transfer);
+
+   map = pipe_transfer_map(a, dst, 0, 0, PIPE_TRANSFER_READ,
+                           0, 0, CS_INVOCATIONS, 1, &transfer);
+   for (i = 0; i < CS_INVOCATIONS && success; i++) {
+      if (map[i] != data[i] + 1) {
+         if (verbose)
+            printf("  image texel %u is %u instead of %u\n",
+                   i, map[i], data[i] + 1);
+         success = FALSE;
+      }
+   }
+   a->transfer_unmap(a, transfer);
+
+   a->set_shader_images(a, PIPE_SHADER_COMPUTE, 0, 1, NULL);
+   a->set_sampler_views(a, PIPE_SHADER_COMPUTE, 0, 1, &no_view);
+   a->set_shader_buffers(a, PIPE_SHADER_COMPUTE, 0, 1, NULL);
+   a->bind_compute_state(a, NULL);
+   a->delete_compute_state(a, cs);
+   pipe_sampler_view_reference(&view, NULL);
+   pipe_resource_reference(&buf, NULL);
+   pipe_resource_reference(&src, NULL);
+   pipe_resource_reference(&dst, NULL);
+   a->destroy(a);
+
+   return success;
+}
+
+
+boolean
+test_all(unsigned verbose, FILE *fp)
+{
+   struct pipe_screen *screen = create_screen();
+   boolean success = TRUE;
+   boolean result;
+
+   if (!screen)
+      return FALSE;
+
+   result = test_render_then_read(screen, verbose);
+   if (!result) {
+      printf("render then read from another context failed\n");
+      success = FALSE;
+   }
+   if (fp)
+      write_tsv_row(fp, "render_then_read", result);
+
+   result = test_sample_then_write(screen, verbose);
+   if (!result) {
+      printf("sample then write from another context failed\n");
+      success = FALSE;
+   }
+   if (fp)
+      write_tsv_row(fp, "sample_then_write", result);
+
+   result = test_empty_tiles(screen, verbose);
+   if (!result) {
+      printf("empty-tiles query failed\n");
+      success = FALSE;
+   }
+   if (fp)
+      write_tsv_row(fp, "empty_tiles", result);
+
+   result = test_launch_grid(screen, verbose);
+   if (!result) {
+      printf("compute shader launch failed\n");
+      success = FALSE;
+   }
+   if (fp)
+      write_tsv_row(fp, "launch_grid", result);
+
+   screen->destroy(screen);
+
+   return success;
+}
+
+
+boolean
+test_some(unsigned verbose, FILE *fp,
+          unsigned long n)
+{
+   return test_all(verbose, fp);
+}
+
+
+boolean
+test_single(unsigned verbose, FILE *fp)
+{
+   printf("no test_single()");
+   return TRUE;
+}
@@ -0,0 +1,498 @@
+/**************************************************************************
+ *
+ * Copyright 2019 The Mesa Authors
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL VMWARE AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+
+/**
+ * @file
+ * Unit tests and benchmark for the depth test LLVM IR generation.
+ *
+ * Runs the swizzled depth load, depth test and swizzled depth store over a
+ * whole 4x4 block, the way the fragment shader does, with 4, 8 and 16 wide
+ * vectors, so the cost per pixel of the different vector widths can be
+ * compared.
+ */
+
+#include <math.h>
+
+#include "util/u_memory.h"
+#include "util/u_format.h"
+
+#include "gallivm/lp_bld_init.h"
+#include "gallivm/lp_bld_type.h"
+#include "gallivm/lp_bld_const.h"
+#include "gallivm/lp_bld_flow.h"
+#include "gallivm/lp_bld_debug.h"
+#include "lp_bld_depth.h"
+#include "lp_test.h"
+
+
+#define DEPTH_STRIDE 64
+
+
+typedef void (*depth_test_ptr_t)(const float *z_src, void *depth,
+                                 int32_t depth_stride, uint32_t *mask);
+
+
+void
+write_tsv_header(FILE *fp)
+{
+   fprintf(fp,
+           "result\t"
+           "cycles_per_pixel\t"
+           "type\t"
+           "format\n");
+
+   fflush(fp);
+}
+
+
+static void
+write_tsv_row(FILE *fp,
+              enum pipe_format format,
+              struct lp_type type,
+              double cycles,
+              boolean success)
+{
+   fprintf(fp, "%s\t", success ? "pass" : "fail");
+
+   fprintf(fp, "%.1f\t", cycles / 16);
+
+   fprintf(fp, "f%ux%u\t", type.width, type.length);
+
+   fprintf(fp, "%s\n", util_format_name(format));
+
+   fflush(fp);
+}
+
+
+static void
+dump_depth_type(FILE *fp,
+                enum pipe_format format,
+                struct lp_type type)
+{
+   fprintf(fp, " type=f%ux%u format=%s ...\n",
+           type.width, type.length, util_format_name(format));
+   fflush(fp);
+}
+
+
+/**
+ * Pixel of a 4x4 block for an element of the fragment shader vectors,
+ * which hold 2x2 quads in turn.
+ */
+static void
+quad_elem_to_pixel(unsigned elem, unsigned *x, unsigned *y)
+{
+   unsigned quad = elem / 4;
+   *x = (quad & 1) * 2 + (elem & 1);
+   *y = (quad >> 1) * 2 + ((elem >> 1) & 1);
+}
+
+
+/**
+ * Build a function doing a GL_LESS depth test with depth writes for a
+ * 4x4 block, looping over it in vectors of the given type like the
+ * fragment shader does.
+ */
+static LLVMValueRef
+add_depth_test(struct gallivm_state *gallivm,
+               enum pipe_format format,
+               struct lp_type type)
+{
+   LLVMModuleRef module = gallivm->module;
+   LLVMContextRef context = gallivm->context;
+   LLVMBuilderRef builder;
+   const struct util_format_description *desc = util_format_description(format);
+   struct lp_type int_type = lp_int_type(type);
+   struct pipe_depth_state depth;
+   struct pipe_stencil_state stencil[2];
+   LLVMTypeRef args[4];
+   LLVMValueRef func;
+   LLVMValueRef z_src_ptr, depth_ptr, depth_stride, mask_ptr;
+   LLVMValueRef stencil_refs[2];
+   LLVMBasicBlockRef block;
+   unsigned i;
+
+   memset(&depth, 0, sizeof depth);
+   depth.enabled = 1;
+   depth.writemask = 1;
+   depth.func = PIPE_FUNC_LESS;
+   memset(stencil, 0, sizeof stencil);
+
+   args[0] = LLVMPointerType(LLVMFloatTypeInContext(context), 0);
+   args[1] = LLVMPointerType(LLVMInt8TypeInContext(context), 0);
+   args[2] = LLVMInt32TypeInContext(context);
+   args[3] = LLVMPointerType(LLVMInt32TypeInContext(context), 0);
+   func = LLVMAddFunction(module, "test",
+                          LLVMFunctionType(LLVMVoidTypeInContext(context),
+                                           args, 4, 0));
+   LLVMSetFunctionCallConv(func, LLVMCCallConv);
+   z_src_ptr = LLVMGetParam(func, 0);
+   depth_ptr = LLVMGetParam(func, 1);
+   depth_stride = LLVMGetParam(func, 2);
+   mask_ptr = LLVMGetParam(func, 3);
+
+   block = LLVMAppendBasicBlockInContext(context, func, "entry");
+   builder = gallivm->builder;
+   LLVMPositionBuilderAtEnd(builder, block);
+
+   stencil_refs[0] = lp_build_const_int_vec(gallivm, int_type, 0);
+   stencil_refs[1] = stencil_refs[0];
+
+   z_src_ptr = LLVMBuildBitCast(builder, z_src_ptr,
+                                LLVMPointerType(lp_build_vec_type(gallivm, type), 0), "");
+   mask_ptr = LLVMBuildBitCast(builder, mask_ptr,
+                               LLVMPointerType(lp_build_vec_type(gallivm, int_type), 0), "");
+
+   for (i = 0; i < 16 / type.length; i++) {
+      LLVMValueRef index = lp_build_const_int32(gallivm, i);
+      struct lp_build_mask_context mask;
+      LLVMValueRef z_src, z_fb, s_fb, z_value, s_value, mask_val;
+
+      z_src = LLVMBuildLoad(builder,
+                            LLVMBuildGEP(builder, z_src_ptr, &index, 1, ""), "");
+
+      lp_build_depth_stencil_load_swizzled(gallivm, type, desc, FALSE,
+                                           depth_ptr, depth_stride,
+                                           &z_fb, &s_fb, index);
+
+      lp_build_mask_begin(&mask, gallivm, type,
+                          lp_build_const_int_vec(gallivm, int_type, ~0));
+
+      lp_build_depth_stencil_test(gallivm, &depth, stencil, type, desc,
+                                  &mask, stencil_refs, z_src, z_fb, s_fb,
+                                  NULL, &z_value, &s_value, FALSE);
+
+      lp_build_depth_stencil_write_swizzled(gallivm, type, desc, FALSE,
+                                            NULL, NULL, NULL, index,
+                                            depth_ptr, depth_stride,
+                                            z_value, s_value);
+
+      mask_val = lp_build_mask_end(&mask);
+      LLVMBuildStore(builder, mask_val,
+                     LLVMBuildGEP(builder, mask_ptr, &index, 1, ""));
+   }
+
+   LLVMBuildRetVoid(builder);
+
+   gallivm_verify_function(gallivm, func);
+
+   return func;
+}
+
+
+/**
+ * Fill the incoming fragment depths and the depth buffer.  For the unorm
+ * formats the values are chosen at least two steps apart, so the rounding
+ * of the float to unorm conversion cannot change the test outcome.
+ */
+static void
+random_depth(enum pipe_format format,
+             float *z_src,
+             uint8_t *tile)
+{
+   const struct util_format_description *desc = util_format_description(format);
+   unsigned bpp = desc->block.bits / 8;
+   unsigned zbits = desc->channel[0].size;
+   double scale = zbits == 32 ? 1.0 : (double)((1ULL << zbits) - 1);
+   unsigned x, y, i;
+
+   for (i = 0; i < 16; i++) {
+      unsigned k = (rand() % ((1 << MIN2(zbits, 20)) / 4)) * 4 + 2;
+      z_src[i] = zbits == 32 ? (float)rand() / RAND_MAX : (float)(k / scale);
+   }
+
+   for (y = 0; y < 4; y++) {
+      for (x = 0; x < 4; x++) {
+         uint8_t *pixel = tile + y * DEPTH_STRIDE + x * bpp;
+         unsigned k = (rand() % ((1 << MIN2(zbits, 20)) / 4)) * 4;
+         uint32_t bits = rand();
+
+         switch (format) {
+         case PIPE_FORMAT_Z16_UNORM:
+            *(uint16_t *)pixel = k;
+            break;
+         case PIPE_FORMAT_Z24_UNORM_S8_UINT:
+            *(uint32_t *)pixel = k | (bits & 0xff000000);
+            break;
+         case PIPE_FORMAT_Z32_FLOAT:
+            *(float *)pixel = (float)rand() / RAND_MAX;
+            break;
+         case PIPE_FORMAT_Z32_FLOAT_S8X24_UINT:
+            *(float *)pixel = (float)rand() / RAND_MAX;
+            *(uint32_t *)(pixel + 4) = bits;
+            break;
+         default:
+            assert(0);
+         }
+      }
+   }
+}
+
+
+/**
+ * Check the depth test result of one pixel against the initial buffer
+ * contents.  The stencil bits must be left alone.
+ */
+static boolean
+check_pixel(enum pipe_format format,
+            float z_src,
+            const uint8_t *before,
+            const uint8_t *after,
+            uint32_t mask)
+{
+   const struct util_format_description *desc = util_format_description(format);
+   unsigned zbits = desc->channel[0].size;
+   double scale = (double)((1ULL << MIN2(zbits, 31)) - 1);
+   boolean pass;
+
+   switch (format) {
+   case PIPE_FORMAT_Z16_UNORM:
+   case PIPE_FORMAT_Z24_UNORM_S8_UINT:
+   {
+      uint32_t zmask = (1u << zbits) - 1;
+      uint32_t old = zbits == 16 ? *(const uint16_t *)before :
+                                   *(const uint32_t *)before;
+      uint32_t res = zbits == 16 ? *(const uint16_t *)after :
+                                   *(const uint32_t *)after;
+      int64_t src = (int64_t)floor(z_src * scale + 0.5);
+
+      pass = src < (int64_t)(old & zmask);
+      if ((res & ~zmask) != (old & ~zmask))
+         return FALSE;
+      if (pass ? llabs((int64_t)(res & zmask) - src) > 1 : res != old)
+         return FALSE;
+      break;
+   }
+   case PIPE_FORMAT_Z32_FLOAT:
+   case PIPE_FORMAT_Z32_FLOAT_S8X24_UINT:
+   {
+      float old = *(const float *)before;
+      float res = *(const float *)after;
+
+      pass = z_src < old;
+      if (res != (pass ? z_src : old))
+         return FALSE;
+      /* The X24 bits next to the stencil are undefined. */
+      if (desc->block.bits > 32 &&
+          (*(const uint32_t *)(after + 4) & 0xff) !=
+          (*(const uint32_t *)(before + 4) & 0xff))
+         return FALSE;
+      break;
+   }
+   default:
+      assert(0);
+      return FALSE;
+   }
+
+   return mask == (pass ? ~0u : 0u);
+}
+
+
+PIPE_ALIGN_STACK
+static boolean
+test_one(unsigned verbose,
+         FILE *fp,
+         enum pipe_format format,
+         struct lp_type type)
+{
+   const struct util_format_description *desc = util_format_description(format);
+   const unsigned bpp = desc->block.bits / 8;
+   LLVMContextRef context;
+   struct gallivm_state *gallivm;
+   LLVMValueRef func = NULL;
+   depth_test_ptr_t depth_test_ptr;
+   boolean success;
+   const unsigned n = LP_TEST_NUM_SAMPLES;
+   int64_t cycles[LP_TEST_NUM_SAMPLES];
+   double cycles_avg = 0.0;
+   unsigned i;
+
+   if(verbose >= 1)
+      dump_depth_type(stdout, format, type);
+
+   context = LLVMContextCreate();
+   gallivm = gallivm_create("test_module", context, NULL);
+
+   func = add_depth_test(gallivm, format, type);
+
+   gallivm_compile_module(gallivm);
+
+   depth_test_ptr = (depth_test_ptr_t)gallivm_jit_function(gallivm, func);
+
+   gallivm_free_ir(gallivm);
+
+   success = TRUE;
+
+   {
+      float *z_src = align_malloc(16 * sizeof(float), 64);
+      uint32_t *mask = align_malloc(16 * sizeof(uint32_t), 64);
+      uint8_t *tile = align_malloc(4 * DEPTH_STRIDE, 64);
+      uint8_t *ref = align_malloc(4 * DEPTH_STRIDE, 64);
+
+      for(i = 0; i < n && success; ++i) {
+         int64_t start_counter = 0;
+         int64_t end_counter = 0;
+         unsigned j;
+
+         random_depth(format, z_src, tile);
+         memcpy(ref, tile, 4 * DEPTH_STRIDE);
+
+         start_counter = rdtsc();
+         depth_test_ptr(z_src, tile, DEPTH_STRIDE, mask);
+         end_counter = rdtsc();
+
+         cycles[i] = end_counter - start_counter;
+
+         for (j = 0; j < 16; j++) {
+            unsigned x, y, offset;
+
+            quad_elem_to_pixel(j, &x, &y);
+            offset = y * DEPTH_STRIDE + x * bpp;
+
+            if (!check_pixel(format, z_src[j], ref + offset, tile + offset,
+                             mask[j])) {
+               success = FALSE;
+
+               if(verbose < 1)
+                  dump_depth_type(stderr, format, type);
+               fprintf(stderr, "MISMATCH at pixel %u,%u\n", x, y);
+               fprintf(stderr, "  Src: %f\n", z_src[j]);
+               fprintf(stderr, "  Mask: 0x%08x\n", mask[j]);
+               break;
+            }
+         }
+      }
+
+      align_free(z_src);
+      align_free(mask);
+      align_free(tile);
+      align_free(ref);
+   }
+
+   /*
+    * Remove the outliers of the cycle counter, as lp_test_blend does.
+    */
+   {
+      double sum = 0.0, sum2 = 0.0;
+      double avg, std;
+      unsigned m;
+
+      for(i = 0; i < n; ++i) {
+         sum += cycles[i];
+         sum2 += cycles[i]*cycles[i];
+      }
+
+      avg = sum/n;
+      std = sqrtf((sum2 - n*avg*avg)/n);
+
+      m = 0;
+      sum = 0.0;
+      for(i = 0; i < n; ++i) {
+         if(fabs(cycles[i] - avg) <= 4.0*std) {
+            sum += cycles[i];
+            ++m;
+         }
+      }
+
+      cycles_avg = m ? sum/m : avg;
+   }
+
+   if(fp)
+      write_tsv_row(fp, format, type, cycles_avg, success);
+
+   gallivm_destroy(gallivm);
+   LLVMContextDispose(context);
+
+   return success;
+}
+
+
+const enum pipe_format
+depth_formats[] = {
+   PIPE_FORMAT_Z16_UNORM,
+   PIPE_FORMAT_Z24_UNORM_S8_UINT,
+   PIPE_FORMAT_Z32_FLOAT,
+   PIPE_FORMAT_Z32_FLOAT_S8X24_UINT,
+};
+
+
+const struct lp_type depth_types[] = {
+   /* float, fixed,  sign,  norm, width, len */
+   {   TRUE, FALSE,  TRUE, FALSE,    32,   4 }, /* f32 x 4 */
+   {   TRUE, FALSE,  TRUE, FALSE,    32,   8 }, /* f32 x 8 */
+   {   TRUE, FALSE,  TRUE, FALSE,    32,  16 }, /* f32 x 16 */
+};
+
+
+const unsigned num_formats = ARRAY_SIZE(depth_formats);
+const unsigned num_types = ARRAY_SIZE(depth_types);
+
+
+boolean
+test_all(unsigned verbose, FILE *fp)
+{
+   const enum pipe_format *format;
+   const struct lp_type *type;
+   boolean success = TRUE;
+
+   for(format = depth_formats; format < &depth_formats[num_formats]; ++format) {
+      for(type = depth_types; type < &depth_types[num_types]; ++type) {
+         if(!test_one(verbose, fp, *format, *type))
+            success = FALSE;
+      }
+   }
+
+   return success;
+}
+
+
+boolean
+test_some(unsigned verbose, FILE *fp,
+          unsigned long n)
+{
+   unsigned long i;
+   boolean success = TRUE;
+
+   for(i = 0; i < n; ++i) {
+      enum pipe_format format = depth_formats[rand() % num_formats];
+      struct lp_type type = depth_types[rand() % num_types];
+
+      if(!test_one(verbose, fp, format, type))
+         success = FALSE;
+   }
+
+   return success;
+}
+
+
+boolean
+test_single(unsigned verbose, FILE *fp)
+{
+   printf("no test_single()");
+   return TRUE;
+}
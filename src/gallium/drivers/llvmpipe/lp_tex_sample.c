@@ -46,6 +46,7 @@
 #include "gallivm/lp_bld_const.h"
 #include "gallivm/lp_bld_type.h"
 #include "gallivm/lp_bld_sample.h"
+#include "gallivm/lp_bld_struct.h"
 #include "gallivm/lp_bld_tgsi.h"
 #include "lp_jit.h"
 #include "lp_tex_sample.h"
@@ -324,3 +325,102 @@ lp_llvm_sampler_soa_create(const struct lp_sampler_static_state *static_state)
    return &sampler->base;
 }
 
+
+
+static void
+lp_llvm_mem_fetch_buffer(const struct lp_build_tgsi_mem_iface *base,
+                         struct lp_build_tgsi_context *bld_base,
+                         unsigned index,
+                         LLVMValueRef *base_ptr,
+                         LLVMValueRef *size)
+{
+   const struct lp_llvm_mem_iface *iface =
+      (const struct lp_llvm_mem_iface *)base;
+   struct gallivm_state *gallivm = bld_base->base.gallivm;
+   LLVMValueRef idx = lp_build_const_int32(gallivm, index);
+
+   assert(index < LP_MAX_TGSI_SHADER_BUFFERS);
+
+   *base_ptr = lp_build_array_get(gallivm,
+                  lp_jit_context_ssbos(gallivm, iface->context_ptr), idx);
+   *size = lp_build_array_get(gallivm,
+                  lp_jit_context_num_ssbo_bytes(gallivm, iface->context_ptr),
+                  idx);
+}
+
+
+static LLVMValueRef
+lp_llvm_image_member(struct gallivm_state *gallivm,
+                     LLVMValueRef context_ptr,
+                     unsigned image_unit,
+                     unsigned member_index,
+                     const char *member_name)
+{
+   LLVMBuilderRef builder = gallivm->builder;
+   LLVMValueRef indices[4];
+   LLVMValueRef ptr;
+   LLVMValueRef res;
+
+   /* context[0] */
+   indices[0] = lp_build_const_int32(gallivm, 0);
+   /* context[0].images */
+   indices[1] = lp_build_const_int32(gallivm, LP_JIT_CTX_IMAGES);
+   /* context[0].images[unit] */
+   indices[2] = lp_build_const_int32(gallivm, image_unit);
+   /* context[0].images[unit].member */
+   indices[3] = lp_build_const_int32(gallivm, member_index);
+
+   ptr = LLVMBuildGEP(builder, context_ptr, indices, ARRAY_SIZE(indices), "");
+   res = LLVMBuildLoad(builder, ptr, "");
+
+   lp_build_name(res, "context.image%u.%s", image_unit, member_name);
+
+   return res;
+}
+
+
+static void
+lp_llvm_mem_fetch_image(const struct lp_build_tgsi_mem_iface *base,
+                        struct lp_build_tgsi_context *bld_base,
+                        unsigned index,
+                        struct lp_build_tgsi_image *image)
+{
+   const struct lp_llvm_mem_iface *iface =
+      (const struct lp_llvm_mem_iface *)base;
+   struct gallivm_state *gallivm = bld_base->base.gallivm;
+   LLVMValueRef context_ptr = iface->context_ptr;
+
+   assert(index < LP_MAX_TGSI_SHADER_IMAGES);
+
+   image->format = iface->image_formats[index];
+   if (image->format == PIPE_FORMAT_NONE)
+      return;
+
+   image->base_ptr = lp_llvm_image_member(gallivm, context_ptr, index,
+                                          LP_JIT_IMAGE_BASE, "base");
+   image->width = lp_llvm_image_member(gallivm, context_ptr, index,
+                                       LP_JIT_IMAGE_WIDTH, "width");
+   image->height = lp_llvm_image_member(gallivm, context_ptr, index,
+                                        LP_JIT_IMAGE_HEIGHT, "height");
+   image->depth = lp_llvm_image_member(gallivm, context_ptr, index,
+                                       LP_JIT_IMAGE_DEPTH, "depth");
+   image->row_stride = lp_llvm_image_member(gallivm, context_ptr, index,
+                                            LP_JIT_IMAGE_ROW_STRIDE,
+                                            "row_stride");
+   image->img_stride = lp_llvm_image_member(gallivm, context_ptr, index,
+                                            LP_JIT_IMAGE_IMG_STRIDE,
+                                            "img_stride");
+}
+
+
+void
+lp_llvm_mem_iface_init(struct lp_llvm_mem_iface *iface,
+                       LLVMValueRef context_ptr,
+                       const uint16_t *image_formats)
+{
+   memset(iface, 0, sizeof *iface);
+   iface->base.fetch_buffer = lp_llvm_mem_fetch_buffer;
+   iface->base.fetch_image = lp_llvm_mem_fetch_image;
+   iface->context_ptr = context_ptr;
+   iface->image_formats = image_formats;
+}
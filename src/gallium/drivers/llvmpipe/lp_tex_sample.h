@@ -30,14 +30,17 @@
 
 
 #include "gallivm/lp_bld.h"
+#include "gallivm/lp_bld_tgsi.h"
 
 
 struct lp_sampler_static_state;
 
 /**
  * Whether texture cache is used for s3tc textures.
+ * RGTC and LATC, BPTC and ETC are decoded inline and never go through the
+ * cache.
  */
-#define LP_USE_TEXTURE_CACHE 0
+#define LP_USE_TEXTURE_CACHE 1
 
 /**
  * Pure-LLVM texture sampling code generator.
@@ -46,4 +49,24 @@ struct lp_sampler_static_state;
 struct lp_build_sampler_soa *
 lp_llvm_sampler_soa_create(const struct lp_sampler_static_state *key);
 
+
+/**
+ * Gives the TGSI translation access to the shader buffers and images of
+ * the lp_jit_context/lp_jit_cs_context pointed to by context_ptr.
+ */
+struct lp_llvm_mem_iface
+{
+   struct lp_build_tgsi_mem_iface base;
+
+   LLVMValueRef context_ptr;
+
+   /** Formats of the bound images, LP_MAX_TGSI_SHADER_IMAGES entries */
+   const uint16_t *image_formats;
+};
+
+void
+lp_llvm_mem_iface_init(struct lp_llvm_mem_iface *iface,
+                       LLVMValueRef context_ptr,
+                       const uint16_t *image_formats);
+
 #endif /* LP_TEX_SAMPLE_H */
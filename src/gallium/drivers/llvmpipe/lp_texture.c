@@ -43,7 +43,11 @@
 #include "util/simple_list.h"
 #include "util/u_transfer.h"
 
+#include "gallivm/lp_bld_sample.h"
+
 #include "lp_context.h"
+#include "lp_debug.h"
+#include "lp_fence.h"
 #include "lp_flush.h"
 #include "lp_screen.h"
 #include "lp_texture.h"
@@ -183,6 +187,95 @@ fail:
 }
 
 
+/**
+ * Whether the images of a texture can be stored in LP_SAMPLER_TILE_SIZE^2
+ * texel tiles, which keeps the texels of a bilinear footprint within one or
+ * two cache lines instead of spreading them over two rows.
+ *
+ * Only the fragment shader sampler knows about the tiled layout.  Textures
+ * which end up being rendered to or sampled by the draw module are
+ * converted back to linear on first such use, see
+ * llvmpipe_resource_make_linear().
+ */
+static boolean
+llvmpipe_texture_can_tile(const struct pipe_resource *pt)
+{
+   const struct util_format_description *desc =
+      util_format_description(pt->format);
+
+   if (LP_PERF & PERF_NO_TILED_TEX)
+      return FALSE;
+
+   switch (pt->target) {
+   case PIPE_TEXTURE_2D:
+   case PIPE_TEXTURE_2D_ARRAY:
+   case PIPE_TEXTURE_RECT:
+   case PIPE_TEXTURE_CUBE:
+   case PIPE_TEXTURE_CUBE_ARRAY:
+      break;
+   default:
+      return FALSE;
+   }
+
+   if (!(pt->bind & PIPE_BIND_SAMPLER_VIEW) ||
+       (pt->bind & (PIPE_BIND_DEPTH_STENCIL |
+                    PIPE_BIND_SHADER_IMAGE |
+                    PIPE_BIND_LINEAR)))
+      return FALSE;
+
+   /* The tiled offset computation works on single texels */
+   if (desc->block.width != 1 || desc->block.height != 1 ||
+       util_format_is_depth_or_stencil(pt->format))
+      return FALSE;
+
+   return pt->nr_samples <= 1;
+}
+
+
+/**
+ * Copy a rectangle of texels between a tiled texture image and linear memory.
+ * \param image  start of the tiled image (one level of one layer)
+ * \param to_tiled  copy from linear to tiled rather than the other way round
+ */
+static void
+llvmpipe_copy_tiled_rect(ubyte *image,
+                         unsigned row_stride,
+                         unsigned texel_bytes,
+                         unsigned x0, unsigned y0,
+                         unsigned width, unsigned height,
+                         ubyte *linear,
+                         unsigned linear_stride,
+                         boolean to_tiled)
+{
+   const unsigned tile_mask = LP_SAMPLER_TILE_SIZE - 1;
+   unsigned x, y;
+
+   for (y = 0; y < height; y++) {
+      unsigned ty = y0 + y;
+      ubyte *tiled_row = image + (ty & ~tile_mask) * row_stride +
+                         (ty & tile_mask) * LP_SAMPLER_TILE_SIZE * texel_bytes;
+      ubyte *linear_row = linear + y * linear_stride;
+
+      /* copy the runs of texels lying within one tile row */
+      for (x = 0; x < width; ) {
+         unsigned tx = x0 + x;
+         unsigned count = MIN2(LP_SAMPLER_TILE_SIZE - (tx & tile_mask),
+                               width - x);
+         ubyte *tiled = tiled_row +
+            ((tx & ~tile_mask) * LP_SAMPLER_TILE_SIZE + (tx & tile_mask)) *
+            texel_bytes;
+
+         if (to_tiled)
+            memcpy(tiled, linear_row + x * texel_bytes, count * texel_bytes);
+         else
+            memcpy(linear_row + x * texel_bytes, tiled, count * texel_bytes);
+
+         x += count;
+      }
+   }
+}
+
+
 /**
  * Check the size of the texture specified by 'res'.
  * \return TRUE if OK, FALSE if too large.
@@ -264,6 +357,7 @@ llvmpipe_resource_create_front(struct pipe_screen *_screen,
          /* texture map */
          if (!llvmpipe_texture_layout(screen, lpr, true))
             goto fail;
+         lpr->tiled = llvmpipe_texture_can_tile(&lpr->base);
       }
    }
    else {
@@ -320,6 +414,9 @@ llvmpipe_resource_destroy(struct pipe_screen *pscreen,
    struct llvmpipe_screen *screen = llvmpipe_screen(pscreen);
    struct llvmpipe_resource *lpr = llvmpipe_resource(pt);
 
+   lp_fence_reference(&lpr->last_write_fence, NULL);
+   lp_fence_reference(&lpr->last_use_fence, NULL);
+
    if (lpr->dt) {
       /* display target */
       struct sw_winsys *winsys = screen->winsys;
@@ -390,6 +487,8 @@ llvmpipe_resource_map(struct pipe_resource *resource,
       return map;
    }
    else if (llvmpipe_resource_is_texture(resource)) {
+      /* tiled textures are only ever accessed by the fs sampler */
+      assert(!lpr->tiled);
 
       map = llvmpipe_get_texture_image_address(lpr, layer, level);
       return map;
@@ -596,6 +695,48 @@ llvmpipe_transfer_map( struct pipe_context *pipe,
 
    format = lpr->base.format;
 
+   if (lpr->tiled) {
+      /*
+       * Hand out a linear copy of the box, which gets written back into
+       * the tiled image on unmap.
+       */
+      const unsigned texel_bytes = util_format_get_blocksize(format);
+      unsigned z;
+
+      if (usage & PIPE_TRANSFER_MAP_DIRECTLY) {
+         pipe_resource_reference(&pt->resource, NULL);
+         FREE(lpt);
+         return NULL;
+      }
+
+      pt->stride = align(box->width * texel_bytes, 16);
+      pt->layer_stride = pt->stride * box->height;
+      lpt->staging = align_malloc(pt->layer_stride * box->depth, 16);
+      if (!lpt->staging) {
+         pipe_resource_reference(&pt->resource, NULL);
+         FREE(lpt);
+         return NULL;
+      }
+
+      if (!(usage & (PIPE_TRANSFER_DISCARD_RANGE |
+                     PIPE_TRANSFER_DISCARD_WHOLE_RESOURCE))) {
+         for (z = 0; z < box->depth; z++) {
+            llvmpipe_copy_tiled_rect(
+               llvmpipe_get_texture_image_address(lpr, box->z + z, level),
+               lpr->row_stride[level], texel_bytes,
+               box->x, box->y, box->width, box->height,
+               (ubyte *) lpt->staging + z * pt->layer_stride, pt->stride,
+               FALSE);
+         }
+      }
+
+      if (usage & PIPE_TRANSFER_WRITE) {
+         screen->timestamp++;
+      }
+
+      return lpt->staging;
+   }
+
    map = llvmpipe_resource_map(resource,
                                level,
                                box->z,
@@ -623,8 +764,35 @@ static void
 llvmpipe_transfer_unmap(struct pipe_context *pipe,
                         struct pipe_transfer *transfer)
 {
+   struct llvmpipe_transfer *lpt = llvmpipe_transfer(transfer);
+
    assert(transfer->resource);
 
+   if (lpt->staging) {
+      struct llvmpipe_resource *lpr = llvmpipe_resource(transfer->resource);
+      const struct pipe_box *box = &transfer->box;
+      unsigned z;
+
+      if (transfer->usage & PIPE_TRANSFER_WRITE) {
+         for (z = 0; z < box->depth; z++) {
+            llvmpipe_copy_tiled_rect(
+               llvmpipe_get_texture_image_address(lpr, box->z + z,
+                                                  transfer->level),
+               lpr->row_stride[transfer->level],
+               util_format_get_blocksize(lpr->base.format),
+               box->x, box->y, box->width, box->height,
+               (ubyte *) lpt->staging + z * transfer->layer_stride,
+               transfer->stride,
+               TRUE);
+         }
+      }
+
+      align_free(lpt->staging);
+      pipe_resource_reference(&transfer->resource, NULL);
+      FREE(transfer);
+      return;
+   }
+
    llvmpipe_resource_unmap(transfer->resource,
                            transfer->level,
                            transfer->box.z);
@@ -747,6 +915,65 @@ llvmpipe_get_texture_image_address(struct llvmpipe_resource *lpr,
 }
 
 
+/**
+ * Convert a tiled texture to the linear layout, in place, so that it can be
+ * rendered to or sampled by the draw module.  This is a one-way switch.
+ */
+void
+llvmpipe_resource_make_linear(struct pipe_context *pipe,
+                              struct pipe_resource *resource)
+{
+   struct llvmpipe_resource *lpr = llvmpipe_resource(resource);
+   struct llvmpipe_screen *screen = llvmpipe_screen(resource->screen);
+   const unsigned texel_bytes = util_format_get_blocksize(resource->format);
+   unsigned level, layer;
+   ubyte *tmp;
+
+   if (!lpr->tiled)
+      return;
+
+   /* Queued rendering of any context may still sample the tiled images.
+    * Commands other contexts haven't flushed yet are not covered, which
+    * matches what GL requires of applications sharing textures between
+    * contexts.
+    */
+   llvmpipe_flush_resource(pipe, resource, 0,
+                           FALSE, /* read_only */
+                           TRUE, /* cpu_access */
+                           FALSE, /* do_not_block */
+                           __FUNCTION__);
+
+   tmp = align_malloc(lpr->img_stride[0], 16);
+   if (!tmp) {
+      /* not much we can do, the contents will look scrambled */
+      lpr->tiled = FALSE;
+      return;
+   }
+
+   for (level = 0; level <= resource->last_level; level++) {
+      unsigned width = u_minify(resource->width0, level);
+      unsigned height = u_minify(resource->height0, level);
+
+      for (layer = 0; layer < resource->array_size; layer++) {
+         ubyte *image = llvmpipe_get_texture_image_address(lpr, layer, level);
+
+         memcpy(tmp, image, lpr->img_stride[level]);
+         llvmpipe_copy_tiled_rect(tmp, lpr->row_stride[level], texel_bytes,
+                                  0, 0, width, height,
+                                  image, lpr->row_stride[level],
+                                  FALSE);
+      }
+   }
+
+   align_free(tmp);
+
+   lpr->tiled = FALSE;
+
+   /* Make every context pick up the new layout in its shader keys */
+   screen->timestamp++;
+}
+
+
 /**
  * Return size of resource in bytes
  */
@@ -47,6 +47,7 @@ struct pipe_screen;
 struct llvmpipe_context;
 
 struct sw_displaytarget;
+struct lp_fence;
 
 
 /**
@@ -80,6 +81,13 @@ struct llvmpipe_resource
     */
    void *tex_data;
 
+   /**
+    * Whether the texture images are stored in LP_SAMPLER_TILE_SIZE^2 texel
+    * tiles rather than linearly.  Only ever set for sampled-only 2D images,
+    * see llvmpipe_resource_make_linear().
+    */
+   boolean tiled;
+
    /**
     * Data for non-texture resources.
     */
@@ -88,6 +96,20 @@ struct llvmpipe_resource
    boolean userBuffer;  /** Is this a user-space buffer? */
    unsigned timestamp;
 
+   /**
+    * Fence of the last scene queued for rasterization which renders to
+    * this resource, from any context.  Protected by the screen's
+    * rast_mutex.
+    */
+   struct lp_fence *last_write_fence;
+
+   /**
+    * Fence of the last scene queued for rasterization which references
+    * this resource, (e.g. samples from it), from any context.  Protected
+    * by the screen's rast_mutex.
+    */
+   struct lp_fence *last_use_fence;
+
    unsigned id;  /**< temporary, for debugging */
 
 #ifdef DEBUG
@@ -102,6 +124,9 @@ struct llvmpipe_transfer
    struct pipe_transfer base;
 
    unsigned long offset;
+
+   /** Linear copy of the mapped box, for tiled textures */
+   void *staging;
 };
 
 
@@ -175,6 +200,17 @@ llvmpipe_resource_is_1d(const struct pipe_resource *resource)
 }
 
 
+/**
+ * Whether the texture of a sampler view uses the tiled layout.
+ */
+static inline boolean
+llvmpipe_sampler_view_is_tiled(const struct pipe_sampler_view *view)
+{
+   return view && view->texture &&
+          llvmpipe_resource_const(view->texture)->tiled;
+}
+
+
 static inline unsigned
 llvmpipe_layer_stride(struct pipe_resource *resource,
                       unsigned level)
@@ -220,6 +256,11 @@ llvmpipe_get_texture_image_address(struct llvmpipe_resource *lpr,
                                    unsigned face_slice, unsigned level);
 
 
+void
+llvmpipe_resource_make_linear(struct pipe_context *pipe,
+                              struct pipe_resource *resource);
+
+
 extern void
 llvmpipe_print_resources(void);
 
@@ -0,0 +1,850 @@
+/**************************************************************************
+ *
+ * Copyright 2019 The Mesa Authors
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/**
+ * Tile-parallel rasterization: binning of the vbuf primitives and the
+ * rasterization worker threads.
+ *
+ * The results are bit-exact with single threaded rendering:
+ *  - a bin is rasterized by restricting the cliprects to the bin's
+ *    rectangle, and setup computes triangle spans from the vertices rather
+ *    than by stepping, so the bins produce exactly the quads the unclipped
+ *    primitive would produce there;
+ *  - the span chunks of triangle setup are MAX_QUADS pixels wide and
+ *    aligned, so they never straddle a bin and the quads handed to the
+ *    quad pipeline are batched the same way;
+ *  - every bin's primitives are rasterized in submission order and a pixel
+ *    belongs to exactly one bin, so the per-pixel operation order is kept.
+ *
+ * The worker tile caches and the context's own tile caches never hold
+ * tiles at the same time: whichever side is about to render flushes the
+ * other one first.
+ */
+
+#include "pipe/p_defines.h"
+#include "os/os_thread.h"
+#include "tgsi/tgsi_exec.h"
+#include "util/u_math.h"
+#include "util/u_memory.h"
+#include "util/u_string.h"
+#include "util/u_thread.h"
+
+#include "sp_bin.h"
+#include "sp_context.h"
+#include "sp_flush.h"
+#include "sp_quad_pipe.h"
+#include "sp_setup.h"
+#include "sp_state.h"
+#include "sp_tex_sample.h"
+#include "sp_tex_tile_cache.h"
+#include "sp_texture.h"
+#include "sp_tile_cache.h"
+
+
+/** A binned point, line or triangle */
+struct sp_bin_prim
+{
+   const float (*v[3])[4];
+   unsigned nr_verts;
+};
+
+
+/** The primitives touching one screen tile, in submission order */
+struct sp_bin
+{
+   unsigned *prims;
+   unsigned count;
+   unsigned size;
+};
+
+
+enum sp_bin_job
+{
+   SP_BIN_JOB_RENDER,
+   SP_BIN_JOB_FLUSH
+};
+
+
+/**
+ * Per-thread rasterization state.  The thread renders with a private copy
+ * of the softpipe context in which the tile caches, the fragment shader
+ * machine and sampler, and the quad stages are replaced by its own.
+ */
+struct sp_bin_task
+{
+   struct sp_binner *binner;
+   unsigned thread_index;
+
+   struct softpipe_context *softpipe;
+   struct setup_context *setup;
+
+   struct softpipe_tile_cache *cbuf_cache[PIPE_MAX_COLOR_BUFS];
+   struct softpipe_tile_cache *zsbuf_cache;
+
+   /** Fragment shader texture caches, allocated on first use */
+   struct softpipe_tex_tile_cache *tex_cache[PIPE_MAX_SHADER_SAMPLER_VIEWS];
+   struct sp_tgsi_sampler *sampler;
+
+   struct tgsi_exec_machine *fs_machine;
+
+   struct {
+      struct quad_stage *shade;
+      struct quad_stage *depth_test;
+      struct quad_stage *blend;
+      struct quad_stage *pstipple;
+   } quad;
+
+   pipe_semaphore work_ready;
+   pipe_semaphore work_done;
+};
+
+
+struct sp_binner
+{
+   struct softpipe_context *softpipe;
+
+   unsigned num_threads;
+   struct sp_bin_task tasks[SP_MAX_THREADS];
+   thrd_t threads[SP_MAX_THREADS];
+
+   enum sp_bin_job job;
+   boolean exit_flag;
+
+   /** Whether the worker tile caches may hold tiles */
+   boolean tiles_in_tasks;
+
+   struct sp_bin_prim *prims;
+   unsigned num_prims;
+   unsigned max_prims;
+
+   struct sp_bin *bins;
+   unsigned num_bins;  /**< allocated bins */
+   unsigned bins_x, bins_y;
+
+   /** Inclusive range of the bins touched by the current batch */
+   unsigned bin_x0, bin_y0;
+   unsigned bin_x1, bin_y1;
+};
+
+
+static void
+flush_render_caches(struct softpipe_tile_cache **cbuf_cache,
+                    struct softpipe_tile_cache *zsbuf_cache)
+{
+   unsigned i;
+
+   for (i = 0; i < PIPE_MAX_COLOR_BUFS; i++)
+      sp_flush_tile_cache(cbuf_cache[i]);
+
+   sp_flush_tile_cache(zsbuf_cache);
+}
+
+
+/**
+ * Narrow the cliprects of the task's context down to the given bin.
+ */
+static void
+restrict_cliprects(struct sp_bin_task *task, unsigned bx, unsigned by)
+{
+   const struct softpipe_context *softpipe = task->binner->softpipe;
+   const unsigned x0 = bx * TILE_SIZE;
+   const unsigned y0 = by * TILE_SIZE;
+   unsigned i;
+
+   for (i = 0; i < PIPE_MAX_VIEWPORTS; i++) {
+      const struct pipe_scissor_state *clip = &softpipe->cliprect[i];
+      struct pipe_scissor_state *bin_clip = &task->softpipe->cliprect[i];
+      const unsigned minx = MAX2(clip->minx, x0);
+      const unsigned miny = MAX2(clip->miny, y0);
+
+      bin_clip->minx = minx;
+      bin_clip->miny = miny;
+      bin_clip->maxx = MAX2(MIN2(clip->maxx, x0 + TILE_SIZE), minx);
+      bin_clip->maxy = MAX2(MIN2(clip->maxy, y0 + TILE_SIZE), miny);
+   }
+}
+
+
+/**
+ * Rasterize the task's share of the bins: bin (x, y) belongs to thread
+ * (x + y) % num_threads.
+ */
+static void
+rasterize_bins(struct sp_bin_task *task)
+{
+   struct sp_binner *binner = task->binner;
+   const unsigned n = binner->num_threads;
+   unsigned bx, by, i;
+
+   for (by = binner->bin_y0; by <= binner->bin_y1; by++) {
+      bx = binner->bin_x0 +
+           (task->thread_index + n - (binner->bin_x0 + by) % n) % n;
+
+      for (; bx <= binner->bin_x1; bx += n) {
+         struct sp_bin *bin = &binner->bins[by * binner->bins_x + bx];
+
+         if (!bin->count)
+            continue;
+
+         restrict_cliprects(task, bx, by);
+
+         for (i = 0; i < bin->count; i++) {
+            const struct sp_bin_prim *prim = &binner->prims[bin->prims[i]];
+
+            switch (prim->nr_verts) {
+            case 3:
+               sp_setup_tri(task->setup, prim->v[0], prim->v[1], prim->v[2]);
+               break;
+            case 2:
+               sp_setup_line(task->setup, prim->v[0], prim->v[1]);
+               break;
+            default:
+               sp_setup_point(task->setup, prim->v[0]);
+               break;
+            }
+         }
+
+         bin->count = 0;
+      }
+   }
+}
+
+
+/**
+ * This is the thread's main entrypoint.  Wait for a job, run it, signal
+ * that it's done.
+ */
+static int
+thread_function(void *init_data)
+{
+   struct sp_bin_task *task = (struct sp_bin_task *) init_data;
+   struct sp_binner *binner = task->binner;
+   char thread_name[16];
+
+   util_snprintf(thread_name, sizeof thread_name, "softpipe-%u",
+                 task->thread_index);
+   u_thread_setname(thread_name);
+
+   while (1) {
+      pipe_semaphore_wait(&task->work_ready);
+
+      if (binner->exit_flag)
+         break;
+
+      if (binner->job == SP_BIN_JOB_RENDER)
+         rasterize_bins(task);
+      else
+         flush_render_caches(task->cbuf_cache, task->zsbuf_cache);
+
+      pipe_semaphore_signal(&task->work_done);
+   }
+
+#ifdef _WIN32
+   pipe_semaphore_signal(&task->work_done);
+#endif
+
+   return 0;
+}
+
+
+/**
+ * Run a job on all threads and wait for them to finish it.
+ */
+static void
+run_job(struct sp_binner *binner, enum sp_bin_job job)
+{
+   unsigned i;
+
+   binner->job = job;
+
+   for (i = 0; i < binner->num_threads; i++)
+      pipe_semaphore_signal(&binner->tasks[i].work_ready);
+
+   for (i = 0; i < binner->num_threads; i++)
+      pipe_semaphore_wait(&binner->tasks[i].work_done);
+}
+
+
+/**
+ * Can the current state be rendered by the worker threads?
+ */
+static boolean
+can_bin(const struct softpipe_context *softpipe)
+{
+   const struct sp_fragment_shader_variant *fs = softpipe->fs_variant;
+
+   /* the statistics counters are updated per primitive and per quad */
+   if (softpipe->active_statistics_queries)
+      return FALSE;
+
+   if (!fs || !softpipe->framebuffer.width || !softpipe->framebuffer.height)
+      return FALSE;
+
+   /* stores from several threads would land in a different order */
+   if (fs->info.file_count[TGSI_FILE_IMAGE] ||
+       fs->info.file_count[TGSI_FILE_BUFFER] ||
+       fs->info.file_count[TGSI_FILE_MEMORY])
+      return FALSE;
+
+   return TRUE;
+}
+
+
+static boolean
+update_bins(struct sp_binner *binner)
+{
+   const struct softpipe_context *softpipe = binner->softpipe;
+   const unsigned bins_x = DIV_ROUND_UP(softpipe->framebuffer.width, TILE_SIZE);
+   const unsigned bins_y = DIV_ROUND_UP(softpipe->framebuffer.height, TILE_SIZE);
+
+   if (bins_x * bins_y > binner->num_bins) {
+      struct sp_bin *bins = CALLOC(bins_x * bins_y, sizeof *bins);
+      unsigned i;
+
+      if (!bins)
+         return FALSE;
+
+      for (i = 0; i < binner->num_bins; i++)
+         FREE(binner->bins[i].prims);
+      FREE(binner->bins);
+
+      binner->bins = bins;
+      binner->num_bins = bins_x * bins_y;
+   }
+
+   binner->bins_x = bins_x;
+   binner->bins_y = bins_y;
+
+   return TRUE;
+}
+
+
+/**
+ * Make the task's fragment sampler a copy of the context's one, but
+ * pointing to the task's own texture caches.
+ */
+static boolean
+update_task_samplers(struct sp_bin_task *task)
+{
+   struct softpipe_context *softpipe = task->binner->softpipe;
+   const struct sp_tgsi_sampler *sampler =
+      softpipe->tgsi.sampler[PIPE_SHADER_FRAGMENT];
+   unsigned i;
+
+   task->sampler->base = sampler->base;
+   memcpy(task->sampler->sp_sampler, sampler->sp_sampler,
+          sizeof sampler->sp_sampler);
+
+   for (i = 0; i < softpipe->num_sampler_views[PIPE_SHADER_FRAGMENT]; i++) {
+      struct pipe_sampler_view *view =
+         softpipe->sampler_views[PIPE_SHADER_FRAGMENT][i];
+      struct softpipe_tex_tile_cache *tc = task->tex_cache[i];
+
+      task->sampler->sp_sview[i] = sampler->sp_sview[i];
+
+      if (!view)
+         continue;
+
+      if (!tc) {
+         tc = sp_create_tex_tile_cache(&softpipe->pipe);
+         if (!tc)
+            return FALSE;
+         task->tex_cache[i] = tc;
+      }
+
+      sp_tex_tile_cache_set_sampler_view(tc, view);
+
+      if (tc->texture) {
+         struct softpipe_resource *spt = softpipe_resource(tc->texture);
+         if (spt->timestamp != tc->timestamp) {
+            sp_tex_tile_cache_validate_texture(tc);
+            tc->timestamp = spt->timestamp;
+         }
+      }
+
+      task->sampler->sp_sview[i].cache = tc;
+   }
+
+   return TRUE;
+}
+
+
+/**
+ * Copy the current context state into the task's context.
+ */
+static boolean
+prepare_task(struct sp_bin_task *task)
+{
+   struct softpipe_context *softpipe = task->binner->softpipe;
+   struct softpipe_context *sp = task->softpipe;
+   const struct sp_fragment_shader_variant *fs = softpipe->fs_variant;
+   unsigned i;
+
+   if (!update_task_samplers(task))
+      return FALSE;
+
+   memcpy(sp, softpipe, sizeof *sp);
+
+   for (i = 0; i < PIPE_MAX_COLOR_BUFS; i++)
+      sp->cbuf_cache[i] = task->cbuf_cache[i];
+   sp->zsbuf_cache = task->zsbuf_cache;
+
+   sp->tgsi.sampler[PIPE_SHADER_FRAGMENT] = task->sampler;
+   sp->fs_machine = task->fs_machine;
+
+   sp->quad.shade = task->quad.shade;
+   sp->quad.depth_test = task->quad.depth_test;
+   sp->quad.blend = task->quad.blend;
+   sp->quad.pstipple = task->quad.pstipple;
+
+   /* the state was validated by the vbuf code already */
+   sp->dirty = 0;
+
+   if (task->fs_machine->Tokens != fs->tokens) {
+      fs->prepare(fs, task->fs_machine,
+                  (struct tgsi_sampler *) task->sampler,
+                  (struct tgsi_image *)
+                     softpipe->tgsi.image[PIPE_SHADER_FRAGMENT],
+                  (struct tgsi_buffer *)
+                     softpipe->tgsi.buffer[PIPE_SHADER_FRAGMENT]);
+   }
+
+   sp_build_quad_pipeline(sp);
+   sp_setup_prepare(task->setup);
+
+   return TRUE;
+}
+
+
+/**
+ * Called by the vbuf code before it sets up the primitives of a batch.
+ * Returns TRUE if the primitives are to be binned and rasterized by the
+ * worker threads, in which case sp_bin_end() must be called at the end
+ * of the batch.
+ */
+boolean
+sp_bin_begin(struct sp_binner *binner, struct setup_context *setup)
+{
+   struct softpipe_context *softpipe = binner->softpipe;
+   unsigned i;
+
+   if (!can_bin(softpipe) || !update_bins(binner))
+      goto no_binning;
+
+   for (i = 0; i < binner->num_threads; i++) {
+      if (!prepare_task(&binner->tasks[i]))
+         goto no_binning;
+   }
+
+   if (!binner->tiles_in_tasks) {
+      flush_render_caches(softpipe->cbuf_cache, softpipe->zsbuf_cache);
+      binner->tiles_in_tasks = TRUE;
+   }
+
+   binner->num_prims = 0;
+   binner->bin_x0 = binner->bins_x;
+   binner->bin_y0 = binner->bins_y;
+   binner->bin_x1 = 0;
+   binner->bin_y1 = 0;
+
+   sp_setup_set_binner(setup, binner);
+
+   return TRUE;
+
+no_binning:
+   /* the batch is rendered by the calling thread */
+   sp_bin_flush(binner, 0);
+   return FALSE;
+}
+
+
+/**
+ * Rasterize the binned primitives of the batch.
+ */
+void
+sp_bin_end(struct sp_binner *binner, struct setup_context *setup)
+{
+   struct softpipe_context *softpipe = binner->softpipe;
+   uint64_t occlusion_count = 0;
+   unsigned i;
+
+   sp_setup_set_binner(setup, NULL);
+
+   if (!binner->num_prims)
+      return;
+
+   run_job(binner, SP_BIN_JOB_RENDER);
+
+   for (i = 0; i < binner->num_threads; i++) {
+      occlusion_count += binner->tasks[i].softpipe->occlusion_count -
+                         softpipe->occlusion_count;
+   }
+   softpipe->occlusion_count += occlusion_count;
+}
+
+
+/**
+ * Add a primitive to the bins overlapping the given window space bounds.
+ */
+static void
+bin_prim(struct sp_binner *binner,
+         float xmin, float ymin, float xmax, float ymax,
+         const float (*v0)[4],
+         const float (*v1)[4],
+         const float (*v2)[4],
+         unsigned nr_verts)
+{
+   const struct softpipe_context *softpipe = binner->softpipe;
+   const float width = (float) (softpipe->framebuffer.width - 1);
+   const float height = (float) (softpipe->framebuffer.height - 1);
+   struct sp_bin_prim *prim;
+   unsigned bx0, by0, bx1, by1, bx, by;
+
+   /* NaNs fail the comparisons and end up covering the whole surface */
+   if (!(xmin > 0.0f))
+      xmin = 0.0f;
+   if (!(ymin > 0.0f))
+      ymin = 0.0f;
+   if (!(xmax < width))
+      xmax = width;
+   if (!(ymax < height))
+      ymax = height;
+
+   if (xmin > xmax || ymin > ymax)
+      return;
+
+   if (binner->num_prims == binner->max_prims) {
+      unsigned max_prims = MAX2(binner->max_prims * 2, 256);
+      prim = REALLOC(binner->prims,
+                     binner->max_prims * sizeof *prim,
+                     max_prims * sizeof *prim);
+      if (!prim)
+         return;
+      binner->prims = prim;
+      binner->max_prims = max_prims;
+   }
+
+   prim = &binner->prims[binner->num_prims];
+   prim->v[0] = v0;
+   prim->v[1] = v1;
+   prim->v[2] = v2;
+   prim->nr_verts = nr_verts;
+
+   bx0 = (unsigned) xmin / TILE_SIZE;
+   by0 = (unsigned) ymin / TILE_SIZE;
+   bx1 = (unsigned) xmax / TILE_SIZE;
+   by1 = (unsigned) ymax / TILE_SIZE;
+
+   for (by = by0; by <= by1; by++) {
+      for (bx = bx0; bx <= bx1; bx++) {
+         struct sp_bin *bin = &binner->bins[by * binner->bins_x + bx];
+
+         if (bin->count == bin->size) {
+            unsigned size = MAX2(bin->size * 2, 16);
+            unsigned *prims = REALLOC(bin->prims,
+                                      bin->size * sizeof *prims,
+                                      size * sizeof *prims);
+            if (!prims)
+               continue;
+            bin->prims = prims;
+            bin->size = size;
+         }
+
+         bin->prims[bin->count++] = binner->num_prims;
+      }
+   }
+
+   binner->bin_x0 = MIN2(binner->bin_x0, bx0);
+   binner->bin_y0 = MIN2(binner->bin_y0, by0);
+   binner->bin_x1 = MAX2(binner->bin_x1, bx1);
+   binner->bin_y1 = MAX2(binner->bin_y1, by1);
+
+   binner->num_prims++;
+}
+
+
+void
+sp_bin_tri(struct sp_binner *binner,
+           const float (*v0)[4],
+           const float (*v1)[4],
+           const float (*v2)[4])
+{
+   /* one pixel of slack covers the pixel center offset and rounding */
+   const float xmin = MIN3(v0[0][0], v1[0][0], v2[0][0]) - 1.0f;
+   const float ymin = MIN3(v0[0][1], v1[0][1], v2[0][1]) - 1.0f;
+   const float xmax = MAX3(v0[0][0], v1[0][0], v2[0][0]) + 1.0f;
+   const float ymax = MAX3(v0[0][1], v1[0][1], v2[0][1]) + 1.0f;
+
+   bin_prim(binner, xmin, ymin, xmax, ymax, v0, v1, v2, 3);
+}
+
+
+void
+sp_bin_line(struct sp_binner *binner,
+            const float (*v0)[4],
+            const float (*v1)[4])
+{
+   const float xmin = MIN2(v0[0][0], v1[0][0]) - 1.0f;
+   const float ymin = MIN2(v0[0][1], v1[0][1]) - 1.0f;
+   const float xmax = MAX2(v0[0][0], v1[0][0]) + 1.0f;
+   const float ymax = MAX2(v0[0][1], v1[0][1]) + 1.0f;
+
+   bin_prim(binner, xmin, ymin, xmax, ymax, v0, v1, NULL, 2);
+}
+
+
+void
+sp_bin_point(struct sp_binner *binner,
+             const float (*v0)[4])
+{
+   const struct softpipe_context *softpipe = binner->softpipe;
+   const int sizeAttr = softpipe->psize_slot;
+   const float size = sizeAttr > 0 ? v0[sizeAttr][0]
+                                    : softpipe->rasterizer->point_size;
+   /* round points reach sqrt(2)/2 beyond their half size */
+   const float radius = 0.5f * size + 2.0f;
+
+   bin_prim(binner,
+            v0[0][0] - radius, v0[0][1] - radius,
+            v0[0][0] + radius, v0[0][1] + radius,
+            v0, NULL, NULL, 1);
+}
+
+
+/**
+ * Write the tiles held by the worker threads back to the surfaces, so
+ * that the calling thread can render to or read from them.
+ * With SP_FLUSH_TEXTURE_CACHE, the texture caches are invalidated too.
+ */
+void
+sp_bin_flush(struct sp_binner *binner, unsigned flags)
+{
+   unsigned i, j;
+
+   if (binner->tiles_in_tasks) {
+      run_job(binner, SP_BIN_JOB_FLUSH);
+      binner->tiles_in_tasks = FALSE;
+   }
+
+   if (flags & SP_FLUSH_TEXTURE_CACHE) {
+      for (i = 0; i < binner->num_threads; i++) {
+         struct sp_bin_task *task = &binner->tasks[i];
+         for (j = 0; j < ARRAY_SIZE(task->tex_cache); j++) {
+            if (task->tex_cache[j])
+               sp_flush_tex_tile_cache(task->tex_cache[j]);
+         }
+      }
+   }
+}
+
+
+/**
+ * Called before the context's framebuffer state changes.
+ */
+void
+sp_bin_set_framebuffer(struct sp_binner *binner,
+                       const struct pipe_framebuffer_state *fb)
+{
+   unsigned i, j;
+
+   sp_bin_flush(binner, 0);
+
+   for (i = 0; i < binner->num_threads; i++) {
+      struct sp_bin_task *task = &binner->tasks[i];
+
+      for (j = 0; j < PIPE_MAX_COLOR_BUFS; j++) {
+         sp_tile_cache_set_surface(task->cbuf_cache[j],
+                                   j < fb->nr_cbufs ? fb->cbufs[j] : NULL);
+      }
+      sp_tile_cache_set_surface(task->zsbuf_cache, fb->zsbuf);
+   }
+}
+
+
+/**
+ * Unbind a fragment shader variant which is about to be deleted from the
+ * threads' machines.
+ */
+void
+sp_bin_release_fs_variant(struct sp_binner *binner,
+                          const struct sp_fragment_shader_variant *var)
+{
+   unsigned i;
+
+   for (i = 0; i < binner->num_threads; i++) {
+      struct tgsi_exec_machine *machine = binner->tasks[i].fs_machine;
+      if (machine->Tokens == var->tokens)
+         tgsi_exec_machine_bind_shader(machine, NULL, NULL, NULL, NULL);
+   }
+}
+
+
+static void
+destroy_task(struct sp_bin_task *task)
+{
+   unsigned i;
+
+   if (task->setup)
+      sp_setup_destroy_context(task->setup);
+
+   if (task->quad.shade)
+      task->quad.shade->destroy(task->quad.shade);
+   if (task->quad.depth_test)
+      task->quad.depth_test->destroy(task->quad.depth_test);
+   if (task->quad.blend)
+      task->quad.blend->destroy(task->quad.blend);
+   if (task->quad.pstipple)
+      task->quad.pstipple->destroy(task->quad.pstipple);
+
+   if (task->fs_machine)
+      tgsi_exec_machine_destroy(task->fs_machine);
+
+   for (i = 0; i < PIPE_MAX_COLOR_BUFS; i++)
+      sp_destroy_tile_cache(task->cbuf_cache[i]);
+   sp_destroy_tile_cache(task->zsbuf_cache);
+
+   for (i = 0; i < ARRAY_SIZE(task->tex_cache); i++) {
+      if (task->tex_cache[i]) {
+         sp_tex_tile_cache_set_sampler_view(task->tex_cache[i], NULL);
+         sp_destroy_tex_tile_cache(task->tex_cache[i]);
+      }
+   }
+
+   FREE(task->sampler);
+   FREE(task->softpipe);
+}
+
+
+static boolean
+init_task(struct sp_binner *binner, unsigned index)
+{
+   struct softpipe_context *softpipe = binner->softpipe;
+   struct sp_bin_task *task = &binner->tasks[index];
+   unsigned i;
+
+   task->binner = binner;
+   task->thread_index = index;
+
+   task->softpipe = CALLOC_STRUCT(softpipe_context);
+   if (!task->softpipe)
+      return FALSE;
+
+   for (i = 0; i < PIPE_MAX_COLOR_BUFS; i++) {
+      task->cbuf_cache[i] = sp_create_tile_cache(&softpipe->pipe);
+      if (!task->cbuf_cache[i])
+         return FALSE;
+   }
+   task->zsbuf_cache = sp_create_tile_cache(&softpipe->pipe);
+
+   task->sampler = sp_create_tgsi_sampler();
+   task->fs_machine = tgsi_exec_machine_create(PIPE_SHADER_FRAGMENT);
+
+   task->quad.shade = sp_quad_shade_stage(task->softpipe);
+   task->quad.depth_test = sp_quad_depth_test_stage(task->softpipe);
+   task->quad.blend = sp_quad_blend_stage(task->softpipe);
+   task->quad.pstipple = sp_quad_polygon_stipple_stage(task->softpipe);
+
+   task->setup = sp_setup_create_context(task->softpipe);
+
+   return task->zsbuf_cache && task->sampler && task->fs_machine &&
+          task->quad.shade && task->quad.depth_test && task->quad.blend &&
+          task->quad.pstipple && task->setup;
+}
+
+
+/**
+ * Create the binner and its rasterization threads.
+ * \param num_threads  number of threads, at most SP_MAX_THREADS
+ */
+struct sp_binner *
+sp_bin_create(struct softpipe_context *softpipe, unsigned num_threads)
+{
+   struct sp_binner *binner;
+   unsigned i;
+
+   assert(num_threads > 0 && num_threads <= SP_MAX_THREADS);
+
+   binner = CALLOC_STRUCT(sp_binner);
+   if (!binner)
+      return NULL;
+
+   binner->softpipe = softpipe;
+
+   for (i = 0; i < num_threads; i++) {
+      if (!init_task(binner, i)) {
+         unsigned j;
+         for (j = 0; j <= i; j++)
+            destroy_task(&binner->tasks[j]);
+         FREE(binner);
+         return NULL;
+      }
+   }
+
+   binner->num_threads = num_threads;
+
+   for (i = 0; i < num_threads; i++) {
+      pipe_semaphore_init(&binner->tasks[i].work_ready, 0);
+      pipe_semaphore_init(&binner->tasks[i].work_done, 0);
+      binner->threads[i] = u_thread_create(thread_function,
+                                           (void *) &binner->tasks[i]);
+   }
+
+   return binner;
+}
+
+
+void
+sp_bin_destroy(struct sp_binner *binner)
+{
+   unsigned i;
+
+   /* Wake the threads up with the exit flag set so that they quit. */
+   binner->exit_flag = TRUE;
+   for (i = 0; i < binner->num_threads; i++) {
+      pipe_semaphore_signal(&binner->tasks[i].work_ready);
+   }
+
+   for (i = 0; i < binner->num_threads; i++) {
+#ifdef _WIN32
+      pipe_semaphore_wait(&binner->tasks[i].work_done);
+#else
+      thrd_join(binner->threads[i], NULL);
+#endif
+   }
+
+   for (i = 0; i < binner->num_threads; i++) {
+      pipe_semaphore_destroy(&binner->tasks[i].work_ready);
+      pipe_semaphore_destroy(&binner->tasks[i].work_done);
+      destroy_task(&binner->tasks[i]);
+   }
+
+   for (i = 0; i < binner->num_bins; i++)
+      FREE(binner->bins[i].prims);
+   FREE(binner->bins);
+   FREE(binner->prims);
+   FREE(binner);
+}
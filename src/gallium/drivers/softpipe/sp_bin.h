@@ -0,0 +1,94 @@
+/**************************************************************************
+ *
+ * Copyright 2019 The Mesa Authors
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/**
+ * Tile-parallel rasterization.
+ *
+ * With SOFTPIPE_NUM_THREADS set, the primitives of a vbuf batch are not
+ * rasterized right away but sorted into TILE_SIZE x TILE_SIZE screen bins.
+ * At the end of the batch each worker thread rasterizes the bins it owns
+ * with its own copy of the context state, tile caches, fragment shader
+ * machine and quad pipeline.  A bin always belongs to the same thread, so
+ * the threads' render tile caches never hold the same tile.
+ */
+
+#ifndef SP_BIN_H
+#define SP_BIN_H
+
+#include "pipe/p_compiler.h"
+
+
+/** Max number of rasterization threads */
+#define SP_MAX_THREADS 16
+
+
+struct pipe_framebuffer_state;
+struct setup_context;
+struct softpipe_context;
+struct sp_binner;
+struct sp_fragment_shader_variant;
+
+
+struct sp_binner *
+sp_bin_create(struct softpipe_context *softpipe, unsigned num_threads);
+
+void
+sp_bin_destroy(struct sp_binner *binner);
+
+boolean
+sp_bin_begin(struct sp_binner *binner, struct setup_context *setup);
+
+void
+sp_bin_end(struct sp_binner *binner, struct setup_context *setup);
+
+void
+sp_bin_tri(struct sp_binner *binner,
+           const float (*v0)[4],
+           const float (*v1)[4],
+           const float (*v2)[4]);
+
+void
+sp_bin_line(struct sp_binner *binner,
+            const float (*v0)[4],
+            const float (*v1)[4]);
+
+void
+sp_bin_point(struct sp_binner *binner,
+             const float (*v0)[4]);
+
+void
+sp_bin_flush(struct sp_binner *binner, unsigned flags);
+
+void
+sp_bin_set_framebuffer(struct sp_binner *binner,
+                       const struct pipe_framebuffer_state *fb);
+
+void
+sp_bin_release_fs_variant(struct sp_binner *binner,
+                          const struct sp_fragment_shader_variant *var);
+
+#endif /* SP_BIN_H */
@@ -39,6 +39,7 @@
 #include "util/u_inlines.h"
 #include "util/u_upload_mgr.h"
 #include "tgsi/tgsi_exec.h"
+#include "sp_bin.h"
 #include "sp_buffer.h"
 #include "sp_clear.h"
 #include "sp_context.h"
@@ -75,6 +76,9 @@ softpipe_destroy( struct pipe_context *pipe )
    if (softpipe->draw)
       draw_destroy( softpipe->draw );
 
+   if (softpipe->binner)
+      sp_bin_destroy(softpipe->binner);
+
    if (softpipe->quad.shade)
       softpipe->quad.shade->destroy( softpipe->quad.shade );
 
@@ -198,6 +202,7 @@ softpipe_create_context(struct pipe_screen *screen,
 {
    struct softpipe_screen *sp_screen = softpipe_screen(screen);
    struct softpipe_context *softpipe = CALLOC_STRUCT(softpipe_context);
+   unsigned num_threads;
    uint i, sh;
 
    util_init_math();
@@ -316,9 +321,26 @@ softpipe_create_context(struct pipe_screen *screen,
               (struct tgsi_buffer *)
               softpipe->tgsi.buffer[PIPE_SHADER_GEOMETRY]);
 
+   for (sh = PIPE_SHADER_TESS_CTRL; sh <= PIPE_SHADER_TESS_EVAL; sh++) {
+      draw_texture_sampler(softpipe->draw, sh,
+                           (struct tgsi_sampler *)softpipe->tgsi.sampler[sh]);
+      draw_image(softpipe->draw, sh,
+                 (struct tgsi_image *)softpipe->tgsi.image[sh]);
+      draw_buffer(softpipe->draw, sh,
+                  (struct tgsi_buffer *)softpipe->tgsi.buffer[sh]);
+   }
+
    if (debug_get_bool_option( "SOFTPIPE_NO_RAST", FALSE ))
       softpipe->no_rast = TRUE;
 
+   num_threads = debug_get_num_option("SOFTPIPE_NUM_THREADS", 0);
+   if (num_threads) {
+      softpipe->binner = sp_bin_create(softpipe,
+                                       MIN2(num_threads, SP_MAX_THREADS));
+      if (!softpipe->binner)
+         goto fail;
+   }
+
    softpipe->vbuf_backend = sp_create_vbuf_backend(softpipe);
    if (!softpipe->vbuf_backend)
       goto fail;
@@ -48,6 +48,7 @@
 
 
 struct softpipe_vbuf_render;
+struct sp_binner;
 struct draw_context;
 struct draw_stage;
 struct softpipe_tile_cache;
@@ -69,6 +70,8 @@ struct softpipe_context {
    struct sp_fragment_shader_variant *fs_variant;
    struct sp_vertex_shader *vs;
    struct sp_geometry_shader *gs;
+   struct sp_tess_ctrl_shader *tcs;
+   struct sp_tess_eval_shader *tes;
    struct sp_velems_state *velems;
    struct sp_so_state *so;
    struct sp_compute_shader *cs;
@@ -90,6 +93,7 @@ struct softpipe_context {
    struct pipe_vertex_buffer vertex_buffer[PIPE_MAX_ATTRIBS];
    struct pipe_resource *mapped_vs_tex[PIPE_MAX_SHADER_SAMPLER_VIEWS];
    struct pipe_resource *mapped_gs_tex[PIPE_MAX_SHADER_SAMPLER_VIEWS];
+   struct pipe_resource *mapped_tes_tex[PIPE_MAX_SHADER_SAMPLER_VIEWS];
 
    struct draw_so_target *so_targets[PIPE_MAX_SO_BUFFERS];
    unsigned num_so_targets;
@@ -189,6 +193,9 @@ struct softpipe_context {
 
    struct blitter_context *blitter;
 
+   /** Tile-parallel rasterization, NULL if disabled */
+   struct sp_binner *binner;
+
    boolean dirty_render_cache;
 
    struct softpipe_tile_cache *cbuf_cache[PIPE_MAX_COLOR_BUFS];
@@ -128,6 +128,9 @@ softpipe_draw_vbo(struct pipe_context *pipe,
       softpipe_prepare_geometry_sampling(sp,
                                          sp->num_sampler_views[PIPE_SHADER_GEOMETRY],
                                          sp->sampler_views[PIPE_SHADER_GEOMETRY]);
+      softpipe_prepare_tess_eval_sampling(sp,
+                                          sp->num_sampler_views[PIPE_SHADER_TESS_EVAL],
+                                          sp->sampler_views[PIPE_SHADER_TESS_EVAL]);
    }
 
    if (sp->gs && !sp->gs->shader.tokens) {
@@ -156,6 +159,7 @@ softpipe_draw_vbo(struct pipe_context *pipe,
    if (softpipe_screen(sp->pipe.screen)->use_llvm) {
       softpipe_cleanup_vertex_sampling(sp);
       softpipe_cleanup_geometry_sampling(sp);
+      softpipe_cleanup_tess_eval_sampling(sp);
    }
 
    /*
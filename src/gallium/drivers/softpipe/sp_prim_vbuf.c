@@ -36,6 +36,7 @@
  */
 
 
+#include "sp_bin.h"
 #include "sp_context.h"
 #include "sp_setup.h"
 #include "sp_state.h"
@@ -165,6 +166,8 @@ sp_vbuf_draw_elements(struct vbuf_render *vbr, const ushort *indices, uint nr)
    const void *vertex_buffer = cvbr->vertex_buffer;
    struct setup_context *setup = cvbr->setup;
    const boolean flatshade_first = softpipe->rasterizer->flatshade_first;
+   const boolean binned =
+      softpipe->binner && sp_bin_begin(softpipe->binner, setup);
    unsigned i;
 
    switch (cvbr->prim) {
@@ -345,6 +348,9 @@ sp_vbuf_draw_elements(struct vbuf_render *vbr, const ushort *indices, uint nr)
    default:
       assert(0);
    }
+
+   if (binned)
+      sp_bin_end(softpipe->binner, setup);
 }
 
 
@@ -362,6 +368,8 @@ sp_vbuf_draw_arrays(struct vbuf_render *vbr, uint start, uint nr)
    const void *vertex_buffer =
       (void *) get_vert(cvbr->vertex_buffer, start, stride);
    const boolean flatshade_first = softpipe->rasterizer->flatshade_first;
+   const boolean binned =
+      softpipe->binner && sp_bin_begin(softpipe->binner, setup);
    unsigned i;
 
    switch (cvbr->prim) {
@@ -585,6 +593,9 @@ sp_vbuf_draw_arrays(struct vbuf_render *vbr, uint start, uint nr)
    default:
       assert(0);
    }
+
+   if (binned)
+      sp_bin_end(softpipe->binner, setup);
 }
 
 /*
@@ -653,6 +664,12 @@ sp_create_vbuf_backend(struct softpipe_context *sp)
    cvbr->base.max_indices = SP_MAX_VBUF_INDEXES;
    cvbr->base.max_vertex_buffer_bytes = SP_MAX_VBUF_SIZE;
 
+   if (sp->binner) {
+      /* bigger batches amortize waking up the rasterization threads */
+      cvbr->base.max_indices = SP_MAX_VBUF_INDEXES * 4;
+      cvbr->base.max_vertex_buffer_bytes = SP_MAX_VBUF_SIZE * 16;
+   }
+
    cvbr->base.get_vertex_info = sp_vbuf_get_vertex_info;
    cvbr->base.allocate_vertices = sp_vbuf_allocate_vertices;
    cvbr->base.map_vertices = sp_vbuf_map_vertices;
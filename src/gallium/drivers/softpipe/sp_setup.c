@@ -32,6 +32,7 @@
  * \author  Brian Paul
  */
 
+#include "sp_bin.h"
 #include "sp_context.h"
 #include "sp_quad.h"
 #include "sp_quad_pipe.h"
@@ -113,6 +114,9 @@ struct setup_context {
 
    unsigned cull_face;		/* which faces cull */
    unsigned nr_vertex_attrs;
+
+   /** If set, primitives are handed to the binner instead of rendered */
+   struct sp_binner *binner;
 };
 
 
@@ -821,6 +825,11 @@ sp_setup_tri(struct setup_context *setup,
 
    if (setup->softpipe->no_rast || setup->softpipe->rasterizer->rasterizer_discard)
       return;
+
+   if (setup->binner) {
+      sp_bin_tri(setup->binner, v0, v1, v2);
+      return;
+   }
    
    det = calc_det(v0, v1, v2);
    /*
@@ -1107,6 +1116,11 @@ sp_setup_line(struct setup_context *setup,
    if (setup->softpipe->no_rast || setup->softpipe->rasterizer->rasterizer_discard)
       return;
 
+   if (setup->binner) {
+      sp_bin_line(setup->binner, v0, v1);
+      return;
+   }
+
    if (dx == 0 && dy == 0)
       return;
 
@@ -1254,6 +1268,11 @@ sp_setup_point(struct setup_context *setup,
    if (setup->softpipe->no_rast || setup->softpipe->rasterizer->rasterizer_discard)
       return;
 
+   if (setup->binner) {
+      sp_bin_point(setup->binner, v0);
+      return;
+   }
+
    assert(setup->softpipe->reduced_prim == PIPE_PRIM_POINTS);
 
    if (setup->softpipe->layer_slot > 0) {
@@ -1493,6 +1512,17 @@ sp_setup_prepare(struct setup_context *setup)
 }
 
 
+/**
+ * Route the primitives to the given binner rather than rasterizing them,
+ * or stop doing so if binner is NULL.
+ */
+void
+sp_setup_set_binner(struct setup_context *setup, struct sp_binner *binner)
+{
+   setup->binner = binner;
+}
+
+
 void
 sp_setup_destroy_context(struct setup_context *setup)
 {
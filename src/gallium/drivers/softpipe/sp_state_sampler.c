@@ -75,7 +75,8 @@ softpipe_bind_sampler_states(struct pipe_context *pipe,
       softpipe->num_samplers[shader] = j;
    }
 
-   if (shader == PIPE_SHADER_VERTEX || shader == PIPE_SHADER_GEOMETRY) {
+   if (shader == PIPE_SHADER_VERTEX || shader == PIPE_SHADER_GEOMETRY ||
+       shader == PIPE_SHADER_TESS_CTRL || shader == PIPE_SHADER_TESS_EVAL) {
       draw_set_samplers(softpipe->draw,
                         shader,
                         softpipe->samplers[shader],
@@ -143,7 +144,8 @@ softpipe_set_sampler_views(struct pipe_context *pipe,
       softpipe->num_sampler_views[shader] = j;
    }
 
-   if (shader == PIPE_SHADER_VERTEX || shader == PIPE_SHADER_GEOMETRY) {
+   if (shader == PIPE_SHADER_VERTEX || shader == PIPE_SHADER_GEOMETRY ||
+       shader == PIPE_SHADER_TESS_CTRL || shader == PIPE_SHADER_TESS_EVAL) {
       draw_set_sampler_views(softpipe->draw,
                              shader,
                              softpipe->sampler_views[shader],
@@ -315,6 +317,28 @@ softpipe_cleanup_geometry_sampling(struct softpipe_context *ctx)
 }
 
 
+/**
+ * Called during state validation when SP_NEW_TEXTURE is set.
+ */
+void
+softpipe_prepare_tess_eval_sampling(struct softpipe_context *sp,
+                                    unsigned num,
+                                    struct pipe_sampler_view **views)
+{
+   prepare_shader_sampling(sp, num, views, PIPE_SHADER_TESS_EVAL,
+                           sp->mapped_tes_tex);
+}
+
+void
+softpipe_cleanup_tess_eval_sampling(struct softpipe_context *ctx)
+{
+   unsigned i;
+   for (i = 0; i < ARRAY_SIZE(ctx->mapped_tes_tex); i++) {
+      pipe_resource_reference(&ctx->mapped_tes_tex[i], NULL);
+   }
+}
+
+
 void
 softpipe_init_sampler_funcs(struct pipe_context *pipe)
 {
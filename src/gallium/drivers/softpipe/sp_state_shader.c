@@ -29,6 +29,7 @@
 #include "sp_state.h"
 #include "sp_fs.h"
 #include "sp_texture.h"
+#include "sp_bin.h"
 
 #include "pipe/p_defines.h"
 #include "util/u_memory.h"
@@ -37,6 +38,7 @@
 #include "draw/draw_context.h"
 #include "draw/draw_vs.h"
 #include "draw/draw_gs.h"
+#include "draw/draw_tess.h"
 #include "tgsi/tgsi_dump.h"
 #include "tgsi/tgsi_scan.h"
 #include "tgsi/tgsi_parse.h"
@@ -190,6 +192,9 @@ softpipe_delete_fs_state(struct pipe_context *pipe, void *fs)
       draw_delete_fragment_shader(softpipe->draw, var->draw_shader);
 #endif
 
+      if (softpipe->binner)
+         sp_bin_release_fs_variant(softpipe->binner, var);
+
       var->delete(var, softpipe->fs_machine);
    }
 
@@ -335,6 +340,148 @@ softpipe_delete_gs_state(struct pipe_context *pipe, void *gs)
 }
 
 
+static void *
+softpipe_create_tcs_state(struct pipe_context *pipe,
+                          const struct pipe_shader_state *templ)
+{
+   struct softpipe_context *softpipe = softpipe_context(pipe);
+   struct sp_tess_ctrl_shader *state;
+
+   state = CALLOC_STRUCT(sp_tess_ctrl_shader);
+   if (!state)
+      goto fail;
+
+   state->shader = *templ;
+
+   /* copy shader tokens, the ones passed in will go away.
+    */
+   state->shader.tokens = tgsi_dup_tokens(templ->tokens);
+   if (state->shader.tokens == NULL)
+      goto fail;
+
+   state->draw_data = draw_create_tess_ctrl_shader(softpipe->draw, templ);
+   if (state->draw_data == NULL)
+      goto fail;
+
+   state->max_sampler = state->draw_data->info.file_max[TGSI_FILE_SAMPLER];
+
+   return state;
+
+fail:
+   if (state) {
+      tgsi_free_tokens(state->shader.tokens);
+      FREE( state );
+   }
+   return NULL;
+}
+
+
+static void
+softpipe_bind_tcs_state(struct pipe_context *pipe, void *tcs)
+{
+   struct softpipe_context *softpipe = softpipe_context(pipe);
+
+   softpipe->tcs = (struct sp_tess_ctrl_shader *)tcs;
+
+   draw_bind_tess_ctrl_shader(softpipe->draw,
+                              (softpipe->tcs ? softpipe->tcs->draw_data : NULL));
+
+   softpipe->dirty |= SP_NEW_TESS;
+}
+
+
+static void
+softpipe_delete_tcs_state(struct pipe_context *pipe, void *tcs)
+{
+   struct softpipe_context *softpipe = softpipe_context(pipe);
+
+   struct sp_tess_ctrl_shader *state =
+      (struct sp_tess_ctrl_shader *)tcs;
+
+   draw_delete_tess_ctrl_shader(softpipe->draw, state->draw_data);
+
+   tgsi_free_tokens(state->shader.tokens);
+   FREE(state);
+}
+
+
+static void *
+softpipe_create_tes_state(struct pipe_context *pipe,
+                          const struct pipe_shader_state *templ)
+{
+   struct softpipe_context *softpipe = softpipe_context(pipe);
+   struct sp_tess_eval_shader *state;
+
+   state = CALLOC_STRUCT(sp_tess_eval_shader);
+   if (!state)
+      goto fail;
+
+   state->shader = *templ;
+
+   /* copy shader tokens, the ones passed in will go away.
+    */
+   state->shader.tokens = tgsi_dup_tokens(templ->tokens);
+   if (state->shader.tokens == NULL)
+      goto fail;
+
+   state->draw_data = draw_create_tess_eval_shader(softpipe->draw, templ);
+   if (state->draw_data == NULL)
+      goto fail;
+
+   state->max_sampler = state->draw_data->info.file_max[TGSI_FILE_SAMPLER];
+
+   return state;
+
+fail:
+   if (state) {
+      tgsi_free_tokens(state->shader.tokens);
+      FREE( state );
+   }
+   return NULL;
+}
+
+
+static void
+softpipe_bind_tes_state(struct pipe_context *pipe, void *tes)
+{
+   struct softpipe_context *softpipe = softpipe_context(pipe);
+
+   softpipe->tes = (struct sp_tess_eval_shader *)tes;
+
+   draw_bind_tess_eval_shader(softpipe->draw,
+                              (softpipe->tes ? softpipe->tes->draw_data : NULL));
+
+   softpipe->dirty |= SP_NEW_TESS;
+}
+
+
+static void
+softpipe_delete_tes_state(struct pipe_context *pipe, void *tes)
+{
+   struct softpipe_context *softpipe = softpipe_context(pipe);
+
+   struct sp_tess_eval_shader *state =
+      (struct sp_tess_eval_shader *)tes;
+
+   draw_delete_tess_eval_shader(softpipe->draw, state->draw_data);
+
+   tgsi_free_tokens(state->shader.tokens);
+   FREE(state);
+}
+
+
+static void
+softpipe_set_tess_state(struct pipe_context *pipe,
+                        const float default_outer_level[4],
+                        const float default_inner_level[2])
+{
+   struct softpipe_context *softpipe = softpipe_context(pipe);
+
+   draw_set_tess_state(softpipe->draw, default_outer_level,
+                       default_inner_level);
+}
+
+
 static void
 softpipe_set_constant_buffer(struct pipe_context *pipe,
                              enum pipe_shader_type shader, uint index,
@@ -364,7 +511,8 @@ softpipe_set_constant_buffer(struct pipe_context *pipe,
    /* note: reference counting */
    pipe_resource_reference(&softpipe->constants[shader][index], constants);
 
-   if (shader == PIPE_SHADER_VERTEX || shader == PIPE_SHADER_GEOMETRY) {
+   if (shader == PIPE_SHADER_VERTEX || shader == PIPE_SHADER_GEOMETRY ||
+       shader == PIPE_SHADER_TESS_CTRL || shader == PIPE_SHADER_TESS_EVAL) {
       draw_set_mapped_constant_buffer(softpipe->draw, shader, index, data, size);
    }
 
@@ -443,6 +591,16 @@ softpipe_init_shader_funcs(struct pipe_context *pipe)
    pipe->bind_gs_state   = softpipe_bind_gs_state;
    pipe->delete_gs_state = softpipe_delete_gs_state;
 
+   pipe->create_tcs_state = softpipe_create_tcs_state;
+   pipe->bind_tcs_state   = softpipe_bind_tcs_state;
+   pipe->delete_tcs_state = softpipe_delete_tcs_state;
+
+   pipe->create_tes_state = softpipe_create_tes_state;
+   pipe->bind_tes_state   = softpipe_bind_tes_state;
+   pipe->delete_tes_state = softpipe_delete_tes_state;
+
+   pipe->set_tess_state = softpipe_set_tess_state;
+
    pipe->set_constant_buffer = softpipe_set_constant_buffer;
 
    pipe->create_compute_state = softpipe_create_compute_state;
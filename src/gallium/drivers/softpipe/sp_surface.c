@@ -64,6 +64,8 @@ static void sp_blit(struct pipe_context *pipe,
    util_blitter_save_vertex_elements(sp->blitter, sp->velems);
    util_blitter_save_vertex_shader(sp->blitter, sp->vs);
    util_blitter_save_geometry_shader(sp->blitter, sp->gs);
+   util_blitter_save_tessctrl_shader(sp->blitter, sp->tcs);
+   util_blitter_save_tesseval_shader(sp->blitter, sp->tes);
    util_blitter_save_so_targets(sp->blitter, sp->num_so_targets,
                      (struct pipe_stream_output_target**)sp->so_targets);
    util_blitter_save_rasterizer(sp->blitter, sp->rasterizer);
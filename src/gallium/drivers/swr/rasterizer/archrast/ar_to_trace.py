@@ -0,0 +1,255 @@
+# Copyright (C) 2019 Intel Corporation.   All Rights Reserved.
+#
+# Permission is hereby granted, free of charge, to any person obtaining a
+# copy of this software and associated documentation files (the "Software"),
+# to deal in the Software without restriction, including without limitation
+# the rights to use, copy, modify, merge, publish, distribute, sublicense,
+# and/or sell copies of the Software, and to permit persons to whom the
+# Software is furnished to do so, subject to the following conditions:
+#
+# The above copyright notice and this permission notice (including the next
+# paragraph) shall be included in all copies or substantial portions of the
+# Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+# THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+# FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+# IN THE SOFTWARE.
+
+# Converts the binary ArchRast event files (ar_event*.bin) into a Chrome
+# trace (JSON) timeline that can be opened in chrome://tracing or
+# ui.perfetto.dev. Every thread of the capture becomes a track showing its
+# frontend/backend/compute work and stalls, and every draw becomes an async
+# span from the time it was queued to the time it retired, annotated with the
+# per-draw statistics found in the capture.
+#
+#   python ar_to_trace.py -o trace.json /tmp/ar_event*.bin
+
+# Python source
+from __future__ import print_function
+import argparse
+import json
+import os
+import re
+import struct
+import sys
+
+type_formats = {
+    'bool'     : '?',
+    'uint8_t'  : 'B',
+    'int8_t'   : 'b',
+    'uint16_t' : 'H',
+    'int16_t'  : 'h',
+    'uint32_t' : 'I',
+    'int32_t'  : 'i',
+    'uint64_t' : 'Q',
+    'int64_t'  : 'q',
+    'float'    : 'f',
+    'double'   : 'd',
+}
+
+timeline_events = ('DrawQueuedEvent', 'DrawRetiredEvent', 'FrontendWorkEvent',
+                   'BackendWorkEvent', 'ComputeWorkEvent', 'WorkerStallEvent')
+
+# Must match the parsing done by codegen/gen_archrast.py so that event ids
+# line up with the generated handlers.
+def parse_protos(events, enums, filename):
+    with open(filename, 'r') as f:
+        lines = f.readlines()
+
+    idx = 0
+    while idx < len(lines):
+        line = lines[idx].rstrip()
+        idx += 1
+
+        match = re.match(r'(\s*)event(\s*)(\w+)', line)
+        if match:
+            event = {'name': match.group(3), 'fields': []}
+            while idx < len(lines):
+                line = lines[idx].rstrip()
+                idx += 1
+                field = re.match(r'(\s*)(\w+)(\s*)(\w+)', line)
+                if field:
+                    event['fields'].append((field.group(2), field.group(4)))
+                if re.match(r'(\s*)};', line):
+                    break
+            events.append(event)
+
+        match = re.match(r'(\s*)enum(\s*)(\w+)', line)
+        if match:
+            values = {}
+            value = 0
+            while idx < len(lines):
+                line = lines[idx].rstrip()
+                idx += 1
+                enum = re.match(r'\s*(\w+)\s*(=\s*(\w+))?', line)
+                if enum and not re.search(r'#if|#endif', line):
+                    if enum.group(3):
+                        value = int(enum.group(3), 0)
+                    values[value] = enum.group(1)
+                    value += 1
+                if re.match(r'(\s*)};', line):
+                    break
+            enums[match.group(3)] = values
+
+def build_decoders(events, enums):
+    decoders = {}
+    for event_id, event in enumerate(events, 1):
+        fmt = '<'
+        for (field_type, _) in event['fields']:
+            if field_type in enums:
+                fmt += 'I'
+            else:
+                fmt += type_formats[field_type]
+        decoders[event_id] = (event, struct.Struct(fmt))
+    return decoders
+
+def read_events(filename, decoders):
+    with open(filename, 'rb') as f:
+        data = f.read()
+
+    offset = 0
+    while offset + 4 <= len(data):
+        (event_id,) = struct.unpack_from('<I', data, offset)
+        offset += 4
+        if event_id not in decoders:
+            print('Warning: unknown event id %d in %s, skipping the rest of the file' %
+                  (event_id, filename), file=sys.stderr)
+            return
+        (event, decoder) = decoders[event_id]
+        if offset + decoder.size > len(data):
+            print('Warning: truncated event %s in %s' % (event['name'], filename),
+                  file=sys.stderr)
+            return
+        values = decoder.unpack_from(data, offset)
+        offset += decoder.size
+        yield (event['name'], dict(zip([name for (_, name) in event['fields']], values)))
+
+def thread_id(filename):
+    # ar_event<creator thread>_<context id>.bin
+    match = re.search(r'_(\d+)\.bin', os.path.basename(filename))
+    return int(match.group(1)) if match else 0
+
+def convert(filenames, decoders, enums):
+    stall_names = enums.get('AR_WORKER_STALL', {})
+    pid = 1
+    trace = []
+    draw_args = {}
+    base_time = None
+
+    def us(time):
+        return (time - base_time) / 1000.0
+
+    threads = []
+    for filename in filenames:
+        threads.append((thread_id(filename), list(read_events(filename, decoders))))
+
+    # Timestamps are absolute, make them relative to the first one in the capture.
+    for (_, events) in threads:
+        for (_, data) in events:
+            for key in ('time', 'startTime'):
+                if key in data and (base_time is None or data[key] < base_time):
+                    base_time = data[key]
+    if base_time is None:
+        print('Warning: no timeline events found. Was the capture made with a build '
+              'that emits them?', file=sys.stderr)
+        base_time = 0
+
+    # Per-draw statistics become arguments of the draw spans. Workers report
+    # their own counters for a draw, so those are summed up.
+    for (_, events) in threads:
+        for (name, data) in events:
+            if 'drawId' not in data or name in timeline_events:
+                continue
+            args = draw_args.setdefault(data['drawId'], {})
+            for (key, value) in data.items():
+                if key == 'drawId':
+                    continue
+                key = '%s.%s' % (name, key)
+                if name in ('DrawInfoEvent', 'DispatchEvent'):
+                    args[key] = value
+                else:
+                    args[key] = args.get(key, 0) + value
+
+    for (tid, events) in threads:
+        thread_name = 'SWR thread %d' % tid
+        last_time = base_time
+
+        for (name, data) in events:
+            if name == 'ThreadStartApiEvent':
+                thread_name = 'SWR API %d' % tid
+            elif name == 'ThreadStartWorkerEvent':
+                thread_name = 'SWR worker %d' % tid
+            elif name == 'DrawQueuedEvent':
+                args = {'drawId': data['drawId'], 'compute': data['isCompute']}
+                args.update(draw_args.get(data['drawId'], {}))
+                trace.append({'name': 'draw', 'cat': 'draw', 'ph': 'b', 'id': data['drawId'],
+                              'ts': us(data['time']), 'pid': pid, 'tid': tid, 'args': args})
+                last_time = data['time']
+            elif name == 'DrawRetiredEvent':
+                trace.append({'name': 'draw', 'cat': 'draw', 'ph': 'e', 'id': data['drawId'],
+                              'ts': us(data['time']), 'pid': pid, 'tid': tid})
+                last_time = data['time']
+            elif name == 'FrameEndEvent':
+                # Not timestamped, place it after the last draw queued by this thread.
+                trace.append({'name': 'frame %d' % data['frameId'], 'cat': 'frame', 'ph': 'i',
+                              's': 'g', 'ts': us(last_time), 'pid': pid, 'tid': tid,
+                              'args': {'nextDrawId': data['nextDrawId']}})
+            elif name in timeline_events:
+                if name == 'WorkerStallEvent':
+                    (span_name, cat) = (stall_names.get(data['reason'], 'Stall'), 'stall')
+                else:
+                    (span_name, cat) = {
+                        'FrontendWorkEvent' : ('FE', 'frontend'),
+                        'BackendWorkEvent'  : ('BE', 'backend'),
+                        'ComputeWorkEvent'  : ('CS', 'compute'),
+                    }[name]
+                args = dict((key, value) for (key, value) in data.items()
+                            if key not in ('startTime', 'endTime', 'reason'))
+                trace.append({'name': span_name, 'cat': cat, 'ph': 'X',
+                              'ts': us(data['startTime']),
+                              'dur': (data['endTime'] - data['startTime']) / 1000.0,
+                              'pid': pid, 'tid': tid, 'args': args})
+                last_time = data['endTime']
+
+        trace.append({'name': 'thread_name', 'ph': 'M', 'pid': pid, 'tid': tid,
+                      'args': {'name': thread_name}})
+        trace.append({'name': 'thread_sort_index', 'ph': 'M', 'pid': pid, 'tid': tid,
+                      'args': {'sort_index': tid}})
+
+    return trace
+
+def main():
+    curdir = os.path.dirname(os.path.abspath(__file__))
+
+    parser = argparse.ArgumentParser(description='Convert ArchRast event files to a Chrome trace.')
+    parser.add_argument('files', nargs='+', help='ArchRast event files (ar_event*.bin)')
+    parser.add_argument('--proto', '-p', help='Path to proto file',
+                        default=os.path.join(curdir, 'events.proto'))
+    parser.add_argument('--proto_private', '-pp', help='Path to private proto file',
+                        default=os.path.join(curdir, 'events_private.proto'))
+    parser.add_argument('--output', '-o', help='Output filename (i.e. trace.json)', required=True)
+    args = parser.parse_args()
+
+    for filename in (args.proto, args.proto_private):
+        if not os.path.exists(filename):
+            print('Error: Could not find proto file %s' % filename, file=sys.stderr)
+            return 1
+
+    events = []
+    enums = {}
+    parse_protos(events, enums, args.proto)
+    parse_protos(events, enums, args.proto_private)
+
+    trace = convert(args.files, build_decoders(events, enums), enums)
+
+    with open(args.output, 'w') as f:
+        json.dump({'traceEvents': trace, 'displayTimeUnit': 'ns'}, f)
+
+    return 0
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -26,6 +26,9 @@
  *
  ******************************************************************************/
 #include <atomic>
+#include <cstdarg>
+#include <mutex>
+#include <string>
 
 #include "common/os.h"
 #include "archrast/archrast.h"
@@ -548,6 +551,231 @@ namespace ArchRast
 
     };
 
+    //////////////////////////////////////////////////////////////////////////
+    /// @brief Chrome trace (JSON array format) file shared by the trace
+    ///        handlers of all threads. The file stays open for the life of the
+    ///        process and the closing bracket is never written; trace viewers
+    ///        accept an unterminated array, so a trace of a process that did
+    ///        not exit cleanly is still readable.
+    class TraceFile
+    {
+    public:
+        static TraceFile& Get()
+        {
+            static TraceFile sTraceFile;
+            return sTraceFile;
+        }
+
+        // Timestamps in the trace are relative to when the file was opened.
+        uint64_t GetBaseTime() const { return mBaseTime; }
+
+        void Write(const std::string& text)
+        {
+            std::lock_guard<std::mutex> l(mMutex);
+            mFile << text;
+            mFile.flush();
+        }
+
+    private:
+        TraceFile() : mBaseTime(GetTimestamp())
+        {
+            mFile.open(KNOB_AR_TRACE_FILE, std::ios::out | std::ios::trunc);
+            if (!mFile.is_open())
+            {
+                SWR_INVALID("ArchRast: Could not open trace file!");
+                return;
+            }
+
+            mFile << "[\n";
+        }
+
+        std::mutex    mMutex;
+        std::ofstream mFile;
+        uint64_t      mBaseTime;
+    };
+
+    //////////////////////////////////////////////////////////////////////////
+    /// @brief Event handler that turns the timeline events of a thread into
+    ///        Chrome trace events. Events are buffered per thread and appended
+    ///        to the shared trace file in chunks.
+    class EventHandlerTrace : public EventHandler
+    {
+    public:
+        EventHandlerTrace(uint32_t id, AR_THREAD type) :
+            mFile(TraceFile::Get()), mId(id), mPid(GetCurrentProcessId())
+        {
+            char name[32];
+            if (type == AR_THREAD::API)
+            {
+                sprintf_s(name, "SWR API %u", id);
+            }
+            else
+            {
+                sprintf_s(name, "SWR worker %u", id);
+            }
+
+            Append("{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%u,\"tid\":%u,"
+                   "\"args\":{\"name\":\"%s\"}},\n",
+                   mPid,
+                   mId,
+                   name);
+            Append("{\"name\":\"thread_sort_index\",\"ph\":\"M\",\"pid\":%u,\"tid\":%u,"
+                   "\"args\":{\"sort_index\":%u}},\n",
+                   mPid,
+                   mId,
+                   mId);
+        }
+
+        virtual ~EventHandlerTrace() { Flush(); }
+
+        virtual void Handle(const DrawQueuedEvent& event)
+        {
+            Append("{\"name\":\"draw\",\"cat\":\"draw\",\"ph\":\"b\",\"id\":%u,\"ts\":%.3f,"
+                   "\"pid\":%u,\"tid\":%u,\"args\":{\"drawId\":%u,\"compute\":%u}},\n",
+                   event.data.drawId,
+                   ToUs(event.data.time),
+                   mPid,
+                   mId,
+                   event.data.drawId,
+                   event.data.isCompute);
+        }
+
+        virtual void Handle(const DrawRetiredEvent& event)
+        {
+            Append("{\"name\":\"draw\",\"cat\":\"draw\",\"ph\":\"e\",\"id\":%u,\"ts\":%.3f,"
+                   "\"pid\":%u,\"tid\":%u},\n",
+                   event.data.drawId,
+                   ToUs(event.data.time),
+                   mPid,
+                   mId);
+        }
+
+        virtual void Handle(const FrameEndEvent& event)
+        {
+            Append("{\"name\":\"frame %u\",\"cat\":\"frame\",\"ph\":\"i\",\"s\":\"g\","
+                   "\"ts\":%.3f,\"pid\":%u,\"tid\":%u,\"args\":{\"nextDrawId\":%u}},\n",
+                   event.data.frameId,
+                   ToUs(GetTimestamp()),
+                   mPid,
+                   mId,
+                   event.data.nextDrawId);
+        }
+
+        virtual void Handle(const SwrSyncEvent& event) { Instant("sync", event.data.drawId); }
+
+        virtual void Handle(const SwrStoreTilesEvent& event)
+        {
+            Instant("store tiles", event.data.drawId);
+        }
+
+        virtual void Handle(const FrontendWorkEvent& event)
+        {
+            Append("{\"name\":\"FE\",\"cat\":\"frontend\",\"ph\":\"X\",\"ts\":%.3f,"
+                   "\"dur\":%.3f,\"pid\":%u,\"tid\":%u,\"args\":{\"drawId\":%u}},\n",
+                   ToUs(event.data.startTime),
+                   Duration(event.data.startTime, event.data.endTime),
+                   mPid,
+                   mId,
+                   event.data.drawId);
+        }
+
+        virtual void Handle(const BackendWorkEvent& event)
+        {
+            Append("{\"name\":\"BE\",\"cat\":\"backend\",\"ph\":\"X\",\"ts\":%.3f,"
+                   "\"dur\":%.3f,\"pid\":%u,\"tid\":%u,\"args\":{\"drawId\":%u,"
+                   "\"macroTileId\":%u,\"numWorkItems\":%u}},\n",
+                   ToUs(event.data.startTime),
+                   Duration(event.data.startTime, event.data.endTime),
+                   mPid,
+                   mId,
+                   event.data.drawId,
+                   event.data.macroTileId,
+                   event.data.numWorkItems);
+        }
+
+        virtual void Handle(const ComputeWorkEvent& event)
+        {
+            Append("{\"name\":\"CS\",\"cat\":\"compute\",\"ph\":\"X\",\"ts\":%.3f,"
+                   "\"dur\":%.3f,\"pid\":%u,\"tid\":%u,\"args\":{\"drawId\":%u,"
+                   "\"numThreadGroups\":%u}},\n",
+                   ToUs(event.data.startTime),
+                   Duration(event.data.startTime, event.data.endTime),
+                   mPid,
+                   mId,
+                   event.data.drawId,
+                   event.data.numThreadGroups);
+        }
+
+        virtual void Handle(const WorkerStallEvent& event)
+        {
+            static const char* const sReasons[] = {
+                "Idle", "WaitForFrontend", "WaitForDependency", "WaitForTiles"};
+            SWR_ASSERT((uint32_t)event.data.reason < sizeof(sReasons) / sizeof(sReasons[0]));
+
+            Append("{\"name\":\"%s\",\"cat\":\"stall\",\"ph\":\"X\",\"ts\":%.3f,"
+                   "\"dur\":%.3f,\"pid\":%u,\"tid\":%u,\"args\":{\"drawId\":%u}},\n",
+                   sReasons[event.data.reason],
+                   ToUs(event.data.startTime),
+                   Duration(event.data.startTime, event.data.endTime),
+                   mPid,
+                   mId,
+                   event.data.drawId);
+        }
+
+    private:
+        double ToUs(uint64_t time) const
+        {
+            return (double)(int64_t)(time - mFile.GetBaseTime()) / 1000.0;
+        }
+
+        static double Duration(uint64_t startTime, uint64_t endTime)
+        {
+            return (double)(endTime - startTime) / 1000.0;
+        }
+
+        void Instant(const char* pName, uint32_t drawId)
+        {
+            Append("{\"name\":\"%s\",\"cat\":\"api\",\"ph\":\"i\",\"s\":\"t\",\"ts\":%.3f,"
+                   "\"pid\":%u,\"tid\":%u,\"args\":{\"drawId\":%u}},\n",
+                   pName,
+                   ToUs(GetTimestamp()),
+                   mPid,
+                   mId,
+                   drawId);
+        }
+
+        void Append(const char* pFormat, ...)
+        {
+            char    line[512];
+            va_list args;
+            va_start(args, pFormat);
+            vsnprintf(line, sizeof(line), pFormat, args);
+            va_end(args);
+
+            mBuffer += line;
+            if (mBuffer.size() >= mFlushSize)
+            {
+                Flush();
+            }
+        }
+
+        void Flush()
+        {
+            if (!mBuffer.empty())
+            {
+                mFile.Write(mBuffer);
+                mBuffer.clear();
+            }
+        }
+
+        static const size_t mFlushSize = 64 * 1024;
+
+        TraceFile&  mFile;
+        uint32_t    mId;
+        uint32_t    mPid;
+        std::string mBuffer;
+    };
+
     static EventManager* FromHandle(HANDLE hThreadContext)
     {
         return reinterpret_cast<EventManager*>(hThreadContext);
@@ -581,6 +809,11 @@ namespace ArchRast
 
             pHandler->MarkHeader();
 
+            if (!KNOB_AR_TRACE_FILE.empty())
+            {
+                pManager->Attach(new EventHandlerTrace(id, type));
+            }
+
             return pManager;
         }
 
@@ -593,6 +826,8 @@ namespace ArchRast
         EventManager* pManager = FromHandle(hThreadContext);
         SWR_ASSERT(pManager != nullptr);
 
+        pManager->EndStall(GetTimestamp());
+
         delete pManager;
     }
 
@@ -613,4 +848,20 @@ namespace ArchRast
 
         pManager->FlushDraw(drawId);
     }
+
+    void BeginStall(HANDLE hThreadContext, AR_WORKER_STALL reason, uint32_t drawId)
+    {
+        EventManager* pManager = FromHandle(hThreadContext);
+        SWR_ASSERT(pManager != nullptr);
+
+        pManager->BeginStall(reason, drawId, GetTimestamp());
+    }
+
+    void EndStall(HANDLE hThreadContext)
+    {
+        EventManager* pManager = FromHandle(hThreadContext);
+        SWR_ASSERT(pManager != nullptr);
+
+        pManager->EndStall(GetTimestamp());
+    }
 } // namespace ArchRast
@@ -31,6 +31,8 @@
 #include "gen_ar_event.hpp"
 #include "eventmanager.h"
 
+#include <chrono>
+
 namespace ArchRast
 {
     enum class AR_THREAD
@@ -45,4 +47,17 @@ namespace ArchRast
     // Dispatch event for this thread.
     void Dispatch(HANDLE hThreadContext, const Event& event);
     void FlushDraw(HANDLE hThreadContext, uint32_t drawId);
+
+    // Timeline stalls for this thread. Repeated BeginStall calls with the same
+    // reason and draw are folded into a single WorkerStallEvent.
+    void BeginStall(HANDLE hThreadContext, AR_WORKER_STALL reason, uint32_t drawId);
+    void EndStall(HANDLE hThreadContext);
+
+    // Timestamp used by timeline events, in ns.
+    INLINE uint64_t GetTimestamp()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   std::chrono::steady_clock::now().time_since_epoch())
+            .count();
+    }
 }; // namespace ArchRast
@@ -79,10 +79,40 @@ namespace ArchRast
             }
         }
 
+        void BeginStall(AR_WORKER_STALL reason, uint32_t drawId, uint64_t time)
+        {
+            if (mStallActive && mStallReason == reason && mStallDrawId == drawId)
+            {
+                return;
+            }
+
+            EndStall(time);
+
+            mStallActive    = true;
+            mStallReason    = reason;
+            mStallDrawId    = drawId;
+            mStallStartTime = time;
+        }
+
+        void EndStall(uint64_t time)
+        {
+            if (mStallActive)
+            {
+                mStallActive = false;
+                Dispatch(WorkerStallEvent(mStallDrawId, mStallReason, mStallStartTime, time));
+            }
+        }
+
     private:
         // Handlers stay registered for life
         void Detach(EventHandler* pHandler) { SWR_INVALID("Should not be called"); }
 
         std::vector<EventHandler*> mHandlers;
+
+        // Current stall of this thread, reported once it ends.
+        bool            mStallActive{false};
+        AR_WORKER_STALL mStallReason{Idle};
+        uint32_t        mStallDrawId{0};
+        uint64_t        mStallStartTime{0};
     };
 }; // namespace ArchRast
@@ -84,7 +84,8 @@ def parse_protos(protos, filename):
 
         idx = 0
 
-        eventId = 0
+        # event ids continue across proto files so that they stay unique
+        eventId = len(protos['event_names'])
         raw_text = []
         while idx < len(lines):
             line = lines[idx].rstrip()
@@ -186,10 +186,26 @@ KNOBS = [
         'category'  : 'debug',
     }],
 
+    ['AR_TRACE_FILE', {
+        'type'      : 'std::string',
+        'default'   : '',
+        'desc'      : ['When set, ArchRast also writes a Chrome trace (JSON) timeline to',
+                       'this file, showing frontend/backend work and stalls per worker',
+                       'thread and the lifetime of each draw. Open it in chrome://tracing',
+                       'or ui.perfetto.dev.',
+                       '',
+                       'NOTE: KNOB_ENABLE_AR must be enabled in core/knobs.h',
+                       'for this to have an effect.'],
+        'category'  : 'perf_adv',
+    }],
+
     ['JIT_ENABLE_CACHE', {
         'type'      : 'bool',
-        'default'   : 'false',
-        'desc'      : ['Enables caching of compiled shaders'],
+        'default'   : 'true',
+        'desc'      : ['Enables caching of compiled shaders in the Mesa shader cache',
+                       '',
+                       'NOTE: The location and maximum size of the cache are set with',
+                       '      MESA_GLSL_CACHE_DIR and MESA_GLSL_CACHE_MAX_SIZE'],
         'category'  : 'debug_adv',
     }],
 
@@ -228,13 +244,6 @@ KNOBS = [
         ],
     }],
 
-    ['JIT_CACHE_DIR', {
-        'type'      : 'std::string',
-        'default'   : r'%TEMP%\SWR\JitCache' if sys.platform == 'win32' else '${HOME}/.swr/jitcache',
-        'desc'      : ['Cache directory for compiled shaders.'],
-        'category'  : 'debug',
-    }],
-
     ['TOSS_DRAW', {
         'type'      : 'bool',
         'default'   : 'false',
@@ -241,6 +241,8 @@ void QueueWork(SWR_CONTEXT* pContext)
         InterlockedIncrement(&pContext->drawsOutstandingFE);
     }
 
+    AR_API_EVENT(DrawQueuedEvent(pDC->drawId, IsDraw ? 0 : 1, ArchRast::GetTimestamp()));
+
     _ReadWriteBarrier();
     {
         std::unique_lock<std::mutex> lock(pContext->WaitLock);
@@ -441,6 +443,11 @@ void SwrDestroyContext(HANDLE hContext)
 #endif
     }
 
+#if defined(KNOB_ENABLE_AR)
+    ArchRast::DestroyThreadContext(pContext->pArContext[pContext->NumWorkerThreads]);
+    delete[] pContext->pArContext;
+#endif
+
     delete[] pContext->ppScratch;
     AlignedFree(pContext->pStats);
 
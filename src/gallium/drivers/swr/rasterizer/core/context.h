@@ -578,9 +578,15 @@ struct SWR_CONTEXT
 #ifdef KNOB_ENABLE_AR
 #define _AR_EVENT(ctx, event) ArchRast::Dispatch(ctx, ArchRast::event)
 #define _AR_FLUSH(ctx, id) ArchRast::FlushDraw(ctx, id)
+#define _AR_BEGIN_STALL(ctx, reason, id) ArchRast::BeginStall(ctx, ArchRast::reason, id)
+#define _AR_END_STALL(ctx) ArchRast::EndStall(ctx)
+#define AR_TIMESTAMP(name) uint64_t name = ArchRast::GetTimestamp()
 #else
 #define _AR_EVENT(ctx, event)
 #define _AR_FLUSH(ctx, id)
+#define _AR_BEGIN_STALL(ctx, reason, id)
+#define _AR_END_STALL(ctx)
+#define AR_TIMESTAMP(name)
 #endif
 
 // Use these macros for api thread.
@@ -589,3 +595,5 @@ struct SWR_CONTEXT
 // Use these macros for worker threads.
 #define AR_EVENT(event) _AR_EVENT(AR_WORKER_CTX, event)
 #define AR_FLUSH(id) _AR_FLUSH(AR_WORKER_CTX, id)
+#define AR_BEGIN_STALL(reason, id) _AR_BEGIN_STALL(AR_WORKER_CTX, reason, id)
+#define AR_END_STALL() _AR_END_STALL(AR_WORKER_CTX)
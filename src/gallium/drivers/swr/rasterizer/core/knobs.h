@@ -179,6 +179,7 @@
 // Debug knobs
 ///////////////////////////////////////////////////////////////////////////////
 //#define KNOB_ENABLE_RDTSC
+//#define KNOB_ENABLE_AR
 
 // Set to 1 to use the dynamic KNOB_TOSS_XXXX knobs.
 #if !defined(KNOB_ENABLE_TOSS_POINTS)
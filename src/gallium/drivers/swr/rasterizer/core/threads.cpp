@@ -452,6 +452,8 @@ INLINE int32_t CompleteDrawContextInl(SWR_CONTEXT* pContext, uint32_t workerId,
 
     if (result == 0)
     {
+        AR_EVENT(DrawRetiredEvent(pDC->drawId, ArchRast::GetTimestamp()));
+
         ExecuteCallbacks(pContext, workerId, pDC);
 
         // Cleanup memory allocations
@@ -567,11 +569,15 @@ bool WorkOnFifoBE(SWR_CONTEXT* pContext,
         // but if there are lots of bubbles between draws then serializing FE and BE may
         // need to be revisited.
         if (!pDC->doneFE)
+        {
+            AR_BEGIN_STALL(WaitForFrontend, pDC->drawId);
             return false;
+        }
 
         // If this draw is dependent on a previous draw then we need to bail.
         if (CheckDependency(pContext, pDC, lastRetiredDraw))
         {
+            AR_BEGIN_STALL(WaitForDependency, pDC->drawId);
             return false;
         }
 
@@ -605,6 +611,8 @@ bool WorkOnFifoBE(SWR_CONTEXT* pContext,
             {
                 BE_WORK* pWork;
 
+                AR_END_STALL();
+                AR_TIMESTAMP(beStartTime);
                 RDTSC_BEGIN(WorkerFoundWork, pDC->drawId);
 
                 uint32_t numWorkItems = tile->getNumQueued();
@@ -627,6 +635,8 @@ bool WorkOnFifoBE(SWR_CONTEXT* pContext,
                     tile->dequeue();
                 }
                 RDTSC_END(WorkerFoundWork, numWorkItems);
+                AR_EVENT(BackendWorkEvent(
+                    pDC->drawId, tileID, numWorkItems, beStartTime, ArchRast::GetTimestamp()));
 
                 _ReadWriteBarrier();
 
@@ -662,6 +672,15 @@ bool WorkOnFifoBE(SWR_CONTEXT* pContext,
         }
     }
 
+#if defined(KNOB_ENABLE_AR)
+    // Whatever is left of the oldest draw is in flight on other workers.
+    if (!bShutdown && IDComparesLess(curDrawBE, drawEnqueued))
+    {
+        DRAW_CONTEXT* pDC = &pContext->dcRing[curDrawBE % pContext->MAX_DRAWS_IN_FLIGHT];
+        AR_BEGIN_STALL(WaitForTiles, pDC->drawId);
+    }
+#endif
+
     return bShutdown;
 }
 
@@ -753,7 +772,10 @@ void WorkOnFifoFE(SWR_CONTEXT* pContext, uint32_t workerId, uint32_t& curDrawFE)
             if (initial == 0)
             {
                 // successfully grabbed the DC, now run the FE
+                AR_END_STALL();
+                AR_TIMESTAMP(feStartTime);
                 pDC->FeWork.pfnWork(pContext, pDC, workerId, &pDC->FeWork.desc);
+                AR_EVENT(FrontendWorkEvent(pDC->drawId, feStartTime, ArchRast::GetTimestamp()));
 
                 CompleteDrawFE(pContext, workerId, pDC);
             }
@@ -790,6 +812,7 @@ void WorkOnCompute(SWR_CONTEXT* pContext, uint32_t workerId, uint32_t& curDrawBE
         // check dependencies
         if (CheckDependency(pContext, pDC, lastRetiredDraw))
         {
+            AR_BEGIN_STALL(WaitForDependency, pDC->drawId);
             return;
         }
 
@@ -802,12 +825,30 @@ void WorkOnCompute(SWR_CONTEXT* pContext, uint32_t workerId, uint32_t& curDrawBE
             void*    pSpillFillBuffer = nullptr;
             void*    pScratchSpace    = nullptr;
             uint32_t threadGroupId    = 0;
+#if defined(KNOB_ENABLE_AR)
+            uint32_t numThreadGroups = 0;
+            uint64_t csStartTime     = ArchRast::GetTimestamp();
+#endif
             while (queue.getWork(threadGroupId))
             {
+#if defined(KNOB_ENABLE_AR)
+                if (numThreadGroups++ == 0)
+                {
+                    AR_END_STALL();
+                }
+#endif
                 queue.dispatch(pDC, workerId, threadGroupId, pSpillFillBuffer, pScratchSpace);
                 queue.finishedWork();
             }
 
+#if defined(KNOB_ENABLE_AR)
+            if (numThreadGroups > 0)
+            {
+                AR_EVENT(ComputeWorkEvent(
+                    pDC->drawId, numThreadGroups, csStartTime, ArchRast::GetTimestamp()));
+            }
+#endif
+
             // Ensure all streaming writes are globally visible before moving onto the next draw
             _mm_mfence();
         }
@@ -910,6 +951,11 @@ DWORD workerThreadMain(LPVOID pData)
             break;
         }
 
+        if (!threadHasWork(curDrawBE))
+        {
+            _AR_BEGIN_STALL(pContext->pArContext[workerId], Idle, 0);
+        }
+
         uint32_t loop = 0;
         while (loop++ < KNOB_WORKER_SPIN_LOOP_COUNT && !threadHasWork(curDrawBE))
         {
@@ -37,6 +37,9 @@
 
 #include "gen_state_llvm.h"
 
+#include "util/disk_cache.h"
+#include "util/mesa-sha1.h"
+
 #include <sstream>
 #if defined(_WIN32)
 #include <psapi.h>
@@ -47,11 +50,6 @@
 #define JITTER_OUTPUT_DIR SWR_OUTPUT_DIR "\\Jitter"
 #endif // _WIN32
 
-#if defined(__APPLE__) || defined(FORCE_LINUX) || defined(__linux__) || defined(__gnu_linux__)
-#include <pwd.h>
-#include <sys/stat.h>
-#endif
-
 
 using namespace llvm;
 using namespace SwrJit;
@@ -522,74 +520,61 @@ void JITCALL JitDestroyContext(HANDLE hJitContext)
 /// JitCache
 //////////////////////////////////////////////////////////////////////////
 
-//////////////////////////////////////////////////////////////////////////
-/// JitCacheFileHeader
-//////////////////////////////////////////////////////////////////////////
-struct JitCacheFileHeader
+/// constructor
+JitCache::JitCache() {}
+
+JitCache::~JitCache()
 {
-    void Init(uint32_t           llCRC,
-              uint32_t           objCRC,
-              const std::string& moduleID,
-              const std::string& cpu,
-              uint32_t           optLevel,
-              uint64_t           objSize)
+    if (mpDiskCache)
     {
-        m_objSize = objSize;
-        m_llCRC   = llCRC;
-        m_objCRC  = objCRC;
-        strncpy(m_ModuleID, moduleID.c_str(), JC_STR_MAX_LEN - 1);
-        m_ModuleID[JC_STR_MAX_LEN - 1] = 0;
-        strncpy(m_Cpu, cpu.c_str(), JC_STR_MAX_LEN - 1);
-        m_Cpu[JC_STR_MAX_LEN - 1] = 0;
-        m_optLevel                = optLevel;
+        disk_cache_destroy(mpDiskCache);
     }
+}
 
+//////////////////////////////////////////////////////////////////////////
+/// @brief Open the disk cache.  Everything that changes the generated code
+///        for the same IR is hashed into the cache's driver id: the mesa and
+///        LLVM builds, the target CPU, the optimization level, the SIMD width
+///        and all knobs.
+void JitCache::Init(JitManager* pJitMgr, const llvm::StringRef& cpu, llvm::CodeGenOpt::Level level)
+{
+    mCpu      = cpu.str();
+    mpJitMgr  = pJitMgr;
+    mOptLevel = level;
 
-    bool
-    IsValid(uint32_t llCRC, const std::string& moduleID, const std::string& cpu, uint32_t optLevel)
+    uint32_t mesaTimestamp, llvmTimestamp;
+    if (!disk_cache_get_function_timestamp((void*)&JitCreateContext, &mesaTimestamp) ||
+        !disk_cache_get_function_timestamp((void*)&sys::getProcessTriple, &llvmTimestamp))
     {
-        if ((m_MagicNumber != JC_MAGIC_NUMBER) || (m_llCRC != llCRC) ||
-            (m_platformKey != JC_PLATFORM_KEY) || (m_optLevel != optLevel))
-        {
-            return false;
-        }
-
-        m_ModuleID[JC_STR_MAX_LEN - 1] = 0;
-        if (strncmp(moduleID.c_str(), m_ModuleID, JC_STR_MAX_LEN - 1))
-        {
-            return false;
-        }
-
-        m_Cpu[JC_STR_MAX_LEN - 1] = 0;
-        if (strncmp(cpu.c_str(), m_Cpu, JC_STR_MAX_LEN - 1))
-        {
-            return false;
-        }
-
-        return true;
+        return;
     }
 
-    uint64_t GetObjectSize() const { return m_objSize; }
-    uint64_t GetObjectCRC() const { return m_objCRC; }
-
-private:
-    static const uint64_t JC_MAGIC_NUMBER = 0xfedcba9876543211ULL + 4;
-    static const size_t   JC_STR_MAX_LEN  = 32;
-    static const uint32_t JC_PLATFORM_KEY = (LLVM_VERSION_MAJOR << 24) |
-                                            (LLVM_VERSION_MINOR << 16) | (LLVM_VERSION_PATCH << 8) |
-                                            ((sizeof(void*) > sizeof(uint32_t)) ? 1 : 0);
-
-    uint64_t m_MagicNumber              = JC_MAGIC_NUMBER;
-    uint64_t m_objSize                  = 0;
-    uint32_t m_llCRC                    = 0;
-    uint32_t m_platformKey              = JC_PLATFORM_KEY;
-    uint32_t m_objCRC                   = 0;
-    uint32_t m_optLevel                 = 0;
-    char     m_ModuleID[JC_STR_MAX_LEN] = {};
-    char     m_Cpu[JC_STR_MAX_LEN]      = {};
-};
-
-static inline uint32_t ComputeModuleCRC(const llvm::Module* M)
+    const uint32_t    llvmVersion = (LLVM_VERSION_MAJOR << 8) | LLVM_VERSION_MINOR;
+    const uint32_t    optLevel    = mOptLevel;
+    const uint32_t    vWidth      = pJitMgr->mVWidth;
+    const std::string knobs       = g_GlobalKnobs.ToString();
+
+    struct mesa_sha1 ctx;
+    uint8_t          sha1[20];
+    char             timestamp[41];
+
+    _mesa_sha1_init(&ctx);
+    _mesa_sha1_update(&ctx, &mesaTimestamp, sizeof(mesaTimestamp));
+    _mesa_sha1_update(&ctx, &llvmTimestamp, sizeof(llvmTimestamp));
+    _mesa_sha1_update(&ctx, &llvmVersion, sizeof(llvmVersion));
+    _mesa_sha1_update(&ctx, mCpu.c_str(), mCpu.size() + 1);
+    _mesa_sha1_update(&ctx, &optLevel, sizeof(optLevel));
+    _mesa_sha1_update(&ctx, &vWidth, sizeof(vWidth));
+    _mesa_sha1_update(&ctx, knobs.c_str(), knobs.size());
+    _mesa_sha1_final(&ctx, sha1);
+    _mesa_sha1_format(timestamp, sha1);
+
+    mpDiskCache = disk_cache_create("swr", timestamp, 0);
+}
+
+//////////////////////////////////////////////////////////////////////////
+/// @brief Cache key of a module, the hash of its bitcode.
+static void ComputeModuleKey(struct disk_cache* pCache, const llvm::Module* M, cache_key key)
 {
     std::string        bitcodeBuffer;
     raw_string_ostream bitcodeStream(bitcodeBuffer);
@@ -599,32 +584,10 @@ static inline uint32_t ComputeModuleCRC(const llvm::Module* M)
 #else
     llvm::WriteBitcodeToFile(M, bitcodeStream);
 #endif
-    // M->print(bitcodeStream, nullptr, false);
 
     bitcodeStream.flush();
 
-    return ComputeCRC(0, bitcodeBuffer.data(), bitcodeBuffer.size());
-}
-
-/// constructor
-JitCache::JitCache()
-{
-#if defined(__APPLE__) || defined(FORCE_LINUX) || defined(__linux__) || defined(__gnu_linux__)
-    if (strncmp(KNOB_JIT_CACHE_DIR.c_str(), "~/", 2) == 0)
-    {
-        char* homedir;
-        if (!(homedir = getenv("HOME")))
-        {
-            homedir = getpwuid(getuid())->pw_dir;
-        }
-        mCacheDir = homedir;
-        mCacheDir += (KNOB_JIT_CACHE_DIR.c_str() + 1);
-    }
-    else
-#endif
-    {
-        mCacheDir = KNOB_JIT_CACHE_DIR;
-    }
+    disk_cache_compute_key(pCache, bitcodeBuffer.data(), bitcodeBuffer.size(), key);
 }
 
 int ExecUnhookedProcess(const std::string& CmdLine, std::string* pStdOut, std::string* pStdErr)
@@ -636,45 +599,13 @@ int ExecUnhookedProcess(const std::string& CmdLine, std::string* pStdOut, std::s
 void JitCache::notifyObjectCompiled(const llvm::Module* M, llvm::MemoryBufferRef Obj)
 {
     const std::string& moduleID = M->getModuleIdentifier();
-    if (!moduleID.length())
+    if (!moduleID.length() || !mpDiskCache)
     {
         return;
     }
 
-    if (!llvm::sys::fs::exists(mCacheDir.str()) &&
-        llvm::sys::fs::create_directories(mCacheDir.str()))
-    {
-        SWR_INVALID("Unable to create directory: %s", mCacheDir.c_str());
-        return;
-    }
-
-    JitCacheFileHeader header;
-
-    llvm::SmallString<MAX_PATH> filePath = mCacheDir;
-    llvm::sys::path::append(filePath, moduleID);
-
-    llvm::SmallString<MAX_PATH> objPath = filePath;
-    objPath += JIT_OBJ_EXT;
-
-    {
-        std::error_code      err;
-        llvm::raw_fd_ostream fileObj(objPath.c_str(), err, llvm::sys::fs::F_None);
-        fileObj << Obj.getBuffer();
-        fileObj.flush();
-    }
-
-
-    {
-        std::error_code      err;
-        llvm::raw_fd_ostream fileObj(filePath.c_str(), err, llvm::sys::fs::F_None);
-
-        uint32_t objcrc = ComputeCRC(0, Obj.getBufferStart(), Obj.getBufferSize());
-
-        header.Init(mCurrentModuleCRC, objcrc, moduleID, mCpu, mOptLevel, Obj.getBufferSize());
-
-        fileObj.write((const char*)&header, sizeof(header));
-        fileObj.flush();
-    }
+    // getObject() computed the key of this module on the cache miss
+    disk_cache_put(mpDiskCache, mCurrentModuleKey, Obj.getBufferStart(), Obj.getBufferSize(), nullptr);
 }
 
 /// Returns a pointer to a newly allocated MemoryBuffer that contains the
@@ -683,78 +614,24 @@ void JitCache::notifyObjectCompiled(const llvm::Module* M, llvm::MemoryBufferRef
 std::unique_ptr<llvm::MemoryBuffer> JitCache::getObject(const llvm::Module* M)
 {
     const std::string& moduleID = M->getModuleIdentifier();
-    mCurrentModuleCRC           = ComputeModuleCRC(M);
-
-    if (!moduleID.length())
-    {
-        return nullptr;
-    }
 
-    if (!llvm::sys::fs::exists(mCacheDir))
+    if (!moduleID.length() || !mpDiskCache)
     {
         return nullptr;
     }
 
-    llvm::SmallString<MAX_PATH> filePath = mCacheDir;
-    llvm::sys::path::append(filePath, moduleID);
+    ComputeModuleKey(mpDiskCache, M, mCurrentModuleKey);
 
-    llvm::SmallString<MAX_PATH> objFilePath = filePath;
-    objFilePath += JIT_OBJ_EXT;
-
-    FILE* fpObjIn = nullptr;
-    FILE* fpIn    = fopen(filePath.c_str(), "rb");
-    if (!fpIn)
+    size_t size;
+    void*  pData = disk_cache_get(mpDiskCache, mCurrentModuleKey, &size);
+    if (!pData)
     {
         return nullptr;
     }
 
-    std::unique_ptr<llvm::MemoryBuffer> pBuf = nullptr;
-    do
-    {
-        JitCacheFileHeader header;
-        if (!fread(&header, sizeof(header), 1, fpIn))
-        {
-            break;
-        }
-
-        if (!header.IsValid(mCurrentModuleCRC, moduleID, mCpu, mOptLevel))
-        {
-            break;
-        }
-
-        fpObjIn = fopen(objFilePath.c_str(), "rb");
-        if (!fpObjIn)
-        {
-            break;
-        }
-
-#if LLVM_VERSION_MAJOR < 6
-        pBuf = llvm::MemoryBuffer::getNewUninitMemBuffer(size_t(header.GetObjectSize()));
-#else
-        pBuf = llvm::WritableMemoryBuffer::getNewUninitMemBuffer(size_t(header.GetObjectSize()));
-#endif
-        if (!fread(const_cast<char*>(pBuf->getBufferStart()), header.GetObjectSize(), 1, fpObjIn))
-        {
-            pBuf = nullptr;
-            break;
-        }
-
-        if (header.GetObjectCRC() != ComputeCRC(0, pBuf->getBufferStart(), pBuf->getBufferSize()))
-        {
-            SWR_TRACE("Invalid object cache file, ignoring: %s", filePath.c_str());
-            pBuf = nullptr;
-            break;
-        }
-
-    } while (0);
-
-    fclose(fpIn);
-
-    if (fpObjIn)
-    {
-        fclose(fpObjIn);
-    }
-
+    std::unique_ptr<llvm::MemoryBuffer> pBuf =
+        llvm::MemoryBuffer::getMemBufferCopy(llvm::StringRef((const char*)pData, size), moduleID);
+    free(pData);
 
     return pBuf;
 }
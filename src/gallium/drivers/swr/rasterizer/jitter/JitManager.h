@@ -85,21 +85,20 @@ struct JitLLVMContext : llvm::LLVMContext
 
 //////////////////////////////////////////////////////////////////////////
 /// JitCache
+/// @brief Object cache for the JIT, backed by Mesa's on-disk shader cache
+/// so that compiled code is shared with the shader JIT and subject to the
+/// cache's size limit and eviction.
 //////////////////////////////////////////////////////////////////////////
 struct JitManager; // Forward Decl
+struct disk_cache; // Forward Decl
 class JitCache : public llvm::ObjectCache
 {
 public:
     /// constructor
     JitCache();
-    virtual ~JitCache() {}
+    virtual ~JitCache();
 
-    void Init(JitManager* pJitMgr, const llvm::StringRef& cpu, llvm::CodeGenOpt::Level level)
-    {
-        mCpu      = cpu.str();
-        mpJitMgr  = pJitMgr;
-        mOptLevel = level;
-    }
+    void Init(JitManager* pJitMgr, const llvm::StringRef& cpu, llvm::CodeGenOpt::Level level);
 
     /// notifyObjectCompiled - Provides a pointer to compiled code for Module M.
     void notifyObjectCompiled(const llvm::Module* M, llvm::MemoryBufferRef Obj) override;
@@ -109,12 +108,15 @@ public:
     /// available.
     std::unique_ptr<llvm::MemoryBuffer> getObject(const llvm::Module* M) override;
 
+    /// Returns the disk cache, nullptr if caching is disabled.
+    struct disk_cache* GetDiskCache() const { return mpDiskCache; }
+
 private:
-    std::string                 mCpu;
-    llvm::SmallString<MAX_PATH> mCacheDir;
-    uint32_t                    mCurrentModuleCRC = 0;
-    JitManager*                 mpJitMgr          = nullptr;
-    llvm::CodeGenOpt::Level     mOptLevel         = llvm::CodeGenOpt::None;
+    std::string             mCpu;
+    struct disk_cache*      mpDiskCache = nullptr;
+    uint8_t                 mCurrentModuleKey[20] = {};
+    JitManager*             mpJitMgr  = nullptr;
+    llvm::CodeGenOpt::Level mOptLevel = llvm::CodeGenOpt::None;
 };
 
 //////////////////////////////////////////////////////////////////////////
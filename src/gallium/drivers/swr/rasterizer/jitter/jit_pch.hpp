@@ -148,9 +148,3 @@ static inline llvm::AttributeSet GetFuncAttribSet(llvm::LLVMContext&       ctx,
 #include <mutex>
 
 #include "common/os.h"
-
-#if defined(_WIN32)
-#define JIT_OBJ_EXT ".obj"
-#else
-#define JIT_OBJ_EXT ".o"
-#endif // _WIN32
@@ -36,6 +36,9 @@
 #include "functionpasses/passes.h"
 
 #include "tgsi/tgsi_strings.h"
+#include "tgsi/tgsi_parse.h"
+#include "util/disk_cache.h"
+#include "util/mesa-sha1.h"
 #include "util/u_format.h"
 #include "util/u_prim.h"
 #include "gallivm/lp_bld_init.h"
@@ -209,23 +212,68 @@ swr_generate_gs_key(struct swr_jit_gs_key &key,
    swr_generate_sampler_key(swr_gs->info, ctx, PIPE_SHADER_GEOMETRY, key);
 }
 
+/**
+ * Key of a shader variant in the JIT's disk cache.  Everything the IR
+ * depends on besides the variant key is passed in state.
+ */
+static void
+swr_shader_cache_key(const char *stage, const struct tgsi_token *tokens,
+                     const void *key, size_t key_size, unsigned state,
+                     unsigned char ir_sha1_cache_key[20])
+{
+   struct mesa_sha1 ctx;
+
+   _mesa_sha1_init(&ctx);
+   _mesa_sha1_update(&ctx, stage, strlen(stage));
+   _mesa_sha1_update(&ctx, tokens,
+                     tgsi_num_tokens(tokens) * sizeof(struct tgsi_token));
+   _mesa_sha1_update(&ctx, key, key_size);
+   _mesa_sha1_update(&ctx, &state, sizeof(state));
+   _mesa_sha1_final(&ctx, ir_sha1_cache_key);
+}
+
 struct BuilderSWR : public Builder {
-   BuilderSWR(JitManager *pJitMgr, const char *pName)
+   BuilderSWR(JitManager *pJitMgr, const char *pName,
+              const unsigned char *ir_sha1_cache_key = NULL)
       : Builder(pJitMgr)
    {
+      struct disk_cache *disk_cache = pJitMgr->mCache.GetDiskCache();
+
+      memset(&cached, 0, sizeof(cached));
+      use_cache = disk_cache && ir_sha1_cache_key;
+      if (use_cache) {
+         disk_cache_compute_key(disk_cache, ir_sha1_cache_key, 20,
+                                disk_cache_key);
+         cached.data = disk_cache_get(disk_cache, disk_cache_key,
+                                      &cached.data_size);
+         cache_hit = cached.data != NULL;
+      }
+
       pJitMgr->SetupNewModule();
-      gallivm = gallivm_create(pName, wrap(&JM()->mContext));
+      gallivm = gallivm_create(pName, wrap(&JM()->mContext),
+                               use_cache ? &cached : NULL);
       pJitMgr->mpCurrentModule = unwrap(gallivm->module);
    }
 
    ~BuilderSWR() {
+      /* cached holds the new object once the module has been jitted */
+      if (use_cache && !cache_hit && cached.data_size && !cached.dont_cache)
+         disk_cache_put(JM()->mCache.GetDiskCache(), disk_cache_key,
+                        cached.data, cached.data_size, NULL);
+
       gallivm_free_ir(gallivm);
+      free(cached.data);
    }
 
    void WriteVS(Value *pVal, Value *pVsContext, Value *pVtxOutput,
                 unsigned slot, unsigned channel);
 
    struct gallivm_state *gallivm;
+   struct lp_cached_code cached;
+   cache_key disk_cache_key;
+   bool use_cache = false;
+   bool cache_hit = false;
+
    PFN_VERTEX_FUNC CompileVS(struct swr_context *ctx, swr_jit_vs_key &key);
    PFN_PIXEL_KERNEL CompileFS(struct swr_context *ctx, swr_jit_fs_key &key);
    PFN_GS_FUNC CompileGS(struct swr_context *ctx, swr_jit_gs_key &key);
@@ -690,7 +738,8 @@ BuilderSWR::CompileGS(struct swr_context *ctx, swr_jit_gs_key &key)
                      NULL, // thread data
                      sampler,
                      &gs->info.base,
-                     &gs_iface.base);
+                     &gs_iface.base,
+                     NULL); // compute shader face
 
    lp_build_mask_end(&mask);
 
@@ -717,9 +766,14 @@ BuilderSWR::CompileGS(struct swr_context *ctx, swr_jit_gs_key &key)
 PFN_GS_FUNC
 swr_compile_gs(struct swr_context *ctx, swr_jit_gs_key &key)
 {
+   unsigned char ir_sha1_cache_key[20];
+
+   swr_shader_cache_key("gs", ctx->gs->pipe.tokens, &key, sizeof(key), 0,
+                        ir_sha1_cache_key);
+
    BuilderSWR builder(
       reinterpret_cast<JitManager *>(swr_screen(ctx->pipe.screen)->hJitMgr),
-      "GS");
+      "GS", ir_sha1_cache_key);
    PFN_GS_FUNC func = builder.CompileGS(ctx, key);
 
    ctx->gs->map.insert(std::make_pair(key, make_unique<VariantGS>(builder.gallivm, func)));
@@ -841,7 +895,8 @@ BuilderSWR::CompileVS(struct swr_context *ctx, swr_jit_vs_key &key)
                      NULL, // thread data
                      sampler, // sampler
                      &swr_vs->info.base,
-                     NULL); // geometry shader face
+                     NULL, // geometry shader face
+                     NULL); // compute shader face
 
    sampler->destroy(sampler);
 
@@ -968,12 +1023,17 @@ BuilderSWR::CompileVS(struct swr_context *ctx, swr_jit_vs_key &key)
 PFN_VERTEX_FUNC
 swr_compile_vs(struct swr_context *ctx, swr_jit_vs_key &key)
 {
+   unsigned char ir_sha1_cache_key[20];
+
    if (!ctx->vs->pipe.tokens)
       return NULL;
 
+   swr_shader_cache_key("vs", ctx->vs->pipe.tokens, &key, sizeof(key),
+                        ctx->rasterizer->clip_plane_enable, ir_sha1_cache_key);
+
    BuilderSWR builder(
       reinterpret_cast<JitManager *>(swr_screen(ctx->pipe.screen)->hJitMgr),
-      "VS");
+      "VS", ir_sha1_cache_key);
    PFN_VERTEX_FUNC func = builder.CompileVS(ctx, key);
 
    ctx->vs->map.insert(std::make_pair(key, make_unique<VariantVS>(builder.gallivm, func)));
@@ -1331,7 +1391,8 @@ BuilderSWR::CompileFS(struct swr_context *ctx, swr_jit_fs_key &key)
                      NULL, // thread data
                      sampler, // sampler
                      &swr_fs->info.base,
-                     NULL); // geometry shader face
+                     NULL, // geometry shader face
+                     NULL); // compute shader face
 
    sampler->destroy(sampler);
 
@@ -1418,12 +1479,17 @@ BuilderSWR::CompileFS(struct swr_context *ctx, swr_jit_fs_key &key)
 PFN_PIXEL_KERNEL
 swr_compile_fs(struct swr_context *ctx, swr_jit_fs_key &key)
 {
+   unsigned char ir_sha1_cache_key[20];
+
    if (!ctx->fs->pipe.tokens)
       return NULL;
 
+   swr_shader_cache_key("fs", ctx->fs->pipe.tokens, &key, sizeof(key),
+                        ctx->gs != NULL, ir_sha1_cache_key);
+
    BuilderSWR builder(
       reinterpret_cast<JitManager *>(swr_screen(ctx->pipe.screen)->hJitMgr),
-      "FS");
+      "FS", ir_sha1_cache_key);
    PFN_PIXEL_KERNEL func = builder.CompileFS(ctx, key);
 
    ctx->fs->map.insert(std::make_pair(key, make_unique<VariantFS>(builder.gallivm, func)));
@@ -0,0 +1,477 @@
+/**************************************************************************
+ *
+ * Copyright 2019 The Mesa Authors
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/*
+ * Tessellates triangle, quad and isoline domains for all spacing modes and
+ * a range of inner and outer levels, including the clamping, rounding and
+ * culling edge cases, and checks that:
+ *
+ * - every outer edge is split into the number of segments the GL spec
+ *   asks for, at positions symmetric around its middle,
+ * - all points lie in the domain and are referenced,
+ * - the triangles cover the domain exactly once, all with the same
+ *   winding, which flips with the vertex order,
+ * - point mode emits every point once, and the padding is zeroed.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "draw/draw_tessellator.h"
+#include "util/u_math.h"
+#include "util/u_memory.h"
+
+
+#define EPS 1e-5f
+
+static unsigned failures;
+
+#define CHECK(cond, ...)                                   \
+   do {                                                    \
+      if (!(cond)) {                                       \
+         printf("FAILED: %s: ", #cond);                    \
+         printf(__VA_ARGS__);                              \
+         printf("\n");                                     \
+         failures++;                                       \
+         return;                                           \
+      }                                                    \
+   } while (0)
+
+
+static const char *
+spacing_name(enum pipe_tess_spacing spacing)
+{
+   switch (spacing) {
+   case PIPE_TESS_SPACING_FRACTIONAL_ODD:
+      return "fractional_odd";
+   case PIPE_TESS_SPACING_FRACTIONAL_EVEN:
+      return "fractional_even";
+   default:
+      return "equal";
+   }
+}
+
+
+static float
+clamped_level(float level, enum pipe_tess_spacing spacing)
+{
+   switch (spacing) {
+   case PIPE_TESS_SPACING_FRACTIONAL_ODD:
+      return CLAMP(level, 1.0f, DRAW_TESS_MAX_LEVEL - 1);
+   case PIPE_TESS_SPACING_FRACTIONAL_EVEN:
+      return CLAMP(level, 2.0f, DRAW_TESS_MAX_LEVEL);
+   default:
+      return CLAMP(level, 1.0f, DRAW_TESS_MAX_LEVEL);
+   }
+}
+
+/**
+ * Number of segments an edge with the given level is split into, from the
+ * GL 4.6 spec, section 11.2.2.
+ */
+static unsigned
+expected_segments(float level, enum pipe_tess_spacing spacing)
+{
+   level = clamped_level(level, spacing);
+
+   switch (spacing) {
+   case PIPE_TESS_SPACING_FRACTIONAL_ODD:
+      return 2 * (unsigned) ceilf((level - 1.0f) / 2.0f) + 1;
+   case PIPE_TESS_SPACING_FRACTIONAL_EVEN:
+      return 2 * (unsigned) ceilf(level / 2.0f);
+   default:
+      return (unsigned) ceilf(level);
+   }
+}
+
+
+static int
+compare_float(const void *a, const void *b)
+{
+   const float fa = *(const float *) a, fb = *(const float *) b;
+
+   return fa < fb ? -1 : fa > fb;
+}
+
+
+/**
+ * Collect the positions along the outer edge where coordinate \p c is zero
+ * (or one when \p one is set), sorted, and compare them with the expected
+ * subdivision.
+ */
+static void
+check_edge(const struct draw_tessellator *tess, unsigned c, boolean one,
+           unsigned along, float level, enum pipe_tess_spacing spacing,
+           const char *name)
+{
+   const float *coord[3] = { tess->u, tess->v, tess->w };
+   const float value = one ? 1.0f : 0.0f;
+   const unsigned segs = expected_segments(level, spacing);
+   float t[DRAW_TESS_MAX_LEVEL + 2];
+   unsigned n = 0, i;
+
+   for (i = 0; i < tess->num_points; i++) {
+      if (coord[c][i] == value) {
+         CHECK(n <= segs, "%s: too many points on edge %u = %.0f",
+               name, c, value);
+         t[n++] = coord[along][i];
+      }
+   }
+
+   CHECK(n == segs + 1, "%s: edge %u = %.0f has %u points, expected %u",
+         name, c, value, n, segs + 1);
+
+   qsort(t, n, sizeof(float), compare_float);
+   CHECK(t[0] == 0.0f && t[n - 1] == 1.0f,
+         "%s: edge %u = %.0f doesn't reach the corners", name, c, value);
+   for (i = 0; i < n; i++) {
+      CHECK(fabsf(t[i] + t[n - 1 - i] - 1.0f) < EPS,
+            "%s: edge %u = %.0f is not symmetric", name, c, value);
+      CHECK(i == 0 || t[i] > t[i - 1],
+            "%s: edge %u = %.0f has repeated points", name, c, value);
+   }
+
+   /* all but the two segments at the ends have length 1 / level */
+   if (spacing != PIPE_TESS_SPACING_EQUAL && segs > 2) {
+      level = clamped_level(level, spacing);
+      for (i = 2; i < n - 2; i++)
+         CHECK(fabsf(t[i] - t[i - 1] - 1.0f / level) < EPS,
+               "%s: edge %u = %.0f segment %u has length %f",
+               name, c, value, i - 1, t[i] - t[i - 1]);
+   }
+}
+
+
+static double
+signed_area(const struct draw_tessellator *tess,
+            unsigned a, unsigned b, unsigned c)
+{
+   const double ua = tess->u[a], va = tess->v[a];
+
+   return 0.5 * ((tess->u[b] - ua) * (tess->v[c] - va) -
+                 (tess->u[c] - ua) * (tess->v[b] - va));
+}
+
+
+/**
+ * Check the triangles of a triangle or quad domain.  The signed areas must
+ * all have the sign of the first one and add up to the domain area, which
+ * means that the domain is covered without holes or overlaps.
+ */
+static void
+check_triangles(const struct draw_tessellator *tess, float domain_area,
+                float *winding, const char *name)
+{
+   double area = 0.0, sign = 0.0;
+   unsigned i;
+
+   CHECK(tess->out_prim == PIPE_PRIM_TRIANGLES, "%s: out_prim %u",
+         name, tess->out_prim);
+   CHECK(tess->num_indices % 3 == 0 && tess->num_indices > 0,
+         "%s: %u indices", name, tess->num_indices);
+
+   for (i = 0; i < tess->num_indices; i += 3) {
+      const double a = signed_area(tess, tess->indices[i],
+                                   tess->indices[i + 1], tess->indices[i + 2]);
+
+      if (sign == 0.0)
+         sign = a < 0.0 ? -1.0 : 1.0;
+      CHECK(a * sign > 0.0, "%s: triangle %u has area %g, winding %g",
+            name, i / 3, a, sign);
+      area += a;
+   }
+
+   CHECK(fabs(area * sign - domain_area) < 1e-6,
+         "%s: triangles cover an area of %f instead of %f",
+         name, area * sign, domain_area);
+
+   *winding = sign;
+}
+
+
+static void
+check_points(const struct draw_tessellator *tess, unsigned prim_mode,
+             const char *name)
+{
+   boolean *used = CALLOC(tess->num_points, sizeof(boolean));
+   unsigned i;
+
+   for (i = 0; i < tess->num_indices; i++) {
+      if (tess->indices[i] >= tess->num_points) {
+         printf("FAILED: %s: index %u out of range\n", name, tess->indices[i]);
+         failures++;
+         FREE(used);
+         return;
+      }
+      used[tess->indices[i]] = TRUE;
+   }
+
+   for (i = 0; i < tess->num_points; i++) {
+      const float u = tess->u[i], v = tess->v[i], w = tess->w[i];
+
+      if (!used[i] ||
+          u < 0.0f || u > 1.0f || v < 0.0f || v > 1.0f ||
+          (prim_mode == PIPE_PRIM_TRIANGLES ?
+           fabsf(u + v + w - 1.0f) > EPS : w != 0.0f)) {
+         printf("FAILED: %s: point %u (%f, %f, %f) is %s\n", name, i, u, v, w,
+                used[i] ? "outside of the domain" : "unused");
+         failures++;
+         break;
+      }
+   }
+
+   FREE(used);
+
+   for (i = tess->num_points;
+        i < align(tess->num_points, DRAW_TESS_POINT_ALIGN); i++) {
+      CHECK(tess->u[i] == 0.0f && tess->v[i] == 0.0f && tess->w[i] == 0.0f,
+            "%s: padding point %u is not zero", name, i);
+   }
+}
+
+
+static void
+test_patch(struct draw_tessellator *tess, unsigned prim_mode,
+           enum pipe_tess_spacing spacing,
+           float o0, float o1, float o2, float o3, float i0, float i1)
+{
+   const float outer[4] = { o0, o1, o2, o3 };
+   const float inner[2] = { i0, i1 };
+   struct draw_tess_domain domain;
+   float winding_ccw = 0.0f, winding_cw = 0.0f;
+   unsigned num_points, num_indices;
+   char name[128];
+
+   snprintf(name, sizeof(name), "%s %s outer (%g, %g, %g, %g) inner (%g, %g)",
+            prim_mode == PIPE_PRIM_TRIANGLES ? "triangles" :
+            prim_mode == PIPE_PRIM_QUADS ? "quads" : "isolines",
+            spacing_name(spacing), o0, o1, o2, o3, i0, i1);
+
+   domain.prim_mode = prim_mode;
+   domain.spacing = spacing;
+   domain.vertex_order_cw = FALSE;
+   domain.point_mode = FALSE;
+
+   draw_tessellate(tess, &domain, outer, inner);
+   check_points(tess, prim_mode, name);
+
+   switch (prim_mode) {
+   case PIPE_PRIM_TRIANGLES:
+      check_edge(tess, 0, FALSE, 1, o0, spacing, name);
+      check_edge(tess, 1, FALSE, 2, o1, spacing, name);
+      check_edge(tess, 2, FALSE, 0, o2, spacing, name);
+      check_triangles(tess, 0.5f, &winding_ccw, name);
+      break;
+   case PIPE_PRIM_QUADS:
+      check_edge(tess, 0, FALSE, 1, o0, spacing, name);
+      check_edge(tess, 1, FALSE, 0, o1, spacing, name);
+      check_edge(tess, 0, TRUE, 1, o2, spacing, name);
+      check_edge(tess, 1, TRUE, 0, o3, spacing, name);
+      check_triangles(tess, 1.0f, &winding_ccw, name);
+      break;
+   default: {
+      /* outer[0] lines, always equally spaced, split by outer[1] */
+      const unsigned lines = expected_segments(o0, PIPE_TESS_SPACING_EQUAL);
+      const unsigned segs = expected_segments(o1, spacing);
+      unsigned i;
+
+      CHECK(tess->out_prim == PIPE_PRIM_LINES, "%s: out_prim %u",
+            name, tess->out_prim);
+      CHECK(tess->num_points == lines * (segs + 1),
+            "%s: %u points, expected %u", name, tess->num_points,
+            lines * (segs + 1));
+      CHECK(tess->num_indices == 2 * lines * segs,
+            "%s: %u indices, expected %u", name, tess->num_indices,
+            2 * lines * segs);
+      for (i = 0; i < tess->num_points; i++) {
+         CHECK(tess->v[i] < 1.0f, "%s: line at v = 1", name);
+         CHECK(fabsf(tess->v[i] * lines - roundf(tess->v[i] * lines)) < EPS,
+               "%s: line at v = %f", name, tess->v[i]);
+      }
+      for (i = 0; i < tess->num_indices; i += 2) {
+         CHECK(tess->v[tess->indices[i]] == tess->v[tess->indices[i + 1]] &&
+               tess->u[tess->indices[i]] < tess->u[tess->indices[i + 1]],
+               "%s: segment %u doesn't follow its line", name, i / 2);
+      }
+      break;
+   }
+   }
+
+   num_points = tess->num_points;
+   num_indices = tess->num_indices;
+
+   /* the clockwise order only flips the winding */
+   domain.vertex_order_cw = TRUE;
+   draw_tessellate(tess, &domain, outer, inner);
+   CHECK(tess->num_points == num_points && tess->num_indices == num_indices,
+         "%s: cw generates %u points and %u indices instead of %u and %u",
+         name, tess->num_points, tess->num_indices, num_points, num_indices);
+   if (prim_mode != PIPE_PRIM_LINES) {
+      check_triangles(tess, prim_mode == PIPE_PRIM_QUADS ? 1.0f : 0.5f,
+                      &winding_cw, name);
+      CHECK(winding_cw == -winding_ccw, "%s: cw doesn't flip the winding",
+            name);
+   }
+
+   /* point mode emits every point exactly once */
+   domain.point_mode = TRUE;
+   draw_tessellate(tess, &domain, outer, inner);
+   CHECK(tess->out_prim == PIPE_PRIM_POINTS, "%s: point mode out_prim %u",
+         name, tess->out_prim);
+   CHECK(tess->num_points == num_points &&
+         tess->num_indices == tess->num_points,
+         "%s: point mode generates %u points and %u indices", name,
+         tess->num_points, tess->num_indices);
+   {
+      unsigned i, j;
+
+      for (i = 0; i < tess->num_points; i++) {
+         CHECK(tess->indices[i] == i, "%s: point mode index %u is %u",
+               name, i, tess->indices[i]);
+         for (j = 0; j < i; j++) {
+            CHECK(tess->u[i] != tess->u[j] || tess->v[i] != tess->v[j] ||
+                  tess->w[i] != tess->w[j],
+                  "%s: points %u and %u are the same", name, j, i);
+         }
+      }
+   }
+}
+
+
+/**
+ * A patch with an outer level that is zero, negative or NaN is culled.
+ */
+static void
+test_culled(struct draw_tessellator *tess, unsigned prim_mode, float level)
+{
+   static const unsigned num_outer[] = { 3, 4, 2 };
+   const unsigned mode = prim_mode == PIPE_PRIM_TRIANGLES ? 0 :
+                         prim_mode == PIPE_PRIM_QUADS ? 1 : 2;
+   struct draw_tess_domain domain;
+   unsigned e;
+
+   domain.prim_mode = prim_mode;
+   domain.spacing = PIPE_TESS_SPACING_EQUAL;
+   domain.vertex_order_cw = FALSE;
+   domain.point_mode = FALSE;
+
+   for (e = 0; e < num_outer[mode]; e++) {
+      float outer[4] = { 4.0f, 4.0f, 4.0f, 4.0f };
+      const float inner[2] = { 4.0f, 4.0f };
+
+      outer[e] = level;
+      draw_tessellate(tess, &domain, outer, inner);
+      CHECK(tess->num_points == 0 && tess->num_indices == 0,
+            "mode %u: outer[%u] = %g isn't culled", prim_mode, e, level);
+   }
+
+   /* levels the domain doesn't use don't cull it */
+   if (num_outer[mode] < 4) {
+      const float outer[4] = { 4.0f, 4.0f, 4.0f, level };
+      const float inner[2] = { 4.0f, 4.0f };
+
+      draw_tessellate(tess, &domain, outer, inner);
+      CHECK(tess->num_points > 0, "mode %u: unused outer[3] = %g culls",
+            prim_mode, level);
+   }
+}
+
+
+int
+main(int argc, char **argv)
+{
+   static const enum pipe_tess_spacing spacings[] = {
+      PIPE_TESS_SPACING_EQUAL,
+      PIPE_TESS_SPACING_FRACTIONAL_ODD,
+      PIPE_TESS_SPACING_FRACTIONAL_EVEN,
+   };
+   /* uniform levels, around the rounding steps and beyond the limits */
+   static const float levels[] = {
+      0.25f, 1.0f, 1.5f, 2.0f, 2.1f, 3.0f, 3.5f, 4.0f, 5.0f, 7.9f,
+      16.0f, 33.3f, 62.5f, 63.0f, 64.0f, 100.0f,
+   };
+   /* mismatched outer and inner levels */
+   static const float mixed[][6] = {
+      { 1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f },
+      { 1.0f, 1.0f, 1.0f, 1.0f, 5.0f, 5.0f },
+      { 5.0f, 5.0f, 5.0f, 5.0f, 1.0f, 1.0f },
+      { 1.0f, 2.0f, 3.0f, 4.0f, 1.0f, 1.0f },
+      { 2.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f },
+      { 1.0f, 7.0f, 2.5f, 64.0f, 3.0f, 9.0f },
+      { 64.0f, 1.0f, 64.0f, 1.0f, 64.0f, 1.0f },
+      { 3.0f, 3.0f, 3.0f, 3.0f, 1.0f, 8.0f },
+      { 3.0f, 3.0f, 3.0f, 3.0f, 8.0f, 2.0f },
+      { 0.5f, 12.0f, 0.5f, 12.0f, 0.0f, -1.0f },
+      { 6.0f, 6.0f, 6.0f, 6.0f, NAN, 6.0f },
+   };
+   static const unsigned prim_modes[] = {
+      PIPE_PRIM_TRIANGLES,
+      PIPE_PRIM_QUADS,
+      PIPE_PRIM_LINES,
+   };
+   struct draw_tessellator *tess = draw_tessellator_create();
+   unsigned s, i, m;
+
+   (void) argc;
+   (void) argv;
+
+   if (!tess) {
+      printf("FAILED: draw_tessellator_create()\n");
+      return 1;
+   }
+
+   for (m = 0; m < ARRAY_SIZE(prim_modes); m++) {
+      for (s = 0; s < ARRAY_SIZE(spacings); s++) {
+         for (i = 0; i < ARRAY_SIZE(levels); i++) {
+            const float l = levels[i];
+
+            test_patch(tess, prim_modes[m], spacings[s], l, l, l, l, l, l);
+         }
+         for (i = 0; i < ARRAY_SIZE(mixed); i++) {
+            const float *l = mixed[i];
+
+            test_patch(tess, prim_modes[m], spacings[s],
+                       l[0], l[1], l[2], l[3], l[4], l[5]);
+         }
+      }
+
+      test_culled(tess, prim_modes[m], 0.0f);
+      test_culled(tess, prim_modes[m], -1.0f);
+      test_culled(tess, prim_modes[m], NAN);
+   }
+
+   draw_tessellator_destroy(tess);
+
+   if (failures) {
+      printf("Failure! %u checks failed.\n", failures);
+      return 1;
+   }
+
+   printf("Success!\n");
+   return 0;
+}
@@ -0,0 +1,183 @@
+/**************************************************************************
+ *
+ * Copyright 2019 The Mesa Authors
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/*
+ * Runs a vertex shader through the TGSI interpreter with and without the
+ * pre-decoded fast paths, checks that the outputs are bit-identical and
+ * prints the time per quad of both.
+ *
+ *   tgsi_exec_test [iterations]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "tgsi/tgsi_exec.h"
+#include "tgsi/tgsi_text.h"
+#include "util/os_time.h"
+#include "util/u_memory.h"
+
+
+static const char vs_text[] =
+   "VERT\n"
+   "DCL IN[0]\n"
+   "DCL IN[1]\n"
+   "DCL OUT[0], POSITION\n"
+   "DCL OUT[1], GENERIC[0]\n"
+   "DCL OUT[2], GENERIC[1]\n"
+   "DCL CONST[0..3]\n"
+   "DCL TEMP[0..3]\n"
+   "IMM[0] FLT32 {    0.5000,     2.0000,    -1.0000,     0.0000}\n"
+   "  0: MUL TEMP[0], IN[0].xxxx, CONST[0]\n"
+   "  1: MAD TEMP[0], IN[0].yyyy, CONST[1], TEMP[0]\n"
+   "  2: MAD TEMP[0], IN[0].zzzz, CONST[2], TEMP[0]\n"
+   "  3: MAD OUT[0], IN[0].wwww, CONST[3], TEMP[0]\n"
+   "  4: DP3 TEMP[1].x, IN[1], IN[1]\n"
+   "  5: RSQ TEMP[1].x, TEMP[1].xxxx\n"
+   "  6: MUL TEMP[1].xyz, IN[1], TEMP[1].xxxx\n"
+   "  7: DP3_SAT TEMP[2].x, TEMP[1], CONST[0]\n"
+   "  8: MAX TEMP[2].y, -TEMP[1].zzzz, IMM[0].wwww\n"
+   "  9: MIN TEMP[2].z, |IN[1].xxxx|, IMM[0].yyyy\n"
+   " 10: ADD TEMP[2].w, TEMP[2].xxxx, -IMM[0].xxxx\n"
+   " 11: FSLT TEMP[3].x, IN[0].xxxx, IMM[0].wwww\n"
+   " 12: UIF TEMP[3].xxxx\n"
+   " 13:   MOV_SAT OUT[1], TEMP[2].wzyx\n"
+   " 14: ELSE\n"
+   " 15:   DP4 OUT[1], TEMP[2], -|IN[0]|\n"
+   " 16: ENDIF\n"
+   " 17: DP2 OUT[2].xy, IN[1].zwzw, -CONST[1]\n"
+   " 18: MAD_SAT OUT[2].zw, TEMP[0].yyxx, IMM[0].zzzz, CONST[3].wzyx\n"
+   " 19: END\n";
+
+#define NUM_QUADS 256
+#define NUM_INPUTS 2
+#define NUM_OUTPUTS 3
+
+
+static float
+rand_float(void)
+{
+   return (float) rand() / (float) RAND_MAX * 4.0f - 2.0f;
+}
+
+
+/**
+ * Run all quads through the machine, return the time taken in ns.
+ */
+static int64_t
+run_quads(struct tgsi_exec_machine *mach,
+          const struct tgsi_exec_vector (*inputs)[NUM_INPUTS],
+          struct tgsi_exec_vector (*outputs)[NUM_OUTPUTS],
+          unsigned iterations)
+{
+   int64_t start = os_time_get_nano();
+   unsigned i, q;
+
+   for (i = 0; i < iterations; i++) {
+      for (q = 0; q < NUM_QUADS; q++) {
+         memcpy(mach->Inputs, inputs[q], sizeof(inputs[q]));
+         tgsi_exec_machine_run(mach, 0);
+         memcpy(outputs[q], mach->Outputs, sizeof(outputs[q]));
+      }
+   }
+
+   return os_time_get_nano() - start;
+}
+
+
+int main(int argc, char **argv)
+{
+   unsigned iterations = argc > 1 ? atoi(argv[1]) : 1000;
+   struct tgsi_token tokens[1024];
+   struct tgsi_exec_machine *mach[2];
+   struct tgsi_exec_vector (*inputs)[NUM_INPUTS];
+   struct tgsi_exec_vector (*outputs[2])[NUM_OUTPUTS];
+   float consts[4][4];
+   const void *bufs[1] = { consts };
+   const unsigned sizes[1] = { sizeof(consts) };
+   int64_t time[2];
+   unsigned i, j, k;
+
+   if (!tgsi_text_translate(vs_text, tokens, ARRAY_SIZE(tokens))) {
+      fprintf(stderr, "failed to translate the shader\n");
+      return 1;
+   }
+
+   inputs = CALLOC(NUM_QUADS, sizeof(*inputs));
+   outputs[0] = CALLOC(NUM_QUADS, sizeof(*outputs[0]));
+   outputs[1] = CALLOC(NUM_QUADS, sizeof(*outputs[1]));
+   if (!inputs || !outputs[0] || !outputs[1])
+      return 1;
+
+   for (i = 0; i < NUM_QUADS; i++)
+      for (j = 0; j < NUM_INPUTS; j++)
+         for (k = 0; k < TGSI_NUM_CHANNELS; k++) {
+            union tgsi_exec_channel *chan = &inputs[i][j].xyzw[k];
+            chan->f[0] = rand_float();
+            chan->f[1] = rand_float();
+            chan->f[2] = rand_float();
+            chan->f[3] = rand_float();
+         }
+
+   for (i = 0; i < 4; i++)
+      for (j = 0; j < 4; j++)
+         consts[i][j] = rand_float();
+
+   /* [0] is the generic interpreter, [1] uses the decoded instructions */
+   for (i = 0; i < 2; i++) {
+      mach[i] = tgsi_exec_machine_create(PIPE_SHADER_VERTEX);
+      if (!mach[i])
+         return 1;
+      mach[i]->UseFastPath = i;
+      tgsi_exec_machine_bind_shader(mach[i], tokens, NULL, NULL, NULL);
+      tgsi_exec_set_constant_buffers(mach[i], 1, bufs, sizes);
+      time[i] = run_quads(mach[i], (const void *) inputs, outputs[i],
+                          iterations);
+   }
+
+   if (memcmp(outputs[0], outputs[1], NUM_QUADS * sizeof(*outputs[0]))) {
+      printf("FAILED: outputs differ\n");
+      return 1;
+   }
+
+   printf("generic: %8.1f ns/quad\n",
+          (double) time[0] / ((double) iterations * NUM_QUADS));
+   printf("decoded: %8.1f ns/quad\n",
+          (double) time[1] / ((double) iterations * NUM_QUADS));
+   printf("PASSED\n");
+
+   for (i = 0; i < 2; i++) {
+      tgsi_exec_machine_bind_shader(mach[i], NULL, NULL, NULL, NULL);
+      tgsi_exec_machine_destroy(mach[i]);
+   }
+   FREE(inputs);
+   FREE(outputs[0]);
+   FREE(outputs[1]);
+
+   return 0;
+}
@@ -127,10 +127,14 @@ int main(int argc, char** argv)
       }
       create_fn = translate_sse2_create;
    }
+#if defined(HAVE_LLVM)
+   else if (!strcmp(argv[1], "llvm"))
+      create_fn = translate_llvm_create;
+#endif
 
    if (!create_fn)
    {
-      printf("Usage: ./translate_test [default|generic|x86|nosse|sse|sse2|sse3|sse4.1]\n");
+      printf("Usage: ./translate_test [default|generic|x86|nosse|sse|sse2|sse3|sse4.1|llvm]\n");
       return 2;
    }
 
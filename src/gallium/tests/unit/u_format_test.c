@@ -280,9 +280,13 @@ test_format_pack_rgba_float(const struct util_format_description *format_desc,
    unsigned i, j, k;
    boolean success;
 
-   if (test->format == PIPE_FORMAT_DXT1_RGBA) {
+   if (test->format == PIPE_FORMAT_DXT1_RGBA ||
+       format_desc->layout == UTIL_FORMAT_LAYOUT_RGTC ||
+       format_desc->layout == UTIL_FORMAT_LAYOUT_BPTC ||
+       format_desc->layout == UTIL_FORMAT_LAYOUT_ETC) {
       /*
-       * Skip S3TC as packed representation is not canonical.
+       * Skip S3TC, RGTC, BPTC and ETC as packed representation is not
+       * canonical.
        *
        * TODO: Do a round trip conversion.
        */
@@ -359,6 +363,18 @@ test_format_unpack_rgba_8unorm(const struct util_format_description *format_desc
    unsigned i, j, k;
    boolean success;
 
+   /* The signed RGTC formats have no 8unorm unpack */
+   if (format_desc->layout == UTIL_FORMAT_LAYOUT_RGTC &&
+       !util_format_fits_8unorm(format_desc)) {
+      return TRUE;
+   }
+
+   /* The BPTC float formats round to 8unorm rather than truncate */
+   if (test->format == PIPE_FORMAT_BPTC_RGB_FLOAT ||
+       test->format == PIPE_FORMAT_BPTC_RGB_UFLOAT) {
+      return TRUE;
+   }
+
    format_desc->unpack_rgba_8unorm(&unpacked[0][0][0], sizeof unpacked[0],
                               test->packed, 0,
                               format_desc->block.width, format_desc->block.height);
@@ -398,9 +414,13 @@ test_format_pack_rgba_8unorm(const struct util_format_description *format_desc,
    unsigned i;
    boolean success;
 
-   if (test->format == PIPE_FORMAT_DXT1_RGBA) {
+   if (test->format == PIPE_FORMAT_DXT1_RGBA ||
+       format_desc->layout == UTIL_FORMAT_LAYOUT_RGTC ||
+       format_desc->layout == UTIL_FORMAT_LAYOUT_BPTC ||
+       format_desc->layout == UTIL_FORMAT_LAYOUT_ETC) {
       /*
-       * Skip S3TC as packed representation is not canonical.
+       * Skip S3TC, RGTC, BPTC and ETC as packed representation is not
+       * canonical.
        *
        * TODO: Do a round trip conversion.
        */
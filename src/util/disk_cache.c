@@ -24,6 +24,7 @@
 #ifdef ENABLE_SHADER_CACHE
 
 #include <ctype.h>
+#include <limits.h>
 #include <ftw.h>
 #include <string.h>
 #include <stdlib.h>
@@ -39,17 +40,30 @@
 #include <dirent.h>
 #include "zlib.h"
 
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+#ifdef HAVE_LZ4
+#include <lz4.h>
+#include <lz4hc.h>
+#endif
+
 #include "util/crc32.h"
 #include "util/debug.h"
+#include "util/hash_table.h"
 #include "util/rand_xor.h"
 #include "util/u_atomic.h"
 #include "util/u_queue.h"
 #include "util/mesa-sha1.h"
 #include "util/ralloc.h"
+#include "util/set.h"
+#include "util/u_process.h"
 #include "main/compiler.h"
 #include "main/errors.h"
 
 #include "disk_cache.h"
+#include "disk_cache_pack.h"
 
 /* Number of bits to mask off from a cache key to get an index. */
 #define CACHE_INDEX_KEY_BITS 16
@@ -74,6 +88,49 @@
  */
 #define CACHE_VERSION 1
 
+/* Codecs the cache entries can be compressed with.
+ *
+ * zlib compressed data is stored as a plain zlib stream, as it always has
+ * been, so that entries remain readable across Mesa versions. Data
+ * compressed with any other codec starts with a cache_entry_codec_header.
+ * The first byte of a zlib stream always has 8 (deflate) in its low nibble,
+ * so the two can't be mistaken for each other.
+ */
+enum cache_codec {
+   CACHE_CODEC_ZLIB,
+   CACHE_CODEC_ZSTD,
+   CACHE_CODEC_LZ4,
+};
+
+struct cache_entry_codec_header {
+   uint8_t magic[2]; /* "MC" */
+   uint8_t codec;
+   uint8_t pad;
+};
+
+/* Number of keys read by a single prefetch job. */
+#define CACHE_PREFETCH_JOB_KEYS 16
+
+/* Prefetched items that haven't been claimed by disk_cache_get() yet are
+ * kept in memory up to this total size. Anything beyond is dropped and
+ * read again on demand.
+ */
+#define CACHE_PREFETCH_MAX_SIZE (64 * 1024 * 1024)
+
+/* Maximum number of keys recorded in a hot set manifest. */
+#define CACHE_HOT_SET_MAX_KEYS 8192
+
+#define CACHE_HOT_SET_MAGIC 0x5348434d /* "MCHS" */
+#define CACHE_HOT_SET_VERSION 1
+
+#ifdef HAVE_ZSTD
+#define CACHE_DEFAULT_CODEC CACHE_CODEC_ZSTD
+#define CACHE_DEFAULT_CODEC_LEVEL 1
+#else
+#define CACHE_DEFAULT_CODEC CACHE_CODEC_ZLIB
+#define CACHE_DEFAULT_CODEC_LEVEL Z_BEST_COMPRESSION
+#endif
+
 struct disk_cache {
    /* The path to the cache directory. */
    char *path;
@@ -98,6 +155,44 @@ struct disk_cache {
    /* Maximum size of all cached objects (in bytes). */
    uint64_t max_size;
 
+   /* Single-file storage, (if enabled), replacing the per-item files. */
+   struct disk_cache_pack *pack;
+
+   /* Codec used to compress new entries. Entries compressed with any of
+    * the supported codecs can be read.
+    */
+   enum cache_codec codec;
+   int codec_level;
+
+#ifdef HAVE_ZSTD
+   /* Compression context, only used by the cache_queue thread. */
+   ZSTD_CCtx *zstd_cctx;
+#endif
+
+   /* Threads reading and decompressing items for disk_cache_prefetch(),
+    * created on first use. Unlike cache_queue these run at normal priority,
+    * since someone is usually about to wait for their results.
+    */
+   struct util_queue prefetch_queue;
+   bool prefetch_cancel;
+
+   /* Protects the prefetch_queue creation and everything below. */
+   mtx_t prefetch_mutex;
+
+   /* Items prefetched without a callback, until claimed by
+    * disk_cache_get(), (cache_key -> struct prefetched_item).
+    */
+   struct hash_table *prefetched;
+   uint64_t prefetched_size;
+
+   /* Keys got or put during this run in the order they were first used,
+    * written to the hot set manifest on destruction. NULL unless
+    * MESA_GLSL_CACHE_HOT_SET is enabled.
+    */
+   struct set *hot_set;
+   cache_key *hot_set_keys;
+   unsigned num_hot_set_keys;
+
    /* Driver cache keys. */
    uint8_t *driver_keys_blob;
    size_t driver_keys_blob_size;
@@ -106,6 +201,41 @@ struct disk_cache {
    disk_cache_get_cb blob_get_cb;
 };
 
+struct prefetched_item {
+   cache_key key;
+
+   /* Signalled once data and size are valid. */
+   struct util_queue_fence fence;
+
+   /* NULL if the item isn't in the cache or had to be dropped. */
+   void *data;
+   size_t size;
+};
+
+/* A disk_cache_prefetch() call, split into several jobs. */
+struct prefetch_batch {
+   /* One reference for each job plus one held while submitting them. */
+   int32_t refcount;
+
+   disk_cache_prefetch_cb cb;
+   void *cb_data;
+
+   struct util_queue_fence *fence;
+};
+
+struct prefetch_job {
+   struct util_queue_fence fence;
+
+   struct disk_cache *cache;
+   struct prefetch_batch *batch;
+
+   unsigned num_keys;
+   cache_key keys[CACHE_PREFETCH_JOB_KEYS];
+
+   /* Where the results go when there is no callback. */
+   struct prefetched_item *items[CACHE_PREFETCH_JOB_KEYS];
+};
+
 struct disk_cache_put_job {
    struct util_queue_fence fence;
 
@@ -122,6 +252,55 @@ struct disk_cache_put_job {
    struct cache_item_metadata cache_item_metadata;
 };
 
+/* Header of a hot set manifest, followed by num_keys keys. */
+struct hot_set_header {
+   uint32_t magic;
+   uint32_t version;
+   uint32_t num_keys;
+};
+
+static void
+prefetch_hot_set(struct disk_cache *cache);
+
+static void
+write_hot_set(struct disk_cache *cache);
+
+static void
+destroy_prefetched_item(struct prefetched_item *item);
+
+static uint32_t
+cache_key_hash(const void *key)
+{
+   uint32_t hash;
+
+   /* Keys are SHA-1 hashes already, any 32 bits of them will do. */
+   memcpy(&hash, key, sizeof(hash));
+   return hash;
+}
+
+static bool
+cache_key_equals(const void *a, const void *b)
+{
+   return memcmp(a, b, CACHE_KEY_SIZE) == 0;
+}
+
+static void
+record_hot_set_key(struct disk_cache *cache, const cache_key key)
+{
+   if (cache->hot_set == NULL)
+      return;
+
+   mtx_lock(&cache->prefetch_mutex);
+   if (cache->num_hot_set_keys < CACHE_HOT_SET_MAX_KEYS &&
+       !_mesa_set_search(cache->hot_set, key)) {
+      uint8_t *entry = cache->hot_set_keys[cache->num_hot_set_keys++];
+
+      memcpy(entry, key, CACHE_KEY_SIZE);
+      _mesa_set_add(cache->hot_set, entry);
+   }
+   mtx_unlock(&cache->prefetch_mutex);
+}
+
 /* Create a directory named 'path' if it does not already exist.
  *
  * Returns: 0 if path already exists as a directory or if created.
@@ -182,6 +361,51 @@ concatenate_and_mkdir(void *ctx, const char *path, const char *name)
       return NULL;
 }
 
+/* Parse the codec selection from $MESA_GLSL_CACHE_COMPRESSION, which is
+ * "zlib", "zstd" or "lz4", optionally followed by ":<level>".
+ */
+static void
+select_codec(struct disk_cache *cache)
+{
+   const char *str = getenv("MESA_GLSL_CACHE_COMPRESSION");
+   const char *level_str;
+   size_t len;
+
+   cache->codec = CACHE_DEFAULT_CODEC;
+   cache->codec_level = CACHE_DEFAULT_CODEC_LEVEL;
+
+   if (str == NULL || *str == '\0')
+      return;
+
+   level_str = strchr(str, ':');
+   len = level_str ? level_str - str : strlen(str);
+
+   if (len == 4 && strncmp(str, "zlib", len) == 0) {
+      cache->codec = CACHE_CODEC_ZLIB;
+      cache->codec_level = Z_BEST_COMPRESSION;
+      if (level_str)
+         cache->codec_level = CLAMP(atoi(level_str + 1), 1, 9);
+#ifdef HAVE_ZSTD
+   } else if (len == 4 && strncmp(str, "zstd", len) == 0) {
+      cache->codec = CACHE_CODEC_ZSTD;
+      cache->codec_level = 1;
+      if (level_str)
+         cache->codec_level = CLAMP(atoi(level_str + 1), 1, ZSTD_maxCLevel());
+#endif
+#ifdef HAVE_LZ4
+   } else if (len == 3 && strncmp(str, "lz4", len) == 0) {
+      /* Level 0 is the fast compressor, anything else selects LZ4 HC. */
+      cache->codec = CACHE_CODEC_LZ4;
+      cache->codec_level = 0;
+      if (level_str)
+         cache->codec_level = CLAMP(atoi(level_str + 1), 0, LZ4HC_CLEVEL_MAX);
+#endif
+   } else {
+      fprintf(stderr, "Unsupported shader cache compression \"%s\", "
+                      "using the default.\n", str);
+   }
+}
+
 #define DRV_KEY_CPY(_dst, _src, _src_size) \
 do {                                       \
    memcpy(_dst, _src, _src_size);          \
@@ -220,6 +444,13 @@ disk_cache_create(const char *gpu_name, const char *timestamp,
    if (cache == NULL)
       goto fail;
 
+   mtx_init(&cache->prefetch_mutex, mtx_plain);
+
+   cache->prefetched = _mesa_hash_table_create(cache, cache_key_hash,
+                                               cache_key_equals);
+   if (cache->prefetched == NULL)
+      goto fail;
+
    /* Assume failure. */
    cache->path_init_failed = true;
 
@@ -370,6 +601,33 @@ disk_cache_create(const char *gpu_name, const char *timestamp,
 
    cache->max_size = max_size;
 
+   select_codec(cache);
+
+#ifdef HAVE_ZSTD
+   if (cache->codec == CACHE_CODEC_ZSTD) {
+      cache->zstd_cctx = ZSTD_createCCtx();
+      if (cache->zstd_cctx == NULL) {
+         munmap(cache->index_mmap, cache->index_mmap_size);
+         goto path_fail;
+      }
+   }
+#endif
+
+   /* At user request, store all items in a single pack file rather than one
+    * file each. This keeps the number of files, and the cost of finding
+    * items to evict, down for large caches.
+    */
+   if (env_var_as_boolean("MESA_GLSL_CACHE_SINGLE_FILE", false)) {
+      cache->pack = disk_cache_pack_open(cache->path, max_size);
+      if (cache->pack == NULL) {
+#ifdef HAVE_ZSTD
+         ZSTD_freeCCtx(cache->zstd_cctx);
+#endif
+         munmap(cache->index_mmap, cache->index_mmap_size);
+         goto path_fail;
+      }
+   }
+
    /* 1 thread was chosen because we don't really care about getting things
     * to disk quickly just that it's not blocking other tasks.
     *
@@ -380,6 +638,18 @@ disk_cache_create(const char *gpu_name, const char *timestamp,
                    UTIL_QUEUE_INIT_RESIZE_IF_FULL |
                    UTIL_QUEUE_INIT_USE_MINIMUM_PRIORITY);
 
+   /* At user request, remember which items this run used, and prefetch
+    * them on the next run.
+    */
+   if (env_var_as_boolean("MESA_GLSL_CACHE_HOT_SET", false)) {
+      cache->hot_set = _mesa_set_create(cache, cache_key_hash,
+                                        cache_key_equals);
+      cache->hot_set_keys = ralloc_array(cache, cache_key,
+                                         CACHE_HOT_SET_MAX_KEYS);
+      if (!cache->hot_set || !cache->hot_set_keys)
+         cache->hot_set = NULL;
+   }
+
    cache->path_init_failed = false;
 
  path_fail:
@@ -417,6 +687,9 @@ disk_cache_create(const char *gpu_name, const char *timestamp,
    /* Seed our rand function */
    s_rand_xorshift128plus(cache->seed_xorshift128plus, true);
 
+   if (cache->hot_set)
+      prefetch_hot_set(cache);
+
    ralloc_free(local);
 
    return cache;
@@ -424,8 +697,10 @@ disk_cache_create(const char *gpu_name, const char *timestamp,
  fail:
    if (fd != -1)
       close(fd);
-   if (cache)
+   if (cache) {
+      mtx_destroy(&cache->prefetch_mutex);
       ralloc_free(cache);
+   }
    ralloc_free(local);
 
    return NULL;
@@ -435,10 +710,32 @@ void
 disk_cache_destroy(struct disk_cache *cache)
 {
    if (cache && !cache->path_init_failed) {
+      struct hash_entry *entry;
+
+      if (util_queue_is_initialized(&cache->prefetch_queue)) {
+         /* Let pending prefetches finish without reading anything. */
+         cache->prefetch_cancel = true;
+         util_queue_finish(&cache->prefetch_queue);
+         util_queue_destroy(&cache->prefetch_queue);
+      }
+
+      if (cache->hot_set)
+         write_hot_set(cache);
+
+      hash_table_foreach(cache->prefetched, entry)
+         destroy_prefetched_item(entry->data);
+
       util_queue_destroy(&cache->cache_queue);
+      disk_cache_pack_close(cache->pack);
       munmap(cache->index_mmap, cache->index_mmap_size);
+#ifdef HAVE_ZSTD
+      ZSTD_freeCCtx(cache->zstd_cctx);
+#endif
    }
 
+   if (cache)
+      mtx_destroy(&cache->prefetch_mutex);
+
    ralloc_free(cache);
 }
 
@@ -671,6 +968,11 @@ disk_cache_remove(struct disk_cache *cache, const cache_key key)
 {
    struct stat sb;
 
+   if (cache->pack) {
+      disk_cache_pack_remove(cache->pack, key);
+      return;
+   }
+
    char *filename = get_cache_file(cache, key);
    if (filename == NULL) {
       return;
@@ -718,22 +1020,14 @@ write_all(int fd, const void *buf, size_t count)
    return done;
 }
 
-/* From the zlib docs:
- *    "If the memory is available, buffers sizes on the order of 128K or 256K
- *    bytes should be used."
- */
-#define BUFSIZE 256 * 1024
-
 /**
- * Compresses cache entry in memory and writes it to disk. Returns the size
- * of the data written to disk.
+ * Compresses cache entry data into out_data with zlib. Returns the
+ * compressed size, (or 0 on any error).
  */
 static size_t
-deflate_and_write_to_disk(const void *in_data, size_t in_data_size, int dest,
-                          const char *filename)
+deflate_cache_data(const void *in_data, size_t in_data_size,
+                   uint8_t *out_data, size_t out_data_size, int level)
 {
-   unsigned char out[BUFSIZE];
-
    /* allocate deflate state */
    z_stream strm;
    strm.zalloc = Z_NULL;
@@ -741,50 +1035,111 @@ deflate_and_write_to_disk(const void *in_data, size_t in_data_size, int dest,
    strm.opaque = Z_NULL;
    strm.next_in = (uint8_t *) in_data;
    strm.avail_in = in_data_size;
+   strm.next_out = out_data;
+   strm.avail_out = out_data_size;
 
-   int ret = deflateInit(&strm, Z_BEST_COMPRESSION);
+   int ret = deflateInit(&strm, level);
    if (ret != Z_OK)
        return 0;
 
-   /* compress until end of in_data */
+   /* The output buffer is sized with compressBound() so everything should
+    * be compressed in one go.
+    */
+   ret = deflate(&strm, Z_FINISH);
+   assert(ret != Z_STREAM_ERROR);  /* state not clobbered */
+
    size_t compressed_size = 0;
-   int flush;
-   do {
-      int remaining = in_data_size - BUFSIZE;
-      flush = remaining > 0 ? Z_NO_FLUSH : Z_FINISH;
-      in_data_size -= BUFSIZE;
-
-      /* Run deflate() on input until the output buffer is not full (which
-       * means there is no more data to deflate).
-       */
-      do {
-         strm.avail_out = BUFSIZE;
-         strm.next_out = out;
+   if (ret == Z_STREAM_END)
+      compressed_size = out_data_size - strm.avail_out;
 
-         ret = deflate(&strm, flush);    /* no bad return value */
-         assert(ret != Z_STREAM_ERROR);  /* state not clobbered */
+   /* clean up and return */
+   (void)deflateEnd(&strm);
+   return compressed_size;
+}
 
-         size_t have = BUFSIZE - strm.avail_out;
-         compressed_size += have;
+/**
+ * Returns the size of the buffer compress_cache_data() needs to compress
+ * data of the given size.
+ */
+static size_t
+compress_bound(struct disk_cache *cache, size_t in_data_size)
+{
+   switch (cache->codec) {
+#ifdef HAVE_ZSTD
+   case CACHE_CODEC_ZSTD:
+      return sizeof(struct cache_entry_codec_header) +
+             ZSTD_compressBound(in_data_size);
+#endif
+#ifdef HAVE_LZ4
+   case CACHE_CODEC_LZ4:
+      return sizeof(struct cache_entry_codec_header) +
+             LZ4_compressBound(MIN2(in_data_size, LZ4_MAX_INPUT_SIZE));
+#endif
+   default:
+      return compressBound(in_data_size);
+   }
+}
 
-         ssize_t written = write_all(dest, out, have);
-         if (written == -1) {
-            (void)deflateEnd(&strm);
-            return 0;
-         }
-      } while (strm.avail_out == 0);
+static inline size_t
+write_codec_header(struct disk_cache *cache, uint8_t *out_data)
+{
+   struct cache_entry_codec_header header = { { 'M', 'C' }, cache->codec, 0 };
 
-      /* all input should be used */
-      assert(strm.avail_in == 0);
+   memcpy(out_data, &header, sizeof(header));
+   return sizeof(header);
+}
 
-   } while (flush != Z_FINISH);
+/**
+ * Compresses cache entry data into out_data with the codec selected for
+ * the cache. Returns the compressed size, (or 0 on any error).
+ */
+static size_t
+compress_cache_data(struct disk_cache *cache, const void *in_data,
+                    size_t in_data_size, uint8_t *out_data,
+                    size_t out_data_size)
+{
+   switch (cache->codec) {
+#ifdef HAVE_ZSTD
+   case CACHE_CODEC_ZSTD: {
+      size_t header_size = write_codec_header(cache, out_data);
+      size_t ret = ZSTD_compressCCtx(cache->zstd_cctx,
+                                     out_data + header_size,
+                                     out_data_size - header_size,
+                                     in_data, in_data_size,
+                                     cache->codec_level);
+      if (ZSTD_isError(ret))
+         return 0;
 
-   /* stream should be complete */
-   assert(ret == Z_STREAM_END);
+      return header_size + ret;
+   }
+#endif
+#ifdef HAVE_LZ4
+   case CACHE_CODEC_LZ4: {
+      int ret;
 
-   /* clean up and return */
-   (void)deflateEnd(&strm);
-   return compressed_size;
+      if (in_data_size > LZ4_MAX_INPUT_SIZE)
+         return 0;
+
+      size_t header_size = write_codec_header(cache, out_data);
+
+      if (cache->codec_level) {
+         ret = LZ4_compress_HC(in_data, (char *) out_data + header_size,
+                               in_data_size, out_data_size - header_size,
+                               cache->codec_level);
+      } else {
+         ret = LZ4_compress_default(in_data, (char *) out_data + header_size,
+                                    in_data_size, out_data_size - header_size);
+      }
+      if (ret <= 0)
+         return 0;
+
+      return header_size + ret;
+   }
+#endif
+   default:
+      return deflate_cache_data(in_data, in_data_size, out_data,
+                                out_data_size, cache->codec_level);
+   }
 }
 
 static struct disk_cache_put_job *
@@ -848,6 +1203,68 @@ struct cache_entry_file_data {
    uint32_t uncompressed_size;
 };
 
+/**
+ * Builds the cache entry for a put job, in the form it is stored on disk.
+ * Returns a malloc'ed buffer and its size, (or NULL on any error).
+ */
+static uint8_t *
+create_cache_entry(struct disk_cache_put_job *dc_job, size_t *entry_size)
+{
+   struct disk_cache *cache = dc_job->cache;
+   struct cache_item_metadata *metadata = &dc_job->cache_item_metadata;
+   size_t header_size, compressed_size, max_compressed_size;
+   uint8_t *entry, *out;
+
+   header_size = cache->driver_keys_blob_size + sizeof(uint32_t) +
+                 sizeof(struct cache_entry_file_data);
+   if (metadata->type == CACHE_ITEM_TYPE_GLSL)
+      header_size += sizeof(uint32_t) + metadata->num_keys * sizeof(cache_key);
+
+   max_compressed_size = compress_bound(cache, dc_job->size);
+
+   entry = malloc(header_size + max_compressed_size);
+   if (entry == NULL)
+      return NULL;
+
+   out = entry;
+
+   /* Write the driver_keys_blob, this can be used find information about the
+    * mesa version that produced the entry or deal with hash collisions,
+    * should that ever become a real problem.
+    */
+   DRV_KEY_CPY(out, cache->driver_keys_blob, cache->driver_keys_blob_size)
+
+   /* Write the cache item metadata. This data can be used to deal with
+    * hash collisions, as well as providing useful information to 3rd party
+    * tools reading the cache files.
+    */
+   DRV_KEY_CPY(out, &metadata->type, sizeof(uint32_t))
+   if (metadata->type == CACHE_ITEM_TYPE_GLSL) {
+      DRV_KEY_CPY(out, &metadata->num_keys, sizeof(uint32_t))
+      DRV_KEY_CPY(out, metadata->keys[0],
+                  metadata->num_keys * sizeof(cache_key))
+   }
+
+   /* Create CRC of the data. We will read this when restoring the cache and
+    * use it to check for corruption.
+    */
+   struct cache_entry_file_data cf_data;
+   cf_data.crc32 = util_hash_crc32(dc_job->data, dc_job->size);
+   cf_data.uncompressed_size = dc_job->size;
+   DRV_KEY_CPY(out, &cf_data, sizeof(cf_data))
+
+   /* Finally, the compressed contents. */
+   compressed_size = compress_cache_data(cache, dc_job->data, dc_job->size,
+                                         out, max_compressed_size);
+   if (compressed_size == 0) {
+      free(entry);
+      return NULL;
+   }
+
+   *entry_size = header_size + compressed_size;
+   return entry;
+}
+
 static void
 cache_put(void *job, int thread_index)
 {
@@ -856,8 +1273,21 @@ cache_put(void *job, int thread_index)
    int fd = -1, fd_final = -1, err, ret;
    unsigned i = 0;
    char *filename = NULL, *filename_tmp = NULL;
+   uint8_t *entry = NULL;
+   size_t entry_size;
    struct disk_cache_put_job *dc_job = (struct disk_cache_put_job *) job;
 
+   /* The pack does its own locking, eviction and size accounting. */
+   if (dc_job->cache->pack) {
+      entry = create_cache_entry(dc_job, &entry_size);
+      if (entry) {
+         disk_cache_pack_put(dc_job->cache->pack, dc_job->key, entry,
+                             entry_size);
+         free(entry);
+      }
+      return;
+   }
+
    filename = get_cache_file(dc_job->cache, dc_job->key);
    if (filename == NULL)
       goto done;
@@ -916,66 +1346,18 @@ cache_put(void *job, int thread_index)
     * by some other process.
     */
 
-   /* Write the driver_keys_blob, this can be used find information about the
-    * mesa version that produced the entry or deal with hash collisions,
-    * should that ever become a real problem.
-    */
-   ret = write_all(fd, dc_job->cache->driver_keys_blob,
-                   dc_job->cache->driver_keys_blob_size);
-   if (ret == -1) {
-      unlink(filename_tmp);
-      goto done;
-   }
-
-   /* Write the cache item metadata. This data can be used to deal with
-    * hash collisions, as well as providing useful information to 3rd party
-    * tools reading the cache files.
-    */
-   ret = write_all(fd, &dc_job->cache_item_metadata.type,
-                   sizeof(uint32_t));
-   if (ret == -1) {
-      unlink(filename_tmp);
-      goto done;
-   }
-
-   if (dc_job->cache_item_metadata.type == CACHE_ITEM_TYPE_GLSL) {
-      ret = write_all(fd, &dc_job->cache_item_metadata.num_keys,
-                      sizeof(uint32_t));
-      if (ret == -1) {
-         unlink(filename_tmp);
-         goto done;
-      }
-
-      ret = write_all(fd, dc_job->cache_item_metadata.keys[0],
-                      dc_job->cache_item_metadata.num_keys *
-                      sizeof(cache_key));
-      if (ret == -1) {
-         unlink(filename_tmp);
-         goto done;
-      }
-   }
-
-   /* Create CRC of the data. We will read this when restoring the cache and
-    * use it to check for corruption.
-    */
-   struct cache_entry_file_data cf_data;
-   cf_data.crc32 = util_hash_crc32(dc_job->data, dc_job->size);
-   cf_data.uncompressed_size = dc_job->size;
-
-   size_t cf_data_size = sizeof(cf_data);
-   ret = write_all(fd, &cf_data, cf_data_size);
-   if (ret == -1) {
+   entry = create_cache_entry(dc_job, &entry_size);
+   if (entry == NULL) {
       unlink(filename_tmp);
       goto done;
    }
 
-   /* Now, finally, write out the contents to the temporary file, then
-    * rename them atomically to the destination filename, and also
+   /* Now, finally, write out the entry to the temporary file, then
+    * rename it atomically to the destination filename, and also
     * perform an atomic increment of the total cache size.
     */
-   size_t file_size = deflate_and_write_to_disk(dc_job->data, dc_job->size,
-                                                fd, filename_tmp);
-   if (file_size == 0) {
+   ret = write_all(fd, entry, entry_size);
+   if (ret == -1) {
       unlink(filename_tmp);
       goto done;
    }
@@ -1004,6 +1386,7 @@ cache_put(void *job, int thread_index)
       close(fd);
    free(filename_tmp);
    free(filename);
+   free(entry);
 }
 
 void
@@ -1019,6 +1402,8 @@ disk_cache_put(struct disk_cache *cache, const cache_key key,
    if (cache->path_init_failed)
       return;
 
+   record_hot_set_key(cache, key);
+
    struct disk_cache_put_job *dc_job =
       create_put_job(cache, key, data, size, cache_item_metadata);
 
@@ -1068,86 +1453,82 @@ inflate_cache_data(uint8_t *in_data, size_t in_data_size,
    return true;
 }
 
-void *
-disk_cache_get(struct disk_cache *cache, const cache_key key, size_t *size)
+/**
+ * Decompresses cache entry data, whichever codec it was compressed with.
+ * Returns true if successful.
+ */
+static bool
+decompress_cache_data(uint8_t *in_data, size_t in_data_size,
+                      uint8_t *out_data, size_t out_data_size)
 {
-   int fd = -1, ret;
-   struct stat sb;
-   char *filename = NULL;
-   uint8_t *data = NULL;
-   uint8_t *uncompressed_data = NULL;
-   uint8_t *file_header = NULL;
+   struct cache_entry_codec_header header;
+
+   if (in_data_size < sizeof(header) ||
+       in_data[0] != 'M' || in_data[1] != 'C')
+      return inflate_cache_data(in_data, in_data_size, out_data,
+                                out_data_size);
+
+   memcpy(&header, in_data, sizeof(header));
+   in_data += sizeof(header);
+   in_data_size -= sizeof(header);
+
+   switch (header.codec) {
+#ifdef HAVE_ZSTD
+   case CACHE_CODEC_ZSTD: {
+      size_t ret = ZSTD_decompress(out_data, out_data_size,
+                                   in_data, in_data_size);
+      return !ZSTD_isError(ret) && ret == out_data_size;
+   }
+#endif
+#ifdef HAVE_LZ4
+   case CACHE_CODEC_LZ4: {
+      if (in_data_size > INT_MAX || out_data_size > INT_MAX)
+         return false;
+
+      int ret = LZ4_decompress_safe((const char *) in_data, (char *) out_data,
+                                    in_data_size, out_data_size);
+      return ret >= 0 && ret == out_data_size;
+   }
+#endif
+   default:
+      /* Written by a build supporting more codecs than this one. */
+      return false;
+   }
+}
 
-   if (size)
-      *size = 0;
+/**
+ * Checks a cache entry read back from disk and decompresses its data.
+ * Returns the malloc'ed data, (or NULL on any error).
+ */
+static uint8_t *
+parse_cache_entry(struct disk_cache *cache, uint8_t *entry, size_t entry_size,
+                  size_t *size)
+{
+   size_t ck_size = cache->driver_keys_blob_size;
+   size_t offset = 0;
 
-   if (cache->blob_get_cb) {
-      /* This is what Android EGL defines as the maxValueSize in egl_cache_t
-       * class implementation.
-       */
-      const signed long max_blob_size = 64 * 1024;
-      void *blob = malloc(max_blob_size);
-      if (!blob)
-         return NULL;
+   if (entry_size < ck_size)
+      return NULL;
 
-      signed long bytes =
-         cache->blob_get_cb(key, CACHE_KEY_SIZE, blob, max_blob_size);
+   /* Check for extremely unlikely hash collisions */
+   if (memcmp(cache->driver_keys_blob, entry, ck_size) != 0) {
+      assert(!"Mesa cache keys mismatch!");
+      return NULL;
+   }
+   offset += ck_size;
 
-      if (!bytes) {
-         free(blob);
-         return NULL;
-      }
-
-      if (size)
-         *size = bytes;
-      return blob;
-   }
-
-   filename = get_cache_file(cache, key);
-   if (filename == NULL)
-      goto fail;
-
-   fd = open(filename, O_RDONLY | O_CLOEXEC);
-   if (fd == -1)
-      goto fail;
-
-   if (fstat(fd, &sb) == -1)
-      goto fail;
-
-   data = malloc(sb.st_size);
-   if (data == NULL)
-      goto fail;
-
-   size_t ck_size = cache->driver_keys_blob_size;
-   file_header = malloc(ck_size);
-   if (!file_header)
-      goto fail;
-
-   if (sb.st_size < ck_size)
-      goto fail;
-
-   ret = read_all(fd, file_header, ck_size);
-   if (ret == -1)
-      goto fail;
-
-   /* Check for extremely unlikely hash collisions */
-   if (memcmp(cache->driver_keys_blob, file_header, ck_size) != 0) {
-      assert(!"Mesa cache keys mismatch!");
-      goto fail;
-   }
-
-   size_t cache_item_md_size = sizeof(uint32_t);
    uint32_t md_type;
-   ret = read_all(fd, &md_type, cache_item_md_size);
-   if (ret == -1)
-      goto fail;
+   if (entry_size - offset < sizeof(md_type))
+      return NULL;
+   memcpy(&md_type, entry + offset, sizeof(md_type));
+   offset += sizeof(md_type);
 
    if (md_type == CACHE_ITEM_TYPE_GLSL) {
       uint32_t num_keys;
-      cache_item_md_size += sizeof(uint32_t);
-      ret = read_all(fd, &num_keys, sizeof(uint32_t));
-      if (ret == -1)
-         goto fail;
+      if (entry_size - offset < sizeof(num_keys))
+         return NULL;
+      memcpy(&num_keys, entry + offset, sizeof(num_keys));
+      offset += sizeof(num_keys);
 
       /* The cache item metadata is currently just used for distributing
        * precompiled shaders, they are not used by Mesa so just skip them for
@@ -1155,30 +1536,25 @@ disk_cache_get(struct disk_cache *cache, const cache_key key, size_t *size)
        * TODO: pass the metadata back to the caller and do some basic
        * validation.
        */
-      cache_item_md_size += num_keys * sizeof(cache_key);
-      ret = lseek(fd, num_keys * sizeof(cache_key), SEEK_CUR);
-      if (ret == -1)
-         goto fail;
+      if ((entry_size - offset) / sizeof(cache_key) < num_keys)
+         return NULL;
+      offset += num_keys * sizeof(cache_key);
    }
 
    /* Load the CRC that was created when the file was written. */
    struct cache_entry_file_data cf_data;
-   size_t cf_data_size = sizeof(cf_data);
-   ret = read_all(fd, &cf_data, cf_data_size);
-   if (ret == -1)
-      goto fail;
-
-   /* Load the actual cache data. */
-   size_t cache_data_size =
-      sb.st_size - cf_data_size - ck_size - cache_item_md_size;
-   ret = read_all(fd, data, cache_data_size);
-   if (ret == -1)
-      goto fail;
+   if (entry_size - offset < sizeof(cf_data))
+      return NULL;
+   memcpy(&cf_data, entry + offset, sizeof(cf_data));
+   offset += sizeof(cf_data);
 
    /* Uncompress the cache data */
-   uncompressed_data = malloc(cf_data.uncompressed_size);
-   if (!inflate_cache_data(data, cache_data_size, uncompressed_data,
-                           cf_data.uncompressed_size))
+   uint8_t *uncompressed_data = malloc(cf_data.uncompressed_size);
+   if (!uncompressed_data)
+      return NULL;
+
+   if (!decompress_cache_data(entry + offset, entry_size - offset,
+                              uncompressed_data, cf_data.uncompressed_size))
       goto fail;
 
    /* Check the data for corruption */
@@ -1186,29 +1562,164 @@ disk_cache_get(struct disk_cache *cache, const cache_key key, size_t *size)
                                         cf_data.uncompressed_size))
       goto fail;
 
-   free(data);
-   free(filename);
-   free(file_header);
-   close(fd);
-
    if (size)
       *size = cf_data.uncompressed_size;
 
    return uncompressed_data;
 
  fail:
-   if (data)
+   free(uncompressed_data);
+   return NULL;
+}
+
+/* Read, decompress and validate the item stored under \key in the
+ * cache directory.
+ */
+static void *
+read_cache_item(struct disk_cache *cache, const cache_key key, size_t *size)
+{
+   int fd = -1, ret;
+   struct stat sb;
+   char *filename = NULL;
+   uint8_t *data = NULL;
+   uint8_t *uncompressed_data = NULL;
+
+   if (cache->pack) {
+      size_t entry_size;
+
+      data = disk_cache_pack_get(cache->pack, key, &entry_size);
+      if (data == NULL)
+         return NULL;
+
+      uncompressed_data = parse_cache_entry(cache, data, entry_size, size);
       free(data);
-   if (uncompressed_data)
-      free(uncompressed_data);
-   if (filename)
-      free(filename);
-   if (file_header)
-      free(file_header);
+      return uncompressed_data;
+   }
+
+   filename = get_cache_file(cache, key);
+   if (filename == NULL)
+      goto done;
+
+   fd = open(filename, O_RDONLY | O_CLOEXEC);
+   if (fd == -1)
+      goto done;
+
+   if (fstat(fd, &sb) == -1)
+      goto done;
+
+   data = malloc(sb.st_size);
+   if (data == NULL)
+      goto done;
+
+   ret = read_all(fd, data, sb.st_size);
+   if (ret == -1)
+      goto done;
+
+   uncompressed_data = parse_cache_entry(cache, data, sb.st_size, size);
+
+ done:
+   free(data);
+   free(filename);
    if (fd != -1)
       close(fd);
 
-   return NULL;
+   return uncompressed_data;
+}
+
+/* Take the prefetched copy of the item stored under \key out of the cache,
+ * if there is one.
+ */
+static struct prefetched_item *
+claim_prefetched_item(struct disk_cache *cache, const cache_key key)
+{
+   struct prefetched_item *item = NULL;
+
+   mtx_lock(&cache->prefetch_mutex);
+   if (cache->prefetched->entries) {
+      struct hash_entry *entry = _mesa_hash_table_search(cache->prefetched,
+                                                         key);
+      if (entry) {
+         item = entry->data;
+         _mesa_hash_table_remove(cache->prefetched, entry);
+      }
+   }
+   mtx_unlock(&cache->prefetch_mutex);
+
+   return item;
+}
+
+static void
+destroy_prefetched_item(struct prefetched_item *item)
+{
+   util_queue_fence_destroy(&item->fence);
+   free(item->data);
+   free(item);
+}
+
+void *
+disk_cache_get(struct disk_cache *cache, const cache_key key, size_t *size)
+{
+   struct prefetched_item *item;
+   void *data = NULL;
+   size_t data_size = 0;
+
+   if (size)
+      *size = 0;
+
+   if (cache->blob_get_cb) {
+      /* This is what Android EGL defines as the maxValueSize in egl_cache_t
+       * class implementation.
+       */
+      const signed long max_blob_size = 64 * 1024;
+      void *blob = malloc(max_blob_size);
+      if (!blob)
+         return NULL;
+
+      signed long bytes =
+         cache->blob_get_cb(key, CACHE_KEY_SIZE, blob, max_blob_size);
+
+      if (!bytes) {
+         free(blob);
+         return NULL;
+      }
+
+      if (size)
+         *size = bytes;
+      return blob;
+   }
+
+   if (cache->path_init_failed)
+      return NULL;
+
+   item = claim_prefetched_item(cache, key);
+   if (item) {
+      util_queue_fence_wait(&item->fence);
+
+      if (item->data) {
+         mtx_lock(&cache->prefetch_mutex);
+         cache->prefetched_size -= item->size;
+         mtx_unlock(&cache->prefetch_mutex);
+
+         data = item->data;
+         data_size = item->size;
+         item->data = NULL;
+      }
+      destroy_prefetched_item(item);
+   }
+
+   /* Items that were dropped or failed to be read by a prefetch are simply
+    * read again.
+    */
+   if (data == NULL)
+      data = read_cache_item(cache, key, &data_size);
+
+   if (data) {
+      record_hot_set_key(cache, key);
+      if (size)
+         *size = data_size;
+   }
+
+   return data;
 }
 
 void
@@ -1279,4 +1790,304 @@ disk_cache_set_callbacks(struct disk_cache *cache, disk_cache_put_cb put,
    cache->blob_get_cb = get;
 }
 
+static void
+release_prefetch_batch(struct prefetch_batch *batch)
+{
+   if (p_atomic_dec_zero(&batch->refcount)) {
+      if (batch->fence)
+         util_queue_fence_signal(batch->fence);
+      free(batch);
+   }
+}
+
+static void
+prefetch_items(void *job, int thread_index)
+{
+   struct prefetch_job *pf_job = job;
+   struct disk_cache *cache = pf_job->cache;
+   struct prefetch_batch *batch = pf_job->batch;
+
+   for (unsigned i = 0; i < pf_job->num_keys; i++) {
+      void *data = NULL;
+      size_t size = 0;
+
+      /* Once the cache is being destroyed, just report misses. */
+      if (!cache->prefetch_cancel)
+         data = read_cache_item(cache, pf_job->keys[i], &size);
+
+      if (batch->cb) {
+         batch->cb(batch->cb_data, pf_job->keys[i], data, size);
+         continue;
+      }
+
+      struct prefetched_item *item = pf_job->items[i];
+
+      if (data) {
+         mtx_lock(&cache->prefetch_mutex);
+         if (cache->prefetched_size + size <= CACHE_PREFETCH_MAX_SIZE) {
+            cache->prefetched_size += size;
+            item->data = data;
+            item->size = size;
+            data = NULL;
+         }
+         mtx_unlock(&cache->prefetch_mutex);
+         free(data);
+      }
+
+      util_queue_fence_signal(&item->fence);
+   }
+}
+
+static void
+destroy_prefetch_job(void *job, int thread_index)
+{
+   struct prefetch_job *pf_job = job;
+
+   release_prefetch_batch(pf_job->batch);
+   util_queue_fence_destroy(&pf_job->fence);
+   free(pf_job);
+}
+
+static bool
+init_prefetch_queue(struct disk_cache *cache)
+{
+   bool initialized;
+
+   mtx_lock(&cache->prefetch_mutex);
+   if (!util_queue_is_initialized(&cache->prefetch_queue)) {
+      /* Reading is mostly spent decompressing, so use a few threads. */
+      long num_threads = sysconf(_SC_NPROCESSORS_ONLN);
+
+      util_queue_init(&cache->prefetch_queue, "disk_pf", 32,
+                      CLAMP(num_threads, 1, 4),
+                      UTIL_QUEUE_INIT_RESIZE_IF_FULL);
+   }
+   initialized = util_queue_is_initialized(&cache->prefetch_queue);
+   mtx_unlock(&cache->prefetch_mutex);
+
+   return initialized;
+}
+
+/* Queue up a prefetched_item to be filled for \key, unless one is already
+ * pending.
+ */
+static struct prefetched_item *
+add_prefetched_item(struct disk_cache *cache, const cache_key key)
+{
+   struct prefetched_item *item = NULL;
+
+   mtx_lock(&cache->prefetch_mutex);
+   if (_mesa_hash_table_search(cache->prefetched, key))
+      goto done;
+
+   item = calloc(1, sizeof(*item));
+   if (item == NULL)
+      goto done;
+
+   memcpy(item->key, key, CACHE_KEY_SIZE);
+   util_queue_fence_init(&item->fence);
+   util_queue_fence_reset(&item->fence);
+   _mesa_hash_table_insert(cache->prefetched, item->key, item);
+
+ done:
+   mtx_unlock(&cache->prefetch_mutex);
+   return item;
+}
+
+void
+disk_cache_prefetch(struct disk_cache *cache, const cache_key *keys,
+                    unsigned num_keys, disk_cache_prefetch_cb cb,
+                    void *cb_data, struct util_queue_fence *fence)
+{
+   struct prefetch_batch *batch = NULL;
+   struct prefetch_job *pf_job = NULL;
+   unsigned i = 0;
+
+   if (fence)
+      util_queue_fence_reset(fence);
+
+   if (num_keys == 0 || cache->blob_get_cb || cache->path_init_failed ||
+       !init_prefetch_queue(cache))
+      goto sync;
+
+   batch = calloc(1, sizeof(*batch));
+   if (batch == NULL)
+      goto sync;
+
+   batch->refcount = 1;
+   batch->cb = cb;
+   batch->cb_data = cb_data;
+   batch->fence = fence;
+
+   for (; i < num_keys; i++) {
+      if (pf_job == NULL) {
+         pf_job = calloc(1, sizeof(*pf_job));
+         if (pf_job == NULL)
+            break;
+
+         pf_job->cache = cache;
+         pf_job->batch = batch;
+      }
+
+      if (!cb) {
+         pf_job->items[pf_job->num_keys] = add_prefetched_item(cache, keys[i]);
+         if (pf_job->items[pf_job->num_keys] == NULL)
+            continue;
+      }
+
+      memcpy(pf_job->keys[pf_job->num_keys++], keys[i], CACHE_KEY_SIZE);
+
+      if (pf_job->num_keys == CACHE_PREFETCH_JOB_KEYS) {
+         p_atomic_inc(&batch->refcount);
+         util_queue_fence_init(&pf_job->fence);
+         util_queue_add_job(&cache->prefetch_queue, pf_job, &pf_job->fence,
+                            prefetch_items, destroy_prefetch_job);
+         pf_job = NULL;
+      }
+   }
+
+   if (pf_job && pf_job->num_keys) {
+      p_atomic_inc(&batch->refcount);
+      util_queue_fence_init(&pf_job->fence);
+      util_queue_add_job(&cache->prefetch_queue, pf_job, &pf_job->fence,
+                         prefetch_items, destroy_prefetch_job);
+   } else {
+      free(pf_job);
+   }
+
+ sync:
+   /* Whatever couldn't be queued is read right away when there is a
+    * callback waiting for it, and skipped otherwise.
+    */
+   if (cb) {
+      for (; i < num_keys; i++) {
+         size_t size = 0;
+         void *data = disk_cache_get(cache, keys[i], &size);
+
+         cb(cb_data, keys[i], data, size);
+      }
+   }
+
+   if (batch)
+      release_prefetch_batch(batch);
+   else if (fence)
+      util_queue_fence_signal(fence);
+}
+
+static char *
+get_hot_set_file(struct disk_cache *cache)
+{
+   const char *process_name = util_get_process_name();
+   struct mesa_sha1 ctx;
+   unsigned char sha1[20];
+   char buf[41];
+   char *filename;
+
+   /* One manifest per driver and application. */
+   _mesa_sha1_init(&ctx);
+   _mesa_sha1_update(&ctx, cache->driver_keys_blob,
+                     cache->driver_keys_blob_size);
+   if (process_name)
+      _mesa_sha1_update(&ctx, process_name, strlen(process_name));
+   _mesa_sha1_final(&ctx, sha1);
+   _mesa_sha1_format(buf, sha1);
+
+   if (asprintf(&filename, "%s/hotset.%s", cache->path, buf) == -1)
+      return NULL;
+
+   return filename;
+}
+
+/* Prefetch the items the last run of this application used, according to
+ * its hot set manifest.
+ */
+static void
+prefetch_hot_set(struct disk_cache *cache)
+{
+   struct hot_set_header header;
+   cache_key *keys = NULL;
+   char *filename;
+   int fd = -1;
+
+   filename = get_hot_set_file(cache);
+   if (filename == NULL)
+      return;
+
+   fd = open(filename, O_RDONLY | O_CLOEXEC);
+   if (fd == -1)
+      goto done;
+
+   if (read_all(fd, &header, sizeof(header)) == -1 ||
+       header.magic != CACHE_HOT_SET_MAGIC ||
+       header.version != CACHE_HOT_SET_VERSION ||
+       header.num_keys == 0 || header.num_keys > CACHE_HOT_SET_MAX_KEYS)
+      goto done;
+
+   keys = malloc(header.num_keys * sizeof(cache_key));
+   if (keys == NULL)
+      goto done;
+
+   if (read_all(fd, keys, header.num_keys * sizeof(cache_key)) == -1)
+      goto done;
+
+   disk_cache_prefetch(cache, (const cache_key *) keys, header.num_keys,
+                       NULL, NULL, NULL);
+
+ done:
+   free(keys);
+   if (fd != -1)
+      close(fd);
+   free(filename);
+}
+
+/* Write the keys used during this run to the hot set manifest, replacing
+ * the previous one.
+ */
+static void
+write_hot_set(struct disk_cache *cache)
+{
+   struct hot_set_header header;
+   char *filename, *filename_tmp = NULL;
+   int fd = -1;
+
+   if (cache->num_hot_set_keys == 0)
+      return;
+
+   filename = get_hot_set_file(cache);
+   if (filename == NULL)
+      return;
+
+   /* Several instances of an application may exit at the same time, give
+    * each its own temporary file.
+    */
+   if (asprintf(&filename_tmp, "%s.%d.tmp", filename, (int) getpid()) == -1) {
+      filename_tmp = NULL;
+      goto done;
+   }
+
+   fd = open(filename_tmp, O_WRONLY | O_CLOEXEC | O_CREAT | O_TRUNC, 0644);
+   if (fd == -1)
+      goto done;
+
+   header.magic = CACHE_HOT_SET_MAGIC;
+   header.version = CACHE_HOT_SET_VERSION;
+   header.num_keys = cache->num_hot_set_keys;
+
+   if (write_all(fd, &header, sizeof(header)) == -1 ||
+       write_all(fd, cache->hot_set_keys,
+                 header.num_keys * sizeof(cache_key)) == -1) {
+      unlink(filename_tmp);
+      goto done;
+   }
+
+   if (rename(filename_tmp, filename) == -1)
+      unlink(filename_tmp);
+
+ done:
+   if (fd != -1)
+      close(fd);
+   free(filename_tmp);
+   free(filename);
+}
+
 #endif /* ENABLE_SHADER_CACHE */
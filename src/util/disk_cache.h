@@ -58,6 +58,15 @@ typedef signed long
 (*disk_cache_get_cb) (const void *key, signed long keySize,
                       void *value, signed long valueSize);
 
+/* Called for every key passed to disk_cache_prefetch(), with the malloc'ed
+ * item (owned by the callee from then on) or NULL if it wasn't found.
+ */
+typedef void
+(*disk_cache_prefetch_cb) (void *cb_data, const cache_key key,
+                           void *data, size_t size);
+
+struct util_queue_fence;
+
 struct cache_item_metadata {
    /**
     * The cache item type. This could be used to identify a GLSL cache item,
@@ -219,6 +228,24 @@ void
 disk_cache_set_callbacks(struct disk_cache *cache, disk_cache_put_cb put,
                          disk_cache_get_cb get);
 
+/**
+ * Start reading, decompressing and validating the \num_keys items named
+ * by \keys on background threads.
+ *
+ * If \cb is non-NULL it is called from one of those threads for each key,
+ * in no particular order. Otherwise the items are kept in memory, (up to a
+ * limit), and a later disk_cache_get() of one of the keys returns it
+ * without touching the disk, waiting for it first if it is still being
+ * read.
+ *
+ * If \fence is non-NULL it is reset here and signalled once all the keys
+ * have been processed.
+ */
+void
+disk_cache_prefetch(struct disk_cache *cache, const cache_key *keys,
+                    unsigned num_keys, disk_cache_prefetch_cb cb,
+                    void *cb_data, struct util_queue_fence *fence);
+
 #else
 
 static inline struct disk_cache *
@@ -279,6 +306,14 @@ disk_cache_set_callbacks(struct disk_cache *cache, disk_cache_put_cb put,
    return;
 }
 
+static inline void
+disk_cache_prefetch(struct disk_cache *cache, const cache_key *keys,
+                    unsigned num_keys, disk_cache_prefetch_cb cb,
+                    void *cb_data, struct util_queue_fence *fence)
+{
+   return;
+}
+
 #endif /* ENABLE_SHADER_CACHE */
 
 #ifdef __cplusplus
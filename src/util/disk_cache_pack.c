@@ -0,0 +1,1033 @@
+/*
+ * Copyright © 2019 The Mesa Authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifdef ENABLE_SHADER_CACHE
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include "c11/threads.h"
+#include "util/crc32.h"
+#include "util/macros.h"
+#include "util/u_atomic.h"
+
+#include "disk_cache_pack.h"
+
+/* Must match CACHE_KEY_SIZE. */
+#define PACK_KEY_SIZE 20
+
+/* Bump whenever the layout of the index or the pack changes. Both are
+ * recreated from scratch when their version doesn't match.
+ */
+#define PACK_VERSION 1
+
+/* Number of slots in the index hash table, (a power of two). Least recently
+ * used entries are evicted before the table becomes more than 3/4 full to
+ * keep the linear probing sequences short.
+ */
+#define PACK_INDEX_SLOTS (1 << 17)
+#define PACK_INDEX_MAX_ENTRIES (PACK_INDEX_SLOTS / 4 * 3)
+
+/* The pack is compacted once more than half of it, and at least this many
+ * bytes, are taken up by evicted or removed records.
+ */
+#define PACK_COMPACT_MIN_DEAD_SIZE (1024 * 1024)
+
+#define PACK_RECORD_MAGIC 0x4352504d /* "MPRC" */
+
+/* Offset of a slot that held an entry which has since been evicted. */
+#define PACK_SLOT_DELETED UINT64_MAX
+
+static const char pack_file_magic[8] = { 'M', 'E', 'S', 'A', 'P', 'A', 'C', 'K' };
+static const char pack_index_magic[8] = { 'M', 'E', 'S', 'A', 'P', 'I', 'D', 'X' };
+
+struct pack_file_header {
+   char magic[8];
+   uint32_t version;
+   uint32_t pad;
+   uint64_t generation;
+};
+
+/* Every entry in the pack is preceded by one of these. Since records carry
+ * their own key and checksum they don't depend on the index for anything;
+ * a record the index points to is only used if it validates.
+ *
+ * A record without an entry marks the removal or eviction of the key, so
+ * that recovery doesn't bring back entries that are gone from the index.
+ */
+struct pack_record_header {
+   uint32_t magic;
+   uint32_t size;
+   uint8_t key[PACK_KEY_SIZE];
+   uint32_t crc32;
+};
+
+struct pack_index_header {
+   char magic[8];
+   uint32_t version;
+
+   /* Set while the slots don't describe the pack named by generation, (i.e.
+    * while they are being rewritten by compaction or recovery). An index
+    * that is found dirty under the lock is rebuilt from the pack.
+    */
+   uint32_t dirty;
+
+   uint64_t generation;
+
+   /* End of the last record appended to the pack. */
+   uint64_t pack_size;
+
+   /* Total size of the records (headers included) reachable from slots. */
+   uint64_t live_size;
+
+   /* Bumped on every access, stamped into the slot that was accessed. */
+   uint64_t lru_clock;
+
+   uint32_t num_entries;
+   uint32_t num_deleted;
+};
+
+struct pack_index_slot {
+   uint8_t key[PACK_KEY_SIZE];
+
+   /* Size of the record, header included. */
+   uint32_t size;
+
+   /* Offset of the record in the pack, 0 for an empty slot or
+    * PACK_SLOT_DELETED.
+    */
+   uint64_t offset;
+
+   uint64_t last_access;
+};
+
+struct disk_cache_pack {
+   char *path;
+   uint64_t max_size;
+
+   /* Protects pack_fd/generation and serializes the writers within this
+    * process. Writers in different processes are serialized by an exclusive
+    * flock on the index file. Readers only hold the mutex for the index
+    * lookup and don't take the flock: a reader racing with a writer may at
+    * worst see a record that doesn't validate and treat it as a miss.
+    */
+   mtx_t mutex;
+
+   int index_fd;
+   void *index_mmap;
+   size_t index_mmap_size;
+   struct pack_index_header *header;
+   struct pack_index_slot *slots;
+
+   int pack_fd;
+   uint64_t generation;
+};
+
+static ssize_t
+pread_all(int fd, void *buf, size_t count, uint64_t offset)
+{
+   char *in = buf;
+   ssize_t read_ret;
+   size_t done;
+
+   for (done = 0; done < count; done += read_ret) {
+      read_ret = pread(fd, in + done, count - done, offset + done);
+      if (read_ret == -1 || read_ret == 0)
+         return -1;
+   }
+   return done;
+}
+
+static ssize_t
+pwrite_all(int fd, const void *buf, size_t count, uint64_t offset)
+{
+   const char *out = buf;
+   ssize_t written;
+   size_t done;
+
+   for (done = 0; done < count; done += written) {
+      written = pwrite(fd, out + done, count - done, offset + done);
+      if (written == -1)
+         return -1;
+   }
+   return done;
+}
+
+static char *
+get_pack_filename(struct disk_cache_pack *pack, uint64_t generation)
+{
+   char *filename;
+
+   if (asprintf(&filename, "%s/pack.%" PRIu64, pack->path, generation) == -1)
+      return NULL;
+
+   return filename;
+}
+
+/* Returns the generation of a pack file name, or 0 for other files. */
+static uint64_t
+parse_pack_filename(const char *name)
+{
+   uint64_t generation;
+   int len;
+
+   if (sscanf(name, "pack.%" SCNu64 "%n", &generation, &len) != 1 ||
+       name[len] != '\0')
+      return 0;
+
+   return generation;
+}
+
+/* Open the pack file of the given generation and check its header.
+ *
+ * Returns: the file descriptor, or -1 on any error.
+ */
+static int
+open_pack_file(struct disk_cache_pack *pack, uint64_t generation)
+{
+   struct pack_file_header header;
+   char *filename;
+   int fd;
+
+   filename = get_pack_filename(pack, generation);
+   if (filename == NULL)
+      return -1;
+
+   fd = open(filename, O_RDWR | O_CLOEXEC);
+   free(filename);
+   if (fd == -1)
+      return -1;
+
+   if (pread_all(fd, &header, sizeof(header), 0) == -1 ||
+       memcmp(header.magic, pack_file_magic, sizeof(header.magic)) != 0 ||
+       header.version != PACK_VERSION ||
+       header.generation != generation) {
+      close(fd);
+      return -1;
+   }
+
+   return fd;
+}
+
+static int
+create_pack_file(struct disk_cache_pack *pack, uint64_t generation)
+{
+   struct pack_file_header header;
+   char *filename;
+   int fd;
+
+   filename = get_pack_filename(pack, generation);
+   if (filename == NULL)
+      return -1;
+
+   fd = open(filename, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+   if (fd == -1) {
+      free(filename);
+      return -1;
+   }
+
+   memset(&header, 0, sizeof(header));
+   memcpy(header.magic, pack_file_magic, sizeof(header.magic));
+   header.version = PACK_VERSION;
+   header.generation = generation;
+
+   if (pwrite_all(fd, &header, sizeof(header), 0) == -1) {
+      unlink(filename);
+      close(fd);
+      fd = -1;
+   }
+
+   free(filename);
+   return fd;
+}
+
+/* Remove every pack file but the one of the given generation. Only called
+ * with the index locked, so no other process can be writing one.
+ */
+static void
+remove_stale_pack_files(struct disk_cache_pack *pack, uint64_t generation)
+{
+   struct dirent *entry;
+   DIR *dir;
+
+   dir = opendir(pack->path);
+   if (dir == NULL)
+      return;
+
+   while ((entry = readdir(dir)) != NULL) {
+      uint64_t gen = parse_pack_filename(entry->d_name);
+      if (gen && gen != generation)
+         unlinkat(dirfd(dir), entry->d_name, 0);
+   }
+
+   closedir(dir);
+}
+
+/* Returns the newest generation for which a valid pack file exists, or 0. */
+static uint64_t
+find_newest_pack_file(struct disk_cache_pack *pack)
+{
+   uint64_t newest = 0;
+   struct dirent *entry;
+   DIR *dir;
+
+   dir = opendir(pack->path);
+   if (dir == NULL)
+      return 0;
+
+   while ((entry = readdir(dir)) != NULL) {
+      uint64_t gen = parse_pack_filename(entry->d_name);
+      if (gen <= newest)
+         continue;
+
+      int fd = open_pack_file(pack, gen);
+      if (fd != -1) {
+         newest = gen;
+         close(fd);
+      }
+   }
+
+   closedir(dir);
+
+   return newest;
+}
+
+static uint32_t
+hash_key(const uint8_t *key)
+{
+   uint32_t hash;
+
+   /* Keys are cryptographic hashes already. */
+   memcpy(&hash, key, sizeof(hash));
+   return hash;
+}
+
+/* Find the slot holding \key, or if \insert is set, the slot \key should be
+ * stored to if it isn't there.
+ */
+static struct pack_index_slot *
+find_slot(struct disk_cache_pack *pack, const uint8_t *key, bool insert)
+{
+   struct pack_index_slot *deleted = NULL;
+   uint32_t mask = PACK_INDEX_SLOTS - 1;
+   uint32_t i = hash_key(key) & mask;
+   unsigned n;
+
+   for (n = 0; n < PACK_INDEX_SLOTS; n++, i = (i + 1) & mask) {
+      struct pack_index_slot *slot = &pack->slots[i];
+      uint64_t offset = p_atomic_read(&slot->offset);
+
+      if (offset == 0)
+         return insert ? (deleted ? deleted : slot) : NULL;
+
+      if (offset == PACK_SLOT_DELETED) {
+         if (!deleted)
+            deleted = slot;
+         continue;
+      }
+
+      if (memcmp(slot->key, key, PACK_KEY_SIZE) == 0)
+         return insert ? NULL : slot;
+   }
+
+   return insert ? deleted : NULL;
+}
+
+static bool
+insert_slot(struct disk_cache_pack *pack, const uint8_t *key, uint32_t size,
+            uint64_t offset, uint64_t last_access)
+{
+   struct pack_index_slot *slot = find_slot(pack, key, true);
+   if (slot == NULL)
+      return false;
+
+   if (slot->offset == PACK_SLOT_DELETED)
+      pack->header->num_deleted--;
+
+   memcpy(slot->key, key, PACK_KEY_SIZE);
+   slot->size = size;
+   slot->last_access = last_access;
+
+   /* Publish the slot to lock-free readers last. */
+   p_atomic_set(&slot->offset, offset);
+
+   pack->header->num_entries++;
+   pack->header->live_size += size;
+
+   return true;
+}
+
+static void
+delete_slot(struct disk_cache_pack *pack, struct pack_index_slot *slot)
+{
+   p_atomic_set(&slot->offset, PACK_SLOT_DELETED);
+
+   pack->header->num_entries--;
+   pack->header->num_deleted++;
+   pack->header->live_size -= slot->size;
+}
+
+/* Read the record at \offset and check that it is a valid record for \key,
+ * (or for any key if \key is NULL, in which case the key of the record is
+ * returned in \record_key).
+ *
+ * Returns: the malloc'ed entry, (or NULL on any error).
+ */
+static void *
+read_record(int fd, uint64_t offset, const uint8_t *key, uint8_t *record_key,
+            uint32_t *entry_size)
+{
+   struct pack_record_header header;
+   void *entry;
+
+   if (pread_all(fd, &header, sizeof(header), offset) == -1)
+      return NULL;
+
+   if (header.magic != PACK_RECORD_MAGIC ||
+       (key && memcmp(header.key, key, PACK_KEY_SIZE) != 0))
+      return NULL;
+
+   entry = malloc(MAX2(header.size, 1));
+   if (entry == NULL)
+      return NULL;
+
+   if (pread_all(fd, entry, header.size, offset + sizeof(header)) == -1 ||
+       header.crc32 != util_hash_crc32(entry, header.size)) {
+      free(entry);
+      return NULL;
+   }
+
+   if (record_key)
+      memcpy(record_key, header.key, PACK_KEY_SIZE);
+   *entry_size = header.size;
+
+   return entry;
+}
+
+static void
+reset_index(struct disk_cache_pack *pack, uint64_t generation)
+{
+   struct pack_index_header *header = pack->header;
+
+   memset(pack->slots, 0, PACK_INDEX_SLOTS * sizeof(*pack->slots));
+
+   memcpy(header->magic, pack_index_magic, sizeof(header->magic));
+   header->version = PACK_VERSION;
+   header->generation = generation;
+   header->pack_size = sizeof(struct pack_file_header);
+   header->live_size = 0;
+   header->num_entries = 0;
+   header->num_deleted = 0;
+}
+
+/* Rebuild the index from the records of the newest valid pack, (or start
+ * over with an empty pack if there is none). Called with the index locked
+ * when it is missing, from an older version or was left dirty by a process
+ * that died while rewriting it.
+ *
+ * Records are scanned in the order they were appended, which is also a fair
+ * approximation of their LRU order. The scan stops at the first record that
+ * doesn't validate, (a write interrupted by a crash).
+ */
+static bool
+recover_index(struct disk_cache_pack *pack)
+{
+   struct pack_index_header *header = pack->header;
+   uint64_t generation = 0;
+   int fd = -1;
+
+   if (memcmp(header->magic, pack_index_magic, sizeof(header->magic)) == 0 &&
+       header->version == PACK_VERSION) {
+      generation = header->generation;
+      fd = open_pack_file(pack, generation);
+   }
+
+   if (fd == -1) {
+      generation = find_newest_pack_file(pack);
+      if (generation)
+         fd = open_pack_file(pack, generation);
+   }
+
+   header->dirty = 1;
+
+   if (fd == -1) {
+      generation++;
+      fd = create_pack_file(pack, generation);
+      if (fd == -1)
+         return false;
+      reset_index(pack, generation);
+   } else {
+      uint64_t offset = sizeof(struct pack_file_header);
+      uint8_t key[PACK_KEY_SIZE];
+      uint32_t entry_size;
+      void *entry;
+
+      reset_index(pack, generation);
+
+      while ((entry = read_record(fd, offset, NULL, key, &entry_size))) {
+         uint32_t size = sizeof(struct pack_record_header) + entry_size;
+
+         free(entry);
+
+         struct pack_index_slot *slot = find_slot(pack, key, false);
+         if (entry_size == 0) {
+            if (slot)
+               delete_slot(pack, slot);
+         } else if (slot == NULL &&
+                    header->num_entries < PACK_INDEX_MAX_ENTRIES) {
+            insert_slot(pack, key, size, offset, ++header->lru_clock);
+         }
+
+         offset += size;
+      }
+
+      header->pack_size = offset;
+   }
+
+   remove_stale_pack_files(pack, generation);
+
+   if (pack->pack_fd != -1)
+      close(pack->pack_fd);
+   pack->pack_fd = fd;
+   pack->generation = generation;
+
+   msync(pack->index_mmap, pack->index_mmap_size, MS_SYNC);
+   header->dirty = 0;
+
+   return true;
+}
+
+/* Make sure pack_fd refers to the pack the index currently describes, (it
+ * may have been compacted by another process). With \locked set, also repair
+ * the index if needed.
+ *
+ * Returns: true if the pack and the index can be used.
+ */
+static bool
+sync_pack(struct disk_cache_pack *pack, bool locked)
+{
+   struct pack_index_header *header = pack->header;
+
+   if (header->dirty ||
+       memcmp(header->magic, pack_index_magic, sizeof(header->magic)) != 0 ||
+       header->version != PACK_VERSION)
+      return locked && recover_index(pack);
+
+   if (header->generation != pack->generation || pack->pack_fd == -1) {
+      int fd = open_pack_file(pack, header->generation);
+      if (fd == -1)
+         return locked && recover_index(pack);
+
+      if (pack->pack_fd != -1)
+         close(pack->pack_fd);
+      pack->pack_fd = fd;
+      pack->generation = header->generation;
+   }
+
+   return true;
+}
+
+static bool
+lock_pack(struct disk_cache_pack *pack)
+{
+   mtx_lock(&pack->mutex);
+
+   if (flock(pack->index_fd, LOCK_EX) == -1) {
+      mtx_unlock(&pack->mutex);
+      return false;
+   }
+
+   if (!sync_pack(pack, true)) {
+      flock(pack->index_fd, LOCK_UN);
+      mtx_unlock(&pack->mutex);
+      return false;
+   }
+
+   return true;
+}
+
+static void
+unlock_pack(struct disk_cache_pack *pack)
+{
+   flock(pack->index_fd, LOCK_UN);
+   mtx_unlock(&pack->mutex);
+}
+
+struct lru_entry {
+   uint64_t last_access;
+   uint32_t slot;
+};
+
+static int
+compare_lru_entries(const void *a, const void *b)
+{
+   const struct lru_entry *ea = a, *eb = b;
+
+   if (ea->last_access < eb->last_access)
+      return -1;
+   return ea->last_access > eb->last_access;
+}
+
+/* Evict the least recently used entries until a record of \size fits.
+ *
+ * Sorting the entries by last access isn't free, so this also evicts a few
+ * percent more entries than strictly needed, (which keeps the next puts from
+ * having to evict again right away).
+ *
+ * Like removals, evictions append a record without an entry for every
+ * evicted key, so that rebuilding the index from the pack doesn't bring the
+ * evicted entries back. They are written with a single write at the end.
+ */
+static void
+evict_lru_entries(struct disk_cache_pack *pack, uint64_t size)
+{
+   struct pack_index_header *header = pack->header;
+   struct pack_record_header *tombstones;
+   struct lru_entry *entries;
+   unsigned num_entries = 0, num_evicted = 0, extra, i;
+   uint32_t empty_crc32 = util_hash_crc32(NULL, 0);
+
+   entries = malloc(MAX2(header->num_entries, 1) * sizeof(*entries));
+   tombstones = malloc(MAX2(header->num_entries, 1) * sizeof(*tombstones));
+   if (entries == NULL || tombstones == NULL) {
+      free(entries);
+      free(tombstones);
+      return;
+   }
+
+   for (i = 0; i < PACK_INDEX_SLOTS; i++) {
+      uint64_t offset = pack->slots[i].offset;
+
+      if (offset != 0 && offset != PACK_SLOT_DELETED &&
+          num_entries < header->num_entries) {
+         entries[num_entries].last_access = pack->slots[i].last_access;
+         entries[num_entries].slot = i;
+         num_entries++;
+      }
+   }
+
+   qsort(entries, num_entries, sizeof(*entries), compare_lru_entries);
+
+   extra = num_entries / 32;
+
+   for (i = 0; i < num_entries; i++) {
+      if (header->live_size + size <= pack->max_size &&
+          header->num_entries < PACK_INDEX_MAX_ENTRIES) {
+         if (extra == 0)
+            break;
+         extra--;
+      }
+
+      struct pack_index_slot *slot = &pack->slots[entries[i].slot];
+
+      tombstones[num_evicted].magic = PACK_RECORD_MAGIC;
+      tombstones[num_evicted].size = 0;
+      memcpy(tombstones[num_evicted].key, slot->key, PACK_KEY_SIZE);
+      tombstones[num_evicted].crc32 = empty_crc32;
+      num_evicted++;
+
+      delete_slot(pack, slot);
+   }
+
+   if (num_evicted &&
+       pwrite_all(pack->pack_fd, tombstones,
+                  num_evicted * sizeof(*tombstones), header->pack_size) != -1)
+      header->pack_size += num_evicted * sizeof(*tombstones);
+
+   free(tombstones);
+   free(entries);
+}
+
+static int
+compare_slot_offsets(const void *a, const void *b)
+{
+   const struct pack_index_slot *sa = a, *sb = b;
+
+   if (sa->offset < sb->offset)
+      return -1;
+   return sa->offset > sb->offset;
+}
+
+/* Copy the live records to a new generation of the pack and switch the
+ * index over to it.
+ *
+ * The new pack is complete and synced to disk before the index is touched,
+ * and the index is marked dirty while its slots are rewritten. If we die
+ * before the generation is switched, the index still describes the old
+ * pack and the partial new one is removed as stale by the next recovery.
+ * If we die after it, the next writer finds the index dirty and rebuilds it
+ * from the new pack.
+ */
+static void
+compact_pack(struct disk_cache_pack *pack)
+{
+   struct pack_index_header *header = pack->header;
+   struct pack_index_slot *live;
+   uint64_t generation = pack->generation + 1;
+   uint64_t offset = sizeof(struct pack_file_header);
+   unsigned num_live = 0, i;
+   char *filename;
+   int fd;
+
+   live = malloc(MAX2(header->num_entries, 1) * sizeof(*live));
+   if (live == NULL)
+      return;
+
+   for (i = 0; i < PACK_INDEX_SLOTS; i++) {
+      uint64_t slot_offset = pack->slots[i].offset;
+
+      if (slot_offset != 0 && slot_offset != PACK_SLOT_DELETED &&
+          num_live < header->num_entries)
+         live[num_live++] = pack->slots[i];
+   }
+
+   /* Read the old pack sequentially. */
+   qsort(live, num_live, sizeof(*live), compare_slot_offsets);
+
+   fd = create_pack_file(pack, generation);
+   if (fd == -1) {
+      free(live);
+      return;
+   }
+
+   for (i = 0; i < num_live; i++) {
+      struct pack_record_header record;
+      uint32_t entry_size;
+      void *entry;
+
+      entry = read_record(pack->pack_fd, live[i].offset, live[i].key, NULL,
+                          &entry_size);
+      if (entry == NULL) {
+         /* Drop records that don't validate. */
+         live[i].size = 0;
+         continue;
+      }
+
+      record.magic = PACK_RECORD_MAGIC;
+      record.size = entry_size;
+      memcpy(record.key, live[i].key, PACK_KEY_SIZE);
+      record.crc32 = util_hash_crc32(entry, entry_size);
+
+      if (pwrite_all(fd, &record, sizeof(record), offset) == -1 ||
+          pwrite_all(fd, entry, entry_size, offset + sizeof(record)) == -1) {
+         free(entry);
+         goto fail;
+      }
+
+      free(entry);
+
+      live[i].size = sizeof(record) + entry_size;
+      live[i].offset = offset;
+      offset += live[i].size;
+   }
+
+   if (fsync(fd) == -1)
+      goto fail;
+
+   header->dirty = 1;
+   header->generation = generation;
+   msync(pack->index_mmap, sysconf(_SC_PAGESIZE), MS_SYNC);
+
+   reset_index(pack, generation);
+   for (i = 0; i < num_live; i++) {
+      if (live[i].size)
+         insert_slot(pack, live[i].key, live[i].size, live[i].offset,
+                     live[i].last_access);
+   }
+   header->pack_size = offset;
+
+   msync(pack->index_mmap, pack->index_mmap_size, MS_SYNC);
+   header->dirty = 0;
+
+   filename = get_pack_filename(pack, pack->generation);
+   if (filename) {
+      unlink(filename);
+      free(filename);
+   }
+
+   close(pack->pack_fd);
+   pack->pack_fd = fd;
+   pack->generation = generation;
+
+   free(live);
+   return;
+
+ fail:
+   filename = get_pack_filename(pack, generation);
+   if (filename) {
+      unlink(filename);
+      free(filename);
+   }
+   close(fd);
+   free(live);
+}
+
+/* Append a record to the pack. It only becomes visible once pack_size is
+ * updated, a record beyond pack_size, (a put interrupted by a crash), is
+ * simply overwritten by the next one.
+ *
+ * Returns: the offset of the record, or 0 on any error.
+ */
+static uint64_t
+append_record(struct disk_cache_pack *pack, const uint8_t *key,
+              const void *entry, uint32_t entry_size)
+{
+   struct pack_record_header record;
+   uint64_t offset = pack->header->pack_size;
+
+   record.magic = PACK_RECORD_MAGIC;
+   record.size = entry_size;
+   memcpy(record.key, key, PACK_KEY_SIZE);
+   record.crc32 = util_hash_crc32(entry, entry_size);
+
+   if (pwrite_all(pack->pack_fd, &record, sizeof(record), offset) == -1 ||
+       pwrite_all(pack->pack_fd, entry, entry_size,
+                  offset + sizeof(record)) == -1)
+      return 0;
+
+   return offset;
+}
+
+struct disk_cache_pack *
+disk_cache_pack_open(const char *path, uint64_t max_size)
+{
+   struct disk_cache_pack *pack;
+   struct stat sb;
+   char *filename;
+   size_t size;
+
+   pack = calloc(1, sizeof(*pack));
+   if (pack == NULL)
+      return NULL;
+
+   pack->index_fd = -1;
+   pack->pack_fd = -1;
+   pack->max_size = max_size;
+
+   pack->path = strdup(path);
+   if (pack->path == NULL)
+      goto fail;
+
+   if (asprintf(&filename, "%s/pack.idx", path) == -1)
+      goto fail;
+
+   pack->index_fd = open(filename, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+   free(filename);
+   if (pack->index_fd == -1)
+      goto fail;
+
+   if (flock(pack->index_fd, LOCK_EX) == -1)
+      goto fail;
+
+   if (fstat(pack->index_fd, &sb) == -1)
+      goto fail;
+
+   /* A file of any other size is from another version, (or damaged), so
+    * let recovery start over. The file is only ever grown: other processes
+    * may have it mapped, and truncating it would make their accesses past
+    * the new end fault.
+    */
+   size = sizeof(struct pack_index_header) +
+          PACK_INDEX_SLOTS * sizeof(struct pack_index_slot);
+   if (sb.st_size < size && ftruncate(pack->index_fd, size) == -1)
+      goto fail;
+
+   pack->index_mmap = mmap(NULL, size, PROT_READ | PROT_WRITE,
+                           MAP_SHARED, pack->index_fd, 0);
+   if (pack->index_mmap == MAP_FAILED) {
+      pack->index_mmap = NULL;
+      goto fail;
+   }
+   pack->index_mmap_size = size;
+
+   pack->header = pack->index_mmap;
+   pack->slots = (struct pack_index_slot *) (pack->header + 1);
+
+   if (sb.st_size != size)
+      pack->header->dirty = 1;
+
+   if (!sync_pack(pack, true))
+      goto fail;
+
+   flock(pack->index_fd, LOCK_UN);
+
+   mtx_init(&pack->mutex, mtx_plain);
+
+   return pack;
+
+ fail:
+   if (pack->index_mmap)
+      munmap(pack->index_mmap, pack->index_mmap_size);
+   if (pack->index_fd != -1)
+      close(pack->index_fd);
+   free(pack->path);
+   free(pack);
+
+   return NULL;
+}
+
+void
+disk_cache_pack_close(struct disk_cache_pack *pack)
+{
+   if (pack == NULL)
+      return;
+
+   if (pack->pack_fd != -1)
+      close(pack->pack_fd);
+   munmap(pack->index_mmap, pack->index_mmap_size);
+   close(pack->index_fd);
+   mtx_destroy(&pack->mutex);
+   free(pack->path);
+   free(pack);
+}
+
+bool
+disk_cache_pack_put(struct disk_cache_pack *pack, const uint8_t *key,
+                    const void *entry, size_t entry_size)
+{
+   struct pack_index_header *header = pack->header;
+   uint64_t size = sizeof(struct pack_record_header) + entry_size;
+   uint64_t offset;
+   bool ret = false;
+
+   if (size > pack->max_size || size > UINT32_MAX)
+      return false;
+
+   if (!lock_pack(pack))
+      return false;
+
+   /* Another process (or an earlier put of ours) got there first. */
+   if (find_slot(pack, key, false)) {
+      ret = true;
+      goto done;
+   }
+
+   if (header->live_size + size > pack->max_size ||
+       header->num_entries >= PACK_INDEX_MAX_ENTRIES)
+      evict_lru_entries(pack, size);
+
+   uint64_t dead_size =
+      header->pack_size - sizeof(struct pack_file_header) - header->live_size;
+   if ((dead_size > PACK_COMPACT_MIN_DEAD_SIZE &&
+        dead_size > header->live_size) ||
+       header->num_entries + header->num_deleted >= PACK_INDEX_MAX_ENTRIES)
+      compact_pack(pack);
+
+   offset = append_record(pack, key, entry, entry_size);
+   if (offset == 0)
+      goto done;
+
+   if (!insert_slot(pack, key, size, offset,
+                    p_atomic_inc_return(&header->lru_clock)))
+      goto done;
+
+   header->pack_size = offset + size;
+   ret = true;
+
+ done:
+   unlock_pack(pack);
+   return ret;
+}
+
+void *
+disk_cache_pack_get(struct disk_cache_pack *pack, const uint8_t *key,
+                    size_t *entry_size)
+{
+   struct pack_index_slot *slot;
+   uint64_t offset = 0;
+   uint32_t size = 0;
+   void *entry;
+   int fd = -1;
+
+   /* Only the lookup is done under the mutex. The record is read from a
+    * duplicate of pack_fd, which stays valid even if another thread
+    * compacts the pack and closes pack_fd meanwhile.
+    */
+   mtx_lock(&pack->mutex);
+
+   if (sync_pack(pack, false)) {
+      slot = find_slot(pack, key, false);
+      if (slot)
+         offset = p_atomic_read(&slot->offset);
+
+      if (offset != 0 && offset != PACK_SLOT_DELETED) {
+         fd = fcntl(pack->pack_fd, F_DUPFD_CLOEXEC, 0);
+
+         /* Racing with other readers here only makes the LRU order slightly
+          * less exact.
+          */
+         slot->last_access = p_atomic_inc_return(&pack->header->lru_clock);
+      }
+   }
+
+   mtx_unlock(&pack->mutex);
+
+   if (fd == -1)
+      return NULL;
+
+   entry = read_record(fd, offset, key, NULL, &size);
+   close(fd);
+
+   if (entry == NULL)
+      return NULL;
+
+   if (size == 0) {
+      free(entry);
+      return NULL;
+   }
+
+   *entry_size = size;
+
+   return entry;
+}
+
+void
+disk_cache_pack_remove(struct disk_cache_pack *pack, const uint8_t *key)
+{
+   struct pack_index_slot *slot;
+
+   if (!lock_pack(pack))
+      return;
+
+   slot = find_slot(pack, key, false);
+   if (slot) {
+      delete_slot(pack, slot);
+
+      if (append_record(pack, key, NULL, 0))
+         pack->header->pack_size += sizeof(struct pack_record_header);
+   }
+
+   unlock_pack(pack);
+}
+
+#endif /* ENABLE_SHADER_CACHE */
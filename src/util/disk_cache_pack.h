@@ -0,0 +1,86 @@
+/*
+ * Copyright © 2019 The Mesa Authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/* Single-file storage backend for the disk cache.
+ *
+ * Instead of one file per item, cache entries are appended to a pack file
+ * ("pack.<generation>") and located through an open-addressing hash table
+ * kept in a memory-mapped index file ("pack.idx"), which also records the
+ * last access of every entry for LRU eviction. Records in the pack carry
+ * their key and a CRC so the index can always be rebuilt from a pack, and
+ * compaction writes a complete new generation of the pack before the index
+ * is switched over to it, so a crash at any point loses at most the entries
+ * that were being written.
+ *
+ * The pack only deals in opaque entries; serializing, compressing and
+ * validating the data is left to disk_cache.c.
+ */
+
+#ifndef DISK_CACHE_PACK_H
+#define DISK_CACHE_PACK_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct disk_cache_pack;
+
+/**
+ * Open (creating or recovering as needed) the pack stored in the cache
+ * directory \path. The total size of the live entries is kept under
+ * \max_size by evicting the least recently used ones.
+ *
+ * \return NULL on failure.
+ */
+struct disk_cache_pack *
+disk_cache_pack_open(const char *path, uint64_t max_size);
+
+void
+disk_cache_pack_close(struct disk_cache_pack *pack);
+
+/**
+ * Append an entry for \key unless one is already present.
+ */
+bool
+disk_cache_pack_put(struct disk_cache_pack *pack, const uint8_t *key,
+                    const void *entry, size_t entry_size);
+
+/**
+ * \return a malloc'ed copy of the entry stored for \key, or NULL.
+ */
+void *
+disk_cache_pack_get(struct disk_cache_pack *pack, const uint8_t *key,
+                    size_t *entry_size);
+
+void
+disk_cache_pack_remove(struct disk_cache_pack *pack, const uint8_t *key);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DISK_CACHE_PACK_H */
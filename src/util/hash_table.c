@@ -33,7 +33,8 @@
  */
 
 /**
- * Implements an open-addressing, linear-reprobing hash table.
+ * Implements an open-addressing hash table, probed a group of slots at a
+ * time through per-slot control bytes (see hash_table_group.h).
  *
  * For more information, see:
  *
@@ -45,69 +46,51 @@
 #include <assert.h>
 
 #include "hash_table.h"
+#include "hash_table_group.h"
 #include "ralloc.h"
 #include "macros.h"
 #include "main/hash.h"
 
 static const uint32_t deleted_key_value;
 
-/**
- * From Knuth -- a good choice for hash/rehash values is p, p-2 where
- * p and p-2 are both prime.  These tables are sized to have an extra 10%
- * free to avoid exponential performance degradation as the hash table fills
- */
-static const struct {
-   uint32_t max_entries, size, rehash;
-} hash_sizes[] = {
-   { 2,			5,		3	  },
-   { 4,			7,		5	  },
-   { 8,			13,		11	  },
-   { 16,		19,		17	  },
-   { 32,		43,		41        },
-   { 64,		73,		71        },
-   { 128,		151,		149       },
-   { 256,		283,		281       },
-   { 512,		571,		569       },
-   { 1024,		1153,		1151      },
-   { 2048,		2269,		2267      },
-   { 4096,		4519,		4517      },
-   { 8192,		9013,		9011      },
-   { 16384,		18043,		18041     },
-   { 32768,		36109,		36107     },
-   { 65536,		72091,		72089     },
-   { 131072,		144409,		144407    },
-   { 262144,		288361,		288359    },
-   { 524288,		576883,		576881    },
-   { 1048576,		1153459,	1153457   },
-   { 2097152,		2307163,	2307161   },
-   { 4194304,		4613893,	4613891   },
-   { 8388608,		9227641,	9227639   },
-   { 16777216,		18455029,	18455027  },
-   { 33554432,		36911011,	36911009  },
-   { 67108864,		73819861,	73819859  },
-   { 134217728,		147639589,	147639587 },
-   { 268435456,		295279081,	295279079 },
-   { 536870912,		590559793,	590559791 },
-   { 1073741824,	1181116273,	1181116271},
-   { 2147483648ul,	2362232233ul,	2362232231ul}
-};
+/* Tables start with four slots and double in size from there. */
+#define MIN_SIZE_INDEX 2
+#define MAX_SIZE_INDEX 31
 
-static int
-entry_is_free(const struct hash_entry *entry)
+static uint32_t
+max_entries_for_size(uint32_t size)
 {
-   return entry->key == NULL;
+   /* A table that fits a single group only needs to keep one slot empty for
+    * lookups to stop, bigger ones are filled up to 7/8.
+    */
+   return size < HASH_GROUP_WIDTH ? size - 1 : size - size / 8;
 }
 
-static int
-entry_is_deleted(const struct hash_table *ht, struct hash_entry *entry)
+/**
+ * Allocates the entries and control bytes for a table of
+ * (1 << size_index) slots, all of them empty.
+ */
+static bool
+hash_table_alloc(struct hash_table *ht, uint32_t size_index)
 {
-   return entry->key == ht->deleted_key;
-}
+   uint32_t size = 1u << size_index;
+   struct hash_entry *table;
 
-static int
-entry_is_present(const struct hash_table *ht, struct hash_entry *entry)
-{
-   return entry->key != NULL && entry->key != ht->deleted_key;
+   table = ralloc_size(ht, size * sizeof(struct hash_entry) +
+                           hash_ctrl_bytes(size));
+   if (table == NULL)
+      return false;
+
+   ht->table = table;
+   ht->ctrl = (uint8_t *)(table + size);
+   ht->size_index = size_index;
+   ht->size = size;
+   ht->max_entries = max_entries_for_size(size);
+   ht->entries = 0;
+   ht->deleted_entries = 0;
+   hash_ctrl_reset(ht->ctrl, size);
+
+   return true;
 }
 
 struct hash_table *
@@ -122,18 +105,11 @@ _mesa_hash_table_create(void *mem_ctx,
    if (ht == NULL)
       return NULL;
 
-   ht->size_index = 0;
-   ht->size = hash_sizes[ht->size_index].size;
-   ht->rehash = hash_sizes[ht->size_index].rehash;
-   ht->max_entries = hash_sizes[ht->size_index].max_entries;
    ht->key_hash_function = key_hash_function;
    ht->key_equals_function = key_equals_function;
-   ht->table = rzalloc_array(ht, struct hash_entry, ht->size);
-   ht->entries = 0;
-   ht->deleted_entries = 0;
    ht->deleted_key = &deleted_key_value;
 
-   if (ht->table == NULL) {
+   if (!hash_table_alloc(ht, MIN_SIZE_INDEX)) {
       ralloc_free(ht);
       return NULL;
    }
@@ -144,6 +120,8 @@ _mesa_hash_table_create(void *mem_ctx,
 struct hash_table *
 _mesa_hash_table_clone(struct hash_table *src, void *dst_mem_ctx)
 {
+   size_t table_size = src->size * sizeof(struct hash_entry) +
+                       hash_ctrl_bytes(src->size);
    struct hash_table *ht;
 
    ht = ralloc(dst_mem_ctx, struct hash_table);
@@ -152,13 +130,14 @@ _mesa_hash_table_clone(struct hash_table *src, void *dst_mem_ctx)
 
    memcpy(ht, src, sizeof(struct hash_table));
 
-   ht->table = ralloc_array(ht, struct hash_entry, ht->size);
+   ht->table = ralloc_size(ht, table_size);
    if (ht->table == NULL) {
       ralloc_free(ht);
       return NULL;
    }
 
-   memcpy(ht->table, src->table, ht->size * sizeof(struct hash_entry));
+   memcpy(ht->table, src->table, table_size);
+   ht->ctrl = (uint8_t *)(ht->table + ht->size);
 
    return ht;
 }
@@ -198,29 +177,23 @@ _mesa_hash_table_clear(struct hash_table *ht,
 {
    struct hash_entry *entry;
 
-   for (entry = ht->table; entry != ht->table + ht->size; entry++) {
-      if (entry->key == NULL)
-         continue;
-
-      if (delete_function != NULL && entry->key != ht->deleted_key)
+   if (delete_function) {
+      hash_table_foreach(ht, entry) {
          delete_function(entry);
-
-      entry->key = NULL;
+      }
    }
 
+   hash_ctrl_reset(ht->ctrl, ht->size);
    ht->entries = 0;
    ht->deleted_entries = 0;
 }
 
 /** Sets the value of the key pointer used for deleted entries in the table.
  *
- * The assumption is that usually keys are actual pointers, so we use a
- * default value of a pointer to an arbitrary piece of storage in the library.
- * But in some cases a consumer wants to store some other sort of value in the
- * table, like a uint32_t, in which case that pointer may conflict with one of
- * their valid keys.  This lets that user select a safe value.
- *
- * This must be called before any keys are actually deleted from the table.
+ * Deleted entries are tracked in the control bytes rather than by replacing
+ * their key, so any non-NULL key can be stored in the table. The deleted key
+ * is only kept for users that reserve a key value of their own for it, like
+ * hash_table_u64.
  */
 void
 _mesa_hash_table_set_deleted_key(struct hash_table *ht, const void *deleted_key)
@@ -231,26 +204,33 @@ _mesa_hash_table_set_deleted_key(struct hash_table *ht, const void *deleted_key)
 static struct hash_entry *
 hash_table_search(struct hash_table *ht, uint32_t hash, const void *key)
 {
-   uint32_t start_hash_address = hash % ht->size;
-   uint32_t hash_address = start_hash_address;
+   uint64_t mix = hash_ctrl_mix(hash);
+   uint8_t h2 = hash_ctrl_h2(mix);
+   hash_group_mask window = hash_group_window(ht->size);
+   uint32_t mask = ht->size - 1;
+   uint32_t pos = hash_ctrl_h1(mix, ht->size_index);
+   uint32_t stride = 0;
 
    do {
-      uint32_t double_hash;
+      const uint8_t *group = ht->ctrl + pos;
+      hash_group_mask match = hash_group_match(group, h2) & window;
 
-      struct hash_entry *entry = ht->table + hash_address;
+      while (match) {
+         struct hash_entry *entry =
+            ht->table + ((pos + hash_group_first(match)) & mask);
 
-      if (entry_is_free(entry)) {
-         return NULL;
-      } else if (entry_is_present(ht, entry) && entry->hash == hash) {
-         if (ht->key_equals_function(key, entry->key)) {
+         if (entry->hash == hash && ht->key_equals_function(key, entry->key))
             return entry;
-         }
+
+         match &= match - 1;
       }
 
-      double_hash = 1 + hash % ht->rehash;
+      if (hash_group_match_empty(group) & window)
+         return NULL;
 
-      hash_address = (hash_address + double_hash) % ht->size;
-   } while (hash_address != start_hash_address);
+      stride += HASH_GROUP_WIDTH;
+      pos = (pos + stride) & mask;
+   } while (stride < ht->size);
 
    return NULL;
 }
@@ -276,37 +256,63 @@ _mesa_hash_table_search_pre_hashed(struct hash_table *ht, uint32_t hash,
    return hash_table_search(ht, hash, key);
 }
 
-static struct hash_entry *
-hash_table_insert(struct hash_table *ht, uint32_t hash,
-                  const void *key, void *data);
+/**
+ * Finds the first free slot on the probe sequence of the given hash.
+ *
+ * \return ht->size if there is none, which only happens when a required
+ * resize failed.
+ */
+static uint32_t
+hash_table_find_free(struct hash_table *ht, uint64_t mix)
+{
+   hash_group_mask window = hash_group_window(ht->size);
+   uint32_t mask = ht->size - 1;
+   uint32_t pos = hash_ctrl_h1(mix, ht->size_index);
+   uint32_t stride = 0;
+
+   do {
+      hash_group_mask free = hash_group_match_free(ht->ctrl + pos) & window;
+
+      if (free)
+         return (pos + hash_group_first(free)) & mask;
+
+      stride += HASH_GROUP_WIDTH;
+      pos = (pos + stride) & mask;
+   } while (stride < ht->size);
+
+   return ht->size;
+}
 
 static void
 _mesa_hash_table_rehash(struct hash_table *ht, unsigned new_size_index)
 {
    struct hash_table old_ht;
-   struct hash_entry *table, *entry;
+   struct hash_entry *entry;
 
-   if (new_size_index >= ARRAY_SIZE(hash_sizes))
+   if (new_size_index > MAX_SIZE_INDEX)
       return;
 
-   table = rzalloc_array(ht, struct hash_entry,
-                         hash_sizes[new_size_index].size);
-   if (table == NULL)
+   old_ht = *ht;
+
+   if (!hash_table_alloc(ht, new_size_index))
       return;
 
-   old_ht = *ht;
+   /* The keys are known to be distinct and the new table has no deleted
+    * slots, so each entry just goes into the first empty slot of its probe
+    * sequence, using its stored hash.
+    */
+   for (entry = old_ht.table; entry != old_ht.table + old_ht.size; entry++) {
+      uint64_t mix = hash_ctrl_mix(entry->hash);
+      uint32_t i;
 
-   ht->table = table;
-   ht->size_index = new_size_index;
-   ht->size = hash_sizes[ht->size_index].size;
-   ht->rehash = hash_sizes[ht->size_index].rehash;
-   ht->max_entries = hash_sizes[ht->size_index].max_entries;
-   ht->entries = 0;
-   ht->deleted_entries = 0;
+      if (!hash_ctrl_is_full(old_ht.ctrl[entry - old_ht.table]))
+         continue;
 
-   hash_table_foreach(&old_ht, entry) {
-      hash_table_insert(ht, entry->hash, entry->key, entry->data);
+      i = hash_table_find_free(ht, mix);
+      hash_ctrl_set(ht->ctrl, ht->size, i, hash_ctrl_h2(mix));
+      ht->table[i] = *entry;
    }
+   ht->entries = old_ht.entries;
 
    ralloc_free(old_ht.table);
 }
@@ -315,70 +321,90 @@ static struct hash_entry *
 hash_table_insert(struct hash_table *ht, uint32_t hash,
                   const void *key, void *data)
 {
-   uint32_t start_hash_address, hash_address;
-   struct hash_entry *available_entry = NULL;
+   struct hash_entry *entry;
+   uint64_t mix = hash_ctrl_mix(hash);
+   uint8_t h2 = hash_ctrl_h2(mix);
+   hash_group_mask window;
+   uint32_t mask, pos, stride = 0;
+   uint32_t available = UINT32_MAX;
 
    assert(key != NULL);
 
-   if (ht->entries >= ht->max_entries) {
-      _mesa_hash_table_rehash(ht, ht->size_index + 1);
-   } else if (ht->deleted_entries + ht->entries >= ht->max_entries) {
-      _mesa_hash_table_rehash(ht, ht->size_index);
+   if (ht->entries + ht->deleted_entries >= ht->max_entries) {
+      /* Only clean up the deleted entries in place when that frees a good
+       * share of the table, so that a table churning right at its limit
+       * doesn't rehash on every insertion.
+       */
+      if (ht->deleted_entries > ht->max_entries / 4)
+         _mesa_hash_table_rehash(ht, ht->size_index);
+      else
+         _mesa_hash_table_rehash(ht, ht->size_index + 1);
    }
 
-   start_hash_address = hash % ht->size;
-   hash_address = start_hash_address;
+   window = hash_group_window(ht->size);
+   mask = ht->size - 1;
+   pos = hash_ctrl_h1(mix, ht->size_index);
+
    do {
-      struct hash_entry *entry = ht->table + hash_address;
-      uint32_t double_hash;
-
-      if (!entry_is_present(ht, entry)) {
-         /* Stash the first available entry we find */
-         if (available_entry == NULL)
-            available_entry = entry;
-         if (entry_is_free(entry))
-            break;
-      }
+      const uint8_t *group = ht->ctrl + pos;
+      hash_group_mask match = hash_group_match(group, h2) & window;
+
+      while (match) {
+         entry = ht->table + ((pos + hash_group_first(match)) & mask);
+
+         /* Implement replacement when another insert happens
+          * with a matching key.  This is a relatively common
+          * feature of hash tables, with the alternative
+          * generally being "insert the new value as well, and
+          * return it first when the key is searched for".
+          *
+          * Note that the hash table doesn't have a delete
+          * callback.  If freeing of old data pointers is
+          * required to avoid memory leaks, perform a search
+          * before inserting.
+          */
+         if (entry->hash == hash && ht->key_equals_function(key, entry->key)) {
+            entry->key = key;
+            entry->data = data;
+            return entry;
+         }
 
-      /* Implement replacement when another insert happens
-       * with a matching key.  This is a relatively common
-       * feature of hash tables, with the alternative
-       * generally being "insert the new value as well, and
-       * return it first when the key is searched for".
-       *
-       * Note that the hash table doesn't have a delete
-       * callback.  If freeing of old data pointers is
-       * required to avoid memory leaks, perform a search
-       * before inserting.
-       */
-      if (!entry_is_deleted(ht, entry) &&
-          entry->hash == hash &&
-          ht->key_equals_function(key, entry->key)) {
-         entry->key = key;
-         entry->data = data;
-         return entry;
+         match &= match - 1;
       }
 
+      /* Stash the first available slot we find */
+      if (available == UINT32_MAX) {
+         hash_group_mask free = hash_group_match_free(group) & window;
 
-      double_hash = 1 + hash % ht->rehash;
+         if (free)
+            available = (pos + hash_group_first(free)) & mask;
+      }
 
-      hash_address = (hash_address + double_hash) % ht->size;
-   } while (hash_address != start_hash_address);
+      if (hash_group_match_empty(group) & window)
+         break;
 
-   if (available_entry) {
-      if (entry_is_deleted(ht, available_entry))
-         ht->deleted_entries--;
-      available_entry->hash = hash;
-      available_entry->key = key;
-      available_entry->data = data;
-      ht->entries++;
-      return available_entry;
+      stride += HASH_GROUP_WIDTH;
+      pos = (pos + stride) & mask;
+   } while (stride < ht->size);
+
+   if (available == UINT32_MAX) {
+      /* We could hit here if a required resize failed. An unchecked-malloc
+       * application could ignore this result.
+       */
+      return NULL;
    }
 
-   /* We could hit here if a required resize failed. An unchecked-malloc
-    * application could ignore this result.
-    */
-   return NULL;
+   if (ht->ctrl[available] == HASH_CTRL_DELETED)
+      ht->deleted_entries--;
+   hash_ctrl_set(ht->ctrl, ht->size, available, h2);
+
+   entry = ht->table + available;
+   entry->hash = hash;
+   entry->key = key;
+   entry->data = data;
+   ht->entries++;
+
+   return entry;
 }
 
 /**
@@ -406,7 +432,8 @@ _mesa_hash_table_insert_pre_hashed(struct hash_table *ht, uint32_t hash,
  * This function deletes the given hash table entry.
  *
  * Note that deletion doesn't otherwise modify the table, so an iteration over
- * the table deleting entries is safe.
+ * the table deleting entries is safe. The slot only becomes a tombstone when
+ * lookups may have probed past it, see hash_ctrl_erase().
  */
 void
 _mesa_hash_table_remove(struct hash_table *ht,
@@ -415,9 +442,9 @@ _mesa_hash_table_remove(struct hash_table *ht,
    if (!entry)
       return;
 
-   entry->key = ht->deleted_key;
+   if (hash_ctrl_erase(ht->ctrl, ht->size, entry - ht->table))
+      ht->deleted_entries++;
    ht->entries--;
-   ht->deleted_entries++;
 }
 
 /**
@@ -433,24 +460,25 @@ void _mesa_hash_table_remove_key(struct hash_table *ht,
  * This function is an iterator over the hash table.
  *
  * Pass in NULL for the first entry, as in the start of a for loop.  Note that
- * an iteration over the table is O(table_size) not O(entries).
+ * an iteration over the table is O(table_size) not O(entries), but it only
+ * looks at the control bytes of empty slots.
  */
 struct hash_entry *
 _mesa_hash_table_next_entry(struct hash_table *ht,
                             struct hash_entry *entry)
 {
-   if (entry == NULL)
-      entry = ht->table;
-   else
-      entry = entry + 1;
-
-   for (; entry != ht->table + ht->size; entry++) {
-      if (entry_is_present(ht, entry)) {
-         return entry;
-      }
-   }
+   struct hash_entry *next = entry ? entry + 1 : ht->table;
+   uint32_t i = next - ht->table;
 
-   return NULL;
+   /* Most slots are in use, so check the next one before skipping ahead a
+    * group at a time.
+    */
+   if (i < ht->size && hash_ctrl_is_full(ht->ctrl[i]))
+      return next;
+
+   i = hash_ctrl_next_full(ht->ctrl, ht->size, i);
+
+   return i < ht->size ? ht->table + i : NULL;
 }
 
 /**
@@ -465,24 +493,22 @@ struct hash_entry *
 _mesa_hash_table_random_entry(struct hash_table *ht,
                               bool (*predicate)(struct hash_entry *entry))
 {
-   struct hash_entry *entry;
-   uint32_t i = rand() % ht->size;
+   uint32_t start = rand() % ht->size;
+   uint32_t i;
 
    if (ht->entries == 0)
       return NULL;
 
-   for (entry = ht->table + i; entry != ht->table + ht->size; entry++) {
-      if (entry_is_present(ht, entry) &&
-          (!predicate || predicate(entry))) {
-         return entry;
-      }
+   for (i = hash_ctrl_next_full(ht->ctrl, ht->size, start); i < ht->size;
+        i = hash_ctrl_next_full(ht->ctrl, ht->size, i + 1)) {
+      if (!predicate || predicate(ht->table + i))
+         return ht->table + i;
    }
 
-   for (entry = ht->table; entry != ht->table + i; entry++) {
-      if (entry_is_present(ht, entry) &&
-          (!predicate || predicate(entry))) {
-         return entry;
-      }
+   for (i = hash_ctrl_next_full(ht->ctrl, ht->size, 0); i < start;
+        i = hash_ctrl_next_full(ht->ctrl, ht->size, i + 1)) {
+      if (!predicate || predicate(ht->table + i))
+         return ht->table + i;
    }
 
    return NULL;
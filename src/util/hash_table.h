@@ -44,13 +44,20 @@ struct hash_entry {
    void *data;
 };
 
+/**
+ * Open-addressing hash table with a power-of-two number of slots.
+ *
+ * Whether a slot of \c table holds an entry is tracked by the control byte
+ * array \c ctrl (see hash_table_group.h), which lives in the same
+ * allocation right after \c table.
+ */
 struct hash_table {
    struct hash_entry *table;
+   uint8_t *ctrl;
    uint32_t (*key_hash_function)(const void *key);
    bool (*key_equals_function)(const void *a, const void *b);
    const void *deleted_key;
    uint32_t size;
-   uint32_t rehash;
    uint32_t max_entries;
    uint32_t size_index;
    uint32_t entries;
@@ -135,9 +142,9 @@ _mesa_fnv32_1a_accumulate_block(uint32_t hash, const void *data, size_t size)
    _mesa_fnv32_1a_accumulate_block(hash, &(expr), sizeof(expr))
 
 /**
- * This foreach function is safe against deletion (which just replaces
- * an entry's data with the deleted marker), but not against insertion
- * (which may rehash the table, making entry a dangling pointer).
+ * This foreach function is safe against deletion (which just marks the
+ * entry's slot as free), but not against insertion (which may rehash the
+ * table, making entry a dangling pointer).
  */
 #define hash_table_foreach(ht, entry)                   \
    for (entry = _mesa_hash_table_next_entry(ht, NULL);  \
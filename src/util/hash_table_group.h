@@ -0,0 +1,302 @@
+/*
+ * Copyright © 2019 The Mesa Authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/**
+ * Control bytes shared by the hash table and set implementations.
+ *
+ * Next to its array of entries, a table keeps one control byte per slot:
+ * HASH_CTRL_EMPTY, HASH_CTRL_DELETED, or for a present entry the top seven
+ * bits of its mixed hash. Lookups compare a whole group of
+ * HASH_GROUP_WIDTH control bytes at once (with SSE2 or NEON when
+ * available) and only look at the entries whose control byte matches, so
+ * a probe touches 16 bytes of control data instead of 16 entries.
+ *
+ * Table sizes are powers of two. Probing starts at an arbitrary slot, and
+ * to allow groups to be loaded from any slot, the first HASH_GROUP_WIDTH
+ * control bytes are mirrored after the last one. Groups are visited in
+ * triangular order, which reaches every group of the table.
+ */
+
+#ifndef HASH_TABLE_GROUP_H
+#define HASH_TABLE_GROUP_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "bitscan.h"
+#include "u_endian.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define HASH_GROUP_SSE2
+#elif (defined(__ARM_NEON) || defined(__ARM_NEON__)) && \
+      defined(PIPE_ARCH_LITTLE_ENDIAN)
+#include <arm_neon.h>
+#define HASH_GROUP_NEON
+#endif
+
+#define HASH_GROUP_WIDTH 16
+
+#define HASH_CTRL_EMPTY   ((uint8_t)0x80)
+#define HASH_CTRL_DELETED ((uint8_t)0xfe)
+
+/* Masks returned by the group matches hold one bit per slot of the group,
+ * at bit (slot << HASH_GROUP_SHIFT). HASH_GROUP_ALL has the bits of all
+ * slots set.
+ */
+typedef uint64_t hash_group_mask;
+
+#if defined(HASH_GROUP_SSE2)
+
+#define HASH_GROUP_SHIFT 0
+#define HASH_GROUP_ALL 0xffffull
+
+static inline hash_group_mask
+hash_group_match(const uint8_t *ctrl, uint8_t h2)
+{
+   __m128i group = _mm_loadu_si128((const __m128i *)ctrl);
+   return _mm_movemask_epi8(_mm_cmpeq_epi8(group, _mm_set1_epi8(h2)));
+}
+
+static inline hash_group_mask
+hash_group_match_empty(const uint8_t *ctrl)
+{
+   return hash_group_match(ctrl, HASH_CTRL_EMPTY);
+}
+
+/* Empty or deleted slots, the ones with the top bit set. */
+static inline hash_group_mask
+hash_group_match_free(const uint8_t *ctrl)
+{
+   return _mm_movemask_epi8(_mm_loadu_si128((const __m128i *)ctrl));
+}
+
+#elif defined(HASH_GROUP_NEON)
+
+#define HASH_GROUP_SHIFT 2
+#define HASH_GROUP_ALL 0x1111111111111111ull
+
+/* NEON has no movemask, narrow every 0x00/0xff lane to a nibble instead
+ * and keep one bit of it.
+ */
+static inline hash_group_mask
+hash_group_nibbles(uint8x16_t lanes)
+{
+   uint8x8_t nibbles = vshrn_n_u16(vreinterpretq_u16_u8(lanes), 4);
+   return vget_lane_u64(vreinterpret_u64_u8(nibbles), 0) & HASH_GROUP_ALL;
+}
+
+static inline hash_group_mask
+hash_group_match(const uint8_t *ctrl, uint8_t h2)
+{
+   return hash_group_nibbles(vceqq_u8(vld1q_u8(ctrl), vdupq_n_u8(h2)));
+}
+
+static inline hash_group_mask
+hash_group_match_empty(const uint8_t *ctrl)
+{
+   return hash_group_match(ctrl, HASH_CTRL_EMPTY);
+}
+
+static inline hash_group_mask
+hash_group_match_free(const uint8_t *ctrl)
+{
+   int8x16_t group = vreinterpretq_s8_u8(vld1q_u8(ctrl));
+   return hash_group_nibbles(vcltq_s8(group, vdupq_n_s8(0)));
+}
+
+#else
+
+#define HASH_GROUP_SHIFT 0
+#define HASH_GROUP_ALL 0xffffull
+
+static inline hash_group_mask
+hash_group_match(const uint8_t *ctrl, uint8_t h2)
+{
+   hash_group_mask mask = 0;
+
+   for (unsigned i = 0; i < HASH_GROUP_WIDTH; i++)
+      mask |= (hash_group_mask)(ctrl[i] == h2) << i;
+
+   return mask;
+}
+
+static inline hash_group_mask
+hash_group_match_empty(const uint8_t *ctrl)
+{
+   return hash_group_match(ctrl, HASH_CTRL_EMPTY);
+}
+
+static inline hash_group_mask
+hash_group_match_free(const uint8_t *ctrl)
+{
+   hash_group_mask mask = 0;
+
+   for (unsigned i = 0; i < HASH_GROUP_WIDTH; i++)
+      mask |= (hash_group_mask)(ctrl[i] >> 7) << i;
+
+   return mask;
+}
+
+#endif
+
+/* Present entries of a group. */
+static inline hash_group_mask
+hash_group_match_full(const uint8_t *ctrl)
+{
+   return ~hash_group_match_free(ctrl) & HASH_GROUP_ALL;
+}
+
+/* Index of the first slot in a non-zero mask. */
+static inline unsigned
+hash_group_first(hash_group_mask mask)
+{
+   return (ffsll(mask) - 1) >> HASH_GROUP_SHIFT;
+}
+
+/* Index of the last slot in a non-zero mask. */
+static inline unsigned
+hash_group_last(hash_group_mask mask)
+{
+   return (util_last_bit64(mask) - 1) >> HASH_GROUP_SHIFT;
+}
+
+/**
+ * The slots of a group that belong to a table of \p size slots.
+ *
+ * A table smaller than a group is always probed with a single group, whose
+ * first \p size slots cover the whole table through the mirrored control
+ * bytes. The rest of such a group is ignored.
+ */
+static inline hash_group_mask
+hash_group_window(uint32_t size)
+{
+   if (size >= HASH_GROUP_WIDTH)
+      return ~(hash_group_mask)0;
+
+   return ((hash_group_mask)1 << (size << HASH_GROUP_SHIFT)) - 1;
+}
+
+/**
+ * Spreads the bits of a key's hash, so that hash functions which only
+ * vary in some bits, like _mesa_hash_pointer(), still use the whole table.
+ */
+static inline uint64_t
+hash_ctrl_mix(uint32_t hash)
+{
+   return hash * 0x9e3779b97f4a7c15ull;
+}
+
+/* The control byte of a present entry. */
+static inline uint8_t
+hash_ctrl_h2(uint64_t mix)
+{
+   return mix >> 57;
+}
+
+/* The slot where probing starts in a table of (1 << size_log2) slots. */
+static inline uint32_t
+hash_ctrl_h1(uint64_t mix, uint32_t size_log2)
+{
+   return (mix >> (57 - size_log2)) & ((1u << size_log2) - 1);
+}
+
+/* Size of the control byte array of a table of \p size slots. */
+static inline size_t
+hash_ctrl_bytes(uint32_t size)
+{
+   return size + HASH_GROUP_WIDTH;
+}
+
+static inline bool
+hash_ctrl_is_full(uint8_t ctrl)
+{
+   return !(ctrl & 0x80);
+}
+
+static inline void
+hash_ctrl_reset(uint8_t *ctrl, uint32_t size)
+{
+   memset(ctrl, HASH_CTRL_EMPTY, hash_ctrl_bytes(size));
+}
+
+static inline void
+hash_ctrl_set(uint8_t *ctrl, uint32_t size, uint32_t i, uint8_t value)
+{
+   ctrl[i] = value;
+   if (i < HASH_GROUP_WIDTH)
+      ctrl[size + i] = value;
+}
+
+/**
+ * Marks slot \p i as no longer present.
+ *
+ * The slot can only be made empty again if no lookup ever probed past it,
+ * which is the case when every group containing the slot also contains an
+ * empty slot: then the run of non-empty slots around it is shorter than a
+ * group. Otherwise it has to become a tombstone, until the next rehash.
+ *
+ * \return true if a tombstone was left.
+ */
+static inline bool
+hash_ctrl_erase(uint8_t *ctrl, uint32_t size, uint32_t i)
+{
+   if (size > HASH_GROUP_WIDTH) {
+      uint32_t before = (i - HASH_GROUP_WIDTH) & (size - 1);
+      hash_group_mask empty_before = hash_group_match_empty(ctrl + before);
+      hash_group_mask empty_after = hash_group_match_empty(ctrl + i);
+
+      if (!empty_before || !empty_after ||
+          (HASH_GROUP_WIDTH - 1 - hash_group_last(empty_before)) +
+          hash_group_first(empty_after) >= HASH_GROUP_WIDTH) {
+         hash_ctrl_set(ctrl, size, i, HASH_CTRL_DELETED);
+         return true;
+      }
+   }
+
+   hash_ctrl_set(ctrl, size, i, HASH_CTRL_EMPTY);
+   return false;
+}
+
+/**
+ * \return the first present slot at or after \p i, or \p size if there is
+ * none.
+ */
+static inline uint32_t
+hash_ctrl_next_full(const uint8_t *ctrl, uint32_t size, uint32_t i)
+{
+   for (; i < size; i += HASH_GROUP_WIDTH) {
+      hash_group_mask full = hash_group_match_full(ctrl + i);
+
+      if (full) {
+         i += hash_group_first(full);
+         return i < size ? i : size;
+      }
+   }
+
+   return size;
+}
+
+#endif /* HASH_TABLE_GROUP_H */
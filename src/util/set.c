@@ -36,71 +36,44 @@
 #include <assert.h>
 #include <string.h>
 
-#include "macros.h"
+#include "hash_table_group.h"
 #include "ralloc.h"
 #include "set.h"
 
-/*
- * From Knuth -- a good choice for hash/rehash values is p, p-2 where
- * p and p-2 are both prime.  These tables are sized to have an extra 10%
- * free to avoid exponential performance degradation as the hash table fills
- */
+/* Sets start with four slots and double in size from there. */
+#define MIN_SIZE_INDEX 2
+#define MAX_SIZE_INDEX 31
 
-static const uint32_t deleted_key_value;
-static const void *deleted_key = &deleted_key_value;
-
-static const struct {
-   uint32_t max_entries, size, rehash;
-} hash_sizes[] = {
-   { 2,            5,            3            },
-   { 4,            7,            5            },
-   { 8,            13,           11           },
-   { 16,           19,           17           },
-   { 32,           43,           41           },
-   { 64,           73,           71           },
-   { 128,          151,          149          },
-   { 256,          283,          281          },
-   { 512,          571,          569          },
-   { 1024,         1153,         1151         },
-   { 2048,         2269,         2267         },
-   { 4096,         4519,         4517         },
-   { 8192,         9013,         9011         },
-   { 16384,        18043,        18041        },
-   { 32768,        36109,        36107        },
-   { 65536,        72091,        72089        },
-   { 131072,       144409,       144407       },
-   { 262144,       288361,       288359       },
-   { 524288,       576883,       576881       },
-   { 1048576,      1153459,      1153457      },
-   { 2097152,      2307163,      2307161      },
-   { 4194304,      4613893,      4613891      },
-   { 8388608,      9227641,      9227639      },
-   { 16777216,     18455029,     18455027     },
-   { 33554432,     36911011,     36911009     },
-   { 67108864,     73819861,     73819859     },
-   { 134217728,    147639589,    147639587    },
-   { 268435456,    295279081,    295279079    },
-   { 536870912,    590559793,    590559791    },
-   { 1073741824,   1181116273,   1181116271   },
-   { 2147483648ul, 2362232233ul, 2362232231ul }
-};
-
-static int
-entry_is_free(struct set_entry *entry)
+static uint32_t
+max_entries_for_size(uint32_t size)
 {
-   return entry->key == NULL;
+   /* A set that fits a single group only needs to keep one slot empty for
+    * lookups to stop, bigger ones are filled up to 7/8.
+    */
+   return size < HASH_GROUP_WIDTH ? size - 1 : size - size / 8;
 }
 
-static int
-entry_is_deleted(struct set_entry *entry)
+static bool
+set_alloc(struct set *ht, uint32_t size_index)
 {
-   return entry->key == deleted_key;
-}
+   uint32_t size = 1u << size_index;
+   struct set_entry *table;
 
-static int
-entry_is_present(struct set_entry *entry)
-{
-   return entry->key != NULL && entry->key != deleted_key;
+   table = ralloc_size(ht, size * sizeof(struct set_entry) +
+                           hash_ctrl_bytes(size));
+   if (table == NULL)
+      return false;
+
+   ht->table = table;
+   ht->ctrl = (uint8_t *)(table + size);
+   ht->size_index = size_index;
+   ht->size = size;
+   ht->max_entries = max_entries_for_size(size);
+   ht->entries = 0;
+   ht->deleted_entries = 0;
+   hash_ctrl_reset(ht->ctrl, size);
+
+   return true;
 }
 
 struct set *
@@ -115,17 +88,10 @@ _mesa_set_create(void *mem_ctx,
    if (ht == NULL)
       return NULL;
 
-   ht->size_index = 0;
-   ht->size = hash_sizes[ht->size_index].size;
-   ht->rehash = hash_sizes[ht->size_index].rehash;
-   ht->max_entries = hash_sizes[ht->size_index].max_entries;
    ht->key_hash_function = key_hash_function;
    ht->key_equals_function = key_equals_function;
-   ht->table = rzalloc_array(ht, struct set_entry, ht->size);
-   ht->entries = 0;
-   ht->deleted_entries = 0;
 
-   if (ht->table == NULL) {
+   if (!set_alloc(ht, MIN_SIZE_INDEX)) {
       ralloc_free(ht);
       return NULL;
    }
@@ -136,6 +102,8 @@ _mesa_set_create(void *mem_ctx,
 struct set *
 _mesa_set_clone(struct set *set, void *dst_mem_ctx)
 {
+   size_t table_size = set->size * sizeof(struct set_entry) +
+                       hash_ctrl_bytes(set->size);
    struct set *clone;
 
    clone = ralloc(dst_mem_ctx, struct set);
@@ -144,13 +112,14 @@ _mesa_set_clone(struct set *set, void *dst_mem_ctx)
 
    memcpy(clone, set, sizeof(struct set));
 
-   clone->table = ralloc_array(clone, struct set_entry, clone->size);
+   clone->table = ralloc_size(clone, table_size);
    if (clone->table == NULL) {
       ralloc_free(clone);
       return NULL;
    }
 
-   memcpy(clone->table, set->table, clone->size * sizeof(struct set_entry));
+   memcpy(clone->table, set->table, table_size);
+   clone->ctrl = (uint8_t *)(clone->table + clone->size);
 
    return clone;
 }
@@ -192,12 +161,13 @@ _mesa_set_clear(struct set *set, void (*delete_function)(struct set_entry *entry
    if (!set)
       return;
 
-   set_foreach (set, entry) {
-      if (delete_function)
+   if (delete_function) {
+      set_foreach (set, entry) {
          delete_function(entry);
-      entry->key = deleted_key;
+      }
    }
 
+   hash_ctrl_reset(set->ctrl, set->size);
    set->entries = set->deleted_entries = 0;
 }
 
@@ -209,26 +179,33 @@ _mesa_set_clear(struct set *set, void (*delete_function)(struct set_entry *entry
 static struct set_entry *
 set_search(const struct set *ht, uint32_t hash, const void *key)
 {
-   uint32_t hash_address;
+   uint64_t mix = hash_ctrl_mix(hash);
+   uint8_t h2 = hash_ctrl_h2(mix);
+   hash_group_mask window = hash_group_window(ht->size);
+   uint32_t mask = ht->size - 1;
+   uint32_t pos = hash_ctrl_h1(mix, ht->size_index);
+   uint32_t stride = 0;
 
-   hash_address = hash % ht->size;
    do {
-      uint32_t double_hash;
+      const uint8_t *group = ht->ctrl + pos;
+      hash_group_mask match = hash_group_match(group, h2) & window;
 
-      struct set_entry *entry = ht->table + hash_address;
+      while (match) {
+         struct set_entry *entry =
+            ht->table + ((pos + hash_group_first(match)) & mask);
 
-      if (entry_is_free(entry)) {
-         return NULL;
-      } else if (entry_is_present(entry) && entry->hash == hash) {
-         if (ht->key_equals_function(key, entry->key)) {
+         if (entry->hash == hash && ht->key_equals_function(key, entry->key))
             return entry;
-         }
+
+         match &= match - 1;
       }
 
-      double_hash = 1 + hash % ht->rehash;
+      if (hash_group_match_empty(group) & window)
+         return NULL;
 
-      hash_address = (hash_address + double_hash) % ht->size;
-   } while (hash_address != hash % ht->size);
+      stride += HASH_GROUP_WIDTH;
+      pos = (pos + stride) & mask;
+   } while (stride < ht->size);
 
    return NULL;
 }
@@ -249,36 +226,62 @@ _mesa_set_search_pre_hashed(const struct set *set, uint32_t hash,
    return set_search(set, hash, key);
 }
 
-static struct set_entry *
-set_add(struct set *ht, uint32_t hash, const void *key);
+/**
+ * Finds the first free slot on the probe sequence of the given hash.
+ *
+ * \return ht->size if there is none, which only happens when a required
+ * resize failed.
+ */
+static uint32_t
+set_find_free(struct set *ht, uint64_t mix)
+{
+   hash_group_mask window = hash_group_window(ht->size);
+   uint32_t mask = ht->size - 1;
+   uint32_t pos = hash_ctrl_h1(mix, ht->size_index);
+   uint32_t stride = 0;
+
+   do {
+      hash_group_mask free = hash_group_match_free(ht->ctrl + pos) & window;
+
+      if (free)
+         return (pos + hash_group_first(free)) & mask;
+
+      stride += HASH_GROUP_WIDTH;
+      pos = (pos + stride) & mask;
+   } while (stride < ht->size);
+
+   return ht->size;
+}
 
 static void
 set_rehash(struct set *ht, unsigned new_size_index)
 {
    struct set old_ht;
-   struct set_entry *table, *entry;
+   struct set_entry *entry;
 
-   if (new_size_index >= ARRAY_SIZE(hash_sizes))
+   if (new_size_index > MAX_SIZE_INDEX)
       return;
 
-   table = rzalloc_array(ht, struct set_entry,
-                         hash_sizes[new_size_index].size);
-   if (table == NULL)
+   old_ht = *ht;
+
+   if (!set_alloc(ht, new_size_index))
       return;
 
-   old_ht = *ht;
+   /* The keys are known to be distinct, so each entry just goes into the
+    * first empty slot of its probe sequence.
+    */
+   for (entry = old_ht.table; entry != old_ht.table + old_ht.size; entry++) {
+      uint64_t mix = hash_ctrl_mix(entry->hash);
+      uint32_t i;
 
-   ht->table = table;
-   ht->size_index = new_size_index;
-   ht->size = hash_sizes[ht->size_index].size;
-   ht->rehash = hash_sizes[ht->size_index].rehash;
-   ht->max_entries = hash_sizes[ht->size_index].max_entries;
-   ht->entries = 0;
-   ht->deleted_entries = 0;
+      if (!hash_ctrl_is_full(old_ht.ctrl[entry - old_ht.table]))
+         continue;
 
-   set_foreach(&old_ht, entry) {
-      set_add(ht, entry->hash, entry->key);
+      i = set_find_free(ht, mix);
+      hash_ctrl_set(ht->ctrl, ht->size, i, hash_ctrl_h2(mix));
+      ht->table[i] = *entry;
    }
+   ht->entries = old_ht.entries;
 
    ralloc_free(old_ht.table);
 }
@@ -292,63 +295,85 @@ set_rehash(struct set *ht, unsigned new_size_index)
 static struct set_entry *
 set_add(struct set *ht, uint32_t hash, const void *key)
 {
-   uint32_t hash_address;
-   struct set_entry *available_entry = NULL;
-
-   if (ht->entries >= ht->max_entries) {
-      set_rehash(ht, ht->size_index + 1);
-   } else if (ht->deleted_entries + ht->entries >= ht->max_entries) {
-      set_rehash(ht, ht->size_index);
+   struct set_entry *entry;
+   uint64_t mix = hash_ctrl_mix(hash);
+   uint8_t h2 = hash_ctrl_h2(mix);
+   hash_group_mask window;
+   uint32_t mask, pos, stride = 0;
+   uint32_t available = UINT32_MAX;
+
+   if (ht->entries + ht->deleted_entries >= ht->max_entries) {
+      /* Only clean up the deleted entries in place when that frees a good
+       * share of the set, so that a set churning right at its limit doesn't
+       * rehash on every insertion.
+       */
+      if (ht->deleted_entries > ht->max_entries / 4)
+         set_rehash(ht, ht->size_index);
+      else
+         set_rehash(ht, ht->size_index + 1);
    }
 
-   hash_address = hash % ht->size;
+   window = hash_group_window(ht->size);
+   mask = ht->size - 1;
+   pos = hash_ctrl_h1(mix, ht->size_index);
+
    do {
-      struct set_entry *entry = ht->table + hash_address;
-      uint32_t double_hash;
-
-      if (!entry_is_present(entry)) {
-         /* Stash the first available entry we find */
-         if (available_entry == NULL)
-            available_entry = entry;
-         if (entry_is_free(entry))
-            break;
+      const uint8_t *group = ht->ctrl + pos;
+      hash_group_mask match = hash_group_match(group, h2) & window;
+
+      while (match) {
+         entry = ht->table + ((pos + hash_group_first(match)) & mask);
+
+         /* Implement replacement when another insert happens
+          * with a matching key.  This is a relatively common
+          * feature of hash tables, with the alternative
+          * generally being "insert the new value as well, and
+          * return it first when the key is searched for".
+          *
+          * Note that the hash table doesn't have a delete callback.
+          * If freeing of old keys is required to avoid memory leaks,
+          * perform a search before inserting.
+          */
+         if (entry->hash == hash && ht->key_equals_function(key, entry->key)) {
+            entry->key = key;
+            return entry;
+         }
+
+         match &= match - 1;
       }
 
-      /* Implement replacement when another insert happens
-       * with a matching key.  This is a relatively common
-       * feature of hash tables, with the alternative
-       * generally being "insert the new value as well, and
-       * return it first when the key is searched for".
-       *
-       * Note that the hash table doesn't have a delete callback.
-       * If freeing of old keys is required to avoid memory leaks,
-       * perform a search before inserting.
-       */
-      if (!entry_is_deleted(entry) &&
-          entry->hash == hash &&
-          ht->key_equals_function(key, entry->key)) {
-         entry->key = key;
-         return entry;
+      /* Stash the first available slot we find */
+      if (available == UINT32_MAX) {
+         hash_group_mask free = hash_group_match_free(group) & window;
+
+         if (free)
+            available = (pos + hash_group_first(free)) & mask;
       }
 
-      double_hash = 1 + hash % ht->rehash;
+      if (hash_group_match_empty(group) & window)
+         break;
 
-      hash_address = (hash_address + double_hash) % ht->size;
-   } while (hash_address != hash % ht->size);
+      stride += HASH_GROUP_WIDTH;
+      pos = (pos + stride) & mask;
+   } while (stride < ht->size);
 
-   if (available_entry) {
-      if (entry_is_deleted(available_entry))
-         ht->deleted_entries--;
-      available_entry->hash = hash;
-      available_entry->key = key;
-      ht->entries++;
-      return available_entry;
+   if (available == UINT32_MAX) {
+      /* We could hit here if a required resize failed. An unchecked-malloc
+       * application could ignore this result.
+       */
+      return NULL;
    }
 
-   /* We could hit here if a required resize failed. An unchecked-malloc
-    * application could ignore this result.
-    */
-   return NULL;
+   if (ht->ctrl[available] == HASH_CTRL_DELETED)
+      ht->deleted_entries--;
+   hash_ctrl_set(ht->ctrl, ht->size, available, h2);
+
+   entry = ht->table + available;
+   entry->hash = hash;
+   entry->key = key;
+   ht->entries++;
+
+   return entry;
 }
 
 struct set_entry *
@@ -370,7 +395,8 @@ _mesa_set_add_pre_hashed(struct set *set, uint32_t hash, const void *key)
  * This function deletes the given hash table entry.
  *
  * Note that deletion doesn't otherwise modify the table, so an iteration over
- * the table deleting entries is safe.
+ * the table deleting entries is safe. The slot only becomes a tombstone when
+ * lookups may have probed past it, see hash_ctrl_erase().
  */
 void
 _mesa_set_remove(struct set *ht, struct set_entry *entry)
@@ -378,9 +404,9 @@ _mesa_set_remove(struct set *ht, struct set_entry *entry)
    if (!entry)
       return;
 
-   entry->key = deleted_key;
+   if (hash_ctrl_erase(ht->ctrl, ht->size, entry - ht->table))
+      ht->deleted_entries++;
    ht->entries--;
-   ht->deleted_entries++;
 }
 
 /**
@@ -396,47 +422,46 @@ _mesa_set_remove_key(struct set *set, const void *key)
  * This function is an iterator over the hash table.
  *
  * Pass in NULL for the first entry, as in the start of a for loop.  Note that
- * an iteration over the table is O(table_size) not O(entries).
+ * an iteration over the table is O(table_size) not O(entries), but it only
+ * looks at the control bytes of empty slots.
  */
 struct set_entry *
 _mesa_set_next_entry(const struct set *ht, struct set_entry *entry)
 {
-   if (entry == NULL)
-      entry = ht->table;
-   else
-      entry = entry + 1;
-
-   for (; entry != ht->table + ht->size; entry++) {
-      if (entry_is_present(entry)) {
-         return entry;
-      }
-   }
+   struct set_entry *next = entry ? entry + 1 : ht->table;
+   uint32_t i = next - ht->table;
 
-   return NULL;
+   /* Most slots are in use, so check the next one before skipping ahead a
+    * group at a time.
+    */
+   if (i < ht->size && hash_ctrl_is_full(ht->ctrl[i]))
+      return next;
+
+   i = hash_ctrl_next_full(ht->ctrl, ht->size, i);
+
+   return i < ht->size ? ht->table + i : NULL;
 }
 
 struct set_entry *
 _mesa_set_random_entry(struct set *ht,
                        int (*predicate)(struct set_entry *entry))
 {
-   struct set_entry *entry;
-   uint32_t i = rand() % ht->size;
+   uint32_t start = rand() % ht->size;
+   uint32_t i;
 
    if (ht->entries == 0)
       return NULL;
 
-   for (entry = ht->table + i; entry != ht->table + ht->size; entry++) {
-      if (entry_is_present(entry) &&
-          (!predicate || predicate(entry))) {
-         return entry;
-      }
+   for (i = hash_ctrl_next_full(ht->ctrl, ht->size, start); i < ht->size;
+        i = hash_ctrl_next_full(ht->ctrl, ht->size, i + 1)) {
+      if (!predicate || predicate(ht->table + i))
+         return ht->table + i;
    }
 
-   for (entry = ht->table; entry != ht->table + i; entry++) {
-      if (entry_is_present(entry) &&
-          (!predicate || predicate(entry))) {
-         return entry;
-      }
+   for (i = hash_ctrl_next_full(ht->ctrl, ht->size, 0); i < start;
+        i = hash_ctrl_next_full(ht->ctrl, ht->size, i + 1)) {
+      if (!predicate || predicate(ht->table + i))
+         return ht->table + i;
    }
 
    return NULL;
@@ -40,13 +40,20 @@ struct set_entry {
    const void *key;
 };
 
+/**
+ * Open-addressing set with a power-of-two number of slots.
+ *
+ * Whether a slot of \c table holds an entry is tracked by the control byte
+ * array \c ctrl (see hash_table_group.h), which lives in the same
+ * allocation right after \c table.
+ */
 struct set {
    void *mem_ctx;
    struct set_entry *table;
+   uint8_t *ctrl;
    uint32_t (*key_hash_function)(const void *key);
    bool (*key_equals_function)(const void *a, const void *b);
    uint32_t size;
-   uint32_t rehash;
    uint32_t max_entries;
    uint32_t size_index;
    uint32_t entries;
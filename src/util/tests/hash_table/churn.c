@@ -0,0 +1,115 @@
+/*
+ * Copyright © 2019 The Mesa Authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/* Force assertions, even on release builds. */
+#undef NDEBUG
+
+#include <assert.h>
+#include <stdlib.h>
+#include "hash_table.h"
+
+#define NUM_KEYS 100000
+#define WINDOW 300
+
+static uint32_t
+key_value(const void *key)
+{
+   return *(const uint32_t *)key;
+}
+
+/* Only a few distinct hashes, so that keys pile up in long probe runs. */
+static uint32_t
+bad_hash(const void *key)
+{
+   return key_value(key) % 7;
+}
+
+static bool
+uint32_t_key_equals(const void *a, const void *b)
+{
+   return key_value(a) == key_value(b);
+}
+
+/* Keeps a sliding window of keys in the table, checking that the deleted
+ * ones are gone, the others are found, and that the table doesn't grow
+ * beyond what the window needs.
+ */
+static void
+churn(uint32_t (*key_hash_function)(const void *key))
+{
+   static uint32_t keys[NUM_KEYS];
+   struct hash_table *ht;
+   struct hash_entry *entry;
+   uint32_t i, count = 0;
+
+   ht = _mesa_hash_table_create(NULL, key_hash_function,
+                                uint32_t_key_equals);
+
+   for (i = 0; i < NUM_KEYS; i++) {
+      keys[i] = i;
+      _mesa_hash_table_insert(ht, keys + i, NULL);
+
+      if (i >= WINDOW)
+         _mesa_hash_table_remove_key(ht, keys + i - WINDOW);
+
+      if (i % 1000 == 0) {
+         uint32_t j;
+
+         for (j = i >= 2 * WINDOW ? i - 2 * WINDOW : 0; j <= i; j++) {
+            entry = _mesa_hash_table_search(ht, keys + j);
+            assert((entry != NULL) == (j + WINDOW > i));
+         }
+      }
+   }
+
+   assert(ht->entries == WINDOW);
+   assert(ht->size <= 4 * WINDOW);
+
+   /* Delete every other entry while iterating. */
+   hash_table_foreach(ht, entry) {
+      if (key_value(entry->key) % 2)
+         _mesa_hash_table_remove(ht, entry);
+      count++;
+   }
+   assert(count == WINDOW);
+   assert(ht->entries == WINDOW / 2);
+
+   for (i = NUM_KEYS - WINDOW; i < NUM_KEYS; i++) {
+      entry = _mesa_hash_table_search(ht, keys + i);
+      assert((entry != NULL) == (i % 2 == 0));
+   }
+
+   _mesa_hash_table_destroy(ht, NULL);
+}
+
+int
+main(int argc, char **argv)
+{
+   (void) argc;
+   (void) argv;
+
+   churn(key_value);
+   churn(bad_hash);
+
+   return 0;
+}
@@ -0,0 +1,185 @@
+/*
+ * Copyright © 2019 The Mesa Authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/* Measures the cost of the common hash table and set operations, with keys
+ * that look like the pointers NIR and GLSL passes use, for a range of table
+ * sizes. "churn" keeps the table at a fixed size while removing the oldest
+ * key and adding a new one, which is what long running passes do to their
+ * remap tables.
+ *
+ *   hash_table_bench [operations per run] [max keys]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "hash_table.h"
+#include "os_time.h"
+#include "set.h"
+
+static unsigned num_ops;
+
+/* Pointers to 16-byte aligned objects, like ralloc'ed IR. */
+static const void *
+make_key(unsigned i)
+{
+   return (const void *)(uintptr_t)(0x10000 + (uintptr_t)i * 48);
+}
+
+static double
+ns_per_op(int64_t start, unsigned ops)
+{
+   return (double)(os_time_get_nano() - start) / ops;
+}
+
+static void
+bench_hash_table(unsigned num_keys)
+{
+   unsigned rounds = num_ops / num_keys > 0 ? num_ops / num_keys : 1;
+   double insert, hit, miss, churn, iterate;
+   struct hash_table *ht = NULL;
+   struct hash_entry *entry;
+   uintptr_t sum = 0;
+   int64_t start;
+
+   start = os_time_get_nano();
+   for (unsigned r = 0; r < rounds; r++) {
+      _mesa_hash_table_destroy(ht, NULL);
+      ht = _mesa_hash_table_create(NULL, _mesa_hash_pointer,
+                                   _mesa_key_pointer_equal);
+      for (unsigned i = 0; i < num_keys; i++)
+         _mesa_hash_table_insert(ht, make_key(i), NULL);
+   }
+   insert = ns_per_op(start, rounds * num_keys);
+
+   start = os_time_get_nano();
+   for (unsigned r = 0; r < rounds; r++) {
+      for (unsigned i = 0; i < num_keys; i++)
+         sum += (uintptr_t)_mesa_hash_table_search(ht, make_key(i));
+   }
+   hit = ns_per_op(start, rounds * num_keys);
+
+   start = os_time_get_nano();
+   for (unsigned r = 0; r < rounds; r++) {
+      for (unsigned i = num_keys; i < 2 * num_keys; i++)
+         sum += (uintptr_t)_mesa_hash_table_search(ht, make_key(i));
+   }
+   miss = ns_per_op(start, rounds * num_keys);
+
+   start = os_time_get_nano();
+   for (unsigned i = num_keys; i < num_keys + rounds * num_keys; i++) {
+      _mesa_hash_table_remove_key(ht, make_key(i - num_keys));
+      _mesa_hash_table_insert(ht, make_key(i), NULL);
+   }
+   churn = ns_per_op(start, rounds * num_keys);
+
+   start = os_time_get_nano();
+   for (unsigned r = 0; r < rounds; r++) {
+      hash_table_foreach(ht, entry)
+         sum += (uintptr_t)entry->key;
+   }
+   iterate = ns_per_op(start, rounds * num_keys);
+
+   if (sum == 1)
+      printf("\n");
+
+   printf("hash_table %8u  %8.1f  %8.1f  %8.1f  %8.1f  %8.1f\n",
+          num_keys, insert, hit, miss, churn, iterate);
+
+   _mesa_hash_table_destroy(ht, NULL);
+}
+
+static void
+bench_set(unsigned num_keys)
+{
+   unsigned rounds = num_ops / num_keys > 0 ? num_ops / num_keys : 1;
+   double insert, hit, miss, churn, iterate;
+   struct set *set = NULL;
+   struct set_entry *entry;
+   uintptr_t sum = 0;
+   int64_t start;
+
+   start = os_time_get_nano();
+   for (unsigned r = 0; r < rounds; r++) {
+      _mesa_set_destroy(set, NULL);
+      set = _mesa_set_create(NULL, _mesa_hash_pointer,
+                             _mesa_key_pointer_equal);
+      for (unsigned i = 0; i < num_keys; i++)
+         _mesa_set_add(set, make_key(i));
+   }
+   insert = ns_per_op(start, rounds * num_keys);
+
+   start = os_time_get_nano();
+   for (unsigned r = 0; r < rounds; r++) {
+      for (unsigned i = 0; i < num_keys; i++)
+         sum += (uintptr_t)_mesa_set_search(set, make_key(i));
+   }
+   hit = ns_per_op(start, rounds * num_keys);
+
+   start = os_time_get_nano();
+   for (unsigned r = 0; r < rounds; r++) {
+      for (unsigned i = num_keys; i < 2 * num_keys; i++)
+         sum += (uintptr_t)_mesa_set_search(set, make_key(i));
+   }
+   miss = ns_per_op(start, rounds * num_keys);
+
+   start = os_time_get_nano();
+   for (unsigned i = num_keys; i < num_keys + rounds * num_keys; i++) {
+      _mesa_set_remove_key(set, make_key(i - num_keys));
+      _mesa_set_add(set, make_key(i));
+   }
+   churn = ns_per_op(start, rounds * num_keys);
+
+   start = os_time_get_nano();
+   for (unsigned r = 0; r < rounds; r++) {
+      set_foreach(set, entry)
+         sum += (uintptr_t)entry->key;
+   }
+   iterate = ns_per_op(start, rounds * num_keys);
+
+   if (sum == 1)
+      printf("\n");
+
+   printf("set        %8u  %8.1f  %8.1f  %8.1f  %8.1f  %8.1f\n",
+          num_keys, insert, hit, miss, churn, iterate);
+
+   _mesa_set_destroy(set, NULL);
+}
+
+int
+main(int argc, char **argv)
+{
+   unsigned max_keys = argc > 2 ? atoi(argv[2]) : 1 << 20;
+
+   num_ops = argc > 1 ? atoi(argv[1]) : 4000000;
+
+   printf("ns/op          keys    insert  hit       miss      churn     "
+          "iterate\n");
+
+   for (unsigned num_keys = 4; num_keys <= max_keys; num_keys *= 4)
+      bench_hash_table(num_keys);
+   for (unsigned num_keys = 4; num_keys <= max_keys; num_keys *= 4)
+      bench_set(num_keys);
+
+   return 0;
+}
@@ -0,0 +1,148 @@
+/*
+ * Copyright © 2019 The Mesa Authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/* Measures how many jobs per second a util_queue gets through for a range
+ * of worker thread counts, with one producer and with as many producers as
+ * workers. Jobs do next to nothing, so this is dominated by the cost of
+ * adding, dispatching and completing them.
+ *
+ *   u_queue_bench [jobs per run] [max threads] [work per job]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "util/os_time.h"
+#include "util/u_queue.h"
+
+struct producer {
+   thrd_t thread;
+   struct util_queue *queue;
+   struct util_queue_fence *fences;
+   unsigned num_jobs;
+};
+
+static unsigned work_per_job;
+static unsigned num_executed;
+
+static void
+execute_job(void *job, int thread_index)
+{
+   volatile unsigned x = 0;
+
+   for (unsigned i = 0; i < work_per_job; i++)
+      x += i;
+
+   p_atomic_inc(&num_executed);
+}
+
+static void
+add_jobs(struct producer *p)
+{
+   for (unsigned i = 0; i < p->num_jobs; i++) {
+      /* Keep the number of jobs in flight bounded like real users do. */
+      util_queue_fence_wait(&p->fences[i % 1024]);
+      util_queue_add_job(p->queue, p, &p->fences[i % 1024], execute_job,
+                         NULL);
+   }
+}
+
+static int
+producer_thread(void *data)
+{
+   add_jobs(data);
+   return 0;
+}
+
+static double
+run(unsigned num_threads, unsigned num_producers, unsigned num_jobs)
+{
+   struct producer *producers = calloc(num_producers, sizeof(*producers));
+   struct util_queue queue;
+   int64_t start, end;
+
+   if (!util_queue_init(&queue, "bench", 64, num_threads,
+                        UTIL_QUEUE_INIT_RESIZE_IF_FULL)) {
+      fprintf(stderr, "util_queue_init failed\n");
+      exit(1);
+   }
+
+   for (unsigned i = 0; i < num_producers; i++) {
+      producers[i].queue = &queue;
+      producers[i].num_jobs = num_jobs / num_producers;
+      producers[i].fences = calloc(1024, sizeof(*producers[i].fences));
+      for (unsigned j = 0; j < 1024; j++)
+         util_queue_fence_init(&producers[i].fences[j]);
+   }
+
+   num_executed = 0;
+   start = os_time_get_nano();
+
+   for (unsigned i = 1; i < num_producers; i++)
+      thrd_create(&producers[i].thread, producer_thread, &producers[i]);
+   add_jobs(&producers[0]);
+   for (unsigned i = 1; i < num_producers; i++)
+      thrd_join(producers[i].thread, NULL);
+
+   util_queue_finish(&queue);
+   end = os_time_get_nano();
+
+   if (num_executed != producers[0].num_jobs * num_producers) {
+      fprintf(stderr, "executed %u jobs out of %u\n", num_executed,
+              producers[0].num_jobs * num_producers);
+      exit(1);
+   }
+
+   util_queue_destroy(&queue);
+
+   for (unsigned i = 0; i < num_producers; i++) {
+      for (unsigned j = 0; j < 1024; j++)
+         util_queue_fence_destroy(&producers[i].fences[j]);
+      free(producers[i].fences);
+   }
+   free(producers);
+
+   return num_executed / ((end - start) / 1e9);
+}
+
+int
+main(int argc, char **argv)
+{
+   unsigned num_jobs = argc > 1 ? atoi(argv[1]) : 1000000;
+   unsigned max_threads = argc > 2 ? atoi(argv[2]) :
+                          sysconf(_SC_NPROCESSORS_ONLN);
+   work_per_job = argc > 3 ? atoi(argv[3]) : 0;
+
+   printf("threads  1 producer (jobs/s)  N producers (jobs/s)\n");
+
+   for (unsigned num_threads = 1; num_threads <= max_threads;
+        num_threads *= 2) {
+      double single = run(num_threads, 1, num_jobs);
+      double multi = run(num_threads, num_threads, num_jobs);
+
+      printf("%7u  %19.0f  %20.0f\n", num_threads, single, multi);
+   }
+
+   return 0;
+}
@@ -0,0 +1,293 @@
+/*
+ * Copyright © 2019 The Mesa Authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/* Force assertions, even on release builds. */
+#undef NDEBUG
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "util/u_queue.h"
+
+#define NUM_JOBS 1000
+
+struct test_job {
+   struct util_queue_fence fence;
+   unsigned id;
+   bool cleaned_up;
+};
+
+static unsigned order[NUM_JOBS * 4];
+static unsigned num_executed;
+
+/* Keeps the thread that executes it busy until the gate is signalled. */
+static struct util_queue_fence gate;
+
+static void
+record_job(void *data, int thread_index)
+{
+   struct test_job *job = data;
+
+   order[p_atomic_inc_return(&num_executed) - 1] = job->id;
+}
+
+static void
+cleanup_job(void *data, int thread_index)
+{
+   struct test_job *job = data;
+
+   job->cleaned_up = true;
+}
+
+static void
+wait_for_gate(void *data, int thread_index)
+{
+   util_queue_fence_wait(&gate);
+}
+
+static void
+init_jobs(struct test_job *jobs, unsigned count)
+{
+   for (unsigned i = 0; i < count; i++) {
+      util_queue_fence_init(&jobs[i].fence);
+      jobs[i].id = i;
+      jobs[i].cleaned_up = false;
+   }
+   num_executed = 0;
+}
+
+static void
+block_queue(struct util_queue *queue, struct test_job *job)
+{
+   util_queue_fence_reset(&gate);
+   util_queue_add_job(queue, job, &job->fence, wait_for_gate, NULL);
+}
+
+/* Jobs of a single thread queue are executed in order, including when they
+ * don't fit into the queue at first.
+ */
+static void
+test_order(unsigned flags)
+{
+   static struct test_job jobs[NUM_JOBS];
+   struct test_job blocker;
+   struct util_queue queue;
+
+   assert(util_queue_init(&queue, "test", 8, 1, flags));
+   init_jobs(jobs, NUM_JOBS);
+   util_queue_fence_init(&blocker.fence);
+
+   /* Make sure jobs pile up in a resizable queue. */
+   if (flags & UTIL_QUEUE_INIT_RESIZE_IF_FULL)
+      block_queue(&queue, &blocker);
+
+   for (unsigned i = 0; i < NUM_JOBS; i++) {
+      util_queue_add_job(&queue, &jobs[i], &jobs[i].fence, record_job,
+                         cleanup_job);
+      if (i == NUM_JOBS / 2 && (flags & UTIL_QUEUE_INIT_RESIZE_IF_FULL))
+         util_queue_fence_signal(&gate);
+   }
+
+   util_queue_finish(&queue);
+
+   assert(num_executed == NUM_JOBS);
+   for (unsigned i = 0; i < NUM_JOBS; i++) {
+      assert(order[i] == i);
+      assert(util_queue_fence_is_signalled(&jobs[i].fence));
+      assert(jobs[i].cleaned_up);
+   }
+
+   util_queue_destroy(&queue);
+}
+
+/* High priority jobs overtake queued jobs of normal priority. */
+static void
+test_priority(void)
+{
+   struct test_job jobs[4], blocker;
+   struct util_queue queue;
+
+   assert(util_queue_init(&queue, "test", 8, 1,
+                          UTIL_QUEUE_INIT_RESIZE_IF_FULL));
+   init_jobs(jobs, 4);
+   util_queue_fence_init(&blocker.fence);
+
+   block_queue(&queue, &blocker);
+   util_queue_add_job(&queue, &jobs[0], &jobs[0].fence, record_job, NULL);
+   util_queue_add_job(&queue, &jobs[1], &jobs[1].fence, record_job, NULL);
+   util_queue_add_job_with_priority(&queue, &jobs[2], &jobs[2].fence,
+                                    record_job, NULL,
+                                    UTIL_QUEUE_PRIORITY_HIGH);
+   util_queue_add_job_with_priority(&queue, &jobs[3], &jobs[3].fence,
+                                    record_job, NULL,
+                                    UTIL_QUEUE_PRIORITY_HIGH);
+   util_queue_fence_signal(&gate);
+
+   util_queue_finish(&queue);
+
+   assert(num_executed == 4);
+   assert(order[0] == 2 && order[1] == 3);
+   assert(order[2] == 0 && order[3] == 1);
+
+   util_queue_destroy(&queue);
+}
+
+/* Dropped jobs are cleaned up but never executed. */
+static void
+test_drop_job(unsigned flags)
+{
+   struct test_job jobs[16], blocker;
+   struct util_queue queue;
+
+   assert(util_queue_init(&queue, "test", 8, 1, flags));
+   init_jobs(jobs, 16);
+   util_queue_fence_init(&blocker.fence);
+
+   block_queue(&queue, &blocker);
+
+   /* With a resizable queue, the last ones go to the overflow. Otherwise
+    * stay below the limit, or adding would block.
+    */
+   unsigned num_jobs = (flags & UTIL_QUEUE_INIT_RESIZE_IF_FULL) ? 16 : 4;
+
+   for (unsigned i = 0; i < num_jobs; i++) {
+      util_queue_add_job(&queue, &jobs[i], &jobs[i].fence, record_job,
+                         cleanup_job);
+   }
+
+   util_queue_drop_job(&queue, &jobs[1].fence);
+   util_queue_drop_job(&queue, &jobs[num_jobs - 2].fence);
+   assert(util_queue_fence_is_signalled(&jobs[1].fence));
+   assert(jobs[1].cleaned_up);
+   assert(jobs[num_jobs - 2].cleaned_up);
+
+   util_queue_fence_signal(&gate);
+   util_queue_finish(&queue);
+
+   assert(num_executed == num_jobs - 2);
+   for (unsigned i = 0, j = 0; i < num_jobs; i++) {
+      if (i != 1 && i != num_jobs - 2)
+         assert(order[j++] == i);
+      assert(jobs[i].cleaned_up);
+   }
+
+   util_queue_destroy(&queue);
+}
+
+struct producer {
+   thrd_t thread;
+   struct util_queue *queue;
+   struct test_job *jobs;
+};
+
+static int
+add_many_jobs(void *data)
+{
+   struct producer *p = data;
+
+   for (unsigned i = 0; i < NUM_JOBS; i++) {
+      util_queue_add_job(p->queue, &p->jobs[i], &p->jobs[i].fence,
+                         record_job, cleanup_job);
+   }
+   return 0;
+}
+
+/* Several threads adding jobs to several threads. */
+static void
+test_producers(unsigned flags)
+{
+   static struct test_job jobs[4][NUM_JOBS];
+   struct producer producers[4];
+   struct util_queue queue;
+   unsigned count[NUM_JOBS] = {0};
+
+   assert(util_queue_init(&queue, "test", 8, 4, flags));
+   init_jobs(&jobs[0][0], 4 * NUM_JOBS);
+
+   for (unsigned i = 0; i < 4; i++) {
+      producers[i].queue = &queue;
+      producers[i].jobs = jobs[i];
+      for (unsigned j = 0; j < NUM_JOBS; j++)
+         jobs[i][j].id = j;
+      thrd_create(&producers[i].thread, add_many_jobs, &producers[i]);
+   }
+   for (unsigned i = 0; i < 4; i++)
+      thrd_join(producers[i].thread, NULL);
+
+   util_queue_finish(&queue);
+
+   assert(num_executed == 4 * NUM_JOBS);
+   for (unsigned i = 0; i < 4 * NUM_JOBS; i++)
+      count[order[i]]++;
+   for (unsigned i = 0; i < NUM_JOBS; i++)
+      assert(count[i] == 4);
+
+   for (unsigned i = 0; i < 4; i++) {
+      for (unsigned j = 0; j < NUM_JOBS; j++)
+         util_queue_fence_wait(&jobs[i][j].fence);
+   }
+
+   util_queue_destroy(&queue);
+}
+
+/* Destroying a queue signals the fences of the jobs it didn't execute. */
+static void
+test_destroy(void)
+{
+   struct test_job jobs[16], blocker;
+   struct util_queue queue;
+
+   assert(util_queue_init(&queue, "test", 4, 1,
+                          UTIL_QUEUE_INIT_RESIZE_IF_FULL));
+   init_jobs(jobs, 16);
+   util_queue_fence_init(&blocker.fence);
+
+   block_queue(&queue, &blocker);
+   for (unsigned i = 0; i < 16; i++)
+      util_queue_add_job(&queue, &jobs[i], &jobs[i].fence, record_job, NULL);
+
+   util_queue_fence_signal(&gate);
+   util_queue_destroy(&queue);
+
+   for (unsigned i = 0; i < 16; i++)
+      assert(util_queue_fence_is_signalled(&jobs[i].fence));
+}
+
+int
+main(int argc, char **argv)
+{
+   util_queue_fence_init(&gate);
+
+   test_order(0);
+   test_order(UTIL_QUEUE_INIT_RESIZE_IF_FULL);
+   test_priority();
+   test_drop_job(0);
+   test_drop_job(UTIL_QUEUE_INIT_RESIZE_IF_FULL);
+   test_producers(0);
+   test_producers(UTIL_QUEUE_INIT_RESIZE_IF_FULL);
+   test_destroy();
+
+   printf("all tests passed\n");
+   return 0;
+}
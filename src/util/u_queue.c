@@ -29,6 +29,7 @@
 #include <time.h>
 
 #include "util/os_time.h"
+#include "util/u_endian.h"
 #include "util/u_string.h"
 #include "util/u_thread.h"
 #include "u_process.h"
@@ -222,6 +223,243 @@ util_queue_fence_destroy(struct util_queue_fence *fence)
 }
 #endif
 
+/****************************************************************************
+ * util_queue_sem
+ */
+
+#ifdef UTIL_QUEUE_FENCE_FUTEX
+#define UTIL_QUEUE_SEM_WAITER (1ull << 32)
+
+/* The futex is the count half of the state. */
+static inline uint32_t *
+util_queue_sem_futex(struct util_queue_sem *sem)
+{
+#ifdef PIPE_ARCH_BIG_ENDIAN
+   return (uint32_t *)&sem->state + 1;
+#else
+   return (uint32_t *)&sem->state;
+#endif
+}
+
+static void
+util_queue_sem_init(struct util_queue_sem *sem, unsigned count)
+{
+   sem->state = count;
+}
+
+static void
+util_queue_sem_destroy(struct util_queue_sem *sem)
+{
+}
+
+/* Waking up a thread is only needed while there are fewer units than
+ * waiters. In particular, once woken up threads don't get to run right
+ * away, later posts don't keep making syscalls for them.
+ */
+static void
+util_queue_sem_post(struct util_queue_sem *sem)
+{
+   uint64_t state = p_atomic_inc_return(&sem->state) - 1;
+
+   if ((uint32_t)state < (state >> 32))
+      futex_wake(util_queue_sem_futex(sem), 1);
+}
+
+static void
+util_queue_sem_wait(struct util_queue_sem *sem)
+{
+   uint64_t state = p_atomic_read(&sem->state);
+   uint64_t waiter = 0;
+
+   while (1) {
+      uint64_t old;
+
+      if ((uint32_t)state) {
+         /* Take one, and stop counting as a waiter if we were one. */
+         old = p_atomic_cmpxchg(&sem->state, state, state - 1 - waiter);
+         if (old == state)
+            return;
+      } else if (!waiter) {
+         old = p_atomic_cmpxchg(&sem->state, state,
+                                state + UTIL_QUEUE_SEM_WAITER);
+         if (old == state) {
+            waiter = UTIL_QUEUE_SEM_WAITER;
+            old += UTIL_QUEUE_SEM_WAITER;
+         }
+      } else {
+         futex_wait(util_queue_sem_futex(sem), 0, NULL);
+         old = p_atomic_read(&sem->state);
+      }
+
+      state = old;
+   }
+}
+#endif
+
+#ifdef UTIL_QUEUE_FENCE_STANDARD
+static void
+util_queue_sem_init(struct util_queue_sem *sem, unsigned count)
+{
+   (void) mtx_init(&sem->mutex, mtx_plain);
+   cnd_init(&sem->cond);
+   sem->count = count;
+}
+
+static void
+util_queue_sem_destroy(struct util_queue_sem *sem)
+{
+   cnd_destroy(&sem->cond);
+   mtx_destroy(&sem->mutex);
+}
+
+static void
+util_queue_sem_post(struct util_queue_sem *sem)
+{
+   mtx_lock(&sem->mutex);
+   sem->count++;
+   cnd_signal(&sem->cond);
+   mtx_unlock(&sem->mutex);
+}
+
+static void
+util_queue_sem_wait(struct util_queue_sem *sem)
+{
+   mtx_lock(&sem->mutex);
+   while (sem->count == 0)
+      cnd_wait(&sem->cond, &sem->mutex);
+   sem->count--;
+   mtx_unlock(&sem->mutex);
+}
+#endif
+
+/****************************************************************************
+ * util_queue_ring
+ */
+
+struct util_queue_slot {
+   /* Equal to the position that may be written next if the slot is free,
+    * and to that position + 1 once the job has been written.
+    */
+   unsigned sequence;
+   /* Position whose job was last taken, either by a thread or by
+    * util_queue_drop_job().
+    */
+   unsigned claim;
+   struct util_queue_job job;
+};
+
+static bool
+util_queue_ring_init(struct util_queue_ring *ring, unsigned num_slots)
+{
+   ring->slots = (struct util_queue_slot*)
+                 calloc(num_slots, sizeof(struct util_queue_slot));
+   if (!ring->slots)
+      return false;
+
+   ring->mask = num_slots - 1;
+   for (unsigned i = 0; i < num_slots; i++) {
+      ring->slots[i].sequence = i;
+      ring->slots[i].claim = i - num_slots;
+   }
+   return true;
+}
+
+static bool
+util_queue_ring_push(struct util_queue_ring *ring,
+                     const struct util_queue_job *job)
+{
+   unsigned pos = p_atomic_read(&ring->enqueue_pos);
+   struct util_queue_slot *slot;
+
+   while (1) {
+      slot = &ring->slots[pos & ring->mask];
+      int diff = (int)(p_atomic_read(&slot->sequence) - pos);
+
+      if (diff == 0) {
+         unsigned old = p_atomic_cmpxchg(&ring->enqueue_pos, pos, pos + 1);
+         if (old == pos)
+            break;
+         pos = old;
+      } else if (diff < 0) {
+         /* The slot still holds a job from the previous lap. */
+         return false;
+      } else {
+         pos = p_atomic_read(&ring->enqueue_pos);
+      }
+   }
+
+   slot->job = *job;
+   p_atomic_set(&slot->sequence, pos + 1);
+   return true;
+}
+
+/* Take the next job. Its "job" is NULL if it was dropped. */
+static bool
+util_queue_ring_pop(struct util_queue_ring *ring, struct util_queue_job *job)
+{
+   unsigned pos = p_atomic_read(&ring->dequeue_pos);
+   struct util_queue_slot *slot;
+
+   while (1) {
+      slot = &ring->slots[pos & ring->mask];
+      int diff = (int)(p_atomic_read(&slot->sequence) - (pos + 1));
+
+      if (diff == 0) {
+         unsigned old = p_atomic_cmpxchg(&ring->dequeue_pos, pos, pos + 1);
+         if (old == pos)
+            break;
+         pos = old;
+      } else if (diff < 0) {
+         /* Empty, or the next job is still being written. */
+         return false;
+      } else {
+         pos = p_atomic_read(&ring->dequeue_pos);
+      }
+   }
+
+   unsigned prev_claim = pos - (ring->mask + 1);
+
+   if (p_atomic_cmpxchg(&slot->claim, prev_claim, pos) == prev_claim)
+      *job = slot->job;
+   else
+      memset(job, 0, sizeof(*job));
+
+   p_atomic_set(&slot->sequence, pos + ring->mask + 1);
+   return true;
+}
+
+/* Claim the queued job with the given fence so that no thread executes it.
+ * The slot itself is released by the thread that pops it.
+ */
+static bool
+util_queue_ring_drop(struct util_queue_ring *ring,
+                     struct util_queue_fence *fence)
+{
+   unsigned end = p_atomic_read(&ring->enqueue_pos);
+
+   for (unsigned pos = p_atomic_read(&ring->dequeue_pos);
+        (int)(end - pos) > 0; pos++) {
+      struct util_queue_slot *slot = &ring->slots[pos & ring->mask];
+
+      if (p_atomic_read(&slot->sequence) != pos + 1 ||
+          slot->job.fence != fence)
+         continue;
+
+      /* The job may be taken and the slot reused at any time, but then the
+       * claim doesn't match anymore and what was read is discarded.
+       */
+      struct util_queue_job job = slot->job;
+      unsigned prev_claim = pos - (ring->mask + 1);
+
+      if (p_atomic_cmpxchg(&slot->claim, prev_claim, pos) == prev_claim) {
+         if (job.cleanup)
+            job.cleanup(job.job, -1);
+         return true;
+      }
+   }
+   return false;
+}
+
 /****************************************************************************
  * util_queue implementation
  */
@@ -231,6 +469,78 @@ struct thread_input {
    int thread_index;
 };
 
+static void
+add_overflow_job(struct util_queue *queue, const struct util_queue_job *job)
+{
+   mtx_lock(&queue->lock);
+
+   /* The overflow may have been emptied in the meantime. */
+   if (queue->num_overflow == 0 &&
+       util_queue_ring_push(&queue->rings[UTIL_QUEUE_PRIORITY_NORMAL], job)) {
+      mtx_unlock(&queue->lock);
+      return;
+   }
+
+   if (queue->num_overflow == queue->overflow_size) {
+      /* Make it larger, keeping the jobs in order. */
+      int new_size = MAX2(queue->overflow_size * 2, queue->max_jobs);
+      struct util_queue_job *jobs =
+         (struct util_queue_job*)calloc(new_size,
+                                        sizeof(struct util_queue_job));
+      assert(jobs);
+
+      for (int i = 0; i < queue->num_overflow; i++) {
+         jobs[i] = queue->overflow[(queue->overflow_idx + i) %
+                                   queue->overflow_size];
+      }
+
+      free(queue->overflow);
+      queue->overflow = jobs;
+      queue->overflow_size = new_size;
+      queue->overflow_idx = 0;
+   }
+
+   queue->overflow[(queue->overflow_idx + queue->num_overflow) %
+                   queue->overflow_size] = *job;
+   p_atomic_inc(&queue->num_overflow);
+
+   mtx_unlock(&queue->lock);
+}
+
+static bool
+get_overflow_job(struct util_queue *queue, struct util_queue_job *job)
+{
+   bool found = false;
+
+   mtx_lock(&queue->lock);
+   if (queue->num_overflow) {
+      *job = queue->overflow[queue->overflow_idx];
+      queue->overflow_idx = (queue->overflow_idx + 1) % queue->overflow_size;
+      p_atomic_dec(&queue->num_overflow);
+      found = true;
+   }
+   mtx_unlock(&queue->lock);
+
+   return found;
+}
+
+/* Take the oldest job of the highest priority, if any. */
+static bool
+get_queued_job(struct util_queue *queue, struct util_queue_job *job)
+{
+   for (int i = UTIL_QUEUE_NUM_PRIORITIES - 1; i >= 0; i--) {
+      if (util_queue_ring_pop(&queue->rings[i], job)) {
+         if (!(queue->flags & UTIL_QUEUE_INIT_RESIZE_IF_FULL))
+            util_queue_sem_post(&queue->num_free);
+         return true;
+      }
+   }
+
+   /* Jobs in the overflow are always newer than those in the rings. */
+   return p_atomic_read(&queue->num_overflow) &&
+          get_overflow_job(queue, job);
+}
+
 static int
 util_queue_thread_func(void *input)
 {
@@ -248,25 +558,15 @@ util_queue_thread_func(void *input)
    while (1) {
       struct util_queue_job job;
 
-      mtx_lock(&queue->lock);
-      assert(queue->num_queued >= 0 && queue->num_queued <= queue->max_jobs);
-
       /* wait if the queue is empty */
-      while (!queue->kill_threads && queue->num_queued == 0)
-         cnd_wait(&queue->has_queued_cond, &queue->lock);
+      util_queue_sem_wait(&queue->num_queued);
 
-      if (queue->kill_threads) {
-         mtx_unlock(&queue->lock);
+      if (p_atomic_read(&queue->kill_threads))
          break;
-      }
-
-      job = queue->jobs[queue->read_idx];
-      memset(&queue->jobs[queue->read_idx], 0, sizeof(struct util_queue_job));
-      queue->read_idx = (queue->read_idx + 1) % queue->max_jobs;
 
-      queue->num_queued--;
-      cnd_signal(&queue->has_space_cond);
-      mtx_unlock(&queue->lock);
+      /* The job has been counted, but may not be completely added yet. */
+      while (!get_queued_job(queue, &job))
+         thrd_yield();
 
       if (job.job) {
          job.execute(job.job, thread_index);
@@ -276,18 +576,6 @@ util_queue_thread_func(void *input)
       }
    }
 
-   /* signal remaining jobs before terminating */
-   mtx_lock(&queue->lock);
-   for (unsigned i = queue->read_idx; i != queue->write_idx;
-        i = (i + 1) % queue->max_jobs) {
-      if (queue->jobs[i].job) {
-         util_queue_fence_signal(queue->jobs[i].fence);
-         queue->jobs[i].job = NULL;
-      }
-   }
-   queue->read_idx = queue->write_idx;
-   queue->num_queued = 0;
-   mtx_unlock(&queue->lock);
    return 0;
 }
 
@@ -298,7 +586,7 @@ util_queue_init(struct util_queue *queue,
                 unsigned num_threads,
                 unsigned flags)
 {
-   unsigned i;
+   unsigned i, ring_size;
 
    /* Form the thread name from process_name and name, limited to 13
     * characters. Characters 14-15 are reserved for the thread number.
@@ -332,17 +620,22 @@ util_queue_init(struct util_queue *queue,
    queue->num_threads = num_threads;
    queue->max_jobs = max_jobs;
 
-   queue->jobs = (struct util_queue_job*)
-                 calloc(max_jobs, sizeof(struct util_queue_job));
-   if (!queue->jobs)
-      goto fail;
-
    (void) mtx_init(&queue->lock, mtx_plain);
    (void) mtx_init(&queue->finish_lock, mtx_plain);
 
-   queue->num_queued = 0;
-   cnd_init(&queue->has_queued_cond);
-   cnd_init(&queue->has_space_cond);
+   /* Non-resizable queues are limited to max_jobs by num_free, the rings
+    * only need to be at least that large.
+    */
+   util_queue_sem_init(&queue->num_queued, 0);
+   util_queue_sem_init(&queue->num_free, max_jobs);
+
+   for (ring_size = 1; ring_size < max_jobs; ring_size *= 2)
+      ;
+
+   for (i = 0; i < UTIL_QUEUE_NUM_PRIORITIES; i++) {
+      if (!util_queue_ring_init(&queue->rings[i], ring_size))
+         goto fail;
+   }
 
    queue->threads = (thrd_t*) calloc(num_threads, sizeof(thrd_t));
    if (!queue->threads)
@@ -391,12 +684,14 @@ util_queue_init(struct util_queue *queue,
 fail:
    free(queue->threads);
 
-   if (queue->jobs) {
-      cnd_destroy(&queue->has_space_cond);
-      cnd_destroy(&queue->has_queued_cond);
-      mtx_destroy(&queue->lock);
-      free(queue->jobs);
-   }
+   for (i = 0; i < UTIL_QUEUE_NUM_PRIORITIES; i++)
+      free(queue->rings[i].slots);
+
+   util_queue_sem_destroy(&queue->num_free);
+   util_queue_sem_destroy(&queue->num_queued);
+   mtx_destroy(&queue->finish_lock);
+   mtx_destroy(&queue->lock);
+
    /* also util_queue_is_initialized can be used to check for success */
    memset(queue, 0, sizeof(*queue));
    return false;
@@ -405,17 +700,23 @@ fail:
 static void
 util_queue_killall_and_wait(struct util_queue *queue)
 {
+   struct util_queue_job job;
    unsigned i;
 
    /* Signal all threads to terminate. */
-   mtx_lock(&queue->lock);
-   queue->kill_threads = 1;
-   cnd_broadcast(&queue->has_queued_cond);
-   mtx_unlock(&queue->lock);
+   p_atomic_set(&queue->kill_threads, 1);
+   for (i = 0; i < queue->num_threads; i++)
+      util_queue_sem_post(&queue->num_queued);
 
    for (i = 0; i < queue->num_threads; i++)
       thrd_join(queue->threads[i], NULL);
    queue->num_threads = 0;
+
+   /* signal remaining jobs */
+   while (get_queued_job(queue, &job)) {
+      if (job.job)
+         util_queue_fence_signal(job.fence);
+   }
 }
 
 void
@@ -424,11 +725,13 @@ util_queue_destroy(struct util_queue *queue)
    util_queue_killall_and_wait(queue);
    remove_from_atexit_list(queue);
 
-   cnd_destroy(&queue->has_space_cond);
-   cnd_destroy(&queue->has_queued_cond);
+   util_queue_sem_destroy(&queue->num_free);
+   util_queue_sem_destroy(&queue->num_queued);
    mtx_destroy(&queue->finish_lock);
    mtx_destroy(&queue->lock);
-   free(queue->jobs);
+   for (unsigned i = 0; i < UTIL_QUEUE_NUM_PRIORITIES; i++)
+      free(queue->rings[i].slots);
+   free(queue->overflow);
    free(queue->threads);
 }
 
@@ -439,11 +742,26 @@ util_queue_add_job(struct util_queue *queue,
                    util_queue_execute_func execute,
                    util_queue_execute_func cleanup)
 {
-   struct util_queue_job *ptr;
+   util_queue_add_job_with_priority(queue, job, fence, execute, cleanup,
+                                    UTIL_QUEUE_PRIORITY_NORMAL);
+}
+
+/**
+ * Add a job that is executed before all queued jobs of a lower priority.
+ * Jobs of the same priority are executed in order.
+ */
+void
+util_queue_add_job_with_priority(struct util_queue *queue,
+                                 void *job,
+                                 struct util_queue_fence *fence,
+                                 util_queue_execute_func execute,
+                                 util_queue_execute_func cleanup,
+                                 enum util_queue_priority priority)
+{
+   struct util_queue_ring *ring = &queue->rings[priority];
+   struct util_queue_job ptr;
 
-   mtx_lock(&queue->lock);
-   if (queue->kill_threads) {
-      mtx_unlock(&queue->lock);
+   if (p_atomic_read(&queue->kill_threads)) {
       /* well no good option here, but any leaks will be
        * short-lived as things are shutting down..
        */
@@ -452,53 +770,30 @@ util_queue_add_job(struct util_queue *queue,
 
    util_queue_fence_reset(fence);
 
-   assert(queue->num_queued >= 0 && queue->num_queued <= queue->max_jobs);
-
-   if (queue->num_queued == queue->max_jobs) {
-      if (queue->flags & UTIL_QUEUE_INIT_RESIZE_IF_FULL) {
-         /* If the queue is full, make it larger to avoid waiting for a free
-          * slot.
-          */
-         unsigned new_max_jobs = queue->max_jobs + 8;
-         struct util_queue_job *jobs =
-            (struct util_queue_job*)calloc(new_max_jobs,
-                                           sizeof(struct util_queue_job));
-         assert(jobs);
-
-         /* Copy all queued jobs into the new list. */
-         unsigned num_jobs = 0;
-         unsigned i = queue->read_idx;
-
-         do {
-            jobs[num_jobs++] = queue->jobs[i];
-            i = (i + 1) % queue->max_jobs;
-         } while (i != queue->write_idx);
-
-         assert(num_jobs == queue->num_queued);
-
-         free(queue->jobs);
-         queue->jobs = jobs;
-         queue->read_idx = 0;
-         queue->write_idx = num_jobs;
-         queue->max_jobs = new_max_jobs;
-      } else {
-         /* Wait until there is a free slot. */
-         while (queue->num_queued == queue->max_jobs)
-            cnd_wait(&queue->has_space_cond, &queue->lock);
-      }
+   ptr.job = job;
+   ptr.fence = fence;
+   ptr.execute = execute;
+   ptr.cleanup = cleanup;
+
+   if (!(queue->flags & UTIL_QUEUE_INIT_RESIZE_IF_FULL)) {
+      /* Wait until there is a free slot. */
+      util_queue_sem_wait(&queue->num_free);
+
+      /* It may still be in the process of being freed. */
+      while (!util_queue_ring_push(ring, &ptr))
+         thrd_yield();
+   } else if (priority == UTIL_QUEUE_PRIORITY_NORMAL &&
+              p_atomic_read(&queue->num_overflow)) {
+      /* Queue behind the jobs that didn't fit before. */
+      add_overflow_job(queue, &ptr);
+   } else if (!util_queue_ring_push(ring, &ptr)) {
+      /* If the queue is full, make it larger to avoid waiting for a free
+       * slot. High priority jobs that don't fit lose their priority.
+       */
+      add_overflow_job(queue, &ptr);
    }
 
-   ptr = &queue->jobs[queue->write_idx];
-   assert(ptr->job == NULL);
-   ptr->job = job;
-   ptr->fence = fence;
-   ptr->execute = execute;
-   ptr->cleanup = cleanup;
-   queue->write_idx = (queue->write_idx + 1) % queue->max_jobs;
-
-   queue->num_queued++;
-   cnd_signal(&queue->has_queued_cond);
-   mtx_unlock(&queue->lock);
+   util_queue_sem_post(&queue->num_queued);
 }
 
 /**
@@ -519,20 +814,27 @@ util_queue_drop_job(struct util_queue *queue, struct util_queue_fence *fence)
    if (util_queue_fence_is_signalled(fence))
       return;
 
-   mtx_lock(&queue->lock);
-   for (unsigned i = queue->read_idx; i != queue->write_idx;
-        i = (i + 1) % queue->max_jobs) {
-      if (queue->jobs[i].fence == fence) {
-         if (queue->jobs[i].cleanup)
-            queue->jobs[i].cleanup(queue->jobs[i].job, -1);
-
-         /* Just clear it. The threads will treat as a no-op job. */
-         memset(&queue->jobs[i], 0, sizeof(queue->jobs[i]));
-         removed = true;
-         break;
+   for (unsigned i = 0; i < UTIL_QUEUE_NUM_PRIORITIES && !removed; i++)
+      removed = util_queue_ring_drop(&queue->rings[i], fence);
+
+   if (!removed && p_atomic_read(&queue->num_overflow)) {
+      mtx_lock(&queue->lock);
+      for (int i = 0; i < queue->num_overflow; i++) {
+         struct util_queue_job *ptr =
+            &queue->overflow[(queue->overflow_idx + i) % queue->overflow_size];
+
+         if (ptr->fence == fence) {
+            if (ptr->cleanup)
+               ptr->cleanup(ptr->job, -1);
+
+            /* Just clear it. The threads will treat as a no-op job. */
+            memset(ptr, 0, sizeof(*ptr));
+            removed = true;
+            break;
+         }
       }
+      mtx_unlock(&queue->lock);
    }
-   mtx_unlock(&queue->lock);
 
    if (removed)
       util_queue_fence_signal(fence);
@@ -197,21 +197,72 @@ struct util_queue_job {
    util_queue_execute_func cleanup;
 };
 
+enum util_queue_priority {
+   UTIL_QUEUE_PRIORITY_NORMAL,
+   /* Executed before any queued job of normal priority. */
+   UTIL_QUEUE_PRIORITY_HIGH,
+   UTIL_QUEUE_NUM_PRIORITIES,
+};
+
+struct util_queue_slot;
+
+/* Bounded lock-free multi-producer multi-consumer ring of jobs. Every slot
+ * carries a sequence number telling whether it's free for the producer or
+ * ready for the consumer of a given position, so producers and consumers
+ * only contend on their own position counter.
+ */
+struct util_queue_ring {
+   struct util_queue_slot *slots;
+   unsigned mask; /* number of slots - 1 */
+
+   /* Keep the positions on separate cache lines from each other and from
+    * the rest of the queue.
+    */
+   char pad0[64];
+   unsigned enqueue_pos;
+   char pad1[64];
+   unsigned dequeue_pos;
+   char pad2[64];
+};
+
+/* Counting semaphore. With futexes, the count lives in the low half and the
+ * number of waiters in the high half of the same word, so that waking up
+ * is only a syscall when someone is actually asleep.
+ */
+struct util_queue_sem {
+#ifdef UTIL_QUEUE_FENCE_FUTEX
+   uint64_t state;
+#else
+   mtx_t mutex;
+   cnd_t cond;
+   unsigned count;
+#endif
+};
+
 /* Put this into your context. */
 struct util_queue {
    char name[14]; /* 13 characters = the thread name without the index */
    mtx_t finish_lock; /* only for util_queue_finish */
-   mtx_t lock;
-   cnd_t has_queued_cond;
-   cnd_t has_space_cond;
    thrd_t *threads;
    unsigned flags;
-   int num_queued;
    unsigned num_threads;
    int kill_threads;
    int max_jobs;
-   int write_idx, read_idx; /* ring buffer pointers */
-   struct util_queue_job *jobs;
+
+   struct util_queue_ring rings[UTIL_QUEUE_NUM_PRIORITIES];
+
+   /* Number of queued jobs, and free slots unless the queue is resizable. */
+   struct util_queue_sem num_queued;
+   struct util_queue_sem num_free;
+
+   /* Jobs that didn't fit into the ring of a resizable queue. Until they
+    * have all been executed, new jobs are added here too, to keep them in
+    * order.
+    */
+   mtx_t lock;
+   int num_overflow;
+   int overflow_size, overflow_idx;
+   struct util_queue_job *overflow;
 
    /* for cleanup at exit(), protected by exit_mutex */
    struct list_head head;
@@ -230,6 +281,12 @@ void util_queue_add_job(struct util_queue *queue,
                         struct util_queue_fence *fence,
                         util_queue_execute_func execute,
                         util_queue_execute_func cleanup);
+void util_queue_add_job_with_priority(struct util_queue *queue,
+                                      void *job,
+                                      struct util_queue_fence *fence,
+                                      util_queue_execute_func execute,
+                                      util_queue_execute_func cleanup,
+                                      enum util_queue_priority priority);
 void util_queue_drop_job(struct util_queue *queue,
                          struct util_queue_fence *fence);
 